@@ -0,0 +1,451 @@
+//
+//  main.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/11.
+//
+
+// candidate_sim: replays an ICE gathering through custom::CandidateBatcher
+// against a local WebSocket echo stand-in, as SignalingService sends it, and
+// compares it with sending every candidate on its own.
+//
+//   candidate_sim [--window-ms W] [--max-candidates N] [--mlines M] [--seed S]
+//
+// The stand-in listens on a loopback TCP port and echoes every RFC 6455 frame
+// back unmasked, the way a signaling server relays to the peer; the HTTP
+// upgrade is left out. The trace is what a phone on Wi-Fi and cellular
+// gathers, IPv4 and IPv6: host candidates right away, server reflexive ones
+// after a STUN round trip, relayed ones after TURN allocation, with a few the
+// RFC 8445 rules make redundant. Frames are written with TCP_NODELAY, so each
+// is a packet. Prints frames, bytes, batch sizes and the latency from a
+// candidate being gathered to its echo arriving.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "CandidateBatcher.h"
+#include "SignalingCodec.h"
+
+namespace {
+
+constexpr uint8_t kOpcodeText = 0x1;
+constexpr uint8_t kOpcodeClose = 0x8;
+
+struct Options {
+  double window_ms = 20;
+  size_t max_candidates = 16;
+  int mlines = 1;
+  unsigned seed = 1;
+};
+
+struct GatherEvent {
+  int64_t at_ns = 0;
+  std::string sdp;
+  int32_t sdp_mline_index = 0;
+  std::string sdp_mid;
+};
+
+struct RunResult {
+  size_t frames = 0;
+  size_t bytes = 0;
+  size_t candidates = 0;
+  size_t dropped = 0;
+  double mean_batch = 0;
+  size_t max_batch = 0;
+  std::vector<int64_t> latencies_ns;
+};
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void SleepUntilNs(int64_t ns) {
+  const int64_t now_ns = NowNs();
+  if (ns > now_ns) {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(ns - now_ns));
+  }
+}
+
+bool ReadAll(int fd, void *data, size_t size) {
+  uint8_t *bytes = static_cast<uint8_t *>(data);
+  while (size > 0) {
+    const ssize_t n = read(fd, bytes, size);
+    if (n <= 0) {
+      return false;
+    }
+    bytes += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+bool WriteAll(int fd, const void *data, size_t size) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  while (size > 0) {
+    const ssize_t n = write(fd, bytes, size);
+    if (n <= 0) {
+      return false;
+    }
+    bytes += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// Writes one unfragmented frame, masked as clients must.
+bool WriteFrame(int fd, uint8_t opcode, std::string_view payload, bool masked, std::vector<uint8_t> *scratch) {
+  scratch->clear();
+  scratch->push_back(static_cast<uint8_t>(0x80 | opcode));
+  const uint8_t mask_bit = masked ? 0x80 : 0;
+  if (payload.size() < 126) {
+    scratch->push_back(static_cast<uint8_t>(mask_bit | payload.size()));
+  } else if (payload.size() <= 0xFFFF) {
+    scratch->push_back(mask_bit | 126);
+    scratch->push_back(static_cast<uint8_t>(payload.size() >> 8));
+    scratch->push_back(static_cast<uint8_t>(payload.size()));
+  } else {
+    scratch->push_back(mask_bit | 127);
+    for (int shift = 56; shift >= 0; shift -= 8) {
+      scratch->push_back(static_cast<uint8_t>(static_cast<uint64_t>(payload.size()) >> shift));
+    }
+  }
+  const uint8_t mask[4] = {0x37, 0xfa, 0x21, 0x3d};
+  if (masked) {
+    scratch->insert(scratch->end(), mask, mask + 4);
+  }
+  const size_t header = scratch->size();
+  scratch->insert(scratch->end(), payload.begin(), payload.end());
+  if (masked) {
+    for (size_t i = 0; i < payload.size(); ++i) {
+      (*scratch)[header + i] ^= mask[i & 3];
+    }
+  }
+  return WriteAll(fd, scratch->data(), scratch->size());
+}
+
+// Reads one frame, unmasking it if needed.
+bool ReadFrame(int fd, uint8_t *opcode, std::string *payload) {
+  uint8_t header[2];
+  if (!ReadAll(fd, header, sizeof(header))) {
+    return false;
+  }
+  *opcode = header[0] & 0x0F;
+  uint64_t size = header[1] & 0x7F;
+  if (size == 126 || size == 127) {
+    uint8_t extended[8];
+    const size_t count = size == 126 ? 2 : 8;
+    if (!ReadAll(fd, extended, count)) {
+      return false;
+    }
+    size = 0;
+    for (size_t i = 0; i < count; ++i) {
+      size = size << 8 | extended[i];
+    }
+  }
+  uint8_t mask[4] = {};
+  const bool masked = (header[1] & 0x80) != 0;
+  if (masked && !ReadAll(fd, mask, sizeof(mask))) {
+    return false;
+  }
+  payload->resize(size);
+  if (size > 0 && !ReadAll(fd, &(*payload)[0], size)) {
+    return false;
+  }
+  if (masked) {
+    for (size_t i = 0; i < size; ++i) {
+      (*payload)[i] ^= mask[i & 3];
+    }
+  }
+  return true;
+}
+
+// The stand-in: echoes the frames of one connection until it closes.
+void RunEcho(int listen_fd) {
+  const int fd = accept(listen_fd, nullptr, nullptr);
+  if (fd < 0) {
+    return;
+  }
+  const int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  std::string payload;
+  std::vector<uint8_t> scratch;
+  uint8_t opcode = 0;
+  while (ReadFrame(fd, &opcode, &payload)) {
+    WriteFrame(fd, opcode, payload, false, &scratch);
+    if (opcode == kOpcodeClose) {
+      break;
+    }
+  }
+  close(fd);
+}
+
+std::vector<GatherEvent> MakeTrace(const Options &options) {
+  std::mt19937 rng(options.seed);
+  auto jitter_ms = [&](double low, double high) {
+    return static_cast<int64_t>(std::uniform_real_distribution<double>(low, high)(rng) * 1e6);
+  };
+  struct Interface {
+    const char *address;
+    const char *reflexive;
+    int network_id;
+    int network_cost;
+  };
+  // Cellular IPv4 has a public address here, so its server reflexive
+  // candidate repeats the host one.
+  const Interface kInterfaces[] = {
+      {"192.168.1.23", "203.0.113.7", 1, 10},
+      {"fd00::1c2b:9aff:fe01:4411", nullptr, 2, 10},
+      {"198.51.100.88", "198.51.100.88", 3, 900},
+      {"2001:db8:85a3::8a2e:370:7334", nullptr, 4, 900},
+  };
+  std::vector<GatherEvent> trace;
+  uint32_t foundation = 842163049;
+  for (int mline = 0; mline < options.mlines; ++mline) {
+    int port = 50000 + mline * 100;
+    for (const Interface &interface : kInterfaces) {
+      auto add = [&](int64_t at_ns, const std::string &rest) {
+        GatherEvent event;
+        event.at_ns = at_ns;
+        event.sdp = "candidate:" + std::to_string(foundation++) + " 1 " + rest + " generation 0 ufrag 8hhY network-id " +
+                    std::to_string(interface.network_id) + " network-cost " + std::to_string(interface.network_cost);
+        event.sdp_mline_index = mline;
+        event.sdp_mid = std::to_string(mline);
+        trace.push_back(event);
+      };
+      const std::string address = interface.address;
+      const std::string host_port = std::to_string(++port);
+      const int64_t host_ns = jitter_ms(0.5, 6);
+      add(host_ns, "udp 2122260223 " + address + " " + host_port + " typ host");
+      add(host_ns + jitter_ms(0.2, 2), "tcp 1518280447 " + address + " 9 typ host tcptype active");
+      if (interface.reflexive) {
+        add(jitter_ms(40, 180), std::string("udp 1686052607 ") + interface.reflexive + " " + host_port +
+                                    " typ srflx raddr " + address + " rport " + host_port);
+      }
+      if (address.find(':') == std::string::npos) {
+        const std::string relay_port = std::to_string(60000 + port);
+        const int64_t relay_ns = jitter_ms(200, 450);
+        add(relay_ns, "udp 41885439 198.51.100.20 " + relay_port + " typ relay raddr " + address + " rport " +
+                          host_port);
+        add(relay_ns + jitter_ms(5, 40), "udp 25108223 198.51.100.20 " + std::to_string(60500 + port) +
+                                             " typ relay raddr " + address + " rport " + host_port);
+      }
+    }
+  }
+  // A network change makes the first interface's host candidate be gathered
+  // again, with a new foundation.
+  GatherEvent again = trace.front();
+  again.at_ns = jitter_ms(300, 500);
+  again.sdp.replace(again.sdp.find(' '), 0, "0");
+  trace.push_back(again);
+  std::stable_sort(trace.begin(), trace.end(),
+                   [](const GatherEvent &a, const GatherEvent &b) { return a.at_ns < b.at_ns; });
+  return trace;
+}
+
+// Sends |trace| over a fresh echo connection, batched if |batched|.
+bool Run(const std::vector<GatherEvent> &trace, const Options &options, bool batched, RunResult *result) {
+  const int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t length = sizeof(address);
+  if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+      listen(listen_fd, 1) != 0 || getsockname(listen_fd, reinterpret_cast<sockaddr *>(&address), &length) != 0) {
+    perror("candidate_sim: listen");
+    return false;
+  }
+  std::thread echo(RunEcho, listen_fd);
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+    perror("candidate_sim: connect");
+    shutdown(listen_fd, SHUT_RDWR);
+    echo.join();
+    close(listen_fd);
+    return false;
+  }
+  const int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  // Gather time of every candidate sent, by its SDP.
+  std::mutex mutex;
+  std::unordered_map<std::string, int64_t> gathered_ns;
+  std::thread reader([&] {
+    custom::SignalingParser parser;
+    custom::SignalingMessage message;
+    std::string payload;
+    uint8_t opcode = 0;
+    while (ReadFrame(fd, &opcode, &payload) && opcode == kOpcodeText) {
+      const int64_t now_ns = NowNs();
+      if (!parser.Parse(payload, &message)) {
+        fprintf(stderr, "candidate_sim: bad echo: %s\n", parser.error());
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      auto record = [&](const custom::SignalingCandidate &candidate) {
+        auto it = gathered_ns.find(std::string(candidate.sdp));
+        if (it != gathered_ns.end()) {
+          result->latencies_ns.push_back(now_ns - it->second);
+        }
+      };
+      if (message.has_candidate) {
+        record(message.candidate);
+      }
+      for (size_t i = 0; i < message.candidate_count; ++i) {
+        record(message.candidates[i]);
+      }
+    }
+  });
+
+  custom::SignalingWriter writer;
+  std::vector<uint8_t> scratch;
+  auto send = [&](const custom::SignalingCandidate *candidates, size_t count) {
+    custom::SignalingMessage message;
+    if (count == 1) {
+      message.type = custom::SignalingMessageType::kCandidate;
+      message.has_candidate = true;
+      message.candidate = candidates[0];
+    } else {
+      message.type = custom::SignalingMessageType::kCandidates;
+      message.candidates = candidates;
+      message.candidate_count = count;
+    }
+    const std::string_view json = writer.Write(message);
+    ++result->frames;
+    result->bytes += json.size();
+    WriteFrame(fd, kOpcodeText, json, true, &scratch);
+  };
+  custom::CandidateBatcherConfig config;
+  config.window_ns = batched ? static_cast<int64_t>(options.window_ms * 1e6) : 0;
+  config.max_candidates = options.max_candidates;
+  custom::CandidateBatcher batcher(config, send);
+
+  const int64_t start_ns = NowNs();
+  for (const GatherEvent &event : trace) {
+    // Send batches that fall due before the next candidate.
+    while (batcher.deadline_ns() >= 0 && batcher.deadline_ns() <= start_ns + event.at_ns) {
+      SleepUntilNs(batcher.deadline_ns());
+      batcher.Poll(NowNs());
+    }
+    SleepUntilNs(start_ns + event.at_ns);
+    custom::SignalingCandidate candidate;
+    candidate.sdp = event.sdp;
+    candidate.sdp_mline_index = event.sdp_mline_index;
+    candidate.has_sdp_mid = true;
+    candidate.sdp_mid = event.sdp_mid;
+    const int64_t now_ns = NowNs();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      gathered_ns[event.sdp] = now_ns;
+    }
+    if (batched) {
+      batcher.Add(candidate, now_ns);
+    } else {
+      send(&candidate, 1);
+    }
+  }
+  // Gathering completes with the last candidate.
+  batcher.Flush(NowNs());
+
+  // Wait for the echoes, then close.
+  for (int i = 0; i < 1000; ++i) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (result->latencies_ns.size() >= (batched ? batcher.stats().sent : trace.size())) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  WriteFrame(fd, kOpcodeClose, std::string_view(), true, &scratch);
+  reader.join();
+  echo.join();
+  close(fd);
+  close(listen_fd);
+
+  result->candidates = trace.size();
+  if (batched) {
+    const custom::CandidateBatchStats &stats = batcher.stats();
+    result->dropped = stats.duplicates;
+    result->mean_batch = stats.mean_batch();
+    result->max_batch = stats.max_batch;
+  } else {
+    result->mean_batch = 1;
+    result->max_batch = 1;
+  }
+  return true;
+}
+
+// Nearest rank percentile of sorted |values|.
+int64_t Percentile(const std::vector<int64_t> &values, int percent) {
+  if (values.empty()) {
+    return 0;
+  }
+  const size_t rank = (values.size() * percent + 99) / 100;
+  return values[rank == 0 ? 0 : rank - 1];
+}
+
+void Print(const char *mode, RunResult result) {
+  std::sort(result.latencies_ns.begin(), result.latencies_ns.end());
+  printf("%-14s %6zu %7zu %6zu %7zu %6.1f %4zu %8.2f %8.2f %8.2f\n", mode, result.frames, result.bytes,
+         result.candidates, result.dropped, result.mean_batch, result.max_batch,
+         Percentile(result.latencies_ns, 50) / 1e6, Percentile(result.latencies_ns, 90) / 1e6,
+         result.latencies_ns.empty() ? 0.0 : result.latencies_ns.back() / 1e6);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (i + 1 == argc) {
+      fprintf(stderr, "usage: candidate_sim [--window-ms W] [--max-candidates N] [--mlines M] [--seed S]\n");
+      return 2;
+    }
+    const char *value = argv[++i];
+    if (arg == "--window-ms") {
+      options.window_ms = atof(value);
+    } else if (arg == "--max-candidates") {
+      options.max_candidates = static_cast<size_t>(std::max(1, atoi(value)));
+    } else if (arg == "--mlines") {
+      options.mlines = std::max(1, atoi(value));
+    } else if (arg == "--seed") {
+      options.seed = static_cast<unsigned>(atoi(value));
+    } else {
+      fprintf(stderr, "candidate_sim: unknown option %s\n", arg.c_str());
+      return 2;
+    }
+  }
+
+  const std::vector<GatherEvent> trace = MakeTrace(options);
+  printf("%zu candidates gathered over %.0f ms\n", trace.size(), trace.back().at_ns / 1e6);
+  printf("%-14s %6s %7s %6s %7s %6s %4s %8s %8s %8s\n", "mode", "frames", "bytes", "cands", "dropped", "batch",
+         "max", "p50 ms", "p90 ms", "max ms");
+  RunResult single;
+  RunResult batched;
+  if (!Run(trace, options, false, &single) || !Run(trace, options, true, &batched)) {
+    return 1;
+  }
+  Print("per-candidate", single);
+  char mode[32];
+  snprintf(mode, sizeof(mode), "batched %gms", options.window_ms);
+  Print(mode, batched);
+  return 0;
+}
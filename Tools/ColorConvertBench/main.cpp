@@ -0,0 +1,120 @@
+//
+//  main.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/9.
+//
+
+// color_convert_bench: throughput of custom::ColorConversion between BGRA and
+// NV12, both ways, on every SIMD path this CPU supports.
+//
+//   color_convert_bench [--size WxH] [--seconds S]
+//
+// Prints megapixels per second and the speedup over the scalar path, for
+// BT.601 and BT.709 video range; the other combinations run the same kernels
+// with other constants.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "ColorConvert.h"
+
+namespace {
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Runs |conversion| repeatedly for about |seconds|; returns megapixels per second.
+double Run(const custom::ColorConversion &conversion, const custom::ColorImage &src, const custom::ColorImage &dst,
+           double seconds) {
+  int64_t frames = 0;
+  const int64_t start = NowNs();
+  int64_t elapsed_ns = 0;
+  do {
+    conversion.Convert(src, dst);
+    frames++;
+    elapsed_ns = NowNs() - start;
+  } while (elapsed_ns < seconds * 1e9);
+  return static_cast<double>(src.width) * src.height * frames / (elapsed_ns / 1e9) / 1e6;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int width = 1280;
+  int height = 720;
+  double seconds = 1.0;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &width, &height) == 2 &&
+        width > 0 && height > 0) {
+      ++i;
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: color_convert_bench [--size WxH] [--seconds S]\n");
+      return 2;
+    }
+  }
+
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  std::vector<uint8_t> bgra(static_cast<size_t>(width) * 4 * height);
+  std::vector<uint8_t> y(static_cast<size_t>(width) * height);
+  std::vector<uint8_t> uv(static_cast<size_t>(chroma_width) * 2 * chroma_height);
+  uint32_t state = 1;
+  for (uint8_t &value : bgra) {
+    state = state * 1664525u + 1013904223u;
+    value = static_cast<uint8_t>(state >> 24);
+  }
+  custom::ColorImage bgra_image;
+  bgra_image.layout = custom::PixelLayout::kBGRA;
+  bgra_image.width = width;
+  bgra_image.height = height;
+  bgra_image.planes[0] = bgra.data();
+  bgra_image.strides[0] = width * 4;
+  custom::ColorImage nv12_image;
+  nv12_image.layout = custom::PixelLayout::kNV12;
+  nv12_image.width = width;
+  nv12_image.height = height;
+  nv12_image.planes[0] = y.data();
+  nv12_image.planes[1] = uv.data();
+  nv12_image.strides[0] = width;
+  nv12_image.strides[1] = chroma_width * 2;
+
+  const struct {
+    const char *name;
+    custom::YuvMatrix matrix;
+  } kMatrices[] = {{"bt601", custom::YuvMatrix::kBT601}, {"bt709", custom::YuvMatrix::kBT709}};
+  const custom::SimdPath kPaths[] = {custom::SimdPath::kScalar, custom::SimdPath::kSSE2, custom::SimdPath::kAVX2,
+                                     custom::SimdPath::kNEON};
+
+  printf("%dx%d video range\n\n%-7s %-10s %-7s %10s %8s\n", width, height, "matrix", "direction", "path", "Mpix/s",
+         "speedup");
+  for (const auto &entry : kMatrices) {
+    for (int to_bgra = 0; to_bgra < 2; ++to_bgra) {
+      double scalar = 0;
+      for (custom::SimdPath path : kPaths) {
+        if (!custom::IsSimdPathSupported(path)) {
+          continue;
+        }
+        const custom::ColorImage &src = to_bgra ? nv12_image : bgra_image;
+        const custom::ColorImage &dst = to_bgra ? bgra_image : nv12_image;
+        const custom::ColorConversion conversion =
+            custom::ColorConversion::Select(entry.matrix, custom::YuvRange::kVideo, src.layout, dst.layout, path);
+        const double mpix = Run(conversion, src, dst, seconds);
+        if (path == custom::SimdPath::kScalar) {
+          scalar = mpix;
+        }
+        printf("%-7s %-10s %-7s %10.1f %7.2fx\n", entry.name, to_bgra ? "nv12>bgra" : "bgra>nv12",
+               custom::SimdPathName(path), mpix, scalar ? mpix / scalar : 0);
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,172 @@
+//
+//  main.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/14.
+//
+
+// conversion_scaling_bench: BGRA to NV12 conversion split into row bands on a
+// custom::WorkStealingPool of 1 to N threads, the way CustomPixelBufferUtils
+// converts frames, at 720p, 1080p and 4K.
+//
+//   conversion_scaling_bench [--threads N] [--size WxH] [--seconds S]
+//
+// --size replaces the three default sizes. Prints megapixels per second, the
+// speedup over one thread and the tasks stolen per frame.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "ColorConvert.h"
+#include "WorkStealingPool.h"
+
+namespace {
+
+// Same as CustomPixelBufferUtils.
+const int kMinBandRows = 32;
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Size {
+  int width;
+  int height;
+};
+
+struct Frame {
+  int width = 0;
+  int height = 0;
+  int stride_bgra = 0;
+  int stride_y = 0;
+  int stride_uv = 0;
+  std::vector<uint8_t> bgra;
+  std::vector<uint8_t> y;
+  std::vector<uint8_t> uv;
+};
+
+// A noise frame with padded rows, like IOSurface backed pixel buffers.
+Frame MakeFrame(int width, int height) {
+  Frame frame;
+  frame.width = width;
+  frame.height = height;
+  frame.stride_bgra = width * 4 + 64;
+  frame.stride_y = width + 64;
+  frame.stride_uv = (width + 1) / 2 * 2 + 64;
+  frame.bgra.resize(static_cast<size_t>(frame.stride_bgra) * height);
+  frame.y.resize(static_cast<size_t>(frame.stride_y) * height);
+  frame.uv.resize(static_cast<size_t>(frame.stride_uv) * ((height + 1) / 2));
+  uint32_t state = 1;
+  for (uint8_t &value : frame.bgra) {
+    state = state * 1664525u + 1013904223u;
+    value = static_cast<uint8_t>(state >> 24);
+  }
+  return frame;
+}
+
+// Rows [first_row, end_row) of |image|; |first_row| is even.
+custom::ColorImage RowBand(const custom::ColorImage &image, int first_row, int end_row) {
+  custom::ColorImage band = image;
+  band.height = end_row - first_row;
+  for (int i = 0; i < custom::kMaxPlanes; ++i) {
+    if (band.planes[i]) {
+      band.planes[i] += static_cast<size_t>(i == 0 ? first_row : first_row / 2) * band.strides[i];
+    }
+  }
+  return band;
+}
+
+// Converts |frame| in bands on |pool| repeatedly for about |seconds|; returns
+// megapixels per second, or a negative value if a band failed.
+double Run(custom::WorkStealingPool *pool, const custom::ColorConversion &conversion, Frame *frame, double seconds) {
+  custom::ColorImage src;
+  src.layout = custom::PixelLayout::kBGRA;
+  src.width = frame->width;
+  src.height = frame->height;
+  src.planes[0] = frame->bgra.data();
+  src.strides[0] = frame->stride_bgra;
+  custom::ColorImage dst;
+  dst.layout = custom::PixelLayout::kNV12;
+  dst.width = frame->width;
+  dst.height = frame->height;
+  dst.planes[0] = frame->y.data();
+  dst.planes[1] = frame->uv.data();
+  dst.strides[0] = frame->stride_y;
+  dst.strides[1] = frame->stride_uv;
+
+  std::atomic<bool> ok{true};
+  int64_t frames = 0;
+  const int64_t start = NowNs();
+  int64_t elapsed_ns = 0;
+  do {
+    custom::ForEachRowBand(pool, frame->height, 2, kMinBandRows, [&](int first_row, int end_row) {
+      if (!conversion.Convert(RowBand(src, first_row, end_row), RowBand(dst, first_row, end_row))) {
+        ok = false;
+      }
+    });
+    frames++;
+    elapsed_ns = NowNs() - start;
+  } while (elapsed_ns < seconds * 1e9);
+  if (!ok.load()) {
+    return -1;
+  }
+  return static_cast<double>(frame->width) * frame->height * frames / (elapsed_ns / 1e9) / 1e6;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int max_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  double seconds = 1.0;
+  std::vector<Size> sizes = {{1280, 720}, {1920, 1080}, {3840, 2160}};
+  for (int i = 1; i < argc; ++i) {
+    Size size;
+    if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+      max_threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc &&
+               sscanf(argv[i + 1], "%dx%d", &size.width, &size.height) == 2 && size.width > 0 && size.height > 0) {
+      sizes = {size};
+      ++i;
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: conversion_scaling_bench [--threads N] [--size WxH] [--seconds S]\n");
+      return 2;
+    }
+  }
+
+  // The conversion of CustomPixelBufferUtils, selected once.
+  const custom::ColorConversion conversion = custom::ColorConversion::Select(
+      custom::YuvMatrix::kBT601, custom::YuvRange::kVideo, custom::PixelLayout::kBGRA, custom::PixelLayout::kNV12);
+  printf("bgra>nv12, %d row minimum bands, %s path\n\n%-10s %7s %10s %8s %12s\n", kMinBandRows,
+         custom::SimdPathName(conversion.path()), "size", "threads", "Mpix/s", "speedup", "steals/frame");
+  for (const Size &size : sizes) {
+    Frame frame = MakeFrame(size.width, size.height);
+    double single = 0;
+    for (int threads = 1; threads <= max_threads; ++threads) {
+      custom::WorkStealingPool pool(threads);
+      const double mpix = Run(&pool, conversion, &frame, seconds);
+      if (mpix < 0) {
+        fprintf(stderr, "conversion failed at %dx%d\n", size.width, size.height);
+        return 1;
+      }
+      if (threads == 1) {
+        single = mpix;
+      }
+      const custom::WorkStealingPoolStats stats = pool.stats();
+      char name[32];
+      snprintf(name, sizeof(name), "%dx%d", size.width, size.height);
+      printf("%-10s %7d %10.1f %7.2fx %12.2f\n", name, threads, mpix, single ? mpix / single : 0,
+             stats.jobs ? static_cast<double>(stats.steals) / stats.jobs : 0);
+    }
+  }
+  return 0;
+}
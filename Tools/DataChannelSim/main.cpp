@@ -0,0 +1,508 @@
+//
+//  main.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/13.
+//
+
+// datachannel_sim: sends a burst of binary messages through custom::BulkSender
+// and custom::BulkReceiver over an in-memory stand-in for a data channel, in
+// virtual time, for a few send windows, and compares that with sending every
+// message whole, as WebRTCService did before.
+//
+//   datachannel_sim [--rate-mbps R] [--rtt-ms T] [--callback-ms C] [--open-ms O]
+//                   [--messages N] [--max-kb K] [--interval-ms I] [--seed S]
+//                   [--bulk-mb B] [--control-ms C]
+//
+// The stand-in keeps what is sent in a send buffer, whose size is the
+// channel's bufferedAmount, drains it at the link rate, and delivers each
+// message half a round trip after it drained. Like libwebrtc it refuses
+// messages larger than 256 KiB, the default a=max-message-size, and any sent
+// before it opens. The sender hears of a drained buffer a callback delay
+// later, the hop from the signaling thread to the transfer's queue.
+//
+// The workload is N messages of 1 KiB to K KiB, one every I ms from t = 0,
+// so the first ones are sent while the channel is still connecting. Every
+// message received is checked against what was sent. Prints messages
+// delivered, throughput, the largest bufferedAmount, the time from a message
+// being sent to it being delivered, and the receiver's buffer pool use.
+//
+// A second run saturates the channel with two bulk streams of B MiB each in
+// 1 MiB messages, weighted 1 and 3, and sends a 200 byte control message
+// every C ms meanwhile. Prints the control messages' send to delivery time,
+// bulk throughput and the bulk streams' share of the channel while both had
+// data queued, for control messages queued behind bulk ones on a single
+// stream, sent as unframed text past the sender as sendMessge used to, and on
+// a priority 0 stream with a few windows.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BulkTransfer.h"
+
+namespace {
+
+constexpr int64_t kNever = std::numeric_limits<int64_t>::max();
+constexpr size_t kMaxMessageSize = 256 << 10;
+
+constexpr uint16_t kControlStream = 1;
+constexpr uint16_t kBulkStreams[] = {2, 3};
+constexpr uint32_t kBulkWeights[] = {1, 3};
+constexpr size_t kControlSize = 200;
+constexpr size_t kBulkMessageSize = 1 << 20;
+
+struct Options {
+  double rate_mbps = 50;
+  double rtt_ms = 40;
+  double callback_ms = 0.5;
+  double open_ms = 30;
+  size_t messages = 48;
+  size_t max_kb = 1024;
+  double interval_ms = 100;
+  unsigned seed = 1;
+  size_t bulk_mb = 16;
+  double control_ms = 20;
+};
+
+struct Message {
+  int64_t send_ns = 0;
+  std::vector<uint8_t> data;
+  uint64_t hash = 0;
+};
+
+uint64_t Hash(const uint8_t *data, size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+std::vector<Message> MakeWorkload(const Options &options) {
+  std::mt19937 random(options.seed);
+  std::uniform_int_distribution<size_t> size_kb(1, std::max<size_t>(options.max_kb, 1));
+  std::vector<Message> messages(options.messages);
+  for (size_t i = 0; i < messages.size(); i++) {
+    messages[i].send_ns = static_cast<int64_t>(i * options.interval_ms * 1e6);
+    messages[i].data.resize(size_kb(random) * 1024);
+    for (uint8_t &byte : messages[i].data) {
+      byte = static_cast<uint8_t>(random());
+    }
+    messages[i].hash = Hash(messages[i].data.data(), messages[i].data.size());
+  }
+  return messages;
+}
+
+// The data channel stand-in. Time only moves in Advance().
+class Channel {
+ public:
+  using ReceiveFunc = std::function<void(const std::vector<uint8_t> &message, int64_t now_ns)>;
+
+  Channel(const Options &options, ReceiveFunc receive)
+      : ns_per_byte_(8e3 / options.rate_mbps),
+        one_way_ns_(static_cast<int64_t>(options.rtt_ms * 1e6 / 2)),
+        open_ns_(static_cast<int64_t>(options.open_ms * 1e6)),
+        receive_(std::move(receive)) {}
+
+  bool Send(const uint8_t *data, size_t size) {
+    if (now_ns_ < open_ns_ || size > kMaxMessageSize) {
+      return false;
+    }
+    if (buffer_.empty()) {
+      drained_ns_ = now_ns_ + SerializationNs(size);
+    }
+    buffer_.emplace_back(data, data + size);
+    buffered_amount_ += size;
+    peak_buffered_ = std::max(peak_buffered_, buffered_amount_);
+    return true;
+  }
+
+  // When the channel opens, the head of the send buffer drains, or the
+  // oldest message in flight arrives, whichever is first.
+  int64_t next_event_ns() const {
+    int64_t next = now_ns_ < open_ns_ ? open_ns_ : kNever;
+    if (!buffer_.empty()) {
+      next = std::min(next, drained_ns_);
+    }
+    if (!in_flight_.empty()) {
+      next = std::min(next, in_flight_.front().first);
+    }
+    return next;
+  }
+
+  // Moves to |now_ns|, which is at most next_event_ns(). Returns true if the
+  // channel opened or bufferedAmount went down.
+  bool Advance(int64_t now_ns) {
+    const bool opened = now_ns_ < open_ns_ && now_ns >= open_ns_;
+    now_ns_ = now_ns;
+    bool drained = false;
+    while (!buffer_.empty() && drained_ns_ <= now_ns_) {
+      buffered_amount_ -= buffer_.front().size();
+      in_flight_.emplace_back(drained_ns_ + one_way_ns_, std::move(buffer_.front()));
+      buffer_.pop_front();
+      if (!buffer_.empty()) {
+        drained_ns_ += SerializationNs(buffer_.front().size());
+      }
+      drained = true;
+    }
+    while (!in_flight_.empty() && in_flight_.front().first <= now_ns_) {
+      receive_(in_flight_.front().second, now_ns_);
+      in_flight_.pop_front();
+    }
+    return opened || drained;
+  }
+
+  int64_t now_ns() const { return now_ns_; }
+  uint64_t buffered_amount() const { return buffered_amount_; }
+  uint64_t peak_buffered() const { return peak_buffered_; }
+
+ private:
+  int64_t SerializationNs(size_t size) const { return static_cast<int64_t>(size * ns_per_byte_); }
+
+  const double ns_per_byte_;
+  const int64_t one_way_ns_;
+  const int64_t open_ns_;
+  ReceiveFunc receive_;
+  int64_t now_ns_ = 0;
+  std::deque<std::vector<uint8_t>> buffer_;
+  int64_t drained_ns_ = 0;
+  std::deque<std::pair<int64_t, std::vector<uint8_t>>> in_flight_;
+  uint64_t buffered_amount_ = 0;
+  uint64_t peak_buffered_ = 0;
+};
+
+struct RunResult {
+  size_t delivered = 0;
+  size_t corrupt = 0;
+  uint64_t bytes = 0;
+  int64_t first_delivery_ns = -1;
+  int64_t last_delivery_ns = 0;
+  std::vector<int64_t> latencies_ns;
+  uint64_t peak_buffered = 0;
+  uint64_t stalls = 0;
+  uint64_t pool_hits = 0;
+  uint64_t pool_misses = 0;
+};
+
+void Delivered(const Message &message, const uint8_t *data, size_t size, int64_t now_ns, RunResult *result) {
+  if (size != message.data.size() || Hash(data, size) != message.hash) {
+    result->corrupt++;
+    return;
+  }
+  result->delivered++;
+  result->bytes += size;
+  if (result->first_delivery_ns < 0) {
+    result->first_delivery_ns = now_ns;
+  }
+  result->last_delivery_ns = now_ns;
+  result->latencies_ns.push_back(now_ns - message.send_ns);
+}
+
+// Sends every message whole, dropping what the channel refuses.
+RunResult RunWhole(const std::vector<Message> &messages, const Options &options) {
+  RunResult result;
+  Channel channel(options, [&](const std::vector<uint8_t> &data, int64_t now_ns) {
+    // The first 8 bytes carry the message index.
+    uint64_t index = 0;
+    std::memcpy(&index, data.data(), sizeof(index));
+    Delivered(messages[index], data.data() + sizeof(index), data.size() - sizeof(index), now_ns, &result);
+  });
+  std::vector<uint8_t> tagged;
+  size_t next = 0;
+  for (;;) {
+    const int64_t next_send = next < messages.size() ? messages[next].send_ns : kNever;
+    const int64_t now = std::min(next_send, channel.next_event_ns());
+    if (now == kNever) {
+      break;
+    }
+    channel.Advance(now);
+    while (next < messages.size() && messages[next].send_ns <= now) {
+      const uint64_t index = next;
+      tagged.resize(sizeof(index) + messages[next].data.size());
+      std::memcpy(tagged.data(), &index, sizeof(index));
+      std::memcpy(tagged.data() + sizeof(index), messages[next].data.data(), messages[next].data.size());
+      channel.Send(tagged.data(), tagged.size());
+      next++;
+    }
+  }
+  result.peak_buffered = channel.peak_buffered();
+  return result;
+}
+
+RunResult RunFramed(const std::vector<Message> &messages, const Options &options, uint64_t window) {
+  RunResult result;
+  int64_t receive_ns = 0;
+  // BulkSender numbers messages from 0 in Enqueue() order.
+  custom::BulkReceiver receiver(custom::BulkReceiverConfig(), [&](const custom::ReceivedMessage &message) {
+    Delivered(messages[message.message_id], message.data, message.size, receive_ns, &result);
+  });
+  Channel channel(options, [&](const std::vector<uint8_t> &frame, int64_t now_ns) {
+    receive_ns = now_ns;
+    receiver.OnFrame(frame.data(), frame.size(), now_ns);
+  });
+  custom::BulkSenderConfig config;
+  config.high_water = window;
+  config.low_water = window / 4;
+  config.max_queued_bytes = std::numeric_limits<size_t>::max();
+  custom::BulkSender sender(config, [&](const uint8_t *frame, size_t size, bool) { return channel.Send(frame, size); });
+
+  const int64_t callback_ns = static_cast<int64_t>(options.callback_ms * 1e6);
+  int64_t pump_ns = kNever;
+  size_t next = 0;
+  for (;;) {
+    const int64_t next_send = next < messages.size() ? messages[next].send_ns : kNever;
+    const int64_t now = std::min({next_send, pump_ns, channel.next_event_ns()});
+    if (now == kNever) {
+      break;
+    }
+    if (channel.Advance(now) && pump_ns == kNever) {
+      pump_ns = now + callback_ns;
+    }
+    bool pump = now >= pump_ns;
+    while (next < messages.size() && messages[next].send_ns <= now) {
+      sender.Enqueue(0, messages[next].data.data(), messages[next].data.size(), nullptr, now);
+      next++;
+      pump = true;
+    }
+    if (pump) {
+      pump_ns = kNever;
+      sender.Pump(channel.buffered_amount(), now);
+    }
+  }
+  result.peak_buffered = channel.peak_buffered();
+  result.stalls = sender.stats().stalls;
+  result.pool_hits = receiver.pool().stats().hits;
+  result.pool_misses = receiver.pool().stats().misses;
+  return result;
+}
+
+enum class ControlMode {
+  // Control messages queued on the bulk stream, behind whole bulk messages.
+  kSameStream,
+  // Sent to the channel directly, unframed, past the sender.
+  kUnframed,
+  // On their own stream of priority 0.
+  kPriority,
+};
+
+struct MuxResult {
+  std::vector<int64_t> control_latencies_ns;
+  uint64_t bulk_bytes = 0;
+  int64_t bulk_first_ns = -1;
+  int64_t bulk_last_ns = 0;
+  // Payload bytes of each bulk stream received by the time the first of them
+  // was done.
+  uint64_t share_bytes[2] = {};
+};
+
+MuxResult RunMux(const Options &options, ControlMode mode, uint64_t window) {
+  MuxResult result;
+  uint64_t stream_bytes[2] = {};
+  const uint64_t bulk_total = options.bulk_mb * kBulkMessageSize;
+  auto control_received = [&](const uint8_t *data, int64_t now_ns) {
+    int64_t sent_ns = 0;
+    std::memcpy(&sent_ns, data, sizeof(sent_ns));
+    result.control_latencies_ns.push_back(now_ns - sent_ns);
+  };
+  int64_t receive_ns = 0;
+  custom::BulkReceiver receiver(custom::BulkReceiverConfig(), [&](const custom::ReceivedMessage &message) {
+    if (message.size == kControlSize) {
+      control_received(message.data, receive_ns);
+    }
+  });
+  Channel channel(options, [&](const std::vector<uint8_t> &frame, int64_t now_ns) {
+    custom::DataFrameHeader header;
+    const char *error = nullptr;
+    if (!custom::ReadDataFrameHeader(frame.data(), frame.size(), &header, &error)) {
+      control_received(frame.data(), now_ns);
+      return;
+    }
+    if (header.message_size == kBulkMessageSize) {
+      const size_t payload = frame.size() - custom::kDataFrameHeaderSize;
+      result.bulk_bytes += payload;
+      if (result.bulk_first_ns < 0) {
+        result.bulk_first_ns = now_ns;
+      }
+      result.bulk_last_ns = now_ns;
+      for (int i = 0; i < 2; i++) {
+        if (header.stream == kBulkStreams[i]) {
+          stream_bytes[i] += payload;
+        }
+      }
+      if (result.share_bytes[0] == 0 && (stream_bytes[0] == bulk_total || stream_bytes[1] == bulk_total)) {
+        result.share_bytes[0] = stream_bytes[0];
+        result.share_bytes[1] = stream_bytes[1];
+      }
+    }
+    receive_ns = now_ns;
+    receiver.OnFrame(frame.data(), frame.size(), now_ns);
+  });
+
+  custom::BulkSenderConfig config;
+  config.high_water = window;
+  config.low_water = window / 4;
+  config.max_queued_bytes = std::numeric_limits<size_t>::max();
+  custom::BulkSender sender(config, [&](const uint8_t *frame, size_t size, bool) { return channel.Send(frame, size); });
+  sender.SetStreamConfig(kControlStream, {0, 1});
+  for (int i = 0; i < 2; i++) {
+    sender.SetStreamConfig(kBulkStreams[i], {1, kBulkWeights[i]});
+  }
+  // Bulk messages all queued up front; a single stream in kSameStream.
+  const std::vector<uint8_t> bulk(kBulkMessageSize);
+  for (size_t i = 0; i < options.bulk_mb; i++) {
+    for (int j = 0; j < 2; j++) {
+      const uint16_t stream = mode == ControlMode::kSameStream ? kBulkStreams[0] : kBulkStreams[j];
+      sender.Enqueue(stream, bulk.data(), bulk.size(), nullptr, 0);
+    }
+  }
+
+  // Control messages from once the bulk streams filled the window until they
+  // are about done.
+  const int64_t control_interval_ns = std::max<int64_t>(static_cast<int64_t>(options.control_ms * 1e6), 1);
+  const int64_t control_end_ns = static_cast<int64_t>(options.open_ms * 1e6 + 2 * bulk_total * 8e3 / options.rate_mbps);
+  int64_t control_ns = static_cast<int64_t>(options.open_ms * 1e6) + 100000000;
+  std::vector<std::vector<uint8_t>> controls;
+  const int64_t callback_ns = static_cast<int64_t>(options.callback_ms * 1e6);
+  int64_t pump_ns = kNever;
+  for (;;) {
+    const int64_t next_control = control_ns < control_end_ns ? control_ns : kNever;
+    const int64_t now = std::min({next_control, pump_ns, channel.next_event_ns()});
+    if (now == kNever) {
+      break;
+    }
+    if (channel.Advance(now) && pump_ns == kNever) {
+      pump_ns = now + callback_ns;
+    }
+    bool pump = now >= pump_ns;
+    if (now == next_control) {
+      controls.emplace_back(kControlSize);
+      std::memcpy(controls.back().data(), &now, sizeof(now));
+      if (mode == ControlMode::kUnframed) {
+        channel.Send(controls.back().data(), kControlSize);
+      } else {
+        const uint16_t stream = mode == ControlMode::kSameStream ? kBulkStreams[0] : kControlStream;
+        sender.Enqueue(stream, controls.back().data(), kControlSize, nullptr, now);
+        pump = true;
+      }
+      control_ns += control_interval_ns;
+    }
+    if (pump) {
+      pump_ns = kNever;
+      sender.Pump(channel.buffered_amount(), now);
+    }
+  }
+  return result;
+}
+
+double PercentileMs(std::vector<int64_t> values, double percentile) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[static_cast<size_t>(percentile * (values.size() - 1))] / 1e6;
+}
+
+void Print(const char *mode, const RunResult &result, size_t messages) {
+  const int64_t span_ns = result.last_delivery_ns - std::max<int64_t>(result.first_delivery_ns, 0);
+  printf("%-12s %5zu/%-4zu %7.1f %9.0f %9.1f %8.1f %8.1f %6llu %4llu/%llu\n", mode, result.delivered, messages,
+         span_ns > 0 ? result.bytes * 8e3 / span_ns : 0, result.peak_buffered / 1024.0,
+         PercentileMs(result.latencies_ns, 0.5), PercentileMs(result.latencies_ns, 0.99),
+         result.last_delivery_ns / 1e6, static_cast<unsigned long long>(result.stalls),
+         static_cast<unsigned long long>(result.pool_hits), static_cast<unsigned long long>(result.pool_misses));
+  if (result.corrupt) {
+    printf("  %zu messages corrupt\n", result.corrupt);
+  }
+}
+
+void PrintMux(const char *mode, const MuxResult &result) {
+  const int64_t span_ns = result.bulk_last_ns - std::max<int64_t>(result.bulk_first_ns, 0);
+  printf("%-14s %6zu %9.1f %8.1f %8.1f %9.1f", mode, result.control_latencies_ns.size(),
+         PercentileMs(result.control_latencies_ns, 0.5), PercentileMs(result.control_latencies_ns, 0.99),
+         PercentileMs(result.control_latencies_ns, 1), span_ns > 0 ? result.bulk_bytes * 8e3 / span_ns : 0);
+  if (result.share_bytes[0] > 0 && result.share_bytes[1] > 0) {
+    printf("  %.2f:%.2f\n", 1.0, static_cast<double>(result.share_bytes[1]) / result.share_bytes[0]);
+  } else {
+    printf("  -\n");
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (i + 1 == argc) {
+      fprintf(stderr,
+              "usage: datachannel_sim [--rate-mbps R] [--rtt-ms T] [--callback-ms C] [--open-ms O]\n"
+              "                       [--messages N] [--max-kb K] [--interval-ms I] [--seed S]\n"
+              "                       [--bulk-mb B] [--control-ms C]\n");
+      return 2;
+    }
+    const char *value = argv[++i];
+    if (arg == "--rate-mbps") {
+      options.rate_mbps = std::max(0.1, atof(value));
+    } else if (arg == "--rtt-ms") {
+      options.rtt_ms = std::max(0.0, atof(value));
+    } else if (arg == "--callback-ms") {
+      options.callback_ms = std::max(0.0, atof(value));
+    } else if (arg == "--open-ms") {
+      options.open_ms = std::max(0.0, atof(value));
+    } else if (arg == "--messages") {
+      options.messages = static_cast<size_t>(std::max(1, atoi(value)));
+    } else if (arg == "--max-kb") {
+      options.max_kb = static_cast<size_t>(std::max(1, atoi(value)));
+    } else if (arg == "--interval-ms") {
+      options.interval_ms = std::max(0.0, atof(value));
+    } else if (arg == "--bulk-mb") {
+      options.bulk_mb = static_cast<size_t>(std::max(1, atoi(value)));
+    } else if (arg == "--control-ms") {
+      options.control_ms = std::max(0.1, atof(value));
+    } else if (arg == "--seed") {
+      options.seed = static_cast<unsigned>(atoi(value));
+    } else {
+      fprintf(stderr, "datachannel_sim: unknown option %s\n", arg.c_str());
+      return 2;
+    }
+  }
+
+  const std::vector<Message> messages = MakeWorkload(options);
+  uint64_t total = 0;
+  for (const Message &message : messages) {
+    total += message.data.size();
+  }
+  printf("%zu messages, %.1f MiB, at %g Mbps with a %g ms round trip, open after %g ms\n", messages.size(),
+         total / 1048576.0, options.rate_mbps, options.rtt_ms, options.open_ms);
+  printf("%-12s %10s %7s %9s %9s %8s %8s %6s %9s\n", "mode", "delivered", "Mbps", "peak KiB", "p50 ms", "p99 ms",
+         "done ms", "stalls", "pool h/m");
+  Print("whole", RunWhole(messages, options), messages.size());
+  bool intact = true;
+  for (uint64_t window : {64u << 10, 256u << 10, 1u << 20, 4u << 20}) {
+    const RunResult result = RunFramed(messages, options, window);
+    char mode[32];
+    snprintf(mode, sizeof(mode), "window %lluK", static_cast<unsigned long long>(window >> 10));
+    Print(mode, result, messages.size());
+    intact = intact && result.delivered == messages.size() && result.corrupt == 0;
+  }
+
+  printf("\n2 bulk streams of %zu MiB weighted %u:%u, a %zu byte control message every %g ms\n", options.bulk_mb,
+         kBulkWeights[0], kBulkWeights[1], kControlSize, options.control_ms);
+  printf("%-14s %6s %9s %8s %8s %9s  %s\n", "mode", "ctrl", "p50 ms", "p99 ms", "max ms", "bulk Mbps", "share");
+  PrintMux("same stream 1M", RunMux(options, ControlMode::kSameStream, 1 << 20));
+  PrintMux("unframed 1M", RunMux(options, ControlMode::kUnframed, 1 << 20));
+  for (uint64_t window : {1u << 20, 256u << 10, 64u << 10}) {
+    char mode[32];
+    snprintf(mode, sizeof(mode), "priority %lluK", static_cast<unsigned long long>(window >> 10));
+    PrintMux(mode, RunMux(options, ControlMode::kPriority, window));
+  }
+  return intact ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+//
+//  main.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/14.
+//
+
+// frame_pool_bench: custom::FrameBufferPool in steady state, as the output
+// pool of the CustomPixelBufferUtils conversions uses it. Every frame acquires
+// an NV12 buffer, writes it, and keeps it in flight for a few frames, like an
+// encoder holding its input, before releasing it.
+//
+//   frame_pool_bench [--size WxH] [--frames N] [--depth D] [--warmup W]
+//
+// Prints the misses (allocations) per frame and the bytes the pool owns for
+// each second of 30 frames, then the time per frame against allocating every
+// buffer. Exits 1 if the pool still allocates after the first W frames.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+
+#include "FrameBufferPool.h"
+
+namespace {
+
+const int kFramesPerWindow = 30;
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Stands in for the conversion: one byte per row of each plane.
+void Write(uint8_t *plane, int stride, int rows, uint8_t value) {
+  for (int y = 0; y < rows; ++y) {
+    plane[static_cast<size_t>(y) * stride] = value;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int width = 1280;
+  int height = 720;
+  int frames = 300;
+  int depth = 3;
+  int warmup = kFramesPerWindow;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &width, &height) == 2 &&
+        width > 0 && height > 0) {
+      ++i;
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+      frames = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0) {
+      depth = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0) {
+      warmup = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: frame_pool_bench [--size WxH] [--frames N] [--depth D] [--warmup W]\n");
+      return 2;
+    }
+  }
+
+  custom::FrameBufferKey key;
+  key.width = width;
+  key.height = height;
+  key.format = custom::kFourccNV12VideoRange;
+  custom::FrameBufferPool pool;
+  std::deque<std::shared_ptr<custom::FrameBuffer>> in_flight;
+
+  printf("%dx%d NV12, %d frames in flight\n\n%-11s %13s %14s %7s\n", width, height, depth, "frames", "misses/frame",
+         "allocated KiB", "in use");
+  uint64_t steady_misses = 0;
+  uint64_t window_misses = 0;
+  int64_t pooled_ns = 0;
+  for (int frame = 0; frame < frames; ++frame) {
+    const uint64_t misses = pool.stats().misses;
+    const int64_t start = NowNs();
+    std::shared_ptr<custom::FrameBuffer> buffer = pool.Acquire(key);
+    if (!buffer) {
+      fprintf(stderr, "frame_pool_bench: can't allocate %dx%d\n", width, height);
+      return 1;
+    }
+    Write(buffer->Plane(0), buffer->Stride(0), height, static_cast<uint8_t>(frame));
+    Write(buffer->Plane(1), buffer->Stride(1), (height + 1) / 2, static_cast<uint8_t>(frame));
+    in_flight.push_back(std::move(buffer));
+    if (static_cast<int>(in_flight.size()) > depth) {
+      in_flight.pop_front();
+    }
+    const int64_t elapsed_ns = NowNs() - start;
+    const uint64_t frame_misses = pool.stats().misses - misses;
+    window_misses += frame_misses;
+    if (frame >= warmup) {
+      steady_misses += frame_misses;
+      pooled_ns += elapsed_ns;
+    }
+    if ((frame + 1) % kFramesPerWindow == 0 || frame + 1 == frames) {
+      const int first = frame / kFramesPerWindow * kFramesPerWindow;
+      const custom::FrameBufferPoolStats stats = pool.stats();
+      char range[32];
+      snprintf(range, sizeof(range), "%d-%d", first, frame);
+      printf("%-11s %13.3f %14zu %7zu\n", range, static_cast<double>(window_misses) / (frame + 1 - first),
+             stats.allocated_bytes >> 10, stats.in_use);
+      window_misses = 0;
+    }
+  }
+  in_flight.clear();
+
+  // The same frames without a pool: every buffer allocated and freed.
+  const custom::FrameLayout layout = custom::ComputeFrameLayout(key);
+  std::deque<std::unique_ptr<uint8_t[]>> unpooled;
+  int64_t unpooled_ns = 0;
+  for (int frame = 0; frame < frames; ++frame) {
+    const int64_t start = NowNs();
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[layout.total_size]);
+    Write(buffer.get() + layout.planes[0].offset, layout.planes[0].stride, height, static_cast<uint8_t>(frame));
+    Write(buffer.get() + layout.planes[1].offset, layout.planes[1].stride, (height + 1) / 2,
+          static_cast<uint8_t>(frame));
+    unpooled.push_back(std::move(buffer));
+    if (static_cast<int>(unpooled.size()) > depth) {
+      unpooled.pop_front();
+    }
+    if (frame >= warmup) {
+      unpooled_ns += NowNs() - start;
+    }
+  }
+
+  const custom::FrameBufferPoolStats stats = pool.stats();
+  const int steady_frames = frames > warmup ? frames - warmup : 0;
+  printf("\nafter %d frames: %.3f misses/frame, %zu buffers, %zu KiB allocated\n", warmup,
+         steady_frames ? static_cast<double>(steady_misses) / steady_frames : 0, stats.high_water,
+         stats.allocated_bytes >> 10);
+  if (steady_frames) {
+    printf("per frame: pooled %.2f us, allocated %.2f us\n", pooled_ns / 1e3 / steady_frames,
+           unpooled_ns / 1e3 / steady_frames);
+  }
+  if (steady_misses > 0) {
+    fprintf(stderr, "frame_pool_bench: %llu allocations after warm-up\n",
+            static_cast<unsigned long long>(steady_misses));
+    return 1;
+  }
+  return 0;
+}
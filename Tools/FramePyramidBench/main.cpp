@@ -0,0 +1,140 @@
+//
+//  main.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/9.
+//
+
+// frame_pyramid_bench: time per frame of custom::BuildNV12Pyramid on every
+// SIMD path this CPU supports, against building the same layers with four
+// separate box passes over the source, one per plane and layer, in C.
+//
+//   frame_pyramid_bench [--size WxH] [--seconds S]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "FramePyramid.h"
+
+namespace {
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Runs |body| repeatedly for about |seconds|; returns milliseconds per call.
+double Run(double seconds, const std::function<void()> &body) {
+  int64_t calls = 0;
+  const int64_t start = NowNs();
+  int64_t elapsed_ns = 0;
+  do {
+    body();
+    calls++;
+    elapsed_ns = NowNs() - start;
+  } while (elapsed_ns < seconds * 1e9);
+  return elapsed_ns / 1e6 / calls;
+}
+
+// One |factor| x |factor| box pass over a plane of |channels| interleaved
+// channels, edges clamped.
+void BoxPass(const uint8_t *src, int src_stride, int src_width, int src_height, int channels, int factor,
+             uint8_t *dst, int dst_stride, int dst_width, int dst_height) {
+  for (int y = 0; y < dst_height; ++y) {
+    for (int x = 0; x < dst_width; ++x) {
+      for (int c = 0; c < channels; ++c) {
+        int sum = factor * factor / 2;
+        for (int dy = 0; dy < factor; ++dy) {
+          const uint8_t *row = src + static_cast<size_t>(std::min(y * factor + dy, src_height - 1)) * src_stride;
+          for (int dx = 0; dx < factor; ++dx) {
+            sum += row[std::min(x * factor + dx, src_width - 1) * channels + c];
+          }
+        }
+        dst[static_cast<size_t>(y) * dst_stride + x * channels + c] = static_cast<uint8_t>(sum / (factor * factor));
+      }
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int width = 1280;
+  int height = 720;
+  double seconds = 1.0;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &width, &height) == 2 &&
+        width >= 4 && height >= 4) {
+      ++i;
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: frame_pyramid_bench [--size WxH] [--seconds S]\n");
+      return 2;
+    }
+  }
+
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  std::vector<uint8_t> y(static_cast<size_t>(width) * height);
+  std::vector<uint8_t> uv(static_cast<size_t>(chroma_width) * 2 * chroma_height);
+  uint32_t state = 1;
+  for (std::vector<uint8_t> *plane : {&y, &uv}) {
+    for (uint8_t &value : *plane) {
+      state = state * 1664525u + 1013904223u;
+      value = static_cast<uint8_t>(state >> 24);
+    }
+  }
+
+  printf("%dx%d nv12\n\n%-30s %8s\n", width, height, "pyramid", "ms");
+  custom::FrameBufferPool pool;
+  const custom::SimdPath kPaths[] = {custom::SimdPath::kScalar, custom::SimdPath::kSSE2, custom::SimdPath::kAVX2,
+                                     custom::SimdPath::kNEON};
+  for (custom::SimdPath path : kPaths) {
+    if (!custom::IsSimdPathSupported(path)) {
+      continue;
+    }
+    const double ms = Run(seconds, [&] {
+      custom::NV12Pyramid pyramid;
+      custom::BuildNV12Pyramid(y.data(), width, uv.data(), chroma_width * 2, width, height,
+                               custom::kFourccNV12VideoRange, &pool, &pyramid, path);
+    });
+    char name[64];
+    snprintf(name, sizeof(name), "one pass, %s", custom::SimdPathName(path));
+    printf("%-30s %8.3f\n", name, ms);
+  }
+
+  std::vector<uint8_t> layers[4];
+  int sizes[4][3];
+  for (int level = 1; level <= 2; ++level) {
+    const int layer_width = width >> level;
+    const int layer_height = height >> level;
+    const int layer_chroma_width = (layer_width + 1) / 2;
+    const int layer_chroma_height = (layer_height + 1) / 2;
+    sizes[(level - 1) * 2][0] = layer_width;
+    sizes[(level - 1) * 2][1] = layer_height;
+    sizes[(level - 1) * 2][2] = 1;
+    sizes[(level - 1) * 2 + 1][0] = layer_chroma_width;
+    sizes[(level - 1) * 2 + 1][1] = layer_chroma_height;
+    sizes[(level - 1) * 2 + 1][2] = 2;
+  }
+  for (int i = 0; i < 4; ++i) {
+    layers[i].resize(static_cast<size_t>(sizes[i][0]) * sizes[i][2] * sizes[i][1]);
+  }
+  const double separate = Run(seconds, [&] {
+    for (int i = 0; i < 4; ++i) {
+      const bool luma = sizes[i][2] == 1;
+      BoxPass(luma ? y.data() : uv.data(), luma ? width : chroma_width * 2, luma ? width : chroma_width,
+              luma ? height : chroma_height, sizes[i][2], i < 2 ? 2 : 4, layers[i].data(), sizes[i][0] * sizes[i][2],
+              sizes[i][0], sizes[i][1]);
+    }
+  });
+  printf("%-30s %8.3f\n", "four separate box passes, C", separate);
+  return 0;
+}
@@ -0,0 +1,220 @@
+//
+//  main.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+// frame_scheduler_sim: replays a synthetic capture timeline through
+// custom::FrameScheduler and custom::LatestFrameMailbox, as CustomVideoSource
+// uses them, in virtual time, and compares it with processing every frame in
+// arrival order.
+//
+//   frame_scheduler_sim [--fps F] [--processing-ms P] [--jitter-ms J]
+//                       [--budget-ms B] [--throttle T] [--seconds S] [--seed N]
+//
+// Frames arrive every 1/F seconds with up to 2 ms of capture jitter. Each takes
+// P ms to process, plus or minus J, and T times that during the middle third
+// of the run, like a thermally throttled GPU; T is 2 by default. Prints the scheduler's per second
+// counters and the latency from arrival to the end of processing. Exits 1 if
+// the counters don't add up to the frames that arrived.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "FrameScheduler.h"
+#include "LatestFrameMailbox.h"
+
+namespace {
+
+constexpr int64_t kNsPerMs = 1000000;
+
+struct Options {
+  double fps = 30;
+  double processing_ms = 25;
+  double jitter_ms = 5;
+  double budget_ms = 66;
+  double throttle = 2;
+  int seconds = 9;
+  unsigned seed = 1;
+};
+
+struct Timeline {
+  std::vector<int64_t> arrivals;
+  // Processing time of the frame that arrived at the same index.
+  std::vector<int64_t> processing;
+};
+
+Timeline MakeTimeline(const Options &options) {
+  std::mt19937 random(options.seed);
+  std::uniform_real_distribution<double> capture_jitter(-2, 2);
+  std::uniform_real_distribution<double> processing_jitter(-options.jitter_ms, options.jitter_ms);
+  Timeline timeline;
+  const int64_t interval_ns = static_cast<int64_t>(1e9 / options.fps);
+  const int64_t end_ns = options.seconds * 1000000000LL;
+  for (int64_t at = 0; at < end_ns; at += interval_ns) {
+    const bool throttled = at >= end_ns / 3 && at < end_ns * 2 / 3;
+    const double processing_ms = (throttled ? options.throttle : 1) * options.processing_ms + processing_jitter(random);
+    timeline.arrivals.push_back(std::max<int64_t>(0, at + static_cast<int64_t>(capture_jitter(random) * kNsPerMs)));
+    timeline.processing.push_back(std::max<int64_t>(kNsPerMs, static_cast<int64_t>(processing_ms * kNsPerMs)));
+  }
+  return timeline;
+}
+
+struct RunResult {
+  std::vector<int64_t> latencies;
+  custom::FrameSchedulerCounters totals;
+  std::vector<custom::FrameSchedulerCounters> seconds;
+};
+
+int64_t Percentile(std::vector<int64_t> values, int percent) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  const size_t rank = (values.size() * percent + 99) / 100;
+  return values[rank == 0 ? 0 : rank - 1];
+}
+
+// Event loop of one capture thread and one worker. The worker picks up the
+// mailbox as soon as it is idle, like processingQueue does.
+RunResult RunScheduled(const Timeline &timeline, const Options &options) {
+  custom::FrameSchedulerConfig config;
+  config.latency_budget_ns = static_cast<int64_t>(options.budget_ms * kNsPerMs);
+  custom::FrameScheduler scheduler(config);
+  custom::LatestFrameMailbox<int> mailbox;
+  RunResult result;
+
+  size_t next = 0;
+  bool busy = false;
+  int64_t busy_until = 0;
+  int64_t busy_arrival = 0;
+  // The scheduler's windows start at the first frame.
+  int64_t next_second = timeline.arrivals.empty() ? 0 : timeline.arrivals[0] + 1000000000;
+  auto take = [&](int64_t now) {
+    int frame = -1;
+    int64_t arrival = 0;
+    if (!mailbox.Take(&frame, &arrival)) {
+      return;
+    }
+    scheduler.OnProcessingStarted(now);
+    busy = true;
+    busy_arrival = arrival;
+    busy_until = now + timeline.processing[frame];
+  };
+  while (next < timeline.arrivals.size() || busy) {
+    const bool arrival_first = next < timeline.arrivals.size() && (!busy || timeline.arrivals[next] < busy_until);
+    const int64_t now = arrival_first ? timeline.arrivals[next] : busy_until;
+    if (arrival_first) {
+      if (scheduler.Admit(now) && mailbox.Put(static_cast<int>(next), now)) {
+        scheduler.OnReplaced(now);
+      }
+      next++;
+      if (!busy) {
+        take(now);
+      }
+    } else {
+      scheduler.OnProcessingFinished(busy_arrival, now);
+      result.latencies.push_back(now - busy_arrival);
+      busy = false;
+      take(now);
+    }
+    // The scheduler rolls its window over with the first call past it.
+    for (; now >= next_second; next_second += 1000000000) {
+      result.seconds.push_back(scheduler.LastSecond());
+    }
+  }
+  result.totals = scheduler.Totals();
+  return result;
+}
+
+// Every frame in arrival order, the way the capture queue backs up without the
+// scheduler.
+RunResult RunUnscheduled(const Timeline &timeline) {
+  RunResult result;
+  int64_t free_at = 0;
+  for (size_t i = 0; i < timeline.arrivals.size(); ++i) {
+    free_at = std::max(free_at, timeline.arrivals[i]) + timeline.processing[i];
+    result.latencies.push_back(free_at - timeline.arrivals[i]);
+  }
+  result.totals.admitted = timeline.arrivals.size();
+  result.totals.processed = timeline.arrivals.size();
+  return result;
+}
+
+void Print(const char *mode, const RunResult &result, const Options &options) {
+  const int64_t budget_ns = static_cast<int64_t>(options.budget_ms * kNsPerMs);
+  const size_t late = std::count_if(result.latencies.begin(), result.latencies.end(),
+                                    [budget_ns](int64_t latency) { return latency > budget_ns; });
+  printf("%-12s %9llu %8llu %9llu %6zu %8.1f %8.1f %8.1f\n", mode,
+         static_cast<unsigned long long>(result.totals.processed),
+         static_cast<unsigned long long>(result.totals.dropped),
+         static_cast<unsigned long long>(result.totals.replaced), late,
+         Percentile(result.latencies, 50) / 1e6, Percentile(result.latencies, 99) / 1e6,
+         Percentile(result.latencies, 100) / 1e6);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (i + 1 == argc) {
+      fprintf(stderr,
+              "usage: frame_scheduler_sim [--fps F] [--processing-ms P] [--jitter-ms J] [--budget-ms B]\n"
+              "                           [--throttle T] [--seconds S] [--seed N]\n");
+      return 2;
+    }
+    const char *value = argv[++i];
+    if (arg == "--fps") {
+      options.fps = std::max(1.0, atof(value));
+    } else if (arg == "--processing-ms") {
+      options.processing_ms = std::max(1.0, atof(value));
+    } else if (arg == "--jitter-ms") {
+      options.jitter_ms = std::max(0.0, atof(value));
+    } else if (arg == "--budget-ms") {
+      options.budget_ms = std::max(1.0, atof(value));
+    } else if (arg == "--throttle") {
+      options.throttle = std::max(0.1, atof(value));
+    } else if (arg == "--seconds") {
+      options.seconds = std::max(1, atoi(value));
+    } else if (arg == "--seed") {
+      options.seed = static_cast<unsigned>(atoi(value));
+    } else {
+      fprintf(stderr, "frame_scheduler_sim: unknown option %s\n", arg.c_str());
+      return 2;
+    }
+  }
+
+  const Timeline timeline = MakeTimeline(options);
+  printf("%zu frames at %g fps, %g +- %g ms processing (x%g for the middle third), %g ms budget\n",
+         timeline.arrivals.size(), options.fps, options.processing_ms, options.jitter_ms, options.throttle,
+         options.budget_ms);
+  const RunResult scheduled = RunScheduled(timeline, options);
+
+  printf("%-8s %9s %8s %9s %6s %9s\n", "second", "admitted", "dropped", "replaced", "late", "processed");
+  for (size_t i = 0; i < scheduled.seconds.size(); ++i) {
+    const custom::FrameSchedulerCounters &second = scheduled.seconds[i];
+    printf("%-8zu %9llu %8llu %9llu %6llu %9llu\n", i, static_cast<unsigned long long>(second.admitted),
+           static_cast<unsigned long long>(second.dropped), static_cast<unsigned long long>(second.replaced),
+           static_cast<unsigned long long>(second.late), static_cast<unsigned long long>(second.processed));
+  }
+
+  printf("\n%-12s %9s %8s %9s %6s %8s %8s %8s\n", "mode", "processed", "dropped", "replaced", "late", "p50 ms",
+         "p99 ms", "max ms");
+  Print("scheduled", scheduled, options);
+  Print("every frame", RunUnscheduled(timeline), options);
+
+  const custom::FrameSchedulerCounters &totals = scheduled.totals;
+  const bool consistent = totals.admitted + totals.dropped == timeline.arrivals.size() &&
+                          totals.processed + totals.replaced == totals.admitted;
+  if (!consistent) {
+    fprintf(stderr, "frame_scheduler_sim: counters don't add up\n");
+  }
+  return consistent ? 0 : 1;
+}
@@ -0,0 +1,518 @@
+//
+//  main.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+// frametool: runs the CPU video path of the app offline on Linux or macOS.
+//
+//   frametool -i in.y4m [-o out.y4m] [--filter identity|grayscale]
+//             [--brightness B --contrast C] [--flip] [--denoise K]
+//             [--threshold T] [--rotate 0|90|180|270]
+//             [--simd auto|scalar|sse2|avx2|neon] [--frames N] [--direct]
+//             [--quality psnr|ssim [--reference ref.y4m] [--every N]]
+//   frametool -i in.yuv -s 1280x720 -f nv12 ...
+//   frametool -h|--help
+//
+// Frames go through read, filter, flip, denoise, rotate and write, the stages
+// that are enabled, and the time each stage takes is printed per frame
+// percentiles at the end. Input is memory mapped and filtered straight from
+// the mapping, so "read" only covers locating the frame and the page faults
+// land in the first stage that touches it. Output is written as Y4M or raw by
+// the extension of -o, in large buffered writes that bypass the page cache
+// with --direct; without -o nothing is written.
+//
+// --quality measures every Nth output frame against the matching frame of
+// --reference, or of the input if there is none, and prints per plane PSNR,
+// and SSIM with "ssim", at the end. A raw reference has the size and format of
+// the output.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ColorConvert.h"
+#include "FrameBufferPool.h"
+#include "FrameHistory.h"
+#include "QualityMetrics.h"
+#include "RotateConvert.h"
+#include "StageTrace.h"
+#include "TemporalDenoise.h"
+#include "YuvFile.h"
+#include "YuvFilter.h"
+
+namespace {
+
+struct Options {
+  std::string input;
+  std::string output;
+  custom::YuvFileInfo raw_info;
+  std::string filter = "identity";
+  bool brightness_contrast = false;
+  float brightness = 0;
+  float contrast = 1;
+  bool flip = false;
+  bool direct_io = false;
+  int denoise_frames = 0;
+  int threshold = 10;
+  custom::Rotation rotation = custom::Rotation::k0;
+  custom::SimdPath simd = custom::SimdPath::kAuto;
+  long max_frames = -1;
+  bool quality = false;
+  bool ssim = false;
+  std::string reference;
+  long quality_interval = 1;
+  bool help = false;
+};
+
+struct StageTimes {
+  const char *name;
+  std::vector<int64_t> ns;
+};
+
+// Mean and minimum of the measured frames' scores.
+struct QualityStats {
+  static constexpr int kScores = 4;
+  static constexpr const char *kNames[kScores] = {"Y", "U", "V", "all"};
+
+  size_t frames = 0;
+  double psnr_sum[kScores] = {};
+  double psnr_min[kScores] = {};
+  double ssim_sum[kScores] = {};
+  double ssim_min[kScores] = {};
+
+  void Add(const custom::FrameQuality &quality) {
+    for (int i = 0; i < kScores; ++i) {
+      const double psnr = i < 3 ? quality.planes[i].psnr : quality.psnr;
+      const double ssim = i < 3 ? quality.planes[i].ssim : quality.ssim;
+      psnr_sum[i] += psnr;
+      ssim_sum[i] += ssim;
+      psnr_min[i] = frames == 0 ? psnr : std::min(psnr_min[i], psnr);
+      ssim_min[i] = frames == 0 ? ssim : std::min(ssim_min[i], ssim);
+    }
+    ++frames;
+  }
+};
+
+void PrintUsage(FILE *out) {
+  fprintf(out,
+          "usage: frametool -i <in.y4m|in.yuv> [-s WxH -f i420|nv12|nv12f] [-o <out.y4m|out.yuv|->]\n"
+          "                 [--filter identity|grayscale] [--brightness B --contrast C] [--flip]\n"
+          "                 [--denoise K] [--threshold T] [--rotate 0|90|180|270]\n"
+          "                 [--simd auto|scalar|sse2|avx2|neon] [--frames N] [--direct]\n"
+          "                 [--quality psnr|ssim [--reference <ref.y4m|ref.yuv>] [--every N]]\n");
+}
+
+bool ParseFormat(const char *value, uint32_t *format) {
+  if (strcmp(value, "i420") == 0) {
+    *format = custom::kFourccI420;
+  } else if (strcmp(value, "nv12") == 0) {
+    *format = custom::kFourccNV12VideoRange;
+  } else if (strcmp(value, "nv12f") == 0) {
+    *format = custom::kFourccNV12FullRange;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool ParseSimdPath(const char *value, custom::SimdPath *path) {
+  static const struct {
+    const char *name;
+    custom::SimdPath path;
+  } kPaths[] = {
+      {"auto", custom::SimdPath::kAuto}, {"scalar", custom::SimdPath::kScalar}, {"sse2", custom::SimdPath::kSSE2},
+      {"avx2", custom::SimdPath::kAVX2}, {"neon", custom::SimdPath::kNEON},
+  };
+  for (const auto &entry : kPaths) {
+    if (strcmp(value, entry.name) == 0) {
+      *path = entry.path;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Options followed by a value.
+bool TakesValue(const std::string &arg) {
+  static const char *const kValueOptions[] = {
+      "-i",       "-o",     "-s",       "-f",        "--filter",    "--brightness", "--contrast", "--denoise",
+      "--threshold", "--rotate", "--simd", "--frames", "--quality", "--reference",  "--every",
+  };
+  for (const char *option : kValueOptions) {
+    if (arg == option) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ParseOptions(int argc, char **argv, Options *options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help") {
+      options->help = true;
+      return true;
+    }
+    if (arg == "--flip") {
+      options->flip = true;
+      continue;
+    }
+    if (arg == "--direct") {
+      options->direct_io = true;
+      continue;
+    }
+    if (!TakesValue(arg)) {
+      fprintf(stderr, "frametool: unknown option %s\n", arg.c_str());
+      return false;
+    }
+    if (i + 1 == argc) {
+      fprintf(stderr, "frametool: %s needs a value\n", arg.c_str());
+      return false;
+    }
+    const char *value = argv[++i];
+    bool valid = true;
+    if (arg == "-i") {
+      options->input = value;
+    } else if (arg == "-o") {
+      options->output = value;
+    } else if (arg == "-s") {
+      valid = sscanf(value, "%dx%d", &options->raw_info.width, &options->raw_info.height) == 2;
+    } else if (arg == "-f") {
+      valid = ParseFormat(value, &options->raw_info.format);
+    } else if (arg == "--filter") {
+      options->filter = value;
+      valid = options->filter == "identity" || options->filter == "grayscale";
+    } else if (arg == "--brightness") {
+      options->brightness_contrast = true;
+      options->brightness = static_cast<float>(atof(value));
+    } else if (arg == "--contrast") {
+      options->brightness_contrast = true;
+      options->contrast = static_cast<float>(atof(value));
+    } else if (arg == "--denoise") {
+      options->denoise_frames = atoi(value);
+      valid = options->denoise_frames >= 0 && options->denoise_frames <= custom::kMaxTemporalDenoiseFrames;
+    } else if (arg == "--threshold") {
+      options->threshold = atoi(value);
+      valid = options->threshold >= 0 && options->threshold <= 255;
+    } else if (arg == "--rotate") {
+      const int degrees = atoi(value);
+      valid = degrees == 0 || degrees == 90 || degrees == 180 || degrees == 270;
+      options->rotation = static_cast<custom::Rotation>(degrees);
+    } else if (arg == "--simd") {
+      valid = ParseSimdPath(value, &options->simd) && custom::IsSimdPathSupported(options->simd);
+    } else if (arg == "--frames") {
+      options->max_frames = atol(value);
+    } else if (arg == "--quality") {
+      options->quality = true;
+      options->ssim = strcmp(value, "ssim") == 0;
+      valid = options->ssim || strcmp(value, "psnr") == 0;
+    } else if (arg == "--reference") {
+      options->reference = value;
+    } else if (arg == "--every") {
+      options->quality_interval = atol(value);
+      valid = options->quality_interval > 0;
+    } else {
+      fprintf(stderr, "frametool: unknown option %s\n", arg.c_str());
+      return false;
+    }
+    if (!valid) {
+      fprintf(stderr, "frametool: bad value %s for %s\n", value, arg.c_str());
+      return false;
+    }
+  }
+  if (options->input.empty()) {
+    fprintf(stderr, "frametool: no input\n");
+    return false;
+  }
+  // The input only lines up with the output if neither is turned.
+  if (options->quality && options->reference.empty() && (options->flip || options->rotation != custom::Rotation::k0)) {
+    fprintf(stderr, "frametool: --quality with --flip or --rotate needs a --reference\n");
+    return false;
+  }
+  return true;
+}
+
+custom::Yuv420Image ImageOfBuffer(const custom::FrameBuffer &buffer) {
+  custom::Yuv420Image image;
+  image.format = buffer.key.format;
+  image.width = buffer.key.width;
+  image.height = buffer.key.height;
+  for (int i = 0; i < buffer.layout.plane_count; ++i) {
+    image.planes[i] = buffer.Plane(i);
+    image.strides[i] = buffer.Stride(i);
+  }
+  return image;
+}
+
+custom::ColorImage ColorImageOfBuffer(const custom::FrameBuffer &buffer, custom::PixelLayout layout) {
+  custom::ColorImage image;
+  image.layout = layout;
+  image.width = buffer.key.width;
+  image.height = buffer.key.height;
+  for (int i = 0; i < buffer.layout.plane_count; ++i) {
+    image.planes[i] = buffer.Plane(i);
+    image.strides[i] = buffer.Stride(i);
+  }
+  return image;
+}
+
+// Nearest rank percentile of sorted |values|.
+int64_t Percentile(const std::vector<int64_t> &values, int percent) {
+  const size_t rank = (values.size() * percent + 99) / 100;
+  return values[rank == 0 ? 0 : rank - 1];
+}
+
+void PrintQuality(const QualityStats &stats, bool with_ssim) {
+  if (stats.frames == 0) {
+    return;
+  }
+  fprintf(stderr, "%-8s %8s %9s %9s", "plane", "frames", "PSNR dB", "min dB");
+  fprintf(stderr, with_ssim ? " %9s %9s\n" : "\n", "SSIM", "min SSIM");
+  for (int i = 0; i < QualityStats::kScores; ++i) {
+    fprintf(stderr, "%-8s %8zu %9.3f %9.3f", QualityStats::kNames[i], stats.frames, stats.psnr_sum[i] / stats.frames,
+            stats.psnr_min[i]);
+    if (with_ssim) {
+      fprintf(stderr, " %9.5f %9.5f", stats.ssim_sum[i] / stats.frames, stats.ssim_min[i]);
+    }
+    fprintf(stderr, "\n");
+  }
+}
+
+void PrintTimes(const std::vector<StageTimes> &stages, size_t frames, int64_t elapsed_ns) {
+  fprintf(stderr, "%-8s %8s %9s %9s %9s %9s %9s\n", "stage", "frames", "mean ms", "p50 ms", "p90 ms", "p99 ms",
+          "max ms");
+  for (const StageTimes &stage : stages) {
+    if (stage.ns.empty()) {
+      continue;
+    }
+    std::vector<int64_t> sorted = stage.ns;
+    std::sort(sorted.begin(), sorted.end());
+    int64_t sum = 0;
+    for (int64_t ns : sorted) {
+      sum += ns;
+    }
+    fprintf(stderr, "%-8s %8zu %9.3f %9.3f %9.3f %9.3f %9.3f\n", stage.name, sorted.size(),
+            sum / 1e6 / sorted.size(), Percentile(sorted, 50) / 1e6, Percentile(sorted, 90) / 1e6,
+            Percentile(sorted, 99) / 1e6, sorted.back() / 1e6);
+  }
+  if (frames > 0 && elapsed_ns > 0) {
+    fprintf(stderr, "%zu frames in %.3f s, %.1f fps\n", frames, elapsed_ns / 1e9, frames * 1e9 / elapsed_ns);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options)) {
+    PrintUsage(stderr);
+    return 2;
+  }
+  if (options.help) {
+    PrintUsage(stdout);
+    return 0;
+  }
+
+  std::string error;
+  custom::YuvFileReader reader;
+  if (!reader.Open(options.input, options.raw_info, &error)) {
+    fprintf(stderr, "frametool: %s\n", error.c_str());
+    return 1;
+  }
+  const custom::YuvFileInfo &input_info = reader.info();
+
+  custom::YuvFilter filter =
+      options.filter == "grayscale" ? custom::YuvFilter::Grayscale() : custom::YuvFilter::Identity();
+  if (options.brightness_contrast &&
+      !custom::ComposeYuvFilters(filter, custom::YuvFilter::BrightnessContrast(options.brightness, options.contrast),
+                                 &filter)) {
+    fprintf(stderr, "frametool: can't compose the filters\n");
+    return 1;
+  }
+
+  // Same output format as CustomCPUFilter: full range stays full range.
+  custom::FrameBufferKey input_key;
+  input_key.width = input_info.width;
+  input_key.height = input_info.height;
+  input_key.format = input_info.format;
+  custom::FrameBufferKey filtered_key = input_key;
+  filtered_key.format = input_info.format == custom::kFourccNV12FullRange ? custom::kFourccNV12FullRange
+                                                                          : custom::kFourccNV12VideoRange;
+  const bool rotates = options.rotation != custom::Rotation::k0;
+  const bool transposes = options.rotation == custom::Rotation::k90 || options.rotation == custom::Rotation::k270;
+  custom::FrameBufferKey bgra_key = input_key;
+  bgra_key.format = custom::kFourccBGRA;
+  // BGRAToNV12Rotated writes BT.601 video range.
+  custom::FrameBufferKey rotated_key;
+  rotated_key.width = transposes ? input_info.height : input_info.width;
+  rotated_key.height = transposes ? input_info.width : input_info.height;
+  rotated_key.format = custom::kFourccNV12VideoRange;
+  const custom::ColorConversion to_bgra = custom::ColorConversion::Select(
+      custom::YuvMatrix::kBT601,
+      filtered_key.format == custom::kFourccNV12FullRange ? custom::YuvRange::kFull : custom::YuvRange::kVideo,
+      custom::PixelLayout::kNV12, custom::PixelLayout::kBGRA, options.simd);
+  if (rotates && !to_bgra.valid()) {
+    fprintf(stderr, "frametool: no BGRA conversion for --simd %s\n", custom::SimdPathName(options.simd));
+    return 1;
+  }
+
+  custom::YuvFileInfo output_info = input_info;
+  output_info.width = rotates ? rotated_key.width : filtered_key.width;
+  output_info.height = rotates ? rotated_key.height : filtered_key.height;
+  output_info.format = rotates ? rotated_key.format : filtered_key.format;
+
+  custom::YuvFileReader reference_reader;
+  if (!options.reference.empty() && !reference_reader.Open(options.reference, output_info, &error)) {
+    fprintf(stderr, "frametool: %s\n", error.c_str());
+    return 1;
+  }
+  custom::QualityMeter meter(options.simd);
+  QualityStats quality_stats;
+
+  custom::YuvFileWriter writer;
+  if (!options.output.empty()) {
+    custom::YuvFileWriterConfig config;
+    config.direct_io = options.direct_io;
+    if (!writer.Open(options.output, output_info, config, &error)) {
+      fprintf(stderr, "frametool: %s\n", error.c_str());
+      return 1;
+    }
+  }
+
+  fprintf(stderr, "frametool: %lld frames of %dx%d '%c%c%c%c', simd %s\n",
+          static_cast<long long>(reader.frame_count()), input_info.width, input_info.height,
+          static_cast<char>(input_info.format >> 24), static_cast<char>(input_info.format >> 16),
+          static_cast<char>(input_info.format >> 8), static_cast<char>(input_info.format),
+          custom::SimdPathName(custom::ResolveSimdPath(options.simd)));
+
+  enum { kRead, kFilter, kFlip, kDenoise, kRotate, kQuality, kWrite, kTotal };
+  std::vector<StageTimes> stages = {{"read", {}},   {"filter", {}},  {"flip", {}},  {"denoise", {}},
+                                    {"rotate", {}}, {"quality", {}}, {"write", {}}, {"total", {}}};
+  custom::FrameBufferPool pool;
+  // Previous outputs of the denoise, which makes it recursive as in
+  // CustomTemporalDenoiser.
+  custom::FrameHistory<custom::FrameBuffer> history(options.denoise_frames);
+  const int64_t frame_interval_ns = 1000000000LL * input_info.fps_den / input_info.fps_num;
+  size_t frames = 0;
+  bool failed = false;
+  const int64_t start_ns = custom::TraceNowNs();
+  while (options.max_frames < 0 || static_cast<long>(frames) < options.max_frames) {
+    int64_t begin_ns = custom::TraceNowNs();
+    const int64_t frame_begin_ns = begin_ns;
+    auto measure = [&](int stage) {
+      const int64_t end_ns = custom::TraceNowNs();
+      stages[stage].ns.push_back(end_ns - begin_ns);
+      begin_ns = end_ns;
+    };
+
+    custom::YuvFrameView input;
+    if (!reader.Next(&input)) {
+      break;
+    }
+    measure(kRead);
+
+    std::shared_ptr<custom::FrameBuffer> frame = pool.Acquire(filtered_key);
+    custom::Yuv420Image image = frame ? ImageOfBuffer(*frame) : custom::Yuv420Image();
+    if (!custom::ApplyYuvFilter(filter, input.image, image, options.simd)) {
+      fprintf(stderr, "frametool: filter failed at frame %zu\n", frames);
+      failed = true;
+      break;
+    }
+    measure(kFilter);
+
+    if (options.flip) {
+      custom::FlipYuv420Vertically(image);
+      measure(kFlip);
+    }
+
+    if (options.denoise_frames > 0) {
+      custom::Yuv420Image previous[custom::kMaxTemporalDenoiseFrames];
+      int count = 0;
+      while (count < options.denoise_frames) {
+        std::shared_ptr<custom::FrameBuffer> buffer = history.At(count);
+        if (!buffer) {
+          break;
+        }
+        previous[count++] = ImageOfBuffer(*buffer);
+      }
+      if (!custom::ApplyTemporalDenoise(image, previous, count, static_cast<uint8_t>(options.threshold), image,
+                                        options.simd)) {
+        fprintf(stderr, "frametool: denoise failed at frame %zu\n", frames);
+        failed = true;
+        break;
+      }
+      history.Push(static_cast<int64_t>(frames) * frame_interval_ns, frame);
+      measure(kDenoise);
+    }
+
+    if (rotates) {
+      std::shared_ptr<custom::FrameBuffer> bgra = pool.Acquire(bgra_key);
+      std::shared_ptr<custom::FrameBuffer> rotated = pool.Acquire(rotated_key);
+      custom::ColorImage source;
+      source.layout = custom::PixelLayout::kNV12;
+      source.width = image.width;
+      source.height = image.height;
+      for (int i = 0; i < 2; ++i) {
+        source.planes[i] = image.planes[i];
+        source.strides[i] = image.strides[i];
+      }
+      if (!bgra || !rotated || !to_bgra.Convert(source, ColorImageOfBuffer(*bgra, custom::PixelLayout::kBGRA)) ||
+          !custom::BGRAToNV12Rotated(bgra->Plane(0), bgra->Stride(0), bgra_key.width, bgra_key.height,
+                                     rotated->Plane(0), rotated->Stride(0), rotated->Plane(1), rotated->Stride(1),
+                                     options.rotation, options.simd)) {
+        fprintf(stderr, "frametool: rotation failed at frame %zu\n", frames);
+        failed = true;
+        break;
+      }
+      frame = rotated;
+      image = ImageOfBuffer(*frame);
+      measure(kRotate);
+    }
+
+    if (options.quality && static_cast<long>(frames) % options.quality_interval == 0) {
+      custom::YuvFrameView reference;
+      if (!options.reference.empty() && !reference_reader.Frame(static_cast<int64_t>(frames), &reference)) {
+        fprintf(stderr, "frametool: %s has no frame %zu\n", options.reference.c_str(), frames);
+        failed = true;
+        break;
+      }
+      custom::FrameQuality quality;
+      if (!meter.Measure(options.reference.empty() ? input.image : reference.image, image, options.ssim, &quality)) {
+        fprintf(stderr, "frametool: can't compare frame %zu with its reference\n", frames);
+        failed = true;
+        break;
+      }
+      quality_stats.Add(quality);
+      measure(kQuality);
+    }
+
+    if (!options.output.empty()) {
+      if (!writer.WriteFrame(image)) {
+        fprintf(stderr, "frametool: write failed at frame %zu\n", frames);
+        failed = true;
+        break;
+      }
+      measure(kWrite);
+    }
+    stages[kTotal].ns.push_back(begin_ns - frame_begin_ns);
+    ++frames;
+  }
+  const int64_t elapsed_ns = custom::TraceNowNs() - start_ns;
+
+  const bool direct_io = writer.direct_io();
+  if (!writer.Close()) {
+    fprintf(stderr, "frametool: can't finish %s\n", options.output.c_str());
+    failed = true;
+  } else if (!options.output.empty()) {
+    fprintf(stderr, "frametool: wrote %.1f MB%s\n", writer.bytes_written() / 1e6, direct_io ? ", uncached" : "");
+  }
+  PrintTimes(stages, frames, elapsed_ns);
+  PrintQuality(quality_stats, options.ssim);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,120 @@
+//
+//  main.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/9.
+//
+
+// quality_bench: time per frame of custom::QualityMeter, PSNR alone and PSNR
+// with SSIM, for I420 and NV12 frames on every SIMD path this CPU supports.
+//
+//   quality_bench [--size WxH] [--seconds S]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "QualityMetrics.h"
+
+namespace {
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Runs |body| repeatedly for about |seconds|; returns milliseconds per call.
+double Run(double seconds, const std::function<void()> &body) {
+  int64_t calls = 0;
+  const int64_t start = NowNs();
+  int64_t elapsed_ns = 0;
+  do {
+    body();
+    calls++;
+    elapsed_ns = NowNs() - start;
+  } while (elapsed_ns < seconds * 1e9);
+  return elapsed_ns / 1e6 / calls;
+}
+
+// Packed |format| image in |data|, which is sized for it.
+custom::Yuv420Image MakeImage(uint32_t format, int width, int height, std::vector<uint8_t> *data) {
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  const size_t y_size = static_cast<size_t>(width) * height;
+  const size_t chroma_size = static_cast<size_t>(chroma_width) * chroma_height;
+  data->resize(y_size + 2 * chroma_size);
+  custom::Yuv420Image image;
+  image.format = format;
+  image.width = width;
+  image.height = height;
+  image.planes[0] = data->data();
+  image.strides[0] = width;
+  image.planes[1] = data->data() + y_size;
+  if (format == custom::kFourccI420) {
+    image.strides[1] = chroma_width;
+    image.planes[2] = image.planes[1] + chroma_size;
+    image.strides[2] = chroma_width;
+  } else {
+    image.strides[1] = 2 * chroma_width;
+  }
+  return image;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int width = 1920;
+  int height = 1080;
+  double seconds = 1.0;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &width, &height) == 2 &&
+        width >= custom::kMinQualityFrameSize && height >= custom::kMinQualityFrameSize) {
+      ++i;
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: quality_bench [--size WxH] [--seconds S]\n");
+      return 2;
+    }
+  }
+
+  std::vector<uint8_t> reference_data;
+  std::vector<uint8_t> distorted_data;
+  const custom::SimdPath kPaths[] = {custom::SimdPath::kScalar, custom::SimdPath::kSSE2, custom::SimdPath::kAVX2,
+                                     custom::SimdPath::kNEON};
+  printf("%dx%d\n\n%-16s", width, height, "ms");
+  for (custom::SimdPath path : kPaths) {
+    if (custom::IsSimdPathSupported(path)) {
+      printf(" %9s", custom::SimdPathName(path));
+    }
+  }
+  printf("\n");
+  for (uint32_t format : {custom::kFourccI420, custom::kFourccNV12VideoRange}) {
+    const custom::Yuv420Image reference = MakeImage(format, width, height, &reference_data);
+    const custom::Yuv420Image distorted = MakeImage(format, width, height, &distorted_data);
+    uint32_t state = 1;
+    for (size_t i = 0; i < reference_data.size(); ++i) {
+      state = state * 1664525u + 1013904223u;
+      reference_data[i] = static_cast<uint8_t>(state >> 24);
+      distorted_data[i] = static_cast<uint8_t>(reference_data[i] + (state >> 8) % 9 - 4);
+    }
+    for (bool with_ssim : {false, true}) {
+      printf("%-4s %-11s", format == custom::kFourccI420 ? "I420" : "NV12", with_ssim ? "PSNR+SSIM" : "PSNR");
+      for (custom::SimdPath path : kPaths) {
+        if (!custom::IsSimdPathSupported(path)) {
+          continue;
+        }
+        custom::QualityMeter meter(path);
+        custom::FrameQuality quality;
+        const double ms = Run(seconds, [&] { meter.Measure(reference, distorted, with_ssim, &quality); });
+        printf(" %9.3f", ms);
+      }
+      printf("\n");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,351 @@
+//
+//  main.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/12.
+//
+
+// sdp_bench: custom::SessionDescription and custom::OfferTemplateCache on
+// offers of 3 m= sections, as this app makes, up to the 64 of a large
+// conference, against munging with std::string the usual way.
+//
+//   sdp_bench [--seconds S]
+//
+// The munge puts H264 first and sets b=AS on every video section. Each
+// workload has several offers that only differ in the values a new peer
+// connection changes, so the template cache is measured on offers it hasn't
+// seen, like a reconnect's. Every path is checked to produce the same SDP.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <strings.h>
+#include <vector>
+
+#include "OfferTemplateCache.h"
+#include "SessionDescription.h"
+
+namespace {
+
+constexpr int kVideoKbps = 2000;
+
+// An offer like libwebrtc's with |media_sections| m= sections: audio and
+// video transceivers and a data channel last. |seed| picks the values that
+// change with every peer connection.
+std::string MakeOfferSdp(int media_sections, unsigned seed) {
+  std::mt19937 rng(seed);
+  auto token = [&](size_t size) {
+    static const char kAlphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789+/";
+    std::string value;
+    for (size_t i = 0; i < size; ++i) {
+      value += kAlphabet[rng() % 64];
+    }
+    return value;
+  };
+  const std::string ufrag = token(4);
+  const std::string pwd = token(24);
+  std::string fingerprint = "sha-256 ";
+  for (int i = 0; i < 32; ++i) {
+    char byte[4];
+    snprintf(byte, sizeof(byte), i ? ":%02X" : "%02X", static_cast<unsigned>(rng() & 0xFF));
+    fingerprint += byte;
+  }
+  const std::string stream = token(36);
+
+  std::string sdp = "v=0\r\no=- " + std::to_string(rng()) + std::to_string(rng()) + " 2 IN IP4 127.0.0.1\r\n";
+  sdp += "s=-\r\nt=0 0\r\n";
+  sdp += "a=group:BUNDLE";
+  for (int m = 0; m < media_sections; ++m) {
+    sdp += " " + std::to_string(m);
+  }
+  sdp += "\r\na=extmap-allow-mixed\r\na=msid-semantic: WMS " + stream + "\r\n";
+  for (int m = 0; m < media_sections; ++m) {
+    const bool data = m == media_sections - 1;
+    const bool audio = !data && m % 4 == 0;
+    if (data) {
+      sdp += "m=application 9 UDP/DTLS/SCTP webrtc-datachannel\r\n";
+    } else if (audio) {
+      sdp += "m=audio 9 UDP/TLS/RTP/SAVPF 111 63 103 104 9 0 8 106 105 13 110 112 113 126\r\n";
+    } else {
+      sdp += "m=video 9 UDP/TLS/RTP/SAVPF 96 97 98 99 100 101 102 103 127 120 125 107 108 109 124 119 123 118 114 "
+             "115 116\r\n";
+    }
+    sdp += "c=IN IP4 0.0.0.0\r\n";
+    if (!data) {
+      sdp += "a=rtcp:9 IN IP4 0.0.0.0\r\n";
+    }
+    sdp += "a=ice-ufrag:" + ufrag + "\r\na=ice-pwd:" + pwd + "\r\na=ice-options:trickle renomination\r\n";
+    sdp += "a=fingerprint:" + fingerprint + "\r\na=setup:actpass\r\na=mid:" + std::to_string(m) + "\r\n";
+    if (data) {
+      sdp += "a=sctp-port:5000\r\na=max-message-size:262144\r\n";
+      continue;
+    }
+    sdp +=
+        "a=extmap:1 urn:ietf:params:rtp-hdrext:ssrc-audio-level\r\n"
+        "a=extmap:2 http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time\r\n"
+        "a=extmap:3 http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01\r\n"
+        "a=extmap:4 urn:ietf:params:rtp-hdrext:sdes:mid\r\n";
+    const std::string track = token(36);
+    sdp += "a=sendrecv\r\na=msid:" + stream + " " + track + "\r\na=rtcp-mux\r\n";
+    const std::string ssrc = std::to_string(rng());
+    if (audio) {
+      sdp +=
+          "a=rtpmap:111 opus/48000/2\r\n"
+          "a=rtcp-fb:111 transport-cc\r\n"
+          "a=fmtp:111 minptime=10;useinbandfec=1\r\n"
+          "a=rtpmap:63 red/48000/2\r\n"
+          "a=fmtp:63 111/111\r\n"
+          "a=rtpmap:103 ISAC/16000\r\n"
+          "a=rtpmap:104 ISAC/32000\r\n"
+          "a=rtpmap:9 G722/8000\r\n"
+          "a=rtpmap:0 PCMU/8000\r\n"
+          "a=rtpmap:8 PCMA/8000\r\n"
+          "a=rtpmap:106 CN/32000\r\n"
+          "a=rtpmap:105 CN/16000\r\n"
+          "a=rtpmap:13 CN/8000\r\n"
+          "a=rtpmap:110 telephone-event/48000\r\n"
+          "a=rtpmap:112 telephone-event/32000\r\n"
+          "a=rtpmap:113 telephone-event/16000\r\n"
+          "a=rtpmap:126 telephone-event/8000\r\n";
+    } else {
+      sdp += "a=rtcp-rsize\r\n";
+      const int kPayloads[] = {96, 98, 100, 102, 127, 125, 108, 124, 123, 114, 116};
+      const int kRtxPayloads[] = {97, 99, 101, 103, 120, 107, 109, 119, 118, 115};
+      const char *kCodecs[] = {"VP8", "VP9", "VP9", "H264", "H264", "H264", "H264", "H264", "H264", "red", "ulpfec"};
+      const char *kFmtps[] = {
+          nullptr,
+          "profile-id=0",
+          "profile-id=2",
+          "level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42001f",
+          "level-asymmetry-allowed=1;packetization-mode=0;profile-level-id=42001f",
+          "level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f",
+          "level-asymmetry-allowed=1;packetization-mode=0;profile-level-id=42e01f",
+          "level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=4d001f",
+          "level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=64001f",
+          nullptr,
+          nullptr,
+      };
+      for (size_t i = 0; i < sizeof(kPayloads) / sizeof(kPayloads[0]); ++i) {
+        const std::string pt = std::to_string(kPayloads[i]);
+        sdp += "a=rtpmap:" + pt + " " + kCodecs[i] + "/90000\r\n";
+        if (i < 9) {
+          sdp += "a=rtcp-fb:" + pt + " goog-remb\r\na=rtcp-fb:" + pt + " transport-cc\r\na=rtcp-fb:" + pt +
+                 " ccm fir\r\na=rtcp-fb:" + pt + " nack\r\na=rtcp-fb:" + pt + " nack pli\r\n";
+        }
+        if (kFmtps[i]) {
+          sdp += "a=fmtp:" + pt + " " + kFmtps[i] + "\r\n";
+        }
+        if (i < 10) {
+          const std::string rtx = std::to_string(kRtxPayloads[i]);
+          sdp += "a=rtpmap:" + rtx + " rtx/90000\r\na=fmtp:" + rtx + " apt=" + pt + "\r\n";
+        }
+      }
+      sdp += "a=ssrc-group:FID " + ssrc + " " + std::to_string(rng()) + "\r\n";
+    }
+    const std::string cname = token(16);
+    sdp += "a=ssrc:" + ssrc + " cname:" + cname + "\r\n";
+    sdp += "a=ssrc:" + ssrc + " msid:" + stream + " " + track + "\r\n";
+  }
+  return sdp;
+}
+
+// Munges with custom::SessionDescription.
+void Munge(custom::SessionDescription &description, const std::string &sdp, std::string *munged) {
+  description.Parse(sdp);
+  for (size_t i = 0; i < description.media_count(); ++i) {
+    if (description.media(i).media == "video") {
+      description.PreferCodec(i, "H264");
+      description.SetBandwidth(i, kVideoKbps);
+    }
+  }
+  munged->clear();
+  description.AppendTo(munged);
+}
+
+// The same munge the way it is usually written: the SDP split into
+// std::strings, attributes found with find() and the m= line rebuilt.
+std::string MungeWithStrings(const std::string &sdp) {
+  std::vector<std::string> lines;
+  std::istringstream in(sdp);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (!line.empty()) {
+      lines.push_back(line);
+    }
+  }
+  for (size_t i = 0; i < lines.size(); ++i) {
+    if (lines[i].compare(0, 8, "m=video ") != 0) {
+      continue;
+    }
+    size_t end = i + 1;
+    while (end < lines.size() && lines[end].compare(0, 2, "m=") != 0) {
+      ++end;
+    }
+    std::vector<std::string> preferred;
+    for (size_t j = i + 1; j < end; ++j) {
+      if (lines[j].compare(0, 9, "a=rtpmap:") == 0) {
+        const size_t space = lines[j].find(' ');
+        const std::string name = lines[j].substr(space + 1, lines[j].find('/') - space - 1);
+        if (strcasecmp(name.c_str(), "H264") == 0) {
+          preferred.push_back(lines[j].substr(9, space - 9));
+        }
+      }
+    }
+    const size_t primary_count = preferred.size();
+    for (size_t j = i + 1; j < end; ++j) {
+      const size_t apt = lines[j].find("apt=");
+      if (lines[j].compare(0, 7, "a=fmtp:") == 0 && apt != std::string::npos) {
+        const std::string associated = lines[j].substr(apt + 4);
+        for (size_t k = 0; k < primary_count; ++k) {
+          if (preferred[k] == associated) {
+            preferred.push_back(lines[j].substr(7, lines[j].find(' ') - 7));
+          }
+        }
+      }
+    }
+    std::istringstream m_line(lines[i].substr(2));
+    std::vector<std::string> tokens;
+    std::string token;
+    while (m_line >> token) {
+      tokens.push_back(token);
+    }
+    std::string rebuilt = "m=" + tokens[0] + " " + tokens[1] + " " + tokens[2];
+    for (const std::string &pt : preferred) {
+      rebuilt += " " + pt;
+    }
+    for (size_t k = 3; k < tokens.size(); ++k) {
+      bool moved = false;
+      for (const std::string &pt : preferred) {
+        moved = moved || pt == tokens[k];
+      }
+      if (!moved) {
+        rebuilt += " " + tokens[k];
+      }
+    }
+    lines[i] = rebuilt;
+    size_t position = i + 1;
+    while (position < end && (lines[position].compare(0, 2, "i=") == 0 || lines[position].compare(0, 2, "c=") == 0)) {
+      ++position;
+    }
+    lines.insert(lines.begin() + position, "b=AS:" + std::to_string(kVideoKbps));
+  }
+  std::string munged;
+  for (const std::string &munged_line : lines) {
+    munged += munged_line + "\r\n";
+  }
+  return munged;
+}
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Result {
+  double sdps_per_s = 0;
+  double mb_per_s = 0;
+};
+
+// Runs |body| over all |sdps| repeatedly for about |seconds|.
+template <typename Body>
+Result Run(const std::vector<std::string> &sdps, double seconds, Body body) {
+  size_t bytes_per_round = 0;
+  for (const std::string &sdp : sdps) {
+    bytes_per_round += sdp.size();
+  }
+  size_t rounds = 0;
+  const int64_t begin_ns = NowNs();
+  int64_t elapsed_ns = 0;
+  do {
+    for (const std::string &sdp : sdps) {
+      body(sdp);
+    }
+    ++rounds;
+    elapsed_ns = NowNs() - begin_ns;
+  } while (elapsed_ns < seconds * 1e9);
+  Result result;
+  result.sdps_per_s = rounds * sdps.size() * 1e9 / elapsed_ns;
+  result.mb_per_s = rounds * bytes_per_round * 1e3 / elapsed_ns;
+  return result;
+}
+
+void Print(const char *operation, const Result &result) {
+  printf("%-16s %10.0f %9.1f %9.2f\n", operation, result.sdps_per_s, result.mb_per_s, 1e6 / result.sdps_per_s);
+}
+
+// Keeps results alive so the work isn't optimized away.
+size_t g_sink = 0;
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  double seconds = 0.5;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: sdp_bench [--seconds S]\n");
+      return 2;
+    }
+  }
+
+  for (int media_sections : {3, 16, 64}) {
+    // Offers of one shape from different peer connections; the first is the
+    // one munged before, the others are measured.
+    std::vector<std::string> offers;
+    for (unsigned seed = 1; seed <= 5; ++seed) {
+      offers.push_back(MakeOfferSdp(media_sections, seed));
+    }
+    const std::string first = offers.front();
+    offers.erase(offers.begin());
+
+    custom::SessionDescription description;
+    std::string munged;
+    custom::OfferTemplateCache cache;
+    Munge(description, first, &munged);
+    if (!cache.Store(first, munged)) {
+      fprintf(stderr, "sdp_bench: munged offer can't be templated\n");
+      return 1;
+    }
+    for (const std::string &offer : offers) {
+      std::string templated;
+      Munge(description, offer, &munged);
+      if (!cache.Apply(offer, &templated) || templated != munged || MungeWithStrings(offer) != munged) {
+        fprintf(stderr, "sdp_bench: munging paths disagree\n");
+        return 1;
+      }
+    }
+
+    printf("\n%d m= sections, %zu bytes, %zu lines\n", media_sections, offers[0].size(), description.line_count());
+    printf("%-16s %10s %9s %9s\n", "op", "SDPs/s", "MB/s", "us/SDP");
+    Print("tokenize", Run(offers, seconds, [&](const std::string &sdp) {
+            description.Parse(sdp);
+            g_sink += description.line_count();
+          }));
+    Print("parse all", Run(offers, seconds, [&](const std::string &sdp) {
+            description.Parse(sdp);
+            for (size_t i = 0; i < description.media_count(); ++i) {
+              g_sink += description.media(i).codecs.size();
+            }
+          }));
+    Print("munge", Run(offers, seconds, [&](const std::string &sdp) {
+            Munge(description, sdp, &munged);
+            g_sink += munged.size();
+          }));
+    Print("template", Run(offers, seconds, [&](const std::string &sdp) {
+            cache.Apply(sdp, &munged);
+            g_sink += munged.size();
+          }));
+    Print("std::string", Run(offers, seconds, [&](const std::string &sdp) {
+            g_sink += MungeWithStrings(sdp).size();
+          }));
+  }
+  return g_sink == 0 ? 1 : 0;
+}
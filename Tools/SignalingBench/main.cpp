@@ -0,0 +1,277 @@
+//
+//  main.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/10.
+//
+
+// signaling_bench: throughput of custom::SignalingParser and
+// custom::SignalingWriter on the messages SignalingService exchanges, an offer
+// and a burst of trickled candidates, against JsonCpp when it is installed.
+//
+//   signaling_bench [--seconds S]
+//
+// JsonCpp parses into its DOM and copies the fields out as std::strings, and
+// builds a DOM to write; that is what a generic library costs, as JSONDecoder
+// and JSONEncoder do in the app.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SignalingCodec.h"
+
+#ifdef CUSTOM_HAVE_JSONCPP
+#include <json/json.h>
+#endif
+
+namespace {
+
+// The kind of offer libwebrtc makes for one audio and one video track.
+std::string MakeOfferSdp() {
+  std::string sdp =
+      "v=0\r\n"
+      "o=- 4611731400430051336 2 IN IP4 127.0.0.1\r\n"
+      "s=-\r\n"
+      "t=0 0\r\n"
+      "a=group:BUNDLE 0 1\r\n"
+      "a=extmap-allow-mixed\r\n"
+      "a=msid-semantic: WMS stream\r\n";
+  const char *kMedia[] = {"audio", "video"};
+  for (int m = 0; m < 2; ++m) {
+    const bool video = m == 1;
+    sdp += std::string("m=") + kMedia[m] + " 9 UDP/TLS/RTP/SAVPF " +
+           (video ? "96 97 98 99 100 101 102 121 127 120 125 107 108 109 124 119 123\r\n"
+                  : "111 63 103 104 9 0 8 106 105 13 110 112 113 126\r\n");
+    sdp +=
+        "c=IN IP4 0.0.0.0\r\n"
+        "a=rtcp:9 IN IP4 0.0.0.0\r\n"
+        "a=ice-ufrag:8hhY\r\n"
+        "a=ice-pwd:asd88fgpdd777uzjYhagZg+h\r\n"
+        "a=ice-options:trickle renomination\r\n"
+        "a=fingerprint:sha-256 7B:8B:F0:65:5F:78:E2:51:3B:AC:6F:F3:3F:46:1B:35:DC:B8:5F:64:1A:24:C2:43:F0:A1:58:D0:A1:2C:19:08\r\n"
+        "a=setup:actpass\r\n";
+    sdp += "a=mid:" + std::to_string(m) + "\r\n";
+    sdp +=
+        "a=extmap:1 urn:ietf:params:rtp-hdrext:ssrc-audio-level\r\n"
+        "a=extmap:2 http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time\r\n"
+        "a=extmap:3 http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01\r\n"
+        "a=extmap:4 urn:ietf:params:rtp-hdrext:sdes:mid\r\n"
+        "a=sendrecv\r\n"
+        "a=msid:stream track\r\n"
+        "a=rtcp-mux\r\n";
+    if (video) {
+      sdp += "a=rtcp-rsize\r\n";
+      const int kPayloads[] = {96, 98, 100, 102, 127, 125, 108, 124, 123};
+      const char *kCodecs[] = {"VP8", "VP9", "VP9", "H264", "H264", "H264", "H264", "red", "ulpfec"};
+      for (size_t i = 0; i < sizeof(kPayloads) / sizeof(kPayloads[0]); ++i) {
+        const std::string pt = std::to_string(kPayloads[i]);
+        sdp += "a=rtpmap:" + pt + " " + kCodecs[i] + "/90000\r\n";
+        if (i < 7) {
+          sdp += "a=rtcp-fb:" + pt + " goog-remb\r\na=rtcp-fb:" + pt + " transport-cc\r\na=rtcp-fb:" + pt +
+                 " ccm fir\r\na=rtcp-fb:" + pt + " nack\r\na=rtcp-fb:" + pt + " nack pli\r\n";
+          sdp += "a=rtpmap:" + std::to_string(kPayloads[i] + 1) + " rtx/90000\r\n";
+          sdp += "a=fmtp:" + std::to_string(kPayloads[i] + 1) + " apt=" + pt + "\r\n";
+        }
+        if (std::strcmp(kCodecs[i], "H264") == 0) {
+          sdp += "a=fmtp:" + pt + " level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f\r\n";
+        }
+      }
+      sdp += "a=ssrc-group:FID 3735928559 3405691582\r\n";
+    } else {
+      sdp +=
+          "a=rtpmap:111 opus/48000/2\r\n"
+          "a=rtcp-fb:111 transport-cc\r\n"
+          "a=fmtp:111 minptime=10;useinbandfec=1\r\n"
+          "a=rtpmap:63 red/48000/2\r\n"
+          "a=fmtp:63 111/111\r\n"
+          "a=rtpmap:103 ISAC/16000\r\n"
+          "a=rtpmap:104 ISAC/32000\r\n"
+          "a=rtpmap:9 G722/8000\r\n"
+          "a=rtpmap:0 PCMU/8000\r\n"
+          "a=rtpmap:8 PCMA/8000\r\n"
+          "a=rtpmap:106 CN/32000\r\n"
+          "a=rtpmap:105 CN/16000\r\n"
+          "a=rtpmap:13 CN/8000\r\n"
+          "a=rtpmap:110 telephone-event/48000\r\n"
+          "a=rtpmap:112 telephone-event/32000\r\n"
+          "a=rtpmap:113 telephone-event/16000\r\n"
+          "a=rtpmap:126 telephone-event/8000\r\n";
+    }
+    const std::string ssrc = video ? "3735928559" : "2882400001";
+    sdp += "a=ssrc:" + ssrc + " cname:Yq8mVxVjUq6D2p2N\r\n";
+    sdp += "a=ssrc:" + ssrc + " msid:stream track\r\n";
+  }
+  return sdp;
+}
+
+std::vector<std::string> MakeCandidateSdps() {
+  return {
+      "candidate:842163049 1 udp 1677729535 203.0.113.7 61722 typ srflx raddr 192.168.1.23 rport 61722 generation 0 "
+      "ufrag 8hhY network-id 1 network-cost 10",
+      "candidate:1467250027 1 udp 2122260223 192.168.1.23 61722 typ host generation 0 ufrag 8hhY network-id 1 "
+      "network-cost 10",
+      "candidate:1853887674 1 udp 2122194687 fd00::1c2b:9aff:fe01:4411 58233 typ host generation 0 ufrag 8hhY "
+      "network-id 2 network-cost 10",
+      "candidate:3317407399 1 tcp 1518280447 192.168.1.23 9 typ host tcptype active generation 0 ufrag 8hhY "
+      "network-id 1 network-cost 10",
+      "candidate:2999745851 1 udp 41885439 198.51.100.20 3478 typ relay raddr 203.0.113.7 rport 61722 generation 0 "
+      "ufrag 8hhY network-id 1 network-cost 10",
+  };
+}
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Result {
+  double messages_per_s = 0;
+  double mb_per_s = 0;
+};
+
+// Runs |body| over all |messages| repeatedly for about |seconds|.
+template <typename Body>
+Result Run(const std::vector<std::string> &messages, double seconds, Body body) {
+  size_t bytes_per_round = 0;
+  for (const std::string &message : messages) {
+    bytes_per_round += message.size();
+  }
+  size_t rounds = 0;
+  const int64_t begin_ns = NowNs();
+  int64_t elapsed_ns = 0;
+  do {
+    for (const std::string &message : messages) {
+      body(message);
+    }
+    ++rounds;
+    elapsed_ns = NowNs() - begin_ns;
+  } while (elapsed_ns < seconds * 1e9);
+  Result result;
+  result.messages_per_s = rounds * messages.size() * 1e9 / elapsed_ns;
+  result.mb_per_s = rounds * bytes_per_round * 1e3 / elapsed_ns;
+  return result;
+}
+
+void Print(const char *name, const char *operation, const Result &result) {
+  printf("%-8s %-6s %12.0f %10.1f\n", name, operation, result.messages_per_s, result.mb_per_s);
+}
+
+// Keeps results alive so the work isn't optimized away.
+size_t g_sink = 0;
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  double seconds = 1.0;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: signaling_bench [--seconds S]\n");
+      return 2;
+    }
+  }
+
+  const std::string offer_sdp = MakeOfferSdp();
+  const std::vector<std::string> candidate_sdps = MakeCandidateSdps();
+  std::vector<custom::SignalingMessage> offers(1);
+  offers[0].type = custom::SignalingMessageType::kOffer;
+  offers[0].has_session_description = true;
+  offers[0].sdp = offer_sdp;
+  std::vector<custom::SignalingMessage> candidates;
+  for (size_t i = 0; i < candidate_sdps.size(); ++i) {
+    custom::SignalingMessage candidate;
+    candidate.type = custom::SignalingMessageType::kCandidate;
+    candidate.has_candidate = true;
+    candidate.candidate.sdp = candidate_sdps[i];
+    candidate.candidate.sdp_mline_index = static_cast<int32_t>(i % 2);
+    candidate.candidate.has_sdp_mid = true;
+    candidate.candidate.sdp_mid = i % 2 ? "1" : "0";
+    candidates.push_back(candidate);
+  }
+  // The JSON of every message, as the codec under test writes it.
+  custom::SignalingWriter writer;
+  const std::vector<std::string> offer_json = {std::string(writer.Write(offers[0]))};
+  std::vector<std::string> candidate_json;
+  for (const custom::SignalingMessage &message : candidates) {
+    candidate_json.emplace_back(writer.Write(message));
+  }
+
+  const struct {
+    const char *name;
+    const std::vector<custom::SignalingMessage> &messages;
+    const std::vector<std::string> &json;
+  } kWorkloads[] = {{"offer", offers, offer_json}, {"candidate", candidates, candidate_json}};
+  printf("offer %zu bytes, candidates %zu bytes on average\n", offer_json[0].size(),
+         [&] {
+           size_t total = 0;
+           for (const std::string &json : candidate_json) {
+             total += json.size();
+           }
+           return total / candidate_json.size();
+         }());
+
+  for (const auto &workload : kWorkloads) {
+    printf("\n%-8s %-6s %12s %10s  (%s)\n", "codec", "op", "msgs/s", "MB/s", workload.name);
+
+    custom::SignalingParser parser;
+    custom::SignalingMessage parsed;
+    Print("custom", "parse", Run(workload.json, seconds, [&](const std::string &json) {
+            parser.Parse(json, &parsed);
+            g_sink += parsed.sdp.size() + parsed.candidate.sdp.size();
+          }));
+    // The messages the JSON was written from.
+    const std::vector<custom::SignalingMessage> &to_write = workload.messages;
+    size_t next = 0;
+    Print("custom", "write", Run(workload.json, seconds, [&](const std::string &) {
+            g_sink += writer.Write(to_write[next]).size();
+            next = (next + 1) % to_write.size();
+          }));
+
+#ifdef CUSTOM_HAVE_JSONCPP
+    Json::CharReaderBuilder reader_builder;
+    std::unique_ptr<Json::CharReader> reader(reader_builder.newCharReader());
+    Print("jsoncpp", "parse", Run(workload.json, seconds, [&](const std::string &json) {
+            Json::Value root;
+            std::string errors;
+            reader->parse(json.data(), json.data() + json.size(), &root, &errors);
+            std::string type = root["type"].asString();
+            std::string sdp = root["sessionDescription"]["sdp"].asString();
+            const Json::Value &candidate = root["candidate"];
+            std::string candidate_sdp = candidate["sdp"].asString();
+            const int index = candidate["sdpMLineIndex"].asInt();
+            std::string mid = candidate["sdpMid"].asString();
+            g_sink += type.size() + sdp.size() + candidate_sdp.size() + index + mid.size();
+          }));
+    Json::StreamWriterBuilder writer_builder;
+    writer_builder["indentation"] = "";
+    next = 0;
+    Print("jsoncpp", "write", Run(workload.json, seconds, [&](const std::string &) {
+            const custom::SignalingMessage &message = to_write[next];
+            next = (next + 1) % to_write.size();
+            Json::Value root;
+            root["type"] = std::string(custom::SignalingMessageTypeName(message.type));
+            if (message.has_session_description) {
+              root["sessionDescription"]["sdp"] = std::string(message.sdp);
+            }
+            if (message.has_candidate) {
+              Json::Value &candidate = root["candidate"];
+              candidate["sdp"] = std::string(message.candidate.sdp);
+              candidate["sdpMLineIndex"] = message.candidate.sdp_mline_index;
+              candidate["sdpMid"] = std::string(message.candidate.sdp_mid);
+            }
+            g_sink += Json::writeString(writer_builder, root).size();
+          }));
+#endif
+  }
+#ifndef CUSTOM_HAVE_JSONCPP
+  printf("\nJsonCpp not found, built without the comparison\n");
+#endif
+  return g_sink == 0 ? 1 : 0;
+}
@@ -0,0 +1,107 @@
+//
+//  main.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/10.
+//
+
+// signaling_fuzz: libFuzzer target for custom::SignalingParser and
+// custom::SignalingWriter.
+//
+//   cmake -S . -B build-fuzz -DCMAKE_CXX_COMPILER=clang++ -DCUSTOM_BUILD_FUZZERS=ON
+//   cmake --build build-fuzz --target signaling_fuzz
+//   ./build-fuzz/signaling_fuzz -max_len=16384 corpus/
+//
+// Every input the parser accepts must survive a round trip: written back,
+// parsed again to the same message and written again to the same bytes.
+// Without clang the target is built with CUSTOM_FUZZ_STANDALONE, a main that
+// runs the files named on the command line, to replay crashes.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "SignalingCodec.h"
+
+namespace {
+
+bool SameCandidate(const custom::SignalingCandidate &x, const custom::SignalingCandidate &y) {
+  return x.sdp == y.sdp && x.sdp_mline_index == y.sdp_mline_index && x.has_sdp_mid == y.has_sdp_mid &&
+         (!x.has_sdp_mid || x.sdp_mid == y.sdp_mid);
+}
+
+bool SameMessage(const custom::SignalingMessage &a, const custom::SignalingMessage &b) {
+  if (a.type != b.type || a.has_session_description != b.has_session_description ||
+      a.supports_candidate_batches != b.supports_candidate_batches ||
+      a.supports_data_frames != b.supports_data_frames || a.has_candidate != b.has_candidate ||
+      a.candidate_count != b.candidate_count) {
+    return false;
+  }
+  if (a.has_session_description && a.sdp != b.sdp) {
+    return false;
+  }
+  if (a.has_candidate && !SameCandidate(a.candidate, b.candidate)) {
+    return false;
+  }
+  for (size_t i = 0; i < a.candidate_count; ++i) {
+    if (!SameCandidate(a.candidates[i], b.candidates[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    fprintf(stderr, "signaling_fuzz: %s\n", what);
+    abort();
+  }
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  // Kept across inputs, like the app's codec, so scratch reuse is covered.
+  static custom::SignalingParser parser;
+  static custom::SignalingParser reparser;
+  static custom::SignalingWriter writer;
+  static custom::SignalingWriter rewriter;
+
+  // A heap copy of exactly |size| bytes so overreads are caught.
+  const std::vector<char> frame(data, data + size);
+  custom::SignalingMessage message;
+  if (!parser.Parse(std::string_view(frame.data(), frame.size()), &message)) {
+    Check(parser.error()[0] != '\0' && parser.error_offset() <= size, "failure without an error");
+    return 0;
+  }
+  const std::string_view written = writer.Write(message);
+  custom::SignalingMessage reparsed;
+  Check(reparser.Parse(written, &reparsed), "written message doesn't parse");
+  Check(SameMessage(message, reparsed), "round trip changed the message");
+  Check(rewriter.Write(reparsed) == written, "round trip changed the JSON");
+  return 0;
+}
+
+#ifdef CUSTOM_FUZZ_STANDALONE
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; ++i) {
+    FILE *file = fopen(argv[i], "rb");
+    if (!file) {
+      fprintf(stderr, "signaling_fuzz: can't open %s\n", argv[i]);
+      return 1;
+    }
+    std::vector<uint8_t> input;
+    uint8_t chunk[4096];
+    size_t read = 0;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+      input.insert(input.end(), chunk, chunk + read);
+    }
+    fclose(file);
+    LLVMFuzzerTestOneInput(input.data(), input.size());
+  }
+  fprintf(stderr, "signaling_fuzz: ran %d inputs\n", argc - 1);
+  return 0;
+}
+#endif
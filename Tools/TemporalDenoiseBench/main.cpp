@@ -0,0 +1,126 @@
+//
+//  main.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/9.
+//
+
+// temporal_denoise_bench: time per frame of custom::ApplyTemporalDenoise over
+// 2 to |--frames| history frames of NV12, on every SIMD path this CPU supports.
+// The history is the current frame plus noise, so most samples average.
+//
+//   temporal_denoise_bench [--size WxH] [--frames K] [--threshold T] [--seconds S]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "TemporalDenoise.h"
+
+namespace {
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Runs |body| repeatedly for about |seconds|; returns milliseconds per call.
+double Run(double seconds, const std::function<void()> &body) {
+  int64_t calls = 0;
+  const int64_t start = NowNs();
+  int64_t elapsed_ns = 0;
+  do {
+    body();
+    calls++;
+    elapsed_ns = NowNs() - start;
+  } while (elapsed_ns < seconds * 1e9);
+  return elapsed_ns / 1e6 / calls;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int width = 1280;
+  int height = 720;
+  int frames = custom::kMaxTemporalDenoiseFrames;
+  int threshold = 10;
+  double seconds = 1.0;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &width, &height) == 2 &&
+        width > 0 && height > 0) {
+      ++i;
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frames = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+      threshold = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: temporal_denoise_bench [--size WxH] [--frames K] [--threshold T] [--seconds S]\n");
+      return 2;
+    }
+  }
+  if (frames < 2 || frames > custom::kMaxTemporalDenoiseFrames || threshold < 0 || threshold > 255) {
+    fprintf(stderr, "temporal_denoise_bench: --frames must be 2..%d and --threshold 0..255\n",
+            custom::kMaxTemporalDenoiseFrames);
+    return 2;
+  }
+
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  const size_t y_size = static_cast<size_t>(width) * height;
+  const size_t uv_size = static_cast<size_t>(chroma_width) * 2 * chroma_height;
+  // The current frame, the history after it, and the output.
+  std::vector<std::vector<uint8_t>> buffers(frames + 2, std::vector<uint8_t>(y_size + uv_size));
+  uint32_t state = 1;
+  for (uint8_t &value : buffers[0]) {
+    state = state * 1664525u + 1013904223u;
+    value = static_cast<uint8_t>(state >> 24);
+  }
+  for (int i = 1; i <= frames; ++i) {
+    for (size_t j = 0; j < buffers[i].size(); ++j) {
+      state = state * 1664525u + 1013904223u;
+      const int value = buffers[0][j] + static_cast<int>(state >> 24) % 17 - 8;
+      buffers[i][j] = static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+    }
+  }
+  std::vector<custom::Yuv420Image> images(frames + 2);
+  for (size_t i = 0; i < images.size(); ++i) {
+    images[i].format = custom::kFourccNV12VideoRange;
+    images[i].width = width;
+    images[i].height = height;
+    images[i].planes[0] = buffers[i].data();
+    images[i].planes[1] = buffers[i].data() + y_size;
+    images[i].strides[0] = width;
+    images[i].strides[1] = chroma_width * 2;
+  }
+
+  const custom::SimdPath kPaths[] = {custom::SimdPath::kScalar, custom::SimdPath::kSSE2, custom::SimdPath::kAVX2,
+                                     custom::SimdPath::kNEON};
+  printf("%dx%d nv12, threshold %d\n\n%-3s %10s", width, height, threshold, "K", "history MB");
+  for (custom::SimdPath path : kPaths) {
+    if (custom::IsSimdPathSupported(path)) {
+      printf(" %9s", custom::SimdPathName(path));
+    }
+  }
+  printf("\n");
+  for (int count = 2; count <= frames; ++count) {
+    printf("%-3d %10.1f", count, count * (y_size + uv_size) / 1e6);
+    for (custom::SimdPath path : kPaths) {
+      if (!custom::IsSimdPathSupported(path)) {
+        continue;
+      }
+      const double ms = Run(seconds, [&] {
+        custom::ApplyTemporalDenoise(images[0], &images[1], count, static_cast<uint8_t>(threshold),
+                                     images[frames + 1], path);
+      });
+      printf(" %9.3f", ms);
+    }
+    printf("\n");
+  }
+  return 0;
+}
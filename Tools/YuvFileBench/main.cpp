@@ -0,0 +1,138 @@
+//
+//  main.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/9.
+//
+
+// yuv_file_bench: copy rate of a raw I420 file through custom::YuvFileReader
+// and custom::YuvFileWriter, through the page cache and bypassing it. The
+// source is written first, in |--dir|; the copies are synced before the clock
+// stops, so the rate is what reaches the file system.
+//
+//   yuv_file_bench [--size WxH] [--frames N] [--dir PATH]
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "YuvFile.h"
+
+namespace {
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+bool Sync(const std::string &path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  const bool synced = fsync(fd) == 0;
+  close(fd);
+  return synced;
+}
+
+// Copies |src| to |dst|; returns seconds, or a negative value on failure.
+double Copy(const std::string &src, const std::string &dst, const custom::YuvFileInfo &info, bool direct_io,
+            bool *was_direct) {
+  const int64_t start = NowNs();
+  custom::YuvFileReader reader;
+  std::string error;
+  if (!reader.Open(src, info, &error)) {
+    fprintf(stderr, "yuv_file_bench: %s\n", error.c_str());
+    return -1;
+  }
+  custom::YuvFileWriterConfig config;
+  config.direct_io = direct_io;
+  custom::YuvFileWriter writer;
+  if (!writer.Open(dst, reader.info(), config, &error)) {
+    fprintf(stderr, "yuv_file_bench: %s\n", error.c_str());
+    return -1;
+  }
+  *was_direct = writer.direct_io();
+  custom::YuvFrameView view;
+  while (reader.Next(&view)) {
+    if (!writer.WriteFrame(view.image)) {
+      fprintf(stderr, "yuv_file_bench: write failed\n");
+      return -1;
+    }
+  }
+  if (!writer.Close() || !Sync(dst)) {
+    fprintf(stderr, "yuv_file_bench: write failed\n");
+    return -1;
+  }
+  return (NowNs() - start) / 1e9;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  custom::YuvFileInfo info;
+  info.format = custom::kFourccI420;
+  info.width = 3840;
+  info.height = 2160;
+  int frames = 60;
+  std::string dir = ".";
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--size") == 0 && i + 1 < argc &&
+        sscanf(argv[i + 1], "%dx%d", &info.width, &info.height) == 2 && info.width > 0 && info.height > 0) {
+      ++i;
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+      frames = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+      dir = argv[++i];
+    } else {
+      fprintf(stderr, "usage: yuv_file_bench [--size WxH] [--frames N] [--dir PATH]\n");
+      return 2;
+    }
+  }
+
+  const std::string src = dir + "/yuv_file_bench_src.yuv";
+  const std::string dst = dir + "/yuv_file_bench_dst.yuv";
+  const size_t frame_size = custom::YuvFileFrameSize(info);
+  {
+    std::vector<uint8_t> frame(frame_size);
+    uint32_t state = 1;
+    for (uint8_t &value : frame) {
+      state = state * 1664525u + 1013904223u;
+      value = static_cast<uint8_t>(state >> 24);
+    }
+    FILE *file = fopen(src.c_str(), "wb");
+    if (!file) {
+      fprintf(stderr, "yuv_file_bench: can't create %s\n", src.c_str());
+      return 1;
+    }
+    for (int i = 0; i < frames; ++i) {
+      fwrite(frame.data(), 1, frame.size(), file);
+    }
+    fclose(file);
+  }
+
+  const double megabytes = static_cast<double>(frame_size) * frames / 1e6;
+  printf("%dx%d i420, %d frames, %.0f MB\n\n%-8s %8s %8s\n", info.width, info.height, frames, megabytes, "copy", "s",
+         "GB/s");
+  int status = 0;
+  for (bool direct_io : {false, true}) {
+    bool was_direct = false;
+    const double seconds = Copy(src, dst, info, direct_io, &was_direct);
+    if (seconds < 0) {
+      status = 1;
+      break;
+    }
+    printf("%-8s %8.3f %8.2f%s\n", direct_io ? "direct" : "cached", seconds, megabytes / 1e3 / seconds,
+           direct_io && !was_direct ? "  (refused, cached)" : "");
+  }
+  remove(src.c_str());
+  remove(dst.c_str());
+  return status;
+}
@@ -0,0 +1,176 @@
+//
+//  main.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/8.
+//
+
+// yuv_filter_bench: throughput of custom::ApplyYuvFilter on every SIMD path
+// this CPU supports, for the filters CustomCPUFilter runs, on an NV12 frame.
+//
+//   yuv_filter_bench [--size WxH] [--seconds S]
+//
+// Prints megapixels per second of luma and the speedup over the scalar path,
+// then replays a static screen with a moving 200x120 window through
+// ApplyYuvFilterToChangedTiles() and prints the tiles skipped and the time per
+// frame against filtering every frame whole.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "DirtyRegion.h"
+#include "YuvFilter.h"
+
+namespace {
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Filters |frame| repeatedly for about |seconds|; returns megapixels per second.
+double Run(const custom::YuvFilter &filter, const custom::Yuv420Image &src, const custom::Yuv420Image &dst,
+           custom::SimdPath path, double seconds) {
+  int64_t frames = 0;
+  const int64_t start = NowNs();
+  int64_t elapsed_ns = 0;
+  do {
+    custom::ApplyYuvFilter(filter, src, dst, path);
+    frames++;
+    elapsed_ns = NowNs() - start;
+  } while (elapsed_ns < seconds * 1e9);
+  return static_cast<double>(src.width) * src.height * frames / (elapsed_ns / 1e9) / 1e6;
+}
+
+// Draws frame |index| of the replay into |image|: bands of flat color with a
+// 200x120 window moving across, the kind of input screen sharing gives.
+void DrawReplayFrame(const custom::Yuv420Image &image, int index) {
+  const int window_x = (index * 7) % std::max(image.width - 200, 1);
+  const int window_y = (index * 3) % std::max(image.height - 120, 1);
+  for (int y = 0; y < image.height; ++y) {
+    uint8_t *row = image.planes[0] + static_cast<size_t>(y) * image.strides[0];
+    for (int x = 0; x < image.width; ++x) {
+      const bool window = x >= window_x && x < window_x + 200 && y >= window_y && y < window_y + 120;
+      row[x] = static_cast<uint8_t>(window ? 40 + (x - window_x) % 32 : 60 + y / 40 * 8);
+    }
+  }
+  for (int y = 0; y < (image.height + 1) / 2; ++y) {
+    uint8_t *row = image.planes[1] + static_cast<size_t>(y) * image.strides[1];
+    for (int x = 0; x < (image.width + 1) / 2; ++x) {
+      const bool window = x * 2 >= window_x && x * 2 < window_x + 200 && y * 2 >= window_y && y * 2 < window_y + 120;
+      row[2 * x] = window ? 160 : 120;
+      row[2 * x + 1] = window ? 100 : 136;
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int width = 1280;
+  int height = 720;
+  double seconds = 1.0;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &width, &height) == 2 &&
+        width > 0 && height > 0) {
+      ++i;
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: yuv_filter_bench [--size WxH] [--seconds S]\n");
+      return 2;
+    }
+  }
+
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  std::vector<uint8_t> src_y(static_cast<size_t>(width) * height);
+  std::vector<uint8_t> src_uv(static_cast<size_t>(chroma_width) * 2 * chroma_height);
+  std::vector<uint8_t> dst_y(src_y.size());
+  std::vector<uint8_t> dst_uv(src_uv.size());
+  uint32_t state = 1;
+  for (uint8_t &value : src_y) {
+    state = state * 1664525u + 1013904223u;
+    value = static_cast<uint8_t>(16 + (state >> 24) % 220);
+  }
+  for (uint8_t &value : src_uv) {
+    state = state * 1664525u + 1013904223u;
+    value = static_cast<uint8_t>(16 + (state >> 24) % 225);
+  }
+  custom::Yuv420Image src;
+  src.format = custom::kFourccNV12VideoRange;
+  src.width = width;
+  src.height = height;
+  src.planes[0] = src_y.data();
+  src.planes[1] = src_uv.data();
+  src.strides[0] = width;
+  src.strides[1] = chroma_width * 2;
+  custom::Yuv420Image dst = src;
+  dst.planes[0] = dst_y.data();
+  dst.planes[1] = dst_uv.data();
+
+  uint8_t invert[256];
+  for (int i = 0; i < 256; ++i) {
+    invert[i] = static_cast<uint8_t>(255 - i);
+  }
+  const struct {
+    const char *name;
+    custom::YuvFilter filter;
+  } kFilters[] = {
+      {"grayscale", custom::YuvFilter::Grayscale()},
+      {"contrast", custom::YuvFilter::BrightnessContrast(0.1f, 1.3f)},
+      {"lut", custom::YuvFilter::Lut(invert)},
+  };
+  const custom::SimdPath kPaths[] = {custom::SimdPath::kScalar, custom::SimdPath::kSSE2, custom::SimdPath::kAVX2,
+                                     custom::SimdPath::kNEON};
+
+  printf("%dx%d nv12\n\n%-10s %-7s %10s %8s\n", width, height, "filter", "path", "Mpix/s", "speedup");
+  for (const auto &entry : kFilters) {
+    double scalar = 0;
+    for (custom::SimdPath path : kPaths) {
+      if (!custom::IsSimdPathSupported(path)) {
+        continue;
+      }
+      const double mpix = Run(entry.filter, src, dst, path, seconds);
+      if (path == custom::SimdPath::kScalar) {
+        scalar = mpix;
+      }
+      printf("%-10s %-7s %10.1f %7.2fx\n", entry.name, custom::SimdPathName(path), mpix, scalar ? mpix / scalar : 0);
+    }
+  }
+
+  // Two outputs, each the previous one of the next frame.
+  std::vector<uint8_t> out_y[2] = {dst_y, dst_y};
+  std::vector<uint8_t> out_uv[2] = {dst_uv, dst_uv};
+  custom::Yuv420Image outputs[2] = {dst, dst};
+  for (int i = 0; i < 2; ++i) {
+    outputs[i].planes[0] = out_y[i].data();
+    outputs[i].planes[1] = out_uv[i].data();
+  }
+  const custom::YuvFilter filter = custom::YuvFilter::BrightnessContrast(0.1f, 1.3f);
+  custom::DirtyRegionDetector detector;
+  int64_t tiled_ns = 0;
+  int64_t full_ns = 0;
+  int frames = 0;
+  const int64_t replay_start = NowNs();
+  do {
+    DrawReplayFrame(src, frames);
+    const custom::Yuv420Image &previous = outputs[(frames + 1) % 2];
+    int64_t start = NowNs();
+    custom::ApplyYuvFilterToChangedTiles(filter, src, frames ? &previous : nullptr, outputs[frames % 2], &detector);
+    tiled_ns += NowNs() - start;
+    start = NowNs();
+    custom::ApplyYuvFilter(filter, src, dst);
+    full_ns += NowNs() - start;
+    frames++;
+  } while (NowNs() - replay_start < seconds * 1e9 || frames < 2);
+  printf("\nstatic screen replay, %d frames: %.0f%% of tiles skipped, %.2f ms per frame, %.2f ms whole\n", frames,
+         detector.stats().skipped_fraction() * 100, tiled_ns / 1e6 / frames, full_ns / 1e6 / frames);
+  return 0;
+}
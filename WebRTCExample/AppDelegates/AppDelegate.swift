@@ -14,6 +14,8 @@ class AppDelegate: UIResponder, UIApplicationDelegate {
 
     func application(_ application: UIApplication, didFinishLaunchingWithOptions launchOptions: [UIApplication.LaunchOptionsKey: Any]?) -> Bool {
         // Override point for customization after application launch.
+        // Compile the capture filter's shaders now rather than on the first frame.
+        CustomPixelBufferProcesser.warmUpShaders()
         return true
     }
 
@@ -0,0 +1,68 @@
+//
+//  CustomCPUFilter.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/24.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreVideo/CoreVideo.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// CPU implementation of the CustomTargetShader filters, for places without an EAGLContext. Works on 4:2:0 buffers
+/// ('420f', '420v', 'y420') and produces the same NV12 the shader's direct YUV output does, within a code value or so.
+/// Frames are not rotated.
+@interface CustomCPUFilter : NSObject
+
+/// Makes -filteredPixelBuffer: filter only the 16x16 tiles whose luma or chroma changed since the previous frame, and
+/// the tiles next to them, and copy the others from the previous output, for screen share and mostly static scenes.
+/// With a zero tileChangeThreshold the output is the same as without it. Keeps the previous input's luma and output; a filter in this mode must only be
+/// used for one stream, from one thread at a time. Defaults to NO.
+@property(nonatomic, assign) BOOL skipsUnchangedTiles;
+
+/// Mean absolute difference per sample a tile may have and still count as unchanged. 0, the default, treats any
+/// change as one; raise it for noisy camera input, small changes then show once they add up.
+@property(nonatomic, assign) NSUInteger tileChangeThreshold;
+
+/// Makes -filteredPixelBuffer: turn its output upside down, the geometry CustomTargetShader's unrotated quad gives.
+/// skipsUnchangedTiles has no effect while it is set. Defaults to NO.
+@property(nonatomic, assign) BOOL flipsVertically;
+
+/// Identifies what the filter does: equal for filters with the same effect, flipsVertically included.
+@property(nonatomic, readonly) uint64_t effectKey;
+
+/// Fraction of tiles -filteredPixelBuffer: skipped since the last -resetTileStats.
+@property(nonatomic, readonly) double skippedTileFraction;
+
+- (void)resetTileStats;
+
+/// Leaves the colors as they are, apart from the shader's YUV round trip.
++ (instancetype)identityFilter;
+
+/// The effect of GRAYSCALE_FILTER_SOURCE.
++ (instancetype)grayscaleFilter;
+
+/// |matrix| holds a row major 3x3 applied to normalized RGB, the 3 values of |offset| are added afterwards.
++ (instancetype)colorMatrixFilter:(const float *)matrix offset:(const float *)offset;
+
+/// rgb' = (rgb - 0.5) * contrast + 0.5 + brightness.
++ (instancetype)brightnessContrastFilter:(float)brightness contrast:(float)contrast;
+
+/// Curve of 256 entries applied to each channel of 8 bit RGB.
++ (instancetype)lutFilter:(const uint8_t *)lut;
+
+/// This filter followed by |filter|, nil if a LUT would have to be followed by a color matrix.
+- (nullable instancetype)filterByAppendingFilter:(CustomCPUFilter *)filter;
+
+/// Filters |pixelBuffer| in place. Returns NO for unsupported formats.
+- (BOOL)applyToPixelBuffer:(CVPixelBufferRef)pixelBuffer;
+
+/// Filters |pixelBuffer| into a video range NV12 ('420v') buffer from +[CustomPixelBufferPool sharedPool], like the
+/// shader's output. See skipsUnchangedTiles and flipsVertically.
+/// Note: This function pass ownership of return value(CVPixelBufferRef) to the caller.
+- (nullable CVPixelBufferRef)filteredPixelBuffer:(CVPixelBufferRef)pixelBuffer CF_RETURNS_RETAINED;
+
+@end
+
+NS_ASSUME_NONNULL_END
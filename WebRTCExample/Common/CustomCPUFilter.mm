@@ -0,0 +1,170 @@
+//
+//  CustomCPUFilter.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/24.
+//
+
+#import "CustomCPUFilter.h"
+#import "CustomPixelBufferPool.h"
+#import "CustomPixelBufferUtils.h"
+
+#include <memory>
+
+#include "DirtyRegion.h"
+#include "ProgramBinaryCache.h"
+#include "YuvFilter.h"
+
+@implementation CustomCPUFilter {
+    custom::YuvFilter _filter;
+    // State of skipsUnchangedTiles.
+    std::unique_ptr<custom::DirtyRegionDetector> _detector;
+    CVPixelBufferRef _previousOutput;
+}
+
+- (instancetype)initWithFilter:(const custom::YuvFilter &)filter {
+    if (self = [super init]) {
+        _filter = filter;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_previousOutput) {
+        CVPixelBufferRelease(_previousOutput);
+    }
+}
+
+- (void)setSkipsUnchangedTiles:(BOOL)skipsUnchangedTiles {
+    _skipsUnchangedTiles = skipsUnchangedTiles;
+    [self resetTileState];
+}
+
+- (void)setTileChangeThreshold:(NSUInteger)tileChangeThreshold {
+    _tileChangeThreshold = tileChangeThreshold;
+    [self resetTileState];
+}
+
+- (uint64_t)effectKey {
+    uint64_t key = custom::Fnv1a64(_filter.matrix, sizeof(_filter.matrix));
+    key = custom::Fnv1a64(_filter.offset, sizeof(_filter.offset), key);
+    if (_filter.has_lut) {
+        key = custom::Fnv1a64(_filter.lut, sizeof(_filter.lut), key);
+    }
+    const uint8_t flags[2] = {_filter.has_lut, (uint8_t)_flipsVertically};
+    return custom::Fnv1a64(flags, sizeof(flags), key);
+}
+
+- (double)skippedTileFraction {
+    return _detector ? _detector->stats().skipped_fraction() : 0.0;
+}
+
+- (void)resetTileStats {
+    if (_detector) {
+        _detector->ResetStats();
+    }
+}
+
+- (void)resetTileState {
+    const int blockArea = custom::DirtyRegionDetector::kBlockSize * custom::DirtyRegionDetector::kBlockSize;
+    _detector = _skipsUnchangedTiles
+        ? std::make_unique<custom::DirtyRegionDetector>((uint32_t)MIN(_tileChangeThreshold, 255) * blockArea)
+        : nullptr;
+    if (_previousOutput) {
+        CVPixelBufferRelease(_previousOutput);
+        _previousOutput = NULL;
+    }
+}
+
++ (instancetype)identityFilter {
+    return [[self alloc] initWithFilter:custom::YuvFilter::Identity()];
+}
+
++ (instancetype)grayscaleFilter {
+    return [[self alloc] initWithFilter:custom::YuvFilter::Grayscale()];
+}
+
++ (instancetype)colorMatrixFilter:(const float *)matrix offset:(const float *)offset {
+    return [[self alloc] initWithFilter:custom::YuvFilter::ColorMatrix(matrix, offset)];
+}
+
++ (instancetype)brightnessContrastFilter:(float)brightness contrast:(float)contrast {
+    return [[self alloc] initWithFilter:custom::YuvFilter::BrightnessContrast(brightness, contrast)];
+}
+
++ (instancetype)lutFilter:(const uint8_t *)lut {
+    return [[self alloc] initWithFilter:custom::YuvFilter::Lut(lut)];
+}
+
+- (nullable instancetype)filterByAppendingFilter:(CustomCPUFilter *)filter {
+    custom::YuvFilter composed;
+    if (!custom::ComposeYuvFilters(_filter, filter->_filter, &composed)) {
+        return nil;
+    }
+    return [[[self class] alloc] initWithFilter:composed];
+}
+
+- (BOOL)applyToPixelBuffer:(CVPixelBufferRef)pixelBuffer {
+    CVPixelBufferLockBaseAddress(pixelBuffer, 0);
+    const custom::Yuv420Image image = [CustomPixelBufferUtils yuv420ImageOfPixelBuffer:pixelBuffer];
+    const bool success = custom::ApplyYuvFilter(_filter, image, image);
+    CVPixelBufferUnlockBaseAddress(pixelBuffer, 0);
+    if (!success) {
+        DLog(@"CustomCPUFilter: can't filter pixel format %u", (unsigned)CVPixelBufferGetPixelFormatType(pixelBuffer));
+    }
+    return success;
+}
+
+- (nullable CVPixelBufferRef)filteredPixelBuffer:(CVPixelBufferRef)pixelBuffer CF_RETURNS_RETAINED {
+    const OSType inputFormat = CVPixelBufferGetPixelFormatType(pixelBuffer);
+    // custom::ApplyYuvFilter() encodes with kBT601VideoRange whatever the input range.
+    const OSType outputFormat = kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange;
+    const CGSize size = CGSizeMake(CVPixelBufferGetWidth(pixelBuffer), CVPixelBufferGetHeight(pixelBuffer));
+    CVPixelBufferRef targetPixelBuffer = [[CustomPixelBufferPool sharedPool] createPixelBuffer:outputFormat targetSize:size];
+    if (!targetPixelBuffer) {
+        return nil;
+    }
+
+    CVPixelBufferLockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+    CVPixelBufferLockBaseAddress(targetPixelBuffer, 0);
+    const custom::Yuv420Image source = [CustomPixelBufferUtils yuv420ImageOfPixelBuffer:pixelBuffer];
+    const custom::Yuv420Image target = [CustomPixelBufferUtils yuv420ImageOfPixelBuffer:targetPixelBuffer];
+    bool success = false;
+    if (_flipsVertically) {
+        success = custom::ApplyYuvFilter(_filter, source, target) && custom::FlipYuv420Vertically(target);
+    } else {
+        success = _detector ? [self filterChangedTilesOf:source into:target] : custom::ApplyYuvFilter(_filter, source, target);
+    }
+    CVPixelBufferUnlockBaseAddress(targetPixelBuffer, 0);
+    CVPixelBufferUnlockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+
+    if (!success) {
+        DLog(@"CustomCPUFilter: can't filter pixel format %u", (unsigned)inputFormat);
+        CVPixelBufferRelease(targetPixelBuffer);
+        return nil;
+    }
+    if (_detector && !_flipsVertically) {
+        if (_previousOutput) {
+            CVPixelBufferRelease(_previousOutput);
+        }
+        _previousOutput = CVPixelBufferRetain(targetPixelBuffer);
+    }
+    return targetPixelBuffer;
+}
+
+#pragma mark - Private
+
+/// Filters the tiles of |source| that changed since the previous frame, and their neighbours, into |target| and copies
+/// the rest from the previous output. Everything is filtered if there is no usable previous output.
+- (BOOL)filterChangedTilesOf:(const custom::Yuv420Image &)source into:(const custom::Yuv420Image &)target {
+    if (!_previousOutput) {
+        return custom::ApplyYuvFilterToChangedTiles(_filter, source, nullptr, target, _detector.get());
+    }
+    CVPixelBufferLockBaseAddress(_previousOutput, kCVPixelBufferLock_ReadOnly);
+    const custom::Yuv420Image previous = [CustomPixelBufferUtils yuv420ImageOfPixelBuffer:_previousOutput];
+    const bool success = custom::ApplyYuvFilterToChangedTiles(_filter, source, &previous, target, _detector.get());
+    CVPixelBufferUnlockBaseAddress(_previousOutput, kCVPixelBufferLock_ReadOnly);
+    return success;
+}
+
+@end
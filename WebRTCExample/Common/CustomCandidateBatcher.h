@@ -0,0 +1,49 @@
+//
+//  CustomCandidateBatcher.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/11.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "CustomSignalingCodec.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Receives a batch of candidates, in the order they were added, on the batcher's queue.
+typedef void (^CustomCandidateBatchHandler)(NSArray<CustomSignalingCandidate *> *candidates);
+
+/// Coalesces trickled ICE candidates with custom::CandidateBatcher: a batch is handed to the handler windowMs after its
+/// first candidate, as soon as it holds maxCandidates, or on flush, e.g. once gathering completes. Candidates with the
+/// same transport address as one already added are dropped. Thread safe; the work happens on a private serial queue.
+@interface CustomCandidateBatcher : NSObject
+
+/// How long a batch waits for more candidates, 0 to hand over every candidate on its own. Defaults to 20.
+@property(atomic, assign) double windowMs;
+/// Defaults to 16.
+@property(atomic, assign) NSUInteger maxCandidates;
+
+@property(atomic, copy, nullable) CustomCandidateBatchHandler handler;
+
+/// Candidates added, duplicates included.
+@property(atomic, readonly) uint64_t candidateCount;
+/// Candidates dropped as redundant.
+@property(atomic, readonly) uint64_t duplicateCount;
+@property(atomic, readonly) uint64_t batchCount;
+@property(atomic, readonly) double meanBatchSize;
+/// Time from a candidate being added to its batch being handed over.
+@property(atomic, readonly) double meanLatencyMs;
+@property(atomic, readonly) double maxLatencyMs;
+
+- (void)addCandidate:(CustomSignalingCandidate *)candidate;
+
+/// Hands over the open batch now.
+- (void)flush;
+
+/// Forgets the candidates seen so far, for a new gathering, e.g. after an ICE restart.
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
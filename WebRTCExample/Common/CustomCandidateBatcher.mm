@@ -0,0 +1,168 @@
+//
+//  CustomCandidateBatcher.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/11.
+//
+
+#import "CustomCandidateBatcher.h"
+
+#include <atomic>
+#include <memory>
+
+#include "CandidateBatcher.h"
+#include "StageTrace.h"
+
+namespace {
+
+const double kDefaultWindowMs = 20;
+const NSUInteger kDefaultMaxCandidates = 16;
+
+}  // namespace
+
+@implementation CustomCandidateBatcher {
+    dispatch_queue_t _queue;
+    // Only used on _queue.
+    std::unique_ptr<custom::CandidateBatcher> _batcher;
+    // The candidates added, by their order in the batch.
+    NSMutableArray<CustomSignalingCandidate *> *_pending;
+    std::atomic<uint64_t> _candidateCount;
+    std::atomic<uint64_t> _duplicateCount;
+    std::atomic<uint64_t> _batchCount;
+    std::atomic<uint64_t> _sentCount;
+    std::atomic<int64_t> _latencySumNs;
+    std::atomic<int64_t> _latencyMaxNs;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _queue = dispatch_queue_create("com.custom.candidatebatcher", DISPATCH_QUEUE_SERIAL);
+        _windowMs = kDefaultWindowMs;
+        _maxCandidates = kDefaultMaxCandidates;
+        _pending = [NSMutableArray array];
+        _candidateCount = 0;
+        _duplicateCount = 0;
+        _batchCount = 0;
+        _sentCount = 0;
+        _latencySumNs = 0;
+        _latencyMaxNs = 0;
+
+        // The views passed to the send function are the strings of _pending, in the same order, so the batch is
+        // handed over as the objects that were added instead of new copies.
+        __weak CustomCandidateBatcher *weakSelf = self;
+        _batcher = std::make_unique<custom::CandidateBatcher>(
+            custom::CandidateBatcherConfig(), [weakSelf](const custom::SignalingCandidate *, size_t count) {
+                [weakSelf handOverBatchOfCount:count];
+            });
+    }
+    return self;
+}
+
+- (uint64_t)candidateCount {
+    return _candidateCount.load();
+}
+
+- (uint64_t)duplicateCount {
+    return _duplicateCount.load();
+}
+
+- (uint64_t)batchCount {
+    return _batchCount.load();
+}
+
+- (double)meanBatchSize {
+    const uint64_t batches = _batchCount.load();
+    return batches ? (double)_sentCount.load() / batches : 0;
+}
+
+- (double)meanLatencyMs {
+    const uint64_t sent = _sentCount.load();
+    return sent ? _latencySumNs.load() / 1e6 / sent : 0;
+}
+
+- (double)maxLatencyMs {
+    return _latencyMaxNs.load() / 1e6;
+}
+
+- (void)addCandidate:(CustomSignalingCandidate *)candidate {
+    dispatch_async(_queue, ^{
+        // Picks up window and size changes for the next batch.
+        if (self->_batcher->pending() == 0) {
+            custom::CandidateBatcherConfig config = self->_batcher->config();
+            config.window_ns = (int64_t)(MAX(self.windowMs, 0.0) * 1e6);
+            config.max_candidates = MAX(self.maxCandidates, (NSUInteger)1);
+            self->_batcher->set_config(config);
+        }
+        // The batcher copies the strings.
+        custom::SignalingCandidate view;
+        view.sdp = candidate.sdp.UTF8String;
+        view.sdp_mline_index = candidate.sdpMLineIndex;
+        view.has_sdp_mid = candidate.sdpMid != nil;
+        if (candidate.sdpMid) {
+            view.sdp_mid = candidate.sdpMid.UTF8String;
+        }
+        const int64_t deadlineNs = self->_batcher->deadline_ns();
+        [self->_pending addObject:candidate];
+        if (!self->_batcher->Add(view, custom::TraceNowNs())) {
+            [self->_pending removeLastObject];
+        } else if (self->_batcher->deadline_ns() >= 0 && self->_batcher->deadline_ns() != deadlineNs) {
+            // A batch was opened.
+            [self armTimerForDeadlineNs:self->_batcher->deadline_ns()];
+        }
+        [self updateCounts];
+    });
+}
+
+- (void)flush {
+    dispatch_async(_queue, ^{
+        self->_batcher->Flush(custom::TraceNowNs());
+        [self updateCounts];
+        DLog(@"CustomCandidateBatcher: %llu candidates, %llu redundant, %llu batches of %.1f, %.1f/%.1f ms wait",
+             self.candidateCount, self.duplicateCount, self.batchCount, self.meanBatchSize, self.meanLatencyMs,
+             self.maxLatencyMs);
+    });
+}
+
+- (void)reset {
+    dispatch_async(_queue, ^{
+        self->_batcher->Reset();
+    });
+}
+
+#pragma mark - Private
+
+// On _queue. One timer per opened batch; one firing after its batch was sent early finds nothing due.
+- (void)armTimerForDeadlineNs:(int64_t)deadlineNs {
+    const int64_t delayNs = MAX(deadlineNs - custom::TraceNowNs(), (int64_t)0);
+    __weak CustomCandidateBatcher *weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, delayNs), _queue, ^{
+        CustomCandidateBatcher *strongSelf = weakSelf;
+        if (strongSelf) {
+            strongSelf->_batcher->Poll(custom::TraceNowNs());
+            [strongSelf updateCounts];
+        }
+    });
+}
+
+// On _queue, from the batcher's send function.
+- (void)handOverBatchOfCount:(size_t)count {
+    NSArray<CustomSignalingCandidate *> *batch = [_pending subarrayWithRange:NSMakeRange(0, count)];
+    [_pending removeObjectsInRange:NSMakeRange(0, count)];
+    CustomCandidateBatchHandler handler = self.handler;
+    if (handler) {
+        handler(batch);
+    }
+}
+
+// On _queue.
+- (void)updateCounts {
+    const custom::CandidateBatchStats &stats = _batcher->stats();
+    _candidateCount = stats.candidates;
+    _duplicateCount = stats.duplicates;
+    _batchCount = stats.batches;
+    _sentCount = stats.sent;
+    _latencySumNs = stats.latency_sum_ns;
+    _latencyMaxNs = stats.latency_max_ns;
+}
+
+@end
@@ -0,0 +1,36 @@
+//
+//  CustomColorConverter.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/28.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreVideo/CoreVideo.h>
+#import "CustomTypes.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Converts the frames of one stream between kCVPixelFormatType_32BGRA and a 4:2:0 format ('420v', '420f', 'y420' or
+/// 'f420'). The range follows the YUV format, so full range buffers get full range values, unlike libyuv's ARGBToNV12
+/// which always writes video range. The kernel for the matrix, range and layout is chosen once, at init.
+@interface CustomColorConverter : NSObject
+
+@property(nonatomic, readonly) CustomColorMatrix matrix;
+@property(nonatomic, readonly) OSType sourcePixelFormat;
+@property(nonatomic, readonly) OSType destinationPixelFormat;
+
+/// nil unless exactly one of the formats is kCVPixelFormatType_32BGRA and the other one is a supported 4:2:0 format.
+- (nullable instancetype)initWithMatrix:(CustomColorMatrix)matrix
+                      sourcePixelFormat:(OSType)sourcePixelFormat
+                 destinationPixelFormat:(OSType)destinationPixelFormat;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Converts |pixelBuffer|, which must have the source format, into a buffer from +[CustomPixelBufferPool sharedPool].
+/// Note: This function pass ownership of return value(CVPixelBufferRef) to the caller.
+- (nullable CVPixelBufferRef)convertPixelBuffer:(CVPixelBufferRef)pixelBuffer CF_RETURNS_RETAINED;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,102 @@
+//
+//  CustomColorConverter.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/28.
+//
+
+#import "CustomColorConverter.h"
+#import "CustomPixelBufferPool.h"
+#import "CustomPixelBufferUtils.h"
+
+#include "ColorConvert.h"
+
+namespace {
+
+constexpr OSType kI420FullRange = kCVPixelFormatType_420YpCbCr8PlanarFullRange;
+
+bool LayoutOfPixelFormat(OSType format, custom::PixelLayout *layout, custom::YuvRange *range) {
+    switch (format) {
+        case kCVPixelFormatType_32BGRA:
+            *layout = custom::PixelLayout::kBGRA;
+            return true;
+        case kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange:
+            *layout = custom::PixelLayout::kNV12;
+            *range = custom::YuvRange::kVideo;
+            return true;
+        case kCVPixelFormatType_420YpCbCr8BiPlanarFullRange:
+            *layout = custom::PixelLayout::kNV12;
+            *range = custom::YuvRange::kFull;
+            return true;
+        case kCVPixelFormatType_420YpCbCr8Planar:
+            *layout = custom::PixelLayout::kI420;
+            *range = custom::YuvRange::kVideo;
+            return true;
+        case kI420FullRange:
+            *layout = custom::PixelLayout::kI420;
+            *range = custom::YuvRange::kFull;
+            return true;
+        default:
+            return false;
+    }
+}
+
+}  // namespace
+
+@implementation CustomColorConverter {
+    custom::ColorConversion _conversion;
+}
+
+- (nullable instancetype)initWithMatrix:(CustomColorMatrix)matrix
+                      sourcePixelFormat:(OSType)sourcePixelFormat
+                 destinationPixelFormat:(OSType)destinationPixelFormat {
+    custom::PixelLayout sourceLayout, destinationLayout;
+    custom::YuvRange range = custom::YuvRange::kVideo;
+    if (matrix < CustomColorMatrixBT601 || matrix > CustomColorMatrixBT2020 ||
+        !LayoutOfPixelFormat(sourcePixelFormat, &sourceLayout, &range) ||
+        !LayoutOfPixelFormat(destinationPixelFormat, &destinationLayout, &range)) {
+        return nil;
+    }
+    custom::ColorConversion conversion =
+        custom::ColorConversion::Select((custom::YuvMatrix)matrix, range, sourceLayout, destinationLayout);
+    if (!conversion.valid()) {
+        return nil;
+    }
+    if (self = [super init]) {
+        _matrix = matrix;
+        _sourcePixelFormat = sourcePixelFormat;
+        _destinationPixelFormat = destinationPixelFormat;
+        _conversion = conversion;
+        DLog(@"CustomColorConverter: %s -> %s (%s)", custom::PixelLayoutName(sourceLayout),
+             custom::PixelLayoutName(destinationLayout), custom::SimdPathName(conversion.path()));
+    }
+    return self;
+}
+
+- (nullable CVPixelBufferRef)convertPixelBuffer:(CVPixelBufferRef)pixelBuffer CF_RETURNS_RETAINED {
+    if (CVPixelBufferGetPixelFormatType(pixelBuffer) != _sourcePixelFormat) {
+        DLog(@"CustomColorConverter: unexpected pixel format %u", (unsigned)CVPixelBufferGetPixelFormatType(pixelBuffer));
+        return nil;
+    }
+    const CGSize size = CGSizeMake(CVPixelBufferGetWidth(pixelBuffer), CVPixelBufferGetHeight(pixelBuffer));
+    CVPixelBufferRef targetPixelBuffer = [[CustomPixelBufferPool sharedPool] createPixelBuffer:_destinationPixelFormat targetSize:size];
+    if (!targetPixelBuffer) {
+        return nil;
+    }
+
+    CVPixelBufferLockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+    CVPixelBufferLockBaseAddress(targetPixelBuffer, 0);
+    const bool success = _conversion.Convert(
+        [CustomPixelBufferUtils colorImageOfPixelBuffer:pixelBuffer layout:_conversion.src_layout()],
+        [CustomPixelBufferUtils colorImageOfPixelBuffer:targetPixelBuffer layout:_conversion.dst_layout()]);
+    CVPixelBufferUnlockBaseAddress(targetPixelBuffer, 0);
+    CVPixelBufferUnlockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+
+    if (!success) {
+        CVPixelBufferRelease(targetPixelBuffer);
+        return nil;
+    }
+    return targetPixelBuffer;
+}
+
+@end
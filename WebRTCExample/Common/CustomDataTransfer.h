@@ -0,0 +1,87 @@
+//
+//  CustomDataTransfer.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/13.
+//
+
+#import <Foundation/Foundation.h>
+#import <WebRTC/RTCDataChannel.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Receives a message, on the transfer's queue. |data| doesn't copy the received frames; keep it as long as needed.
+typedef void (^CustomDataTransferHandler)(NSData *data, uint16_t stream);
+
+/// Binary messages of any size over an RTCDataChannel, with custom::BulkSender and custom::BulkReceiver: a message is
+/// sent as framed chunks while the channel's bufferedAmount stays under windowBytes, so a large one neither fails the
+/// channel's max message size nor queues seconds of data in SCTP, and one sent before the channel opens waits for it.
+/// Received chunks are reassembled into pooled buffers.
+///
+/// Framing is negotiated: both ends advertise it while connecting, e.g. with dataFrames in their offer and answer, and
+/// framed is set once both did. Until then messages are sent whole, as plain binary or text messages, and binary
+/// messages received are handed over as they are, on stream 0, so a peer without this works as it did.
+///
+/// Streams are independent queues multiplexed over the one channel a chunk at a time, by strict priority and, within a
+/// priority, weighted round robin, so a small message on an urgent stream overtakes a bulk transfer in progress.
+///
+/// Doesn't become the channel's delegate: forward binary buffers to receiveBuffer:, and bufferedAmount changes and the
+/// channel opening to bufferedAmountDidChange. Thread safe; the work happens on a private serial queue.
+@interface CustomDataTransfer : NSObject
+
+/// The channel messages are sent on, nil while there is none; queued messages wait for one to open.
+@property(atomic, strong, nullable) RTCDataChannel *dataChannel;
+
+/// Whether both ends advertised framing. Set it before the channel opens, from the peer's offer or answer: it decides
+/// how the messages sent from then on go out and how every binary message received is read. Defaults to NO.
+@property(atomic, assign) BOOL framed;
+
+/// The send window. Sending stops at this bufferedAmount and resumes once a quarter of it is left; priority 0 streams
+/// may go 64 KiB past it. A message on one of those waits about windowBytes over the link rate under bulk load.
+/// Defaults to 256 KiB.
+@property(atomic, assign) NSUInteger windowBytes;
+/// sendData:onStream: refuses messages past this many bytes waiting to be sent. Defaults to 64 MiB.
+@property(atomic, assign) NSUInteger maxQueuedBytes;
+
+@property(atomic, copy, nullable) CustomDataTransferHandler handler;
+
+@property(atomic, readonly) uint64_t sentMessageCount;
+@property(atomic, readonly) uint64_t sentBytes;
+/// Payload rate from the first frame sent to the last.
+@property(atomic, readonly) double sendMbps;
+/// Time from sendData:onStream: to the last chunk of a message being handed to the channel.
+@property(atomic, readonly) double averageSendLatencyMs;
+/// Times the window filled.
+@property(atomic, readonly) uint64_t stallCount;
+
+@property(atomic, readonly) uint64_t receivedMessageCount;
+@property(atomic, readonly) uint64_t receivedBytes;
+@property(atomic, readonly) double receiveMbps;
+/// Time from the first to the last chunk of a message arriving.
+@property(atomic, readonly) double averageReassemblyMs;
+/// Received messages that reused a pooled buffer.
+@property(atomic, readonly) uint64_t poolHitCount;
+
+/// Streams of a lower |priority| send first, streams of the same one share the channel in proportion to |weight|.
+/// Streams not set have priority 1 and weight 1.
+- (void)setPriority:(uint8_t)priority weight:(uint32_t)weight forStream:(uint16_t)stream;
+
+/// Whether the messages of |stream| are UTF-8 text. Until framed is set they go out as text messages, which a peer
+/// without framing receives as strings; framed, they are chunks like any other. Streams not set are binary.
+- (void)setSendsText:(BOOL)text forStream:(uint16_t)stream;
+
+/// Queues |data| on |stream| and sends what the window allows. Returns NO if more than maxQueuedBytes would wait.
+- (BOOL)sendData:(NSData *)data onStream:(uint16_t)stream;
+
+/// A binary buffer received on any channel: a frame if framed is set, otherwise a whole message for stream 0.
+- (void)receiveBuffer:(RTCDataBuffer *)buffer;
+
+/// Sends what the window allows. Call it from dataChannel:didChangeBufferedAmount: and when the channel opens.
+- (void)bufferedAmountDidChange;
+
+/// Drops the messages waiting to be sent and half received, e.g. when the channel closed.
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
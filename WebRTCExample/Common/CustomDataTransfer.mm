@@ -0,0 +1,282 @@
+//
+//  CustomDataTransfer.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/13.
+//
+
+#import "CustomDataTransfer.h"
+
+#include <atomic>
+#include <limits>
+#include <memory>
+
+#include "BulkTransfer.h"
+#include "StageTrace.h"
+
+namespace {
+
+const NSUInteger kDefaultWindowBytes = 256 << 10;
+const NSUInteger kDefaultMaxQueuedBytes = 64 << 20;
+
+}  // namespace
+
+@implementation CustomDataTransfer {
+    dispatch_queue_t _queue;
+    // Only used on _queue.
+    std::unique_ptr<custom::BulkSender> _sender;
+    std::unique_ptr<custom::BulkReceiver> _receiver;
+    // The buffer being passed to _receiver, which single frame messages are handed over as a part of.
+    NSData *_frame;
+    // Bytes passed to sendData:onStream: and not sent or dropped yet; reserved before the message reaches _queue.
+    std::atomic<uint64_t> _queuedBytes;
+    uint64_t _sentBytesCounted;
+    std::atomic<uint64_t> _sentMessageCount;
+    std::atomic<uint64_t> _sentBytes;
+    std::atomic<double> _sendMbps;
+    std::atomic<int64_t> _sendLatencySumNs;
+    std::atomic<uint64_t> _stallCount;
+    std::atomic<uint64_t> _receivedMessageCount;
+    std::atomic<uint64_t> _receivedBytes;
+    std::atomic<double> _receiveMbps;
+    std::atomic<int64_t> _reassemblyLatencySumNs;
+    std::atomic<uint64_t> _poolHitCount;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _queue = dispatch_queue_create("com.custom.datatransfer", DISPATCH_QUEUE_SERIAL);
+        _windowBytes = kDefaultWindowBytes;
+        _maxQueuedBytes = kDefaultMaxQueuedBytes;
+        _queuedBytes = 0;
+        _sentBytesCounted = 0;
+        _sentMessageCount = 0;
+        _sentBytes = 0;
+        _sendMbps = 0;
+        _sendLatencySumNs = 0;
+        _stallCount = 0;
+        _receivedMessageCount = 0;
+        _receivedBytes = 0;
+        _receiveMbps = 0;
+        _reassemblyLatencySumNs = 0;
+        _poolHitCount = 0;
+
+        // maxQueuedBytes is enforced by sendData:onStream: itself.
+        custom::BulkSenderConfig config;
+        config.max_queued_bytes = std::numeric_limits<size_t>::max();
+        __weak CustomDataTransfer *weakSelf = self;
+        _sender = std::make_unique<custom::BulkSender>(
+            config, [weakSelf](const uint8_t *frame, size_t size, bool text) {
+                return (bool)[weakSelf sendFrame:frame size:size text:text];
+            });
+        _receiver = std::make_unique<custom::BulkReceiver>(
+            custom::BulkReceiverConfig(),
+            [weakSelf](const custom::ReceivedMessage &message) { [weakSelf handOverMessage:message]; });
+    }
+    return self;
+}
+
+- (uint64_t)sentMessageCount {
+    return _sentMessageCount.load();
+}
+
+- (uint64_t)sentBytes {
+    return _sentBytes.load();
+}
+
+- (double)sendMbps {
+    return _sendMbps.load();
+}
+
+- (double)averageSendLatencyMs {
+    const uint64_t messages = _sentMessageCount.load();
+    return messages ? _sendLatencySumNs.load() / 1e6 / messages : 0;
+}
+
+- (uint64_t)stallCount {
+    return _stallCount.load();
+}
+
+- (uint64_t)receivedMessageCount {
+    return _receivedMessageCount.load();
+}
+
+- (uint64_t)receivedBytes {
+    return _receivedBytes.load();
+}
+
+- (double)receiveMbps {
+    return _receiveMbps.load();
+}
+
+- (double)averageReassemblyMs {
+    const uint64_t messages = _receivedMessageCount.load();
+    return messages ? _reassemblyLatencySumNs.load() / 1e6 / messages : 0;
+}
+
+- (uint64_t)poolHitCount {
+    return _poolHitCount.load();
+}
+
+- (void)setPriority:(uint8_t)priority weight:(uint32_t)weight forStream:(uint16_t)stream {
+    dispatch_async(_queue, ^{
+        custom::StreamConfig config = self->_sender->stream_config(stream);
+        config.priority = priority;
+        config.weight = weight;
+        self->_sender->SetStreamConfig(stream, config);
+    });
+}
+
+- (void)setSendsText:(BOOL)text forStream:(uint16_t)stream {
+    dispatch_async(_queue, ^{
+        custom::StreamConfig config = self->_sender->stream_config(stream);
+        config.text = text;
+        self->_sender->SetStreamConfig(stream, config);
+    });
+}
+
+- (BOOL)sendData:(NSData *)data onStream:(uint16_t)stream {
+    const uint64_t size = data.length;
+    if (_queuedBytes.fetch_add(size) + size > self.maxQueuedBytes) {
+        _queuedBytes -= size;
+        return NO;
+    }
+    // The sender reads the bytes in place; the block keeps them alive until the last chunk is sent.
+    NSData *message = [data copy];
+    std::shared_ptr<const void> owner(message.bytes, [message](const void *) {});
+    dispatch_async(_queue, ^{
+        if (!self->_sender->Enqueue(stream, static_cast<const uint8_t *>(message.bytes), size, owner,
+                                    custom::TraceNowNs())) {
+            self->_queuedBytes -= size;
+            return;
+        }
+        [self pump];
+    });
+    return YES;
+}
+
+- (void)receiveBuffer:(RTCDataBuffer *)buffer {
+    NSData *data = buffer.data;
+    dispatch_async(_queue, ^{
+        if (!self.framed) {
+            // The peer doesn't frame its messages.
+            CustomDataTransferHandler handler = self.handler;
+            if (handler) {
+                handler(data, 0);
+            }
+            return;
+        }
+        self->_frame = data;
+        if (!self->_receiver->OnFrame(static_cast<const uint8_t *>(data.bytes), data.length, custom::TraceNowNs())) {
+            DLog(@"CustomDataTransfer: dropped a frame, %s", self->_receiver->error());
+        }
+        self->_frame = nil;
+        [self updateReceiveCounts];
+    });
+}
+
+- (void)bufferedAmountDidChange {
+    dispatch_async(_queue, ^{
+        [self pump];
+    });
+}
+
+- (void)reset {
+    dispatch_async(_queue, ^{
+        self->_queuedBytes -= self->_sender->queued_bytes();
+        self->_sender->Clear();
+        self->_receiver->Reset();
+        DLog(@"CustomDataTransfer: sent %llu messages at %.1f Mbps, %.1f ms each, %llu stalls; received %llu at %.1f "
+             @"Mbps, %.1f ms reassembly, %llu pool hits",
+             self.sentMessageCount, self.sendMbps, self.averageSendLatencyMs, self.stallCount,
+             self.receivedMessageCount, self.receiveMbps, self.averageReassemblyMs, self.poolHitCount);
+    });
+}
+
+#pragma mark - Private
+
+// On _queue.
+- (void)pump {
+    RTCDataChannel *channel = self.dataChannel;
+    if (!channel || channel.readyState != RTCDataChannelStateOpen) {
+        return;
+    }
+    custom::BulkSenderConfig config = _sender->config();
+    config.high_water = MAX(self.windowBytes, (NSUInteger)1);
+    config.low_water = config.high_water / 4;
+    config.framed = self.framed;
+    _sender->set_config(config);
+    _sender->Pump(channel.bufferedAmount, custom::TraceNowNs());
+    [self updateSendCounts];
+}
+
+// On _queue, from the sender's send function; |frame| is a whole message if the sender doesn't frame, sent as text
+// if |text|.
+- (BOOL)sendFrame:(const uint8_t *)frame size:(size_t)size text:(BOOL)text {
+    RTCDataChannel *channel = self.dataChannel;
+    if (!channel || channel.readyState != RTCDataChannelStateOpen) {
+        return NO;
+    }
+    // RTCDataBuffer copies the bytes, a view of the sender's frame or the message is enough.
+    NSData *data = [NSData dataWithBytesNoCopy:(void *)frame length:size freeWhenDone:NO];
+    if ([channel sendData:[[RTCDataBuffer alloc] initWithData:data isBinary:!text]]) {
+        return YES;
+    }
+    if (!_sender->config().framed) {
+        // A whole message the open channel refuses, e.g. one past the peer's max message size, won't go later either;
+        // retrying it would hold up every message behind it.
+        DLog(@"CustomDataTransfer: dropped a %zu byte message the channel refused", size);
+        return YES;
+    }
+    return NO;
+}
+
+// On _queue, from the receiver's deliver function.
+- (void)handOverMessage:(const custom::ReceivedMessage &)message {
+    CustomDataTransferHandler handler = self.handler;
+    if (!handler) {
+        return;
+    }
+    NSData *data = nil;
+    if (message.buffer) {
+        std::shared_ptr<custom::MessageBuffer> buffer = message.buffer;
+        data = [[NSData alloc] initWithBytesNoCopy:(void *)message.data
+                                            length:message.size
+                                       deallocator:^(void *, NSUInteger) {
+                                           // Returns the buffer to the pool.
+                                           (void)buffer;
+                                       }];
+    } else {
+        NSData *frame = _frame;
+        data = [[NSData alloc] initWithBytesNoCopy:(void *)message.data
+                                            length:message.size
+                                       deallocator:^(void *, NSUInteger) {
+                                           (void)frame;
+                                       }];
+    }
+    handler(data, message.stream);
+}
+
+// On _queue.
+- (void)updateSendCounts {
+    const custom::BulkSenderStats &stats = _sender->stats();
+    _queuedBytes -= stats.bytes - _sentBytesCounted;
+    _sentBytesCounted = stats.bytes;
+    _sentMessageCount = stats.messages;
+    _sentBytes = stats.bytes;
+    _sendMbps = stats.bytes_per_second() * 8 / 1e6;
+    _sendLatencySumNs = stats.latency_sum_ns;
+    _stallCount = stats.stalls;
+}
+
+// On _queue.
+- (void)updateReceiveCounts {
+    const custom::BulkReceiverStats &stats = _receiver->stats();
+    _receivedMessageCount = stats.messages;
+    _receivedBytes = stats.bytes;
+    _receiveMbps = stats.bytes_per_second() * 8 / 1e6;
+    _reassemblyLatencySumNs = stats.latency_sum_ns;
+    _poolHitCount = _receiver->pool().stats().hits;
+}
+
+@end
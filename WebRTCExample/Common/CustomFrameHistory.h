@@ -0,0 +1,46 @@
+//
+//  CustomFrameHistory.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/5.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreVideo/CoreVideo.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// The last few pixel buffers of a stream with their timestamps, for temporal filters on the CPU or in shaders.
+/// Buffers are retained, never copied: a buffer handed out stays valid, and keeps its pool slot, until it is released,
+/// even after it falls out of the history. Buffers from CustomPixelBufferPool are IOSurface backed and can be bound as
+/// textures through the texture caches. Wraps custom::FrameHistory. Thread safe.
+@interface CustomFrameHistory : NSObject
+
+/// Number of buffers held, at most capacity.
+@property(nonatomic, readonly) NSUInteger count;
+@property(nonatomic, readonly) NSUInteger capacity;
+
+/// |capacity| is clamped to [1, 8].
+- (instancetype)initWithCapacity:(NSUInteger)capacity NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Adds the newest buffer, retaining it, and releases the oldest one if the history is full.
+- (void)pushPixelBuffer:(CVPixelBufferRef)pixelBuffer timeStampNs:(int64_t)timeStampNs;
+
+/// The buffer |age| frames back, 0 being the newest, or NULL past the oldest. |timeStampNs| may be NULL.
+/// Note: This function pass ownership of return value(CVPixelBufferRef) to the caller. The buffer is retained, not
+/// copied.
+- (nullable CVPixelBufferRef)copyPixelBufferAtAge:(NSUInteger)age timeStampNs:(nullable int64_t *)timeStampNs CF_RETURNS_RETAINED;
+
+/// The buffer whose timestamp is closest to |timeStampNs|, if it is within |toleranceNs|. The newer of two equally
+/// close buffers wins.
+/// Note: This function pass ownership of return value(CVPixelBufferRef) to the caller.
+- (nullable CVPixelBufferRef)copyPixelBufferNearestTimeStampNs:(int64_t)timeStampNs
+                                                   toleranceNs:(int64_t)toleranceNs CF_RETURNS_RETAINED;
+
+/// Releases every buffer, e.g. on a scene cut or a format change.
+- (void)clear;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,79 @@
+//
+//  CustomFrameHistory.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/5.
+//
+
+#import "CustomFrameHistory.h"
+
+#include <memory>
+#include <mutex>
+
+#include "FrameHistory.h"
+
+namespace {
+
+struct PixelBufferDeleter {
+    void operator()(CVPixelBufferRef pixelBuffer) const {
+        CVPixelBufferRelease(pixelBuffer);
+    }
+};
+
+typedef custom::FrameHistory<__CVBuffer> PixelBufferHistory;
+
+CVPixelBufferRef RetainedPixelBuffer(const std::shared_ptr<__CVBuffer> &frame) {
+    return frame ? CVPixelBufferRetain(frame.get()) : NULL;
+}
+
+}  // namespace
+
+@implementation CustomFrameHistory {
+    std::mutex _mutex;
+    std::unique_ptr<PixelBufferHistory> _history;
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    if (self = [super init]) {
+        _history = std::make_unique<PixelBufferHistory>(capacity);
+    }
+    return self;
+}
+
+- (NSUInteger)count {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _history->size();
+}
+
+- (NSUInteger)capacity {
+    return _history->capacity();
+}
+
+- (void)pushPixelBuffer:(CVPixelBufferRef)pixelBuffer timeStampNs:(int64_t)timeStampNs {
+    std::shared_ptr<__CVBuffer> frame(CVPixelBufferRetain(pixelBuffer), PixelBufferDeleter());
+    // The displaced buffer is released here, outside the lock.
+    std::shared_ptr<__CVBuffer> oldest;
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_history->size() == _history->capacity()) {
+        oldest = _history->At(_history->size() - 1);
+    }
+    _history->Push(timeStampNs, std::move(frame));
+}
+
+- (nullable CVPixelBufferRef)copyPixelBufferAtAge:(NSUInteger)age timeStampNs:(nullable int64_t *)timeStampNs CF_RETURNS_RETAINED {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return RetainedPixelBuffer(_history->At(age, timeStampNs));
+}
+
+- (nullable CVPixelBufferRef)copyPixelBufferNearestTimeStampNs:(int64_t)timeStampNs
+                                                   toleranceNs:(int64_t)toleranceNs CF_RETURNS_RETAINED {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return RetainedPixelBuffer(_history->Nearest(timeStampNs, toleranceNs));
+}
+
+- (void)clear {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _history->Clear();
+}
+
+@end
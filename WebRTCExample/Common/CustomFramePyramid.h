@@ -0,0 +1,30 @@
+//
+//  CustomFramePyramid.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/1.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreVideo/CoreVideo.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Produces the 1/2 and 1/4 scale layers of processed NV12 frames, e.g. for simulcast. Both layers are built in one
+/// pass over the source and live in one allocation from the pyramid's own pool, which is recycled once every layer
+/// buffer has been released. Layer buffers are not IOSurface backed.
+@interface CustomFramePyramid : NSObject
+
+/// Layers built so far.
+@property(nonatomic, readonly) uint64_t builtCount;
+
+/// Builds the layers of |pixelBuffer| ('420f' or '420v', at least 4x4). Returns the CVPixelBufferRefs of the 1/2 and
+/// 1/4 layer in that order, in the format of |pixelBuffer|, or nil for unsupported buffers.
+- (nullable NSArray *)layersOfPixelBuffer:(CVPixelBufferRef)pixelBuffer;
+
+/// Frees idle pyramid buffers.
+- (void)flush;
+
+@end
+
+NS_ASSUME_NONNULL_END
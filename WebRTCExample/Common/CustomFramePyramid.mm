@@ -0,0 +1,90 @@
+//
+//  CustomFramePyramid.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/1.
+//
+
+#import "CustomFramePyramid.h"
+
+#include <atomic>
+#include <memory>
+
+#include "FramePyramid.h"
+
+namespace {
+
+void ReleasePyramidBuffer(void *releaseRefCon, const void *, size_t, size_t, const void **) {
+    delete static_cast<std::shared_ptr<custom::FrameBuffer> *>(releaseRefCon);
+}
+
+// Wraps |layer| in a CVPixelBuffer that keeps |buffer| alive.
+CVPixelBufferRef CreateLayerPixelBuffer(const custom::PyramidLayer &layer,
+                                        OSType format,
+                                        const std::shared_ptr<custom::FrameBuffer> &buffer) {
+    void *planes[2] = {layer.y, layer.uv};
+    size_t widths[2] = {(size_t)layer.width, (size_t)(layer.width + 1) / 2};
+    size_t heights[2] = {(size_t)layer.height, (size_t)(layer.height + 1) / 2};
+    size_t bytesPerRow[2] = {(size_t)layer.stride_y, (size_t)layer.stride_uv};
+    auto *reference = new std::shared_ptr<custom::FrameBuffer>(buffer);
+    CVPixelBufferRef pixelBuffer = NULL;
+    CVReturn status = CVPixelBufferCreateWithPlanarBytes(kCFAllocatorDefault, layer.width, layer.height, format, NULL, 0,
+                                                         2, planes, widths, heights, bytesPerRow,
+                                                         ReleasePyramidBuffer, reference, NULL, &pixelBuffer);
+    if (status != kCVReturnSuccess) {
+        DLog(@"CustomFramePyramid: CVPixelBufferCreateWithPlanarBytes failed: %d", status);
+        delete reference;
+        return NULL;
+    }
+    return pixelBuffer;
+}
+
+}  // namespace
+
+@implementation CustomFramePyramid {
+    custom::FrameBufferPool _pool;
+    std::atomic<uint64_t> _builtCount;
+}
+
+- (uint64_t)builtCount {
+    return _builtCount.load(std::memory_order_relaxed);
+}
+
+- (nullable NSArray *)layersOfPixelBuffer:(CVPixelBufferRef)pixelBuffer {
+    const OSType format = CVPixelBufferGetPixelFormatType(pixelBuffer);
+    if (CVPixelBufferGetPlaneCount(pixelBuffer) != 2) {
+        return nil;
+    }
+
+    custom::NV12Pyramid pyramid;
+    CVPixelBufferLockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+    const bool success = custom::BuildNV12Pyramid((const uint8_t *)CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 0),
+                                                  (int)CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 0),
+                                                  (const uint8_t *)CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, 1),
+                                                  (int)CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, 1),
+                                                  (int)CVPixelBufferGetWidth(pixelBuffer),
+                                                  (int)CVPixelBufferGetHeight(pixelBuffer),
+                                                  format, &_pool, &pyramid);
+    CVPixelBufferUnlockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+    if (!success) {
+        DLog(@"CustomFramePyramid: can't build layers of pixel format %u", (unsigned)format);
+        return nil;
+    }
+
+    NSMutableArray *layers = [NSMutableArray arrayWithCapacity:custom::kPyramidLayerCount];
+    for (const custom::PyramidLayer &layer : pyramid.layers) {
+        CVPixelBufferRef layerBuffer = CreateLayerPixelBuffer(layer, format, pyramid.buffer);
+        if (!layerBuffer) {
+            return nil;
+        }
+        [layers addObject:(__bridge_transfer id)layerBuffer];
+    }
+    _builtCount.fetch_add(1, std::memory_order_relaxed);
+    return layers;
+}
+
+- (void)flush {
+    _pool.Flush();
+}
+
+@end
@@ -0,0 +1,47 @@
+//
+//  CustomFrameScheduler.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/22.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, CustomFrameAdmission) {
+    /// Skipped, it would have finished over the latency budget.
+    CustomFrameAdmissionRejected,
+    /// Stored in the empty mailbox, a worker has to pick it up.
+    CustomFrameAdmissionQueued,
+    /// Replaced a frame no worker had picked up yet; that worker takes this one instead.
+    CustomFrameAdmissionReplaced,
+};
+
+/// Admission control between the capturer and a ProcessPixelBufferProtocol. Frames that would finish over the latency
+/// budget, judging by the moving average processing time, are skipped; the others go through a latest-wins mailbox so
+/// the worker always processes the freshest frame. One capture thread offers frames, one worker takes them.
+@interface CustomFrameScheduler : NSObject
+
+/// Frames let through, skipped on arrival, let through but replaced before a worker took them, and finished over budget
+/// during the last full second. Frames let through are either processed or replaced.
+@property(nonatomic, readonly) NSUInteger admittedPerSecond;
+@property(nonatomic, readonly) NSUInteger droppedPerSecond;
+@property(nonatomic, readonly) NSUInteger replacedPerSecond;
+@property(nonatomic, readonly) NSUInteger latePerSecond;
+@property(nonatomic, readonly) double averageProcessingTimeMs;
+
+/// |latencyBudgetMs| is the longest acceptable time from a frame's arrival to the end of its processing.
+- (instancetype)initWithLatencyBudgetMs:(double)latencyBudgetMs;
+
+- (CustomFrameAdmission)offerFrame:(id)frame;
+
+/// Takes the latest frame and marks the worker busy, nil if there is none.
+- (nullable id)takeFrame;
+
+/// Marks the frame returned by the last -takeFrame as processed.
+- (void)didFinishFrame;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,95 @@
+//
+//  CustomFrameScheduler.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/22.
+//
+
+#import "CustomFrameScheduler.h"
+
+#include <chrono>
+#include <memory>
+
+#include "FrameScheduler.h"
+#include "LatestFrameMailbox.h"
+
+namespace {
+
+int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+custom::FrameSchedulerConfig MakeConfig(double latencyBudgetMs) {
+    custom::FrameSchedulerConfig config;
+    config.latency_budget_ns = static_cast<int64_t>(latencyBudgetMs * 1e6);
+    return config;
+}
+
+}  // namespace
+
+@implementation CustomFrameScheduler {
+    std::unique_ptr<custom::FrameScheduler> _scheduler;
+    custom::LatestFrameMailbox<id> _mailbox;
+    // Arrival time of the frame the worker is processing.
+    int64_t _takenArrivalNs;
+}
+
+- (instancetype)init {
+    return [self initWithLatencyBudgetMs:custom::FrameSchedulerConfig().latency_budget_ns / 1e6];
+}
+
+- (instancetype)initWithLatencyBudgetMs:(double)latencyBudgetMs {
+    if (self = [super init]) {
+        _scheduler = std::make_unique<custom::FrameScheduler>(MakeConfig(latencyBudgetMs));
+    }
+    return self;
+}
+
+- (NSUInteger)admittedPerSecond {
+    return _scheduler->LastSecond().admitted;
+}
+
+- (NSUInteger)droppedPerSecond {
+    return _scheduler->LastSecond().dropped;
+}
+
+- (NSUInteger)replacedPerSecond {
+    return _scheduler->LastSecond().replaced;
+}
+
+- (NSUInteger)latePerSecond {
+    return _scheduler->LastSecond().late;
+}
+
+- (double)averageProcessingTimeMs {
+    return _scheduler->average_processing_ns() / 1e6;
+}
+
+- (CustomFrameAdmission)offerFrame:(id)frame {
+    const int64_t now = NowNs();
+    if (!_scheduler->Admit(now)) {
+        return CustomFrameAdmissionRejected;
+    }
+    if (_mailbox.Put(frame, now)) {
+        _scheduler->OnReplaced(now);
+        return CustomFrameAdmissionReplaced;
+    }
+    return CustomFrameAdmissionQueued;
+}
+
+- (nullable id)takeFrame {
+    id frame = nil;
+    int64_t arrivalNs = 0;
+    if (!_mailbox.Take(&frame, &arrivalNs)) {
+        return nil;
+    }
+    _takenArrivalNs = arrivalNs;
+    _scheduler->OnProcessingStarted(NowNs());
+    return frame;
+}
+
+- (void)didFinishFrame {
+    _scheduler->OnProcessingFinished(_takenArrivalNs, NowNs());
+}
+
+@end
@@ -0,0 +1,56 @@
+//
+//  CustomGLResources.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/4.
+//
+
+#import <Foundation/Foundation.h>
+#import <OpenGLES/EAGL.h>
+#import <OpenGLES/ES3/gl.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// GL objects shared by every shader drawing in one sharegroup: programs keyed by their sources, one static vertex
+/// buffer holding the fullscreen quad in all four rotations, and sampler objects. Objects are reference counted and
+/// deleted once their last user releases them. Wraps custom::GLResourceRegistry.
+///
+/// All methods except the reports need a context of the sharegroup current.
+@interface CustomGLResources : NSObject
+
+/// Called for a newly created program, in use. Returns NO to reject it, e.g. if a uniform is missing.
+typedef BOOL (^CustomProgramSetup)(GLuint program);
+
+/// The resources of |context|'s sharegroup, created on first use. Users keep a strong reference while they hold
+/// objects from it.
++ (CustomGLResources *)resourcesForContext:(EAGLContext *)context;
+
+/// Object counts, references and estimated memory of every live sharegroup.
++ (NSString *)reportForAllContexts;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Returns the program linking the given sources, creating it through CustomShaderUtil, and so CustomProgramCache, if
+/// this sharegroup has none. |setup| runs once, on creation. Returns 0 on error.
+- (GLuint)acquireProgramWithVertexShaderSource:(const char [_Nonnull])vertexShaderSource
+                          fragmentShaderSource:(const char [_Nonnull])fragmentShaderSource
+                                         setup:(nullable CustomProgramSetup)setup;
+
+/// Returns the vertex buffer with the quads of all four rotations, see custom::FillRotatedQuadVertices. Draw the
+/// quad of a rotation with glDrawArrays(GL_TRIANGLE_FAN, firstVertex, 4). Returns 0 on error.
+- (GLuint)acquireQuadVertexBuffer;
+
+/// Returns a linear, clamp to edge sampler object. Samplers need OpenGL ES 3; returns 0 in other contexts.
+- (GLuint)acquireLinearSampler;
+
+/// Drop a reference taken by the matching acquire method. 0 is ignored.
+- (void)releaseProgram:(GLuint)program;
+- (void)releaseVertexBuffer:(GLuint)vertexBuffer;
+- (void)releaseSampler:(GLuint)sampler;
+
+/// Object counts, references and estimated memory of this sharegroup.
+- (NSString *)report;
+
+@end
+
+NS_ASSUME_NONNULL_END
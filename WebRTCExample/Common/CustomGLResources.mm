@@ -0,0 +1,209 @@
+//
+//  CustomGLResources.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/4.
+//
+
+#import "CustomGLResources.h"
+#import "CustomShaderUtil.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "GLResourceRegistry.h"
+#include "ProgramBinaryCache.h"
+
+namespace {
+
+// Keys of the objects that aren't programs.
+const uint64_t kQuadVertexBufferKey = 1;
+const uint64_t kLinearSamplerKey = 1;
+
+void DeleteObject(custom::GLResourceKind kind, GLuint name) {
+    switch (kind) {
+        case custom::GLResourceKind::kProgram:
+            glDeleteProgram(name);
+            break;
+        case custom::GLResourceKind::kVertexBuffer:
+            glDeleteBuffers(1, &name);
+            break;
+        case custom::GLResourceKind::kSampler:
+            glDeleteSamplers(1, &name);
+            break;
+    }
+}
+
+}  // namespace
+
+@implementation CustomGLResources {
+    custom::GLResourceRegistry _registry;
+    /*Objects are deleted through a context of this sharegroup. Once it is gone the objects went with it.*/
+    __weak EAGLSharegroup *_sharegroup;
+    EAGLRenderingAPI _API;
+}
+
+/// Live resources by sharegroup, neither side retained.
++ (NSMapTable<EAGLSharegroup *, CustomGLResources *> *)allResources {
+    static NSMapTable<EAGLSharegroup *, CustomGLResources *> *allResources;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        allResources = [NSMapTable weakToWeakObjectsMapTable];
+    });
+    return allResources;
+}
+
++ (CustomGLResources *)resourcesForContext:(EAGLContext *)context {
+    NSMapTable<EAGLSharegroup *, CustomGLResources *> *allResources = [self allResources];
+    @synchronized (allResources) {
+        CustomGLResources *resources = [allResources objectForKey:context.sharegroup];
+        if (!resources) {
+            resources = [[CustomGLResources alloc] initWithContext:context];
+            [allResources setObject:resources forKey:context.sharegroup];
+        }
+        return resources;
+    }
+}
+
++ (NSString *)reportForAllContexts {
+    NSMapTable<EAGLSharegroup *, CustomGLResources *> *allResources = [self allResources];
+    NSMutableString *report = [NSMutableString string];
+    @synchronized (allResources) {
+        for (EAGLSharegroup *sharegroup in allResources) {
+            [report appendFormat:@"sharegroup %p:\n%@", sharegroup, [[allResources objectForKey:sharegroup] report]];
+        }
+    }
+    return report;
+}
+
+- (instancetype)initWithContext:(EAGLContext *)context {
+    if (self = [super init]) {
+        _sharegroup = context.sharegroup;
+        _API = context.API;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    auto objects = _registry.TakeAll();
+    if (objects.empty()) {
+        return;
+    }
+    [self performInSharegroup:^{
+        for (const auto &object : objects) {
+            DeleteObject(object.first, object.second);
+        }
+    }];
+}
+
+- (GLuint)acquireProgramWithVertexShaderSource:(const char [])vertexShaderSource
+                          fragmentShaderSource:(const char [])fragmentShaderSource
+                                         setup:(CustomProgramSetup)setup {
+    const uint64_t key = custom::ProgramCacheKey(vertexShaderSource, fragmentShaderSource, std::string());
+    const BOOL hasProgramBinary = _API >= kEAGLRenderingAPIOpenGLES3;
+    return _registry.Acquire(custom::GLResourceKind::kProgram, key, [&](size_t *bytes) -> uint32_t {
+        GLuint program = [CustomShaderUtil createProgramWithVertexShaderSource:vertexShaderSource fragmentShaderSource:fragmentShaderSource];
+        if (!program) {
+            return 0;
+        }
+        glUseProgram(program);
+        if (setup && !setup(program)) {
+            glDeleteProgram(program);
+            return 0;
+        }
+        // The binary size is the best estimate of the driver's memory there is.
+        GLint length = 0;
+        if (hasProgramBinary) {
+            glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        }
+        *bytes = static_cast<size_t>(length);
+        return program;
+    });
+}
+
+- (GLuint)acquireQuadVertexBuffer {
+    return _registry.Acquire(custom::GLResourceKind::kVertexBuffer, kQuadVertexBufferKey, [](size_t *bytes) -> uint32_t {
+        GLfloat vertices[custom::kRotatedQuadFloatCount];
+        custom::FillRotatedQuadVertices(vertices);
+        GLuint vertexBuffer = 0;
+        glGenBuffers(1, &vertexBuffer);
+        if (!vertexBuffer) {
+            return 0;
+        }
+        // Leaves the buffer bound, ready for the attribute setup of programs created next.
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+        *bytes = sizeof(vertices);
+        return vertexBuffer;
+    });
+}
+
+- (GLuint)acquireLinearSampler {
+    if (_API < kEAGLRenderingAPIOpenGLES3) {
+        return 0;
+    }
+    return _registry.Acquire(custom::GLResourceKind::kSampler, kLinearSamplerKey, [](size_t *bytes) -> uint32_t {
+        GLuint sampler = 0;
+        glGenSamplers(1, &sampler);
+        if (!sampler) {
+            return 0;
+        }
+        glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        *bytes = 0;
+        return sampler;
+    });
+}
+
+- (void)releaseProgram:(GLuint)program {
+    [self releaseObject:program kind:custom::GLResourceKind::kProgram];
+}
+
+- (void)releaseVertexBuffer:(GLuint)vertexBuffer {
+    [self releaseObject:vertexBuffer kind:custom::GLResourceKind::kVertexBuffer];
+}
+
+- (void)releaseSampler:(GLuint)sampler {
+    [self releaseObject:sampler kind:custom::GLResourceKind::kSampler];
+}
+
+- (NSString *)report {
+    return [NSString stringWithUTF8String:_registry.Report().ToString().c_str()];
+}
+
+#pragma mark - Private
+
+- (void)releaseObject:(GLuint)name kind:(custom::GLResourceKind)kind {
+    if (_registry.Release(kind, name)) {
+        [self performInSharegroup:^{
+            DeleteObject(kind, name);
+        }];
+    }
+}
+
+/// Runs |block| with a context of the sharegroup current. Users often release from -dealloc, where their own context
+/// may be current on another thread, so a temporary context joins the sharegroup instead.
+- (void)performInSharegroup:(void (^)(void))block {
+    EAGLContext *currentContext = [EAGLContext currentContext];
+    EAGLSharegroup *sharegroup = _sharegroup;
+    if (!sharegroup) {
+        return;
+    }
+    if (currentContext.sharegroup == sharegroup) {
+        block();
+        return;
+    }
+    EAGLContext *context = [[EAGLContext alloc] initWithAPI:_API sharegroup:sharegroup];
+    if (!context) {
+        return;
+    }
+    [EAGLContext setCurrentContext:context];
+    block();
+    glFlush();
+    [EAGLContext setCurrentContext:currentContext];
+}
+
+@end
@@ -0,0 +1,62 @@
+//
+//  CustomPathCostModel.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/6.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreVideo/CoreVideo.h>
+#import "CustomTypes.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Measured costs and the decision for one effect and frame size.
+@interface CustomPathCost : NSObject
+
+@property(nonatomic, readonly) uint64_t effectKey;
+@property(nonatomic, readonly) OSType pixelFormat;
+@property(nonatomic, readonly) int width;
+@property(nonatomic, readonly) int height;
+/// Moving averages of the processing thread's time per frame, 0 until measured.
+@property(nonatomic, readonly) double gpuCostMs;
+@property(nonatomic, readonly) double cpuCostMs;
+/// NO while both paths are still being probed.
+@property(nonatomic, readonly, getter=isDecided) BOOL decided;
+/// CustomProcessingPathGPU or CustomProcessingPathCPU.
+@property(nonatomic, readonly) CustomProcessingPath chosenPath;
+/// Frames run on each path, probes included.
+@property(nonatomic, readonly) uint64_t gpuFrameCount;
+@property(nonatomic, readonly) uint64_t cpuFrameCount;
+/// Decision changes after the first decision.
+@property(nonatomic, readonly) uint64_t switchCount;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+/// Chooses between the GPU and the CPU path per effect and frame size from measured costs. The first frames of each
+/// key alternate between the paths as a startup micro-benchmark, later frames take the cheaper one and the other path
+/// is sampled now and then. Wraps custom::PathCostModel; costs live as long as the model.
+@interface CustomPathCostModel : NSObject
+
+/// Every remembered key, most recently used first.
+@property(nonatomic, readonly) NSArray<CustomPathCost *> *costs;
+
+/// CustomProcessingPathGPU or CustomProcessingPathCPU for the next frame.
+- (CustomProcessingPath)choosePathForEffectKey:(uint64_t)effectKey pixelFormat:(OSType)pixelFormat width:(int)width height:(int)height;
+
+/// A frame took |costNs| on |path|.
+- (void)recordCostNs:(int64_t)costNs
+             forPath:(CustomProcessingPath)path
+           effectKey:(uint64_t)effectKey
+         pixelFormat:(OSType)pixelFormat
+               width:(int)width
+              height:(int)height;
+
+/// Forgets every measurement.
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
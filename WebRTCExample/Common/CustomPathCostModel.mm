@@ -0,0 +1,88 @@
+//
+//  CustomPathCostModel.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/6.
+//
+
+#import "CustomPathCostModel.h"
+
+#include "PathCostModel.h"
+
+namespace {
+
+custom::PathCostKey MakeKey(uint64_t effectKey, OSType pixelFormat, int width, int height) {
+    custom::PathCostKey key;
+    key.effect = effectKey;
+    key.format = pixelFormat;
+    key.width = width;
+    key.height = height;
+    return key;
+}
+
+CustomProcessingPath PathOf(custom::ProcessingPath path) {
+    return path == custom::ProcessingPath::kCpu ? CustomProcessingPathCPU : CustomProcessingPathGPU;
+}
+
+}  // namespace
+
+@implementation CustomPathCost
+
+- (instancetype)initWithEntry:(const custom::PathCostEntry &)entry {
+    if (self = [super init]) {
+        _effectKey = entry.key.effect;
+        _pixelFormat = entry.key.format;
+        _width = entry.key.width;
+        _height = entry.key.height;
+        _gpuCostMs = entry.gpu_ns / 1e6;
+        _cpuCostMs = entry.cpu_ns / 1e6;
+        _decided = entry.decided;
+        _chosenPath = PathOf(entry.chosen);
+        _gpuFrameCount = entry.gpu_frames;
+        _cpuFrameCount = entry.cpu_frames;
+        _switchCount = entry.switches;
+    }
+    return self;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%dx%d '%c%c%c%c' effect %016llx: gpu %.2f ms (%llu), cpu %.2f ms (%llu), %@ %@ (%llu switches)",
+            _width, _height, (char)(_pixelFormat >> 24), (char)(_pixelFormat >> 16), (char)(_pixelFormat >> 8),
+            (char)_pixelFormat, _effectKey, _gpuCostMs, _gpuFrameCount, _cpuCostMs,
+            _cpuFrameCount, _decided ? @"chose" : @"probing, using",
+            _chosenPath == CustomProcessingPathCPU ? @"cpu" : @"gpu", _switchCount];
+}
+
+@end
+
+@implementation CustomPathCostModel {
+    custom::PathCostModel _model;
+}
+
+- (NSArray<CustomPathCost *> *)costs {
+    NSMutableArray<CustomPathCost *> *costs = [NSMutableArray array];
+    for (const custom::PathCostEntry &entry : _model.Entries()) {
+        [costs addObject:[[CustomPathCost alloc] initWithEntry:entry]];
+    }
+    return costs;
+}
+
+- (CustomProcessingPath)choosePathForEffectKey:(uint64_t)effectKey pixelFormat:(OSType)pixelFormat width:(int)width height:(int)height {
+    return PathOf(_model.Choose(MakeKey(effectKey, pixelFormat, width, height)));
+}
+
+- (void)recordCostNs:(int64_t)costNs
+             forPath:(CustomProcessingPath)path
+           effectKey:(uint64_t)effectKey
+         pixelFormat:(OSType)pixelFormat
+               width:(int)width
+              height:(int)height {
+    const custom::ProcessingPath modelPath = path == CustomProcessingPathCPU ? custom::ProcessingPath::kCpu : custom::ProcessingPath::kGpu;
+    _model.Record(MakeKey(effectKey, pixelFormat, width, height), modelPath, costNs);
+}
+
+- (void)reset {
+    _model.Reset();
+}
+
+@end
@@ -0,0 +1,42 @@
+//
+//  CustomPixelBufferPool.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/14.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreVideo/CoreVideo.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Size/format keyed pool of IOSurface backed pixel buffers, the same kind as
+/// +[CustomPixelBufferUtils createEmptyPixelBuffer:targetSize:], on custom::FrameBufferPool. Every call returns a new
+/// CVPixelBuffer over a pooled IOSurface, which goes back to the pool when the last reference to that CVPixelBuffer
+/// (e.g. the one held by the WebRTC encoder) is released. Don't remove its attachments.
+@interface CustomPixelBufferPool : NSObject
+
+@property(class, nonatomic, readonly) CustomPixelBufferPool *sharedPool;
+
+/// Buffers served from a recycled IOSurface.
+@property(nonatomic, readonly) uint64_t hitCount;
+/// Buffers that needed a fresh IOSurface allocation.
+@property(nonatomic, readonly) uint64_t missCount;
+/// Buffers handed out and not released yet.
+@property(nonatomic, readonly) NSUInteger inUseCount;
+/// Largest inUseCount seen, i.e. the in flight depth steady state needs.
+@property(nonatomic, readonly) NSUInteger highWaterCount;
+
+/// Note: This function pass ownership of return value(CVPixelBufferRef) to the caller.
+- (nullable CVPixelBufferRef)createPixelBuffer:(OSType)pixelFormatType targetSize:(CGSize)targetSize CF_RETURNS_RETAINED;
+
+/// Frees the idle buffers, e.g. when the app resigns active. Buffers in use are unaffected.
+- (void)flush;
+
+/// Resets the counts; highWaterCount restarts from inUseCount.
+- (void)resetStats;
+
+@end
+
+NS_ASSUME_NONNULL_END
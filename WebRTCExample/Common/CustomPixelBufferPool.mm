@@ -0,0 +1,163 @@
+//
+//  CustomPixelBufferPool.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/14.
+//
+
+#import "CustomPixelBufferPool.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "FrameBufferPool.h"
+
+namespace {
+
+// Attachment of every buffer handed out, owning its pool buffer.
+const CFStringRef kLeaseAttachmentKey = CFSTR("com.custom.pixelbufferpool.lease");
+
+// Pool buffers are IOSurfaces; a CVPixelBuffer is only created to allocate one and read its plane layout.
+custom::FrameBufferAllocator IOSurfaceAllocator() {
+    custom::FrameBufferAllocator allocator;
+    allocator.allocate = [](custom::FrameBuffer *buffer) -> size_t {
+        const custom::FrameBufferKey &key = buffer->key;
+        NSDictionary *pixelBufferAttributes = @{
+            (id)kCVPixelBufferIOSurfacePropertiesKey: @{},
+        };
+        CVPixelBufferRef pixelBuffer = NULL;
+        CVReturn status = CVPixelBufferCreate(kCFAllocatorDefault, key.width, key.height, key.format,
+                                              (__bridge CFDictionaryRef)pixelBufferAttributes, &pixelBuffer);
+        if (status != kCVReturnSuccess) {
+            DLog(@"Can't create pixelBuffer");
+            return 0;
+        }
+        IOSurfaceRef surface = CVPixelBufferGetIOSurface(pixelBuffer);
+        if (!surface) {
+            CVPixelBufferRelease(pixelBuffer);
+            return 0;
+        }
+        custom::FrameLayout &layout = buffer->layout;
+        layout.plane_count = CVPixelBufferIsPlanar(pixelBuffer) ? (int)CVPixelBufferGetPlaneCount(pixelBuffer) : 1;
+        for (int i = 0; i < layout.plane_count && i < custom::kMaxPlanes; ++i) {
+            custom::PlaneLayout &plane = layout.planes[i];
+            if (CVPixelBufferIsPlanar(pixelBuffer)) {
+                plane.width = (int)CVPixelBufferGetWidthOfPlane(pixelBuffer, i);
+                plane.height = (int)CVPixelBufferGetHeightOfPlane(pixelBuffer, i);
+                plane.stride = (int)CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, i);
+            } else {
+                plane.width = (int)CVPixelBufferGetWidth(pixelBuffer);
+                plane.height = (int)CVPixelBufferGetHeight(pixelBuffer);
+                plane.stride = (int)CVPixelBufferGetBytesPerRow(pixelBuffer);
+            }
+            plane.size = (size_t)plane.stride * plane.height;
+        }
+        layout.total_size = CVPixelBufferGetDataSize(pixelBuffer);
+        buffer->handle = (void *)CFRetain(surface);
+        CVPixelBufferRelease(pixelBuffer);
+        return std::max<size_t>(layout.total_size, 1);
+    };
+    allocator.free = [](custom::FrameBuffer *buffer) {
+        CFRelease((IOSurfaceRef)buffer->handle);
+    };
+    return allocator;
+}
+
+}  // namespace
+
+/// Holds a pool buffer for as long as the CVPixelBuffer wrapping it is alive, as its attachment.
+@interface CustomPixelBufferLease : NSObject
+
+- (instancetype)initWithBuffer:(std::shared_ptr<custom::FrameBuffer>)buffer;
+
+@end
+
+@implementation CustomPixelBufferLease {
+  std::shared_ptr<custom::FrameBuffer> _buffer;
+}
+
+- (instancetype)initWithBuffer:(std::shared_ptr<custom::FrameBuffer>)buffer {
+    if (self = [super init]) {
+        _buffer = std::move(buffer);
+    }
+    return self;
+}
+
+@end
+
+@implementation CustomPixelBufferPool {
+  // Thread safe.
+  std::unique_ptr<custom::FrameBufferPool> _pool;
+}
+
++ (CustomPixelBufferPool *)sharedPool {
+    static CustomPixelBufferPool *sharedPool = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedPool = [[CustomPixelBufferPool alloc] init];
+    });
+    return sharedPool;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _pool = std::make_unique<custom::FrameBufferPool>(custom::FrameBufferPool::kDefaultMaxIdlePerKey,
+                                                          custom::FrameBufferPool::kDefaultMaxKeys,
+                                                          IOSurfaceAllocator());
+    }
+    return self;
+}
+
+- (uint64_t)hitCount {
+    return _pool->stats().hits;
+}
+
+- (uint64_t)missCount {
+    return _pool->stats().misses;
+}
+
+- (NSUInteger)highWaterCount {
+    return _pool->stats().high_water;
+}
+
+- (NSUInteger)inUseCount {
+    return _pool->stats().in_use;
+}
+
+/// Note: This function pass ownership of return value(CVPixelBufferRef) to the caller.
+- (nullable CVPixelBufferRef)createPixelBuffer:(OSType)pixelFormatType targetSize:(CGSize)targetSize CF_RETURNS_RETAINED {
+    custom::FrameBufferKey key;
+    key.width = (int)targetSize.width;
+    key.height = (int)targetSize.height;
+    key.format = pixelFormatType;
+
+    std::shared_ptr<custom::FrameBuffer> buffer = _pool->Acquire(key);
+    if (!buffer) {
+        DLog(@"Can't create pixelBuffer from pool");
+        return nil;
+    }
+    // A fresh CVPixelBuffer over the pooled IOSurface: the buffer goes back to the pool when the last reference to
+    // this one is released, however many consumers it passed through.
+    CVPixelBufferRef pixelBuffer = nil;
+    CVReturn status = CVPixelBufferCreateWithIOSurface(kCFAllocatorDefault, (IOSurfaceRef)buffer->handle, NULL,
+                                                       &pixelBuffer);
+    if (status != kCVReturnSuccess) {
+        DLog(@"Can't create pixelBuffer from IOSurface");
+        return nil;
+    }
+    CustomPixelBufferLease *lease = [[CustomPixelBufferLease alloc] initWithBuffer:std::move(buffer)];
+    CVBufferSetAttachment(pixelBuffer, kLeaseAttachmentKey, (__bridge CFTypeRef)lease,
+                          kCVAttachmentMode_ShouldNotPropagate);
+    return pixelBuffer;
+}
+
+- (void)flush {
+    _pool->Flush();
+}
+
+- (void)resetStats {
+    _pool->ResetStats();
+}
+
+@end
@@ -9,6 +9,9 @@
 #import <AVFoundation/AVFoundation.h>
 #include <libyuv-iOS/libyuv.h>
 
+#include "ColorConvert.h"
+#include "YuvFilter.h"
+
 NS_ASSUME_NONNULL_BEGIN
 
 @interface CustomPixelBufferUtils : NSObject
@@ -19,12 +22,31 @@ NS_ASSUME_NONNULL_BEGIN
 
 + (nullable CVPixelBufferRef) createEmptyPixelBuffer: (CFAllocatorRef __nullable)allocator attributes:(NSDictionary *)attributes pixelFormatType:(OSType)pixelFormatType targetSize:(CGSize)targetSize CF_RETURNS_RETAINED;
 
-///目前会有一些绿屏问题
+/// Threads, including the calling one, that convertBGRAToI420: and convertBGRAToNV12: split a frame over. Frames are
+/// cut into row bands of whole chroma row pairs, so the output is identical to converting it in one call. 0, the
+/// default, uses up to 4 cores; 1 converts on the calling thread only.
+@property(class, nonatomic) NSUInteger conversionThreadCount;
+
+/// Output buffers of the convert/rotate helpers are drawn from +[CustomPixelBufferPool sharedPool] and
+/// recycle into it once the caller (and e.g. the WebRTC encoder) releases them.
+/// Despite the name the result is biplanar video range NV12 ('420v'), the format the pool and the encoder use.
 + (nullable CVPixelBufferRef) convertBGRAToI420:(nonnull CVPixelBufferRef) pixelBufferBGRA CF_RETURNS_RETAINED;
 
+/// Converted with the BT.601 video range custom::ColorConversion, selected once, which matches the C path of
+/// libyuv::ARGBToNV12 and the rotating variant bit for bit; the output is video range '420v' like the one above.
 + (nullable CVPixelBufferRef) convertBGRAToNV12:(nonnull CVPixelBufferRef)pixelBufferBGRA CF_RETURNS_RETAINED;
 
-///目前旋转后的buffer拿去转成NV12/I420会花屏
+/// Rotates and converts to NV12 in a single pass, reading each BGRA pixel once. Both destination planes
+/// are written with their own bytesPerRow. Output matches ARGBRotate: followed by the C path of libyuv::ARGBToNV12.
++ (nullable CVPixelBufferRef) convertBGRAToNV12:(nonnull CVPixelBufferRef)pixelBufferBGRA rotation:(libyuv::RotationMode)rotation CF_RETURNS_RETAINED;
+
+/// Describes the planes of a locked |pixelBuffer| for the portable CPU code; format 0 if it is not NV12 or I420.
++ (custom::Yuv420Image)yuv420ImageOfPixelBuffer:(nonnull CVPixelBufferRef)pixelBuffer;
+
+/// Describes the planes of a locked |pixelBuffer| as |layout|, which the caller has matched to its pixel format.
++ (custom::ColorImage)colorImageOfPixelBuffer:(nonnull CVPixelBufferRef)pixelBuffer layout:(custom::PixelLayout)layout;
+
+///目前旋转后的buffer拿去转成NV12/I420会花屏, 需要旋转时用convertBGRAToNV12:rotation:
 + (nullable CVPixelBufferRef) ARGBRotate:(nonnull CVPixelBufferRef)pixelBufferBGRA rotation:(libyuv::RotationMode)rotation CF_RETURNS_RETAINED;
 
 @end
@@ -6,9 +6,112 @@
 //
 
 #import "CustomPixelBufferUtils.h"
+#import "CustomPixelBufferPool.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "RotateConvert.h"
+#include "WorkStealingPool.h"
+
+namespace {
+
+// Upper bound for conversionThreadCount 0; beyond that the conversion is memory bound.
+const NSUInteger kMaxAutoConversionThreads = 4;
+// Bands shorter than this cost more to hand out than they save.
+const int kMinConversionBandRows = 32;
+
+std::mutex gConversionPoolMutex;
+NSUInteger gConversionThreadCount = 0;
+std::shared_ptr<custom::WorkStealingPool> gConversionPool;
+
+// Pool for the current thread count, created on first use; nil if conversions run on the calling thread.
+std::shared_ptr<custom::WorkStealingPool> ConversionPool() {
+    std::lock_guard<std::mutex> lock(gConversionPoolMutex);
+    NSUInteger threadCount = gConversionThreadCount;
+    if (threadCount == 0) {
+        threadCount = MIN(NSProcessInfo.processInfo.activeProcessorCount, kMaxAutoConversionThreads);
+    }
+    if (threadCount <= 1) {
+        return nullptr;
+    }
+    if (!gConversionPool || gConversionPool->thread_count() != (int)threadCount) {
+        gConversionPool = std::make_shared<custom::WorkStealingPool>((int)threadCount);
+    }
+    return gConversionPool;
+}
+
+// BT.601 video range BGRA -> NV12, bit exact with the C path of libyuv::ARGBToNV12 and BGRAToNV12Rotated(). The
+// kernel is selected once.
+const custom::ColorConversion &BGRAToNV12Conversion() {
+    static const custom::ColorConversion conversion = custom::ColorConversion::Select(
+        custom::YuvMatrix::kBT601, custom::YuvRange::kVideo, custom::PixelLayout::kBGRA, custom::PixelLayout::kNV12);
+    return conversion;
+}
+
+// Rows [firstRow, endRow) of |image|; |firstRow| is even for 4:2:0 layouts.
+custom::ColorImage RowBand(const custom::ColorImage &image, int firstRow, int endRow) {
+    custom::ColorImage band = image;
+    band.height = endRow - firstRow;
+    for (int i = 0; i < custom::kMaxPlanes; i++) {
+        if (band.planes[i]) {
+            band.planes[i] += (size_t)(i == 0 ? firstRow : firstRow / 2) * band.strides[i];
+        }
+    }
+    return band;
+}
+
+}  // namespace
 
 @implementation CustomPixelBufferUtils
 
++ (NSUInteger)conversionThreadCount {
+    std::lock_guard<std::mutex> lock(gConversionPoolMutex);
+    return gConversionThreadCount;
+}
+
++ (void)setConversionThreadCount:(NSUInteger)conversionThreadCount {
+    std::lock_guard<std::mutex> lock(gConversionPoolMutex);
+    gConversionThreadCount = conversionThreadCount;
+}
+
++ (custom::Yuv420Image)yuv420ImageOfPixelBuffer:(CVPixelBufferRef)pixelBuffer {
+    custom::Yuv420Image image;
+    const OSType format = CVPixelBufferGetPixelFormatType(pixelBuffer);
+    const size_t planeCount = CVPixelBufferGetPlaneCount(pixelBuffer);
+    const bool isNV12 = (format == custom::kFourccNV12FullRange || format == custom::kFourccNV12VideoRange);
+    if (!(isNV12 && planeCount == 2) && !(format == custom::kFourccI420 && planeCount == 3)) {
+        return image;
+    }
+    image.format = format;
+    image.width = (int)CVPixelBufferGetWidth(pixelBuffer);
+    image.height = (int)CVPixelBufferGetHeight(pixelBuffer);
+    for (size_t i = 0; i < planeCount; i++) {
+        image.planes[i] = (uint8_t *)CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, i);
+        image.strides[i] = (int)CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, i);
+    }
+    return image;
+}
+
++ (custom::ColorImage)colorImageOfPixelBuffer:(CVPixelBufferRef)pixelBuffer layout:(custom::PixelLayout)layout {
+    custom::ColorImage image;
+    image.layout = layout;
+    image.width = (int)CVPixelBufferGetWidth(pixelBuffer);
+    image.height = (int)CVPixelBufferGetHeight(pixelBuffer);
+    if (!CVPixelBufferIsPlanar(pixelBuffer)) {
+        image.planes[0] = (uint8_t *)CVPixelBufferGetBaseAddress(pixelBuffer);
+        image.strides[0] = (int)CVPixelBufferGetBytesPerRow(pixelBuffer);
+        return image;
+    }
+    const size_t planeCount = MIN(CVPixelBufferGetPlaneCount(pixelBuffer), (size_t)custom::kMaxPlanes);
+    for (size_t i = 0; i < planeCount; i++) {
+        image.planes[i] = (uint8_t *)CVPixelBufferGetBaseAddressOfPlane(pixelBuffer, i);
+        image.strides[i] = (int)CVPixelBufferGetBytesPerRowOfPlane(pixelBuffer, i);
+    }
+    return image;
+}
+
 + (nullable CVPixelBufferRef) createEmptyPixelBuffer:(OSType)pixelFormatType targetSize:(CGSize)targetSize CF_RETURNS_RETAINED {
     CVPixelBufferRef pixelBuffer = nil;
     CVReturn status = CVPixelBufferCreate(kCFAllocatorDefault,
@@ -54,103 +157,122 @@
     return pixelBuffer;
 }
 
-///目前会有一些绿屏问题: webrtc/api/video/i420_buffer.cc 中有各个分量取值的代码
+/// The pooled buffer is biplanar '420v', so the frame is written as NV12 into each plane's own base address and
+/// bytesPerRow; IOSurface planes are padded and not contiguous, which is what the green frames came from.
 + (nullable CVPixelBufferRef) convertBGRAToI420:(nonnull CVPixelBufferRef) pixelBufferBGRA CF_RETURNS_RETAINED {
-    CVPixelBufferLockBaseAddress(pixelBufferBGRA, kCVPixelBufferLock_ReadOnly);
-    const uint8_t *src_argb = static_cast<uint8_t*>(CVPixelBufferGetBaseAddress(pixelBufferBGRA));
-    size_t src_stride_argb = CVPixelBufferGetBytesPerRow(pixelBufferBGRA);
+    return [self convertBGRAToNV12:pixelBufferBGRA];
+}
+
++ (nullable CVPixelBufferRef) convertBGRAToNV12:(nonnull CVPixelBufferRef)pixelBufferBGRA CF_RETURNS_RETAINED {
     size_t width  = CVPixelBufferGetWidth(pixelBufferBGRA);
     size_t height = CVPixelBufferGetHeight(pixelBufferBGRA);
 
-    // Create empty I420 pixelBuffer for convert.
-    CVPixelBufferRef pixelBufferI420 = [self createEmptyPixelBuffer:kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange targetSize:CGSizeMake(width, height)];
+    CVPixelBufferRef targetPixelBuffer = [[CustomPixelBufferPool sharedPool] createPixelBuffer:kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange targetSize:CGSizeMake(width, height)];
 
-    if (!pixelBufferI420) {
+    if (!targetPixelBuffer) {
         return nil;
     }
 
-    CVPixelBufferLockBaseAddress(pixelBufferI420, kCVPixelBufferLock_ReadOnly);
-    uint8_t *dst_y = (uint8_t*)CVPixelBufferGetBaseAddressOfPlane(pixelBufferI420,0);
-    width  = CVPixelBufferGetWidth(pixelBufferI420); // dst_stride_y
-    height = CVPixelBufferGetHeight(pixelBufferI420);
-    
-    size_t dst_stride_y = width;
-    size_t dst_stride_u = (width + 1) / 2;
-    size_t dst_stride_v = (width + 1) / 2;
-    
-    uint8_t *dst_u = dst_y + width * height;
-    uint8_t *dst_v = dst_y + dst_stride_y * height + dst_stride_u * ((height + 1) / 2);
-//    uint8_t *dst_v = dst_u + (width + 1) / 2 * (height + 1) / 2;
+    // Pooled IOSurfaces are reused, so the destination must be locked for writing to keep the
+    // surface seed (and any texture cache reading it) up to date.
+    CVPixelBufferLockBaseAddress(pixelBufferBGRA, kCVPixelBufferLock_ReadOnly);
+    CVPixelBufferLockBaseAddress(targetPixelBuffer, 0);
+
+    const custom::ColorImage src = [self colorImageOfPixelBuffer:pixelBufferBGRA layout:custom::PixelLayout::kBGRA];
+    const custom::ColorImage dst = [self colorImageOfPixelBuffer:targetPixelBuffer layout:custom::PixelLayout::kNV12];
+    const custom::ColorConversion &conversion = BGRAToNV12Conversion();
 
     // 旋转问题通过修改纹理坐标系
-    libyuv::ARGBToI420(src_argb, (int)src_stride_argb, dst_y, (int)dst_stride_y, dst_u, (int)dst_stride_u, dst_v, (int)dst_stride_v, (int)width, (int)height);
+    // Bands start on even rows, so each band's chroma rows are its own.
+    std::atomic<bool> success{true};
+    std::shared_ptr<custom::WorkStealingPool> pool = ConversionPool();
+    custom::ForEachRowBand(pool.get(), (int)height, 2, kMinConversionBandRows, [&](int firstRow, int endRow) {
+        if (!conversion.Convert(RowBand(src, firstRow, endRow), RowBand(dst, firstRow, endRow))) {
+            success = false;
+        }
+    });
 
-    CVPixelBufferUnlockBaseAddress(pixelBufferI420, kCVPixelBufferLock_ReadOnly);
+    CVPixelBufferUnlockBaseAddress(targetPixelBuffer, 0);
     CVPixelBufferUnlockBaseAddress(pixelBufferBGRA, kCVPixelBufferLock_ReadOnly);
-    return pixelBufferI420;
+
+    if (!success) {
+        DLog(@"BGRA to NV12 conversion failed");
+        CVPixelBufferRelease(targetPixelBuffer);
+        return nil;
+    }
+    return targetPixelBuffer;
 }
 
-+ (nullable CVPixelBufferRef) convertBGRAToNV12:(nonnull CVPixelBufferRef)pixelBufferBGRA CF_RETURNS_RETAINED {
-    size_t width  = CVPixelBufferGetWidth(pixelBufferBGRA);
-    size_t height = CVPixelBufferGetHeight(pixelBufferBGRA);
-    
-    CVPixelBufferRef targetPixelBuffer = [self createEmptyPixelBuffer:kCVPixelFormatType_420YpCbCr8BiPlanarFullRange targetSize:CGSizeMake(width, height)];
-    
+/// 旋转和转换在同一遍完成, 每个BGRA像素只读一次. Y/UV两个plane都按各自的bytesPerRow写入.
++ (nullable CVPixelBufferRef) convertBGRAToNV12:(nonnull CVPixelBufferRef)pixelBufferBGRA rotation:(libyuv::RotationMode)rotation CF_RETURNS_RETAINED {
+    const size_t src_width = CVPixelBufferGetWidth(pixelBufferBGRA);
+    const size_t src_height = CVPixelBufferGetHeight(pixelBufferBGRA);
+    const BOOL transposed = (rotation == libyuv::kRotate90 || rotation == libyuv::kRotate270);
+    const size_t width = transposed ? src_height : src_width;
+    const size_t height = transposed ? src_width : src_height;
+
+    CVPixelBufferRef targetPixelBuffer = [[CustomPixelBufferPool sharedPool] createPixelBuffer:kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange targetSize:CGSizeMake(width, height)];
+
     if (!targetPixelBuffer) {
         return nil;
     }
-    
+
     CVPixelBufferLockBaseAddress(pixelBufferBGRA, kCVPixelBufferLock_ReadOnly);
-    CVPixelBufferLockBaseAddress(targetPixelBuffer, kCVPixelBufferLock_ReadOnly);
-    
-    uint8_t *src_argb = (uint8_t *)CVPixelBufferGetBaseAddress(pixelBufferBGRA);
-    size_t src_stride_argb = CVPixelBufferGetBytesPerRow(pixelBufferBGRA);
-    
-    // yuv-stride
-    const size_t dst_stride_y = width;
-    const size_t dst_stride_uv = ((width + 1) / 2);
-//    const size_t dst_stride_uv = CVPixelBufferGetBytesPerRowOfPlane(targetPixelBuffer, 1);
+    CVPixelBufferLockBaseAddress(targetPixelBuffer, 0);
+
+    const uint8_t *src_argb = (const uint8_t *)CVPixelBufferGetBaseAddress(pixelBufferBGRA);
+    const size_t src_stride_argb = CVPixelBufferGetBytesPerRow(pixelBufferBGRA);
 
-    // yuv-data
     uint8_t *dst_y = (uint8_t *)CVPixelBufferGetBaseAddressOfPlane(targetPixelBuffer, 0);
     uint8_t *dst_uv = (uint8_t *)CVPixelBufferGetBaseAddressOfPlane(targetPixelBuffer, 1);
-    
-    libyuv::ARGBToNV12(src_argb, (int)src_stride_argb,
-                       dst_y, (int)dst_stride_y,
-                       dst_uv, (int)(dst_stride_uv * 2),
-                       (int)width, (int)height);
-    
-    CVPixelBufferUnlockBaseAddress(targetPixelBuffer, kCVPixelBufferLock_ReadOnly);
+    const size_t dst_stride_y = CVPixelBufferGetBytesPerRowOfPlane(targetPixelBuffer, 0);
+    const size_t dst_stride_uv = CVPixelBufferGetBytesPerRowOfPlane(targetPixelBuffer, 1);
+
+    const bool success = custom::BGRAToNV12Rotated(src_argb, (int)src_stride_argb,
+                                                   (int)src_width, (int)src_height,
+                                                   dst_y, (int)dst_stride_y,
+                                                   dst_uv, (int)dst_stride_uv,
+                                                   static_cast<custom::Rotation>(rotation));
+
+    CVPixelBufferUnlockBaseAddress(targetPixelBuffer, 0);
     CVPixelBufferUnlockBaseAddress(pixelBufferBGRA, kCVPixelBufferLock_ReadOnly);
+
+    if (!success) {
+        DLog(@"BGRAToNV12Rotated failed");
+        CVPixelBufferRelease(targetPixelBuffer);
+        return nil;
+    }
     return targetPixelBuffer;
 }
 
-///目前旋转后的buffer拿去转成NV12/I420会花屏
+///目前旋转后的buffer拿去转成NV12/I420会花屏, 需要旋转时用convertBGRAToNV12:rotation:
 + (nullable CVPixelBufferRef) ARGBRotate:(nonnull CVPixelBufferRef)pixelBufferBGRA rotation:(libyuv::RotationMode)rotation CF_RETURNS_RETAINED {
     size_t src_width  = CVPixelBufferGetWidth(pixelBufferBGRA);
     size_t src_height = CVPixelBufferGetHeight(pixelBufferBGRA);
 
-    size_t rotate_width = src_height;
-    size_t rotate_height = src_width;
+    const BOOL transposed = (rotation == libyuv::kRotate90 || rotation == libyuv::kRotate270);
+    size_t rotate_width = transposed ? src_height : src_width;
+    size_t rotate_height = transposed ? src_width : src_height;
 
     CVPixelBufferLockBaseAddress(pixelBufferBGRA, kCVPixelBufferLock_ReadOnly);
     const uint8_t *src_argb = (uint8_t *)CVPixelBufferGetBaseAddress(pixelBufferBGRA);
     size_t src_stride_argb = CVPixelBufferGetBytesPerRow(pixelBufferBGRA);
 
-    // Create empty BGRA pixelBuffer for rotate.
-    CVPixelBufferRef rotatePixelBufferBGRA = [self createEmptyPixelBuffer:kCVPixelFormatType_32BGRA targetSize:CGSizeMake(rotate_width, rotate_height)];
+    // Draw the BGRA pixelBuffer for rotate from the shared pool.
+    CVPixelBufferRef rotatePixelBufferBGRA = [[CustomPixelBufferPool sharedPool] createPixelBuffer:kCVPixelFormatType_32BGRA targetSize:CGSizeMake(rotate_width, rotate_height)];
 
     if (!rotatePixelBufferBGRA) {
+        CVPixelBufferUnlockBaseAddress(pixelBufferBGRA, kCVPixelBufferLock_ReadOnly);
         return nil;
     }
 
-    CVPixelBufferLockBaseAddress(rotatePixelBufferBGRA, kCVPixelBufferLock_ReadOnly);
+    CVPixelBufferLockBaseAddress(rotatePixelBufferBGRA, 0);
     uint8_t *rotate_src_argb = (uint8_t *)CVPixelBufferGetBaseAddress(rotatePixelBufferBGRA);
     size_t rotate_src_stride_argb = CVPixelBufferGetBytesPerRow(rotatePixelBufferBGRA);
 
     libyuv::ARGBRotate(src_argb, (int)src_stride_argb, rotate_src_argb, (int)rotate_src_stride_argb, (int)src_width, (int)src_height, rotation);
     
-    CVPixelBufferUnlockBaseAddress(rotatePixelBufferBGRA, kCVPixelBufferLock_ReadOnly);
+    CVPixelBufferUnlockBaseAddress(rotatePixelBufferBGRA, 0);
     CVPixelBufferUnlockBaseAddress(pixelBufferBGRA, kCVPixelBufferLock_ReadOnly);
     return rotatePixelBufferBGRA;
 }
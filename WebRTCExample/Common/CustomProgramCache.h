@@ -0,0 +1,50 @@
+//
+//  CustomProgramCache.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/3.
+//
+
+#import <Foundation/Foundation.h>
+#if TARGET_OS_IPHONE
+#import <OpenGLES/ES3/gl.h>
+#else
+#import <OpenGL/gl3.h>
+#endif
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Persistent cache of linked shader programs. Binaries from glGetProgramBinary are kept in memory and in the caches
+/// directory, keyed by the shader sources and the GL driver, so programs are only compiled the first time the app runs
+/// on a device or after an OS update. Wraps custom::ProgramBinaryCache. Program binaries need OpenGL ES 3; in other
+/// contexts programs are always compiled.
+@interface CustomProgramCache : NSObject
+
+@property(class, nonatomic, readonly) CustomProgramCache *sharedCache NS_SWIFT_NAME(shared);
+
+/// Programs created from a cached binary, and their average load time.
+@property(nonatomic, readonly) uint64_t hitCount;
+@property(nonatomic, readonly) double averageLoadMs;
+
+/// Programs that had to be compiled and linked, and their average build time.
+@property(nonatomic, readonly) uint64_t missCount;
+@property(nonatomic, readonly) double averageCompileMs;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Creates a program in the current context from the cached binary if there is one, otherwise compiles and links it
+/// and caches its binary. Returns the program handle or 0 on error. Attributes and uniforms are not set up.
+- (GLuint)createProgramWithVertexShaderSource:(const char [_Nonnull])vertexShaderSource fragmentShaderSource:(const char [_Nonnull])fragmentShaderSource;
+
+/// Runs |block| on a background OpenGL ES 3 context and saves the cache afterwards, so programs |block| creates through
+/// this cache are ready before the first frame needs them. |block| should delete its programs. Returns immediately.
+- (void)warmUpWithBlock:(void (^)(void))block;
+
+/// Removes all binaries, in memory and on disk.
+- (void)clear;
+
+- (void)resetStats;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,209 @@
+//
+//  CustomProgramCache.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/3.
+//
+
+#import "CustomProgramCache.h"
+#import "CustomShaderUtil.h"
+#if TARGET_OS_IPHONE
+#import <OpenGLES/EAGL.h>
+#endif
+
+#include <string>
+#include <vector>
+
+#include "ProgramBinaryCache.h"
+#include "StageTrace.h"
+
+namespace {
+
+// Identifies the driver of the current context.
+std::string CurrentDriverString() {
+    std::string driver;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION}) {
+        const GLubyte *value = glGetString(name);
+        driver += value ? reinterpret_cast<const char *>(value) : "";
+        driver += '\n';
+    }
+    return driver;
+}
+
+// glProgramBinary is core in OpenGL ES 3, and the driver must offer at least one format.
+bool CurrentContextSupportsProgramBinary() {
+#if TARGET_OS_IPHONE
+    EAGLContext *context = [EAGLContext currentContext];
+    if (!context || context.API < kEAGLRenderingAPIOpenGLES3) {
+        return false;
+    }
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+#else
+    return false;
+#endif
+}
+
+bool IsProgramLinked(GLuint program) {
+    GLint linkStatus = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+    return linkStatus == GL_TRUE;
+}
+
+}  // namespace
+
+@implementation CustomProgramCache {
+    custom::ProgramBinaryCache _cache;
+    NSString *_path;
+    /*Serial queue for warm up and file access.*/
+    dispatch_queue_t _queue;
+}
+
++ (CustomProgramCache *)sharedCache {
+    static CustomProgramCache *sharedCache;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedCache = [[CustomProgramCache alloc] initPrivate];
+    });
+    return sharedCache;
+}
+
+- (instancetype)initPrivate {
+    if (self = [super init]) {
+        NSString *caches = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+        _path = [caches stringByAppendingPathComponent:@"CustomProgramCache.bin"];
+        _queue = dispatch_queue_create("com.custom.programcache", DISPATCH_QUEUE_SERIAL);
+        // A missing or damaged file just means compiling again.
+        if (_cache.LoadFromFile(_path.UTF8String)) {
+            DLog(@"Loaded %zu cached program binaries", _cache.size());
+        }
+    }
+    return self;
+}
+
+- (uint64_t)hitCount {
+    return _cache.stats().hits;
+}
+
+- (double)averageLoadMs {
+    return _cache.stats().average_load_ms();
+}
+
+- (uint64_t)missCount {
+    return _cache.stats().misses;
+}
+
+- (double)averageCompileMs {
+    return _cache.stats().average_compile_ms();
+}
+
+- (GLuint)createProgramWithVertexShaderSource:(const char [])vertexShaderSource fragmentShaderSource:(const char [])fragmentShaderSource {
+    const bool cacheable = CurrentContextSupportsProgramBinary();
+    const uint64_t key = cacheable ? custom::ProgramCacheKey(vertexShaderSource, fragmentShaderSource, CurrentDriverString()) : 0;
+
+    custom::ProgramBinary binary;
+    if (cacheable && _cache.Find(key, &binary)) {
+        const int64_t beginNs = custom::TraceNowNs();
+        GLuint program = glCreateProgram();
+        if (program) {
+            glProgramBinary(program, binary.format, binary.data.data(), static_cast<GLsizei>(binary.data.size()));
+            if (IsProgramLinked(program)) {
+                const int64_t loadNs = custom::TraceNowNs() - beginNs;
+                _cache.RecordHit(loadNs);
+                DLog(@"Program loaded from cache in %.2f ms", loadNs / 1e6);
+                return program;
+            }
+            glDeleteProgram(program);
+        }
+        // Rejected by the driver, e.g. after an update that kept its version string.
+        DLog(@"Cached program binary rejected, compiling");
+        _cache.Erase(key);
+        _cache.RecordRejected();
+    }
+
+    const int64_t beginNs = custom::TraceNowNs();
+    GLuint vertexShader = [CustomShaderUtil createShader:GL_VERTEX_SHADER source:vertexShaderSource];
+    GLuint fragmentShader = [CustomShaderUtil createShader:GL_FRAGMENT_SHADER source:fragmentShaderSource];
+    GLuint program = [CustomShaderUtil createProgramWithVertexShader:vertexShader fragmentShader:fragmentShader];
+    // Shaders are created only to generate program.
+    if (vertexShader) {
+        glDeleteShader(vertexShader);
+    }
+
+    if (fragmentShader) {
+        glDeleteShader(fragmentShader);
+    }
+
+    if (!program) {
+        return 0;
+    }
+    const int64_t compileNs = custom::TraceNowNs() - beginNs;
+    _cache.RecordMiss(compileNs);
+    DLog(@"Program compiled in %.2f ms", compileNs / 1e6);
+
+    if (cacheable) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length > 0) {
+            binary.data.resize(length);
+            GLsizei written = 0;
+            GLenum format = 0;
+            glGetProgramBinary(program, length, &written, &format, binary.data.data());
+            binary.data.resize(written);
+            binary.format = format;
+            _cache.Insert(key, std::move(binary));
+            [self scheduleSave];
+        }
+    }
+    return program;
+}
+
+- (void)warmUpWithBlock:(void (^)(void))block {
+#if TARGET_OS_IPHONE
+    dispatch_async(_queue, ^{
+        EAGLContext *context = [[EAGLContext alloc] initWithAPI:kEAGLRenderingAPIOpenGLES3];
+        if (!context) {
+            // Without OpenGL ES 3 there are no binaries to cache.
+            return;
+        }
+        EAGLContext *previousContext = [EAGLContext currentContext];
+        [EAGLContext setCurrentContext:context];
+        const uint64_t misses = self->_cache.stats().misses;
+        const int64_t beginNs = custom::TraceNowNs();
+        block();
+        DLog(@"Program cache warm up took %.2f ms, compiled %llu programs", (custom::TraceNowNs() - beginNs) / 1e6,
+             self->_cache.stats().misses - misses);
+        [EAGLContext setCurrentContext:previousContext];
+        [self saveIfNeeded];
+    });
+#endif
+}
+
+- (void)clear {
+    _cache.Clear();
+    dispatch_async(_queue, ^{
+        [[NSFileManager defaultManager] removeItemAtPath:self->_path error:nil];
+    });
+}
+
+- (void)resetStats {
+    _cache.ResetStats();
+}
+
+#pragma mark - Private
+
+/// Writes new binaries on the serial queue; saves requested while one is pending are merged.
+- (void)scheduleSave {
+    dispatch_async(_queue, ^{
+        [self saveIfNeeded];
+    });
+}
+
+- (void)saveIfNeeded {
+    if (_cache.dirty() && !_cache.SaveToFile(_path.UTF8String)) {
+        DLog(@"Failed to save program cache to %@", _path);
+    }
+}
+
+@end
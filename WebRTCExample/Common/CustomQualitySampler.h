@@ -0,0 +1,91 @@
+//
+//  CustomQualitySampler.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/9.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreVideo/CoreVideo.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class CustomCPUFilter;
+
+/// PSNR and SSIM of one plane.
+@interface CustomPlaneQuality : NSObject
+
+/// In dB, 100 for identical planes.
+@property(nonatomic, readonly) double psnr;
+/// 1 for identical planes; 0 if SSIM wasn't measured.
+@property(nonatomic, readonly) double ssim;
+@property(nonatomic, readonly) uint64_t squaredError;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+/// Quality of a processed frame against its reference, see custom::QualityMeter.
+@interface CustomFrameQuality : NSObject
+
+@property(nonatomic, readonly) int64_t timeStampNs;
+@property(nonatomic, readonly) CustomPlaneQuality *y;
+@property(nonatomic, readonly) CustomPlaneQuality *u;
+@property(nonatomic, readonly) CustomPlaneQuality *v;
+/// Over all samples.
+@property(nonatomic, readonly) double psnr;
+@property(nonatomic, readonly) double ssim;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Measures |processed| against |reference| right away, on the calling thread. Both must be 4:2:0 ('420f', '420v',
+/// 'y420') of the same size, at least 16x16; nil otherwise.
++ (nullable instancetype)qualityOfPixelBuffer:(CVPixelBufferRef)processed
+                                    reference:(CVPixelBufferRef)reference
+                                     withSSIM:(BOOL)withSSIM
+                                  timeStampNs:(int64_t)timeStampNs;
+
+@end
+
+typedef void (^CustomQualityHandler)(CustomFrameQuality *quality);
+
+/// Measures every sampleInterval-th frame on a background queue, so the processing thread only pays for retaining two
+/// buffers. A sample arriving while the previous one is still being measured is dropped instead of queued.
+/// CustomPixelBufferProcesser uses one when its qualitySampler is set.
+@interface CustomQualitySampler : NSObject
+
+/// Frames between samples; 1 measures every frame the queue keeps up with. Defaults to 30.
+@property(atomic, assign) NSUInteger sampleInterval;
+
+/// Also measure SSIM, several times the cost of PSNR alone. Defaults to YES.
+@property(atomic, assign) BOOL measuresSSIM;
+
+/// Called on the sampler's queue with every measurement.
+@property(atomic, copy, nullable) CustomQualityHandler handler;
+
+/// The latest measurement.
+@property(atomic, readonly, nullable) CustomFrameQuality *latestQuality;
+
+@property(atomic, readonly) uint64_t measuredCount;
+/// Samples dropped because the queue was busy or the frames couldn't be compared, e.g. after a rotation.
+@property(atomic, readonly) uint64_t droppedCount;
+
+/// Counts a frame; YES if it is to be sampled.
+- (BOOL)shouldSampleFrame;
+
+/// Measures |processed| against |reference| in the background. Retains both until then.
+- (void)sampleProcessedPixelBuffer:(CVPixelBufferRef)processed
+                         reference:(CVPixelBufferRef)reference
+                       timeStampNs:(int64_t)timeStampNs;
+
+/// Measures |processed| against |source| run through |cpuFilter| in the background, e.g. GPU output against its CPU
+/// equivalent. Retains |source| until then. Dropped if |cpuFilter| skips unchanged tiles, that state belongs to the
+/// processing thread.
+- (void)sampleProcessedPixelBuffer:(CVPixelBufferRef)processed
+                            source:(CVPixelBufferRef)source
+                         cpuFilter:(CustomCPUFilter *)cpuFilter
+                       timeStampNs:(int64_t)timeStampNs;
+
+@end
+
+NS_ASSUME_NONNULL_END
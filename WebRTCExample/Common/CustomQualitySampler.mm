@@ -0,0 +1,195 @@
+//
+//  CustomQualitySampler.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/9.
+//
+
+#import "CustomQualitySampler.h"
+#import "CustomCPUFilter.h"
+#import "CustomPixelBufferUtils.h"
+
+#include <atomic>
+
+#include "FrameFormat.h"
+#include "QualityMetrics.h"
+
+namespace {
+
+const NSUInteger kDefaultSampleInterval = 30;
+
+bool MeasurePixelBuffers(custom::QualityMeter &meter, CVPixelBufferRef processed, CVPixelBufferRef reference,
+                         bool withSSIM, custom::FrameQuality *quality) {
+    CVPixelBufferLockBaseAddress(processed, kCVPixelBufferLock_ReadOnly);
+    CVPixelBufferLockBaseAddress(reference, kCVPixelBufferLock_ReadOnly);
+    const bool success = meter.Measure([CustomPixelBufferUtils yuv420ImageOfPixelBuffer:reference],
+                                       [CustomPixelBufferUtils yuv420ImageOfPixelBuffer:processed], withSSIM, quality);
+    CVPixelBufferUnlockBaseAddress(reference, kCVPixelBufferLock_ReadOnly);
+    CVPixelBufferUnlockBaseAddress(processed, kCVPixelBufferLock_ReadOnly);
+    return success;
+}
+
+}  // namespace
+
+@implementation CustomPlaneQuality
+
+- (instancetype)initWithPlaneQuality:(const custom::PlaneQuality &)quality {
+    if (self = [super init]) {
+        _psnr = quality.psnr;
+        _ssim = quality.ssim;
+        _squaredError = quality.sse;
+    }
+    return self;
+}
+
+@end
+
+@implementation CustomFrameQuality
+
+- (instancetype)initWithFrameQuality:(const custom::FrameQuality &)quality timeStampNs:(int64_t)timeStampNs {
+    if (self = [super init]) {
+        _timeStampNs = timeStampNs;
+        _y = [[CustomPlaneQuality alloc] initWithPlaneQuality:quality.planes[0]];
+        _u = [[CustomPlaneQuality alloc] initWithPlaneQuality:quality.planes[1]];
+        _v = [[CustomPlaneQuality alloc] initWithPlaneQuality:quality.planes[2]];
+        _psnr = quality.psnr;
+        _ssim = quality.ssim;
+    }
+    return self;
+}
+
++ (nullable instancetype)qualityOfPixelBuffer:(CVPixelBufferRef)processed
+                                    reference:(CVPixelBufferRef)reference
+                                     withSSIM:(BOOL)withSSIM
+                                  timeStampNs:(int64_t)timeStampNs {
+    custom::QualityMeter meter;
+    custom::FrameQuality quality;
+    if (!MeasurePixelBuffers(meter, processed, reference, withSSIM, &quality)) {
+        return nil;
+    }
+    return [[self alloc] initWithFrameQuality:quality timeStampNs:timeStampNs];
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"PSNR %.2f dB (Y %.2f U %.2f V %.2f), SSIM %.4f (Y %.4f U %.4f V %.4f)",
+                                      _psnr, _y.psnr, _u.psnr, _v.psnr, _ssim, _y.ssim, _u.ssim, _v.ssim];
+}
+
+@end
+
+@interface CustomQualitySampler()
+
+@property(atomic, strong, nullable) CustomFrameQuality *latestQuality;
+
+@end
+
+@implementation CustomQualitySampler {
+    dispatch_queue_t _queue;
+    // Only used on _queue.
+    custom::QualityMeter _meter;
+    std::atomic<uint64_t> _frameCount;
+    std::atomic<uint64_t> _measuredCount;
+    std::atomic<uint64_t> _droppedCount;
+    // Set while a sample is queued or being measured.
+    std::atomic<bool> _busy;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        dispatch_queue_attr_t attributes =
+            dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0);
+        _queue = dispatch_queue_create("com.custom.qualitysampler", attributes);
+        _sampleInterval = kDefaultSampleInterval;
+        _measuresSSIM = YES;
+        _frameCount = 0;
+        _measuredCount = 0;
+        _droppedCount = 0;
+        _busy = false;
+    }
+    return self;
+}
+
+- (uint64_t)measuredCount {
+    return _measuredCount.load();
+}
+
+- (uint64_t)droppedCount {
+    return _droppedCount.load();
+}
+
+- (BOOL)shouldSampleFrame {
+    const NSUInteger interval = MAX(self.sampleInterval, (NSUInteger)1);
+    return _frameCount.fetch_add(1) % interval == 0;
+}
+
+- (void)sampleProcessedPixelBuffer:(CVPixelBufferRef)processed
+                         reference:(CVPixelBufferRef)reference
+                       timeStampNs:(int64_t)timeStampNs {
+    if (![self acquire]) {
+        return;
+    }
+    id processedObject = (__bridge id)processed;
+    id referenceObject = (__bridge id)reference;
+    dispatch_async(_queue, ^{
+        [self measureProcessed:(__bridge CVPixelBufferRef)processedObject
+                     reference:(__bridge CVPixelBufferRef)referenceObject
+                   timeStampNs:timeStampNs];
+    });
+}
+
+- (void)sampleProcessedPixelBuffer:(CVPixelBufferRef)processed
+                            source:(CVPixelBufferRef)source
+                         cpuFilter:(CustomCPUFilter *)cpuFilter
+                       timeStampNs:(int64_t)timeStampNs {
+    if (cpuFilter.skipsUnchangedTiles && !cpuFilter.flipsVertically) {
+        _droppedCount++;
+        return;
+    }
+    if (![self acquire]) {
+        return;
+    }
+    id processedObject = (__bridge id)processed;
+    id sourceObject = (__bridge id)source;
+    dispatch_async(_queue, ^{
+        CVPixelBufferRef reference = [cpuFilter filteredPixelBuffer:(__bridge CVPixelBufferRef)sourceObject];
+        if (!reference) {
+            self->_droppedCount++;
+            self->_busy = false;
+            return;
+        }
+        [self measureProcessed:(__bridge CVPixelBufferRef)processedObject reference:reference timeStampNs:timeStampNs];
+        CVPixelBufferRelease(reference);
+    });
+}
+
+#pragma mark - Private
+
+/// Claims the queue for a sample; NO, counting a dropped sample, if it is still busy with the previous one.
+- (BOOL)acquire {
+    if (_busy.exchange(true)) {
+        _droppedCount++;
+        return NO;
+    }
+    return YES;
+}
+
+- (void)measureProcessed:(CVPixelBufferRef)processed reference:(CVPixelBufferRef)reference timeStampNs:(int64_t)timeStampNs {
+    custom::FrameQuality quality;
+    const bool success = MeasurePixelBuffers(_meter, processed, reference, self.measuresSSIM, &quality);
+    _busy = false;
+    if (!success) {
+        DLog(@"CustomQualitySampler: can't compare pixel formats %u and %u",
+             (unsigned)CVPixelBufferGetPixelFormatType(processed), (unsigned)CVPixelBufferGetPixelFormatType(reference));
+        _droppedCount++;
+        return;
+    }
+    _measuredCount++;
+    CustomFrameQuality *frameQuality = [[CustomFrameQuality alloc] initWithFrameQuality:quality timeStampNs:timeStampNs];
+    self.latestQuality = frameQuality;
+    CustomQualityHandler handler = self.handler;
+    if (handler) {
+        handler(frameQuality);
+    }
+}
+
+@end
@@ -0,0 +1,47 @@
+//
+//  CustomSdpMunger.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/12.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Munges local session descriptions with custom::SessionDescription: codec order, b=AS and RID simulcast, without
+/// string hacking. Offers go through a custom::OfferTemplateCache, so a reconnect's offer, which only differs from the
+/// last one in the values a new peer connection changes, is filled into the cached result instead of munged again.
+/// With no option set the SDP is returned as it is. Thread safe.
+@interface CustomSdpMunger : NSObject
+
+/// Encoding name moved to the front of every video section, e.g. @"H264"; nil keeps libwebrtc's order.
+@property(atomic, copy, nullable) NSString *preferredVideoCodec;
+/// Likewise for audio sections, e.g. @"opus".
+@property(atomic, copy, nullable) NSString *preferredAudioCodec;
+
+/// b=AS of video sections in kbps, which caps what the peer sends; 0 leaves libwebrtc's.
+@property(atomic, assign) NSUInteger videoBandwidthKbps;
+@property(atomic, assign) NSUInteger audioBandwidthKbps;
+
+/// RIDs offered as simulcast layers on video sections that send, for SFUs that take them. Empty by default; not
+/// applied to answers.
+@property(atomic, copy) NSArray<NSString *> *simulcastRids;
+
+/// Offers filled into a cached template, and their average time.
+@property(atomic, readonly) uint64_t templateHitCount;
+@property(atomic, readonly) double averageTemplateMs;
+
+/// Descriptions parsed and munged, and their average time.
+@property(atomic, readonly) uint64_t mungeCount;
+@property(atomic, readonly) double averageMungeMs;
+
+/// |sdp| munged, or |sdp| itself if it doesn't parse.
+- (NSString *)mungeOffer:(NSString *)sdp;
+
+/// As above, without the template cache and simulcast.
+- (NSString *)mungeAnswer:(NSString *)sdp;
+
+@end
+
+NS_ASSUME_NONNULL_END
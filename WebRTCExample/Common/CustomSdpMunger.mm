@@ -0,0 +1,168 @@
+//
+//  CustomSdpMunger.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/12.
+//
+
+#import "CustomSdpMunger.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "OfferTemplateCache.h"
+#include "SessionDescription.h"
+#include "StageTrace.h"
+
+namespace {
+
+// The options a munge ran with, to tell when cached templates are stale.
+struct MungeOptions {
+    std::string videoCodec;
+    std::string audioCodec;
+    int videoKbps = 0;
+    int audioKbps = 0;
+    std::vector<std::string> simulcastRids;
+
+    bool empty() const {
+        return videoCodec.empty() && audioCodec.empty() && videoKbps == 0 && audioKbps == 0 && simulcastRids.empty();
+    }
+
+    bool operator==(const MungeOptions &other) const {
+        return videoCodec == other.videoCodec && audioCodec == other.audioCodec && videoKbps == other.videoKbps &&
+               audioKbps == other.audioKbps && simulcastRids == other.simulcastRids;
+    }
+};
+
+std::string StringOfNSString(NSString *_Nullable string) {
+    return string ? std::string(string.UTF8String) : std::string();
+}
+
+}  // namespace
+
+@implementation CustomSdpMunger {
+    std::mutex _mutex;
+    custom::SessionDescription _description;
+    custom::OfferTemplateCache _cache;
+    // The options _cache's templates were made with.
+    MungeOptions _cachedOptions;
+    std::string _munged;
+    uint64_t _templateHitCount;
+    int64_t _templateTotalNs;
+    uint64_t _mungeCount;
+    int64_t _mungeTotalNs;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _simulcastRids = @[];
+        _templateHitCount = 0;
+        _templateTotalNs = 0;
+        _mungeCount = 0;
+        _mungeTotalNs = 0;
+    }
+    return self;
+}
+
+- (uint64_t)templateHitCount {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _templateHitCount;
+}
+
+- (double)averageTemplateMs {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _templateHitCount ? _templateTotalNs / 1e6 / _templateHitCount : 0;
+}
+
+- (uint64_t)mungeCount {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _mungeCount;
+}
+
+- (double)averageMungeMs {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _mungeCount ? _mungeTotalNs / 1e6 / _mungeCount : 0;
+}
+
+- (NSString *)mungeOffer:(NSString *)sdp {
+    return [self mungeDescription:sdp isOffer:YES];
+}
+
+- (NSString *)mungeAnswer:(NSString *)sdp {
+    return [self mungeDescription:sdp isOffer:NO];
+}
+
+#pragma mark - Private
+
+- (MungeOptions)currentOptions {
+    MungeOptions options;
+    options.videoCodec = StringOfNSString(self.preferredVideoCodec);
+    options.audioCodec = StringOfNSString(self.preferredAudioCodec);
+    options.videoKbps = (int)MIN(self.videoBandwidthKbps, (NSUInteger)INT_MAX);
+    options.audioKbps = (int)MIN(self.audioBandwidthKbps, (NSUInteger)INT_MAX);
+    for (NSString *rid in self.simulcastRids) {
+        options.simulcastRids.push_back(StringOfNSString(rid));
+    }
+    return options;
+}
+
+- (NSString *)mungeDescription:(NSString *)sdp isOffer:(BOOL)isOffer {
+    MungeOptions options = [self currentOptions];
+    if (options.empty()) {
+        return sdp;
+    }
+    if (!isOffer) {
+        options.simulcastRids.clear();
+    }
+    const std::string_view text(sdp.UTF8String);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    const int64_t beginNs = custom::TraceNowNs();
+    if (isOffer) {
+        if (!(options == _cachedOptions)) {
+            _cache.Clear();
+            _cachedOptions = options;
+        }
+        if (_cache.Apply(text, &_munged)) {
+            _templateTotalNs += custom::TraceNowNs() - beginNs;
+            _templateHitCount++;
+            return [[NSString alloc] initWithBytes:_munged.data() length:_munged.size() encoding:NSUTF8StringEncoding];
+        }
+    }
+    if (!_description.Parse(text)) {
+        DLog(@"CustomSdpMunger: %s at line %zu", _description.error(), _description.error_line());
+        return sdp;
+    }
+    for (size_t i = 0; i < _description.media_count(); i++) {
+        const custom::SdpMediaSection &media = _description.media(i);
+        if (media.media == "video") {
+            if (!options.videoCodec.empty()) {
+                _description.PreferCodec(i, options.videoCodec);
+            }
+            if (options.videoKbps > 0) {
+                _description.SetBandwidth(i, options.videoKbps);
+            }
+            if (!options.simulcastRids.empty()) {
+                _description.AddSimulcast(i, options.simulcastRids);
+            }
+        } else if (media.media == "audio") {
+            if (!options.audioCodec.empty()) {
+                _description.PreferCodec(i, options.audioCodec);
+            }
+            if (options.audioKbps > 0) {
+                _description.SetBandwidth(i, options.audioKbps);
+            }
+        }
+    }
+    _munged.clear();
+    _description.AppendTo(&_munged);
+    if (isOffer && !_cache.Store(text, _munged)) {
+        DLog(@"CustomSdpMunger: munged offer can't be templated");
+    }
+    _mungeTotalNs += custom::TraceNowNs() - beginNs;
+    _mungeCount++;
+    return [[NSString alloc] initWithBytes:_munged.data() length:_munged.size() encoding:NSUTF8StringEncoding];
+}
+
+@end
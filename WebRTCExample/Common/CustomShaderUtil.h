@@ -38,15 +38,13 @@ NS_ASSUME_NONNULL_BEGIN
 /// pos = position(x,y), tex = texcoord(u,v)
 /// | pos1 | tex1 | pos2 | tex2 | pos3 | tex3 | pos4 | tex4 |
 /// Creates and links a shader program with the given fragment shader source and
-/// a plain vertex shader. Returns the program handle or 0 on error.
+/// a plain vertex shader. Returns the program handle or 0 on error. The program
+/// comes from CustomProgramCache, so it is only compiled the first time.
 + (GLuint) createProgramWithVertexShaderSource:(const char [_Nonnull])vertexShaderSource fragmentShaderSource:(const char [_Nonnull])fragmentShaderSource;
 
-/// Create VAB and VBO and bind them.
-+ (BOOL) createVertexBuffer: (GLuint *)VBO VAO:(GLuint *)VAO;
-
-/// 上传顶点数据,包括顶点坐标和纹理坐标数据
-/// Set vertex data to the currently bound vertex buffer.
-+ (void) setVertexDataWithRotation:(CustomVideoRotation)rotation;
+/// First vertex of the quad for |rotation| in CustomGLResources' quad vertex
+/// buffer, for glDrawArrays(GL_TRIANGLE_FAN, first, 4).
++ (GLint) firstQuadVertexWithRotation:(CustomVideoRotation)rotation;
 
 @end
 
@@ -6,6 +6,12 @@
 //
 
 #import "CustomShaderUtil.h"
+#import "CustomProgramCache.h"
+#if TARGET_OS_IPHONE
+#import <OpenGLES/EAGL.h>
+#endif
+
+#include "GLResourceRegistry.h"
 //#import "CustomOpenGLDefines.h"
 
 @implementation CustomShaderUtil
@@ -56,6 +62,12 @@
   
     glAttachShader(program, vertexShader);
     glAttachShader(program, fragmentShader);
+#if TARGET_OS_IPHONE
+    // Lets CustomProgramCache read the linked binary back. Ignored without OpenGL ES 3.
+    if ([EAGLContext currentContext].API >= kEAGLRenderingAPIOpenGLES3) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+#endif
     glLinkProgram(program);
     GLint linkStatus = GL_FALSE;
     glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
@@ -93,16 +105,10 @@
 /// Creates and links a shader program with the given fragment shader source and
 /// a plain vertex shader. Returns the program handle or 0 on error.
 + (GLuint) createProgramWithVertexShaderSource:(const char [])vertexShaderSource fragmentShaderSource:(const char [])fragmentShaderSource {
-    GLuint vertexShader = [self createShader:GL_VERTEX_SHADER source:vertexShaderSource];
-    GLuint fragmentShader = [self createShader:GL_FRAGMENT_SHADER source:fragmentShaderSource];
-    GLuint program = [self createProgramWithVertexShader:vertexShader fragmentShader:fragmentShader];
-    // Shaders are created only to generate program.
-    if (vertexShader) {
-        glDeleteShader(vertexShader);
-    }
-  
-    if (fragmentShader) {
-        glDeleteShader(fragmentShader);
+    // Compiled only the first time, later runs load the linked binary.
+    GLuint program = [[CustomProgramCache sharedCache] createProgramWithVertexShaderSource:vertexShaderSource fragmentShaderSource:fragmentShaderSource];
+    if (!program) {
+        return 0;
     }
 
     // Set vertex shader variables 'position' and 'texcoord' in program.
@@ -126,94 +132,27 @@
     return program;
 }
 
-/// Create VAB and VBO and bind them.
-+ (BOOL) createVertexBuffer: (GLuint *)VBO VAO:(GLuint *)VAO {
-#if !TARGET_OS_IPHONE
-    glGenVertexArrays(1, VAO);
-    if (*VAO == 0) {
-        return NO;
-    }
-    glBindVertexArray(*VAO);
-#endif
-    // VBO
-    glGenBuffers(1, VBO);
-  
-    if (*VBO == 0) {
-        glDeleteVertexArrays(1, VAO);
-        return NO;
+/// 顶点数据(包括顶点坐标和纹理坐标)四个方向都预先上传到同一个VBO, 旋转时只选择起始顶点.
+/// The quads of all four rotations live in one static vertex buffer, see
+/// custom::FillRotatedQuadVertices; a rotation just selects where to start.
++ (GLint) firstQuadVertexWithRotation:(CustomVideoRotation)rotation {
+    // Corners the texture coordinates are rotated by.
+    int rotationOffset = 0;
+    switch (rotation) {
+        case CustomVideoRotation_0:
+            rotationOffset = 2;
+            break;
+        case CustomVideoRotation_90:
+            rotationOffset = 0;
+            break;
+        case CustomVideoRotation_180:
+            rotationOffset = 2;
+            break;
+        case CustomVideoRotation_270:
+            rotationOffset = 1;
+            break;
     }
-    glBindBuffer(GL_ARRAY_BUFFER, *VBO);
-    glBufferData(GL_ARRAY_BUFFER, 4 * 4 * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
-    return YES;
-}
-
-/// 上传顶点数据,包括顶点坐标和纹理坐标数据，纹理坐标包含纹理的方向,纹理方向也可以通过libyuv来后期旋转不过旋转后的buffer会花屏(还不知道原因)
-/// Set vertex data to the currently bound vertex buffer.
-+ (void) setVertexDataWithRotation:(CustomVideoRotation)rotation {
-  // When modelview and projection matrices are identity (default) the world is
-  // contained in the square around origin with unit size 2. Drawing to these
-  // coordinates is equivalent to drawing to the entire screen. The texture is
-  // stretched over that square using texture coordinates (u, v) that range
-  // from (0, 0) to (1, 1) inclusive. Texture coordinates are flipped vertically
-  // here because the incoming frame has origin in upper left hand corner but
-  // OpenGL expects origin in bottom left corner.
-
-  // Rotate the UV coordinates.
-    NSInteger rotation_offset;
-  switch (rotation) {
-    case CustomVideoRotation_0:
-      rotation_offset = 2;
-      break;
-    case CustomVideoRotation_90:
-      rotation_offset = 0;
-      break;
-    case CustomVideoRotation_180:
-      rotation_offset = 2;
-      break;
-    case CustomVideoRotation_270:
-      rotation_offset = 1;
-      break;
-  }
-    
-    NSMutableArray<NSArray<NSNumber *> *> *uvCoords = [NSMutableArray arrayWithObjects:
-                                                         @[@(0), @(1)],
-                                                         @[@(1), @(1)],
-                                                         @[@(1), @(0)],
-                                                         @[@(0), @(0)], nil];
-    
-    NSMutableArray<NSArray<NSNumber *> *> *tempuvCoords = [NSMutableArray arrayWithObjects:
-                                                           [NSNull null],
-                                                           [NSNull null],
-                                                           [NSNull null],
-                                                           [NSNull null], nil];
-
-    for (NSInteger i = 0; i < uvCoords.count; i++) {
-        NSInteger tempIndex = i - rotation_offset % uvCoords.count;
-        if (tempIndex < 0) {
-            tempIndex = tempIndex + uvCoords.count;
-        }
-        tempuvCoords[tempIndex] = uvCoords[i];
-    }
-    
-  const GLfloat gVertices[] = {
-      // X, Y, U, V.
-      -1, -1, static_cast<GLfloat>([tempuvCoords[0][0] intValue]), static_cast<GLfloat>([tempuvCoords[0][1] intValue]),
-       1, -1, static_cast<GLfloat>([tempuvCoords[1][0] intValue]), static_cast<GLfloat>([tempuvCoords[1][1] intValue]),
-       1,  1, static_cast<GLfloat>([tempuvCoords[2][0] intValue]), static_cast<GLfloat>([tempuvCoords[2][1] intValue]),
-      -1,  1, static_cast<GLfloat>([tempuvCoords[3][0] intValue]), static_cast<GLfloat>([tempuvCoords[3][1] intValue]),
-  };
-    
-    /*
-     e.g: 手机竖屏时
-     const GLfloat gVertices[] = {
-          X, Y, U, V.
-           -1, -1, 0, 1,
-            1, -1, 1, 1,
-            1,  1, 1, 0,
-           -1,  1, 0, 0,
-     };
-     */
-  glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(gVertices), gVertices);
+    return custom::RotatedQuadFirstVertex(rotationOffset);
 }
 
 @end
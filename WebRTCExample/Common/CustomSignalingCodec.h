@@ -0,0 +1,91 @@
+//
+//  CustomSignalingCodec.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/10.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// SignalingMessageType in SignalingMessage.swift.
+typedef NS_ENUM(NSInteger, CustomSignalingMessageType) {
+    CustomSignalingMessageTypeOffer,
+    CustomSignalingMessageTypeAnswer,
+    CustomSignalingMessageTypeUnknown,
+    CustomSignalingMessageTypeCandidate,
+    /// Several candidates in one message, only for peers whose offer or answer set supportsCandidateBatches.
+    CustomSignalingMessageTypeCandidates,
+};
+
+/// Candidate in SignalingMessage.swift.
+@interface CustomSignalingCandidate : NSObject
+
+@property(nonatomic, readonly, copy) NSString *sdp;
+@property(nonatomic, readonly) int32_t sdpMLineIndex;
+@property(nonatomic, readonly, copy, nullable) NSString *sdpMid;
+
+- (instancetype)initWithSdp:(NSString *)sdp
+              sdpMLineIndex:(int32_t)sdpMLineIndex
+                     sdpMid:(nullable NSString *)sdpMid NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+/// A decoded signaling message, see SignalingMessage.swift.
+@interface CustomSignalingMessage : NSObject
+
+@property(nonatomic, readonly) CustomSignalingMessageType type;
+/// sessionDescription.sdp, nil if the message has no session description.
+@property(nonatomic, readonly, nullable) NSString *sdp;
+/// Whether the candidate properties are set.
+@property(nonatomic, readonly) BOOL hasCandidate;
+@property(nonatomic, readonly, nullable) NSString *candidateSdp;
+@property(nonatomic, readonly) int32_t candidateSdpMLineIndex;
+@property(nonatomic, readonly, nullable) NSString *candidateSdpMid;
+/// The candidates of a CustomSignalingMessageTypeCandidates message.
+@property(nonatomic, readonly, nullable) NSArray<CustomSignalingCandidate *> *candidates;
+/// Set in an offer or answer by a peer that accepts CustomSignalingMessageTypeCandidates messages.
+@property(nonatomic, readonly) BOOL supportsCandidateBatches;
+/// Set in an offer or answer by a peer that takes its data channel messages framed, see CustomDataTransfer.framed.
+@property(nonatomic, readonly) BOOL supportsDataFrames;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+/// Encodes and decodes SignalingService's messages with custom::SignalingParser and custom::SignalingWriter, in place of
+/// JSONEncoder and JSONDecoder: no intermediate Data or String, and buffers reused across messages. The JSON is the
+/// same apart from key order and '/' not being escaped, so either end may still use the Codable path. Thread safe.
+@interface CustomSignalingCodec : NSObject
+
+/// Decodes a message from the UTF-8 of a WebSocket text frame; nil if it isn't one.
+- (nullable CustomSignalingMessage *)decodeMessageFromUTF8:(const uint8_t *)bytes length:(NSUInteger)length
+    NS_SWIFT_NAME(decodeMessage(utf8:length:));
+
+- (nullable CustomSignalingMessage *)decodeMessageFromString:(NSString *)text NS_SWIFT_NAME(decodeMessage(_:));
+
+/// An offer, answer or unKnown message carrying |sdp|.
+- (NSString *)encodeSessionDescription:(NSString *)sdp type:(CustomSignalingMessageType)type;
+
+/// As above, telling the peer this end accepts CustomSignalingMessageTypeCandidates messages if
+/// |advertisesCandidateBatches|. Peers that don't know the flag ignore it.
+- (NSString *)encodeSessionDescription:(NSString *)sdp
+                                  type:(CustomSignalingMessageType)type
+            advertisesCandidateBatches:(BOOL)advertisesCandidateBatches;
+
+/// As above, also telling the peer this end takes framed data channel messages if |advertisesDataFrames|.
+- (NSString *)encodeSessionDescription:(NSString *)sdp
+                                  type:(CustomSignalingMessageType)type
+            advertisesCandidateBatches:(BOOL)advertisesCandidateBatches
+                  advertisesDataFrames:(BOOL)advertisesDataFrames;
+
+- (NSString *)encodeCandidate:(NSString *)sdp sdpMLineIndex:(int32_t)sdpMLineIndex sdpMid:(nullable NSString *)sdpMid;
+
+/// A CustomSignalingMessageTypeCandidates message carrying |candidates|.
+- (NSString *)encodeCandidates:(NSArray<CustomSignalingCandidate *> *)candidates;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,258 @@
+//
+//  CustomSignalingCodec.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/10.
+//
+
+#import "CustomSignalingCodec.h"
+
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "SignalingCodec.h"
+
+namespace {
+
+custom::SignalingMessageType CoreTypeOfType(CustomSignalingMessageType type) {
+    switch (type) {
+        case CustomSignalingMessageTypeOffer:
+            return custom::SignalingMessageType::kOffer;
+        case CustomSignalingMessageTypeAnswer:
+            return custom::SignalingMessageType::kAnswer;
+        case CustomSignalingMessageTypeCandidate:
+            return custom::SignalingMessageType::kCandidate;
+        case CustomSignalingMessageTypeCandidates:
+            return custom::SignalingMessageType::kCandidates;
+        case CustomSignalingMessageTypeUnknown:
+            break;
+    }
+    return custom::SignalingMessageType::kUnknown;
+}
+
+CustomSignalingMessageType TypeOfCoreType(custom::SignalingMessageType type) {
+    switch (type) {
+        case custom::SignalingMessageType::kOffer:
+            return CustomSignalingMessageTypeOffer;
+        case custom::SignalingMessageType::kAnswer:
+            return CustomSignalingMessageTypeAnswer;
+        case custom::SignalingMessageType::kCandidate:
+            return CustomSignalingMessageTypeCandidate;
+        case custom::SignalingMessageType::kCandidates:
+            return CustomSignalingMessageTypeCandidates;
+        case custom::SignalingMessageType::kUnknown:
+            break;
+    }
+    return CustomSignalingMessageTypeUnknown;
+}
+
+// The UTF-8 of |string|: its own buffer if it keeps one, else copied into |scratch|.
+std::string_view UTF8OfString(NSString *string, std::string *scratch) {
+    const char *bytes = CFStringGetCStringPtr((__bridge CFStringRef)string, kCFStringEncodingUTF8);
+    if (bytes) {
+        return std::string_view(bytes, strlen(bytes));
+    }
+    scratch->resize([string maximumLengthOfBytesUsingEncoding:NSUTF8StringEncoding]);
+    NSUInteger length = 0;
+    [string getBytes:&(*scratch)[0]
+           maxLength:scratch->size()
+          usedLength:&length
+            encoding:NSUTF8StringEncoding
+             options:0
+               range:NSMakeRange(0, string.length)
+      remainingRange:NULL];
+    return std::string_view(scratch->data(), length);
+}
+
+NSString *StringOfUTF8(std::string_view utf8) {
+    return [[NSString alloc] initWithBytes:utf8.data() length:utf8.size() encoding:NSUTF8StringEncoding];
+}
+
+}  // namespace
+
+@implementation CustomSignalingCandidate
+
+- (instancetype)initWithSdp:(NSString *)sdp sdpMLineIndex:(int32_t)sdpMLineIndex sdpMid:(nullable NSString *)sdpMid {
+    if (self = [super init]) {
+        _sdp = [sdp copy];
+        _sdpMLineIndex = sdpMLineIndex;
+        _sdpMid = [sdpMid copy];
+    }
+    return self;
+}
+
+- (nullable instancetype)initWithCandidate:(const custom::SignalingCandidate &)candidate {
+    NSString *sdp = StringOfUTF8(candidate.sdp);
+    NSString *sdpMid = candidate.has_sdp_mid ? StringOfUTF8(candidate.sdp_mid) : nil;
+    if (!sdp || (candidate.has_sdp_mid && !sdpMid)) {
+        return nil;
+    }
+    return [self initWithSdp:sdp sdpMLineIndex:candidate.sdp_mline_index sdpMid:sdpMid];
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<CustomSignalingCandidate %@ %d %@>", _sdpMid, _sdpMLineIndex, _sdp];
+}
+
+@end
+
+@implementation CustomSignalingMessage
+
+- (nullable instancetype)initWithMessage:(const custom::SignalingMessage &)message {
+    if (self = [super init]) {
+        _type = TypeOfCoreType(message.type);
+        if (message.has_session_description) {
+            _sdp = StringOfUTF8(message.sdp);
+            if (!_sdp) {
+                return nil;
+            }
+        }
+        if (message.has_candidate) {
+            _hasCandidate = YES;
+            _candidateSdp = StringOfUTF8(message.candidate.sdp);
+            _candidateSdpMLineIndex = message.candidate.sdp_mline_index;
+            if (message.candidate.has_sdp_mid) {
+                _candidateSdpMid = StringOfUTF8(message.candidate.sdp_mid);
+            }
+            if (!_candidateSdp || (message.candidate.has_sdp_mid && !_candidateSdpMid)) {
+                return nil;
+            }
+        }
+        _supportsCandidateBatches = message.supports_candidate_batches;
+        _supportsDataFrames = message.supports_data_frames;
+        if (message.type == custom::SignalingMessageType::kCandidates || message.candidate_count > 0) {
+            NSMutableArray<CustomSignalingCandidate *> *candidates =
+                [NSMutableArray arrayWithCapacity:message.candidate_count];
+            for (size_t i = 0; i < message.candidate_count; i++) {
+                CustomSignalingCandidate *candidate =
+                    [[CustomSignalingCandidate alloc] initWithCandidate:message.candidates[i]];
+                if (!candidate) {
+                    return nil;
+                }
+                [candidates addObject:candidate];
+            }
+            _candidates = candidates;
+        }
+    }
+    return self;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<CustomSignalingMessage type %ld, sdp %lu bytes, candidate %@, %lu candidates>",
+                                      (long)_type, (unsigned long)_sdp.length, _hasCandidate ? _candidateSdp : @"none",
+                                      (unsigned long)_candidates.count];
+}
+
+@end
+
+@implementation CustomSignalingCodec {
+    std::mutex _parserMutex;
+    custom::SignalingParser _parser;
+    std::string _textScratch;
+    std::mutex _writerMutex;
+    custom::SignalingWriter _writer;
+    std::string _sdpScratch;
+    std::string _midScratch;
+    // Strings and views of encodeCandidates:'s candidates.
+    std::string _candidatesScratch;
+    std::vector<size_t> _candidateOffsets;
+    std::vector<custom::SignalingCandidate> _candidates;
+}
+
+- (nullable CustomSignalingMessage *)decodeMessageFromUTF8:(const uint8_t *)bytes length:(NSUInteger)length {
+    std::lock_guard<std::mutex> lock(_parserMutex);
+    custom::SignalingMessage message;
+    if (!_parser.Parse(std::string_view(reinterpret_cast<const char *>(bytes), length), &message)) {
+        DLog(@"CustomSignalingCodec: %s at offset %zu", _parser.error(), _parser.error_offset());
+        return nil;
+    }
+    return [[CustomSignalingMessage alloc] initWithMessage:message];
+}
+
+- (nullable CustomSignalingMessage *)decodeMessageFromString:(NSString *)text {
+    std::lock_guard<std::mutex> lock(_parserMutex);
+    custom::SignalingMessage message;
+    if (!_parser.Parse(UTF8OfString(text, &_textScratch), &message)) {
+        DLog(@"CustomSignalingCodec: %s at offset %zu", _parser.error(), _parser.error_offset());
+        return nil;
+    }
+    return [[CustomSignalingMessage alloc] initWithMessage:message];
+}
+
+- (NSString *)encodeSessionDescription:(NSString *)sdp type:(CustomSignalingMessageType)type {
+    return [self encodeSessionDescription:sdp type:type advertisesCandidateBatches:NO];
+}
+
+- (NSString *)encodeSessionDescription:(NSString *)sdp
+                                  type:(CustomSignalingMessageType)type
+            advertisesCandidateBatches:(BOOL)advertisesCandidateBatches {
+    return [self encodeSessionDescription:sdp
+                                     type:type
+               advertisesCandidateBatches:advertisesCandidateBatches
+                     advertisesDataFrames:NO];
+}
+
+- (NSString *)encodeSessionDescription:(NSString *)sdp
+                                  type:(CustomSignalingMessageType)type
+            advertisesCandidateBatches:(BOOL)advertisesCandidateBatches
+                  advertisesDataFrames:(BOOL)advertisesDataFrames {
+    std::lock_guard<std::mutex> lock(_writerMutex);
+    custom::SignalingMessage message;
+    message.type = CoreTypeOfType(type);
+    message.has_session_description = true;
+    message.sdp = UTF8OfString(sdp, &_sdpScratch);
+    message.supports_candidate_batches = advertisesCandidateBatches;
+    message.supports_data_frames = advertisesDataFrames;
+    return StringOfUTF8(_writer.Write(message));
+}
+
+- (NSString *)encodeCandidate:(NSString *)sdp sdpMLineIndex:(int32_t)sdpMLineIndex sdpMid:(nullable NSString *)sdpMid {
+    std::lock_guard<std::mutex> lock(_writerMutex);
+    custom::SignalingMessage message;
+    message.type = custom::SignalingMessageType::kCandidate;
+    message.has_candidate = true;
+    message.candidate.sdp = UTF8OfString(sdp, &_sdpScratch);
+    message.candidate.sdp_mline_index = sdpMLineIndex;
+    if (sdpMid) {
+        message.candidate.has_sdp_mid = true;
+        message.candidate.sdp_mid = UTF8OfString(sdpMid, &_midScratch);
+    }
+    return StringOfUTF8(_writer.Write(message));
+}
+
+- (NSString *)encodeCandidates:(NSArray<CustomSignalingCandidate *> *)candidates {
+    std::lock_guard<std::mutex> lock(_writerMutex);
+    // Every string is appended to one buffer first, the views are taken once it stops growing.
+    _candidatesScratch.clear();
+    _candidateOffsets.clear();
+    for (CustomSignalingCandidate *candidate in candidates) {
+        _candidateOffsets.push_back(_candidatesScratch.size());
+        _candidatesScratch.append(UTF8OfString(candidate.sdp, &_sdpScratch));
+        _candidateOffsets.push_back(_candidatesScratch.size());
+        if (candidate.sdpMid) {
+            _candidatesScratch.append(UTF8OfString(candidate.sdpMid, &_midScratch));
+        }
+        _candidateOffsets.push_back(_candidatesScratch.size());
+    }
+    _candidates.clear();
+    const char *base = _candidatesScratch.data();
+    NSUInteger index = 0;
+    for (CustomSignalingCandidate *candidate in candidates) {
+        const size_t *offsets = &_candidateOffsets[index++ * 3];
+        custom::SignalingCandidate view;
+        view.sdp = std::string_view(base + offsets[0], offsets[1] - offsets[0]);
+        view.sdp_mline_index = candidate.sdpMLineIndex;
+        view.has_sdp_mid = candidate.sdpMid != nil;
+        view.sdp_mid = std::string_view(base + offsets[1], offsets[2] - offsets[1]);
+        _candidates.push_back(view);
+    }
+    custom::SignalingMessage message;
+    message.type = custom::SignalingMessageType::kCandidates;
+    message.candidates = _candidates.data();
+    message.candidate_count = _candidates.size();
+    return StringOfUTF8(_writer.Write(message));
+}
+
+@end
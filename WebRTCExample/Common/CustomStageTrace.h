@@ -0,0 +1,50 @@
+//
+//  CustomStageTrace.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/26.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Mirrors custom::TraceStage.
+typedef NS_ENUM(NSInteger, CustomTraceStage) {
+    /// Waiting between capture and the start of processing.
+    CustomTraceStageQueue,
+    CustomTraceStageUpload,
+    CustomTraceStageDraw,
+    /// Waiting for the GPU to finish the frame.
+    CustomTraceStageReadback,
+    CustomTraceStageConversion,
+    /// Delivering the frame to the RTCVideoSource.
+    CustomTraceStageHandoff,
+};
+
+/// Per stage timings of the capture -> filter -> encode path, keyed by the frame's timeStampNs. Wraps the process wide
+/// custom::StageTrace that CustomPixelBufferProcesser records into; recording is lock free and costs nothing while
+/// disabled.
+@interface CustomStageTrace : NSObject
+
+@property(class, nonatomic, readonly) CustomStageTrace *sharedTrace NS_SWIFT_NAME(shared);
+
+/// Off by default.
+@property(nonatomic, assign, getter=isEnabled) BOOL enabled;
+
+/// Current time on the trace clock.
+@property(nonatomic, readonly) int64_t nowNs;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+- (void)recordStage:(CustomTraceStage)stage timeStampNs:(int64_t)timeStampNs beginNs:(int64_t)beginNs endNs:(int64_t)endNs
+    NS_SWIFT_NAME(record(_:timeStampNs:beginNs:endNs:));
+
+/// The recorded events in Chrome trace event format, for chrome://tracing or Perfetto.
+- (NSData *)chromeTraceJSON;
+
+- (BOOL)writeChromeTraceToURL:(NSURL *)url error:(NSError **)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,60 @@
+//
+//  CustomStageTrace.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/26.
+//
+
+#import "CustomStageTrace.h"
+
+#include <string>
+
+#include "StageTrace.h"
+
+static_assert(static_cast<int>(CustomTraceStageHandoff) == static_cast<int>(custom::TraceStage::kHandoff),
+              "CustomTraceStage must mirror custom::TraceStage");
+
+@implementation CustomStageTrace
+
++ (CustomStageTrace *)sharedTrace {
+    static CustomStageTrace *sharedTrace;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedTrace = [[CustomStageTrace alloc] initPrivate];
+    });
+    return sharedTrace;
+}
+
+- (instancetype)initPrivate {
+    return [super init];
+}
+
+- (BOOL)isEnabled {
+    return custom::StageTrace::Shared().enabled();
+}
+
+- (void)setEnabled:(BOOL)enabled {
+    custom::StageTrace::Shared().set_enabled(enabled);
+}
+
+- (int64_t)nowNs {
+    return custom::TraceNowNs();
+}
+
+- (void)recordStage:(CustomTraceStage)stage timeStampNs:(int64_t)timeStampNs beginNs:(int64_t)beginNs endNs:(int64_t)endNs {
+    if (stage < CustomTraceStageQueue || stage > CustomTraceStageHandoff) {
+        return;
+    }
+    custom::StageTrace::Shared().Record(static_cast<custom::TraceStage>(stage), timeStampNs, beginNs, endNs);
+}
+
+- (NSData *)chromeTraceJSON {
+    const std::string json = custom::StageTrace::Shared().ExportChromeTrace();
+    return [NSData dataWithBytes:json.data() length:json.size()];
+}
+
+- (BOOL)writeChromeTraceToURL:(NSURL *)url error:(NSError **)error {
+    return [[self chromeTraceJSON] writeToURL:url options:NSDataWritingAtomic error:error];
+}
+
+@end
@@ -0,0 +1,40 @@
+//
+//  CustomTemporalDenoiser.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/5.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreVideo/CoreVideo.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class CustomFrameHistory;
+
+/// Motion adaptive temporal denoise of 4:2:0 buffers ('420f', '420v', 'y420') on the CPU, see
+/// custom::ApplyTemporalDenoise. Each frame is averaged with the previous outputs, which the denoiser keeps in its
+/// own CustomFrameHistory; input buffers are never retained, so camera pools aren't starved. One stream, one thread
+/// at a time.
+@interface CustomTemporalDenoiser : NSObject
+
+/// Previous outputs averaged into every frame. Clamped to [1, 8], defaults to 2. Costs one pooled buffer each.
+@property(nonatomic, assign) NSUInteger historyDepth;
+
+/// Largest difference of a sample to its history still treated as noise rather than motion. Defaults to 10.
+@property(nonatomic, assign) uint8_t motionThreshold;
+
+/// The previous outputs, newest first.
+@property(nonatomic, readonly) CustomFrameHistory *history;
+
+/// Denoises |pixelBuffer| into a buffer of the same format from +[CustomPixelBufferPool sharedPool]. The history is
+/// ignored when the format or size changes. Returns nil for unsupported formats.
+/// Note: This function pass ownership of return value(CVPixelBufferRef) to the caller.
+- (nullable CVPixelBufferRef)denoisedPixelBuffer:(CVPixelBufferRef)pixelBuffer timeStampNs:(int64_t)timeStampNs CF_RETURNS_RETAINED;
+
+/// Forgets the previous outputs, e.g. on a scene cut.
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
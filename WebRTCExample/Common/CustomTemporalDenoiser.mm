@@ -0,0 +1,101 @@
+//
+//  CustomTemporalDenoiser.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/5.
+//
+
+#import "CustomTemporalDenoiser.h"
+#import "CustomFrameHistory.h"
+#import "CustomPixelBufferPool.h"
+#import "CustomPixelBufferUtils.h"
+
+#include "TemporalDenoise.h"
+
+namespace {
+
+const NSUInteger kDefaultHistoryDepth = 2;
+const uint8_t kDefaultMotionThreshold = 10;
+
+bool IsSameGeometry(CVPixelBufferRef a, CVPixelBufferRef b) {
+    return CVPixelBufferGetPixelFormatType(a) == CVPixelBufferGetPixelFormatType(b) &&
+           CVPixelBufferGetWidth(a) == CVPixelBufferGetWidth(b) &&
+           CVPixelBufferGetHeight(a) == CVPixelBufferGetHeight(b);
+}
+
+}  // namespace
+
+@implementation CustomTemporalDenoiser
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _motionThreshold = kDefaultMotionThreshold;
+        _history = [[CustomFrameHistory alloc] initWithCapacity:kDefaultHistoryDepth];
+    }
+    return self;
+}
+
+- (NSUInteger)historyDepth {
+    return _history.capacity;
+}
+
+- (void)setHistoryDepth:(NSUInteger)historyDepth {
+    if (historyDepth != _history.capacity) {
+        _history = [[CustomFrameHistory alloc] initWithCapacity:historyDepth];
+    }
+}
+
+- (void)reset {
+    [_history clear];
+}
+
+- (nullable CVPixelBufferRef)denoisedPixelBuffer:(CVPixelBufferRef)pixelBuffer timeStampNs:(int64_t)timeStampNs CF_RETURNS_RETAINED {
+    const OSType format = CVPixelBufferGetPixelFormatType(pixelBuffer);
+    const CGSize size = CGSizeMake(CVPixelBufferGetWidth(pixelBuffer), CVPixelBufferGetHeight(pixelBuffer));
+    CVPixelBufferRef targetPixelBuffer = [[CustomPixelBufferPool sharedPool] createPixelBuffer:format targetSize:size];
+    if (!targetPixelBuffer) {
+        return nil;
+    }
+
+    // Borrow the previous outputs; they are only read.
+    CVPixelBufferRef historyBuffers[custom::kMaxTemporalDenoiseFrames];
+    custom::Yuv420Image historyImages[custom::kMaxTemporalDenoiseFrames];
+    int historyCount = 0;
+    while (historyCount < custom::kMaxTemporalDenoiseFrames) {
+        CVPixelBufferRef historyBuffer = [_history copyPixelBufferAtAge:historyCount timeStampNs:NULL];
+        if (!historyBuffer) {
+            break;
+        }
+        // Outputs from before a format or size change are unusable, and so is everything older.
+        if (!IsSameGeometry(historyBuffer, pixelBuffer)) {
+            CVPixelBufferRelease(historyBuffer);
+            break;
+        }
+        CVPixelBufferLockBaseAddress(historyBuffer, kCVPixelBufferLock_ReadOnly);
+        historyBuffers[historyCount] = historyBuffer;
+        historyImages[historyCount] = [CustomPixelBufferUtils yuv420ImageOfPixelBuffer:historyBuffer];
+        historyCount++;
+    }
+
+    CVPixelBufferLockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+    CVPixelBufferLockBaseAddress(targetPixelBuffer, 0);
+    const custom::Yuv420Image source = [CustomPixelBufferUtils yuv420ImageOfPixelBuffer:pixelBuffer];
+    const custom::Yuv420Image target = [CustomPixelBufferUtils yuv420ImageOfPixelBuffer:targetPixelBuffer];
+    const bool success = custom::ApplyTemporalDenoise(source, historyImages, historyCount, _motionThreshold, target);
+    CVPixelBufferUnlockBaseAddress(targetPixelBuffer, 0);
+    CVPixelBufferUnlockBaseAddress(pixelBuffer, kCVPixelBufferLock_ReadOnly);
+    for (int i = 0; i < historyCount; i++) {
+        CVPixelBufferUnlockBaseAddress(historyBuffers[i], kCVPixelBufferLock_ReadOnly);
+        CVPixelBufferRelease(historyBuffers[i]);
+    }
+
+    if (!success) {
+        DLog(@"CustomTemporalDenoiser: can't denoise pixel format %u", (unsigned)format);
+        CVPixelBufferRelease(targetPixelBuffer);
+        return nil;
+    }
+    [_history pushPixelBuffer:targetPixelBuffer timeStampNs:timeStampNs];
+    return targetPixelBuffer;
+}
+
+@end
@@ -15,4 +15,20 @@ typedef NS_ENUM(NSInteger, CustomVideoRotation) {
     CustomVideoRotation_270 = 270,
 };
 
+/// YUV color matrix. Values match custom::YuvMatrix.
+typedef NS_ENUM(NSInteger, CustomColorMatrix) {
+    CustomColorMatrixBT601 = 0,
+    CustomColorMatrixBT709 = 1,
+    CustomColorMatrixBT2020 = 2,
+};
+
+/// Where CustomPixelBufferProcesser processes frames.
+typedef NS_ENUM(NSInteger, CustomProcessingPath) {
+    /// Whichever path measured cheaper for the effect and frame size.
+    CustomProcessingPathAutomatic = 0,
+    CustomProcessingPathGPU = 1,
+    /// Only for frames the shader has a CPU equivalent for, the others stay on the GPU.
+    CustomProcessingPathCPU = 2,
+};
+
 #endif /* CustomTypes_h */
@@ -0,0 +1,278 @@
+//
+//  BulkTransfer.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/13.
+//
+
+#include "BulkTransfer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace custom {
+
+BulkSender::BulkSender(const BulkSenderConfig &config, SendFunc send) : config_(config), send_(std::move(send)) {}
+
+bool BulkSender::Enqueue(uint16_t stream, const uint8_t *data, size_t size, std::shared_ptr<const void> owner,
+                         int64_t now_ns) {
+  if (size > UINT32_MAX || queued_bytes_ + size > config_.max_queued_bytes) {
+    stats_.rejected++;
+    return false;
+  }
+  Outgoing message;
+  message.stream = stream;
+  message.message_id = next_message_id_++;
+  message.data = data;
+  message.size = size;
+  message.owner = std::move(owner);
+  message.enqueued_ns = now_ns;
+  Stream &queue = streams_[stream];
+  if (queue.messages.empty()) {
+    rounds_[queue.config.priority].push_back(stream);
+  }
+  queue.messages.push_back(std::move(message));
+  queued_messages_++;
+  queued_bytes_ += size;
+  return true;
+}
+
+size_t BulkSender::Pump(uint64_t buffered_amount, int64_t now_ns) {
+  if (stalled_ && buffered_amount <= config_.low_water) {
+    stalled_ = false;
+  }
+  const size_t chunk_size = std::max<size_t>(config_.chunk_size, 1);
+  size_t sent = 0;
+  while (queued_messages_ > 0) {
+    Stream *stream = NextStream(buffered_amount);
+    if (!stream) {
+      if (!stalled_) {
+        stalled_ = true;
+        stats_.stalls++;
+      }
+      break;
+    }
+    Outgoing &message = stream->messages.front();
+    size_t payload = 0;
+    size_t frame_size = 0;
+    if (config_.framed) {
+      payload = std::min(chunk_size, message.size - message.offset);
+      DataFrameHeader header;
+      header.stream = message.stream;
+      header.sequence = next_sequence_;
+      header.message_id = message.message_id;
+      header.offset = static_cast<uint32_t>(message.offset);
+      header.message_size = static_cast<uint32_t>(message.size);
+      header.flags = (message.offset == 0 ? kDataFrameFirst : 0) |
+                     (message.offset + payload == message.size ? kDataFrameLast : 0);
+      frame_.resize(kDataFrameHeaderSize + payload);
+      WriteDataFrameHeader(header, frame_.data());
+      if (payload > 0) {
+        std::memcpy(frame_.data() + kDataFrameHeaderSize, message.data + message.offset, payload);
+      }
+      frame_size = frame_.size();
+      if (!send_(frame_.data(), frame_size, false)) {
+        stats_.send_failures++;
+        break;
+      }
+      next_sequence_++;
+    } else {
+      // The rest of the message, straight from the caller's bytes.
+      payload = message.size - message.offset;
+      frame_size = payload;
+      if (!send_(message.data + message.offset, payload, stream->config.text)) {
+        stats_.send_failures++;
+        break;
+      }
+    }
+
+    sent++;
+    buffered_amount += frame_size;
+    stream->deficit -= static_cast<int64_t>(frame_size);
+    message.offset += payload;
+    queued_bytes_ -= payload;
+    stats_.frames++;
+    stats_.bytes += payload;
+    if (stats_.first_frame_ns < 0) {
+      stats_.first_frame_ns = now_ns;
+    }
+    stats_.last_frame_ns = now_ns;
+    if (message.offset < message.size) {
+      continue;
+    }
+    const int64_t latency = now_ns - message.enqueued_ns;
+    stats_.messages++;
+    stats_.latency_sum_ns += latency;
+    stats_.latency_max_ns = std::max(stats_.latency_max_ns, latency);
+    stream->messages.pop_front();
+    queued_messages_--;
+    if (stream->messages.empty()) {
+      // NextStream() returned the front of its round.
+      auto round = rounds_.find(stream->config.priority);
+      round->second.pop_front();
+      if (round->second.empty()) {
+        rounds_.erase(round);
+      }
+      stream->deficit = 0;
+    }
+  }
+  return sent;
+}
+
+void BulkSender::Clear() {
+  for (auto &pair : streams_) {
+    pair.second.messages.clear();
+    pair.second.deficit = 0;
+  }
+  rounds_.clear();
+  queued_messages_ = 0;
+  queued_bytes_ = 0;
+  stalled_ = false;
+}
+
+void BulkSender::SetStreamConfig(uint16_t stream, const StreamConfig &config) {
+  Stream &queue = streams_[stream];
+  if (!queue.messages.empty() && queue.config.priority != config.priority) {
+    auto round = rounds_.find(queue.config.priority);
+    round->second.erase(std::find(round->second.begin(), round->second.end(), stream));
+    if (round->second.empty()) {
+      rounds_.erase(round);
+    }
+    rounds_[config.priority].push_back(stream);
+    queue.deficit = 0;
+  }
+  queue.config = config;
+}
+
+StreamConfig BulkSender::stream_config(uint16_t stream) const {
+  const auto it = streams_.find(stream);
+  return it == streams_.end() ? StreamConfig() : it->second.config;
+}
+
+BulkSender::Stream *BulkSender::NextStream(uint64_t buffered_amount) {
+  if (rounds_.empty()) {
+    return nullptr;
+  }
+  // Strict priority: only the most urgent streams with messages queued send.
+  auto &[priority, round] = *rounds_.begin();
+  const bool window_open = !stalled_ && buffered_amount < config_.high_water;
+  if (!window_open && !(priority == 0 && buffered_amount < config_.high_water + config_.urgent_headroom)) {
+    return nullptr;
+  }
+  // Deficit round robin. A quantum covers a full frame, so this ends within
+  // one turn around the round; an unframed message larger than a frame may
+  // take several.
+  for (;;) {
+    Stream &stream = streams_[round.front()];
+    const Outgoing &message = stream.messages.front();
+    const size_t rest = message.size - message.offset;
+    const int64_t cost = static_cast<int64_t>(
+        config_.framed ? kDataFrameHeaderSize + std::min(std::max<size_t>(config_.chunk_size, 1), rest) : rest);
+    if (stream.deficit >= cost) {
+      return &stream;
+    }
+    stream.deficit += Quantum(stream);
+    round.push_back(round.front());
+    round.pop_front();
+  }
+}
+
+int64_t BulkSender::Quantum(const Stream &stream) const {
+  const int64_t frame = static_cast<int64_t>(kDataFrameHeaderSize + std::max<size_t>(config_.chunk_size, 1));
+  return frame * std::max<uint32_t>(stream.config.weight, 1);
+}
+
+BulkReceiver::BulkReceiver(const BulkReceiverConfig &config, DeliverFunc deliver)
+    : config_(config), deliver_(std::move(deliver)) {}
+
+bool BulkReceiver::OnFrame(const uint8_t *frame, size_t size, int64_t now_ns) {
+  DataFrameHeader header;
+  if (!ReadDataFrameHeader(frame, size, &header, &error_)) {
+    stats_.malformed++;
+    return false;
+  }
+  if (have_sequence_ && header.sequence != next_sequence_) {
+    stats_.sequence_gaps++;
+  }
+  have_sequence_ = true;
+  next_sequence_ = header.sequence + 1;
+  stats_.frames++;
+  if (stats_.first_frame_ns < 0) {
+    stats_.first_frame_ns = now_ns;
+  }
+  stats_.last_frame_ns = now_ns;
+
+  const uint8_t *payload = frame + kDataFrameHeaderSize;
+  const size_t payload_size = size - kDataFrameHeaderSize;
+  ReceivedMessage message;
+  message.stream = header.stream;
+  message.message_id = header.message_id;
+  if (header.message_size > config_.max_message_size) {
+    error_ = "message too large";
+    stats_.dropped++;
+    return false;
+  }
+  if ((header.flags & (kDataFrameFirst | kDataFrameLast)) == (kDataFrameFirst | kDataFrameLast)) {
+    message.data = payload;
+    message.size = payload_size;
+    stats_.messages++;
+    stats_.bytes += payload_size;
+    deliver_(message);
+    return true;
+  }
+
+  const uint64_t key = static_cast<uint64_t>(header.stream) << 32 | header.message_id;
+  auto it = pending_.find(key);
+  if (header.flags & kDataFrameFirst) {
+    if (it != pending_.end()) {
+      // The sender restarted its message ids; the old message won't finish.
+      pending_bytes_ -= it->second.buffer->size;
+      pending_.erase(it);
+      stats_.dropped++;
+    }
+    if (pending_.size() >= config_.max_pending_messages) {
+      error_ = "too many messages being reassembled";
+      stats_.dropped++;
+      return false;
+    }
+    Pending pending;
+    pending.buffer = pool_.Acquire(header.message_size);
+    pending.first_frame_ns = now_ns;
+    it = pending_.emplace(key, std::move(pending)).first;
+    pending_bytes_ += header.message_size;
+    stats_.pending_bytes_max = std::max(stats_.pending_bytes_max, pending_bytes_);
+  } else if (it == pending_.end() || it->second.received != header.offset ||
+             it->second.buffer->size != header.message_size) {
+    error_ = "chunk of a message not being reassembled";
+    stats_.dropped++;
+    return false;
+  }
+
+  Pending &pending = it->second;
+  std::memcpy(pending.buffer->data + header.offset, payload, payload_size);
+  pending.received += payload_size;
+  stats_.bytes += payload_size;
+  if (!(header.flags & kDataFrameLast)) {
+    return true;
+  }
+  const int64_t latency = now_ns - pending.first_frame_ns;
+  stats_.messages++;
+  stats_.latency_sum_ns += latency;
+  stats_.latency_max_ns = std::max(stats_.latency_max_ns, latency);
+  message.buffer = std::move(pending.buffer);
+  message.data = message.buffer->data;
+  message.size = message.buffer->size;
+  pending_bytes_ -= message.size;
+  pending_.erase(it);
+  deliver_(message);
+  return true;
+}
+
+void BulkReceiver::Reset() {
+  pending_.clear();
+  pending_bytes_ = 0;
+  have_sequence_ = false;
+}
+
+}  // namespace custom
@@ -0,0 +1,271 @@
+//
+//  BulkTransfer.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/13.
+//
+
+#ifndef BulkTransfer_h
+#define BulkTransfer_h
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "DataFrame.h"
+#include "MessageBufferPool.h"
+
+namespace custom {
+
+struct BulkSenderConfig {
+  // Payload bytes per frame. 16 KiB is the largest message every WebRTC
+  // stack takes without an a=max-message-size.
+  size_t chunk_size = 16 * 1024;
+  // The send window: frames are handed to the channel while its
+  // bufferedAmount stays below |high_water|, and once it reached that, not
+  // until it drained to |low_water|. Large enough to keep the link busy while
+  // a bufferedAmount change reaches the sender, small enough that what SCTP
+  // holds, which an urgent message waits for, drains in tens of milliseconds.
+  uint64_t high_water = 256 << 10;
+  uint64_t low_water = 64 << 10;
+  // How far past |high_water| streams of priority 0 may still send, so a
+  // control message waits for what SCTP holds, not for the window to drain.
+  uint64_t urgent_headroom = 64 << 10;
+  // Enqueue() refuses messages past this many queued bytes.
+  size_t max_queued_bytes = 64 << 20;
+  // Whether the peer takes frames, which it advertised while connecting. If
+  // not, every message is handed to the channel whole and without a header,
+  // as plain data channel messages; streams are still scheduled by their
+  // StreamConfig, a message at a time. Change it while no message is partly
+  // sent, e.g. before the channel opens.
+  bool framed = true;
+};
+
+struct BulkSenderStats {
+  uint64_t messages = 0;
+  // Unframed messages count as a frame each.
+  uint64_t frames = 0;
+  // Payload bytes handed to the channel, headers not included.
+  uint64_t bytes = 0;
+  // Messages Enqueue() refused.
+  uint64_t rejected = 0;
+  // Times the window filled, and times the channel refused a frame.
+  uint64_t stalls = 0;
+  uint64_t send_failures = 0;
+  // Time between Enqueue() and the last frame of a message being sent.
+  int64_t latency_sum_ns = 0;
+  int64_t latency_max_ns = 0;
+  // First and last frame sent, -1 before the first.
+  int64_t first_frame_ns = -1;
+  int64_t last_frame_ns = -1;
+
+  int64_t mean_latency_ns() const { return messages ? latency_sum_ns / static_cast<int64_t>(messages) : 0; }
+  double bytes_per_second() const {
+    return last_frame_ns > first_frame_ns ? bytes * 1e9 / (last_frame_ns - first_frame_ns) : 0;
+  }
+};
+
+// How BulkSender shares the channel between streams.
+struct StreamConfig {
+  // Lower is more urgent. A stream only sends while no stream of a more
+  // urgent priority has a frame ready, so a small message on an urgent
+  // stream goes out between two chunks of a large one on a bulk stream.
+  uint8_t priority = 1;
+  // Streams of the same priority share the channel in proportion to their
+  // weights, by deficit round robin over frame sizes.
+  uint32_t weight = 1;
+  // Whether the stream's messages are text. Unframed, they are sent as text
+  // data channel messages rather than binary ones; frames are always binary.
+  bool text = false;
+};
+
+// Sends messages of any size over a data channel as kDataFrameHeaderSize
+// framed chunks, never letting the channel's bufferedAmount grow past the
+// window. A message that doesn't fit the channel's max message size or
+// arrives while the channel is still connecting is queued instead of failing
+// or being dropped. To a peer that doesn't take frames, with
+// BulkSenderConfig::framed off, messages are paced and queued the same way
+// but sent whole.
+//
+// Every stream is a queue of its own, with messages sent in order; chunks of
+// different streams interleave as their StreamConfig says. Streams not
+// configured get the default one.
+//
+// The caller reports the channel's bufferedAmount: call Pump() after
+// Enqueue(), when the channel opens and whenever bufferedAmount changes.
+// Doesn't copy message data; not thread safe.
+class BulkSender {
+ public:
+  // Hands one frame, or an unframed message, to the channel, valid for the
+  // call only; |text| is set for unframed messages of a text stream. Returns
+  // false if the channel can't take it now, e.g. isn't open; it is offered
+  // again on the next Pump().
+  using SendFunc = std::function<bool(const uint8_t *frame, size_t size, bool text)>;
+
+  BulkSender(const BulkSenderConfig &config, SendFunc send);
+  BulkSender(const BulkSender &) = delete;
+  BulkSender &operator=(const BulkSender &) = delete;
+
+  // Queues the |size| bytes at |data| as one message on |stream|, enqueued at
+  // |now_ns|. |owner| keeps them alive until the message is sent. Returns
+  // false if the queue is full or the message is 4 GiB or larger.
+  bool Enqueue(uint16_t stream, const uint8_t *data, size_t size, std::shared_ptr<const void> owner,
+               int64_t now_ns);
+
+  // Sends frames while the channel's |buffered_amount| leaves room in the
+  // window. Returns the number of frames sent.
+  size_t Pump(uint64_t buffered_amount, int64_t now_ns);
+
+  // Drops the queued messages, e.g. when the channel closed. Stream configs
+  // are kept.
+  void Clear();
+
+  // Takes effect with the next frame of |stream|.
+  void SetStreamConfig(uint16_t stream, const StreamConfig &config);
+  // The config of |stream|, the default one if it wasn't set.
+  StreamConfig stream_config(uint16_t stream) const;
+
+  // Takes effect with the next Pump().
+  void set_config(const BulkSenderConfig &config) { config_ = config; }
+  const BulkSenderConfig &config() const { return config_; }
+
+  size_t queued_messages() const { return queued_messages_; }
+  size_t queued_bytes() const { return queued_bytes_; }
+  const BulkSenderStats &stats() const { return stats_; }
+
+ private:
+  struct Outgoing {
+    uint16_t stream = 0;
+    uint32_t message_id = 0;
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    size_t offset = 0;
+    std::shared_ptr<const void> owner;
+    int64_t enqueued_ns = 0;
+  };
+
+  struct Stream {
+    StreamConfig config;
+    std::deque<Outgoing> messages;
+    // Bytes the stream may still send in its round.
+    int64_t deficit = 0;
+  };
+
+  // The stream the next frame is sent from at |buffered_amount|, or null if
+  // the window is closed to every stream with messages queued.
+  Stream *NextStream(uint64_t buffered_amount);
+  int64_t Quantum(const Stream &stream) const;
+
+  BulkSenderConfig config_;
+  SendFunc send_;
+  std::unordered_map<uint16_t, Stream> streams_;
+  // Ids of the streams with messages queued, by priority, in round order.
+  std::map<uint8_t, std::deque<uint16_t>> rounds_;
+  size_t queued_messages_ = 0;
+  size_t queued_bytes_ = 0;
+  // Header and payload of the frame being sent.
+  std::vector<uint8_t> frame_;
+  uint32_t next_message_id_ = 0;
+  uint32_t next_sequence_ = 0;
+  // Whether the window filled and hasn't drained to low water since.
+  bool stalled_ = false;
+  BulkSenderStats stats_;
+};
+
+struct BulkReceiverConfig {
+  // Larger messages are dropped.
+  size_t max_message_size = 64 << 20;
+  // Messages being reassembled at once; the first chunk of another is dropped.
+  size_t max_pending_messages = 16;
+};
+
+struct BulkReceiverStats {
+  uint64_t frames = 0;
+  uint64_t messages = 0;
+  // Payload bytes received, headers not included.
+  uint64_t bytes = 0;
+  // Frames that weren't frames, and frames of messages that were dropped.
+  uint64_t malformed = 0;
+  uint64_t dropped = 0;
+  // Jumps in the frame sequence number. The channel is reliable and ordered,
+  // so any gap means a sender bug or a channel that isn't.
+  uint64_t sequence_gaps = 0;
+  // Largest total size of the messages being reassembled at once.
+  size_t pending_bytes_max = 0;
+  // Time between the first and the last frame of a message.
+  int64_t latency_sum_ns = 0;
+  int64_t latency_max_ns = 0;
+  int64_t first_frame_ns = -1;
+  int64_t last_frame_ns = -1;
+
+  int64_t mean_latency_ns() const { return messages ? latency_sum_ns / static_cast<int64_t>(messages) : 0; }
+  double bytes_per_second() const {
+    return last_frame_ns > first_frame_ns ? bytes * 1e9 / (last_frame_ns - first_frame_ns) : 0;
+  }
+};
+
+// A message BulkReceiver reassembled. |data| points into the frame it came in
+// for a single frame message and |buffer| is null; otherwise it points into
+// |buffer|, which the receiver keeps no reference to.
+struct ReceivedMessage {
+  uint16_t stream = 0;
+  uint32_t message_id = 0;
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+  std::shared_ptr<MessageBuffer> buffer;
+};
+
+// Reassembles BulkSender's frames into messages, copying every chunk once,
+// straight into a pooled buffer of the message's size. Chunks of messages on
+// different streams may interleave; those of one message arrive in order.
+// Not thread safe.
+class BulkReceiver {
+ public:
+  // Receives every message; |message.data| of a single frame message is
+  // valid for the call only, keep |message.buffer| or copy it.
+  using DeliverFunc = std::function<void(const ReceivedMessage &message)>;
+
+  BulkReceiver(const BulkReceiverConfig &config, DeliverFunc deliver);
+  BulkReceiver(const BulkReceiver &) = delete;
+  BulkReceiver &operator=(const BulkReceiver &) = delete;
+
+  // Takes the |size| byte frame at |frame|, received at |now_ns|, and
+  // delivers its message if the frame completes it. Returns false if it isn't
+  // a frame or its message was dropped; error() then says why.
+  bool OnFrame(const uint8_t *frame, size_t size, int64_t now_ns);
+
+  // Drops the messages being reassembled, e.g. when the channel closed.
+  void Reset();
+
+  const char *error() const { return error_; }
+  size_t pending_messages() const { return pending_.size(); }
+  const BulkReceiverStats &stats() const { return stats_; }
+  MessageBufferPool &pool() { return pool_; }
+
+ private:
+  struct Pending {
+    std::shared_ptr<MessageBuffer> buffer;
+    size_t received = 0;
+    int64_t first_frame_ns = 0;
+  };
+
+  BulkReceiverConfig config_;
+  DeliverFunc deliver_;
+  MessageBufferPool pool_;
+  // Keyed by stream << 32 | message id.
+  std::unordered_map<uint64_t, Pending> pending_;
+  size_t pending_bytes_ = 0;
+  bool have_sequence_ = false;
+  uint32_t next_sequence_ = 0;
+  const char *error_ = "";
+  BulkReceiverStats stats_;
+};
+
+}  // namespace custom
+
+#endif /* BulkTransfer_h */
@@ -0,0 +1,73 @@
+//
+//  DataFrame.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/13.
+//
+
+#include "DataFrame.h"
+
+namespace custom {
+namespace {
+
+void Store16(uint16_t value, uint8_t *out) {
+  out[0] = static_cast<uint8_t>(value);
+  out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void Store32(uint32_t value, uint8_t *out) {
+  out[0] = static_cast<uint8_t>(value);
+  out[1] = static_cast<uint8_t>(value >> 8);
+  out[2] = static_cast<uint8_t>(value >> 16);
+  out[3] = static_cast<uint8_t>(value >> 24);
+}
+
+uint16_t Load16(const uint8_t *in) { return static_cast<uint16_t>(in[0] | in[1] << 8); }
+
+uint32_t Load32(const uint8_t *in) {
+  return static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 | static_cast<uint32_t>(in[2]) << 16 |
+         static_cast<uint32_t>(in[3]) << 24;
+}
+
+}  // namespace
+
+void WriteDataFrameHeader(const DataFrameHeader &header, uint8_t *out) {
+  out[0] = kDataFrameMagic;
+  out[1] = static_cast<uint8_t>(kDataFrameVersion << 4 | (header.flags & 0x0F));
+  Store16(header.stream, out + 2);
+  Store32(header.sequence, out + 4);
+  Store32(header.message_id, out + 8);
+  Store32(header.offset, out + 12);
+  Store32(header.message_size, out + 16);
+}
+
+bool ReadDataFrameHeader(const uint8_t *frame, size_t size, DataFrameHeader *header, const char **error) {
+  if (size < kDataFrameHeaderSize || frame[0] != kDataFrameMagic) {
+    *error = "not a data frame";
+    return false;
+  }
+  if (frame[1] >> 4 != kDataFrameVersion) {
+    *error = "unsupported data frame version";
+    return false;
+  }
+  header->flags = frame[1] & 0x0F;
+  header->stream = Load16(frame + 2);
+  header->sequence = Load32(frame + 4);
+  header->message_id = Load32(frame + 8);
+  header->offset = Load32(frame + 12);
+  header->message_size = Load32(frame + 16);
+
+  const uint64_t end = static_cast<uint64_t>(header->offset) + (size - kDataFrameHeaderSize);
+  if (end > header->message_size) {
+    *error = "chunk past the end of its message";
+    return false;
+  }
+  if (((header->flags & kDataFrameFirst) != 0) != (header->offset == 0) ||
+      ((header->flags & kDataFrameLast) != 0) != (end == header->message_size)) {
+    *error = "chunk flags don't match its offset";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace custom
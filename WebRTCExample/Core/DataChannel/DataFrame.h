@@ -0,0 +1,55 @@
+//
+//  DataFrame.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/13.
+//
+
+#ifndef DataFrame_h
+#define DataFrame_h
+
+#include <cstddef>
+#include <cstdint>
+
+namespace custom {
+
+// Every binary data channel message BulkSender sends is one frame: this
+// header, little endian, then a chunk of a message.
+//
+//    0  u8   kDataFrameMagic
+//    1  u8   version << 4 | flags
+//    2  u16  stream
+//    4  u32  sequence number of the frame on the channel
+//    8  u32  message id, per sender
+//   12  u32  offset of the chunk in the message
+//   16  u32  message size
+//
+// A message of up to 4 GiB - 1 is split into chunks sent in order; one that
+// fits a single frame has both kDataFrameFirst and kDataFrameLast set.
+constexpr size_t kDataFrameHeaderSize = 20;
+constexpr uint8_t kDataFrameMagic = 0xCB;
+constexpr uint8_t kDataFrameVersion = 1;
+
+constexpr uint8_t kDataFrameFirst = 0x1;
+constexpr uint8_t kDataFrameLast = 0x2;
+
+struct DataFrameHeader {
+  uint8_t flags = 0;
+  uint16_t stream = 0;
+  uint32_t sequence = 0;
+  uint32_t message_id = 0;
+  uint32_t offset = 0;
+  uint32_t message_size = 0;
+};
+
+// Writes |header| to the kDataFrameHeaderSize bytes at |out|.
+void WriteDataFrameHeader(const DataFrameHeader &header, uint8_t *out);
+
+// Reads the header of the |size| byte frame at |frame|. Returns false if it
+// isn't a frame of this version, or its chunk doesn't fit its message or its
+// flags; |error| then says why, as a static string.
+bool ReadDataFrameHeader(const uint8_t *frame, size_t size, DataFrameHeader *header, const char **error);
+
+}  // namespace custom
+
+#endif /* DataFrame_h */
@@ -0,0 +1,133 @@
+//
+//  MessageBufferPool.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/13.
+//
+
+#include "MessageBufferPool.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace custom {
+
+namespace {
+
+constexpr int kMinClassShift = 12;
+constexpr int kClassCount = 64 - kMinClassShift;
+
+// Index of the smallest size class holding |size| bytes.
+int SizeClass(size_t size) {
+  int shift = kMinClassShift;
+  while (shift < 63 && (size_t{1} << shift) < size) {
+    shift++;
+  }
+  return shift - kMinClassShift;
+}
+
+MessageBuffer *AllocateBuffer(size_t capacity) {
+  MessageBuffer *buffer = new MessageBuffer();
+  buffer->data = new uint8_t[capacity];
+  buffer->capacity = capacity;
+  return buffer;
+}
+
+void FreeBuffer(MessageBuffer *buffer) {
+  delete[] buffer->data;
+  delete buffer;
+}
+
+}  // namespace
+
+struct MessageBufferPool::State {
+  std::mutex mutex;
+  const size_t max_idle_per_class;
+  const size_t max_pooled_size;
+  std::vector<MessageBuffer *> idle[kClassCount];
+  MessageBufferPoolStats stats;
+
+  State(size_t max_idle, size_t max_pooled) : max_idle_per_class(max_idle), max_pooled_size(max_pooled) {}
+
+  ~State() {
+    for (std::vector<MessageBuffer *> &buffers : idle) {
+      for (MessageBuffer *buffer : buffers) {
+        FreeBuffer(buffer);
+      }
+    }
+  }
+};
+
+MessageBufferPool::MessageBufferPool(size_t max_idle_per_class, size_t max_pooled_size)
+    : state_(std::make_shared<State>(max_idle_per_class, max_pooled_size)) {}
+
+MessageBufferPool::~MessageBufferPool() = default;
+
+std::shared_ptr<MessageBuffer> MessageBufferPool::Acquire(size_t size) {
+  const bool pooled = size <= state_->max_pooled_size;
+  const int size_class = SizeClass(size);
+  MessageBuffer *buffer = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    std::vector<MessageBuffer *> &idle = state_->idle[size_class];
+    if (pooled && !idle.empty()) {
+      buffer = idle.back();
+      idle.pop_back();
+      state_->stats.hits++;
+    } else {
+      state_->stats.misses++;
+    }
+    state_->stats.in_use++;
+    state_->stats.high_water = std::max(state_->stats.high_water, state_->stats.in_use);
+  }
+  if (!buffer) {
+    // Allocated outside the lock; a large buffer takes a while to map.
+    buffer = AllocateBuffer(pooled ? size_t{1} << (size_class + kMinClassShift) : std::max<size_t>(size, 1));
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->stats.allocated_bytes += buffer->capacity;
+  }
+  buffer->size = size;
+
+  std::weak_ptr<State> weak_state = state_;
+  return std::shared_ptr<MessageBuffer>(buffer, [weak_state, pooled, size_class](MessageBuffer *buffer) {
+    std::shared_ptr<State> state = weak_state.lock();
+    if (!state) {
+      FreeBuffer(buffer);
+      return;
+    }
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->stats.in_use--;
+    if (pooled && state->idle[size_class].size() < state->max_idle_per_class) {
+      state->idle[size_class].push_back(buffer);
+    } else {
+      state->stats.allocated_bytes -= buffer->capacity;
+      FreeBuffer(buffer);
+    }
+  });
+}
+
+void MessageBufferPool::Flush() {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  for (std::vector<MessageBuffer *> &buffers : state_->idle) {
+    for (MessageBuffer *buffer : buffers) {
+      state_->stats.allocated_bytes -= buffer->capacity;
+      FreeBuffer(buffer);
+    }
+    buffers.clear();
+  }
+}
+
+MessageBufferPoolStats MessageBufferPool::stats() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->stats;
+}
+
+void MessageBufferPool::ResetStats() {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  state_->stats.hits = 0;
+  state_->stats.misses = 0;
+  state_->stats.high_water = state_->stats.in_use;
+}
+
+}  // namespace custom
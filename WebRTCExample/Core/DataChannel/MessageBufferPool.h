@@ -0,0 +1,72 @@
+//
+//  MessageBufferPool.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/13.
+//
+
+#ifndef MessageBufferPool_h
+#define MessageBufferPool_h
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace custom {
+
+// A message buffer handed out by MessageBufferPool. |capacity| is |size|
+// rounded up to the buffer's size class. The memory goes back to the pool when
+// the last std::shared_ptr reference is dropped.
+struct MessageBuffer {
+  uint8_t *data = nullptr;
+  size_t size = 0;
+  size_t capacity = 0;
+};
+
+struct MessageBufferPoolStats {
+  // Acquire() calls served from a recycled buffer.
+  uint64_t hits = 0;
+  // Acquire() calls that had to allocate.
+  uint64_t misses = 0;
+  // Buffers currently handed out.
+  size_t in_use = 0;
+  // Largest |in_use| seen.
+  size_t high_water = 0;
+  // Bytes currently owned by the pool, both in use and idle.
+  size_t allocated_bytes = 0;
+};
+
+// Pool of message buffers in power of two size classes from 4 KiB, so messages
+// of similar size share buffers. Thread safe: buffers may be acquired on one
+// thread and released on another, and may outlive the pool.
+class MessageBufferPool {
+ public:
+  static constexpr size_t kDefaultMaxIdlePerClass = 4;
+  // Messages larger than this aren't pooled, they are allocated and freed.
+  static constexpr size_t kDefaultMaxPooledSize = 16 << 20;
+
+  explicit MessageBufferPool(size_t max_idle_per_class = kDefaultMaxIdlePerClass,
+                             size_t max_pooled_size = kDefaultMaxPooledSize);
+  ~MessageBufferPool();
+
+  MessageBufferPool(const MessageBufferPool &) = delete;
+  MessageBufferPool &operator=(const MessageBufferPool &) = delete;
+
+  // Returns a buffer of |size| bytes. The content of a recycled buffer is
+  // undefined.
+  std::shared_ptr<MessageBuffer> Acquire(size_t size);
+
+  // Frees all idle buffers. Buffers in use are unaffected.
+  void Flush();
+
+  MessageBufferPoolStats stats() const;
+  void ResetStats();
+
+ private:
+  struct State;
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace custom
+
+#endif /* MessageBufferPool_h */
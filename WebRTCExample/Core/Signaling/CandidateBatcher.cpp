@@ -0,0 +1,157 @@
+//
+//  CandidateBatcher.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/11.
+//
+
+#include "CandidateBatcher.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace custom {
+namespace {
+
+// Appends |field| to |key|, optionally ASCII case folded, after its length so
+// fields can't run into each other whatever bytes they hold.
+void AppendField(std::string_view field, bool fold_case, std::string *key) {
+  const uint32_t size = static_cast<uint32_t>(field.size());
+  key->append(reinterpret_cast<const char *>(&size), sizeof(size));
+  for (char c : field) {
+    if (fold_case && c >= 'A' && c <= 'Z') {
+      c = static_cast<char>(c - 'A' + 'a');
+    }
+    key->push_back(c);
+  }
+}
+
+// Splits off the next space separated token of |line|.
+std::string_view NextToken(std::string_view *line) {
+  const size_t begin = std::min(line->find_first_not_of(' '), line->size());
+  line->remove_prefix(begin);
+  const size_t end = std::min(line->find(' '), line->size());
+  const std::string_view token = line->substr(0, end);
+  line->remove_prefix(end);
+  return token;
+}
+
+}  // namespace
+
+void CandidateAddressKey(const SignalingCandidate &candidate, std::string *key) {
+  key->clear();
+  const int32_t index = candidate.sdp_mline_index;
+  AppendField(std::string_view(reinterpret_cast<const char *>(&index), sizeof(index)), false, key);
+  key->push_back(candidate.has_sdp_mid ? 'm' : '-');
+  AppendField(candidate.has_sdp_mid ? candidate.sdp_mid : std::string_view(), false, key);
+
+  // candidate:<foundation> <component> <transport> <priority> <address> <port> typ <type> [<name> <value>]...
+  std::string_view line = candidate.sdp;
+  if (line.substr(0, 2) == "a=") {
+    line.remove_prefix(2);
+  }
+  std::string_view tokens[8];
+  for (std::string_view &token : tokens) {
+    token = NextToken(&line);
+  }
+  if (tokens[0].substr(0, 10) != "candidate:" || tokens[7].empty() || tokens[6] != "typ") {
+    // Marked, so an unparsed line can't equal the fields of a parsed one.
+    key->push_back('u');
+    AppendField(candidate.sdp, false, key);
+    return;
+  }
+  key->push_back('p');
+  AppendField(tokens[1], false, key);
+  AppendField(tokens[2], true, key);
+  AppendField(tokens[4], true, key);
+  AppendField(tokens[5], false, key);
+  for (;;) {
+    const std::string_view name = NextToken(&line);
+    const std::string_view value = NextToken(&line);
+    if (name.empty()) {
+      break;
+    }
+    if (name == "tcptype") {
+      AppendField(value, true, key);
+    }
+  }
+}
+
+CandidateBatcher::CandidateBatcher(const CandidateBatcherConfig &config, SendFunc send)
+    : config_(config), send_(std::move(send)) {}
+
+bool CandidateBatcher::Add(const SignalingCandidate &candidate, int64_t now_ns) {
+  ++stats_.candidates;
+  CandidateAddressKey(candidate, &key_);
+  if (seen_.count(key_) != 0) {
+    ++stats_.duplicates;
+    return false;
+  }
+  seen_.insert(key_);
+  // Send what there is first if this candidate would overflow it.
+  if (!pending_.empty() && arena_.size() + candidate.sdp.size() > config_.max_bytes) {
+    Flush(now_ns);
+  }
+  if (pending_.empty()) {
+    deadline_ns_ = now_ns + config_.window_ns;
+  }
+  Pending entry;
+  entry.sdp_offset = arena_.size();
+  entry.sdp_size = candidate.sdp.size();
+  arena_.append(candidate.sdp);
+  entry.has_sdp_mid = candidate.has_sdp_mid;
+  if (candidate.has_sdp_mid) {
+    entry.mid_offset = arena_.size();
+    entry.mid_size = candidate.sdp_mid.size();
+    arena_.append(candidate.sdp_mid);
+  }
+  entry.sdp_mline_index = candidate.sdp_mline_index;
+  entry.added_ns = now_ns;
+  pending_.push_back(entry);
+
+  if (config_.window_ns <= 0 || pending_.size() >= config_.max_candidates || arena_.size() >= config_.max_bytes) {
+    Flush(now_ns);
+  }
+  return true;
+}
+
+void CandidateBatcher::Poll(int64_t now_ns) {
+  if (!pending_.empty() && now_ns >= deadline_ns_) {
+    Flush(now_ns);
+  }
+}
+
+void CandidateBatcher::Flush(int64_t now_ns) {
+  if (pending_.empty()) {
+    return;
+  }
+  // The arena doesn't change from here on, views into it are stable.
+  batch_.clear();
+  for (const Pending &entry : pending_) {
+    SignalingCandidate candidate;
+    candidate.sdp = std::string_view(arena_.data() + entry.sdp_offset, entry.sdp_size);
+    candidate.sdp_mline_index = entry.sdp_mline_index;
+    candidate.has_sdp_mid = entry.has_sdp_mid;
+    if (entry.has_sdp_mid) {
+      candidate.sdp_mid = std::string_view(arena_.data() + entry.mid_offset, entry.mid_size);
+    }
+    batch_.push_back(candidate);
+
+    const int64_t latency_ns = now_ns - entry.added_ns;
+    stats_.latency_sum_ns += latency_ns;
+    stats_.latency_max_ns = std::max(stats_.latency_max_ns, latency_ns);
+  }
+  ++stats_.batches;
+  stats_.sent += pending_.size();
+  stats_.max_batch = std::max(stats_.max_batch, pending_.size());
+
+  send_(batch_.data(), batch_.size());
+  pending_.clear();
+  arena_.clear();
+}
+
+void CandidateBatcher::Reset() {
+  seen_.clear();
+}
+
+}  // namespace custom
@@ -0,0 +1,128 @@
+//
+//  CandidateBatcher.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/11.
+//
+
+#ifndef CandidateBatcher_h
+#define CandidateBatcher_h
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "SignalingCodec.h"
+
+namespace custom {
+
+struct CandidateBatcherConfig {
+  // A batch is sent this long after its first candidate at the latest; 0
+  // sends every candidate on its own.
+  int64_t window_ns = 20000000;
+  // ... or as soon as it holds this many candidates, or this many bytes of
+  // candidate SDP, so one message never grows past what a peer takes.
+  size_t max_candidates = 16;
+  size_t max_bytes = 4096;
+};
+
+struct CandidateBatchStats {
+  // Candidates added, duplicates included.
+  uint64_t candidates = 0;
+  uint64_t duplicates = 0;
+  uint64_t batches = 0;
+  uint64_t sent = 0;
+  size_t max_batch = 0;
+  // Time sent candidates waited between Add() and their batch being sent.
+  int64_t latency_sum_ns = 0;
+  int64_t latency_max_ns = 0;
+
+  double mean_batch() const { return batches ? static_cast<double>(sent) / batches : 0; }
+  int64_t mean_latency_ns() const { return sent ? latency_sum_ns / static_cast<int64_t>(sent) : 0; }
+};
+
+// The transport address a candidate line describes, for telling redundant
+// candidates apart: sdpMLineIndex, sdpMid, component, transport, address,
+// port and tcptype, but not foundation, priority, type, generation or ufrag.
+// Per RFC 8445 5.1.3 a candidate with the same transport address as one
+// already sent is redundant, e.g. a server reflexive candidate equal to its
+// host candidate when there is no NAT, or one gathered again. The whole line
+// if it doesn't parse. Replaces |key| with the fields, case folded where ICE
+// compares them case insensitively; equal keys mean equal addresses.
+void CandidateAddressKey(const SignalingCandidate &candidate, std::string *key);
+
+// Coalesces trickled ICE candidates into kCandidates messages: a batch opens
+// with the first candidate after the previous one was sent and is sent when
+// its window ends, it is full, or on Flush(), e.g. once gathering completes.
+// Candidates redundant with one already added are dropped.
+//
+// Time is passed in, the caller drives it: arm a timer for deadline_ns() when
+// Add() opens a batch and call Poll() when it fires. Copies the candidates;
+// not thread safe.
+class CandidateBatcher {
+ public:
+  // Receives every batch. |candidates| point into the batcher and are valid
+  // for the call only.
+  using SendFunc = std::function<void(const SignalingCandidate *candidates, size_t count)>;
+
+  CandidateBatcher(const CandidateBatcherConfig &config, SendFunc send);
+  CandidateBatcher(const CandidateBatcher &) = delete;
+  CandidateBatcher &operator=(const CandidateBatcher &) = delete;
+
+  // Queues |candidate|, gathered at |now_ns|, and sends the batch if that
+  // fills it. Returns false if it was dropped as redundant.
+  bool Add(const SignalingCandidate &candidate, int64_t now_ns);
+
+  // Sends the batch if its window has ended by |now_ns|.
+  void Poll(int64_t now_ns);
+
+  // Sends the batch now, if there is one.
+  void Flush(int64_t now_ns);
+
+  // Forgets the candidates seen so far, for a new gathering, e.g. after an
+  // ICE restart. Queued candidates stay queued.
+  void Reset();
+
+  // Takes effect with the next batch.
+  void set_config(const CandidateBatcherConfig &config) { config_ = config; }
+  const CandidateBatcherConfig &config() const { return config_; }
+
+  // When the open batch is due, -1 if there is none.
+  int64_t deadline_ns() const { return pending_.empty() ? -1 : deadline_ns_; }
+  size_t pending() const { return pending_.size(); }
+  const CandidateBatchStats &stats() const { return stats_; }
+
+ private:
+  struct Pending {
+    size_t sdp_offset = 0;
+    size_t sdp_size = 0;
+    size_t mid_offset = 0;
+    size_t mid_size = 0;
+    bool has_sdp_mid = false;
+    int32_t sdp_mline_index = 0;
+    int64_t added_ns = 0;
+  };
+
+  CandidateBatcherConfig config_;
+  SendFunc send_;
+  // Strings of the pending candidates.
+  std::string arena_;
+  std::vector<Pending> pending_;
+  // Views of the pending candidates, rebuilt for every send.
+  std::vector<SignalingCandidate> batch_;
+  int64_t deadline_ns_ = 0;
+  // Address keys of the candidates added since the last Reset(), whole so
+  // that distinct addresses never collide.
+  std::unordered_set<std::string> seen_;
+  // Scratch for the key of the candidate being added.
+  std::string key_;
+  CandidateBatchStats stats_;
+};
+
+}  // namespace custom
+
+#endif /* CandidateBatcher_h */
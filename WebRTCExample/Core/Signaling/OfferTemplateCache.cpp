@@ -0,0 +1,126 @@
+//
+//  OfferTemplateCache.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/12.
+//
+
+#include "OfferTemplateCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace custom {
+namespace {
+
+// Offset of the volatile value in |line|, which starts after a line break,
+// or npos if it has none.
+size_t VolatileValueOffset(std::string_view line) {
+  if (line.substr(0, 2) == "o=") {
+    return 2;
+  }
+  if (line.substr(0, 2) != "a=") {
+    return std::string_view::npos;
+  }
+  static constexpr std::string_view kVolatileAttributes[] = {
+      "ice-ufrag:", "ice-pwd:", "fingerprint:", "ssrc:", "ssrc-group:", "msid:", "msid-semantic:", "candidate:",
+  };
+  line.remove_prefix(2);
+  for (std::string_view attribute : kVolatileAttributes) {
+    if (line.substr(0, attribute.size()) == attribute) {
+      return 2 + attribute.size();
+    }
+  }
+  return std::string_view::npos;
+}
+
+}  // namespace
+
+OfferTemplateCache::OfferTemplateCache(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {}
+
+bool OfferTemplateCache::Apply(std::string_view offer, std::string *munged) {
+  Split(offer);
+  const auto it = templates_.find(shape_);
+  if (it == templates_.end() || it->second.slots.size() != values_.size()) {
+    ++misses_;
+    return false;
+  }
+  const Template &found = it->second;
+  size_t size = found.text.size();
+  for (std::string_view value : values_) {
+    size += value.size();
+  }
+  munged->clear();
+  munged->reserve(size);
+  size_t begin = 0;
+  for (size_t i = 0; i < values_.size(); ++i) {
+    munged->append(found.text, begin, found.slots[i] - begin);
+    munged->append(values_[i]);
+    begin = found.slots[i];
+  }
+  munged->append(found.text, begin, std::string::npos);
+  ++hits_;
+  return true;
+}
+
+bool OfferTemplateCache::Store(std::string_view offer, std::string_view munged) {
+  Split(offer);
+  std::string shape = shape_;
+  const std::vector<std::string_view> offer_values = values_;
+  Split(munged);
+  if (values_ != offer_values) {
+    return false;
+  }
+  auto it = templates_.find(shape);
+  if (it == templates_.end()) {
+    if (templates_.size() >= capacity_) {
+      templates_.erase(order_.front());
+      order_.pop_front();
+    }
+    order_.push_back(shape);
+    it = templates_.emplace(std::move(shape), Template()).first;
+  }
+  it->second.text = shape_;
+  it->second.slots = slots_;
+  return true;
+}
+
+void OfferTemplateCache::Clear() {
+  templates_.clear();
+  order_.clear();
+}
+
+void OfferTemplateCache::Split(std::string_view sdp) {
+  shape_.clear();
+  values_.clear();
+  slots_.clear();
+  shape_.reserve(sdp.size());
+  const char *cursor = sdp.data();
+  const char *const end = cursor + sdp.size();
+  while (cursor < end) {
+    const char *newline = static_cast<const char *>(memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+    const char *line_end = newline ? newline + 1 : end;
+    const std::string_view line(cursor, static_cast<size_t>(line_end - cursor));
+    const size_t offset = VolatileValueOffset(line);
+    if (offset == std::string_view::npos || offset > line.size()) {
+      shape_.append(line);
+    } else {
+      // The value runs up to the line break.
+      size_t value_end = line.size();
+      if (value_end > offset && line[value_end - 1] == '\n') {
+        --value_end;
+      }
+      if (value_end > offset && line[value_end - 1] == '\r') {
+        --value_end;
+      }
+      shape_.append(line.substr(0, offset));
+      slots_.push_back(shape_.size());
+      values_.push_back(line.substr(offset, value_end - offset));
+      shape_.append(line.substr(value_end));
+    }
+    cursor = line_end;
+  }
+}
+
+}  // namespace custom
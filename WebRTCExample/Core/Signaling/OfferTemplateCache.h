@@ -0,0 +1,80 @@
+//
+//  OfferTemplateCache.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/12.
+//
+
+#ifndef OfferTemplateCache_h
+#define OfferTemplateCache_h
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace custom {
+
+// Munged offers kept as templates, so an offer with the same shape as one
+// munged before, e.g. the one a reconnect's new peer connection makes, is
+// munged by filling in its values instead of parsing and editing it again.
+//
+// Two offers have the same shape if they only differ in the values that are
+// new with every peer connection or restart: the o= line, and the values of
+// a=ice-ufrag, ice-pwd, fingerprint, ssrc, ssrc-group, msid, msid-semantic
+// and candidate. A template is the munged text with these values cut out.
+// Munging may add, drop and edit any other line, but must leave the volatile
+// ones in order.
+//
+// One cache serves one set of munging options; clear it when they change.
+// Not thread safe.
+class OfferTemplateCache {
+ public:
+  explicit OfferTemplateCache(size_t capacity = 8);
+  OfferTemplateCache(const OfferTemplateCache &) = delete;
+  OfferTemplateCache &operator=(const OfferTemplateCache &) = delete;
+
+  // Writes the munged form of |offer| to |munged| and returns true if an
+  // offer of its shape was stored; returns false otherwise.
+  bool Apply(std::string_view offer, std::string *munged);
+
+  // Stores |munged| as the template for offers shaped like |offer|, dropping
+  // the oldest template if the cache is full. False if |munged| doesn't keep
+  // the volatile values of |offer| in order, which can't be templated.
+  bool Store(std::string_view offer, std::string_view munged);
+
+  void Clear();
+
+  size_t size() const { return templates_.size(); }
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+ private:
+  struct Template {
+    // The munged offer without its volatile values.
+    std::string text;
+    // Where in |text| each volatile value goes, in order.
+    std::vector<size_t> slots;
+  };
+
+  // Splits |sdp| into |shape_|, its text with the volatile values cut out,
+  // |values_|, and |slots_|, where in |shape_| they were.
+  void Split(std::string_view sdp);
+
+  size_t capacity_;
+  std::unordered_map<std::string, Template> templates_;
+  // Shapes in the order they were stored.
+  std::deque<std::string> order_;
+  std::string shape_;
+  std::vector<std::string_view> values_;
+  std::vector<size_t> slots_;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+};
+
+}  // namespace custom
+
+#endif /* OfferTemplateCache_h */
@@ -0,0 +1,370 @@
+//
+//  SessionDescription.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/12.
+//
+
+#include "SessionDescription.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <utility>
+
+namespace custom {
+namespace {
+
+// Splits off the next space separated token of |line|.
+std::string_view NextToken(std::string_view *line) {
+  const size_t begin = std::min(line->find_first_not_of(' '), line->size());
+  line->remove_prefix(begin);
+  const size_t end = std::min(line->find(' '), line->size());
+  const std::string_view token = line->substr(0, end);
+  line->remove_prefix(end);
+  return token;
+}
+
+int ParseInt(std::string_view text) {
+  int value = -1;
+  const std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), value);
+  return result.ec == std::errc() && result.ptr == text.data() + text.size() ? value : -1;
+}
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    const char x = (a[i] >= 'A' && a[i] <= 'Z') ? static_cast<char>(a[i] - 'A' + 'a') : a[i];
+    const char y = (b[i] >= 'A' && b[i] <= 'Z') ? static_cast<char>(b[i] - 'A' + 'a') : b[i];
+    if (x != y) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// apt=<payload type> in ';' separated fmtp |parameters|, -1 if absent.
+int AssociatedPayloadType(std::string_view parameters) {
+  while (!parameters.empty()) {
+    const size_t end = std::min(parameters.find(';'), parameters.size());
+    std::string_view parameter = parameters.substr(0, end);
+    parameters.remove_prefix(std::min(end + 1, parameters.size()));
+    parameter.remove_prefix(std::min(parameter.find_first_not_of(' '), parameter.size()));
+    if (parameter.substr(0, 4) == "apt=") {
+      return ParseInt(parameter.substr(4));
+    }
+  }
+  return -1;
+}
+
+}  // namespace
+
+SdpAttribute SplitSdpAttribute(std::string_view value) {
+  SdpAttribute attribute;
+  const size_t colon = value.find(':');
+  attribute.name = value.substr(0, colon);
+  if (colon != std::string_view::npos) {
+    attribute.value = value.substr(colon + 1);
+  }
+  return attribute;
+}
+
+bool SessionDescription::Parse(std::string_view sdp) {
+  text_.assign(sdp.data(), sdp.size());
+  lines_.clear();
+  sections_.clear();
+  owned_.clear();
+  error_ = "";
+  error_line_ = 0;
+
+  const char *cursor = text_.data();
+  const char *const end = cursor + text_.size();
+  while (cursor < end) {
+    const char *newline = static_cast<const char *>(memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+    const char *line_end = newline ? newline : end;
+    if (line_end > cursor && line_end[-1] == '\r') {
+      --line_end;
+    }
+    // Blank lines, e.g. after the last line break, are skipped.
+    if (line_end > cursor) {
+      if (line_end - cursor < 2 || cursor[0] < 'a' || cursor[0] > 'z' || cursor[1] != '=') {
+        return Fail("line isn't <type>=<value>", lines_.size());
+      }
+      if (cursor[0] == 'm') {
+        sections_.emplace_back();
+        sections_.back().media.first_line = lines_.size();
+      }
+      SdpLine line;
+      line.type = cursor[0];
+      line.value = std::string_view(cursor + 2, static_cast<size_t>(line_end - cursor - 2));
+      lines_.push_back(line);
+    }
+    cursor = newline ? newline + 1 : end;
+  }
+  if (lines_.empty() || lines_[0].type != 'v') {
+    return Fail("doesn't start with v=", 0);
+  }
+  for (size_t i = 0; i < sections_.size(); ++i) {
+    sections_[i].media.end_line = i + 1 < sections_.size() ? sections_[i + 1].media.first_line : lines_.size();
+  }
+  return true;
+}
+
+const SdpMediaSection &SessionDescription::media(size_t index) {
+  Section &section = sections_[index];
+  if (!section.parsed) {
+    ParseSection(&section);
+  }
+  return section.media;
+}
+
+void SessionDescription::ParseSection(Section *section) {
+  SdpMediaSection &media = section->media;
+  // m=<media> <port> <proto> <fmt> ...
+  std::string_view m_line = lines_[media.first_line].value;
+  media.media = NextToken(&m_line);
+  media.port = NextToken(&m_line);
+  media.protocol = NextToken(&m_line);
+  media.formats.clear();
+  for (std::string_view format = NextToken(&m_line); !format.empty(); format = NextToken(&m_line)) {
+    media.formats.push_back(format);
+  }
+  media.mid = std::string_view();
+  media.direction = "sendrecv";
+
+  std::vector<SdpCodec> codecs;
+  std::vector<std::pair<int, std::string_view>> fmtps;
+  for (size_t i = media.first_line + 1; i < media.end_line; ++i) {
+    if (lines_[i].type != 'a') {
+      continue;
+    }
+    const SdpAttribute attribute = SplitSdpAttribute(lines_[i].value);
+    if (attribute.name == "mid") {
+      media.mid = attribute.value;
+    } else if (attribute.name == "sendrecv" || attribute.name == "sendonly" || attribute.name == "recvonly" ||
+               attribute.name == "inactive") {
+      media.direction = attribute.name;
+    } else if (attribute.name == "rtpmap") {
+      // a=rtpmap:<payload type> <encoding name>/<clock rate>[/<parameters>]
+      std::string_view value = attribute.value;
+      SdpCodec codec;
+      codec.payload_type = ParseInt(NextToken(&value));
+      std::string_view encoding = NextToken(&value);
+      const size_t slash = std::min(encoding.find('/'), encoding.size());
+      codec.name = encoding.substr(0, slash);
+      encoding.remove_prefix(std::min(slash + 1, encoding.size()));
+      codec.clock_rate = ParseInt(encoding.substr(0, encoding.find('/')));
+      if (codec.payload_type >= 0) {
+        codecs.push_back(codec);
+      }
+    } else if (attribute.name == "fmtp") {
+      std::string_view value = attribute.value;
+      const int payload_type = ParseInt(NextToken(&value));
+      value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
+      fmtps.emplace_back(payload_type, value);
+    }
+  }
+  for (const std::pair<int, std::string_view> &fmtp : fmtps) {
+    for (SdpCodec &codec : codecs) {
+      if (codec.payload_type == fmtp.first) {
+        codec.fmtp = fmtp.second;
+        codec.associated_payload_type = AssociatedPayloadType(fmtp.second);
+      }
+    }
+  }
+  // In m= line order.
+  media.codecs.clear();
+  for (std::string_view format : media.formats) {
+    const int payload_type = ParseInt(format);
+    for (const SdpCodec &codec : codecs) {
+      if (codec.payload_type == payload_type) {
+        media.codecs.push_back(codec);
+        break;
+      }
+    }
+  }
+  section->parsed = true;
+}
+
+bool SessionDescription::FindAttribute(size_t first_line, size_t end_line, std::string_view name,
+                                       std::string_view *value) const {
+  for (size_t i = first_line; i < end_line && i < lines_.size(); ++i) {
+    if (lines_[i].type != 'a') {
+      continue;
+    }
+    const SdpAttribute attribute = SplitSdpAttribute(lines_[i].value);
+    if (attribute.name == name) {
+      *value = attribute.value;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SessionDescription::PreferCodec(size_t index, std::string_view name) {
+  media(index);
+  SdpMediaSection &media = sections_[index].media;
+  std::vector<int> preferred;
+  for (const SdpCodec &codec : media.codecs) {
+    if (EqualsIgnoreCase(codec.name, name)) {
+      preferred.push_back(codec.payload_type);
+    }
+  }
+  if (preferred.empty()) {
+    return false;
+  }
+  const size_t primary_count = preferred.size();
+  for (const SdpCodec &codec : media.codecs) {
+    if (codec.associated_payload_type >= 0 &&
+        std::find(preferred.begin(), preferred.begin() + primary_count, codec.associated_payload_type) !=
+            preferred.begin() + primary_count) {
+      preferred.push_back(codec.payload_type);
+    }
+  }
+
+  std::vector<std::string_view> formats;
+  for (int payload_type : preferred) {
+    for (std::string_view format : media.formats) {
+      if (ParseInt(format) == payload_type) {
+        formats.push_back(format);
+        break;
+      }
+    }
+  }
+  for (std::string_view format : media.formats) {
+    if (std::find(preferred.begin(), preferred.end(), ParseInt(format)) == preferred.end()) {
+      formats.push_back(format);
+    }
+  }
+
+  std::string m_line;
+  m_line.reserve(lines_[media.first_line].value.size());
+  m_line.append(media.media).append(" ").append(media.port).append(" ").append(media.protocol);
+  for (std::string_view format : formats) {
+    m_line.append(" ").append(format);
+  }
+  const std::string_view owned = Own(std::move(m_line));
+  lines_[media.first_line].value = owned;
+
+  // Views of the new line, and codecs in its order.
+  std::string_view rest = owned;
+  media.media = NextToken(&rest);
+  media.port = NextToken(&rest);
+  media.protocol = NextToken(&rest);
+  media.formats.clear();
+  for (std::string_view format = NextToken(&rest); !format.empty(); format = NextToken(&rest)) {
+    media.formats.push_back(format);
+  }
+  std::stable_sort(media.codecs.begin(), media.codecs.end(), [&](const SdpCodec &a, const SdpCodec &b) {
+    auto rank = [&](int payload_type) {
+      const auto it = std::find(preferred.begin(), preferred.end(), payload_type);
+      return it == preferred.end() ? preferred.size() : static_cast<size_t>(it - preferred.begin());
+    };
+    return rank(a.payload_type) < rank(b.payload_type);
+  });
+  return true;
+}
+
+void SessionDescription::SetBandwidth(size_t index, int kbps) {
+  const SdpMediaSection &media = sections_[index].media;
+  for (size_t i = media.first_line + 1; i < media.end_line; ++i) {
+    if (lines_[i].type == 'b' && lines_[i].value.substr(0, 3) == "AS:") {
+      if (kbps > 0) {
+        lines_[i].value = Own("AS:" + std::to_string(kbps));
+      } else {
+        EraseLine(i);
+      }
+      return;
+    }
+  }
+  if (kbps <= 0) {
+    return;
+  }
+  // m=, i=, c=, b= in that order.
+  size_t position = media.first_line + 1;
+  while (position < media.end_line && (lines_[position].type == 'i' || lines_[position].type == 'c')) {
+    ++position;
+  }
+  InsertLine(position, 'b', Own("AS:" + std::to_string(kbps)));
+}
+
+bool SessionDescription::AddSimulcast(size_t index, const std::vector<std::string> &rids) {
+  const SdpMediaSection &media = this->media(index);
+  std::string_view existing;
+  if (rids.empty() || media.media != "video" || (media.direction != "sendrecv" && media.direction != "sendonly") ||
+      FindAttribute(media.first_line + 1, media.end_line, "simulcast", &existing)) {
+    return false;
+  }
+  size_t position = media.end_line;
+  std::string simulcast = "simulcast:send ";
+  for (size_t i = 0; i < rids.size(); ++i) {
+    InsertLine(position++, 'a', Own("rid:" + rids[i] + " send"));
+    simulcast.append(i ? ";" : "").append(rids[i]);
+  }
+  InsertLine(position, 'a', Own(std::move(simulcast)));
+  return true;
+}
+
+std::string SessionDescription::ToString() const {
+  std::string out;
+  AppendTo(&out);
+  return out;
+}
+
+void SessionDescription::AppendTo(std::string *out) const {
+  size_t size = 0;
+  for (const SdpLine &line : lines_) {
+    size += line.value.size() + 4;
+  }
+  out->reserve(out->size() + size);
+  for (const SdpLine &line : lines_) {
+    out->push_back(line.type);
+    out->push_back('=');
+    out->append(line.value);
+    out->append("\r\n");
+  }
+}
+
+std::string_view SessionDescription::Own(std::string value) {
+  owned_.push_back(std::move(value));
+  return owned_.back();
+}
+
+void SessionDescription::InsertLine(size_t position, char type, std::string_view value) {
+  SdpLine line;
+  line.type = type;
+  line.value = value;
+  lines_.insert(lines_.begin() + static_cast<std::ptrdiff_t>(position), line);
+  for (Section &section : sections_) {
+    if (section.media.first_line >= position) {
+      ++section.media.first_line;
+    }
+    if (section.media.end_line >= position) {
+      ++section.media.end_line;
+    }
+  }
+}
+
+void SessionDescription::EraseLine(size_t position) {
+  lines_.erase(lines_.begin() + static_cast<std::ptrdiff_t>(position));
+  for (Section &section : sections_) {
+    if (section.media.first_line > position) {
+      --section.media.first_line;
+    }
+    if (section.media.end_line > position) {
+      --section.media.end_line;
+    }
+  }
+}
+
+bool SessionDescription::Fail(const char *error, size_t line) {
+  lines_.clear();
+  sections_.clear();
+  error_ = error;
+  error_line_ = line;
+  return false;
+}
+
+}  // namespace custom
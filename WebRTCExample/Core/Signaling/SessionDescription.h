@@ -0,0 +1,142 @@
+//
+//  SessionDescription.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/12.
+//
+
+#ifndef SessionDescription_h
+#define SessionDescription_h
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace custom {
+
+// One "<type>=<value>" line of an SDP, without its line break.
+struct SdpLine {
+  char type = 0;
+  std::string_view value;
+};
+
+// The value of an a= line split at its first ':'; |value| is empty for
+// property attributes such as "rtcp-mux".
+struct SdpAttribute {
+  std::string_view name;
+  std::string_view value;
+};
+
+SdpAttribute SplitSdpAttribute(std::string_view value);
+
+// A payload type of an m= section with its a=rtpmap and a=fmtp.
+struct SdpCodec {
+  int payload_type = -1;
+  // Encoding name as written, e.g. "H264" or "rtx".
+  std::string_view name;
+  int clock_rate = 0;
+  // a=fmtp parameters, empty if there are none.
+  std::string_view fmtp;
+  // apt= of an rtx payload type, -1 if there is none.
+  int associated_payload_type = -1;
+};
+
+// An m= section, parsed on first use. |first_line| is the m= line; the
+// section ends before |end_line|.
+struct SdpMediaSection {
+  size_t first_line = 0;
+  size_t end_line = 0;
+  // "audio", "video" or "application".
+  std::string_view media;
+  std::string_view port;
+  std::string_view protocol;
+  // Formats of the m= line, in order of preference.
+  std::vector<std::string_view> formats;
+  std::string_view mid;
+  // sendrecv, sendonly, recvonly or inactive; sendrecv if absent.
+  std::string_view direction;
+  // Payload types with an a=rtpmap, in m= line order.
+  std::vector<SdpCodec> codecs;
+};
+
+// An SDP as lines over a copy of its text: Parse() makes a single pass that
+// only finds line breaks and m= lines, each m= section is parsed the first
+// time media() asks for it, and lines and attributes are views of the copy.
+//
+// Munging edits lines in place: edited and inserted lines point at strings the
+// description owns, everything else keeps pointing at the original text, and
+// ToString() writes the result with CRLF line breaks. Not thread safe.
+class SessionDescription {
+ public:
+  SessionDescription() = default;
+  SessionDescription(const SessionDescription &) = delete;
+  SessionDescription &operator=(const SessionDescription &) = delete;
+
+  // Replaces the description with |sdp|. Returns false if a line isn't
+  // "<letter>=<value>" or the first isn't v=; error() and error_line() then
+  // say why. CRLF and LF line breaks are both accepted.
+  bool Parse(std::string_view sdp);
+
+  // A static string, "" after a successful Parse.
+  const char *error() const { return error_; }
+  size_t error_line() const { return error_line_; }
+
+  size_t line_count() const { return lines_.size(); }
+  const SdpLine &line(size_t index) const { return lines_[index]; }
+  // Lines before the first m= line.
+  size_t session_end_line() const { return sections_.empty() ? lines_.size() : sections_[0].media.first_line; }
+
+  size_t media_count() const { return sections_.size(); }
+  const SdpMediaSection &media(size_t index);
+
+  // Value of the first a=|name| in lines [|first_line|, |end_line|), false
+  // if there is none.
+  bool FindAttribute(size_t first_line, size_t end_line, std::string_view name, std::string_view *value) const;
+
+  // Moves the payload types of codec |name|, compared case insensitively, to
+  // the front of section |index|'s m= line, followed by the payload types
+  // whose apt= names them, i.e. their rtx. False if the section has no such
+  // codec.
+  bool PreferCodec(size_t index, std::string_view name);
+
+  // Sets b=AS of section |index| to |kbps|, or removes it for 0. In a local
+  // description it caps what the peer sends.
+  void SetBandwidth(size_t index, int kbps);
+
+  // Adds a=rid lines and "a=simulcast:send <rids>" to send capable video
+  // section |index|, for peers and SFUs that take RID based simulcast. False
+  // if the section isn't one or already has a=simulcast.
+  bool AddSimulcast(size_t index, const std::vector<std::string> &rids);
+
+  std::string ToString() const;
+  // Appends the description to |out|.
+  void AppendTo(std::string *out) const;
+
+ private:
+  struct Section {
+    bool parsed = false;
+    SdpMediaSection media;
+  };
+
+  void ParseSection(Section *section);
+  // Owned copy of |value| that stays put.
+  std::string_view Own(std::string value);
+  void InsertLine(size_t position, char type, std::string_view value);
+  void EraseLine(size_t position);
+  bool Fail(const char *error, size_t line);
+
+  std::string text_;
+  std::vector<SdpLine> lines_;
+  std::vector<Section> sections_;
+  // Values of edited lines; a deque so they never move.
+  std::deque<std::string> owned_;
+  const char *error_ = "";
+  size_t error_line_ = 0;
+};
+
+}  // namespace custom
+
+#endif /* SessionDescription_h */
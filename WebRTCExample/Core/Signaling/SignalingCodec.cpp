@@ -0,0 +1,666 @@
+//
+//  SignalingCodec.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/10.
+//
+
+#include "SignalingCodec.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+namespace custom {
+namespace {
+
+constexpr uint64_t kOnes = 0x0101010101010101ULL;
+constexpr uint64_t kHighBits = 0x8080808080808080ULL;
+
+// Whether any byte of |word| is below |n|, for n <= 128.
+inline bool HasByteBelow(uint64_t word, uint8_t n) {
+  return ((word - kOnes * n) & ~word & kHighBits) != 0;
+}
+
+inline bool HasByte(uint64_t word, uint8_t c) {
+  return HasByteBelow(word ^ (kOnes * c), 1);
+}
+
+inline bool IsSpecial(uint8_t c) {
+  return c == '"' || c == '\\' || c < 0x20;
+}
+
+// The first byte in [begin, end) that ends or escapes a JSON string run: a
+// quote, a backslash or a control character; |end| if there is none. Checks
+// eight bytes at a time, SDPs are mostly long runs of plain text.
+const char *FindSpecial(const char *begin, const char *end) {
+  const char *p = begin;
+  while (end - p >= 8) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    if (HasByte(word, '"') || HasByte(word, '\\') || HasByteBelow(word, 0x20)) {
+      break;
+    }
+    p += 8;
+  }
+  while (p < end && !IsSpecial(static_cast<uint8_t>(*p))) {
+    ++p;
+  }
+  return p;
+}
+
+inline bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// The code unit of the 4 hex digits at |p|, -1 if they aren't.
+int32_t ParseHex4(const char *p) {
+  int32_t value = 0;
+  for (int i = 0; i < 4; ++i) {
+    const int digit = HexValue(p[i]);
+    if (digit < 0) {
+      return -1;
+    }
+    value = value << 4 | digit;
+  }
+  return value;
+}
+
+void AppendUtf8(uint32_t code_point, std::string *out) {
+  if (code_point < 0x80) {
+    out->push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    out->push_back(static_cast<char>(0xC0 | code_point >> 6));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x10000) {
+    out->push_back(static_cast<char>(0xE0 | code_point >> 12));
+    out->push_back(static_cast<char>(0x80 | (code_point >> 6 & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else {
+    out->push_back(static_cast<char>(0xF0 | code_point >> 18));
+    out->push_back(static_cast<char>(0x80 | (code_point >> 12 & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code_point >> 6 & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
+
+}  // namespace
+
+std::string_view SignalingMessageTypeName(SignalingMessageType type) {
+  switch (type) {
+    case SignalingMessageType::kOffer:
+      return "offer";
+    case SignalingMessageType::kAnswer:
+      return "answer";
+    case SignalingMessageType::kUnknown:
+      return "unKnown";
+    case SignalingMessageType::kCandidate:
+      return "candidate";
+    case SignalingMessageType::kCandidates:
+      return "candidates";
+  }
+  return "unKnown";
+}
+
+bool SignalingParser::Parse(std::string_view json, SignalingMessage *message) {
+  begin_ = json.data();
+  cursor_ = begin_;
+  end_ = begin_ + json.size();
+  scratch_.clear();
+  if (scratch_.capacity() < json.size()) {
+    scratch_.reserve(json.size());
+  }
+  error_ = "";
+  error_offset_ = 0;
+
+  candidates_.clear();
+
+  *message = SignalingMessage();
+  if (!ParseMessage(message)) {
+    return false;
+  }
+  if (!candidates_.empty()) {
+    message->candidates = candidates_.data();
+    message->candidate_count = candidates_.size();
+  }
+  SkipWhitespace();
+  if (cursor_ != end_) {
+    return Fail("trailing characters after the message");
+  }
+  return true;
+}
+
+template <typename Field>
+bool SignalingParser::ParseObject(Field field) {
+  if (!Expect('{')) {
+    return false;
+  }
+  SkipWhitespace();
+  if (cursor_ < end_ && *cursor_ == '}') {
+    ++cursor_;
+    return true;
+  }
+  for (;;) {
+    std::string_view key;
+    SkipWhitespace();
+    if (!ParseString(&key) || !Expect(':')) {
+      return false;
+    }
+    SkipWhitespace();
+    if (!field(key)) {
+      return false;
+    }
+    SkipWhitespace();
+    if (cursor_ == end_) {
+      return Fail("unterminated object");
+    }
+    const char c = *cursor_++;
+    if (c == '}') {
+      return true;
+    }
+    if (c != ',') {
+      --cursor_;
+      return Fail("expected ',' or '}'");
+    }
+  }
+}
+
+bool SignalingParser::ParseMessage(SignalingMessage *message) {
+  bool has_type = false;
+  const bool parsed = ParseObject([&](std::string_view key) {
+    if (key == "type") {
+      std::string_view name;
+      if (!ParseString(&name)) {
+        return false;
+      }
+      for (SignalingMessageType type :
+           {SignalingMessageType::kOffer, SignalingMessageType::kAnswer, SignalingMessageType::kUnknown,
+            SignalingMessageType::kCandidate, SignalingMessageType::kCandidates}) {
+        if (name == SignalingMessageTypeName(type)) {
+          message->type = type;
+          has_type = true;
+          return true;
+        }
+      }
+      return Fail("unknown message type");
+    }
+    if (key == "sessionDescription") {
+      message->has_session_description = false;
+      return ConsumeNull() || ParseSessionDescription(message);
+    }
+    if (key == "candidate") {
+      message->has_candidate = false;
+      if (ConsumeNull()) {
+        return true;
+      }
+      message->candidate = SignalingCandidate();
+      if (!ParseCandidate(&message->candidate)) {
+        return false;
+      }
+      message->has_candidate = true;
+      return true;
+    }
+    if (key == "candidates") {
+      candidates_.clear();
+      return ConsumeNull() || ParseCandidates();
+    }
+    if (key == "candidateBatches") {
+      message->supports_candidate_batches = false;
+      return ConsumeNull() || ParseBool(&message->supports_candidate_batches);
+    }
+    if (key == "dataFrames") {
+      message->supports_data_frames = false;
+      return ConsumeNull() || ParseBool(&message->supports_data_frames);
+    }
+    return SkipValue(1);
+  });
+  if (!parsed) {
+    return false;
+  }
+  return has_type || Fail("message without a type");
+}
+
+bool SignalingParser::ParseSessionDescription(SignalingMessage *message) {
+  bool has_sdp = false;
+  const bool parsed = ParseObject([&](std::string_view key) {
+    if (key == "sdp") {
+      has_sdp = true;
+      return ParseString(&message->sdp);
+    }
+    return SkipValue(2);
+  });
+  if (!parsed) {
+    return false;
+  }
+  if (!has_sdp) {
+    return Fail("sessionDescription without sdp");
+  }
+  message->has_session_description = true;
+  return true;
+}
+
+bool SignalingParser::ParseCandidate(SignalingCandidate *candidate) {
+  bool has_sdp = false;
+  bool has_sdp_mline_index = false;
+  const bool parsed = ParseObject([&](std::string_view key) {
+    if (key == "sdp") {
+      has_sdp = true;
+      return ParseString(&candidate->sdp);
+    }
+    if (key == "sdpMLineIndex") {
+      has_sdp_mline_index = true;
+      return ParseInt32(&candidate->sdp_mline_index);
+    }
+    if (key == "sdpMid") {
+      candidate->has_sdp_mid = !ConsumeNull();
+      return !candidate->has_sdp_mid || ParseString(&candidate->sdp_mid);
+    }
+    return SkipValue(2);
+  });
+  if (!parsed) {
+    return false;
+  }
+  if (!has_sdp || !has_sdp_mline_index) {
+    return Fail("candidate without sdp or sdpMLineIndex");
+  }
+  return true;
+}
+
+bool SignalingParser::ParseCandidates() {
+  if (cursor_ == end_ || *cursor_ != '[') {
+    return Fail("expected an array");
+  }
+  ++cursor_;
+  SkipWhitespace();
+  if (cursor_ < end_ && *cursor_ == ']') {
+    ++cursor_;
+    return true;
+  }
+  for (;;) {
+    if (candidates_.size() == kMaxSignalingCandidates) {
+      return Fail("too many candidates");
+    }
+    candidates_.emplace_back();
+    if (!ParseCandidate(&candidates_.back())) {
+      return false;
+    }
+    SkipWhitespace();
+    if (cursor_ == end_) {
+      return Fail("unterminated array");
+    }
+    const char c = *cursor_++;
+    if (c == ']') {
+      return true;
+    }
+    if (c != ',') {
+      --cursor_;
+      return Fail("expected ',' or ']'");
+    }
+    SkipWhitespace();
+  }
+}
+
+bool SignalingParser::ParseBool(bool *value) {
+  if (cursor_ < end_ && *cursor_ == 't') {
+    *value = true;
+    return ParseLiteral("true");
+  }
+  if (cursor_ < end_ && *cursor_ == 'f') {
+    *value = false;
+    return ParseLiteral("false");
+  }
+  return Fail("expected a bool");
+}
+
+bool SignalingParser::ParseString(std::string_view *value) {
+  if (cursor_ == end_ || *cursor_ != '"') {
+    return Fail("expected a string");
+  }
+  const char *start = ++cursor_;
+  const char *special = FindSpecial(cursor_, end_);
+  if (special != end_ && *special == '"') {
+    *value = std::string_view(start, special - start);
+    cursor_ = special + 1;
+    return true;
+  }
+
+  // Escaped: unescape into the scratch, which has room for it.
+  const size_t offset = scratch_.size();
+  for (;;) {
+    if (special == end_) {
+      return Fail("unterminated string");
+    }
+    scratch_.append(cursor_, special - cursor_);
+    cursor_ = special;
+    if (*cursor_ == '"') {
+      ++cursor_;
+      break;
+    }
+    if (*cursor_ != '\\') {
+      return Fail("control character in a string");
+    }
+    if (end_ - cursor_ < 2) {
+      return Fail("unterminated string");
+    }
+    const char escape = cursor_[1];
+    cursor_ += 2;
+    switch (escape) {
+      case '"':
+      case '\\':
+      case '/':
+        scratch_.push_back(escape);
+        break;
+      case 'b':
+        scratch_.push_back('\b');
+        break;
+      case 'f':
+        scratch_.push_back('\f');
+        break;
+      case 'n':
+        scratch_.push_back('\n');
+        break;
+      case 'r':
+        scratch_.push_back('\r');
+        break;
+      case 't':
+        scratch_.push_back('\t');
+        break;
+      case 'u': {
+        const int32_t unit = end_ - cursor_ >= 4 ? ParseHex4(cursor_) : -1;
+        if (unit < 0) {
+          cursor_ -= 2;
+          return Fail("bad \\u escape");
+        }
+        cursor_ += 4;
+        uint32_t code_point = static_cast<uint32_t>(unit);
+        if (unit >= 0xDC00 && unit <= 0xDFFF) {
+          cursor_ -= 6;
+          return Fail("lone low surrogate");
+        }
+        if (unit >= 0xD800 && unit <= 0xDBFF) {
+          const int32_t low = (end_ - cursor_ >= 6 && cursor_[0] == '\\' && cursor_[1] == 'u') ? ParseHex4(cursor_ + 2)
+                                                                                              : -1;
+          if (low < 0xDC00 || low > 0xDFFF) {
+            cursor_ -= 6;
+            return Fail("lone high surrogate");
+          }
+          cursor_ += 6;
+          code_point = 0x10000 + ((code_point - 0xD800) << 10) + (static_cast<uint32_t>(low) - 0xDC00);
+        }
+        AppendUtf8(code_point, &scratch_);
+        break;
+      }
+      default:
+        cursor_ -= 2;
+        return Fail("bad escape");
+    }
+    special = FindSpecial(cursor_, end_);
+  }
+  *value = std::string_view(scratch_.data() + offset, scratch_.size() - offset);
+  return true;
+}
+
+bool SignalingParser::ParseInt32(int32_t *value) {
+  const char *start = cursor_;
+  const bool negative = cursor_ < end_ && *cursor_ == '-';
+  if (negative) {
+    ++cursor_;
+  }
+  if (cursor_ == end_ || !IsDigit(*cursor_)) {
+    cursor_ = start;
+    return Fail("expected an integer");
+  }
+  // Leading zeros aren't JSON.
+  const bool leading_zero = *cursor_ == '0';
+  int64_t magnitude = 0;
+  while (cursor_ < end_ && IsDigit(*cursor_)) {
+    magnitude = std::min<int64_t>(magnitude * 10 + (*cursor_++ - '0'), int64_t{1} << 32);
+  }
+  if ((leading_zero && cursor_ - start > 1 + negative) ||
+      (cursor_ < end_ && (*cursor_ == '.' || *cursor_ == 'e' || *cursor_ == 'E'))) {
+    cursor_ = start;
+    return Fail("not an integer");
+  }
+  const int64_t result = negative ? -magnitude : magnitude;
+  if (result < std::numeric_limits<int32_t>::min() || result > std::numeric_limits<int32_t>::max()) {
+    cursor_ = start;
+    return Fail("integer out of int32 range");
+  }
+  *value = static_cast<int32_t>(result);
+  return true;
+}
+
+bool SignalingParser::SkipValue(int depth) {
+  if (depth > kMaxSignalingDepth) {
+    return Fail("nested too deeply");
+  }
+  if (cursor_ == end_) {
+    return Fail("expected a value");
+  }
+  switch (*cursor_) {
+    case '{':
+      return ParseObject([&](std::string_view) { return SkipValue(depth + 1); });
+    case '[': {
+      ++cursor_;
+      SkipWhitespace();
+      if (cursor_ < end_ && *cursor_ == ']') {
+        ++cursor_;
+        return true;
+      }
+      for (;;) {
+        SkipWhitespace();
+        if (!SkipValue(depth + 1)) {
+          return false;
+        }
+        SkipWhitespace();
+        if (cursor_ == end_) {
+          return Fail("unterminated array");
+        }
+        const char c = *cursor_++;
+        if (c == ']') {
+          return true;
+        }
+        if (c != ',') {
+          --cursor_;
+          return Fail("expected ',' or ']'");
+        }
+      }
+    }
+    case '"': {
+      std::string_view ignored;
+      return ParseString(&ignored);
+    }
+    case 't':
+      return ParseLiteral("true");
+    case 'f':
+      return ParseLiteral("false");
+    case 'n':
+      return ParseLiteral("null");
+    default:
+      return SkipNumber();
+  }
+}
+
+bool SignalingParser::SkipNumber() {
+  const char *start = cursor_;
+  auto digits = [&] {
+    const char *first = cursor_;
+    while (cursor_ < end_ && IsDigit(*cursor_)) {
+      ++cursor_;
+    }
+    return cursor_ - first;
+  };
+  if (cursor_ < end_ && *cursor_ == '-') {
+    ++cursor_;
+  }
+  const char *integer = cursor_;
+  const auto integer_digits = digits();
+  bool valid = integer_digits > 0 && (*integer != '0' || integer_digits == 1);
+  if (valid && cursor_ < end_ && *cursor_ == '.') {
+    ++cursor_;
+    valid = digits() > 0;
+  }
+  if (valid && cursor_ < end_ && (*cursor_ == 'e' || *cursor_ == 'E')) {
+    ++cursor_;
+    if (cursor_ < end_ && (*cursor_ == '+' || *cursor_ == '-')) {
+      ++cursor_;
+    }
+    valid = digits() > 0;
+  }
+  if (!valid) {
+    cursor_ = start;
+    return Fail("expected a value");
+  }
+  return true;
+}
+
+bool SignalingParser::ParseLiteral(std::string_view literal) {
+  if (static_cast<size_t>(end_ - cursor_) < literal.size() || memcmp(cursor_, literal.data(), literal.size()) != 0) {
+    return Fail("expected a value");
+  }
+  cursor_ += literal.size();
+  return true;
+}
+
+bool SignalingParser::Expect(char c) {
+  SkipWhitespace();
+  if (cursor_ == end_ || *cursor_ != c) {
+    return Fail(c == '{' ? "expected '{'" : "expected ':'");
+  }
+  ++cursor_;
+  return true;
+}
+
+bool SignalingParser::ConsumeNull() {
+  SkipWhitespace();
+  if (end_ - cursor_ >= 4 && memcmp(cursor_, "null", 4) == 0) {
+    cursor_ += 4;
+    return true;
+  }
+  return false;
+}
+
+void SignalingParser::SkipWhitespace() {
+  while (cursor_ < end_ && (*cursor_ == ' ' || *cursor_ == '\n' || *cursor_ == '\r' || *cursor_ == '\t')) {
+    ++cursor_;
+  }
+}
+
+bool SignalingParser::Fail(const char *error) {
+  error_ = error;
+  error_offset_ = cursor_ - begin_;
+  return false;
+}
+
+std::string_view SignalingWriter::Write(const SignalingMessage &message) {
+  buffer_.clear();
+  buffer_.append("{\"type\":\"");
+  buffer_.append(SignalingMessageTypeName(message.type));
+  buffer_.push_back('"');
+  if (message.has_session_description) {
+    buffer_.append(",\"sessionDescription\":{\"sdp\":");
+    AppendString(message.sdp);
+    buffer_.push_back('}');
+  }
+  if (message.supports_candidate_batches) {
+    buffer_.append(",\"candidateBatches\":true");
+  }
+  if (message.supports_data_frames) {
+    buffer_.append(",\"dataFrames\":true");
+  }
+  if (message.has_candidate) {
+    buffer_.append(",\"candidate\":");
+    AppendCandidate(message.candidate);
+  }
+  if (message.type == SignalingMessageType::kCandidates || message.candidate_count > 0) {
+    buffer_.append(",\"candidates\":[");
+    for (size_t i = 0; i < message.candidate_count; ++i) {
+      if (i > 0) {
+        buffer_.push_back(',');
+      }
+      AppendCandidate(message.candidates[i]);
+    }
+    buffer_.push_back(']');
+  }
+  buffer_.push_back('}');
+  return buffer_;
+}
+
+void SignalingWriter::AppendCandidate(const SignalingCandidate &candidate) {
+  buffer_.append("{\"sdp\":");
+  AppendString(candidate.sdp);
+  buffer_.append(",\"sdpMLineIndex\":");
+  char digits[16];
+  const std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), candidate.sdp_mline_index);
+  buffer_.append(digits, result.ptr - digits);
+  if (candidate.has_sdp_mid) {
+    buffer_.append(",\"sdpMid\":");
+    AppendString(candidate.sdp_mid);
+  }
+  buffer_.push_back('}');
+}
+
+void SignalingWriter::AppendString(std::string_view value) {
+  static const char kHexDigits[] = "0123456789abcdef";
+  // Usually the only growth; escapes are rare apart from an SDP's line breaks.
+  buffer_.reserve(buffer_.size() + value.size() + value.size() / 16 + 2);
+  buffer_.push_back('"');
+  const char *cursor = value.data();
+  const char *end = cursor + value.size();
+  for (;;) {
+    const char *special = FindSpecial(cursor, end);
+    buffer_.append(cursor, special - cursor);
+    if (special == end) {
+      break;
+    }
+    const uint8_t c = static_cast<uint8_t>(*special);
+    char escape[6] = {'\\', 0, 0, 0, 0, 0};
+    size_t length = 2;
+    switch (c) {
+      case '"':
+      case '\\':
+        escape[1] = static_cast<char>(c);
+        break;
+      case '\b':
+        escape[1] = 'b';
+        break;
+      case '\f':
+        escape[1] = 'f';
+        break;
+      case '\n':
+        escape[1] = 'n';
+        break;
+      case '\r':
+        escape[1] = 'r';
+        break;
+      case '\t':
+        escape[1] = 't';
+        break;
+      default:
+        memcpy(escape + 1, "u00", 3);
+        escape[4] = kHexDigits[c >> 4];
+        escape[5] = kHexDigits[c & 0xF];
+        length = 6;
+        break;
+    }
+    buffer_.append(escape, length);
+    cursor = special + 1;
+  }
+  buffer_.push_back('"');
+}
+
+}  // namespace custom
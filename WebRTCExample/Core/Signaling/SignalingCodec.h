@@ -0,0 +1,156 @@
+//
+//  SignalingCodec.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/10.
+//
+
+#ifndef SignalingCodec_h
+#define SignalingCodec_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace custom {
+
+// SignalingMessageType in SignalingMessage.swift.
+enum class SignalingMessageType {
+  kOffer,
+  kAnswer,
+  kUnknown,
+  kCandidate,
+  // Several trickled candidates in one message, see CandidateBatcher. Only
+  // sent to peers whose offer or answer set supports_candidate_batches: older
+  // clients fail to decode the type and drop the message.
+  kCandidates,
+};
+
+// The raw value on the wire: "offer", "answer", "unKnown", "candidate" or
+// "candidates".
+std::string_view SignalingMessageTypeName(SignalingMessageType type);
+
+// Candidate in SignalingMessage.swift.
+struct SignalingCandidate {
+  std::string_view sdp;
+  int32_t sdp_mline_index = 0;
+  bool has_sdp_mid = false;
+  std::string_view sdp_mid;
+};
+
+// SignalingMessage in SignalingMessage.swift, with SDP flattened into |sdp|.
+// Strings are views: into the parsed frame or the parser's scratch for a
+// parsed message, into the caller's strings for one to write.
+struct SignalingMessage {
+  SignalingMessageType type = SignalingMessageType::kUnknown;
+  bool has_session_description = false;
+  // sessionDescription.sdp.
+  std::string_view sdp;
+  // candidateBatches, set in an offer or answer by a client that accepts
+  // kCandidates messages. Clients that don't know it ignore it.
+  bool supports_candidate_batches = false;
+  // dataFrames, set in an offer or answer by a client that takes its data
+  // channel messages as DataFrame frames, see BulkSender. A client frames
+  // what it sends only once both ends set it.
+  bool supports_data_frames = false;
+  bool has_candidate = false;
+  SignalingCandidate candidate;
+  // The candidates array of a kCandidates message.
+  const SignalingCandidate *candidates = nullptr;
+  size_t candidate_count = 0;
+};
+
+// Nesting SignalingParser follows in values it skips, e.g. unknown keys.
+constexpr int kMaxSignalingDepth = 32;
+
+// Most candidates SignalingParser takes in one message.
+constexpr size_t kMaxSignalingCandidates = 256;
+
+// Parses the JSON JSONEncoder makes of a SignalingMessage, straight from the
+// WebSocket frame, without building a DOM. Strings without escapes are views
+// of the frame; escaped ones, which every SDP is because of its CRLFs, are
+// unescaped into a scratch buffer reused across messages, so steady state
+// parsing allocates nothing.
+//
+// Accepts what JSONDecoder accepts for the schema: keys in any order, unknown
+// keys skipped, null for optionals, "type" required and one of the raw values,
+// sdpMLineIndex an integer in int32 range, candidateBatches and dataFrames bools. The frame
+// is taken to be UTF-8, as WebSocket text frames are; escapes are decoded to
+// UTF-8, lone surrogates are rejected. Not thread safe.
+class SignalingParser {
+ public:
+  SignalingParser() = default;
+  SignalingParser(const SignalingParser &) = delete;
+  SignalingParser &operator=(const SignalingParser &) = delete;
+
+  // Parses |json| into |message|, whose views stay valid until the next Parse
+  // and while |json| is alive. Returns false on malformed JSON or a message
+  // that doesn't fit the schema; error() and error_offset() then say why.
+  bool Parse(std::string_view json, SignalingMessage *message);
+
+  // A static string, "" after a successful Parse.
+  const char *error() const { return error_; }
+  // Offset in the frame the error was found at.
+  size_t error_offset() const { return error_offset_; }
+
+ private:
+  // Calls |field|(key) for every key of the object at the cursor, with the
+  // cursor at the key's value, which |field| consumes.
+  template <typename Field>
+  bool ParseObject(Field field);
+  bool ParseMessage(SignalingMessage *message);
+  bool ParseSessionDescription(SignalingMessage *message);
+  bool ParseCandidate(SignalingCandidate *candidate);
+  bool ParseCandidates();
+  bool ParseBool(bool *value);
+  bool ParseString(std::string_view *value);
+  bool ParseInt32(int32_t *value);
+  bool SkipValue(int depth);
+  bool SkipNumber();
+  bool ParseLiteral(std::string_view literal);
+  // Consumes |c| after any whitespace.
+  bool Expect(char c);
+  // Consumes null if it is next.
+  bool ConsumeNull();
+  void SkipWhitespace();
+  bool Fail(const char *error);
+
+  const char *begin_ = nullptr;
+  const char *cursor_ = nullptr;
+  const char *end_ = nullptr;
+  // Unescaped strings. Reserved to the frame's size before parsing, which
+  // they never exceed, so views into it stay valid while it grows.
+  std::string scratch_;
+  // The candidates array of the message, reused across messages.
+  std::vector<SignalingCandidate> candidates_;
+  const char *error_ = "";
+  size_t error_offset_ = 0;
+};
+
+// Writes SignalingMessages as the JSON JSONEncoder makes of them, apart from
+// key order and not escaping '/', into a buffer reused across messages. Not
+// thread safe.
+class SignalingWriter {
+ public:
+  SignalingWriter() = default;
+  SignalingWriter(const SignalingWriter &) = delete;
+  SignalingWriter &operator=(const SignalingWriter &) = delete;
+
+  // Serializes |message|, replacing the previous one. The result is valid
+  // until the next Write.
+  std::string_view Write(const SignalingMessage &message);
+
+  std::string_view buffer() const { return buffer_; }
+
+ private:
+  void AppendCandidate(const SignalingCandidate &candidate);
+  void AppendString(std::string_view value);
+
+  std::string buffer_;
+};
+
+}  // namespace custom
+
+#endif /* SignalingCodec_h */
@@ -0,0 +1,57 @@
+//
+//  AllocationTrace.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/19.
+//
+
+#include "AllocationTrace.h"
+
+namespace custom {
+
+AllocationTrace::AllocationTrace(size_t capacity) : capacity_(capacity == 0 ? 1 : capacity) {}
+
+void AllocationTrace::BeginFrame() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.frames++;
+  stats_.steady_frames++;
+  frame_has_allocations_ = false;
+}
+
+uint64_t AllocationTrace::Record(const char *what) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.allocations++;
+  stats_.steady_frames = 0;
+  if (!frame_has_allocations_) {
+    stats_.frames_with_allocations++;
+    frame_has_allocations_ = true;
+  }
+
+  Event event;
+  event.frame = stats_.frames;
+  event.what = what;
+  events_.push_back(event);
+  if (events_.size() > capacity_) {
+    events_.pop_front();
+  }
+  return stats_.frames;
+}
+
+AllocationTraceStats AllocationTrace::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+std::vector<AllocationTrace::Event> AllocationTrace::RecentEvents() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return std::vector<Event>(events_.begin(), events_.end());
+}
+
+void AllocationTrace::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  events_.clear();
+  stats_ = AllocationTraceStats();
+  frame_has_allocations_ = false;
+}
+
+}  // namespace custom
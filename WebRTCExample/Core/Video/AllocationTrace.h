@@ -0,0 +1,71 @@
+//
+//  AllocationTrace.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/19.
+//
+
+#ifndef AllocationTrace_h
+#define AllocationTrace_h
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace custom {
+
+struct AllocationTraceStats {
+  uint64_t frames = 0;
+  // Objects created over all frames.
+  uint64_t allocations = 0;
+  // Frames that created at least one object.
+  uint64_t frames_with_allocations = 0;
+  // Frames in a row, up to and including the current one, that created
+  // nothing. Equal to |frames| if nothing was ever allocated.
+  uint64_t steady_frames = 0;
+};
+
+// Frame level record of GPU / CoreVideo object creation, used to check that the
+// render loop reaches a steady state without allocations. Thread safe, so the
+// stats can be read off the render thread.
+class AllocationTrace {
+ public:
+  struct Event {
+    // 1-based index of the frame that created the object.
+    uint64_t frame = 0;
+    // Static string naming the object, e.g. "framebuffer".
+    const char *what = nullptr;
+  };
+
+  static constexpr size_t kDefaultCapacity = 64;
+
+  explicit AllocationTrace(size_t capacity = kDefaultCapacity);
+
+  // Starts a new frame. Allocations recorded before the first call are
+  // attributed to frame 0.
+  void BeginFrame();
+
+  // Records one object creation in the current frame. |what| must outlive the
+  // trace, a string literal in practice. Returns the current frame index.
+  uint64_t Record(const char *what);
+
+  AllocationTraceStats stats() const;
+
+  // The most recent events, oldest first, at most |capacity| of them.
+  std::vector<Event> RecentEvents() const;
+
+  void Reset();
+
+ private:
+  mutable std::mutex mutex_;
+  const size_t capacity_;
+  std::deque<Event> events_;
+  AllocationTraceStats stats_;
+  bool frame_has_allocations_ = false;
+};
+
+}  // namespace custom
+
+#endif /* AllocationTrace_h */
@@ -0,0 +1,722 @@
+//
+//  ColorConvert.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/28.
+//
+
+#include "ColorConvert.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(CUSTOM_ARCH_X86)
+#include <immintrin.h>
+#elif defined(CUSTOM_ARCH_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace custom {
+
+namespace {
+
+typedef ColorConversion::FromBGRARowPairFunc FromBGRARowPairFunc;
+typedef ColorConversion::ToBGRARowFunc ToBGRARowFunc;
+
+// Coefficients of one matrix and range as compile time constants.
+template <YuvMatrix M, YuvRange R>
+struct Coefficients {
+  static constexpr RgbToYuvCoefficients kToYuv = RgbToYuvCoefficientsFor(M, R);
+  static constexpr YuvToRgbCoefficients kToRgb = YuvToRgbCoefficientsFor(M, R);
+};
+
+// The kernels address chroma through two row pointers: the interleaved row for
+// NV12/NV21, with the second one unused, or the U and V rows for I420.
+constexpr bool IsInterleaved(PixelLayout layout) {
+  return layout == PixelLayout::kNV12 || layout == PixelLayout::kNV21;
+}
+
+inline uint8_t Clamp255(int value) {
+  return static_cast<uint8_t>(std::min(std::max(value, 0), 255));
+}
+
+template <PixelLayout L>
+inline void StoreChroma(uint8_t *dst_c0, uint8_t *dst_c1, int i, uint8_t u, uint8_t v) {
+  if (L == PixelLayout::kNV12) {
+    dst_c0[i * 2] = u;
+    dst_c0[i * 2 + 1] = v;
+  } else if (L == PixelLayout::kNV21) {
+    dst_c0[i * 2] = v;
+    dst_c0[i * 2 + 1] = u;
+  } else {
+    dst_c0[i] = u;
+    dst_c1[i] = v;
+  }
+}
+
+template <PixelLayout L>
+inline void LoadChroma(const uint8_t *src_c0, const uint8_t *src_c1, int i, int *u, int *v) {
+  if (L == PixelLayout::kNV12) {
+    *u = src_c0[i * 2];
+    *v = src_c0[i * 2 + 1];
+  } else if (L == PixelLayout::kNV21) {
+    *v = src_c0[i * 2];
+    *u = src_c0[i * 2 + 1];
+  } else {
+    *u = src_c0[i];
+    *v = src_c1[i];
+  }
+}
+
+template <YuvMatrix M, YuvRange R>
+inline uint8_t PixelToY(const uint8_t *bgra) {
+  return static_cast<uint8_t>(RgbToY(Coefficients<M, R>::kToYuv, bgra[2], bgra[1], bgra[0]));
+}
+
+// Chroma of the 2x2 block sums |r|, |g|, |b| of |count| pixels (4, or 2 for
+// the last column of an odd width frame).
+template <YuvMatrix M, YuvRange R, PixelLayout L>
+inline void StoreBlockChroma(uint8_t *dst_c0, uint8_t *dst_c1, int i, int r, int g, int b, int shift) {
+  constexpr RgbToYuvCoefficients c = Coefficients<M, R>::kToYuv;
+  r >>= shift;
+  g >>= shift;
+  b >>= shift;
+  StoreChroma<L>(dst_c0, dst_c1, i, Clamp255(RgbToU(c, r, g, b)), Clamp255(RgbToV(c, r, g, b)));
+}
+
+template <YuvMatrix M, YuvRange R, PixelLayout L>
+void FromBGRARowPairFrom_C(const uint8_t *row0,
+                           const uint8_t *row1,
+                           uint8_t *dst_y0,
+                           uint8_t *dst_y1,
+                           uint8_t *dst_c0,
+                           uint8_t *dst_c1,
+                           int x,
+                           int width) {
+  for (; x + 1 < width; x += 2) {
+    const uint8_t *a = row0 + x * 4;
+    const uint8_t *b = row1 + x * 4;
+    dst_y0[x] = PixelToY<M, R>(a);
+    dst_y0[x + 1] = PixelToY<M, R>(a + 4);
+    dst_y1[x] = PixelToY<M, R>(b);
+    dst_y1[x + 1] = PixelToY<M, R>(b + 4);
+    StoreBlockChroma<M, R, L>(dst_c0, dst_c1, x / 2,
+                              a[2] + a[6] + b[2] + b[6],
+                              a[1] + a[5] + b[1] + b[5],
+                              a[0] + a[4] + b[0] + b[4], 2);
+  }
+  if (x < width) {
+    const uint8_t *a = row0 + x * 4;
+    const uint8_t *b = row1 + x * 4;
+    dst_y0[x] = PixelToY<M, R>(a);
+    dst_y1[x] = PixelToY<M, R>(b);
+    StoreBlockChroma<M, R, L>(dst_c0, dst_c1, x / 2, a[2] + b[2], a[1] + b[1], a[0] + b[0], 1);
+  }
+}
+
+template <YuvMatrix M, YuvRange R, PixelLayout L>
+void FromBGRARowPair_C(const uint8_t *row0,
+                       const uint8_t *row1,
+                       uint8_t *dst_y0,
+                       uint8_t *dst_y1,
+                       uint8_t *dst_c0,
+                       uint8_t *dst_c1,
+                       int width) {
+  FromBGRARowPairFrom_C<M, R, L>(row0, row1, dst_y0, dst_y1, dst_c0, dst_c1, 0, width);
+}
+
+template <YuvMatrix M, YuvRange R, PixelLayout L>
+void ToBGRARowFrom_C(const uint8_t *src_y,
+                     const uint8_t *src_c0,
+                     const uint8_t *src_c1,
+                     uint8_t *dst_bgra,
+                     int x,
+                     int width) {
+  constexpr YuvToRgbCoefficients c = Coefficients<M, R>::kToRgb;
+  for (; x < width; ++x) {
+    int u, v;
+    LoadChroma<L>(src_c0, src_c1, x / 2, &u, &v);
+    u -= 128;
+    v -= 128;
+    const int luma = c.y_scale * (src_y[x] - c.y_offset) + 2048;
+    uint8_t *pixel = dst_bgra + x * 4;
+    pixel[0] = Clamp255((luma + c.ub * u) >> 12);
+    pixel[1] = Clamp255((luma - c.ug * u - c.vg * v) >> 12);
+    pixel[2] = Clamp255((luma + c.vr * v) >> 12);
+    pixel[3] = 255;
+  }
+}
+
+template <YuvMatrix M, YuvRange R, PixelLayout L>
+void ToBGRARow_C(const uint8_t *src_y, const uint8_t *src_c0, const uint8_t *src_c1, uint8_t *dst_bgra, int width) {
+  ToBGRARowFrom_C<M, R, L>(src_y, src_c0, src_c1, dst_bgra, 0, width);
+}
+
+#if defined(CUSTOM_ARCH_X86)
+
+// Sums adjacent 32 bit lanes of |lo| and |hi|: [lo0+lo1, lo2+lo3, hi0+hi1, hi2+hi3].
+__attribute__((target("sse2"))) inline __m128i HorizontalPairSum_SSE2(__m128i lo, __m128i hi) {
+  __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+  __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1));
+  return _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+}
+
+// Four BGRA pixels to four luma bytes in the low 32 bits.
+template <YuvMatrix M, YuvRange R>
+__attribute__((target("sse2"))) inline __m128i Luma4_SSE2(__m128i pixels) {
+  constexpr RgbToYuvCoefficients c = Coefficients<M, R>::kToYuv;
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i coefficients = _mm_setr_epi16(c.yb, c.yg, c.yr, 0, c.yb, c.yg, c.yr, 0);
+  __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), coefficients);
+  __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), coefficients);
+  __m128i sum = HorizontalPairSum_SSE2(lo, hi);
+  sum = _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32((c.y_offset << 8) + 0x80)), 8);
+  sum = _mm_packs_epi32(sum, sum);
+  return _mm_packus_epi16(sum, sum);
+}
+
+// Two 2x2 blocks to [U0 V0 U1 V1] in the low 32 bits, or [V0 U0 V1 U1] for
+// NV21. The saturating packs do the clamping.
+template <YuvMatrix M, YuvRange R, PixelLayout L>
+__attribute__((target("sse2"))) inline __m128i Chroma2_SSE2(__m128i pixels0, __m128i pixels1) {
+  constexpr RgbToYuvCoefficients c = Coefficients<M, R>::kToYuv;
+  constexpr bool kSwap = (L == PixelLayout::kNV21);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i u_coefficients = _mm_setr_epi16(c.ub, c.ug, c.ur, 0, c.ub, c.ug, c.ur, 0);
+  const __m128i v_coefficients = _mm_setr_epi16(c.vb, c.vg, c.vr, 0, c.vb, c.vg, c.vr, 0);
+  __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(pixels0, zero), _mm_unpacklo_epi8(pixels1, zero));
+  __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(pixels0, zero), _mm_unpackhi_epi8(pixels1, zero));
+  lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+  hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+  __m128i average = _mm_srli_epi16(_mm_unpacklo_epi64(lo, hi), 2);
+  __m128i u = _mm_madd_epi16(average, u_coefficients);
+  __m128i v = _mm_madd_epi16(average, v_coefficients);
+  __m128i uv = kSwap ? HorizontalPairSum_SSE2(v, u) : HorizontalPairSum_SSE2(u, v);
+  uv = _mm_shuffle_epi32(uv, _MM_SHUFFLE(3, 1, 2, 0));
+  uv = _mm_srai_epi32(_mm_add_epi32(uv, _mm_set1_epi32((c.uv_offset << 8) + 0x80)), 8);
+  uv = _mm_packs_epi32(uv, uv);
+  return _mm_packus_epi16(uv, uv);
+}
+
+__attribute__((target("sse2"))) inline void Store4(uint8_t *dst, __m128i value) {
+  int32_t word = _mm_cvtsi128_si32(value);
+  memcpy(dst, &word, 4);
+}
+
+// Stores the chroma of four pixels, |chroma| as returned by Chroma2_SSE2.
+template <PixelLayout L>
+__attribute__((target("sse2"))) inline void StoreChroma2_SSE2(uint8_t *dst_c0, uint8_t *dst_c1, int x, __m128i chroma) {
+  if (IsInterleaved(L)) {
+    Store4(dst_c0 + x, chroma);
+  } else {
+    const uint32_t word = static_cast<uint32_t>(_mm_cvtsi128_si32(chroma));
+    dst_c0[x / 2] = static_cast<uint8_t>(word);
+    dst_c1[x / 2] = static_cast<uint8_t>(word >> 8);
+    dst_c0[x / 2 + 1] = static_cast<uint8_t>(word >> 16);
+    dst_c1[x / 2 + 1] = static_cast<uint8_t>(word >> 24);
+  }
+}
+
+template <YuvMatrix M, YuvRange R, PixelLayout L>
+__attribute__((target("sse2"))) void FromBGRARowPair_SSE2(const uint8_t *row0,
+                                                          const uint8_t *row1,
+                                                          uint8_t *dst_y0,
+                                                          uint8_t *dst_y1,
+                                                          uint8_t *dst_c0,
+                                                          uint8_t *dst_c1,
+                                                          int width) {
+  int x = 0;
+  for (; x + 4 <= width; x += 4) {
+    __m128i pixels0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + x * 4));
+    __m128i pixels1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + x * 4));
+    Store4(dst_y0 + x, Luma4_SSE2<M, R>(pixels0));
+    Store4(dst_y1 + x, Luma4_SSE2<M, R>(pixels1));
+    StoreChroma2_SSE2<L>(dst_c0, dst_c1, x, Chroma2_SSE2<M, R, L>(pixels0, pixels1));
+  }
+  FromBGRARowPairFrom_C<M, R, L>(row0, row1, dst_y0, dst_y1, dst_c0, dst_c1, x, width);
+}
+
+// Joins the low 32 bits of both 128 bit lanes into 8 bytes.
+__attribute__((target("avx2"))) inline __m128i JoinLanes_AVX2(__m256i value) {
+  return _mm_unpacklo_epi32(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+}
+
+__attribute__((target("avx2"))) inline __m256i HorizontalPairSum_AVX2(__m256i lo, __m256i hi) {
+  __m256 even = _mm256_shuffle_ps(_mm256_castsi256_ps(lo), _mm256_castsi256_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+  __m256 odd = _mm256_shuffle_ps(_mm256_castsi256_ps(lo), _mm256_castsi256_ps(hi), _MM_SHUFFLE(3, 1, 3, 1));
+  return _mm256_add_epi32(_mm256_castps_si256(even), _mm256_castps_si256(odd));
+}
+
+// Eight BGRA pixels to eight luma bytes. Works per 128 bit lane like Luma4_SSE2.
+template <YuvMatrix M, YuvRange R>
+__attribute__((target("avx2"))) inline __m128i Luma8_AVX2(__m256i pixels) {
+  constexpr RgbToYuvCoefficients c = Coefficients<M, R>::kToYuv;
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i coefficients = _mm256_setr_epi16(c.yb, c.yg, c.yr, 0, c.yb, c.yg, c.yr, 0,
+                                                 c.yb, c.yg, c.yr, 0, c.yb, c.yg, c.yr, 0);
+  __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(pixels, zero), coefficients);
+  __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(pixels, zero), coefficients);
+  __m256i sum = HorizontalPairSum_AVX2(lo, hi);
+  sum = _mm256_srli_epi32(_mm256_add_epi32(sum, _mm256_set1_epi32((c.y_offset << 8) + 0x80)), 8);
+  sum = _mm256_packs_epi32(sum, sum);
+  return JoinLanes_AVX2(_mm256_packus_epi16(sum, sum));
+}
+
+// Four 2x2 blocks to [U0 V0 U1 V1 U2 V2 U3 V3], [V0 U0 ...] for NV21 and
+// [U0 U1 U2 U3 V0 V1 V2 V3] for I420.
+template <YuvMatrix M, YuvRange R, PixelLayout L>
+__attribute__((target("avx2"))) inline __m128i Chroma4_AVX2(__m256i pixels0, __m256i pixels1) {
+  constexpr RgbToYuvCoefficients c = Coefficients<M, R>::kToYuv;
+  constexpr bool kSwap = (L == PixelLayout::kNV21);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i u_coefficients = _mm256_setr_epi16(c.ub, c.ug, c.ur, 0, c.ub, c.ug, c.ur, 0,
+                                                   c.ub, c.ug, c.ur, 0, c.ub, c.ug, c.ur, 0);
+  const __m256i v_coefficients = _mm256_setr_epi16(c.vb, c.vg, c.vr, 0, c.vb, c.vg, c.vr, 0,
+                                                   c.vb, c.vg, c.vr, 0, c.vb, c.vg, c.vr, 0);
+  __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(pixels0, zero), _mm256_unpacklo_epi8(pixels1, zero));
+  __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(pixels0, zero), _mm256_unpackhi_epi8(pixels1, zero));
+  lo = _mm256_add_epi16(lo, _mm256_srli_si256(lo, 8));
+  hi = _mm256_add_epi16(hi, _mm256_srli_si256(hi, 8));
+  __m256i average = _mm256_srli_epi16(_mm256_unpacklo_epi64(lo, hi), 2);
+  __m256i u = _mm256_madd_epi16(average, u_coefficients);
+  __m256i v = _mm256_madd_epi16(average, v_coefficients);
+  __m256i uv = kSwap ? HorizontalPairSum_AVX2(v, u) : HorizontalPairSum_AVX2(u, v);
+  uv = _mm256_shuffle_epi32(uv, _MM_SHUFFLE(3, 1, 2, 0));
+  uv = _mm256_srai_epi32(_mm256_add_epi32(uv, _mm256_set1_epi32((c.uv_offset << 8) + 0x80)), 8);
+  uv = _mm256_packs_epi32(uv, uv);
+  __m128i chroma = JoinLanes_AVX2(_mm256_packus_epi16(uv, uv));
+  if (!IsInterleaved(L)) {
+    chroma = _mm_shuffle_epi8(chroma, _mm_setr_epi8(0, 2, 4, 6, 1, 3, 5, 7, -1, -1, -1, -1, -1, -1, -1, -1));
+  }
+  return chroma;
+}
+
+template <YuvMatrix M, YuvRange R, PixelLayout L>
+__attribute__((target("avx2"))) void FromBGRARowPair_AVX2(const uint8_t *row0,
+                                                          const uint8_t *row1,
+                                                          uint8_t *dst_y0,
+                                                          uint8_t *dst_y1,
+                                                          uint8_t *dst_c0,
+                                                          uint8_t *dst_c1,
+                                                          int width) {
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    __m256i pixels0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0 + x * 4));
+    __m256i pixels1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1 + x * 4));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst_y0 + x), Luma8_AVX2<M, R>(pixels0));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst_y1 + x), Luma8_AVX2<M, R>(pixels1));
+    __m128i chroma = Chroma4_AVX2<M, R, L>(pixels0, pixels1);
+    if (IsInterleaved(L)) {
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(dst_c0 + x), chroma);
+    } else {
+      Store4(dst_c0 + x / 2, chroma);
+      Store4(dst_c1 + x / 2, _mm_srli_si128(chroma, 4));
+    }
+  }
+  FromBGRARowPairFrom_C<M, R, L>(row0, row1, dst_y0, dst_y1, dst_c0, dst_c1, x, width);
+}
+
+// U and V of eight pixels, each sample repeated for its two columns, as 32 bit
+// lanes.
+template <PixelLayout L>
+__attribute__((target("avx2"))) inline void LoadChroma8_AVX2(const uint8_t *src_c0,
+                                                             const uint8_t *src_c1,
+                                                             int x,
+                                                             __m256i *u,
+                                                             __m256i *v) {
+  __m128i first, second;
+  if (IsInterleaved(L)) {
+    __m128i pairs = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src_c0 + x));
+    first = _mm_shuffle_epi8(pairs, _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, -1, -1, -1, -1, -1, -1, -1, -1));
+    second = _mm_shuffle_epi8(pairs, _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, -1, -1, -1, -1, -1, -1, -1, -1));
+  } else {
+    const __m128i repeat = _mm_setr_epi8(0, 0, 1, 1, 2, 2, 3, 3, -1, -1, -1, -1, -1, -1, -1, -1);
+    int32_t word;
+    memcpy(&word, src_c0 + x / 2, 4);
+    first = _mm_shuffle_epi8(_mm_cvtsi32_si128(word), repeat);
+    memcpy(&word, src_c1 + x / 2, 4);
+    second = _mm_shuffle_epi8(_mm_cvtsi32_si128(word), repeat);
+  }
+  if (L == PixelLayout::kNV21) {
+    std::swap(first, second);
+  }
+  *u = _mm256_cvtepu8_epi32(first);
+  *v = _mm256_cvtepu8_epi32(second);
+}
+
+__attribute__((target("avx2"))) inline __m256i Clamp255_AVX2(__m256i value) {
+  return _mm256_min_epi32(_mm256_max_epi32(value, _mm256_setzero_si256()), _mm256_set1_epi32(255));
+}
+
+template <YuvMatrix M, YuvRange R, PixelLayout L>
+__attribute__((target("avx2"))) void ToBGRARow_AVX2(const uint8_t *src_y,
+                                                    const uint8_t *src_c0,
+                                                    const uint8_t *src_c1,
+                                                    uint8_t *dst_bgra,
+                                                    int width) {
+  constexpr YuvToRgbCoefficients c = Coefficients<M, R>::kToRgb;
+  const __m256i luma_offset = _mm256_set1_epi32(2048 - c.y_scale * c.y_offset);
+  const __m256i chroma_offset = _mm256_set1_epi32(128);
+  const __m256i alpha = _mm256_set1_epi32(static_cast<int32_t>(0xFF000000u));
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    __m256i y = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src_y + x)));
+    __m256i u, v;
+    LoadChroma8_AVX2<L>(src_c0, src_c1, x, &u, &v);
+    u = _mm256_sub_epi32(u, chroma_offset);
+    v = _mm256_sub_epi32(v, chroma_offset);
+    __m256i luma = _mm256_add_epi32(_mm256_mullo_epi32(y, _mm256_set1_epi32(c.y_scale)), luma_offset);
+    __m256i b = _mm256_add_epi32(luma, _mm256_mullo_epi32(u, _mm256_set1_epi32(c.ub)));
+    __m256i g = _mm256_sub_epi32(luma, _mm256_add_epi32(_mm256_mullo_epi32(u, _mm256_set1_epi32(c.ug)),
+                                                        _mm256_mullo_epi32(v, _mm256_set1_epi32(c.vg))));
+    __m256i r = _mm256_add_epi32(luma, _mm256_mullo_epi32(v, _mm256_set1_epi32(c.vr)));
+    b = Clamp255_AVX2(_mm256_srai_epi32(b, 12));
+    g = Clamp255_AVX2(_mm256_srai_epi32(g, 12));
+    r = Clamp255_AVX2(_mm256_srai_epi32(r, 12));
+    __m256i pixels = _mm256_or_si256(_mm256_or_si256(b, _mm256_slli_epi32(g, 8)),
+                                     _mm256_or_si256(_mm256_slli_epi32(r, 16), alpha));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst_bgra + x * 4), pixels);
+  }
+  ToBGRARowFrom_C<M, R, L>(src_y, src_c0, src_c1, dst_bgra, x, width);
+}
+
+#endif  // CUSTOM_ARCH_X86
+
+#if defined(CUSTOM_ARCH_NEON)
+
+template <YuvMatrix M, YuvRange R>
+inline uint8x8_t Luma8_NEON(const uint8x8x4_t &pixels) {
+  constexpr RgbToYuvCoefficients c = Coefficients<M, R>::kToYuv;
+  uint16x8_t y = vmull_u8(pixels.val[0], vdup_n_u8(c.yb));
+  y = vmlal_u8(y, pixels.val[1], vdup_n_u8(c.yg));
+  y = vmlal_u8(y, pixels.val[2], vdup_n_u8(c.yr));
+  y = vaddq_u16(y, vdupq_n_u16((c.y_offset << 8) + 0x80));
+  return vshrn_n_u16(y, 8);
+}
+
+// Sum of each 2x2 block of one channel, divided by 4 with truncation.
+inline int16x4_t BlockAverage_NEON(uint8x8_t row0, uint8x8_t row1) {
+  uint16x8_t columns = vaddl_u8(row0, row1);
+  uint16x4_t blocks = vpadd_u16(vget_low_u16(columns), vget_high_u16(columns));
+  return vreinterpret_s16_u16(vshr_n_u16(blocks, 2));
+}
+
+// Stores the chroma of four 2x2 blocks; vqmovun does the clamping.
+template <YuvMatrix M, YuvRange R, PixelLayout L>
+inline void StoreChroma4_NEON(const uint8x8x4_t &pixels0,
+                              const uint8x8x4_t &pixels1,
+                              uint8_t *dst_c0,
+                              uint8_t *dst_c1,
+                              int x) {
+  constexpr RgbToYuvCoefficients c = Coefficients<M, R>::kToYuv;
+  const int32x4_t offset = vdupq_n_s32((c.uv_offset << 8) + 0x80);
+  int16x4_t b = BlockAverage_NEON(pixels0.val[0], pixels1.val[0]);
+  int16x4_t g = BlockAverage_NEON(pixels0.val[1], pixels1.val[1]);
+  int16x4_t r = BlockAverage_NEON(pixels0.val[2], pixels1.val[2]);
+  int32x4_t u = vmlal_n_s16(offset, b, c.ub);
+  u = vmlal_n_s16(u, g, c.ug);
+  u = vmlal_n_s16(u, r, c.ur);
+  int32x4_t v = vmlal_n_s16(offset, r, c.vr);
+  v = vmlal_n_s16(v, g, c.vg);
+  v = vmlal_n_s16(v, b, c.vb);
+  int16x4_t u16 = vshrn_n_s32(u, 8);
+  int16x4_t v16 = vshrn_n_s32(v, 8);
+  if (IsInterleaved(L)) {
+    int16x4x2_t pairs = (L == PixelLayout::kNV21) ? vzip_s16(v16, u16) : vzip_s16(u16, v16);
+    vst1_u8(dst_c0 + x, vqmovun_s16(vcombine_s16(pairs.val[0], pairs.val[1])));
+  } else {
+    uint32x2_t planes = vreinterpret_u32_u8(vqmovun_s16(vcombine_s16(u16, v16)));
+    const uint32_t u_word = vget_lane_u32(planes, 0);
+    const uint32_t v_word = vget_lane_u32(planes, 1);
+    memcpy(dst_c0 + x / 2, &u_word, 4);
+    memcpy(dst_c1 + x / 2, &v_word, 4);
+  }
+}
+
+template <YuvMatrix M, YuvRange R, PixelLayout L>
+void FromBGRARowPair_NEON(const uint8_t *row0,
+                          const uint8_t *row1,
+                          uint8_t *dst_y0,
+                          uint8_t *dst_y1,
+                          uint8_t *dst_c0,
+                          uint8_t *dst_c1,
+                          int width) {
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    uint8x8x4_t pixels0 = vld4_u8(row0 + x * 4);
+    uint8x8x4_t pixels1 = vld4_u8(row1 + x * 4);
+    vst1_u8(dst_y0 + x, Luma8_NEON<M, R>(pixels0));
+    vst1_u8(dst_y1 + x, Luma8_NEON<M, R>(pixels1));
+    StoreChroma4_NEON<M, R, L>(pixels0, pixels1, dst_c0, dst_c1, x);
+  }
+  FromBGRARowPairFrom_C<M, R, L>(row0, row1, dst_y0, dst_y1, dst_c0, dst_c1, x, width);
+}
+
+// U and V of eight pixels, each sample repeated for its two columns, centered
+// on 0.
+template <PixelLayout L>
+inline void LoadChroma8_NEON(const uint8_t *src_c0, const uint8_t *src_c1, int x, int16x8_t *u, int16x8_t *v) {
+  uint8x8_t first, second;
+  if (IsInterleaved(L)) {
+    const uint8_t kEven[8] = {0, 0, 2, 2, 4, 4, 6, 6};
+    const uint8_t kOdd[8] = {1, 1, 3, 3, 5, 5, 7, 7};
+    uint8x8_t pairs = vld1_u8(src_c0 + x);
+    first = vtbl1_u8(pairs, vld1_u8(kEven));
+    second = vtbl1_u8(pairs, vld1_u8(kOdd));
+  } else {
+    const uint8_t kRepeat[8] = {0, 0, 1, 1, 2, 2, 3, 3};
+    uint32_t word;
+    memcpy(&word, src_c0 + x / 2, 4);
+    first = vtbl1_u8(vcreate_u8(word), vld1_u8(kRepeat));
+    memcpy(&word, src_c1 + x / 2, 4);
+    second = vtbl1_u8(vcreate_u8(word), vld1_u8(kRepeat));
+  }
+  if (L == PixelLayout::kNV21) {
+    std::swap(first, second);
+  }
+  *u = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(first)), vdupq_n_s16(128));
+  *v = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(second)), vdupq_n_s16(128));
+}
+
+// One channel of eight pixels from the 32 bit sums of both halves.
+inline uint8x8_t Narrow8_NEON(int32x4_t lo, int32x4_t hi) {
+  return vqmovn_u16(vcombine_u16(vqmovun_s32(vshrq_n_s32(lo, 12)), vqmovun_s32(vshrq_n_s32(hi, 12))));
+}
+
+template <YuvMatrix M, YuvRange R, PixelLayout L>
+void ToBGRARow_NEON(const uint8_t *src_y,
+                    const uint8_t *src_c0,
+                    const uint8_t *src_c1,
+                    uint8_t *dst_bgra,
+                    int width) {
+  constexpr YuvToRgbCoefficients c = Coefficients<M, R>::kToRgb;
+  const int32x4_t luma_offset = vdupq_n_s32(2048 - c.y_scale * c.y_offset);
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    int16x8_t y = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(src_y + x)));
+    int16x8_t u, v;
+    LoadChroma8_NEON<L>(src_c0, src_c1, x, &u, &v);
+    int32x4_t luma_lo = vmlaq_n_s32(luma_offset, vmovl_s16(vget_low_s16(y)), c.y_scale);
+    int32x4_t luma_hi = vmlaq_n_s32(luma_offset, vmovl_s16(vget_high_s16(y)), c.y_scale);
+    int32x4_t u_lo = vmovl_s16(vget_low_s16(u));
+    int32x4_t u_hi = vmovl_s16(vget_high_s16(u));
+    int32x4_t v_lo = vmovl_s16(vget_low_s16(v));
+    int32x4_t v_hi = vmovl_s16(vget_high_s16(v));
+    uint8x8x4_t pixels;
+    pixels.val[0] = Narrow8_NEON(vmlaq_n_s32(luma_lo, u_lo, c.ub), vmlaq_n_s32(luma_hi, u_hi, c.ub));
+    pixels.val[1] = Narrow8_NEON(vmlsq_n_s32(vmlsq_n_s32(luma_lo, u_lo, c.ug), v_lo, c.vg),
+                                 vmlsq_n_s32(vmlsq_n_s32(luma_hi, u_hi, c.ug), v_hi, c.vg));
+    pixels.val[2] = Narrow8_NEON(vmlaq_n_s32(luma_lo, v_lo, c.vr), vmlaq_n_s32(luma_hi, v_hi, c.vr));
+    pixels.val[3] = vdup_n_u8(255);
+    vst4_u8(dst_bgra + x * 4, pixels);
+  }
+  ToBGRARowFrom_C<M, R, L>(src_y, src_c0, src_c1, dst_bgra, x, width);
+}
+
+#endif  // CUSTOM_ARCH_NEON
+
+// The row kernels of one path for one matrix and range, indexed by the 4:2:0
+// layout (NV12, NV21, I420).
+struct KernelSet {
+  FromBGRARowPairFunc from_bgra[3];
+  ToBGRARowFunc to_bgra[3];
+};
+
+inline int ChromaLayoutIndex(PixelLayout layout) {
+  return static_cast<int>(layout) - static_cast<int>(PixelLayout::kNV12);
+}
+
+template <YuvMatrix M, YuvRange R>
+struct ScalarKernels {
+  static constexpr KernelSet kSet = {
+      {FromBGRARowPair_C<M, R, PixelLayout::kNV12>,
+       FromBGRARowPair_C<M, R, PixelLayout::kNV21>,
+       FromBGRARowPair_C<M, R, PixelLayout::kI420>},
+      {ToBGRARow_C<M, R, PixelLayout::kNV12>,
+       ToBGRARow_C<M, R, PixelLayout::kNV21>,
+       ToBGRARow_C<M, R, PixelLayout::kI420>},
+  };
+};
+
+#if defined(CUSTOM_ARCH_X86)
+
+template <YuvMatrix M, YuvRange R>
+struct SSE2Kernels {
+  static constexpr KernelSet kSet = {
+      {FromBGRARowPair_SSE2<M, R, PixelLayout::kNV12>,
+       FromBGRARowPair_SSE2<M, R, PixelLayout::kNV21>,
+       FromBGRARowPair_SSE2<M, R, PixelLayout::kI420>},
+      {ToBGRARow_C<M, R, PixelLayout::kNV12>,
+       ToBGRARow_C<M, R, PixelLayout::kNV21>,
+       ToBGRARow_C<M, R, PixelLayout::kI420>},
+  };
+};
+
+template <YuvMatrix M, YuvRange R>
+struct AVX2Kernels {
+  static constexpr KernelSet kSet = {
+      {FromBGRARowPair_AVX2<M, R, PixelLayout::kNV12>,
+       FromBGRARowPair_AVX2<M, R, PixelLayout::kNV21>,
+       FromBGRARowPair_AVX2<M, R, PixelLayout::kI420>},
+      {ToBGRARow_AVX2<M, R, PixelLayout::kNV12>,
+       ToBGRARow_AVX2<M, R, PixelLayout::kNV21>,
+       ToBGRARow_AVX2<M, R, PixelLayout::kI420>},
+  };
+};
+
+#endif  // CUSTOM_ARCH_X86
+
+#if defined(CUSTOM_ARCH_NEON)
+
+template <YuvMatrix M, YuvRange R>
+struct NEONKernels {
+  static constexpr KernelSet kSet = {
+      {FromBGRARowPair_NEON<M, R, PixelLayout::kNV12>,
+       FromBGRARowPair_NEON<M, R, PixelLayout::kNV21>,
+       FromBGRARowPair_NEON<M, R, PixelLayout::kI420>},
+      {ToBGRARow_NEON<M, R, PixelLayout::kNV12>,
+       ToBGRARow_NEON<M, R, PixelLayout::kNV21>,
+       ToBGRARow_NEON<M, R, PixelLayout::kI420>},
+  };
+};
+
+#endif  // CUSTOM_ARCH_NEON
+
+// Every matrix and range of one path, indexed by YuvMatrix and YuvRange.
+template <template <YuvMatrix, YuvRange> class Kernels>
+const KernelSet &KernelTable(YuvMatrix matrix, YuvRange range) {
+  static constexpr KernelSet kTable[3][2] = {
+      {Kernels<YuvMatrix::kBT601, YuvRange::kVideo>::kSet, Kernels<YuvMatrix::kBT601, YuvRange::kFull>::kSet},
+      {Kernels<YuvMatrix::kBT709, YuvRange::kVideo>::kSet, Kernels<YuvMatrix::kBT709, YuvRange::kFull>::kSet},
+      {Kernels<YuvMatrix::kBT2020, YuvRange::kVideo>::kSet, Kernels<YuvMatrix::kBT2020, YuvRange::kFull>::kSet},
+  };
+  return kTable[static_cast<int>(matrix)][static_cast<int>(range)];
+}
+
+const KernelSet *SelectKernelSet(YuvMatrix matrix, YuvRange range, SimdPath path) {
+  switch (path) {
+#if defined(CUSTOM_ARCH_X86)
+    case SimdPath::kSSE2:
+      return &KernelTable<SSE2Kernels>(matrix, range);
+    case SimdPath::kAVX2:
+      return &KernelTable<AVX2Kernels>(matrix, range);
+#endif
+#if defined(CUSTOM_ARCH_NEON)
+    case SimdPath::kNEON:
+      return &KernelTable<NEONKernels>(matrix, range);
+#endif
+    case SimdPath::kScalar:
+      return &KernelTable<ScalarKernels>(matrix, range);
+    default:
+      return nullptr;
+  }
+}
+
+bool IsValidImage(const ColorImage &image) {
+  if (image.width <= 0 || image.height <= 0 || !image.planes[0]) {
+    return false;
+  }
+  const int chroma_width = (image.width + 1) / 2;
+  switch (image.layout) {
+    case PixelLayout::kBGRA:
+      return image.strides[0] >= image.width * 4;
+    case PixelLayout::kNV12:
+    case PixelLayout::kNV21:
+      return image.strides[0] >= image.width && image.planes[1] && image.strides[1] >= chroma_width * 2;
+    case PixelLayout::kI420:
+      return image.strides[0] >= image.width && image.planes[1] && image.planes[2] &&
+             image.strides[1] >= chroma_width && image.strides[2] >= chroma_width;
+  }
+  return false;
+}
+
+inline uint8_t *ChromaRow(const ColorImage &image, int plane, int y) {
+  return image.planes[plane] ? image.planes[plane] + static_cast<size_t>(y / 2) * image.strides[plane] : nullptr;
+}
+
+void ConvertFromBGRA(const ColorImage &src, const ColorImage &dst, FromBGRARowPairFunc row_pair) {
+  // Scratch luma row for the missing second row of an odd height frame. Kept
+  // per thread so steady state does not allocate.
+  thread_local std::vector<uint8_t> spare_y;
+  if (spare_y.size() < static_cast<size_t>(dst.width)) {
+    spare_y.resize(dst.width);
+  }
+  for (int y = 0; y < dst.height; y += 2) {
+    const bool has_pair = (y + 1 < dst.height);
+    const uint8_t *row0 = src.planes[0] + static_cast<size_t>(y) * src.strides[0];
+    const uint8_t *row1 = has_pair ? row0 + src.strides[0] : row0;
+    uint8_t *y0 = dst.planes[0] + static_cast<size_t>(y) * dst.strides[0];
+    uint8_t *y1 = has_pair ? y0 + dst.strides[0] : spare_y.data();
+    row_pair(row0, row1, y0, y1, ChromaRow(dst, 1, y), ChromaRow(dst, 2, y), dst.width);
+  }
+}
+
+void ConvertToBGRA(const ColorImage &src, const ColorImage &dst, ToBGRARowFunc row) {
+  for (int y = 0; y < dst.height; ++y) {
+    row(src.planes[0] + static_cast<size_t>(y) * src.strides[0],
+        ChromaRow(src, 1, y),
+        ChromaRow(src, 2, y),
+        dst.planes[0] + static_cast<size_t>(y) * dst.strides[0],
+        dst.width);
+  }
+}
+
+}  // namespace
+
+const char *PixelLayoutName(PixelLayout layout) {
+  switch (layout) {
+    case PixelLayout::kBGRA:
+      return "BGRA";
+    case PixelLayout::kNV12:
+      return "NV12";
+    case PixelLayout::kNV21:
+      return "NV21";
+    case PixelLayout::kI420:
+      return "I420";
+  }
+  return "unknown";
+}
+
+ColorConversion ColorConversion::Select(YuvMatrix matrix,
+                                        YuvRange range,
+                                        PixelLayout src_layout,
+                                        PixelLayout dst_layout,
+                                        SimdPath path) {
+  ColorConversion conversion;
+  const bool from_bgra = (src_layout == PixelLayout::kBGRA);
+  if (from_bgra == (dst_layout == PixelLayout::kBGRA) || !IsSimdPathSupported(path)) {
+    return conversion;
+  }
+  const SimdPath resolved = ResolveSimdPath(path);
+  const KernelSet *kernels = SelectKernelSet(matrix, range, resolved);
+  if (!kernels) {
+    return conversion;
+  }
+  conversion.matrix_ = matrix;
+  conversion.range_ = range;
+  conversion.src_layout_ = src_layout;
+  conversion.dst_layout_ = dst_layout;
+  conversion.path_ = resolved;
+  if (from_bgra) {
+    conversion.from_bgra_ = kernels->from_bgra[ChromaLayoutIndex(dst_layout)];
+  } else {
+    conversion.to_bgra_ = kernels->to_bgra[ChromaLayoutIndex(src_layout)];
+  }
+  return conversion;
+}
+
+bool ColorConversion::Convert(const ColorImage &src, const ColorImage &dst) const {
+  if (!valid() || src.layout != src_layout_ || dst.layout != dst_layout_ || src.width != dst.width ||
+      src.height != dst.height || !IsValidImage(src) || !IsValidImage(dst)) {
+    return false;
+  }
+  if (from_bgra_) {
+    ConvertFromBGRA(src, dst, from_bgra_);
+  } else {
+    ConvertToBGRA(src, dst, to_bgra_);
+  }
+  return true;
+}
+
+}  // namespace custom
@@ -0,0 +1,104 @@
+//
+//  ColorConvert.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/28.
+//
+
+#ifndef ColorConvert_h
+#define ColorConvert_h
+
+#include <cstdint>
+
+#include "CpuFeatures.h"
+#include "FrameFormat.h"
+#include "YuvConversion.h"
+
+namespace custom {
+
+enum class PixelLayout {
+  // One plane, B G R A bytes per pixel (libyuv "ARGB").
+  kBGRA,
+  // Luma plane and an interleaved U V plane.
+  kNV12,
+  // Luma plane and an interleaved V U plane.
+  kNV21,
+  // Luma, U and V planes.
+  kI420,
+};
+
+const char *PixelLayoutName(PixelLayout layout);
+
+// A frame in one of the layouts above. Each plane is addressed through its own
+// stride.
+struct ColorImage {
+  PixelLayout layout = PixelLayout::kBGRA;
+  int width = 0;
+  int height = 0;
+  uint8_t *planes[kMaxPlanes] = {};
+  int strides[kMaxPlanes] = {};
+};
+
+// A conversion between BGRA and one of the 4:2:0 layouts, in either direction,
+// for one color matrix and range. Every combination is a separate compile time
+// specialization: coefficients, offsets, clamping and the chroma layout are
+// constants of the inner loop, which has no per pixel branches. Select one
+// when a stream starts and keep it; Convert() only checks its arguments and
+// calls the kernel.
+//
+// BGRA -> YUV uses a 2x2 chroma box filter and, for BT.601 video range NV12, is
+// bit-exact with BGRAToNV12Rotated() and the C path of libyuv::ARGBToNV12.
+// YUV -> BGRA replicates each chroma sample over its 2x2 block and writes
+// opaque alpha. All SIMD paths match the scalar path bit for bit. There is no
+// SSE2 kernel for YUV -> BGRA, SimdPath::kSSE2 runs the scalar code there.
+class ColorConversion {
+ public:
+  typedef void (*FromBGRARowPairFunc)(const uint8_t *row0,
+                                      const uint8_t *row1,
+                                      uint8_t *dst_y0,
+                                      uint8_t *dst_y1,
+                                      uint8_t *dst_c0,
+                                      uint8_t *dst_c1,
+                                      int width);
+  typedef void (*ToBGRARowFunc)(const uint8_t *src_y,
+                                const uint8_t *src_c0,
+                                const uint8_t *src_c1,
+                                uint8_t *dst_bgra,
+                                int width);
+
+  // Invalid; Convert() fails.
+  ColorConversion() = default;
+
+  // Returns an invalid conversion if neither or both layouts are kBGRA, or if
+  // |path| is not supported.
+  static ColorConversion Select(YuvMatrix matrix,
+                                YuvRange range,
+                                PixelLayout src_layout,
+                                PixelLayout dst_layout,
+                                SimdPath path = SimdPath::kAuto);
+
+  bool valid() const { return from_bgra_ || to_bgra_; }
+  YuvMatrix matrix() const { return matrix_; }
+  YuvRange range() const { return range_; }
+  PixelLayout src_layout() const { return src_layout_; }
+  PixelLayout dst_layout() const { return dst_layout_; }
+  // The resolved path, never kAuto.
+  SimdPath path() const { return path_; }
+
+  // |src| and |dst| must have the selected layouts and the same size. Returns
+  // false on invalid arguments.
+  bool Convert(const ColorImage &src, const ColorImage &dst) const;
+
+ private:
+  YuvMatrix matrix_ = YuvMatrix::kBT601;
+  YuvRange range_ = YuvRange::kVideo;
+  PixelLayout src_layout_ = PixelLayout::kBGRA;
+  PixelLayout dst_layout_ = PixelLayout::kBGRA;
+  SimdPath path_ = SimdPath::kScalar;
+  FromBGRARowPairFunc from_bgra_ = nullptr;
+  ToBGRARowFunc to_bgra_ = nullptr;
+};
+
+}  // namespace custom
+
+#endif /* ColorConvert_h */
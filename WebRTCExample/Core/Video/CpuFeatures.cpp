@@ -0,0 +1,64 @@
+//
+//  CpuFeatures.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/16.
+//
+
+#include "CpuFeatures.h"
+
+namespace custom {
+
+bool IsSimdPathSupported(SimdPath path) {
+  switch (path) {
+    case SimdPath::kAuto:
+    case SimdPath::kScalar:
+      return true;
+#if defined(CUSTOM_ARCH_X86)
+    case SimdPath::kSSE2:
+      return __builtin_cpu_supports("sse2");
+    case SimdPath::kAVX2:
+      return __builtin_cpu_supports("avx2");
+#endif
+#if defined(CUSTOM_ARCH_NEON)
+    case SimdPath::kNEON:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+SimdPath ResolveSimdPath(SimdPath path) {
+  if (path != SimdPath::kAuto) {
+    return path;
+  }
+  if (IsSimdPathSupported(SimdPath::kAVX2)) {
+    return SimdPath::kAVX2;
+  }
+  if (IsSimdPathSupported(SimdPath::kSSE2)) {
+    return SimdPath::kSSE2;
+  }
+  if (IsSimdPathSupported(SimdPath::kNEON)) {
+    return SimdPath::kNEON;
+  }
+  return SimdPath::kScalar;
+}
+
+const char *SimdPathName(SimdPath path) {
+  switch (path) {
+    case SimdPath::kAuto:
+      return "auto";
+    case SimdPath::kScalar:
+      return "scalar";
+    case SimdPath::kSSE2:
+      return "sse2";
+    case SimdPath::kAVX2:
+      return "avx2";
+    case SimdPath::kNEON:
+      return "neon";
+  }
+  return "unknown";
+}
+
+}  // namespace custom
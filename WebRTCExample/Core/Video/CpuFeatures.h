@@ -0,0 +1,39 @@
+//
+//  CpuFeatures.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/16.
+//
+
+#ifndef CpuFeatures_h
+#define CpuFeatures_h
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CUSTOM_ARCH_X86 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CUSTOM_ARCH_NEON 1
+#endif
+
+namespace custom {
+
+// Instruction set used by a kernel. kAuto picks the best one the CPU supports;
+// the others force a specific path, e.g. to compare paths against each other.
+enum class SimdPath {
+  kAuto,
+  kScalar,
+  kSSE2,
+  kAVX2,
+  kNEON,
+};
+
+// Returns true if |path| can run on this CPU. kAuto and kScalar always can.
+bool IsSimdPathSupported(SimdPath path);
+
+// Resolves kAuto to the best supported path; other values are returned as is.
+SimdPath ResolveSimdPath(SimdPath path);
+
+const char *SimdPathName(SimdPath path);
+
+}  // namespace custom
+
+#endif /* CpuFeatures_h */
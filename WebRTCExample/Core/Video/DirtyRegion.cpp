@@ -0,0 +1,337 @@
+//
+//  DirtyRegion.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/2.
+//
+
+#include "DirtyRegion.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(CUSTOM_ARCH_X86)
+#include <immintrin.h>
+#elif defined(CUSTOM_ARCH_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace custom {
+
+namespace {
+
+constexpr int kBlockSize = DirtyRegionDetector::kBlockSize;
+
+// SAD of a block of full kBlockSize width and |height| rows.
+typedef uint32_t (*BlockSad16Func)(const uint8_t *a, int stride_a, const uint8_t *b, int stride_b, int height);
+
+uint32_t BlockSad_C(const uint8_t *a, int stride_a, const uint8_t *b, int stride_b, int width, int height) {
+  uint32_t sad = 0;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      sad += static_cast<uint32_t>(std::abs(a[x] - b[x]));
+    }
+    a += stride_a;
+    b += stride_b;
+  }
+  return sad;
+}
+
+uint32_t BlockSad16_C(const uint8_t *a, int stride_a, const uint8_t *b, int stride_b, int height) {
+  return BlockSad_C(a, stride_a, b, stride_b, kBlockSize, height);
+}
+
+#if defined(CUSTOM_ARCH_X86)
+
+__attribute__((target("sse2"))) uint32_t BlockSad16_SSE2(const uint8_t *a,
+                                                         int stride_a,
+                                                         const uint8_t *b,
+                                                         int stride_b,
+                                                         int height) {
+  __m128i sum = _mm_setzero_si128();
+  for (int y = 0; y < height; ++y) {
+    __m128i row_a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+    __m128i row_b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+    sum = _mm_add_epi64(sum, _mm_sad_epu8(row_a, row_b));
+    a += stride_a;
+    b += stride_b;
+  }
+  return static_cast<uint32_t>(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+}
+
+// Two rows per iteration, one in each 128 bit lane.
+__attribute__((target("avx2"))) uint32_t BlockSad16_AVX2(const uint8_t *a,
+                                                         int stride_a,
+                                                         const uint8_t *b,
+                                                         int stride_b,
+                                                         int height) {
+  __m256i sum = _mm256_setzero_si256();
+  int y = 0;
+  for (; y + 2 <= height; y += 2) {
+    __m256i rows_a = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + stride_a)), 1);
+    __m256i rows_b = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + stride_b)), 1);
+    sum = _mm256_add_epi64(sum, _mm256_sad_epu8(rows_a, rows_b));
+    a += 2 * stride_a;
+    b += 2 * stride_b;
+  }
+  __m128i total = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+  if (y < height) {
+    total = _mm_add_epi64(total, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a)),
+                                              _mm_loadu_si128(reinterpret_cast<const __m128i *>(b))));
+  }
+  return static_cast<uint32_t>(_mm_cvtsi128_si32(total) + _mm_cvtsi128_si32(_mm_srli_si128(total, 8)));
+}
+
+#endif  // CUSTOM_ARCH_X86
+
+#if defined(CUSTOM_ARCH_NEON)
+
+uint32_t BlockSad16_NEON(const uint8_t *a, int stride_a, const uint8_t *b, int stride_b, int height) {
+  uint16x8_t sum = vdupq_n_u16(0);
+  for (int y = 0; y < height; ++y) {
+    uint8x16_t row_a = vld1q_u8(a);
+    uint8x16_t row_b = vld1q_u8(b);
+    sum = vabal_u8(sum, vget_low_u8(row_a), vget_low_u8(row_b));
+    sum = vabal_u8(sum, vget_high_u8(row_a), vget_high_u8(row_b));
+    a += stride_a;
+    b += stride_b;
+  }
+  // At most 16 rows of 2 * 255 per lane, no overflow.
+  uint32x4_t pairs = vpaddlq_u16(sum);
+  uint64x2_t quads = vpaddlq_u32(pairs);
+  return static_cast<uint32_t>(vgetq_lane_u64(quads, 0) + vgetq_lane_u64(quads, 1));
+}
+
+#endif  // CUSTOM_ARCH_NEON
+
+BlockSad16Func SelectBlockSad16Func(SimdPath path) {
+  if (!IsSimdPathSupported(path)) {
+    return nullptr;
+  }
+  switch (ResolveSimdPath(path)) {
+#if defined(CUSTOM_ARCH_X86)
+    case SimdPath::kSSE2:
+      return BlockSad16_SSE2;
+    case SimdPath::kAVX2:
+      return BlockSad16_AVX2;
+#endif
+#if defined(CUSTOM_ARCH_NEON)
+    case SimdPath::kNEON:
+      return BlockSad16_NEON;
+#endif
+    case SimdPath::kScalar:
+      return BlockSad16_C;
+    default:
+      return nullptr;
+  }
+}
+
+}  // namespace
+
+uint32_t BlockSad(const uint8_t *a,
+                  int stride_a,
+                  const uint8_t *b,
+                  int stride_b,
+                  int width,
+                  int height,
+                  SimdPath path) {
+  if (width == kBlockSize && height <= kBlockSize) {
+    BlockSad16Func sad = SelectBlockSad16Func(path);
+    if (sad) {
+      return sad(a, stride_a, b, stride_b, height);
+    }
+  }
+  return BlockSad_C(a, stride_a, b, stride_b, width, height);
+}
+
+DirtyRegionDetector::DirtyRegionDetector(uint32_t sad_threshold, SimdPath path)
+    : sad_threshold_(sad_threshold), path_(path) {}
+
+bool DirtyRegionDetector::Detect(const uint8_t *y, int stride, int width, int height, std::vector<DirtyRect> *rects) {
+  return Detect(y, stride, nullptr, 0, nullptr, 0, width, height, rects);
+}
+
+bool DirtyRegionDetector::Detect(const uint8_t *y,
+                                 int stride_y,
+                                 const uint8_t *u,
+                                 int stride_u,
+                                 const uint8_t *v,
+                                 int stride_v,
+                                 int width,
+                                 int height,
+                                 std::vector<DirtyRect> *rects) {
+  if (!y || !rects || width <= 0 || height <= 0 || stride_y < width) {
+    return false;
+  }
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  const int chroma_planes = !u ? 0 : (v ? 2 : 1);
+  // Bytes of a chroma row and of a block's share of it.
+  const int chroma_row_bytes = chroma_planes == 1 ? chroma_width * 2 : chroma_width;
+  const int chroma_block_bytes = chroma_planes == 1 ? kBlockSize : kBlockSize / 2;
+  const uint8_t *chroma[2] = {u, v};
+  const int chroma_strides[2] = {stride_u, stride_v};
+  for (int i = 0; i < chroma_planes; ++i) {
+    if (chroma_strides[i] < chroma_row_bytes) {
+      return false;
+    }
+  }
+  BlockSad16Func sad16 = SelectBlockSad16Func(path_);
+  if (!sad16) {
+    return false;
+  }
+
+  const bool first =
+      (width != width_ || height != height_ || chroma_planes != chroma_planes_ || reference_.empty());
+  if (first) {
+    width_ = width;
+    height_ = height;
+    chroma_planes_ = chroma_planes;
+    blocks_wide_ = (width + kBlockSize - 1) / kBlockSize;
+    blocks_high_ = (height + kBlockSize - 1) / kBlockSize;
+    reference_.resize(static_cast<size_t>(width) * height);
+    for (int i = 0; i < 2; ++i) {
+      chroma_reference_[i].resize(i < chroma_planes ? static_cast<size_t>(chroma_row_bytes) * chroma_height : 0);
+    }
+    block_map_.assign(static_cast<size_t>(blocks_wide_) * blocks_high_, 1);
+  }
+
+  auto sad = [sad16](const uint8_t *block, int stride, const uint8_t *reference, int reference_stride, int columns,
+                     int rows) {
+    return (columns == kBlockSize) ? sad16(block, stride, reference, reference_stride, rows)
+                                   : BlockSad_C(block, stride, reference, reference_stride, columns, rows);
+  };
+  auto copy = [](const uint8_t *block, int stride, uint8_t *reference, int reference_stride, int columns, int rows) {
+    for (int r = 0; r < rows; ++r) {
+      memcpy(reference + static_cast<size_t>(r) * reference_stride, block + static_cast<size_t>(r) * stride, columns);
+    }
+  };
+
+  uint64_t dirty_blocks = 0;
+  for (int by = 0; by < blocks_high_; ++by) {
+    const int top = by * kBlockSize;
+    const int rows = std::min(kBlockSize, height - top);
+    const int chroma_top = by * kBlockSize / 2;
+    const int chroma_rows = std::min(kBlockSize / 2, chroma_height - chroma_top);
+    for (int bx = 0; bx < blocks_wide_; ++bx) {
+      const int left = bx * kBlockSize;
+      const int columns = std::min(kBlockSize, width - left);
+      const int chroma_left = bx * chroma_block_bytes;
+      const int chroma_columns = std::min(chroma_block_bytes, chroma_row_bytes - chroma_left);
+      const uint8_t *block = y + static_cast<size_t>(top) * stride_y + left;
+      uint8_t *reference = reference_.data() + static_cast<size_t>(top) * width + left;
+      bool dirty = first;
+      if (!dirty) {
+        dirty = sad(block, stride_y, reference, width, columns, rows) > sad_threshold_;
+      }
+      if (!dirty && chroma_planes > 0) {
+        uint32_t chroma_sad = 0;
+        for (int i = 0; i < chroma_planes; ++i) {
+          chroma_sad += sad(chroma[i] + static_cast<size_t>(chroma_top) * chroma_strides[i] + chroma_left,
+                            chroma_strides[i],
+                            chroma_reference_[i].data() + static_cast<size_t>(chroma_top) * chroma_row_bytes +
+                                chroma_left,
+                            chroma_row_bytes, chroma_columns, chroma_rows);
+        }
+        dirty = chroma_sad > sad_threshold_ / 2;
+      }
+      block_map_[static_cast<size_t>(by) * blocks_wide_ + bx] = dirty ? 1 : 0;
+      if (dirty) {
+        ++dirty_blocks;
+        copy(block, stride_y, reference, width, columns, rows);
+        for (int i = 0; i < chroma_planes; ++i) {
+          copy(chroma[i] + static_cast<size_t>(chroma_top) * chroma_strides[i] + chroma_left, chroma_strides[i],
+               chroma_reference_[i].data() + static_cast<size_t>(chroma_top) * chroma_row_bytes + chroma_left,
+               chroma_row_bytes, chroma_columns, chroma_rows);
+        }
+      }
+    }
+  }
+
+  stats_.frames++;
+  stats_.blocks += block_map_.size();
+  stats_.dirty_blocks += dirty_blocks;
+  CollectRects(true, rects);
+  return true;
+}
+
+void DirtyRegionDetector::GrowDirtyBlocks() {
+  grown_map_.assign(block_map_.size(), 0);
+  uint64_t added = 0;
+  for (int by = 0; by < blocks_high_; ++by) {
+    for (int bx = 0; bx < blocks_wide_; ++bx) {
+      bool dirty = false;
+      for (int ny = std::max(by - 1, 0); ny <= std::min(by + 1, blocks_high_ - 1) && !dirty; ++ny) {
+        for (int nx = std::max(bx - 1, 0); nx <= std::min(bx + 1, blocks_wide_ - 1) && !dirty; ++nx) {
+          dirty = block_map_[static_cast<size_t>(ny) * blocks_wide_ + nx] != 0;
+        }
+      }
+      const size_t index = static_cast<size_t>(by) * blocks_wide_ + bx;
+      grown_map_[index] = dirty ? 1 : 0;
+      if (dirty && !block_map_[index]) {
+        ++added;
+      }
+    }
+  }
+  block_map_.swap(grown_map_);
+  stats_.dirty_blocks += added;
+}
+
+void DirtyRegionDetector::CollectRects(bool dirty, std::vector<DirtyRect> *rects) const {
+  rects->clear();
+  // Runs of the previous block row that may still grow downwards, as indices
+  // into |rects|, ordered by x.
+  std::vector<size_t> open;
+  std::vector<size_t> next_open;
+  for (int by = 0; by < blocks_high_; ++by) {
+    const uint8_t *row = block_map_.data() + static_cast<size_t>(by) * blocks_wide_;
+    const int top = by * kBlockSize;
+    const int rows = std::min(kBlockSize, height_ - top);
+    next_open.clear();
+    size_t candidate = 0;
+    for (int bx = 0; bx < blocks_wide_;) {
+      if ((row[bx] != 0) != dirty) {
+        ++bx;
+        continue;
+      }
+      const int start = bx;
+      while (bx < blocks_wide_ && (row[bx] != 0) == dirty) {
+        ++bx;
+      }
+      const int x = start * kBlockSize;
+      const int width = std::min(bx * kBlockSize, width_) - x;
+      // Extend the rectangle above if it spans exactly the same columns.
+      while (candidate < open.size() && (*rects)[open[candidate]].x < x) {
+        ++candidate;
+      }
+      if (candidate < open.size() && (*rects)[open[candidate]].x == x && (*rects)[open[candidate]].width == width) {
+        (*rects)[open[candidate]].height += rows;
+        next_open.push_back(open[candidate]);
+      } else {
+        DirtyRect rect;
+        rect.x = x;
+        rect.y = top;
+        rect.width = width;
+        rect.height = rows;
+        next_open.push_back(rects->size());
+        rects->push_back(rect);
+      }
+    }
+    open.swap(next_open);
+  }
+}
+
+void DirtyRegionDetector::Reset() {
+  reference_.clear();
+  chroma_reference_[0].clear();
+  chroma_reference_[1].clear();
+  width_ = 0;
+  height_ = 0;
+}
+
+}  // namespace custom
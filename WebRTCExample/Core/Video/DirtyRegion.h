@@ -0,0 +1,129 @@
+//
+//  DirtyRegion.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/2.
+//
+
+#ifndef DirtyRegion_h
+#define DirtyRegion_h
+
+#include <cstdint>
+#include <vector>
+
+#include "CpuFeatures.h"
+
+namespace custom {
+
+// A rectangle in luma pixels.
+struct DirtyRect {
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+};
+
+struct DirtyRegionStats {
+  uint64_t frames = 0;
+  // Blocks compared, over all frames.
+  uint64_t blocks = 0;
+  // Blocks found changed.
+  uint64_t dirty_blocks = 0;
+
+  // Fraction of the blocks whose processing could be skipped.
+  double skipped_fraction() const {
+    return blocks ? 1.0 - static_cast<double>(dirty_blocks) / static_cast<double>(blocks) : 0.0;
+  }
+};
+
+// Sum of absolute differences of a |width| x |height| block, width at most
+// DirtyRegionDetector::kBlockSize.
+uint32_t BlockSad(const uint8_t *a,
+                  int stride_a,
+                  const uint8_t *b,
+                  int stride_b,
+                  int width,
+                  int height,
+                  SimdPath path = SimdPath::kAuto);
+
+// Finds the 16x16 blocks that changed since the previous frame. A block is
+// dirty if its luma SAD against the reference exceeds |sad_threshold|, or, when
+// chroma is compared too, the SAD of its U and V samples exceeds half of it,
+// their share of a block's samples. Only dirty blocks are copied into the
+// reference, so slow drift below the threshold accumulates until it shows. The
+// first frame after construction, Reset() or a change of size or layout is
+// dirty everywhere.
+//
+// Not thread safe; use one detector per stream.
+class DirtyRegionDetector {
+ public:
+  static constexpr int kBlockSize = 16;
+
+  explicit DirtyRegionDetector(uint32_t sad_threshold = 0, SimdPath path = SimdPath::kAuto);
+
+  DirtyRegionDetector(const DirtyRegionDetector &) = delete;
+  DirtyRegionDetector &operator=(const DirtyRegionDetector &) = delete;
+
+  // Compares the luma plane |y| with the reference and replaces |rects| with
+  // the dirty area, merged into as few rectangles as runs of blocks allow.
+  // Rectangles are block aligned and clipped to the frame, so their origin is
+  // even and they can address 4:2:0 chroma. Returns false on invalid
+  // arguments or if the SIMD path is not supported.
+  bool Detect(const uint8_t *y, int stride, int width, int height, std::vector<DirtyRect> *rects);
+
+  // Detect() comparing the 4:2:0 chroma of each block as well, so a change of
+  // color alone is found. |u| is the interleaved UV plane of NV12 if |v| is
+  // null, otherwise the U plane of I420 and |v| its V plane.
+  bool Detect(const uint8_t *y,
+              int stride_y,
+              const uint8_t *u,
+              int stride_u,
+              const uint8_t *v,
+              int stride_v,
+              int width,
+              int height,
+              std::vector<DirtyRect> *rects);
+
+  // Marks every block next to a dirty one, diagonals included, dirty as well,
+  // for the rectangles collected afterwards; the reference is left as it is.
+  // E.g. a filter that upsamples chroma reads one sample into the neighbouring
+  // blocks, so a change moves their edge pixels too. Counts the added blocks in
+  // the stats.
+  void GrowDirtyBlocks();
+
+  // The blocks of the last Detect() in the given state, merged like the dirty
+  // rectangles; e.g. the tiles to copy from the previous output.
+  void CollectRects(bool dirty, std::vector<DirtyRect> *rects) const;
+
+  // Forgets the reference; the next frame is dirty everywhere.
+  void Reset();
+
+  int blocks_wide() const { return blocks_wide_; }
+  int blocks_high() const { return blocks_high_; }
+  // One byte per block, row major, non-zero if dirty in the last Detect() or
+  // GrowDirtyBlocks().
+  const std::vector<uint8_t> &block_map() const { return block_map_; }
+
+  const DirtyRegionStats &stats() const { return stats_; }
+  void ResetStats() { stats_ = DirtyRegionStats(); }
+
+ private:
+  uint32_t sad_threshold_;
+  SimdPath path_;
+  int width_ = 0;
+  int height_ = 0;
+  int blocks_wide_ = 0;
+  int blocks_high_ = 0;
+  // Chroma planes compared: 0, 1 for NV12 or 2 for I420.
+  int chroma_planes_ = 0;
+  // Packed luma and chroma planes the frames are compared against.
+  std::vector<uint8_t> reference_;
+  std::vector<uint8_t> chroma_reference_[2];
+  std::vector<uint8_t> block_map_;
+  std::vector<uint8_t> grown_map_;
+  DirtyRegionStats stats_;
+};
+
+}  // namespace custom
+
+#endif /* DirtyRegion_h */
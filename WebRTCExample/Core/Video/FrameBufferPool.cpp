@@ -0,0 +1,190 @@
+//
+//  FrameBufferPool.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/14.
+//
+
+#include "FrameBufferPool.h"
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace custom {
+
+namespace {
+
+constexpr size_t kBufferAlignment = 64;
+
+struct Storage {
+  FrameBuffer buffer;
+  size_t size = 0;
+};
+
+// Shared with the buffers in use, which may outlive the pool.
+using AllocatorRef = std::shared_ptr<const FrameBufferAllocator>;
+
+Storage *AllocateStorage(const FrameBufferAllocator &allocator, const FrameBufferKey &key) {
+  Storage *storage = new Storage();
+  storage->buffer.key = key;
+  storage->size = allocator.allocate(&storage->buffer);
+  if (storage->size == 0) {
+    delete storage;
+    return nullptr;
+  }
+  return storage;
+}
+
+void FreeStorage(const FrameBufferAllocator &allocator, Storage *storage) {
+  allocator.free(&storage->buffer);
+  delete storage;
+}
+
+FrameBufferAllocator HeapAllocator() {
+  FrameBufferAllocator allocator;
+  allocator.allocate = [](FrameBuffer *buffer) -> size_t {
+    FrameLayout layout = ComputeFrameLayout(buffer->key, kBufferAlignment);
+    if (layout.plane_count == 0) {
+      return 0;
+    }
+    buffer->layout = layout;
+    buffer->data = static_cast<uint8_t *>(::operator new(layout.total_size, std::align_val_t(kBufferAlignment)));
+    return layout.total_size;
+  };
+  allocator.free = [](FrameBuffer *buffer) {
+    ::operator delete(buffer->data, std::align_val_t(kBufferAlignment));
+  };
+  return allocator;
+}
+
+}  // namespace
+
+struct FrameBufferPool::State {
+  struct KeyEntry {
+    std::vector<Storage *> idle;
+    uint64_t last_use = 0;
+  };
+
+  std::mutex mutex;
+  const size_t max_idle_per_key;
+  const size_t max_keys;
+  const AllocatorRef allocator;
+  uint64_t tick = 0;
+  std::unordered_map<FrameBufferKey, KeyEntry, FrameBufferKeyHash> entries;
+  FrameBufferPoolStats stats;
+
+  State(size_t max_idle, size_t keys, FrameBufferAllocator buffer_allocator)
+      : max_idle_per_key(max_idle),
+        max_keys(keys),
+        allocator(std::make_shared<const FrameBufferAllocator>(std::move(buffer_allocator))) {}
+
+  ~State() {
+    for (auto &pair : entries) {
+      for (Storage *storage : pair.second.idle) {
+        FreeStorage(*allocator, storage);
+      }
+    }
+  }
+
+  // Drops the least recently used key other than |keep| once more than
+  // |max_keys| formats are tracked, e.g. after a resolution change.
+  void EvictStaleKeysLocked(const FrameBufferKey &keep) {
+    while (entries.size() > max_keys) {
+      auto victim = entries.end();
+      for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (it->first != keep && (victim == entries.end() || it->second.last_use < victim->second.last_use)) {
+          victim = it;
+        }
+      }
+      if (victim == entries.end()) {
+        return;
+      }
+      for (Storage *storage : victim->second.idle) {
+        stats.allocated_bytes -= storage->size;
+        FreeStorage(*allocator, storage);
+      }
+      entries.erase(victim);
+    }
+  }
+};
+
+FrameBufferPool::FrameBufferPool(size_t max_idle_per_key, size_t max_keys)
+    : FrameBufferPool(max_idle_per_key, max_keys, HeapAllocator()) {}
+
+FrameBufferPool::FrameBufferPool(size_t max_idle_per_key, size_t max_keys, FrameBufferAllocator allocator)
+    : state_(std::make_shared<State>(max_idle_per_key, std::max<size_t>(max_keys, 1), std::move(allocator))) {}
+
+FrameBufferPool::~FrameBufferPool() = default;
+
+std::shared_ptr<FrameBuffer> FrameBufferPool::Acquire(const FrameBufferKey &key) {
+  Storage *storage = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    State::KeyEntry &entry = state_->entries[key];
+    entry.last_use = ++state_->tick;
+    if (!entry.idle.empty()) {
+      storage = entry.idle.back();
+      entry.idle.pop_back();
+      state_->stats.hits++;
+    } else {
+      storage = AllocateStorage(*state_->allocator, key);
+      if (!storage) {
+        state_->entries.erase(key);
+        return nullptr;
+      }
+      state_->stats.misses++;
+      state_->stats.allocated_bytes += storage->size;
+    }
+    state_->stats.in_use++;
+    state_->stats.high_water = std::max(state_->stats.high_water, state_->stats.in_use);
+    state_->EvictStaleKeysLocked(key);
+  }
+
+  std::weak_ptr<State> weak_state = state_;
+  AllocatorRef allocator = state_->allocator;
+  return std::shared_ptr<FrameBuffer>(&storage->buffer, [weak_state, allocator, storage](FrameBuffer *) {
+    std::shared_ptr<State> state = weak_state.lock();
+    if (!state) {
+      FreeStorage(*allocator, storage);
+      return;
+    }
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->stats.in_use--;
+    auto it = state->entries.find(storage->buffer.key);
+    if (it != state->entries.end() && it->second.idle.size() < state->max_idle_per_key) {
+      it->second.idle.push_back(storage);
+    } else {
+      state->stats.allocated_bytes -= storage->size;
+      FreeStorage(*allocator, storage);
+    }
+  });
+}
+
+void FrameBufferPool::Flush() {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  for (auto &pair : state_->entries) {
+    for (Storage *storage : pair.second.idle) {
+      state_->stats.allocated_bytes -= storage->size;
+      FreeStorage(*state_->allocator, storage);
+    }
+    pair.second.idle.clear();
+  }
+}
+
+FrameBufferPoolStats FrameBufferPool::stats() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->stats;
+}
+
+void FrameBufferPool::ResetStats() {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  state_->stats.hits = 0;
+  state_->stats.misses = 0;
+  state_->stats.high_water = state_->stats.in_use;
+}
+
+}  // namespace custom
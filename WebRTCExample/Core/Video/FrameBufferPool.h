@@ -0,0 +1,90 @@
+//
+//  FrameBufferPool.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/14.
+//
+
+#ifndef FrameBufferPool_h
+#define FrameBufferPool_h
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "FrameFormat.h"
+
+namespace custom {
+
+// A CPU frame buffer handed out by FrameBufferPool. The memory goes back to the
+// pool when the last std::shared_ptr reference is dropped.
+struct FrameBuffer {
+  FrameBufferKey key;
+  FrameLayout layout;
+  // Null for memory of a FrameBufferAllocator that is only mapped while in use,
+  // e.g. an IOSurface.
+  uint8_t *data = nullptr;
+  // What a FrameBufferAllocator allocated, e.g. the IOSurfaceRef.
+  void *handle = nullptr;
+
+  uint8_t *Plane(int index) const { return data + layout.planes[index].offset; }
+  int Stride(int index) const { return layout.planes[index].stride; }
+};
+
+struct FrameBufferPoolStats {
+  // Acquire() calls served from a recycled buffer.
+  uint64_t hits = 0;
+  // Acquire() calls that had to allocate.
+  uint64_t misses = 0;
+  // Buffers currently handed out.
+  size_t in_use = 0;
+  // Largest |in_use| seen, i.e. the number of buffers steady state needs.
+  size_t high_water = 0;
+  // Bytes currently owned by the pool, both in use and idle.
+  size_t allocated_bytes = 0;
+};
+
+// Where a FrameBufferPool gets its memory from, instead of the heap. |allocate|
+// sets up |buffer| for |buffer->key|: its layout, and data or handle, and
+// returns the bytes it takes, or 0 if the key is not supported. |free| releases
+// what |allocate| set up. Both are called with the pool's lock held, or on the
+// thread dropping the last reference once the pool is gone.
+struct FrameBufferAllocator {
+  std::function<size_t(FrameBuffer *buffer)> allocate;
+  std::function<void(FrameBuffer *buffer)> free;
+};
+
+// Size/format keyed pool of frame buffers. Thread safe: buffers may be acquired
+// on one thread and released on another, and may outlive the pool.
+class FrameBufferPool {
+ public:
+  static constexpr size_t kDefaultMaxIdlePerKey = 4;
+  static constexpr size_t kDefaultMaxKeys = 4;
+
+  explicit FrameBufferPool(size_t max_idle_per_key = kDefaultMaxIdlePerKey,
+                           size_t max_keys = kDefaultMaxKeys);
+  FrameBufferPool(size_t max_idle_per_key, size_t max_keys, FrameBufferAllocator allocator);
+  ~FrameBufferPool();
+
+  FrameBufferPool(const FrameBufferPool &) = delete;
+  FrameBufferPool &operator=(const FrameBufferPool &) = delete;
+
+  // Returns a buffer matching |key| or nullptr if the key is not supported. The
+  // content of a recycled buffer is undefined.
+  std::shared_ptr<FrameBuffer> Acquire(const FrameBufferKey &key);
+
+  // Frees all idle buffers. Buffers in use are unaffected.
+  void Flush();
+
+  FrameBufferPoolStats stats() const;
+  void ResetStats();
+
+ private:
+  struct State;
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace custom
+
+#endif /* FrameBufferPool_h */
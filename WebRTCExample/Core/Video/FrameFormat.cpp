@@ -0,0 +1,72 @@
+//
+//  FrameFormat.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/14.
+//
+
+#include "FrameFormat.h"
+
+namespace custom {
+
+namespace {
+
+int AlignUp(int value, int alignment) {
+  if (alignment <= 1) {
+    return value;
+  }
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+int PlaneCountForFormat(uint32_t format) {
+  switch (format) {
+    case kFourccBGRA:
+      return 1;
+    case kFourccNV12FullRange:
+    case kFourccNV12VideoRange:
+      return 2;
+    case kFourccI420:
+      return 3;
+    default:
+      return 0;
+  }
+}
+
+FrameLayout ComputeFrameLayout(const FrameBufferKey &key, int stride_alignment) {
+  FrameLayout layout;
+  const int plane_count = PlaneCountForFormat(key.format);
+  if (key.width <= 0 || key.height <= 0 || plane_count == 0) {
+    return layout;
+  }
+
+  const int chroma_width = (key.width + 1) / 2;
+  const int chroma_height = (key.height + 1) / 2;
+
+  layout.plane_count = plane_count;
+  for (int i = 0; i < plane_count; ++i) {
+    PlaneLayout &plane = layout.planes[i];
+    if (key.format == kFourccBGRA) {
+      plane.width = key.width;
+      plane.height = key.height;
+      plane.bytes_per_sample = 4;
+    } else if (i == 0) {
+      plane.width = key.width;
+      plane.height = key.height;
+      plane.bytes_per_sample = 1;
+    } else {
+      plane.width = chroma_width;
+      plane.height = chroma_height;
+      // NV12 interleaves U and V in a single plane.
+      plane.bytes_per_sample = (plane_count == 2) ? 2 : 1;
+    }
+    plane.stride = AlignUp(plane.width * plane.bytes_per_sample, stride_alignment);
+    plane.offset = layout.total_size;
+    plane.size = static_cast<size_t>(plane.stride) * plane.height;
+    layout.total_size += plane.size;
+  }
+  return layout;
+}
+
+}  // namespace custom
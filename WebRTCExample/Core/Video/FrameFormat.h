@@ -0,0 +1,89 @@
+//
+//  FrameFormat.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/14.
+//
+
+#ifndef FrameFormat_h
+#define FrameFormat_h
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace custom {
+
+constexpr uint32_t MakeFourcc(char a, char b, char c, char d) {
+  return (static_cast<uint32_t>(static_cast<uint8_t>(a)) << 24) |
+         (static_cast<uint32_t>(static_cast<uint8_t>(b)) << 16) |
+         (static_cast<uint32_t>(static_cast<uint8_t>(c)) << 8) |
+         static_cast<uint32_t>(static_cast<uint8_t>(d));
+}
+
+// FourCC codes are numerically identical to the matching CoreVideo OSType, so a
+// value from CVPixelBufferGetPixelFormatType can be passed straight through.
+constexpr uint32_t kFourccBGRA = MakeFourcc('B', 'G', 'R', 'A');           // kCVPixelFormatType_32BGRA
+constexpr uint32_t kFourccNV12FullRange = MakeFourcc('4', '2', '0', 'f');  // kCVPixelFormatType_420YpCbCr8BiPlanarFullRange
+constexpr uint32_t kFourccNV12VideoRange = MakeFourcc('4', '2', '0', 'v'); // kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange
+constexpr uint32_t kFourccI420 = MakeFourcc('y', '4', '2', '0');           // kCVPixelFormatType_420YpCbCr8Planar
+
+constexpr int kMaxPlanes = 3;
+
+// Clockwise rotation in degrees. Values match CustomVideoRotation and
+// libyuv::RotationMode.
+enum class Rotation : int {
+  k0 = 0,
+  k90 = 90,
+  k180 = 180,
+  k270 = 270,
+};
+
+// Identifies a class of interchangeable frame buffers.
+struct FrameBufferKey {
+  int width = 0;
+  int height = 0;
+  uint32_t format = 0;
+
+  bool operator==(const FrameBufferKey &other) const {
+    return width == other.width && height == other.height && format == other.format;
+  }
+  bool operator!=(const FrameBufferKey &other) const { return !(*this == other); }
+};
+
+struct FrameBufferKeyHash {
+  size_t operator()(const FrameBufferKey &key) const {
+    uint64_t packed = (static_cast<uint64_t>(static_cast<uint32_t>(key.width)) << 32) |
+                      static_cast<uint32_t>(key.height);
+    return std::hash<uint64_t>()(packed) ^ (std::hash<uint32_t>()(key.format) << 1);
+  }
+};
+
+struct PlaneLayout {
+  // Size of the plane in samples. A sample is 4 bytes for BGRA, 2 bytes for the
+  // interleaved NV12 chroma plane and 1 byte otherwise.
+  int width = 0;
+  int height = 0;
+  int bytes_per_sample = 0;
+  int stride = 0;
+  size_t offset = 0;
+  size_t size = 0;
+};
+
+struct FrameLayout {
+  int plane_count = 0;
+  PlaneLayout planes[kMaxPlanes];
+  size_t total_size = 0;
+};
+
+// Number of planes for |format|, or 0 if the format is not supported.
+int PlaneCountForFormat(uint32_t format);
+
+// Computes a contiguous layout for |key| where every row starts on a
+// |stride_alignment| byte boundary. Returns a layout with plane_count == 0 if
+// the key is invalid or the format is not supported.
+FrameLayout ComputeFrameLayout(const FrameBufferKey &key, int stride_alignment = 64);
+
+}  // namespace custom
+
+#endif /* FrameFormat_h */
@@ -0,0 +1,112 @@
+//
+//  FrameHistory.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/5.
+//
+
+#ifndef FrameHistory_h
+#define FrameHistory_h
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace custom {
+
+// The last few frames of a stream with their timestamps, for temporal filters.
+// Frames are shared, not copied: the history holds one reference to each and
+// hands out more, so a borrowed frame stays valid after it falls out of the
+// history. The slots are allocated once, pushing never allocates.
+//
+// |Frame| is any type owned through std::shared_ptr, e.g. FrameBuffer, or
+// __CVBuffer with a CVPixelBufferRelease deleter. Not thread safe.
+template <typename Frame>
+class FrameHistory {
+ public:
+  static constexpr size_t kMaxCapacity = 8;
+
+  explicit FrameHistory(size_t capacity)
+      : slots_(capacity == 0 ? 1 : (capacity > kMaxCapacity ? kMaxCapacity : capacity)) {}
+
+  FrameHistory(const FrameHistory &) = delete;
+  FrameHistory &operator=(const FrameHistory &) = delete;
+
+  // Adds the newest frame, dropping the oldest one if the history is full.
+  void Push(int64_t timestamp_ns, std::shared_ptr<Frame> frame) {
+    if (!frame) {
+      return;
+    }
+    newest_ = (newest_ + 1) % slots_.size();
+    slots_[newest_].timestamp_ns = timestamp_ns;
+    slots_[newest_].frame = std::move(frame);
+    if (count_ < slots_.size()) {
+      ++count_;
+    }
+  }
+
+  // Frame |age| steps back, 0 being the newest, or nullptr past the oldest.
+  // |timestamp_ns| may be null.
+  std::shared_ptr<Frame> At(size_t age, int64_t *timestamp_ns = nullptr) const {
+    if (age >= count_) {
+      return nullptr;
+    }
+    const Slot &slot = slots_[(newest_ + slots_.size() - age) % slots_.size()];
+    if (timestamp_ns) {
+      *timestamp_ns = slot.timestamp_ns;
+    }
+    return slot.frame;
+  }
+
+  // The frame whose timestamp is closest to |timestamp_ns|, if within
+  // |tolerance_ns|; nullptr otherwise.
+  std::shared_ptr<Frame> Nearest(int64_t timestamp_ns, int64_t tolerance_ns, int64_t *found_ns = nullptr) const {
+    const Slot *best = nullptr;
+    int64_t best_distance = 0;
+    // Newest first, so the newer of two equally close frames wins.
+    for (size_t age = 0; age < count_; ++age) {
+      const Slot &slot = slots_[(newest_ + slots_.size() - age) % slots_.size()];
+      const int64_t distance = std::llabs(slot.timestamp_ns - timestamp_ns);
+      if (distance <= tolerance_ns && (!best || distance < best_distance)) {
+        best = &slot;
+        best_distance = distance;
+      }
+    }
+    if (!best) {
+      return nullptr;
+    }
+    if (found_ns) {
+      *found_ns = best->timestamp_ns;
+    }
+    return best->frame;
+  }
+
+  // Drops every frame, e.g. on a scene cut or format change.
+  void Clear() {
+    for (Slot &slot : slots_) {
+      slot.frame.reset();
+    }
+    count_ = 0;
+  }
+
+  size_t size() const { return count_; }
+  size_t capacity() const { return slots_.size(); }
+
+ private:
+  struct Slot {
+    int64_t timestamp_ns = 0;
+    std::shared_ptr<Frame> frame;
+  };
+
+  std::vector<Slot> slots_;
+  // Slot of the newest frame.
+  size_t newest_ = 0;
+  size_t count_ = 0;
+};
+
+}  // namespace custom
+
+#endif /* FrameHistory_h */
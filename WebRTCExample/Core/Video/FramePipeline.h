@@ -0,0 +1,136 @@
+//
+//  FramePipeline.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/21.
+//
+
+#ifndef FramePipeline_h
+#define FramePipeline_h
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+namespace custom {
+
+struct FramePipelineStats {
+  uint64_t submitted = 0;
+  uint64_t completed = 0;
+  // Frames that had to be waited for because the pipeline was full or flushed,
+  // i.e. where the caller blocked on the GPU.
+  uint64_t forced_waits = 0;
+  // Largest number of frames pending at once.
+  size_t max_in_flight_seen = 0;
+};
+
+// Ordering and back pressure for frames whose GPU work finishes asynchronously.
+// A frame is submitted once its draw calls are issued and completed (readback,
+// conversion, delivery) once the GPU is done with it. Frames always complete in
+// submission order and at most |max_in_flight| are pending, which bounds both
+// the added latency and the number of render targets in use.
+//
+// The GPU side is a |Stage| passed to the calls that may complete frames:
+//   bool IsDone(Payload &payload, bool wait);  // poll, or block if |wait|
+//   void Complete(Payload payload, int64_t timestamp_ns);
+// Completing a frame must not call back into the pipeline. Not thread safe; use
+// it from the thread that owns the GPU context.
+template <typename Payload>
+class FramePipeline {
+ public:
+  static constexpr size_t kDefaultMaxInFlight = 2;
+
+  explicit FramePipeline(size_t max_in_flight = kDefaultMaxInFlight)
+      : max_in_flight_(std::max<size_t>(max_in_flight, 1)) {}
+
+  FramePipeline(const FramePipeline &) = delete;
+  FramePipeline &operator=(const FramePipeline &) = delete;
+
+  // Takes effect from the next WaitForCapacity() call.
+  void set_max_in_flight(size_t max_in_flight) { max_in_flight_ = std::max<size_t>(max_in_flight, 1); }
+  size_t max_in_flight() const { return max_in_flight_; }
+
+  // Completes the oldest frames, blocking on them if needed, until one more
+  // frame fits. Call it before drawing the next frame so the render target the
+  // draw will use is free again. Returns the number of completed frames.
+  template <typename Stage>
+  size_t WaitForCapacity(Stage &stage) {
+    size_t count = 0;
+    while (pending_.size() >= max_in_flight_) {
+      WaitForFront(stage);
+      CompleteFront(stage);
+      count++;
+    }
+    return count;
+  }
+
+  // Adds a frame whose GPU work has been issued. Does not block; the caller is
+  // expected to have called WaitForCapacity() first.
+  void Submit(int64_t timestamp_ns, Payload payload) {
+    pending_.push_back(Entry{timestamp_ns, std::move(payload)});
+    stats_.submitted++;
+    stats_.max_in_flight_seen = std::max(stats_.max_in_flight_seen, pending_.size());
+  }
+
+  // Completes every pending frame whose GPU work is done, oldest first. Stops
+  // at the first one that is still running so results are never reordered.
+  template <typename Stage>
+  size_t Poll(Stage &stage) {
+    size_t count = 0;
+    while (!pending_.empty() && stage.IsDone(pending_.front().payload, false)) {
+      CompleteFront(stage);
+      count++;
+    }
+    return count;
+  }
+
+  // Waits for and completes all pending frames.
+  template <typename Stage>
+  size_t Flush(Stage &stage) {
+    size_t count = 0;
+    while (!pending_.empty()) {
+      WaitForFront(stage);
+      CompleteFront(stage);
+      count++;
+    }
+    return count;
+  }
+
+  // Drops all pending frames without completing them.
+  void Clear() { pending_.clear(); }
+
+  size_t in_flight() const { return pending_.size(); }
+  const FramePipelineStats &stats() const { return stats_; }
+
+ private:
+  struct Entry {
+    int64_t timestamp_ns;
+    Payload payload;
+  };
+
+  template <typename Stage>
+  void WaitForFront(Stage &stage) {
+    if (!stage.IsDone(pending_.front().payload, false)) {
+      stage.IsDone(pending_.front().payload, true);
+      stats_.forced_waits++;
+    }
+  }
+
+  template <typename Stage>
+  void CompleteFront(Stage &stage) {
+    Entry entry = std::move(pending_.front());
+    pending_.pop_front();
+    stats_.completed++;
+    stage.Complete(std::move(entry.payload), entry.timestamp_ns);
+  }
+
+  size_t max_in_flight_;
+  std::deque<Entry> pending_;
+  FramePipelineStats stats_;
+};
+
+}  // namespace custom
+
+#endif /* FramePipeline_h */
@@ -0,0 +1,403 @@
+//
+//  FramePyramid.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/1.
+//
+
+#include "FramePyramid.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "FrameFormat.h"
+
+#if defined(CUSTOM_ARCH_X86)
+#include <immintrin.h>
+#elif defined(CUSTOM_ARCH_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace custom {
+
+namespace {
+
+// Reduces four source rows to two rows of the 1/2 layer and one row of the 1/4
+// layer, for the first |blocks| samples of the 1/4 layer. A block is the 4x4
+// footprint of one 1/4 layer sample. Kernels only handle whole iterations and
+// return the number of blocks done; PyramidRowsFrom_C finishes the row.
+typedef int (*PyramidRowsFunc)(const uint8_t *const rows[4],
+                               uint8_t *half0,
+                               uint8_t *half1,
+                               uint8_t *quarter,
+                               int blocks);
+
+// |kChannels| is the number of interleaved channels of the plane: 1 for luma,
+// 2 for NV12 chroma. Columns past |src_width| reuse the last one.
+template <int kChannels>
+void PyramidRowsFrom_C(const uint8_t *const rows[4],
+                       int src_width,
+                       uint8_t *half0,
+                       uint8_t *half1,
+                       int half_width,
+                       uint8_t *quarter,
+                       int quarter_width,
+                       int block) {
+  for (int j = block * 2; j < half_width; ++j) {
+    const int a = std::min(j * 2, src_width - 1) * kChannels;
+    const int b = std::min(j * 2 + 1, src_width - 1) * kChannels;
+    for (int c = 0; c < kChannels; ++c) {
+      half0[j * kChannels + c] = static_cast<uint8_t>((rows[0][a + c] + rows[0][b + c] +
+                                                       rows[1][a + c] + rows[1][b + c] + 2) >> 2);
+      half1[j * kChannels + c] = static_cast<uint8_t>((rows[2][a + c] + rows[2][b + c] +
+                                                       rows[3][a + c] + rows[3][b + c] + 2) >> 2);
+    }
+  }
+  for (int k = block; k < quarter_width; ++k) {
+    int columns[4];
+    for (int i = 0; i < 4; ++i) {
+      columns[i] = std::min(k * 4 + i, src_width - 1) * kChannels;
+    }
+    for (int c = 0; c < kChannels; ++c) {
+      int sum = 8;
+      for (int r = 0; r < 4; ++r) {
+        for (int i = 0; i < 4; ++i) {
+          sum += rows[r][columns[i] + c];
+        }
+      }
+      quarter[k * kChannels + c] = static_cast<uint8_t>(sum >> 4);
+    }
+  }
+}
+
+int PyramidRows_C(const uint8_t *const[4], uint8_t *, uint8_t *, uint8_t *, int) {
+  return 0;
+}
+
+#if defined(CUSTOM_ARCH_X86)
+
+// Sums of neighbouring samples of two vectors of 16 bit values: 8 sums, the
+// first 4 from |a|.
+template <int kChannels>
+__attribute__((target("sse2"))) inline __m128i PairSum_SSE2(__m128i a, __m128i b) {
+  if (kChannels == 1) {
+    const __m128i ones = _mm_set1_epi16(1);
+    return _mm_packs_epi32(_mm_madd_epi16(a, ones), _mm_madd_epi16(b, ones));
+  }
+  // U and V pairs are 32 bit lanes.
+  __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0));
+  __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(3, 1, 3, 1));
+  return _mm_add_epi16(_mm_castps_si128(even), _mm_castps_si128(odd));
+}
+
+// 2x2 sums of 16 bytes of two rows.
+template <int kChannels>
+__attribute__((target("sse2"))) inline __m128i BlockSum_SSE2(const uint8_t *row0, const uint8_t *row1) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i pixels0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0));
+  __m128i pixels1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1));
+  __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(pixels0, zero), _mm_unpacklo_epi8(pixels1, zero));
+  __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(pixels0, zero), _mm_unpackhi_epi8(pixels1, zero));
+  return PairSum_SSE2<kChannels>(lo, hi);
+}
+
+template <int kChannels>
+__attribute__((target("sse2"))) int PyramidRows_SSE2(const uint8_t *const rows[4],
+                                                     uint8_t *half0,
+                                                     uint8_t *half1,
+                                                     uint8_t *quarter,
+                                                     int blocks) {
+  // 32 source bytes per row and iteration.
+  constexpr int kBlocksPerIteration = 8 / kChannels;
+  const __m128i two = _mm_set1_epi16(2);
+  const __m128i eight = _mm_set1_epi16(8);
+  int block = 0;
+  for (; block + kBlocksPerIteration <= blocks; block += kBlocksPerIteration) {
+    const int x = block * 4 * kChannels;
+    __m128i top0 = BlockSum_SSE2<kChannels>(rows[0] + x, rows[1] + x);
+    __m128i top1 = BlockSum_SSE2<kChannels>(rows[0] + x + 16, rows[1] + x + 16);
+    __m128i bottom0 = BlockSum_SSE2<kChannels>(rows[2] + x, rows[3] + x);
+    __m128i bottom1 = BlockSum_SSE2<kChannels>(rows[2] + x + 16, rows[3] + x + 16);
+    __m128i out0 = _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(top0, two), 2),
+                                    _mm_srli_epi16(_mm_add_epi16(top1, two), 2));
+    __m128i out1 = _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(bottom0, two), 2),
+                                    _mm_srli_epi16(_mm_add_epi16(bottom1, two), 2));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(half0 + block * 2 * kChannels), out0);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(half1 + block * 2 * kChannels), out1);
+    __m128i sum = PairSum_SSE2<kChannels>(_mm_add_epi16(top0, bottom0), _mm_add_epi16(top1, bottom1));
+    sum = _mm_srli_epi16(_mm_add_epi16(sum, eight), 4);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(quarter + block * kChannels), _mm_packus_epi16(sum, sum));
+  }
+  return block;
+}
+
+// PairSum_SSE2 on 256 bit vectors. The in-lane instructions interleave |a| and
+// |b| by 64 bits; the permute restores the order.
+template <int kChannels>
+__attribute__((target("avx2"))) inline __m256i PairSum_AVX2(__m256i a, __m256i b) {
+  __m256i sum;
+  if (kChannels == 1) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    sum = _mm256_packs_epi32(_mm256_madd_epi16(a, ones), _mm256_madd_epi16(b, ones));
+  } else {
+    __m256 even = _mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(2, 0, 2, 0));
+    __m256 odd = _mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(3, 1, 3, 1));
+    sum = _mm256_add_epi16(_mm256_castps_si256(even), _mm256_castps_si256(odd));
+  }
+  return _mm256_permute4x64_epi64(sum, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+template <int kChannels>
+__attribute__((target("avx2"))) inline __m256i BlockSum_AVX2(const uint8_t *row0, const uint8_t *row1) {
+  __m256i pixels0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0));
+  __m256i pixels1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1));
+  __m256i lo = _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(pixels0)),
+                                _mm256_cvtepu8_epi16(_mm256_castsi256_si128(pixels1)));
+  __m256i hi = _mm256_add_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(pixels0, 1)),
+                                _mm256_cvtepu8_epi16(_mm256_extracti128_si256(pixels1, 1)));
+  return PairSum_AVX2<kChannels>(lo, hi);
+}
+
+// Rounds and packs two vectors of 16 bit values into 32 bytes, in order.
+__attribute__((target("avx2"))) inline __m256i PackInOrder_AVX2(__m256i a, __m256i b) {
+  return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+template <int kChannels>
+__attribute__((target("avx2"))) int PyramidRows_AVX2(const uint8_t *const rows[4],
+                                                     uint8_t *half0,
+                                                     uint8_t *half1,
+                                                     uint8_t *quarter,
+                                                     int blocks) {
+  // 64 source bytes per row and iteration.
+  constexpr int kBlocksPerIteration = 16 / kChannels;
+  const __m256i two = _mm256_set1_epi16(2);
+  const __m256i eight = _mm256_set1_epi16(8);
+  int block = 0;
+  for (; block + kBlocksPerIteration <= blocks; block += kBlocksPerIteration) {
+    const int x = block * 4 * kChannels;
+    __m256i top0 = BlockSum_AVX2<kChannels>(rows[0] + x, rows[1] + x);
+    __m256i top1 = BlockSum_AVX2<kChannels>(rows[0] + x + 32, rows[1] + x + 32);
+    __m256i bottom0 = BlockSum_AVX2<kChannels>(rows[2] + x, rows[3] + x);
+    __m256i bottom1 = BlockSum_AVX2<kChannels>(rows[2] + x + 32, rows[3] + x + 32);
+    __m256i out0 = PackInOrder_AVX2(_mm256_srli_epi16(_mm256_add_epi16(top0, two), 2),
+                                    _mm256_srli_epi16(_mm256_add_epi16(top1, two), 2));
+    __m256i out1 = PackInOrder_AVX2(_mm256_srli_epi16(_mm256_add_epi16(bottom0, two), 2),
+                                    _mm256_srli_epi16(_mm256_add_epi16(bottom1, two), 2));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(half0 + block * 2 * kChannels), out0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(half1 + block * 2 * kChannels), out1);
+    __m256i sum = PairSum_AVX2<kChannels>(_mm256_add_epi16(top0, bottom0), _mm256_add_epi16(top1, bottom1));
+    sum = _mm256_srli_epi16(_mm256_add_epi16(sum, eight), 4);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(quarter + block * kChannels),
+                     _mm256_castsi256_si128(PackInOrder_AVX2(sum, sum)));
+  }
+  return block;
+}
+
+#endif  // CUSTOM_ARCH_X86
+
+#if defined(CUSTOM_ARCH_NEON)
+
+// One channel of 16 samples from each of four rows: 8 samples of both 1/2
+// layer rows and the 4 sums of the 1/4 layer, not yet rounded.
+inline void ReduceStrip_NEON(uint8x16_t row0,
+                             uint8x16_t row1,
+                             uint8x16_t row2,
+                             uint8x16_t row3,
+                             uint8x8_t *half0,
+                             uint8x8_t *half1,
+                             uint16x4_t *quarter) {
+  uint16x8_t top = vpadalq_u8(vpaddlq_u8(row0), row1);
+  uint16x8_t bottom = vpadalq_u8(vpaddlq_u8(row2), row3);
+  *half0 = vrshrn_n_u16(top, 2);
+  *half1 = vrshrn_n_u16(bottom, 2);
+  *quarter = vrshrn_n_u32(vpaddlq_u16(vaddq_u16(top, bottom)), 4);
+}
+
+template <int kChannels>
+int PyramidRows_NEON(const uint8_t *const rows[4], uint8_t *half0, uint8_t *half1, uint8_t *quarter, int blocks) {
+  // 32 source bytes per row and iteration.
+  constexpr int kBlocksPerIteration = 8 / kChannels;
+  int block = 0;
+  for (; block + kBlocksPerIteration <= blocks; block += kBlocksPerIteration) {
+    const int x = block * 4 * kChannels;
+    if (kChannels == 1) {
+      uint8x8_t top[2], bottom[2];
+      uint16x4_t sum[2];
+      for (int i = 0; i < 2; ++i) {
+        ReduceStrip_NEON(vld1q_u8(rows[0] + x + i * 16), vld1q_u8(rows[1] + x + i * 16),
+                         vld1q_u8(rows[2] + x + i * 16), vld1q_u8(rows[3] + x + i * 16),
+                         &top[i], &bottom[i], &sum[i]);
+      }
+      vst1q_u8(half0 + block * 2, vcombine_u8(top[0], top[1]));
+      vst1q_u8(half1 + block * 2, vcombine_u8(bottom[0], bottom[1]));
+      vst1_u8(quarter + block, vmovn_u16(vcombine_u16(sum[0], sum[1])));
+    } else {
+      // U and V separately, interleaved again on the way out.
+      uint8x16x2_t row0 = vld2q_u8(rows[0] + x);
+      uint8x16x2_t row1 = vld2q_u8(rows[1] + x);
+      uint8x16x2_t row2 = vld2q_u8(rows[2] + x);
+      uint8x16x2_t row3 = vld2q_u8(rows[3] + x);
+      uint8x8x2_t top, bottom;
+      uint16x4_t sum[2];
+      for (int c = 0; c < 2; ++c) {
+        ReduceStrip_NEON(row0.val[c], row1.val[c], row2.val[c], row3.val[c], &top.val[c], &bottom.val[c], &sum[c]);
+      }
+      vst2_u8(half0 + block * 4, top);
+      vst2_u8(half1 + block * 4, bottom);
+      uint8x8x2_t quarters = vzip_u8(vmovn_u16(vcombine_u16(sum[0], sum[0])), vmovn_u16(vcombine_u16(sum[1], sum[1])));
+      vst1_u8(quarter + block * 2, quarters.val[0]);
+    }
+  }
+  return block;
+}
+
+#endif  // CUSTOM_ARCH_NEON
+
+struct PyramidKernels {
+  PyramidRowsFunc luma = nullptr;
+  PyramidRowsFunc chroma = nullptr;
+};
+
+PyramidKernels SelectPyramidKernels(SimdPath path) {
+  PyramidKernels kernels;
+  if (!IsSimdPathSupported(path)) {
+    return kernels;
+  }
+  switch (ResolveSimdPath(path)) {
+#if defined(CUSTOM_ARCH_X86)
+    case SimdPath::kSSE2:
+      kernels.luma = PyramidRows_SSE2<1>;
+      kernels.chroma = PyramidRows_SSE2<2>;
+      break;
+    case SimdPath::kAVX2:
+      kernels.luma = PyramidRows_AVX2<1>;
+      kernels.chroma = PyramidRows_AVX2<2>;
+      break;
+#endif
+#if defined(CUSTOM_ARCH_NEON)
+    case SimdPath::kNEON:
+      kernels.luma = PyramidRows_NEON<1>;
+      kernels.chroma = PyramidRows_NEON<2>;
+      break;
+#endif
+    case SimdPath::kScalar:
+      kernels.luma = PyramidRows_C;
+      kernels.chroma = PyramidRows_C;
+      break;
+    default:
+      break;
+  }
+  return kernels;
+}
+
+// Destination of one plane: the 1/2 and 1/4 layers, sizes in samples.
+struct PlaneTargets {
+  uint8_t *half;
+  int half_stride;
+  int half_width;
+  int half_height;
+  uint8_t *quarter;
+  int quarter_stride;
+  int quarter_width;
+  int quarter_height;
+};
+
+template <int kChannels>
+void BuildPlane(const uint8_t *src,
+                int src_stride,
+                int src_width,
+                int src_height,
+                const PlaneTargets &targets,
+                PyramidRowsFunc rows_func) {
+  // Sink for the 1/2 layer row past an odd height and for 1/4 layer rows past
+  // its height. Kept per thread so steady state does not allocate.
+  thread_local std::vector<uint8_t> spare;
+  const size_t spare_size = static_cast<size_t>(targets.half_width) * kChannels;
+  if (spare.size() < spare_size) {
+    spare.resize(spare_size);
+  }
+  // Blocks with their whole footprint inside the source and both layers.
+  const int blocks = std::min({src_width / 4, targets.half_width / 2, targets.quarter_width});
+  const uint8_t *rows[4];
+  for (int group = 0; group * 2 < targets.half_height; ++group) {
+    for (int r = 0; r < 4; ++r) {
+      rows[r] = src + static_cast<size_t>(std::min(group * 4 + r, src_height - 1)) * src_stride;
+    }
+    uint8_t *half0 = targets.half + static_cast<size_t>(group * 2) * targets.half_stride;
+    uint8_t *half1 = (group * 2 + 1 < targets.half_height) ? half0 + targets.half_stride : spare.data();
+    uint8_t *quarter = (group < targets.quarter_height)
+                           ? targets.quarter + static_cast<size_t>(group) * targets.quarter_stride
+                           : spare.data();
+    const int done = rows_func(rows, half0, half1, quarter, blocks);
+    PyramidRowsFrom_C<kChannels>(rows, src_width, half0, half1, targets.half_width, quarter,
+                                 targets.quarter_width, done);
+  }
+}
+
+}  // namespace
+
+bool BuildNV12Pyramid(const uint8_t *src_y,
+                      int src_stride_y,
+                      const uint8_t *src_uv,
+                      int src_stride_uv,
+                      int width,
+                      int height,
+                      uint32_t format,
+                      FrameBufferPool *pool,
+                      NV12Pyramid *pyramid,
+                      SimdPath path) {
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  if (!src_y || !src_uv || !pool || !pyramid || width < 4 || height < 4 || src_stride_y < width ||
+      src_stride_uv < chroma_width * 2 ||
+      (format != kFourccNV12FullRange && format != kFourccNV12VideoRange)) {
+    return false;
+  }
+  const PyramidKernels kernels = SelectPyramidKernels(path);
+  if (!kernels.luma) {
+    return false;
+  }
+
+  PyramidLayer layers[kPyramidLayerCount];
+  for (int i = 0; i < kPyramidLayerCount; ++i) {
+    layers[i].width = PyramidLayerSize(width, i + 1);
+    layers[i].height = PyramidLayerSize(height, i + 1);
+  }
+  // The 1/4 layer goes below the 1/2 layer, starting on an even row so both
+  // share the chroma plane too.
+  const int half_chroma_height = (layers[0].height + 1) / 2;
+  FrameBufferKey key;
+  key.width = layers[0].width;
+  key.height = half_chroma_height * 2 + layers[1].height;
+  key.format = format;
+  std::shared_ptr<FrameBuffer> buffer = pool->Acquire(key);
+  if (!buffer) {
+    return false;
+  }
+  for (int i = 0; i < kPyramidLayerCount; ++i) {
+    layers[i].stride_y = buffer->Stride(0);
+    layers[i].stride_uv = buffer->Stride(1);
+    layers[i].y = buffer->Plane(0) + (i == 0 ? 0 : static_cast<size_t>(half_chroma_height) * 2 * layers[i].stride_y);
+    layers[i].uv = buffer->Plane(1) + (i == 0 ? 0 : static_cast<size_t>(half_chroma_height) * layers[i].stride_uv);
+  }
+
+  const PlaneTargets luma = {
+      layers[0].y, layers[0].stride_y, layers[0].width, layers[0].height,
+      layers[1].y, layers[1].stride_y, layers[1].width, layers[1].height,
+  };
+  const PlaneTargets chroma = {
+      layers[0].uv, layers[0].stride_uv, (layers[0].width + 1) / 2, (layers[0].height + 1) / 2,
+      layers[1].uv, layers[1].stride_uv, (layers[1].width + 1) / 2, (layers[1].height + 1) / 2,
+  };
+  BuildPlane<1>(src_y, src_stride_y, width, height, luma, kernels.luma);
+  BuildPlane<2>(src_uv, src_stride_uv, chroma_width, chroma_height, chroma, kernels.chroma);
+
+  pyramid->buffer = std::move(buffer);
+  for (int i = 0; i < kPyramidLayerCount; ++i) {
+    pyramid->layers[i] = layers[i];
+  }
+  return true;
+}
+
+}  // namespace custom
@@ -0,0 +1,65 @@
+//
+//  FramePyramid.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/1.
+//
+
+#ifndef FramePyramid_h
+#define FramePyramid_h
+
+#include <cstdint>
+#include <memory>
+
+#include "CpuFeatures.h"
+#include "FrameBufferPool.h"
+
+namespace custom {
+
+// Layers below the full resolution frame: 1/2 and 1/4 scale.
+constexpr int kPyramidLayerCount = 2;
+
+// Size of pyramid layer |level| (1 for 1/2, 2 for 1/4) of a |size| frame.
+constexpr int PyramidLayerSize(int size, int level) { return size >> level; }
+
+// One NV12 layer of a pyramid.
+struct PyramidLayer {
+  int width = 0;
+  int height = 0;
+  uint8_t *y = nullptr;
+  int stride_y = 0;
+  uint8_t *uv = nullptr;
+  int stride_uv = 0;
+};
+
+// The layers of a pyramid share one buffer from a FrameBufferPool, stacked
+// vertically in its planes. They stay valid as long as |buffer| is referenced.
+struct NV12Pyramid {
+  std::shared_ptr<FrameBuffer> buffer;
+  PyramidLayer layers[kPyramidLayerCount];
+};
+
+// Builds the 1/2 and 1/4 scale layers of an NV12 frame with a box filter,
+// reading every source row once: each group of four rows gives two rows of the
+// 1/2 layer and one row of the 1/4 layer. The 1/4 layer is the 4x4 box of the
+// source rather than a box of the rounded 1/2 layer. Chroma is filtered in its
+// own plane, so every layer keeps 4:2:0 siting; odd chroma edges reuse the last
+// sample.
+//
+// |width| and |height| must be at least 4; layer sizes round down. |format| is
+// the NV12 FourCC of the source and of the pooled buffer. Returns false on
+// invalid arguments, if |path| is not supported or if the pool can't allocate.
+bool BuildNV12Pyramid(const uint8_t *src_y,
+                      int src_stride_y,
+                      const uint8_t *src_uv,
+                      int src_stride_uv,
+                      int width,
+                      int height,
+                      uint32_t format,
+                      FrameBufferPool *pool,
+                      NV12Pyramid *pyramid,
+                      SimdPath path = SimdPath::kAuto);
+
+}  // namespace custom
+
+#endif /* FramePyramid_h */
@@ -0,0 +1,106 @@
+//
+//  FrameScheduler.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/22.
+//
+
+#include "FrameScheduler.h"
+
+#include <algorithm>
+
+namespace custom {
+
+namespace {
+
+constexpr int64_t kWindowNs = 1000000000;
+
+}  // namespace
+
+FrameScheduler::FrameScheduler(const FrameSchedulerConfig &config) : config_(config) {}
+
+bool FrameScheduler::Admit(int64_t now_ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  AdvanceWindowLocked(now_ns);
+
+  bool admit = true;
+  if (busy_ && average_processing_ns_ > 0) {
+    // The frame would wait for the current one, then take the average time.
+    const double remaining_ns = std::max(0.0, average_processing_ns_ - (now_ns - busy_since_ns_));
+    admit = remaining_ns + average_processing_ns_ <= config_.latency_budget_ns;
+  }
+
+  if (admit) {
+    window_.admitted++;
+    totals_.admitted++;
+  } else {
+    window_.dropped++;
+    totals_.dropped++;
+  }
+  return admit;
+}
+
+void FrameScheduler::OnReplaced(int64_t now_ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  AdvanceWindowLocked(now_ns);
+  window_.replaced++;
+  totals_.replaced++;
+}
+
+void FrameScheduler::OnProcessingStarted(int64_t now_ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  AdvanceWindowLocked(now_ns);
+  busy_ = true;
+  busy_since_ns_ = now_ns;
+}
+
+void FrameScheduler::OnProcessingFinished(int64_t arrival_ns, int64_t now_ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  AdvanceWindowLocked(now_ns);
+  if (busy_) {
+    const double sample_ns = static_cast<double>(now_ns - busy_since_ns_);
+    average_processing_ns_ = average_processing_ns_ > 0
+                                 ? average_processing_ns_ + config_.smoothing * (sample_ns - average_processing_ns_)
+                                 : sample_ns;
+  }
+  busy_ = false;
+
+  window_.processed++;
+  totals_.processed++;
+  if (now_ns - arrival_ns > config_.latency_budget_ns) {
+    window_.late++;
+    totals_.late++;
+  }
+}
+
+FrameSchedulerCounters FrameScheduler::LastSecond() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return last_second_;
+}
+
+FrameSchedulerCounters FrameScheduler::Totals() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return totals_;
+}
+
+int64_t FrameScheduler::average_processing_ns() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return static_cast<int64_t>(average_processing_ns_);
+}
+
+void FrameScheduler::AdvanceWindowLocked(int64_t now_ns) {
+  if (!window_started_) {
+    window_started_ = true;
+    window_start_ns_ = now_ns;
+    return;
+  }
+  if (now_ns - window_start_ns_ < kWindowNs) {
+    return;
+  }
+  // A gap of more than a second leaves an empty last window.
+  last_second_ = now_ns - window_start_ns_ < 2 * kWindowNs ? window_ : FrameSchedulerCounters();
+  window_ = FrameSchedulerCounters();
+  window_start_ns_ += (now_ns - window_start_ns_) / kWindowNs * kWindowNs;
+}
+
+}  // namespace custom
@@ -0,0 +1,85 @@
+//
+//  FrameScheduler.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/22.
+//
+
+#ifndef FrameScheduler_h
+#define FrameScheduler_h
+
+#include <cstdint>
+#include <mutex>
+
+namespace custom {
+
+struct FrameSchedulerConfig {
+  // Longest acceptable time from a frame's arrival to the end of its
+  // processing. Two frames at 30 fps by default.
+  int64_t latency_budget_ns = 66000000;
+  // Weight of the newest sample in the processing time moving average.
+  double smoothing = 0.125;
+};
+
+// Every arriving frame is either admitted or dropped, and every admitted one
+// is eventually either processed or replaced.
+struct FrameSchedulerCounters {
+  // Frames let into the mailbox.
+  uint64_t admitted = 0;
+  // Frames skipped on arrival.
+  uint64_t dropped = 0;
+  // Admitted frames overwritten in the mailbox before the worker took them.
+  uint64_t replaced = 0;
+  // Processed frames that finished over the latency budget.
+  uint64_t late = 0;
+  uint64_t processed = 0;
+};
+
+// Admission control between a capturer and a slower processing stage. Frames
+// that would finish over the latency budget are skipped on arrival, based on a
+// moving average of the processing time; the rest go through a latest-wins
+// mailbox (see LatestFrameMailbox) so the worker always picks up the freshest
+// frame. Keeps per-second counters.
+//
+// Admit() and OnReplaced() are called from the capture thread, the
+// OnProcessing*() calls from a single worker. All times are in nanoseconds on one monotonic clock and are
+// passed in, so a capture timeline can be replayed.
+class FrameScheduler {
+ public:
+  explicit FrameScheduler(const FrameSchedulerConfig &config = FrameSchedulerConfig());
+
+  // Whether a frame arriving at |now_ns| should go into the mailbox. Always
+  // true while the worker is idle or before any processing time is known.
+  bool Admit(int64_t now_ns);
+
+  // An admitted frame was overwritten in the mailbox before it was processed.
+  void OnReplaced(int64_t now_ns);
+
+  void OnProcessingStarted(int64_t now_ns);
+  // |arrival_ns| is the arrival time of the frame that just finished.
+  void OnProcessingFinished(int64_t arrival_ns, int64_t now_ns);
+
+  // Counters of the last complete one second window.
+  FrameSchedulerCounters LastSecond() const;
+  FrameSchedulerCounters Totals() const;
+  int64_t average_processing_ns() const;
+
+ private:
+  void AdvanceWindowLocked(int64_t now_ns);
+
+  const FrameSchedulerConfig config_;
+  mutable std::mutex mutex_;
+  double average_processing_ns_ = 0;
+  bool busy_ = false;
+  int64_t busy_since_ns_ = 0;
+
+  bool window_started_ = false;
+  int64_t window_start_ns_ = 0;
+  FrameSchedulerCounters window_;
+  FrameSchedulerCounters last_second_;
+  FrameSchedulerCounters totals_;
+};
+
+}  // namespace custom
+
+#endif /* FrameScheduler_h */
@@ -0,0 +1,117 @@
+//
+//  GLResourceRegistry.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/4.
+//
+
+#include "GLResourceRegistry.h"
+
+#include <algorithm>
+
+namespace custom {
+
+const char *GLResourceKindName(GLResourceKind kind) {
+  switch (kind) {
+    case GLResourceKind::kProgram:
+      return "program";
+    case GLResourceKind::kVertexBuffer:
+      return "vertex buffer";
+    case GLResourceKind::kSampler:
+      return "sampler";
+  }
+  return "unknown";
+}
+
+void FillRotatedQuadVertices(float vertices[kRotatedQuadFloatCount]) {
+  static const float kPositions[kQuadVertexCount][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+  static const float kTexcoords[kQuadVertexCount][2] = {
+      {0, 1},  // Lower left.
+      {1, 1},  // Lower right.
+      {1, 0},  // Upper right.
+      {0, 0},  // Upper left.
+  };
+  float *vertex = vertices;
+  for (int offset = 0; offset < kQuadRotationCount; ++offset) {
+    for (int i = 0; i < kQuadVertexCount; ++i) {
+      const float *uv = kTexcoords[(i + offset) % kQuadVertexCount];
+      vertex[0] = kPositions[i][0];
+      vertex[1] = kPositions[i][1];
+      vertex[2] = uv[0];
+      vertex[3] = uv[1];
+      vertex += kQuadFloatsPerVertex;
+    }
+  }
+}
+
+std::string GLResourceReport::ToString() const {
+  std::string text;
+  for (int i = 0; i < kGLResourceKindCount; ++i) {
+    const GLResourceCounts &counts = kinds[i];
+    text += GLResourceKindName(static_cast<GLResourceKind>(i));
+    text += ": " + std::to_string(counts.objects) + " objects, " + std::to_string(counts.references) + " refs, " +
+            std::to_string(counts.bytes) + " bytes\n";
+  }
+  text += "created " + std::to_string(created) + ", shared " + std::to_string(shared) + "\n";
+  return text;
+}
+
+uint32_t GLResourceRegistry::Acquire(GLResourceKind kind, uint64_t key, const Factory &factory) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (Entry &entry : entries_) {
+    if (entry.kind == kind && entry.key == key) {
+      entry.references++;
+      shared_++;
+      return entry.name;
+    }
+  }
+  size_t bytes = 0;
+  const uint32_t name = factory ? factory(&bytes) : 0;
+  if (!name) {
+    return 0;
+  }
+  entries_.push_back(Entry{kind, key, name, 1, bytes});
+  created_++;
+  return name;
+}
+
+bool GLResourceRegistry::Release(GLResourceKind kind, uint32_t name) {
+  if (!name) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find_if(entries_.begin(), entries_.end(),
+                         [kind, name](const Entry &entry) { return entry.kind == kind && entry.name == name; });
+  if (it == entries_.end() || --it->references > 0) {
+    return false;
+  }
+  entries_.erase(it);
+  return true;
+}
+
+std::vector<std::pair<GLResourceKind, uint32_t>> GLResourceRegistry::TakeAll() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::pair<GLResourceKind, uint32_t>> objects;
+  objects.reserve(entries_.size());
+  for (const Entry &entry : entries_) {
+    objects.emplace_back(entry.kind, entry.name);
+  }
+  entries_.clear();
+  return objects;
+}
+
+GLResourceReport GLResourceRegistry::Report() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  GLResourceReport report;
+  for (const Entry &entry : entries_) {
+    GLResourceCounts &counts = report.kinds[static_cast<int>(entry.kind)];
+    counts.objects++;
+    counts.references += entry.references;
+    counts.bytes += entry.bytes;
+  }
+  report.created = created_;
+  report.shared = shared_;
+  return report;
+}
+
+}  // namespace custom
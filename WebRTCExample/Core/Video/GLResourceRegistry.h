@@ -0,0 +1,118 @@
+//
+//  GLResourceRegistry.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/4.
+//
+
+#ifndef GLResourceRegistry_h
+#define GLResourceRegistry_h
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace custom {
+
+enum class GLResourceKind : uint8_t {
+  kProgram,
+  kVertexBuffer,
+  kSampler,
+};
+
+constexpr int kGLResourceKindCount = 3;
+
+const char *GLResourceKindName(GLResourceKind kind);
+
+// The fullscreen quad, drawn as a GL_TRIANGLE_FAN of 4 vertices of X, Y, U, V.
+constexpr int kQuadVertexCount = 4;
+constexpr int kQuadFloatsPerVertex = 4;
+// The texture coordinates can be rotated by 0 to 3 corners.
+constexpr int kQuadRotationCount = 4;
+constexpr int kRotatedQuadFloatCount = kQuadRotationCount * kQuadVertexCount * kQuadFloatsPerVertex;
+
+// Fills |vertices| with one quad per rotation, back to back, so a single
+// static buffer serves every rotation. The quad of rotation |offset| starts at
+// vertex RotatedQuadFirstVertex(offset). Texture coordinates are flipped
+// vertically because frames have their origin in the upper left corner; the
+// UV of the corner |i| is that of corner |i + offset| of the unrotated quad.
+void FillRotatedQuadVertices(float vertices[kRotatedQuadFloatCount]);
+
+constexpr int RotatedQuadFirstVertex(int offset) { return (offset & (kQuadRotationCount - 1)) * kQuadVertexCount; }
+
+struct GLResourceCounts {
+  size_t objects = 0;
+  // Sum of the reference counts of those objects.
+  size_t references = 0;
+  // GPU memory as estimated by the creators.
+  size_t bytes = 0;
+};
+
+struct GLResourceReport {
+  GLResourceCounts kinds[kGLResourceKindCount];
+  // Acquire() calls that created an object, and those that shared one.
+  uint64_t created = 0;
+  uint64_t shared = 0;
+
+  const GLResourceCounts &operator[](GLResourceKind kind) const { return kinds[static_cast<int>(kind)]; }
+
+  // One line per kind, e.g. "program: 4 objects, 6 refs, 18432 bytes".
+  std::string ToString() const;
+};
+
+// Reference counted GL objects of one share group, keyed by what they are
+// rather than by who made them, so every shader drawing in the group shares one
+// copy. Knows nothing about GL: objects are created by the factory given to
+// Acquire() and handed back by Release() for the caller to delete with the
+// context current.
+//
+// Thread safe.
+class GLResourceRegistry {
+ public:
+  // Creates the object, returning its name and estimated size in |bytes|, or
+  // 0 on failure.
+  typedef std::function<uint32_t(size_t *bytes)> Factory;
+
+  GLResourceRegistry() = default;
+
+  GLResourceRegistry(const GLResourceRegistry &) = delete;
+  GLResourceRegistry &operator=(const GLResourceRegistry &) = delete;
+
+  // Adds a reference to the object of |kind| with |key|, creating it with
+  // |factory| if there is none. Returns 0 if the factory fails. The factory
+  // runs under the registry's lock and must not call back into it.
+  uint32_t Acquire(GLResourceKind kind, uint64_t key, const Factory &factory);
+
+  // Drops a reference to |name|. Returns true if it was the last one; the
+  // caller then deletes the object.
+  bool Release(GLResourceKind kind, uint32_t name);
+
+  // Forgets every object regardless of references and returns them, e.g. to
+  // delete them before the share group goes away.
+  std::vector<std::pair<GLResourceKind, uint32_t>> TakeAll();
+
+  GLResourceReport Report() const;
+
+ private:
+  struct Entry {
+    GLResourceKind kind;
+    uint64_t key;
+    uint32_t name;
+    size_t references;
+    size_t bytes;
+  };
+
+  mutable std::mutex mutex_;
+  // A share group holds a handful of objects, a linear search is cheapest.
+  std::vector<Entry> entries_;
+  uint64_t created_ = 0;
+  uint64_t shared_ = 0;
+};
+
+}  // namespace custom
+
+#endif /* GLResourceRegistry_h */
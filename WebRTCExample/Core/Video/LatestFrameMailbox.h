@@ -0,0 +1,54 @@
+//
+//  LatestFrameMailbox.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/22.
+//
+
+#ifndef LatestFrameMailbox_h
+#define LatestFrameMailbox_h
+
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+namespace custom {
+
+// Single slot hand-off between a producer and a consumer thread where only the
+// newest value matters: a Put() overwrites a value that has not been taken.
+template <typename T>
+class LatestFrameMailbox {
+ public:
+  // Stores |frame|. Returns true if an untaken frame was overwritten.
+  bool Put(T frame, int64_t arrival_ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const bool replaced = full_;
+    frame_ = std::move(frame);
+    arrival_ns_ = arrival_ns;
+    full_ = true;
+    return replaced;
+  }
+
+  // Moves the stored frame out. Returns false if the mailbox is empty.
+  bool Take(T *frame, int64_t *arrival_ns) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!full_) {
+      return false;
+    }
+    *frame = std::move(frame_);
+    *arrival_ns = arrival_ns_;
+    frame_ = T();
+    full_ = false;
+    return true;
+  }
+
+ private:
+  std::mutex mutex_;
+  T frame_ = T();
+  int64_t arrival_ns_ = 0;
+  bool full_ = false;
+};
+
+}  // namespace custom
+
+#endif /* LatestFrameMailbox_h */
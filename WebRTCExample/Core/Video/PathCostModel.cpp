@@ -0,0 +1,109 @@
+//
+//  PathCostModel.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/6.
+//
+
+#include "PathCostModel.h"
+
+#include <algorithm>
+
+namespace custom {
+
+const char *ProcessingPathName(ProcessingPath path) {
+  switch (path) {
+    case ProcessingPath::kGpu:
+      return "gpu";
+    case ProcessingPath::kCpu:
+      return "cpu";
+  }
+  return "unknown";
+}
+
+PathCostModel::PathCostModel(const PathCostConfig &config) : config_(config) {
+  states_.reserve(config_.max_entries + 1);
+}
+
+ProcessingPath PathCostModel::Choose(const PathCostKey &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  State &state = TouchLocked(key);
+  PathCostEntry &entry = state.entry;
+  if (!entry.decided) {
+    // One untimed warm-up frame plus the probes, the GPU first.
+    const uint64_t runs = static_cast<uint64_t>(config_.probe_frames) + 1;
+    return entry.gpu_frames < runs ? ProcessingPath::kGpu : ProcessingPath::kCpu;
+  }
+  if (config_.reprobe_interval > 0 && ++state.since_probe >= config_.reprobe_interval) {
+    state.since_probe = 0;
+    return entry.chosen == ProcessingPath::kGpu ? ProcessingPath::kCpu : ProcessingPath::kGpu;
+  }
+  return entry.chosen;
+}
+
+void PathCostModel::Record(const PathCostKey &key, ProcessingPath path, int64_t cost_ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  PathCostEntry &entry = TouchLocked(key).entry;
+  const bool gpu = path == ProcessingPath::kGpu;
+  uint64_t &frames = gpu ? entry.gpu_frames : entry.cpu_frames;
+  int64_t &average = gpu ? entry.gpu_ns : entry.cpu_ns;
+  uint32_t &samples = gpu ? entry.gpu_samples : entry.cpu_samples;
+  if (++frames == 1) {
+    return;
+  }
+  average = samples == 0 ? cost_ns
+                         : average + static_cast<int64_t>(config_.smoothing * static_cast<double>(cost_ns - average));
+  ++samples;
+
+  const uint32_t probes = static_cast<uint32_t>(std::max(config_.probe_frames, 1));
+  if (!entry.decided) {
+    if (entry.gpu_samples >= probes && entry.cpu_samples >= probes) {
+      entry.decided = true;
+      entry.chosen = entry.cpu_ns < entry.gpu_ns ? ProcessingPath::kCpu : ProcessingPath::kGpu;
+    }
+    return;
+  }
+  const bool cpu_chosen = entry.chosen == ProcessingPath::kCpu;
+  const int64_t chosen_ns = cpu_chosen ? entry.cpu_ns : entry.gpu_ns;
+  const int64_t other_ns = cpu_chosen ? entry.gpu_ns : entry.cpu_ns;
+  if (static_cast<double>(other_ns) < static_cast<double>(chosen_ns) * (1.0 - config_.switch_margin)) {
+    entry.chosen = cpu_chosen ? ProcessingPath::kGpu : ProcessingPath::kCpu;
+    ++entry.switches;
+  }
+}
+
+std::vector<PathCostEntry> PathCostModel::Entries() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<PathCostEntry> entries;
+  entries.reserve(states_.size());
+  for (const State &state : states_) {
+    entries.push_back(state.entry);
+  }
+  return entries;
+}
+
+void PathCostModel::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  states_.clear();
+}
+
+PathCostModel::State &PathCostModel::TouchLocked(const PathCostKey &key) {
+  auto it = std::find_if(states_.begin(), states_.end(), [&](const State &state) { return state.entry.key == key; });
+  if (it != states_.end() && it == states_.begin()) {
+    return states_.front();
+  }
+  State state;
+  if (it != states_.end()) {
+    state = *it;
+    states_.erase(it);
+  } else {
+    state.entry.key = key;
+    if (states_.size() >= std::max<size_t>(config_.max_entries, 1)) {
+      states_.pop_back();
+    }
+  }
+  states_.insert(states_.begin(), state);
+  return states_.front();
+}
+
+}  // namespace custom
@@ -0,0 +1,110 @@
+//
+//  PathCostModel.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/6.
+//
+
+#ifndef PathCostModel_h
+#define PathCostModel_h
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace custom {
+
+// Where a frame is processed: GL upload, draw and readback, or a SIMD pass
+// over the planes on the CPU.
+enum class ProcessingPath { kGpu, kCpu };
+
+const char *ProcessingPathName(ProcessingPath path);
+
+struct PathCostConfig {
+  // Timed frames each path runs before the first decision. The first frame of
+  // each path pays for shader compilation and allocations and is not timed.
+  int probe_frames = 4;
+  // Once decided, one frame in this many runs the other path so its cost stays
+  // current, e.g. when the device heats up. 0 never probes again.
+  int reprobe_interval = 300;
+  // The other path takes over once it is this fraction cheaper.
+  double switch_margin = 0.1;
+  // Weight of the newest sample in the cost moving averages.
+  double smoothing = 0.125;
+  // Keys remembered; the least recently used one is forgotten.
+  size_t max_entries = 16;
+};
+
+// What a cost applies to: an effect, e.g. a hash of the filter parameters, on
+// frames of one format and size.
+struct PathCostKey {
+  uint64_t effect = 0;
+  uint32_t format = 0;
+  int width = 0;
+  int height = 0;
+
+  bool operator==(const PathCostKey &other) const {
+    return effect == other.effect && format == other.format && width == other.width && height == other.height;
+  }
+};
+
+struct PathCostEntry {
+  PathCostKey key;
+  // Moving averages of the timed frames, 0 until there is one.
+  int64_t gpu_ns = 0;
+  int64_t cpu_ns = 0;
+  uint32_t gpu_samples = 0;
+  uint32_t cpu_samples = 0;
+  // Whether both paths have been probed; |chosen| is the GPU until then.
+  bool decided = false;
+  ProcessingPath chosen = ProcessingPath::kGpu;
+  // Frames run on each path, probes included.
+  uint64_t gpu_frames = 0;
+  uint64_t cpu_frames = 0;
+  // Times the decision changed after the first one.
+  uint64_t switches = 0;
+};
+
+// Picks the cheaper of the GPU and CPU path per effect and frame size from
+// measured costs. The first frames of a key alternate between the paths as a
+// micro-benchmark, after which every frame takes the cheaper one; the other
+// path is sampled now and then and takes over if it becomes clearly cheaper.
+//
+// Costs are whatever the caller measures, typically the time the processing
+// thread spends on a frame. Choose() and Record() are called from the
+// processing thread, Entries() from anywhere.
+class PathCostModel {
+ public:
+  explicit PathCostModel(const PathCostConfig &config = PathCostConfig());
+
+  // The path the next frame of |key| should take.
+  ProcessingPath Choose(const PathCostKey &key);
+
+  // A frame of |key| took |cost_ns| on |path|.
+  void Record(const PathCostKey &key, ProcessingPath path, int64_t cost_ns);
+
+  // Every remembered key, most recently used first.
+  std::vector<PathCostEntry> Entries() const;
+
+  // Forgets every measurement, e.g. after a thermal state change.
+  void Reset();
+
+ private:
+  struct State {
+    PathCostEntry entry;
+    // Frames taking the chosen path since the last probe of the other one.
+    int since_probe = 0;
+  };
+
+  // Moves the state of |key| to the front, creating it if needed.
+  State &TouchLocked(const PathCostKey &key);
+
+  const PathCostConfig config_;
+  mutable std::mutex mutex_;
+  std::vector<State> states_;
+};
+
+}  // namespace custom
+
+#endif /* PathCostModel_h */
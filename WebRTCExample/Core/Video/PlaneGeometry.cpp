@@ -0,0 +1,55 @@
+//
+//  PlaneGeometry.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/23.
+//
+
+#include "PlaneGeometry.h"
+
+#include <cstring>
+
+namespace custom {
+
+bool IsValidPlane(const PlaneSource &plane) {
+  return plane.data && plane.width > 0 && plane.height > 0 && plane.bytes_per_sample > 0 &&
+         plane.stride > 0 && static_cast<size_t>(plane.stride) >= plane.row_bytes();
+}
+
+bool PlanPlaneUpload(const PlaneSource &plane, bool has_unpack_row_length, PlaneUpload *upload) {
+  if (!IsValidPlane(plane)) {
+    return false;
+  }
+  *upload = PlaneUpload();
+  // A single row never reads past its end, the stride does not matter.
+  if (static_cast<size_t>(plane.stride) == plane.row_bytes() || plane.height == 1) {
+    upload->mode = PlaneUploadMode::kPacked;
+  } else if (has_unpack_row_length && plane.stride % plane.bytes_per_sample == 0) {
+    upload->mode = PlaneUploadMode::kRowLength;
+    upload->row_length = plane.stride / plane.bytes_per_sample;
+  } else {
+    upload->mode = PlaneUploadMode::kRepack;
+  }
+  return true;
+}
+
+void CopyPlanePacked(const PlaneSource &plane, uint8_t *dst) {
+  const size_t row_bytes = plane.row_bytes();
+  for (int y = 0; y < plane.height; ++y) {
+    memcpy(dst + y * row_bytes, plane.data + static_cast<size_t>(y) * plane.stride, row_bytes);
+  }
+}
+
+void SplitUVPlanePacked(const PlaneSource &uv, uint8_t *dst_u, uint8_t *dst_v) {
+  for (int y = 0; y < uv.height; ++y) {
+    const uint8_t *src = uv.data + static_cast<size_t>(y) * uv.stride;
+    uint8_t *u = dst_u + static_cast<size_t>(y) * uv.width;
+    uint8_t *v = dst_v + static_cast<size_t>(y) * uv.width;
+    for (int x = 0; x < uv.width; ++x) {
+      u[x] = src[2 * x];
+      v[x] = src[2 * x + 1];
+    }
+  }
+}
+
+}  // namespace custom
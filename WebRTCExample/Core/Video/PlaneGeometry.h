@@ -0,0 +1,67 @@
+//
+//  PlaneGeometry.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/23.
+//
+
+#ifndef PlaneGeometry_h
+#define PlaneGeometry_h
+
+#include <cstddef>
+#include <cstdint>
+
+namespace custom {
+
+// One plane of a CPU frame on its way to a texture.
+struct PlaneSource {
+  const uint8_t *data = nullptr;
+  // Size in samples; a sample is |bytes_per_sample| bytes, e.g. 2 for an
+  // interleaved UV plane.
+  int width = 0;
+  int height = 0;
+  int stride = 0;
+  int bytes_per_sample = 1;
+
+  size_t row_bytes() const { return static_cast<size_t>(width) * bytes_per_sample; }
+  size_t packed_size() const { return row_bytes() * height; }
+};
+
+// How a plane gets into a texture.
+enum class PlaneUploadMode {
+  // Rows are tightly packed, upload straight from the plane.
+  kPacked,
+  // Padded rows, described to GL with GL_UNPACK_ROW_LENGTH (GLES3).
+  kRowLength,
+  // Padded rows without GL_UNPACK_ROW_LENGTH: copy into a packed buffer first.
+  kRepack,
+};
+
+struct PlaneUpload {
+  PlaneUploadMode mode = PlaneUploadMode::kPacked;
+  // GL_UNPACK_ROW_LENGTH in samples for kRowLength, 0 otherwise.
+  int row_length = 0;
+};
+
+// Chroma size of a 4:2:0 frame; odd sizes round up.
+constexpr int ChromaSize420(int luma_size) { return (luma_size + 1) / 2; }
+
+// Whether |plane| describes readable memory: positive size and a stride that
+// holds a full row.
+bool IsValidPlane(const PlaneSource &plane);
+
+// Picks the cheapest way to upload |plane|. A stride that is not a whole number
+// of samples can't be expressed as a row length and is repacked. Returns false
+// if the plane is invalid.
+bool PlanPlaneUpload(const PlaneSource &plane, bool has_unpack_row_length, PlaneUpload *upload);
+
+// Copies |plane| into |dst| with packed rows; |dst| holds packed_size() bytes.
+void CopyPlanePacked(const PlaneSource &plane, uint8_t *dst);
+
+// Splits an interleaved UV plane (NV12 chroma, bytes_per_sample 2) into packed
+// U and V planes of width x height bytes each.
+void SplitUVPlanePacked(const PlaneSource &uv, uint8_t *dst_u, uint8_t *dst_v);
+
+}  // namespace custom
+
+#endif /* PlaneGeometry_h */
@@ -0,0 +1,302 @@
+//
+//  ProgramBinaryCache.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/3.
+//
+
+#include "ProgramBinaryCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+namespace custom {
+
+namespace {
+
+constexpr uint8_t kFileMagic[4] = {'C', 'P', 'B', 'C'};
+// Far above any real program binary; guards allocations against corrupt sizes.
+constexpr uint32_t kMaxBinarySize = 16 << 20;
+
+void PutU32(std::vector<uint8_t> *out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out->push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+void PutU64(std::vector<uint8_t> *out, uint64_t value) {
+  for (int i = 0; i < 8; ++i) {
+    out->push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+// Bounds checked little endian reader.
+class Reader {
+ public:
+  Reader(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+  bool ReadU32(uint32_t *value) {
+    uint64_t wide = 0;
+    if (!ReadLE(4, &wide)) {
+      return false;
+    }
+    *value = static_cast<uint32_t>(wide);
+    return true;
+  }
+
+  bool ReadU64(uint64_t *value) { return ReadLE(8, value); }
+
+  bool ReadBytes(size_t count, const uint8_t **bytes) {
+    if (size_ - offset_ < count) {
+      return false;
+    }
+    *bytes = data_ + offset_;
+    offset_ += count;
+    return true;
+  }
+
+  size_t remaining() const { return size_ - offset_; }
+
+ private:
+  bool ReadLE(int count, uint64_t *value) {
+    const uint8_t *bytes = nullptr;
+    if (!ReadBytes(count, &bytes)) {
+      return false;
+    }
+    *value = 0;
+    for (int i = 0; i < count; ++i) {
+      *value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+    }
+    return true;
+  }
+
+  const uint8_t *data_;
+  size_t size_;
+  size_t offset_ = 0;
+};
+
+}  // namespace
+
+uint64_t Fnv1a64(const void *data, size_t size, uint64_t hash) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+uint64_t ProgramCacheKey(const char *vertex_source, const char *fragment_source, const std::string &driver) {
+  // Hash the terminators too, so moving text between the parts changes the key.
+  const std::string vertex(vertex_source ? vertex_source : "");
+  const std::string fragment(fragment_source ? fragment_source : "");
+  uint64_t hash = Fnv1a64(vertex.c_str(), vertex.size() + 1);
+  hash = Fnv1a64(fragment.c_str(), fragment.size() + 1, hash);
+  return Fnv1a64(driver.c_str(), driver.size() + 1, hash);
+}
+
+ProgramBinaryCache::ProgramBinaryCache(size_t max_entries) : max_entries_(max_entries ? max_entries : 1) {}
+
+bool ProgramBinaryCache::Find(uint64_t key, ProgramBinary *binary) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return false;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second.lru);
+  *binary = it->second.binary;
+  return true;
+}
+
+void ProgramBinaryCache::Insert(uint64_t key, ProgramBinary binary) {
+  if (binary.data.empty() || binary.data.size() > kMaxBinarySize) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second.lru);
+    it->second.binary = std::move(binary);
+  } else {
+    lru_.push_front(key);
+    Entry entry;
+    entry.binary = std::move(binary);
+    entry.lru = lru_.begin();
+    entries_.emplace(key, std::move(entry));
+    while (entries_.size() > max_entries_) {
+      EraseLocked(lru_.back());
+    }
+  }
+  dirty_ = true;
+}
+
+void ProgramBinaryCache::Erase(uint64_t key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  EraseLocked(key);
+}
+
+void ProgramBinaryCache::EraseLocked(uint64_t key) {
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return;
+  }
+  lru_.erase(it->second.lru);
+  entries_.erase(it);
+  dirty_ = true;
+}
+
+void ProgramBinaryCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  dirty_ = dirty_ || !entries_.empty();
+  entries_.clear();
+  lru_.clear();
+}
+
+size_t ProgramBinaryCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+bool ProgramBinaryCache::dirty() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dirty_;
+}
+
+std::vector<uint8_t> ProgramBinaryCache::Serialize() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<uint8_t> out(kFileMagic, kFileMagic + sizeof(kFileMagic));
+  PutU32(&out, kFileVersion);
+  PutU32(&out, static_cast<uint32_t>(entries_.size()));
+  // Most recently used first, so a smaller cache loading this keeps the hot
+  // entries.
+  for (uint64_t key : lru_) {
+    const ProgramBinary &binary = entries_.at(key).binary;
+    PutU64(&out, key);
+    PutU32(&out, binary.format);
+    PutU32(&out, static_cast<uint32_t>(binary.data.size()));
+    out.insert(out.end(), binary.data.begin(), binary.data.end());
+  }
+  PutU64(&out, Fnv1a64(out.data(), out.size()));
+  dirty_ = false;
+  return out;
+}
+
+bool ProgramBinaryCache::Deserialize(const uint8_t *data, size_t size) {
+  if (!data || size < sizeof(kFileMagic) + 16) {
+    return false;
+  }
+  const size_t body_size = size - 8;
+  Reader checksum_reader(data + body_size, 8);
+  uint64_t checksum = 0;
+  if (!checksum_reader.ReadU64(&checksum) || checksum != Fnv1a64(data, body_size)) {
+    return false;
+  }
+
+  Reader reader(data, body_size);
+  const uint8_t *magic = nullptr;
+  uint32_t version = 0;
+  uint32_t count = 0;
+  if (!reader.ReadBytes(sizeof(kFileMagic), &magic) || memcmp(magic, kFileMagic, sizeof(kFileMagic)) != 0 ||
+      !reader.ReadU32(&version) || version != kFileVersion || !reader.ReadU32(&count)) {
+    return false;
+  }
+
+  std::vector<std::pair<uint64_t, ProgramBinary>> loaded;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint64_t key = 0;
+    uint32_t byte_count = 0;
+    const uint8_t *bytes = nullptr;
+    ProgramBinary binary;
+    if (!reader.ReadU64(&key) || !reader.ReadU32(&binary.format) || !reader.ReadU32(&byte_count) ||
+        byte_count == 0 || byte_count > kMaxBinarySize || !reader.ReadBytes(byte_count, &bytes)) {
+      return false;
+    }
+    binary.data.assign(bytes, bytes + byte_count);
+    loaded.emplace_back(key, std::move(binary));
+  }
+  if (reader.remaining() != 0) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  lru_.clear();
+  for (auto &item : loaded) {
+    if (entries_.size() >= max_entries_ || entries_.count(item.first)) {
+      continue;
+    }
+    lru_.push_back(item.first);
+    Entry entry;
+    entry.binary = std::move(item.second);
+    entry.lru = std::prev(lru_.end());
+    entries_.emplace(item.first, std::move(entry));
+  }
+  dirty_ = false;
+  return true;
+}
+
+bool ProgramBinaryCache::SaveToFile(const std::string &path) {
+  const std::vector<uint8_t> data = Serialize();
+  const std::string temp_path = path + ".tmp";
+  FILE *file = fopen(temp_path.c_str(), "wb");
+  bool saved = false;
+  if (file) {
+    const bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    saved = fclose(file) == 0 && written && rename(temp_path.c_str(), path.c_str()) == 0;
+  }
+  if (!saved) {
+    remove(temp_path.c_str());
+    // Keep the entries marked unsaved so the next attempt writes them.
+    std::lock_guard<std::mutex> lock(mutex_);
+    dirty_ = true;
+    return false;
+  }
+  return true;
+}
+
+bool ProgramBinaryCache::LoadFromFile(const std::string &path) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[16 * 1024];
+  size_t read = 0;
+  while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    data.insert(data.end(), chunk, chunk + read);
+  }
+  const bool failed = ferror(file) != 0;
+  fclose(file);
+  return !failed && Deserialize(data.data(), data.size());
+}
+
+void ProgramBinaryCache::RecordHit(int64_t load_ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.hits++;
+  stats_.load_ns += load_ns;
+}
+
+void ProgramBinaryCache::RecordMiss(int64_t compile_ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.misses++;
+  stats_.compile_ns += compile_ns;
+}
+
+void ProgramBinaryCache::RecordRejected() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.rejected++;
+}
+
+ProgramCacheStats ProgramBinaryCache::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void ProgramBinaryCache::ResetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_ = ProgramCacheStats();
+}
+
+}  // namespace custom
@@ -0,0 +1,123 @@
+//
+//  ProgramBinaryCache.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/3.
+//
+
+#ifndef ProgramBinaryCache_h
+#define ProgramBinaryCache_h
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace custom {
+
+// 64 bit FNV-1a, continuing from |hash|.
+uint64_t Fnv1a64(const void *data, size_t size, uint64_t hash = 0xcbf29ce484222325ull);
+
+// Identifies a linked program: the shader sources and the driver that linked
+// it, e.g. GL_VENDOR, GL_RENDERER and GL_VERSION joined. A driver update
+// changes the key, so stale binaries are never handed to glProgramBinary.
+uint64_t ProgramCacheKey(const char *vertex_source, const char *fragment_source, const std::string &driver);
+
+// A program binary as returned by glGetProgramBinary.
+struct ProgramBinary {
+  uint32_t format = 0;
+  std::vector<uint8_t> data;
+};
+
+struct ProgramCacheStats {
+  // Programs created from a cached binary.
+  uint64_t hits = 0;
+  // Programs that had to be compiled and linked.
+  uint64_t misses = 0;
+  // Cached binaries the driver rejected; they are dropped and compiled again.
+  uint64_t rejected = 0;
+  int64_t compile_ns = 0;
+  int64_t load_ns = 0;
+
+  double average_compile_ms() const { return misses ? compile_ns / 1e6 / static_cast<double>(misses) : 0.0; }
+  double average_load_ms() const { return hits ? load_ns / 1e6 / static_cast<double>(hits) : 0.0; }
+};
+
+// In memory index of program binaries with a simple on disk format, so the
+// first frame after launch doesn't pay for shader compilation. Knows nothing
+// about GL: the caller creates programs from Find() results and reports the
+// outcome. The least recently used entries are dropped beyond |max_entries|.
+//
+// File layout, little endian: magic "CPBC", version, entry count, then per
+// entry the key, binary format, byte count and bytes, and finally the FNV-1a
+// of everything before it. A file that fails any check is ignored as a whole.
+//
+// Thread safe.
+class ProgramBinaryCache {
+ public:
+  static constexpr size_t kDefaultMaxEntries = 32;
+  static constexpr uint32_t kFileVersion = 1;
+
+  explicit ProgramBinaryCache(size_t max_entries = kDefaultMaxEntries);
+
+  ProgramBinaryCache(const ProgramBinaryCache &) = delete;
+  ProgramBinaryCache &operator=(const ProgramBinaryCache &) = delete;
+
+  // Copies the binary for |key| into |binary|; returns false if there is none.
+  bool Find(uint64_t key, ProgramBinary *binary);
+
+  // Adds or replaces the binary for |key|. Empty binaries are ignored.
+  void Insert(uint64_t key, ProgramBinary binary);
+
+  // Drops |key|, e.g. after glProgramBinary rejected it.
+  void Erase(uint64_t key);
+
+  void Clear();
+  size_t size() const;
+
+  // True if entries changed since the last Serialize(), Deserialize() or file
+  // operation.
+  bool dirty() const;
+
+  std::vector<uint8_t> Serialize();
+
+  // Replaces the entries with those of |data|. Returns false and keeps the
+  // current entries if |data| is malformed.
+  bool Deserialize(const uint8_t *data, size_t size);
+
+  // Serialize() into a temporary file renamed over |path|, so a crash never
+  // leaves a partial cache behind.
+  bool SaveToFile(const std::string &path);
+  bool LoadFromFile(const std::string &path);
+
+  // Timing reported by the GL side.
+  void RecordHit(int64_t load_ns);
+  void RecordMiss(int64_t compile_ns);
+  void RecordRejected();
+
+  ProgramCacheStats stats() const;
+  void ResetStats();
+
+ private:
+  struct Entry {
+    ProgramBinary binary;
+    std::list<uint64_t>::iterator lru;
+  };
+
+  void EraseLocked(uint64_t key);
+
+  const size_t max_entries_;
+  mutable std::mutex mutex_;
+  std::unordered_map<uint64_t, Entry> entries_;
+  // Most recently used first.
+  std::list<uint64_t> lru_;
+  bool dirty_ = false;
+  ProgramCacheStats stats_;
+};
+
+}  // namespace custom
+
+#endif /* ProgramBinaryCache_h */
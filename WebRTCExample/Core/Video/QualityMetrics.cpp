@@ -0,0 +1,519 @@
+//
+//  QualityMetrics.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/9.
+//
+
+#include "QualityMetrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+#if defined(CUSTOM_ARCH_X86)
+#include <immintrin.h>
+#elif defined(CUSTOM_ARCH_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace custom {
+
+namespace {
+
+// SSIM works on 8x8 windows made of 2x2 blocks of 4x4 pixels, stepping by one
+// block; each block's sums are computed once and shared by four windows.
+constexpr int kSsimBlock = 4;
+// Sums of one 4x4 block: sum a, sum b, sum a^2 + b^2, sum a * b.
+constexpr int kSumsPerBlock = 4;
+
+// Sums of squared differences of |width| bytes, of the even bytes into sse[0]
+// and of the odd ones into sse[1]: U and V of an interleaved NV12 chroma row,
+// whose halves simply add up for a planar row. Lanes hold 32 bit partial sums;
+// they can't overflow for rows up to 64K bytes.
+typedef void (*SseRowFunc)(const uint8_t *a, const uint8_t *b, int width, uint64_t sse[2]);
+
+// Block sums of |blocks| 4x4 blocks starting at |a| and |b|, 4 sums each.
+typedef void (*SsimBlockRowFunc)(const uint8_t *a, int stride_a, const uint8_t *b, int stride_b, int blocks,
+                                 int32_t *sums);
+
+// |x| must be even.
+void SseRowFrom_C(const uint8_t *a, const uint8_t *b, int x, int width, uint64_t sse[2]) {
+  uint64_t even = 0;
+  uint64_t odd = 0;
+  for (; x + 2 <= width; x += 2) {
+    const int d0 = a[x] - b[x];
+    const int d1 = a[x + 1] - b[x + 1];
+    even += static_cast<uint32_t>(d0 * d0);
+    odd += static_cast<uint32_t>(d1 * d1);
+  }
+  if (x < width) {
+    const int d = a[x] - b[x];
+    even += static_cast<uint32_t>(d * d);
+  }
+  sse[0] += even;
+  sse[1] += odd;
+}
+
+void SseRow_C(const uint8_t *a, const uint8_t *b, int width, uint64_t sse[2]) {
+  SseRowFrom_C(a, b, 0, width, sse);
+}
+
+void SsimBlockRowFrom_C(const uint8_t *a, int stride_a, const uint8_t *b, int stride_b, int block, int blocks,
+                        int32_t *sums) {
+  for (; block < blocks; ++block) {
+    int32_t s1 = 0, s2 = 0, ss = 0, s12 = 0;
+    for (int y = 0; y < kSsimBlock; ++y) {
+      const uint8_t *row_a = a + static_cast<ptrdiff_t>(y) * stride_a + block * kSsimBlock;
+      const uint8_t *row_b = b + static_cast<ptrdiff_t>(y) * stride_b + block * kSsimBlock;
+      for (int x = 0; x < kSsimBlock; ++x) {
+        const int32_t va = row_a[x];
+        const int32_t vb = row_b[x];
+        s1 += va;
+        s2 += vb;
+        ss += va * va + vb * vb;
+        s12 += va * vb;
+      }
+    }
+    int32_t *out = sums + block * kSumsPerBlock;
+    out[0] = s1;
+    out[1] = s2;
+    out[2] = ss;
+    out[3] = s12;
+  }
+}
+
+void SsimBlockRow_C(const uint8_t *a, int stride_a, const uint8_t *b, int stride_b, int blocks, int32_t *sums) {
+  SsimBlockRowFrom_C(a, stride_a, b, stride_b, 0, blocks, sums);
+}
+
+#if defined(CUSTOM_ARCH_X86)
+
+// Squares fit 16 bits unsigned; the low half of every 32 bit lane holds an even
+// byte's square, the high half an odd byte's, as unpacking keeps byte parity.
+__attribute__((target("sse2"))) void SseRow_SSE2(const uint8_t *a, const uint8_t *b, int width, uint64_t sse[2]) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i low_half = _mm_set1_epi32(0xffff);
+  __m128i even = _mm_setzero_si128();
+  __m128i odd = _mm_setzero_si128();
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + x));
+    const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + x));
+    const __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+    const __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+    const __m128i sq_lo = _mm_mullo_epi16(lo, lo);
+    const __m128i sq_hi = _mm_mullo_epi16(hi, hi);
+    even = _mm_add_epi32(even, _mm_add_epi32(_mm_and_si128(sq_lo, low_half), _mm_and_si128(sq_hi, low_half)));
+    odd = _mm_add_epi32(odd, _mm_add_epi32(_mm_srli_epi32(sq_lo, 16), _mm_srli_epi32(sq_hi, 16)));
+  }
+  alignas(16) uint32_t lanes[2][4];
+  _mm_store_si128(reinterpret_cast<__m128i *>(lanes[0]), even);
+  _mm_store_si128(reinterpret_cast<__m128i *>(lanes[1]), odd);
+  for (int i = 0; i < 2; ++i) {
+    sse[i] += static_cast<uint64_t>(lanes[i][0]) + lanes[i][1] + lanes[i][2] + lanes[i][3];
+  }
+  SseRowFrom_C(a, b, x, width, sse);
+}
+
+__attribute__((target("avx2"))) void SseRow_AVX2(const uint8_t *a, const uint8_t *b, int width, uint64_t sse[2]) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i low_half = _mm256_set1_epi32(0xffff);
+  __m256i even = _mm256_setzero_si256();
+  __m256i odd = _mm256_setzero_si256();
+  int x = 0;
+  for (; x + 32 <= width; x += 32) {
+    const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + x));
+    const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + x));
+    const __m256i lo = _mm256_sub_epi16(_mm256_unpacklo_epi8(va, zero), _mm256_unpacklo_epi8(vb, zero));
+    const __m256i hi = _mm256_sub_epi16(_mm256_unpackhi_epi8(va, zero), _mm256_unpackhi_epi8(vb, zero));
+    const __m256i sq_lo = _mm256_mullo_epi16(lo, lo);
+    const __m256i sq_hi = _mm256_mullo_epi16(hi, hi);
+    even = _mm256_add_epi32(even,
+                            _mm256_add_epi32(_mm256_and_si256(sq_lo, low_half), _mm256_and_si256(sq_hi, low_half)));
+    odd = _mm256_add_epi32(odd, _mm256_add_epi32(_mm256_srli_epi32(sq_lo, 16), _mm256_srli_epi32(sq_hi, 16)));
+  }
+  alignas(32) uint32_t lanes[2][8];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[0]), even);
+  _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[1]), odd);
+  for (int i = 0; i < 2; ++i) {
+    for (uint32_t lane : lanes[i]) {
+      sse[i] += lane;
+    }
+  }
+  SseRowFrom_C(a, b, x, width, sse);
+}
+
+// Two blocks per step: 8 pixels of 4 rows widened to 16 bits. Each sum is
+// reduced to 32 bit lanes pairwise, so lanes 0-1 belong to the first block and
+// 2-3 to the second, then transposed into the output layout.
+__attribute__((target("sse2"))) void SsimBlockRow_SSE2(const uint8_t *a, int stride_a, const uint8_t *b, int stride_b,
+                                                       int blocks, int32_t *sums) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi16(1);
+  int block = 0;
+  for (; block + 2 <= blocks; block += 2) {
+    __m128i s1 = _mm_setzero_si128();
+    __m128i s2 = _mm_setzero_si128();
+    __m128i ss = _mm_setzero_si128();
+    __m128i s12 = _mm_setzero_si128();
+    for (int y = 0; y < kSsimBlock; ++y) {
+      const __m128i va = _mm_unpacklo_epi8(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i *>(a + static_cast<ptrdiff_t>(y) * stride_a + block * kSsimBlock)),
+          zero);
+      const __m128i vb = _mm_unpacklo_epi8(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i *>(b + static_cast<ptrdiff_t>(y) * stride_b + block * kSsimBlock)),
+          zero);
+      s1 = _mm_add_epi16(s1, va);
+      s2 = _mm_add_epi16(s2, vb);
+      ss = _mm_add_epi32(ss, _mm_add_epi32(_mm_madd_epi16(va, va), _mm_madd_epi16(vb, vb)));
+      s12 = _mm_add_epi32(s12, _mm_madd_epi16(va, vb));
+    }
+    __m128i r1 = _mm_madd_epi16(s1, ones);
+    __m128i r2 = _mm_madd_epi16(s2, ones);
+    // Lane pairs summed: [b0, b0, b1, b1].
+    r1 = _mm_add_epi32(r1, _mm_shuffle_epi32(r1, _MM_SHUFFLE(2, 3, 0, 1)));
+    r2 = _mm_add_epi32(r2, _mm_shuffle_epi32(r2, _MM_SHUFFLE(2, 3, 0, 1)));
+    ss = _mm_add_epi32(ss, _mm_shuffle_epi32(ss, _MM_SHUFFLE(2, 3, 0, 1)));
+    s12 = _mm_add_epi32(s12, _mm_shuffle_epi32(s12, _MM_SHUFFLE(2, 3, 0, 1)));
+    const __m128i sums_lo = _mm_unpacklo_epi32(r1, r2);  // s1 s2 of b0, twice
+    const __m128i sums_hi = _mm_unpacklo_epi32(ss, s12);
+    const __m128i sums_lo1 = _mm_unpackhi_epi32(r1, r2);  // s1 s2 of b1, twice
+    const __m128i sums_hi1 = _mm_unpackhi_epi32(ss, s12);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(sums + block * kSumsPerBlock), _mm_unpacklo_epi64(sums_lo, sums_hi));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(sums + (block + 1) * kSumsPerBlock),
+                     _mm_unpacklo_epi64(sums_lo1, sums_hi1));
+  }
+  SsimBlockRowFrom_C(a, stride_a, b, stride_b, block, blocks, sums);
+}
+
+// The SSE2 kernel on 16 pixels; every step works within 128 bit lanes, so the
+// low lane yields blocks 0 and 1, the high lane blocks 2 and 3.
+__attribute__((target("avx2"))) void SsimBlockRow_AVX2(const uint8_t *a, int stride_a, const uint8_t *b, int stride_b,
+                                                       int blocks, int32_t *sums) {
+  const __m256i ones = _mm256_set1_epi16(1);
+  int block = 0;
+  for (; block + 4 <= blocks; block += 4) {
+    __m256i s1 = _mm256_setzero_si256();
+    __m256i s2 = _mm256_setzero_si256();
+    __m256i ss = _mm256_setzero_si256();
+    __m256i s12 = _mm256_setzero_si256();
+    for (int y = 0; y < kSsimBlock; ++y) {
+      const __m256i va = _mm256_cvtepu8_epi16(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + static_cast<ptrdiff_t>(y) * stride_a + block * kSsimBlock)));
+      const __m256i vb = _mm256_cvtepu8_epi16(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + static_cast<ptrdiff_t>(y) * stride_b + block * kSsimBlock)));
+      s1 = _mm256_add_epi16(s1, va);
+      s2 = _mm256_add_epi16(s2, vb);
+      ss = _mm256_add_epi32(ss, _mm256_add_epi32(_mm256_madd_epi16(va, va), _mm256_madd_epi16(vb, vb)));
+      s12 = _mm256_add_epi32(s12, _mm256_madd_epi16(va, vb));
+    }
+    __m256i r1 = _mm256_madd_epi16(s1, ones);
+    __m256i r2 = _mm256_madd_epi16(s2, ones);
+    r1 = _mm256_add_epi32(r1, _mm256_shuffle_epi32(r1, _MM_SHUFFLE(2, 3, 0, 1)));
+    r2 = _mm256_add_epi32(r2, _mm256_shuffle_epi32(r2, _MM_SHUFFLE(2, 3, 0, 1)));
+    ss = _mm256_add_epi32(ss, _mm256_shuffle_epi32(ss, _MM_SHUFFLE(2, 3, 0, 1)));
+    s12 = _mm256_add_epi32(s12, _mm256_shuffle_epi32(s12, _MM_SHUFFLE(2, 3, 0, 1)));
+    // Blocks 0 | 2 and 1 | 3.
+    const __m256i even = _mm256_unpacklo_epi64(_mm256_unpacklo_epi32(r1, r2), _mm256_unpacklo_epi32(ss, s12));
+    const __m256i odd = _mm256_unpacklo_epi64(_mm256_unpackhi_epi32(r1, r2), _mm256_unpackhi_epi32(ss, s12));
+    int32_t *out = sums + block * kSumsPerBlock;
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm256_castsi256_si128(even));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + kSumsPerBlock), _mm256_castsi256_si128(odd));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * kSumsPerBlock), _mm256_extracti128_si256(even, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 3 * kSumsPerBlock), _mm256_extracti128_si256(odd, 1));
+  }
+  SsimBlockRowFrom_C(a, stride_a, b, stride_b, block, blocks, sums);
+}
+
+#endif  // CUSTOM_ARCH_X86
+
+#if defined(CUSTOM_ARCH_NEON)
+
+// vld2q_u8 splits even and odd bytes on load.
+void SseRow_NEON(const uint8_t *a, const uint8_t *b, int width, uint64_t sse[2]) {
+  uint32x4_t sums[2] = {vdupq_n_u32(0), vdupq_n_u32(0)};
+  int x = 0;
+  for (; x + 32 <= width; x += 32) {
+    const uint8x16x2_t va = vld2q_u8(a + x);
+    const uint8x16x2_t vb = vld2q_u8(b + x);
+    for (int i = 0; i < 2; ++i) {
+      const uint8x16_t diff = vabdq_u8(va.val[i], vb.val[i]);
+      sums[i] = vpadalq_u16(sums[i], vmull_u8(vget_low_u8(diff), vget_low_u8(diff)));
+      sums[i] = vpadalq_u16(sums[i], vmull_u8(vget_high_u8(diff), vget_high_u8(diff)));
+    }
+  }
+  for (int i = 0; i < 2; ++i) {
+    const uint64x2_t pairs = vpaddlq_u32(sums[i]);
+    sse[i] += vgetq_lane_u64(pairs, 0) + vgetq_lane_u64(pairs, 1);
+  }
+  SseRowFrom_C(a, b, x, width, sse);
+}
+
+// Two blocks per step; the low halves of the widened rows belong to the first
+// block, the high halves to the second.
+void SsimBlockRow_NEON(const uint8_t *a, int stride_a, const uint8_t *b, int stride_b, int blocks, int32_t *sums) {
+  int block = 0;
+  for (; block + 2 <= blocks; block += 2) {
+    uint16x8_t s1 = vdupq_n_u16(0);
+    uint16x8_t s2 = vdupq_n_u16(0);
+    uint32x4_t ss0 = vdupq_n_u32(0);
+    uint32x4_t ss1 = vdupq_n_u32(0);
+    uint32x4_t s120 = vdupq_n_u32(0);
+    uint32x4_t s121 = vdupq_n_u32(0);
+    for (int y = 0; y < kSsimBlock; ++y) {
+      const uint16x8_t va = vmovl_u8(vld1_u8(a + static_cast<ptrdiff_t>(y) * stride_a + block * kSsimBlock));
+      const uint16x8_t vb = vmovl_u8(vld1_u8(b + static_cast<ptrdiff_t>(y) * stride_b + block * kSsimBlock));
+      s1 = vaddq_u16(s1, va);
+      s2 = vaddq_u16(s2, vb);
+      ss0 = vmlal_u16(vmlal_u16(ss0, vget_low_u16(va), vget_low_u16(va)), vget_low_u16(vb), vget_low_u16(vb));
+      ss1 = vmlal_u16(vmlal_u16(ss1, vget_high_u16(va), vget_high_u16(va)), vget_high_u16(vb), vget_high_u16(vb));
+      s120 = vmlal_u16(s120, vget_low_u16(va), vget_low_u16(vb));
+      s121 = vmlal_u16(s121, vget_high_u16(va), vget_high_u16(vb));
+    }
+    // [block, block + 1] for each sum.
+    const uint32x2_t r1 = vpadd_u32(vpaddl_u16(vget_low_u16(s1)), vpaddl_u16(vget_high_u16(s1)));
+    const uint32x2_t r2 = vpadd_u32(vpaddl_u16(vget_low_u16(s2)), vpaddl_u16(vget_high_u16(s2)));
+    const uint32x2_t rss = vpadd_u32(vpadd_u32(vget_low_u32(ss0), vget_high_u32(ss0)),
+                                     vpadd_u32(vget_low_u32(ss1), vget_high_u32(ss1)));
+    const uint32x2_t r12 = vpadd_u32(vpadd_u32(vget_low_u32(s120), vget_high_u32(s120)),
+                                     vpadd_u32(vget_low_u32(s121), vget_high_u32(s121)));
+    // Transposed into [s1 s2 ss s12] per block.
+    const uint32x2x2_t sums12 = vzip_u32(r1, r2);
+    const uint32x2x2_t sums34 = vzip_u32(rss, r12);
+    int32_t *out = sums + block * kSumsPerBlock;
+    vst1q_s32(out, vreinterpretq_s32_u32(vcombine_u32(sums12.val[0], sums34.val[0])));
+    vst1q_s32(out + kSumsPerBlock, vreinterpretq_s32_u32(vcombine_u32(sums12.val[1], sums34.val[1])));
+  }
+  SsimBlockRowFrom_C(a, stride_a, b, stride_b, block, blocks, sums);
+}
+
+#endif  // CUSTOM_ARCH_NEON
+
+SseRowFunc SelectSseRowFunc(SimdPath path) {
+  if (!IsSimdPathSupported(path)) {
+    return nullptr;
+  }
+  switch (ResolveSimdPath(path)) {
+#if defined(CUSTOM_ARCH_X86)
+    case SimdPath::kSSE2:
+      return SseRow_SSE2;
+    case SimdPath::kAVX2:
+      return SseRow_AVX2;
+#endif
+#if defined(CUSTOM_ARCH_NEON)
+    case SimdPath::kNEON:
+      return SseRow_NEON;
+#endif
+    case SimdPath::kScalar:
+      return SseRow_C;
+    default:
+      return nullptr;
+  }
+}
+
+SsimBlockRowFunc SelectSsimBlockRowFunc(SimdPath path) {
+  if (!IsSimdPathSupported(path)) {
+    return nullptr;
+  }
+  switch (ResolveSimdPath(path)) {
+#if defined(CUSTOM_ARCH_X86)
+    case SimdPath::kSSE2:
+      return SsimBlockRow_SSE2;
+    case SimdPath::kAVX2:
+      return SsimBlockRow_AVX2;
+#endif
+#if defined(CUSTOM_ARCH_NEON)
+    case SimdPath::kNEON:
+      return SsimBlockRow_NEON;
+#endif
+    case SimdPath::kScalar:
+      return SsimBlockRow_C;
+    default:
+      return nullptr;
+  }
+}
+
+// SSIM of the 8x8 window made of blocks |a| |b| over |c| |d|, with x264's
+// constants for sums of 64 samples.
+double WindowSsim(const int32_t *a, const int32_t *b, const int32_t *c, const int32_t *d) {
+  static const double kC1 = .01 * .01 * 255 * 255 * 64;
+  static const double kC2 = .03 * .03 * 255 * 255 * 64 * 63;
+  const double s1 = a[0] + b[0] + c[0] + d[0];
+  const double s2 = a[1] + b[1] + c[1] + d[1];
+  const double ss = static_cast<double>(a[2]) + b[2] + c[2] + d[2];
+  const double s12 = static_cast<double>(a[3]) + b[3] + c[3] + d[3];
+  const double vars = ss * 64 - s1 * s1 - s2 * s2;
+  const double covar = s12 * 64 - s1 * s2;
+  return (2 * s1 * s2 + kC1) * (2 * covar + kC2) / ((s1 * s1 + s2 * s2 + kC1) * (vars + kC2));
+}
+
+double Psnr(uint64_t sse, uint64_t samples) {
+  if (sse == 0 || samples == 0) {
+    return kMaxPsnr;
+  }
+  return std::min(kMaxPsnr, 10.0 * std::log10(255.0 * 255.0 * static_cast<double>(samples) / static_cast<double>(sse)));
+}
+
+bool SameSize(const PlaneSource &a, const PlaneSource &b) {
+  return a.width == b.width && a.height == b.height;
+}
+
+PlaneSource LumaOf(const Yuv420Image &image) {
+  PlaneSource plane;
+  plane.data = image.planes[0];
+  plane.width = image.width;
+  plane.height = image.height;
+  plane.stride = image.strides[0];
+  return plane;
+}
+
+// The interleaved chroma plane of NV12 |image|.
+PlaneSource ChromaOf(const Yuv420Image &image) {
+  PlaneSource plane;
+  plane.data = image.planes[1];
+  plane.width = ChromaSize420(image.width);
+  plane.height = ChromaSize420(image.height);
+  plane.stride = image.strides[1];
+  plane.bytes_per_sample = 2;
+  return plane;
+}
+
+}  // namespace
+
+QualityMeter::QualityMeter(SimdPath path) : path_(path) {}
+
+void QualityMeter::PlanesOf(const Yuv420Image &image, std::vector<uint8_t> *scratch, PlaneSource planes[3]) {
+  planes[0] = LumaOf(image);
+  for (int i = 1; i < 3; ++i) {
+    planes[i].width = ChromaSize420(image.width);
+    planes[i].height = ChromaSize420(image.height);
+  }
+  if (image.format == kFourccI420) {
+    for (int i = 1; i < 3; ++i) {
+      planes[i].data = image.planes[i];
+      planes[i].stride = image.strides[i];
+    }
+    return;
+  }
+  const PlaneSource uv = ChromaOf(image);
+  const size_t plane_size = static_cast<size_t>(uv.width) * uv.height;
+  scratch->resize(2 * plane_size);
+  SplitUVPlanePacked(uv, scratch->data(), scratch->data() + plane_size);
+  for (int i = 1; i < 3; ++i) {
+    planes[i].data = scratch->data() + (i - 1) * plane_size;
+    planes[i].stride = uv.width;
+  }
+}
+
+bool QualityMeter::Measure(const Yuv420Image &reference,
+                           const Yuv420Image &distorted,
+                           bool with_ssim,
+                           FrameQuality *quality) {
+  if (!IsValidYuv420Image(reference) || !IsValidYuv420Image(distorted) || reference.width != distorted.width ||
+      reference.height != distorted.height || reference.width < kMinQualityFrameSize ||
+      reference.height < kMinQualityFrameSize) {
+    return false;
+  }
+  FrameQuality result;
+  if (!with_ssim && reference.format != kFourccI420 && distorted.format != kFourccI420) {
+    // PSNR of NV12 against NV12 reads U and V straight from the interleaved
+    // rows, without splitting them first.
+    SseRowFunc sse_row = SelectSseRowFunc(path_);
+    if (!sse_row || !MeasurePlane(LumaOf(reference), LumaOf(distorted), false, &result.planes[0])) {
+      return false;
+    }
+    const PlaneSource reference_uv = ChromaOf(reference);
+    const PlaneSource distorted_uv = ChromaOf(distorted);
+    uint64_t sse[2] = {};
+    for (int y = 0; y < reference_uv.height; ++y) {
+      sse_row(reference_uv.data + static_cast<size_t>(y) * reference_uv.stride,
+              distorted_uv.data + static_cast<size_t>(y) * distorted_uv.stride,
+              static_cast<int>(reference_uv.row_bytes()), sse);
+    }
+    for (int i = 1; i < 3; ++i) {
+      PlaneQuality &plane = result.planes[i];
+      plane.sse = sse[i - 1];
+      plane.samples = static_cast<uint64_t>(reference_uv.width) * reference_uv.height;
+      plane.psnr = Psnr(plane.sse, plane.samples);
+    }
+  } else {
+    PlaneSource reference_planes[3];
+    PlaneSource distorted_planes[3];
+    PlanesOf(reference, &reference_chroma_, reference_planes);
+    PlanesOf(distorted, &distorted_chroma_, distorted_planes);
+    for (int i = 0; i < 3; ++i) {
+      if (!MeasurePlane(reference_planes[i], distorted_planes[i], with_ssim, &result.planes[i])) {
+        return false;
+      }
+    }
+  }
+
+  uint64_t sse = 0;
+  uint64_t samples = 0;
+  double weighted_ssim = 0;
+  for (const PlaneQuality &plane : result.planes) {
+    sse += plane.sse;
+    samples += plane.samples;
+    weighted_ssim += plane.ssim * static_cast<double>(plane.samples);
+  }
+  result.psnr = Psnr(sse, samples);
+  result.ssim = weighted_ssim / static_cast<double>(samples);
+  *quality = result;
+  return true;
+}
+
+bool QualityMeter::MeasurePlane(const PlaneSource &reference,
+                                const PlaneSource &distorted,
+                                bool with_ssim,
+                                PlaneQuality *quality) {
+  if (!IsValidPlane(reference) || !IsValidPlane(distorted) || reference.bytes_per_sample != 1 ||
+      distorted.bytes_per_sample != 1 || !SameSize(reference, distorted) ||
+      (with_ssim && (reference.width < 2 * kSsimBlock || reference.height < 2 * kSsimBlock))) {
+    return false;
+  }
+  SseRowFunc sse_row = SelectSseRowFunc(path_);
+  SsimBlockRowFunc ssim_block_row = SelectSsimBlockRowFunc(path_);
+  if (!sse_row || !ssim_block_row) {
+    return false;
+  }
+
+  PlaneQuality result;
+  uint64_t sse[2] = {};
+  for (int y = 0; y < reference.height; ++y) {
+    sse_row(reference.data + static_cast<size_t>(y) * reference.stride,
+            distorted.data + static_cast<size_t>(y) * distorted.stride, reference.width, sse);
+  }
+  result.sse = sse[0] + sse[1];
+  result.samples = static_cast<uint64_t>(reference.width) * reference.height;
+  result.psnr = Psnr(result.sse, result.samples);
+
+  if (with_ssim) {
+    const int blocks = reference.width / kSsimBlock;
+    const int block_rows = reference.height / kSsimBlock;
+    const size_t row_sums = static_cast<size_t>(blocks) * kSumsPerBlock;
+    sums_.resize(2 * row_sums);
+    int32_t *previous = sums_.data();
+    int32_t *current = previous + row_sums;
+    double total = 0;
+    for (int by = 0; by < block_rows; ++by) {
+      const size_t offset = static_cast<size_t>(by) * kSsimBlock;
+      ssim_block_row(reference.data + offset * reference.stride, reference.stride,
+                     distorted.data + offset * distorted.stride, distorted.stride, blocks, current);
+      if (by > 0) {
+        for (int bx = 0; bx + 1 < blocks; ++bx) {
+          const int32_t *top = previous + bx * kSumsPerBlock;
+          const int32_t *bottom = current + bx * kSumsPerBlock;
+          total += WindowSsim(top, top + kSumsPerBlock, bottom, bottom + kSumsPerBlock);
+        }
+      }
+      std::swap(previous, current);
+    }
+    result.ssim = total / (static_cast<double>(block_rows - 1) * (blocks - 1));
+  }
+  *quality = result;
+  return true;
+}
+
+}  // namespace custom
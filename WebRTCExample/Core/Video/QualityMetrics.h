@@ -0,0 +1,89 @@
+//
+//  QualityMetrics.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/9.
+//
+
+#ifndef QualityMetrics_h
+#define QualityMetrics_h
+
+#include <cstdint>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "PlaneGeometry.h"
+#include "YuvFilter.h"
+
+namespace custom {
+
+// PSNR of identical planes, which would be infinite.
+constexpr double kMaxPsnr = 100.0;
+
+// Smallest frame QualityMeter measures: SSIM needs an 8x8 window in every
+// chroma plane.
+constexpr int kMinQualityFrameSize = 16;
+
+struct PlaneQuality {
+  // Sum of squared differences over |samples| samples.
+  uint64_t sse = 0;
+  uint64_t samples = 0;
+  // In dB, kMaxPsnr for identical planes.
+  double psnr = 0;
+  // Mean SSIM of the 8x8 windows on a 4 pixel grid, as x264 and FFmpeg
+  // compute it; 1 for identical planes. 0 if SSIM was not requested.
+  double ssim = 0;
+};
+
+struct FrameQuality {
+  // Y, U and V.
+  PlaneQuality planes[3];
+  // Over all samples: PSNR of the summed squared error, SSIM weighted by each
+  // plane's samples.
+  double psnr = 0;
+  double ssim = 0;
+};
+
+// PSNR and SSIM of a processed frame against a reference, per plane. Frames may
+// differ in layout, e.g. an I420 reference for NV12 output, but must have the
+// same size; samples are compared as stored, so a full range frame against a
+// video range one measures the range difference too.
+//
+// Squared errors and the 4x4 block sums SSIM is built from have SSE2, AVX2 and
+// NEON kernels, all exact, so every path gives the same scores. Keeps scratch
+// buffers for NV12 chroma and SSIM sums; not thread safe, use one meter per
+// thread.
+class QualityMeter {
+ public:
+  explicit QualityMeter(SimdPath path = SimdPath::kAuto);
+
+  // Measures |distorted| against |reference|. |with_ssim| false computes PSNR
+  // only, several times cheaper. Returns false on invalid or
+  // mismatched images, frames smaller than kMinQualityFrameSize, or if the
+  // path is not supported.
+  bool Measure(const Yuv420Image &reference,
+               const Yuv420Image &distorted,
+               bool with_ssim,
+               FrameQuality *quality);
+
+  // One plane of single byte samples, at least 8x8 for SSIM.
+  bool MeasurePlane(const PlaneSource &reference,
+                    const PlaneSource &distorted,
+                    bool with_ssim,
+                    PlaneQuality *quality);
+
+ private:
+  // The Y, U and V planes of |image| as single byte samples; NV12 chroma is
+  // split into |scratch|.
+  void PlanesOf(const Yuv420Image &image, std::vector<uint8_t> *scratch, PlaneSource planes[3]);
+
+  const SimdPath path_;
+  std::vector<uint8_t> reference_chroma_;
+  std::vector<uint8_t> distorted_chroma_;
+  // 4x4 block sums of two block rows.
+  std::vector<int32_t> sums_;
+};
+
+}  // namespace custom
+
+#endif /* QualityMetrics_h */
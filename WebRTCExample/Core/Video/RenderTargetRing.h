@@ -0,0 +1,77 @@
+//
+//  RenderTargetRing.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/19.
+//
+
+#ifndef RenderTargetRing_h
+#define RenderTargetRing_h
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "FrameFormat.h"
+
+namespace custom {
+
+// A fixed ring of render targets that all share one FrameBufferKey. Targets are
+// created together the first time a key is seen and then handed out round
+// robin, so consecutive frames never draw into the same target. A key change
+// (e.g. a new capture resolution) drops and recreates all of them.
+//
+// |Target| is owned through std::unique_ptr and releases its resources in its
+// destructor. Not thread safe; meant to be used from the GL thread.
+template <typename Target>
+class RenderTargetRing {
+ public:
+  static constexpr size_t kDefaultSize = 3;
+
+  explicit RenderTargetRing(size_t size = kDefaultSize) : slots_(size == 0 ? 1 : size) {}
+
+  RenderTargetRing(const RenderTargetRing &) = delete;
+  RenderTargetRing &operator=(const RenderTargetRing &) = delete;
+
+  // Returns the next target for |key|. |create| is called as
+  // create(const FrameBufferKey &) -> std::unique_ptr<Target> for every slot
+  // when the key changes. Returns nullptr if any of them fails, in which case
+  // the ring is left empty.
+  template <typename CreateFn>
+  Target *Next(const FrameBufferKey &key, CreateFn create) {
+    if (key != key_ || !slots_[0]) {
+      Clear();
+      for (auto &slot : slots_) {
+        slot = create(key);
+        if (!slot) {
+          Clear();
+          return nullptr;
+        }
+      }
+      key_ = key;
+    }
+    Target *target = slots_[next_].get();
+    next_ = (next_ + 1) % slots_.size();
+    return target;
+  }
+
+  void Clear() {
+    for (auto &slot : slots_) {
+      slot.reset();
+    }
+    next_ = 0;
+    key_ = FrameBufferKey();
+  }
+
+  const FrameBufferKey &key() const { return key_; }
+  size_t size() const { return slots_.size(); }
+
+ private:
+  std::vector<std::unique_ptr<Target>> slots_;
+  size_t next_ = 0;
+  FrameBufferKey key_;
+};
+
+}  // namespace custom
+
+#endif /* RenderTargetRing_h */
@@ -0,0 +1,416 @@
+//
+//  RotateConvert.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/16.
+//
+
+#include "RotateConvert.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "YuvConversion.h"
+
+#if defined(CUSTOM_ARCH_X86)
+#include <immintrin.h>
+#elif defined(CUSTOM_ARCH_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace custom {
+
+namespace {
+
+// Rows of the destination gathered per pass for 90/270 degrees. 16 BGRA pixels
+// are one 64 byte cache line of a source row.
+constexpr int kTransposeStripRows = 16;
+
+// Converts two destination oriented BGRA rows into two luma rows and one
+// interleaved chroma row, starting at pixel |x| (even). |row1| equals |row0|
+// for the last row of an odd height frame.
+typedef void (*RowPairFunc)(const uint8_t *row0,
+                            const uint8_t *row1,
+                            uint8_t *dst_y0,
+                            uint8_t *dst_y1,
+                            uint8_t *dst_uv,
+                            int width);
+
+// The SIMD kernels below hard code the same kBT601VideoRange coefficients.
+inline uint8_t RGBToY(int r, int g, int b) {
+  return static_cast<uint8_t>(RgbToY(kBT601VideoRange, r, g, b));
+}
+
+inline uint8_t RGBToU(int r, int g, int b) {
+  return static_cast<uint8_t>(RgbToU(kBT601VideoRange, r, g, b));
+}
+
+inline uint8_t RGBToV(int r, int g, int b) {
+  return static_cast<uint8_t>(RgbToV(kBT601VideoRange, r, g, b));
+}
+
+void RowPairFrom_C(const uint8_t *row0,
+                   const uint8_t *row1,
+                   uint8_t *dst_y0,
+                   uint8_t *dst_y1,
+                   uint8_t *dst_uv,
+                   int x,
+                   int width) {
+  for (; x + 1 < width; x += 2) {
+    const uint8_t *a = row0 + x * 4;
+    const uint8_t *b = row1 + x * 4;
+    dst_y0[x] = RGBToY(a[2], a[1], a[0]);
+    dst_y0[x + 1] = RGBToY(a[6], a[5], a[4]);
+    dst_y1[x] = RGBToY(b[2], b[1], b[0]);
+    dst_y1[x + 1] = RGBToY(b[6], b[5], b[4]);
+    const int avg_b = (a[0] + a[4] + b[0] + b[4]) >> 2;
+    const int avg_g = (a[1] + a[5] + b[1] + b[5]) >> 2;
+    const int avg_r = (a[2] + a[6] + b[2] + b[6]) >> 2;
+    dst_uv[x] = RGBToU(avg_r, avg_g, avg_b);
+    dst_uv[x + 1] = RGBToV(avg_r, avg_g, avg_b);
+  }
+  if (x < width) {
+    const uint8_t *a = row0 + x * 4;
+    const uint8_t *b = row1 + x * 4;
+    dst_y0[x] = RGBToY(a[2], a[1], a[0]);
+    dst_y1[x] = RGBToY(b[2], b[1], b[0]);
+    const int avg_b = (a[0] + b[0]) >> 1;
+    const int avg_g = (a[1] + b[1]) >> 1;
+    const int avg_r = (a[2] + b[2]) >> 1;
+    dst_uv[x] = RGBToU(avg_r, avg_g, avg_b);
+    dst_uv[x + 1] = RGBToV(avg_r, avg_g, avg_b);
+  }
+}
+
+void RowPair_C(const uint8_t *row0,
+               const uint8_t *row1,
+               uint8_t *dst_y0,
+               uint8_t *dst_y1,
+               uint8_t *dst_uv,
+               int width) {
+  RowPairFrom_C(row0, row1, dst_y0, dst_y1, dst_uv, 0, width);
+}
+
+#if defined(CUSTOM_ARCH_X86)
+
+// Sums adjacent 32 bit lanes of |lo| and |hi|: [lo0+lo1, lo2+lo3, hi0+hi1, hi2+hi3].
+__attribute__((target("sse2"))) inline __m128i HorizontalPairSum_SSE2(__m128i lo, __m128i hi) {
+  __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+  __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1));
+  return _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+}
+
+// Four BGRA pixels to four luma bytes in the low 32 bits.
+__attribute__((target("sse2"))) inline __m128i Luma4_SSE2(__m128i pixels) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i coefficients = _mm_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0);
+  __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), coefficients);
+  __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), coefficients);
+  __m128i sum = HorizontalPairSum_SSE2(lo, hi);
+  sum = _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(0x1080)), 8);
+  sum = _mm_packs_epi32(sum, sum);
+  return _mm_packus_epi16(sum, sum);
+}
+
+// Two 2x2 blocks (four pixels from each row) to [U0 V0 U1 V1] in the low 32 bits.
+__attribute__((target("sse2"))) inline __m128i Chroma2_SSE2(__m128i pixels0, __m128i pixels1) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i u_coefficients = _mm_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0);
+  const __m128i v_coefficients = _mm_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0);
+  __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(pixels0, zero), _mm_unpacklo_epi8(pixels1, zero));
+  __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(pixels0, zero), _mm_unpackhi_epi8(pixels1, zero));
+  lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+  hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+  __m128i average = _mm_srli_epi16(_mm_unpacklo_epi64(lo, hi), 2);
+  __m128i u = _mm_madd_epi16(average, u_coefficients);
+  __m128i v = _mm_madd_epi16(average, v_coefficients);
+  __m128i uv = HorizontalPairSum_SSE2(u, v);
+  uv = _mm_shuffle_epi32(uv, _MM_SHUFFLE(3, 1, 2, 0));
+  uv = _mm_srai_epi32(_mm_add_epi32(uv, _mm_set1_epi32(0x8080)), 8);
+  uv = _mm_packs_epi32(uv, uv);
+  return _mm_packus_epi16(uv, uv);
+}
+
+__attribute__((target("sse2"))) inline void Store4(uint8_t *dst, __m128i value) {
+  int32_t word = _mm_cvtsi128_si32(value);
+  memcpy(dst, &word, 4);
+}
+
+__attribute__((target("sse2"))) void RowPair_SSE2(const uint8_t *row0,
+                                                  const uint8_t *row1,
+                                                  uint8_t *dst_y0,
+                                                  uint8_t *dst_y1,
+                                                  uint8_t *dst_uv,
+                                                  int width) {
+  int x = 0;
+  for (; x + 4 <= width; x += 4) {
+    __m128i pixels0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + x * 4));
+    __m128i pixels1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + x * 4));
+    Store4(dst_y0 + x, Luma4_SSE2(pixels0));
+    Store4(dst_y1 + x, Luma4_SSE2(pixels1));
+    Store4(dst_uv + x, Chroma2_SSE2(pixels0, pixels1));
+  }
+  RowPairFrom_C(row0, row1, dst_y0, dst_y1, dst_uv, x, width);
+}
+
+// Joins the low 32 bits of both 128 bit lanes into 8 bytes.
+__attribute__((target("avx2"))) inline __m128i JoinLanes_AVX2(__m256i value) {
+  return _mm_unpacklo_epi32(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+}
+
+__attribute__((target("avx2"))) inline __m256i HorizontalPairSum_AVX2(__m256i lo, __m256i hi) {
+  __m256 even = _mm256_shuffle_ps(_mm256_castsi256_ps(lo), _mm256_castsi256_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+  __m256 odd = _mm256_shuffle_ps(_mm256_castsi256_ps(lo), _mm256_castsi256_ps(hi), _MM_SHUFFLE(3, 1, 3, 1));
+  return _mm256_add_epi32(_mm256_castps_si256(even), _mm256_castps_si256(odd));
+}
+
+// Eight BGRA pixels to eight luma bytes. Works per 128 bit lane like Luma4_SSE2.
+__attribute__((target("avx2"))) inline __m128i Luma8_AVX2(__m256i pixels) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i coefficients = _mm256_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0,
+                                                 25, 129, 66, 0, 25, 129, 66, 0);
+  __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(pixels, zero), coefficients);
+  __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(pixels, zero), coefficients);
+  __m256i sum = HorizontalPairSum_AVX2(lo, hi);
+  sum = _mm256_srli_epi32(_mm256_add_epi32(sum, _mm256_set1_epi32(0x1080)), 8);
+  sum = _mm256_packs_epi32(sum, sum);
+  return JoinLanes_AVX2(_mm256_packus_epi16(sum, sum));
+}
+
+// Four 2x2 blocks to [U0 V0 U1 V1 U2 V2 U3 V3].
+__attribute__((target("avx2"))) inline __m128i Chroma4_AVX2(__m256i pixels0, __m256i pixels1) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i u_coefficients = _mm256_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0,
+                                                   112, -74, -38, 0, 112, -74, -38, 0);
+  const __m256i v_coefficients = _mm256_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0,
+                                                   -18, -94, 112, 0, -18, -94, 112, 0);
+  __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(pixels0, zero), _mm256_unpacklo_epi8(pixels1, zero));
+  __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(pixels0, zero), _mm256_unpackhi_epi8(pixels1, zero));
+  lo = _mm256_add_epi16(lo, _mm256_srli_si256(lo, 8));
+  hi = _mm256_add_epi16(hi, _mm256_srli_si256(hi, 8));
+  __m256i average = _mm256_srli_epi16(_mm256_unpacklo_epi64(lo, hi), 2);
+  __m256i u = _mm256_madd_epi16(average, u_coefficients);
+  __m256i v = _mm256_madd_epi16(average, v_coefficients);
+  __m256i uv = HorizontalPairSum_AVX2(u, v);
+  uv = _mm256_shuffle_epi32(uv, _MM_SHUFFLE(3, 1, 2, 0));
+  uv = _mm256_srai_epi32(_mm256_add_epi32(uv, _mm256_set1_epi32(0x8080)), 8);
+  uv = _mm256_packs_epi32(uv, uv);
+  return JoinLanes_AVX2(_mm256_packus_epi16(uv, uv));
+}
+
+__attribute__((target("avx2"))) void RowPair_AVX2(const uint8_t *row0,
+                                                  const uint8_t *row1,
+                                                  uint8_t *dst_y0,
+                                                  uint8_t *dst_y1,
+                                                  uint8_t *dst_uv,
+                                                  int width) {
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    __m256i pixels0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0 + x * 4));
+    __m256i pixels1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1 + x * 4));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst_y0 + x), Luma8_AVX2(pixels0));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst_y1 + x), Luma8_AVX2(pixels1));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst_uv + x), Chroma4_AVX2(pixels0, pixels1));
+  }
+  RowPairFrom_C(row0, row1, dst_y0, dst_y1, dst_uv, x, width);
+}
+
+#endif  // CUSTOM_ARCH_X86
+
+#if defined(CUSTOM_ARCH_NEON)
+
+inline uint8x8_t Luma8_NEON(const uint8x8x4_t &pixels) {
+  uint16x8_t y = vmull_u8(pixels.val[0], vdup_n_u8(25));
+  y = vmlal_u8(y, pixels.val[1], vdup_n_u8(129));
+  y = vmlal_u8(y, pixels.val[2], vdup_n_u8(66));
+  y = vaddq_u16(y, vdupq_n_u16(0x1080));
+  return vshrn_n_u16(y, 8);
+}
+
+// Sum of each 2x2 block of one channel, divided by 4 with truncation.
+inline int16x4_t BlockAverage_NEON(uint8x8_t row0, uint8x8_t row1) {
+  uint16x8_t columns = vaddl_u8(row0, row1);
+  uint16x4_t blocks = vpadd_u16(vget_low_u16(columns), vget_high_u16(columns));
+  return vreinterpret_s16_u16(vshr_n_u16(blocks, 2));
+}
+
+inline uint8x8_t Chroma4_NEON(const uint8x8x4_t &pixels0, const uint8x8x4_t &pixels1) {
+  int16x4_t b = BlockAverage_NEON(pixels0.val[0], pixels1.val[0]);
+  int16x4_t g = BlockAverage_NEON(pixels0.val[1], pixels1.val[1]);
+  int16x4_t r = BlockAverage_NEON(pixels0.val[2], pixels1.val[2]);
+  int32x4_t u = vmull_n_s16(b, 112);
+  u = vmlsl_n_s16(u, g, 74);
+  u = vmlsl_n_s16(u, r, 38);
+  u = vaddq_s32(u, vdupq_n_s32(0x8080));
+  int32x4_t v = vmull_n_s16(r, 112);
+  v = vmlsl_n_s16(v, g, 94);
+  v = vmlsl_n_s16(v, b, 18);
+  v = vaddq_s32(v, vdupq_n_s32(0x8080));
+  int16x4x2_t uv = vzip_s16(vshrn_n_s32(u, 8), vshrn_n_s32(v, 8));
+  return vqmovun_s16(vcombine_s16(uv.val[0], uv.val[1]));
+}
+
+void RowPair_NEON(const uint8_t *row0,
+                  const uint8_t *row1,
+                  uint8_t *dst_y0,
+                  uint8_t *dst_y1,
+                  uint8_t *dst_uv,
+                  int width) {
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    uint8x8x4_t pixels0 = vld4_u8(row0 + x * 4);
+    uint8x8x4_t pixels1 = vld4_u8(row1 + x * 4);
+    vst1_u8(dst_y0 + x, Luma8_NEON(pixels0));
+    vst1_u8(dst_y1 + x, Luma8_NEON(pixels1));
+    vst1_u8(dst_uv + x, Chroma4_NEON(pixels0, pixels1));
+  }
+  RowPairFrom_C(row0, row1, dst_y0, dst_y1, dst_uv, x, width);
+}
+
+#endif  // CUSTOM_ARCH_NEON
+
+RowPairFunc SelectRowPairFunc(SimdPath path) {
+  if (!IsSimdPathSupported(path)) {
+    return nullptr;
+  }
+  switch (ResolveSimdPath(path)) {
+#if defined(CUSTOM_ARCH_X86)
+    case SimdPath::kSSE2:
+      return RowPair_SSE2;
+    case SimdPath::kAVX2:
+      return RowPair_AVX2;
+#endif
+#if defined(CUSTOM_ARCH_NEON)
+    case SimdPath::kNEON:
+      return RowPair_NEON;
+#endif
+    case SimdPath::kScalar:
+      return RowPair_C;
+    default:
+      return nullptr;
+  }
+}
+
+inline void CopyPixel(uint8_t *dst, const uint8_t *src) {
+  memcpy(dst, src, 4);
+}
+
+// Gathers destination rows [dst_row, dst_row + rows) of a rotated frame into
+// |strip|, which holds |rows| tightly packed rows of |dst_width| pixels. Reads
+// whole source rows for 180 degrees and |rows| pixel wide column slices of
+// every source row for 90/270 degrees.
+void GatherRotatedRows(const uint8_t *src,
+                       int src_stride,
+                       int src_width,
+                       int src_height,
+                       Rotation rotation,
+                       int dst_row,
+                       int rows,
+                       uint8_t *strip) {
+  const int dst_width = (rotation == Rotation::k180) ? src_width : src_height;
+  const size_t strip_stride = static_cast<size_t>(dst_width) * 4;
+  switch (rotation) {
+    case Rotation::k180:
+      // dst(x, y) = src(w - 1 - x, h - 1 - y)
+      for (int j = 0; j < rows; ++j) {
+        const uint8_t *src_row = src + static_cast<size_t>(src_height - 1 - dst_row - j) * src_stride;
+        uint8_t *dst = strip + j * strip_stride;
+        for (int x = 0; x < dst_width; ++x) {
+          CopyPixel(dst + x * 4, src_row + (src_width - 1 - x) * 4);
+        }
+      }
+      break;
+    case Rotation::k90:
+      // dst(x, y) = src(y, h - 1 - x)
+      for (int sy = 0; sy < src_height; ++sy) {
+        const uint8_t *src_pixels = src + static_cast<size_t>(sy) * src_stride + dst_row * 4;
+        uint8_t *dst = strip + (src_height - 1 - sy) * 4;
+        for (int j = 0; j < rows; ++j) {
+          CopyPixel(dst + j * strip_stride, src_pixels + j * 4);
+        }
+      }
+      break;
+    case Rotation::k270:
+      // dst(x, y) = src(w - 1 - y, x)
+      for (int sy = 0; sy < src_height; ++sy) {
+        const uint8_t *src_pixels = src + static_cast<size_t>(sy) * src_stride + (src_width - 1 - dst_row) * 4;
+        uint8_t *dst = strip + sy * 4;
+        for (int j = 0; j < rows; ++j) {
+          CopyPixel(dst + j * strip_stride, src_pixels - j * 4);
+        }
+      }
+      break;
+    case Rotation::k0:
+      break;
+  }
+}
+
+}  // namespace
+
+bool BGRAToNV12Rotated(const uint8_t *src_bgra,
+                       int src_stride_bgra,
+                       int src_width,
+                       int src_height,
+                       uint8_t *dst_y,
+                       int dst_stride_y,
+                       uint8_t *dst_uv,
+                       int dst_stride_uv,
+                       Rotation rotation,
+                       SimdPath path) {
+  if (!src_bgra || !dst_y || !dst_uv || src_width <= 0 || src_height <= 0 ||
+      src_stride_bgra < src_width * 4) {
+    return false;
+  }
+  const bool transposed = (rotation == Rotation::k90 || rotation == Rotation::k270);
+  const int dst_width = transposed ? src_height : src_width;
+  const int dst_height = transposed ? src_width : src_height;
+  if (dst_stride_y < dst_width || dst_stride_uv < (dst_width + 1) / 2 * 2) {
+    return false;
+  }
+  RowPairFunc row_pair = SelectRowPairFunc(path);
+  if (!row_pair) {
+    return false;
+  }
+
+  // Scratch luma row for the missing second row of an odd height frame, and the
+  // strip of gathered rows for rotated frames. Kept per thread so steady state
+  // does not allocate.
+  thread_local std::vector<uint8_t> scratch;
+  const int strip_rows = (rotation == Rotation::k0) ? 0 : (rotation == Rotation::k180 ? 2 : kTransposeStripRows);
+  const size_t strip_size = static_cast<size_t>(strip_rows) * dst_width * 4;
+  if (scratch.size() < strip_size + dst_width) {
+    scratch.resize(strip_size + dst_width);
+  }
+  uint8_t *strip = scratch.data();
+  uint8_t *spare_y = scratch.data() + strip_size;
+
+  if (rotation == Rotation::k0) {
+    for (int y = 0; y < dst_height; y += 2) {
+      const bool has_pair = (y + 1 < dst_height);
+      const uint8_t *row0 = src_bgra + static_cast<size_t>(y) * src_stride_bgra;
+      const uint8_t *row1 = has_pair ? row0 + src_stride_bgra : row0;
+      uint8_t *y0 = dst_y + static_cast<size_t>(y) * dst_stride_y;
+      uint8_t *y1 = has_pair ? y0 + dst_stride_y : spare_y;
+      row_pair(row0, row1, y0, y1, dst_uv + static_cast<size_t>(y / 2) * dst_stride_uv, dst_width);
+    }
+    return true;
+  }
+
+  const size_t strip_stride = static_cast<size_t>(dst_width) * 4;
+  for (int y = 0; y < dst_height; y += strip_rows) {
+    const int rows = std::min(strip_rows, dst_height - y);
+    GatherRotatedRows(src_bgra, src_stride_bgra, src_width, src_height, rotation, y, rows, strip);
+    for (int j = 0; j < rows; j += 2) {
+      const bool has_pair = (j + 1 < rows);
+      const uint8_t *row0 = strip + j * strip_stride;
+      const uint8_t *row1 = has_pair ? row0 + strip_stride : row0;
+      uint8_t *y0 = dst_y + static_cast<size_t>(y + j) * dst_stride_y;
+      uint8_t *y1 = has_pair ? y0 + dst_stride_y : spare_y;
+      row_pair(row0, row1, y0, y1, dst_uv + static_cast<size_t>((y + j) / 2) * dst_stride_uv, dst_width);
+    }
+  }
+  return true;
+}
+
+}  // namespace custom
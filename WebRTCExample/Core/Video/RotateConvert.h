@@ -0,0 +1,41 @@
+//
+//  RotateConvert.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/16.
+//
+
+#ifndef RotateConvert_h
+#define RotateConvert_h
+
+#include <cstdint>
+
+#include "CpuFeatures.h"
+#include "FrameFormat.h"
+
+namespace custom {
+
+// Rotates a BGRA frame (libyuv "ARGB" byte order) by |rotation| and converts it
+// to NV12 in one pass; every source pixel is read exactly once. The result is
+// bit-exact with libyuv::ARGBRotate followed by the C path of
+// libyuv::ARGBToNV12: BT.601 video range, 2x2 chroma box filter.
+//
+// |src_width| and |src_height| are the source dimensions. The destination is
+// src_height x src_width for 90 and 270 degrees. Both destination planes are
+// addressed through their own stride, so padded planes (e.g. IOSurface backed
+// CVPixelBuffers) are handled. Returns false on invalid arguments or if |path|
+// is not supported.
+bool BGRAToNV12Rotated(const uint8_t *src_bgra,
+                       int src_stride_bgra,
+                       int src_width,
+                       int src_height,
+                       uint8_t *dst_y,
+                       int dst_stride_y,
+                       uint8_t *dst_uv,
+                       int dst_stride_uv,
+                       Rotation rotation,
+                       SimdPath path = SimdPath::kAuto);
+
+}  // namespace custom
+
+#endif /* RotateConvert_h */
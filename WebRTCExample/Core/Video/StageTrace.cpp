@@ -0,0 +1,189 @@
+//
+//  StageTrace.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/26.
+//
+
+#include "StageTrace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+
+namespace custom {
+
+namespace {
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+std::atomic<uint64_t> g_next_trace_id{1};
+
+}  // namespace
+
+// A single writer ring. Each slot is a seqlock: |sequence| is 0 while the slot
+// is being written and the event's index + 1 once it is complete. The fields
+// are atomics so a concurrent Snapshot() is not a data race; all accesses but
+// the sequence are relaxed.
+struct StageTrace::Ring {
+  struct Slot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<int64_t> frame_ns{0};
+    std::atomic<int64_t> begin_ns{0};
+    std::atomic<int64_t> end_ns{0};
+    std::atomic<uint8_t> stage{0};
+  };
+
+  explicit Ring(size_t capacity) : mask(capacity - 1), slots(new Slot[capacity]) {}
+
+  const size_t mask;
+  std::unique_ptr<Slot[]> slots;
+  std::atomic<uint64_t> head{0};
+};
+
+const char *TraceStageName(TraceStage stage) {
+  switch (stage) {
+    case TraceStage::kQueue:
+      return "queue";
+    case TraceStage::kUpload:
+      return "upload";
+    case TraceStage::kDraw:
+      return "draw";
+    case TraceStage::kReadback:
+      return "readback";
+    case TraceStage::kConversion:
+      return "conversion";
+    case TraceStage::kHandoff:
+      return "handoff";
+  }
+  return "unknown";
+}
+
+int64_t TraceNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+StageTrace &StageTrace::Shared() {
+  static StageTrace *trace = new StageTrace();
+  return *trace;
+}
+
+StageTrace::StageTrace(size_t events_per_thread)
+    : id_(g_next_trace_id.fetch_add(1)), capacity_(RoundUpToPowerOfTwo(std::max<size_t>(events_per_thread, 1))) {
+  for (std::atomic<Ring *> &ring : rings_) {
+    ring.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+StageTrace::~StageTrace() {
+  for (std::atomic<Ring *> &ring : rings_) {
+    delete ring.load(std::memory_order_acquire);
+  }
+}
+
+StageTrace::Ring *StageTrace::RingForCurrentThread() {
+  // Traces this thread has recorded into, by id so a trace created at the
+  // address of a destroyed one is not mistaken for it.
+  struct ThreadRing {
+    uint64_t trace_id;
+    Ring *ring;
+  };
+  thread_local std::vector<ThreadRing> thread_rings;
+  for (const ThreadRing &entry : thread_rings) {
+    if (entry.trace_id == id_) {
+      return entry.ring;
+    }
+  }
+  Ring *ring = nullptr;
+  const int index = ring_count_.fetch_add(1, std::memory_order_relaxed);
+  if (index < kMaxThreads) {
+    ring = new Ring(capacity_);
+    rings_[index].store(ring, std::memory_order_release);
+  }
+  thread_rings.push_back(ThreadRing{id_, ring});
+  return ring;
+}
+
+void StageTrace::Record(TraceStage stage, int64_t frame_ns, int64_t begin_ns, int64_t end_ns) {
+  if (!enabled()) {
+    return;
+  }
+  Ring *ring = RingForCurrentThread();
+  if (!ring) {
+    dropped_events_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  const uint64_t index = ring->head.load(std::memory_order_relaxed);
+  Ring::Slot &slot = ring->slots[index & ring->mask];
+  slot.sequence.store(0, std::memory_order_relaxed);
+  // Readers must not see the new fields with the old sequence.
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.frame_ns.store(frame_ns, std::memory_order_relaxed);
+  slot.begin_ns.store(begin_ns, std::memory_order_relaxed);
+  slot.end_ns.store(end_ns, std::memory_order_relaxed);
+  slot.stage.store(static_cast<uint8_t>(stage), std::memory_order_relaxed);
+  slot.sequence.store(index + 1, std::memory_order_release);
+  ring->head.store(index + 1, std::memory_order_release);
+}
+
+std::vector<TraceEvent> StageTrace::Snapshot() const {
+  std::vector<TraceEvent> events;
+  const int ring_count = std::min(ring_count_.load(std::memory_order_relaxed), kMaxThreads);
+  for (int thread = 0; thread < ring_count; ++thread) {
+    const Ring *ring = rings_[thread].load(std::memory_order_acquire);
+    if (!ring) {
+      continue;
+    }
+    const uint64_t head = ring->head.load(std::memory_order_acquire);
+    const uint64_t first = (head > capacity_) ? head - capacity_ : 0;
+    for (uint64_t index = first; index < head; ++index) {
+      const Ring::Slot &slot = ring->slots[index & ring->mask];
+      const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+      if (sequence != index + 1) {
+        continue;
+      }
+      TraceEvent event;
+      event.thread = static_cast<uint32_t>(thread);
+      event.frame_ns = slot.frame_ns.load(std::memory_order_relaxed);
+      event.begin_ns = slot.begin_ns.load(std::memory_order_relaxed);
+      event.end_ns = slot.end_ns.load(std::memory_order_relaxed);
+      event.stage = static_cast<TraceStage>(slot.stage.load(std::memory_order_relaxed));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+        continue;
+      }
+      events.push_back(event);
+    }
+  }
+  std::sort(events.begin(), events.end(),
+            [](const TraceEvent &a, const TraceEvent &b) { return a.begin_ns < b.begin_ns; });
+  return events;
+}
+
+std::string StageTrace::ExportChromeTrace() const {
+  const std::vector<TraceEvent> events = Snapshot();
+  std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  char buffer[256];
+  for (size_t i = 0; i < events.size(); ++i) {
+    const TraceEvent &event = events[i];
+    // Chrome trace times are in microseconds.
+    snprintf(buffer, sizeof(buffer),
+             "%s{\"name\":\"%s\",\"cat\":\"video\",\"ph\":\"X\",\"pid\":1,\"tid\":%" PRIu32
+             ",\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame_ns\":%" PRId64 "}}",
+             i == 0 ? "" : ",", TraceStageName(event.stage), event.thread + 1, event.begin_ns / 1000.0,
+             (event.end_ns - event.begin_ns) / 1000.0, event.frame_ns);
+    json += buffer;
+  }
+  json += "]}";
+  return json;
+}
+
+}  // namespace custom
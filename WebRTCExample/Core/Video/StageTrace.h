@@ -0,0 +1,129 @@
+//
+//  StageTrace.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/26.
+//
+
+#ifndef StageTrace_h
+#define StageTrace_h
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace custom {
+
+// Steps a captured frame goes through before it is handed to WebRTC.
+enum class TraceStage : uint8_t {
+  // Waiting between capture and the start of processing.
+  kQueue,
+  // Pixel buffer to GL textures.
+  kUpload,
+  // Issuing the shader's draw calls.
+  kDraw,
+  // Waiting for the GPU to finish the frame.
+  kReadback,
+  // Turning the rendered frame into the output buffer.
+  kConversion,
+  // Delivering the frame to the WebRTC video source.
+  kHandoff,
+};
+
+constexpr int kTraceStageCount = 6;
+
+const char *TraceStageName(TraceStage stage);
+
+// Monotonic clock used for all trace timestamps.
+int64_t TraceNowNs();
+
+struct TraceEvent {
+  TraceStage stage = TraceStage::kQueue;
+  // Index of the recording thread's ring, stable for the life of the trace.
+  uint32_t thread = 0;
+  // Capture timestamp of the frame, the timeStampNs passed down the pipeline.
+  int64_t frame_ns = 0;
+  int64_t begin_ns = 0;
+  int64_t end_ns = 0;
+};
+
+// Low overhead record of how long each frame spends in each stage. Every
+// recording thread gets its own fixed size ring, created on its first event,
+// so recording is lock free and never allocates afterwards; old events are
+// overwritten. Snapshot() may run concurrently with recording and skips
+// events that are being overwritten while it reads them.
+class StageTrace {
+ public:
+  static constexpr size_t kDefaultEventsPerThread = 1024;
+  // Threads beyond this many have their events dropped.
+  static constexpr int kMaxThreads = 32;
+
+  // The trace the app's pipeline records into. Disabled until enabled.
+  static StageTrace &Shared();
+
+  // |events_per_thread| is rounded up to a power of two.
+  explicit StageTrace(size_t events_per_thread = kDefaultEventsPerThread);
+  ~StageTrace();
+
+  StageTrace(const StageTrace &) = delete;
+  StageTrace &operator=(const StageTrace &) = delete;
+
+  void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // Records one stage of frame |frame_ns| on the calling thread's ring. Does
+  // nothing while disabled.
+  void Record(TraceStage stage, int64_t frame_ns, int64_t begin_ns, int64_t end_ns);
+
+  // Events currently held by all rings, ordered by begin time.
+  std::vector<TraceEvent> Snapshot() const;
+
+  // Snapshot() as Chrome trace event JSON ("X" events, one track per thread),
+  // for chrome://tracing or Perfetto. The frame timestamp is in each event's
+  // args so the stages of one frame can be followed across threads.
+  std::string ExportChromeTrace() const;
+
+  // Events lost because more than kMaxThreads threads recorded.
+  uint64_t dropped_events() const { return dropped_events_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Ring;
+
+  Ring *RingForCurrentThread();
+
+  const uint64_t id_;
+  const size_t capacity_;
+  std::atomic<bool> enabled_{false};
+  std::atomic<int> ring_count_{0};
+  std::atomic<Ring *> rings_[kMaxThreads];
+  std::atomic<uint64_t> dropped_events_{0};
+};
+
+// Records the time from construction to destruction as |stage| of a frame.
+// Reads the clock only if the trace is enabled.
+class ScopedStage {
+ public:
+  ScopedStage(StageTrace &trace, TraceStage stage, int64_t frame_ns)
+      : trace_(trace), stage_(stage), frame_ns_(frame_ns), begin_ns_(trace.enabled() ? TraceNowNs() : -1) {}
+  ~ScopedStage() {
+    if (begin_ns_ >= 0) {
+      trace_.Record(stage_, frame_ns_, begin_ns_, TraceNowNs());
+    }
+  }
+
+  ScopedStage(const ScopedStage &) = delete;
+  ScopedStage &operator=(const ScopedStage &) = delete;
+
+ private:
+  StageTrace &trace_;
+  const TraceStage stage_;
+  const int64_t frame_ns_;
+  const int64_t begin_ns_;
+};
+
+}  // namespace custom
+
+#endif /* StageTrace_h */
@@ -0,0 +1,243 @@
+//
+//  TemporalDenoise.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/5.
+//
+
+#include "TemporalDenoise.h"
+
+#include <cstddef>
+#include <cstring>
+
+#if defined(CUSTOM_ARCH_X86)
+#include <immintrin.h>
+#elif defined(CUSTOM_ARCH_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace custom {
+
+namespace {
+
+// Averages |width| bytes of |cur| with the rows of |count| history frames.
+// |reciprocal| is ceil(65536 / (count + 1)); with the rounding bias added first
+// the product's high half is exactly the rounded quotient for every possible
+// sum.
+typedef void (*DenoiseRowFunc)(const uint8_t *cur,
+                               const uint8_t *const *history,
+                               int count,
+                               uint8_t threshold,
+                               uint16_t reciprocal,
+                               uint8_t *dst,
+                               int width);
+
+void DenoiseRowFrom_C(const uint8_t *cur,
+                      const uint8_t *const *history,
+                      int count,
+                      uint8_t threshold,
+                      uint16_t reciprocal,
+                      uint8_t *dst,
+                      int x,
+                      int width) {
+  const uint32_t bias = static_cast<uint32_t>(count + 1) / 2;
+  for (; x < width; ++x) {
+    const int c = cur[x];
+    uint32_t sum = c;
+    for (int i = 0; i < count; ++i) {
+      const int h = history[i][x];
+      sum += (h - c <= threshold && c - h <= threshold) ? h : c;
+    }
+    dst[x] = static_cast<uint8_t>(((sum + bias) * reciprocal) >> 16);
+  }
+}
+
+void DenoiseRow_C(const uint8_t *cur,
+                  const uint8_t *const *history,
+                  int count,
+                  uint8_t threshold,
+                  uint16_t reciprocal,
+                  uint8_t *dst,
+                  int width) {
+  DenoiseRowFrom_C(cur, history, count, threshold, reciprocal, dst, 0, width);
+}
+
+#if defined(CUSTOM_ARCH_X86)
+
+__attribute__((target("sse2"))) void DenoiseRow_SSE2(const uint8_t *cur,
+                                                     const uint8_t *const *history,
+                                                     int count,
+                                                     uint8_t threshold,
+                                                     uint16_t reciprocal,
+                                                     uint8_t *dst,
+                                                     int width) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold));
+  const __m128i bias = _mm_set1_epi16(static_cast<short>((count + 1) / 2));
+  const __m128i scale = _mm_set1_epi16(static_cast<short>(reciprocal));
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cur + x));
+    __m128i sum_lo = _mm_add_epi16(_mm_unpacklo_epi8(c, zero), bias);
+    __m128i sum_hi = _mm_add_epi16(_mm_unpackhi_epi8(c, zero), bias);
+    for (int i = 0; i < count; ++i) {
+      const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(history[i] + x));
+      const __m128i diff = _mm_or_si128(_mm_subs_epu8(c, h), _mm_subs_epu8(h, c));
+      // diff <= threshold.
+      const __m128i still = _mm_cmpeq_epi8(_mm_max_epu8(diff, limit), limit);
+      const __m128i sample = _mm_or_si128(_mm_and_si128(still, h), _mm_andnot_si128(still, c));
+      sum_lo = _mm_add_epi16(sum_lo, _mm_unpacklo_epi8(sample, zero));
+      sum_hi = _mm_add_epi16(sum_hi, _mm_unpackhi_epi8(sample, zero));
+    }
+    const __m128i out = _mm_packus_epi16(_mm_mulhi_epu16(sum_lo, scale), _mm_mulhi_epu16(sum_hi, scale));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), out);
+  }
+  DenoiseRowFrom_C(cur, history, count, threshold, reciprocal, dst, x, width);
+}
+
+// The SSE2 kernel on 32 bytes; unpack and pack both work within 128 bit lanes,
+// so the bytes come back in order.
+__attribute__((target("avx2"))) void DenoiseRow_AVX2(const uint8_t *cur,
+                                                     const uint8_t *const *history,
+                                                     int count,
+                                                     uint8_t threshold,
+                                                     uint16_t reciprocal,
+                                                     uint8_t *dst,
+                                                     int width) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i limit = _mm256_set1_epi8(static_cast<char>(threshold));
+  const __m256i bias = _mm256_set1_epi16(static_cast<short>((count + 1) / 2));
+  const __m256i scale = _mm256_set1_epi16(static_cast<short>(reciprocal));
+  int x = 0;
+  for (; x + 32 <= width; x += 32) {
+    const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(cur + x));
+    __m256i sum_lo = _mm256_add_epi16(_mm256_unpacklo_epi8(c, zero), bias);
+    __m256i sum_hi = _mm256_add_epi16(_mm256_unpackhi_epi8(c, zero), bias);
+    for (int i = 0; i < count; ++i) {
+      const __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(history[i] + x));
+      const __m256i diff = _mm256_or_si256(_mm256_subs_epu8(c, h), _mm256_subs_epu8(h, c));
+      const __m256i still = _mm256_cmpeq_epi8(_mm256_max_epu8(diff, limit), limit);
+      const __m256i sample = _mm256_blendv_epi8(c, h, still);
+      sum_lo = _mm256_add_epi16(sum_lo, _mm256_unpacklo_epi8(sample, zero));
+      sum_hi = _mm256_add_epi16(sum_hi, _mm256_unpackhi_epi8(sample, zero));
+    }
+    const __m256i out = _mm256_packus_epi16(_mm256_mulhi_epu16(sum_lo, scale), _mm256_mulhi_epu16(sum_hi, scale));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), out);
+  }
+  DenoiseRowFrom_C(cur, history, count, threshold, reciprocal, dst, x, width);
+}
+
+#endif  // CUSTOM_ARCH_X86
+
+#if defined(CUSTOM_ARCH_NEON)
+
+void DenoiseRow_NEON(const uint8_t *cur,
+                     const uint8_t *const *history,
+                     int count,
+                     uint8_t threshold,
+                     uint16_t reciprocal,
+                     uint8_t *dst,
+                     int width) {
+  const uint8x16_t limit = vdupq_n_u8(threshold);
+  const uint16x8_t bias = vdupq_n_u16(static_cast<uint16_t>((count + 1) / 2));
+  const uint16x4_t scale = vdup_n_u16(reciprocal);
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    const uint8x16_t c = vld1q_u8(cur + x);
+    uint16x8_t sum_lo = vaddw_u8(bias, vget_low_u8(c));
+    uint16x8_t sum_hi = vaddw_u8(bias, vget_high_u8(c));
+    for (int i = 0; i < count; ++i) {
+      const uint8x16_t h = vld1q_u8(history[i] + x);
+      const uint8x16_t sample = vbslq_u8(vcleq_u8(vabdq_u8(c, h), limit), h, c);
+      sum_lo = vaddw_u8(sum_lo, vget_low_u8(sample));
+      sum_hi = vaddw_u8(sum_hi, vget_high_u8(sample));
+    }
+    const uint16x8_t out_lo = vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(sum_lo), scale), 16),
+                                           vshrn_n_u32(vmull_u16(vget_high_u16(sum_lo), scale), 16));
+    const uint16x8_t out_hi = vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(sum_hi), scale), 16),
+                                           vshrn_n_u32(vmull_u16(vget_high_u16(sum_hi), scale), 16));
+    vst1q_u8(dst + x, vcombine_u8(vqmovn_u16(out_lo), vqmovn_u16(out_hi)));
+  }
+  DenoiseRowFrom_C(cur, history, count, threshold, reciprocal, dst, x, width);
+}
+
+#endif  // CUSTOM_ARCH_NEON
+
+DenoiseRowFunc SelectDenoiseRowFunc(SimdPath path) {
+  if (!IsSimdPathSupported(path)) {
+    return nullptr;
+  }
+  switch (ResolveSimdPath(path)) {
+#if defined(CUSTOM_ARCH_X86)
+    case SimdPath::kSSE2:
+      return DenoiseRow_SSE2;
+    case SimdPath::kAVX2:
+      return DenoiseRow_AVX2;
+#endif
+#if defined(CUSTOM_ARCH_NEON)
+    case SimdPath::kNEON:
+      return DenoiseRow_NEON;
+#endif
+    case SimdPath::kScalar:
+      return DenoiseRow_C;
+    default:
+      return nullptr;
+  }
+}
+
+bool SameGeometry(const Yuv420Image &a, const Yuv420Image &b) {
+  return a.format == b.format && a.width == b.width && a.height == b.height;
+}
+
+}  // namespace
+
+bool ApplyTemporalDenoise(const Yuv420Image &src,
+                          const Yuv420Image *history,
+                          int history_count,
+                          uint8_t threshold,
+                          const Yuv420Image &dst,
+                          SimdPath path) {
+  if (history_count < 0 || history_count > kMaxTemporalDenoiseFrames || (history_count > 0 && !history) ||
+      !IsValidYuv420Image(src) || !IsValidYuv420Image(dst) || !SameGeometry(src, dst)) {
+    return false;
+  }
+  for (int i = 0; i < history_count; ++i) {
+    if (!IsValidYuv420Image(history[i]) || !SameGeometry(src, history[i])) {
+      return false;
+    }
+  }
+  DenoiseRowFunc denoise_row = SelectDenoiseRowFunc(path);
+  if (!denoise_row) {
+    return false;
+  }
+
+  const bool nv12 = src.format != kFourccI420;
+  const int chroma_width = (src.width + 1) / 2;
+  const int chroma_height = (src.height + 1) / 2;
+  // Bytes per row and rows of each plane.
+  const int plane_count = nv12 ? 2 : 3;
+  const int row_bytes[kMaxPlanes] = {src.width, nv12 ? 2 * chroma_width : chroma_width, chroma_width};
+  const int rows[kMaxPlanes] = {src.height, chroma_height, chroma_height};
+
+  const uint16_t reciprocal = static_cast<uint16_t>((65536 + history_count) / (history_count + 1));
+  const uint8_t *history_rows[kMaxTemporalDenoiseFrames];
+  for (int plane = 0; plane < plane_count; ++plane) {
+    for (int y = 0; y < rows[plane]; ++y) {
+      const uint8_t *cur = src.planes[plane] + static_cast<size_t>(y) * src.strides[plane];
+      uint8_t *out = dst.planes[plane] + static_cast<size_t>(y) * dst.strides[plane];
+      if (history_count == 0) {
+        if (out != cur) {
+          memcpy(out, cur, row_bytes[plane]);
+        }
+        continue;
+      }
+      for (int i = 0; i < history_count; ++i) {
+        history_rows[i] = history[i].planes[plane] + static_cast<size_t>(y) * history[i].strides[plane];
+      }
+      denoise_row(cur, history_rows, history_count, threshold, reciprocal, out, row_bytes[plane]);
+    }
+  }
+  return true;
+}
+
+}  // namespace custom
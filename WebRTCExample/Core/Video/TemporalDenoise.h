@@ -0,0 +1,44 @@
+//
+//  TemporalDenoise.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/5.
+//
+
+#ifndef TemporalDenoise_h
+#define TemporalDenoise_h
+
+#include <cstdint>
+
+#include "CpuFeatures.h"
+#include "YuvFilter.h"
+
+namespace custom {
+
+// Previous frames a denoise may average over, the capacity of FrameHistory.
+constexpr int kMaxTemporalDenoiseFrames = 8;
+
+// Motion adaptive temporal average. Every sample of |src| is averaged with the
+// same sample of the |history_count| frames of |history|; a history sample
+// differing from the current one by more than |threshold| is taken to be
+// motion and replaced by the current sample, so moving edges don't ghost while
+// static areas lose their noise. The average is rounded to nearest. Luma and
+// chroma are treated alike.
+//
+// Feeding the previous outputs back as |history| gives a recursive filter,
+// stronger for the same number of frames; feeding previous inputs does not
+// smear noise over time.
+//
+// All images must have the same format and size; |dst| may be |src|. A zero
+// |history_count| copies |src|. Returns false on invalid arguments or if
+// |path| is not supported.
+bool ApplyTemporalDenoise(const Yuv420Image &src,
+                          const Yuv420Image *history,
+                          int history_count,
+                          uint8_t threshold,
+                          const Yuv420Image &dst,
+                          SimdPath path = SimdPath::kAuto);
+
+}  // namespace custom
+
+#endif /* TemporalDenoise_h */
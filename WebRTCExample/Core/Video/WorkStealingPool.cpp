@@ -0,0 +1,168 @@
+//
+//  WorkStealingPool.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/25.
+//
+
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+
+namespace custom {
+
+namespace {
+
+// Bands per thread handed out by ForEachRowBand().
+constexpr int kBandsPerThread = 4;
+
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(int thread_count) {
+  const int count = std::max(thread_count, 1);
+  for (int i = 0; i < count; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  // Worker 0 is whichever thread calls ParallelFor().
+  for (int i = 1; i < count; ++i) {
+    threads_.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread &thread : threads_) {
+    thread.join();
+  }
+}
+
+void WorkStealingPool::ParallelFor(int count, const std::function<void(int)> &task) {
+  if (count <= 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> job_lock(job_mutex_);
+  jobs_++;
+  if (queues_.size() == 1 || count == 1) {
+    for (int i = 0; i < count; ++i) {
+      task(i);
+    }
+    tasks_ += count;
+    return;
+  }
+
+  task_ = &task;
+  remaining_ = count;
+  for (int i = 0; i < count; ++i) {
+    Queue &queue = *queues_[i % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(i);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+  }
+  wake_.notify_all();
+
+  while (RunOne(0)) {
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return remaining_.load() == 0; });
+  task_ = nullptr;
+}
+
+WorkStealingPoolStats WorkStealingPool::stats() const {
+  WorkStealingPoolStats stats;
+  stats.jobs = jobs_;
+  stats.tasks = tasks_;
+  stats.steals = steals_;
+  return stats;
+}
+
+void WorkStealingPool::WorkerLoop(int worker) {
+  uint64_t seen_generation = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&] { return stop_ || generation_ != seen_generation; });
+      if (stop_) {
+        return;
+      }
+      seen_generation = generation_;
+    }
+    while (RunOne(worker)) {
+    }
+  }
+}
+
+bool WorkStealingPool::RunOne(int worker) {
+  const int count = static_cast<int>(queues_.size());
+  int task = 0;
+  bool stolen = false;
+  if (!Pop(worker, true, &task)) {
+    stolen = true;
+    int victim = (worker + 1) % count;
+    for (; victim != worker; victim = (victim + 1) % count) {
+      if (Pop(victim, false, &task)) {
+        break;
+      }
+    }
+    if (victim == worker) {
+      return false;
+    }
+  }
+  (*task_)(task);
+  tasks_++;
+  if (stolen) {
+    steals_++;
+  }
+  if (remaining_.fetch_sub(1) == 1) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_.notify_all();
+  }
+  return true;
+}
+
+bool WorkStealingPool::Pop(int queue_index, bool front, int *task) {
+  Queue &queue = *queues_[queue_index];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.tasks.empty()) {
+    return false;
+  }
+  if (front) {
+    *task = queue.tasks.front();
+    queue.tasks.pop_front();
+  } else {
+    *task = queue.tasks.back();
+    queue.tasks.pop_back();
+  }
+  return true;
+}
+
+void ForEachRowBand(WorkStealingPool *pool,
+                    int height,
+                    int row_alignment,
+                    int min_band_rows,
+                    const std::function<void(int, int)> &band) {
+  if (height <= 0) {
+    return;
+  }
+  const int alignment = std::max(row_alignment, 1);
+  const int threads = pool ? pool->thread_count() : 1;
+  int band_rows = std::max((height + threads * kBandsPerThread - 1) / (threads * kBandsPerThread), min_band_rows);
+  band_rows = (band_rows + alignment - 1) / alignment * alignment;
+  const int band_count = (height + band_rows - 1) / band_rows;
+  if (!pool || band_count <= 1) {
+    band(0, height);
+    return;
+  }
+  pool->ParallelFor(band_count, [&](int index) {
+    const int first_row = index * band_rows;
+    band(first_row, std::min(first_row + band_rows, height));
+  });
+}
+
+}  // namespace custom
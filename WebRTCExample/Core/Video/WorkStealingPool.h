@@ -0,0 +1,99 @@
+//
+//  WorkStealingPool.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/25.
+//
+
+#ifndef WorkStealingPool_h
+#define WorkStealingPool_h
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace custom {
+
+struct WorkStealingPoolStats {
+  uint64_t jobs = 0;
+  uint64_t tasks = 0;
+  // Tasks run by a thread other than the one they were dealt to.
+  uint64_t steals = 0;
+};
+
+// Fixed set of threads for splitting one job into coarse tasks, e.g. the row
+// bands of a frame conversion. Tasks are dealt round robin to one queue per
+// thread; a thread works from the front of its own queue and, once that is
+// empty, steals from the back of the others, so a thread delayed by the
+// scheduler does not hold up the job. The calling thread is one of the
+// workers.
+class WorkStealingPool {
+ public:
+  // |thread_count| includes the calling thread; 1 runs every task inline.
+  explicit WorkStealingPool(int thread_count);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  int thread_count() const { return static_cast<int>(queues_.size()); }
+
+  // Runs |task|(i) for every i in [0, count) and returns once all have
+  // finished. Concurrent calls are serialized. |task| must not call back into
+  // the pool.
+  void ParallelFor(int count, const std::function<void(int)> &task);
+
+  WorkStealingPoolStats stats() const;
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<int> tasks;
+  };
+
+  void WorkerLoop(int worker);
+  // Runs one task of the current job, taken from |worker|'s queue or stolen.
+  // Returns false if no queue has a task left.
+  bool RunOne(int worker);
+  bool Pop(int queue_index, bool front, int *task);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+
+  // Serializes ParallelFor() calls.
+  std::mutex job_mutex_;
+  // Only changes while no task of the previous job is left, so a thread that
+  // took a task can read it without a lock.
+  const std::function<void(int)> *task_ = nullptr;
+  std::atomic<int> remaining_{0};
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  uint64_t generation_ = 0;
+  bool stop_ = false;
+
+  std::atomic<uint64_t> jobs_{0};
+  std::atomic<uint64_t> tasks_{0};
+  std::atomic<uint64_t> steals_{0};
+};
+
+// Splits |height| rows into bands of whole |row_alignment| row groups, at least
+// |min_band_rows| high, and runs |band|(first_row, end_row) for each on |pool|.
+// A few bands per thread leave room for stealing. Without a pool, or if the
+// frame makes a single band, |band| runs once inline for the whole frame.
+void ForEachRowBand(WorkStealingPool *pool,
+                    int height,
+                    int row_alignment,
+                    int min_band_rows,
+                    const std::function<void(int, int)> &band);
+
+}  // namespace custom
+
+#endif /* WorkStealingPool_h */
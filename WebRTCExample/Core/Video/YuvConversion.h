@@ -0,0 +1,229 @@
+//
+//  YuvConversion.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/18.
+//
+
+#ifndef YuvConversion_h
+#define YuvConversion_h
+
+#include <cstdint>
+
+namespace custom {
+
+// RGB -> YUV coefficients in 8 bit fixed point (value / 256), the form libyuv
+// uses. The same numbers feed the CPU kernels and, scaled to floats, the
+// shaders, so both paths produce the same output.
+struct RgbToYuvCoefficients {
+  int yr, yg, yb;
+  int ur, ug, ub;
+  int vr, vg, vb;
+  int y_offset;
+  int uv_offset;
+};
+
+// BT.601 video range, identical to libyuv's RGBToY/RGBToU/RGBToV.
+constexpr RgbToYuvCoefficients kBT601VideoRange = {
+    66, 129, 25,
+    -38, -74, 112,
+    112, -94, -18,
+    16, 128,
+};
+
+constexpr int RgbToY(const RgbToYuvCoefficients &c, int r, int g, int b) {
+  return (c.yr * r + c.yg * g + c.yb * b + (c.y_offset << 8) + 0x80) >> 8;
+}
+
+constexpr int RgbToU(const RgbToYuvCoefficients &c, int r, int g, int b) {
+  return (c.ur * r + c.ug * g + c.ub * b + (c.uv_offset << 8) + 0x80) >> 8;
+}
+
+constexpr int RgbToV(const RgbToYuvCoefficients &c, int r, int g, int b) {
+  return (c.vr * r + c.vg * g + c.vb * b + (c.uv_offset << 8) + 0x80) >> 8;
+}
+
+// Pin the coefficients: libyuv adds 0x1080 / 0x8080 before the shift.
+static_assert(RgbToY(kBT601VideoRange, 0, 0, 0) == 16, "BT.601 black");
+static_assert(RgbToY(kBT601VideoRange, 255, 255, 255) == 235, "BT.601 white");
+static_assert(RgbToU(kBT601VideoRange, 255, 255, 255) == 128, "BT.601 neutral U");
+static_assert(RgbToV(kBT601VideoRange, 255, 255, 255) == 128, "BT.601 neutral V");
+static_assert(RgbToU(kBT601VideoRange, 0, 0, 255) == 240, "BT.601 blue U");
+static_assert(RgbToV(kBT601VideoRange, 255, 0, 0) == 240, "BT.601 red V");
+static_assert(RgbToY(kBT601VideoRange, 255, 0, 0) == 82 && RgbToY(kBT601VideoRange, 0, 255, 0) == 144 &&
+                  RgbToY(kBT601VideoRange, 0, 0, 255) == 41,
+              "BT.601 primaries");
+
+enum class YuvMatrix {
+  kBT601,
+  kBT709,
+  kBT2020,
+};
+
+enum class YuvRange {
+  // Y in [16, 235], chroma in [16, 240].
+  kVideo,
+  // Y and chroma in [0, 255].
+  kFull,
+};
+
+namespace internal {
+
+constexpr int RoundToInt(double value) {
+  return static_cast<int>(value < 0 ? value - 0.5 : value + 0.5);
+}
+
+}  // namespace internal
+
+// Derives the fixed point coefficients of a matrix from its luma weights |kr|
+// and |kb| the way libyuv's tables are built: the R and B terms are rounded and
+// G takes the remainder, so white lands exactly on the top of the range and
+// grays get neutral chroma. Full range chroma reaches 255.5 for saturated
+// blue and red; kernels must clamp.
+constexpr RgbToYuvCoefficients MakeRgbToYuvCoefficients(double kr, double kb, YuvRange range) {
+  const double y_scale = (range == YuvRange::kVideo) ? 219.0 / 255.0 : 1.0;
+  const double c_scale = (range == YuvRange::kVideo) ? 224.0 / 255.0 : 1.0;
+  const int y_total = internal::RoundToInt(256 * y_scale);
+  const int c_total = internal::RoundToInt(128 * c_scale);
+  const int yr = internal::RoundToInt(256 * y_scale * kr);
+  const int yb = internal::RoundToInt(256 * y_scale * kb);
+  const int ur = internal::RoundToInt(-256 * c_scale * kr / (2 * (1 - kb)));
+  const int vb = internal::RoundToInt(-256 * c_scale * kb / (2 * (1 - kr)));
+  return RgbToYuvCoefficients{
+      yr, y_total - yr - yb, yb,
+      ur, -c_total - ur, c_total,
+      c_total, -c_total - vb, vb,
+      range == YuvRange::kVideo ? 16 : 0, 128,
+  };
+}
+
+// YUV -> RGB in 12 bit fixed point, for the kernels going back to BGRA:
+//   R = (y_scale * (Y - y_offset) + vr * (V - 128) + 2048) >> 12
+//   G = (y_scale * (Y - y_offset) - ug * (U - 128) - vg * (V - 128) + 2048) >> 12
+//   B = (y_scale * (Y - y_offset) + ub * (U - 128) + 2048) >> 12
+struct YuvToRgbCoefficients {
+  int y_scale;
+  int vr;
+  int ug;
+  int vg;
+  int ub;
+  int y_offset;
+};
+
+constexpr YuvToRgbCoefficients MakeYuvToRgbCoefficients(double kr, double kb, YuvRange range) {
+  const double kg = 1 - kr - kb;
+  const double y_scale = (range == YuvRange::kVideo) ? 255.0 / 219.0 : 1.0;
+  const double c_scale = (range == YuvRange::kVideo) ? 255.0 / 224.0 : 1.0;
+  return YuvToRgbCoefficients{
+      internal::RoundToInt(4096 * y_scale),
+      internal::RoundToInt(4096 * c_scale * 2 * (1 - kr)),
+      internal::RoundToInt(4096 * c_scale * 2 * kb * (1 - kb) / kg),
+      internal::RoundToInt(4096 * c_scale * 2 * kr * (1 - kr) / kg),
+      internal::RoundToInt(4096 * c_scale * 2 * (1 - kb)),
+      range == YuvRange::kVideo ? 16 : 0,
+  };
+}
+
+// Luma weights (kr, kb) of each matrix.
+constexpr double kMatrixKr[] = {0.299, 0.2126, 0.2627};
+constexpr double kMatrixKb[] = {0.114, 0.0722, 0.0593};
+
+constexpr RgbToYuvCoefficients RgbToYuvCoefficientsFor(YuvMatrix matrix, YuvRange range) {
+  return MakeRgbToYuvCoefficients(kMatrixKr[static_cast<int>(matrix)], kMatrixKb[static_cast<int>(matrix)], range);
+}
+
+constexpr YuvToRgbCoefficients YuvToRgbCoefficientsFor(YuvMatrix matrix, YuvRange range) {
+  return MakeYuvToRgbCoefficients(kMatrixKr[static_cast<int>(matrix)], kMatrixKb[static_cast<int>(matrix)], range);
+}
+
+constexpr bool operator==(const RgbToYuvCoefficients &a, const RgbToYuvCoefficients &b) {
+  return a.yr == b.yr && a.yg == b.yg && a.yb == b.yb && a.ur == b.ur && a.ug == b.ug && a.ub == b.ub &&
+         a.vr == b.vr && a.vg == b.vg && a.vb == b.vb && a.y_offset == b.y_offset && a.uv_offset == b.uv_offset;
+}
+
+// The derivation reproduces libyuv's BT.601 table.
+static_assert(RgbToYuvCoefficientsFor(YuvMatrix::kBT601, YuvRange::kVideo) == kBT601VideoRange,
+              "BT.601 video range derivation");
+static_assert(RgbToY(RgbToYuvCoefficientsFor(YuvMatrix::kBT709, YuvRange::kFull), 255, 255, 255) == 255,
+              "Full range white");
+static_assert(RgbToU(RgbToYuvCoefficientsFor(YuvMatrix::kBT2020, YuvRange::kVideo), 128, 128, 128) == 128,
+              "Neutral gray");
+
+// Float form for shaders working on normalized [0, 1] values. The offsets are
+// chosen so that rounding to 8 bits on store gives the same value as the fixed
+// point formula above: y = (66r + 129g + 25b) / 256 + 16 / 255. The fixed point
+// formula rounds halves up, which float error would turn into a coin flip, so
+// the offsets carry a bias of a quarter of the 1/256 step between results.
+struct ShaderYuvMatrix {
+  float y[3];
+  float u[3];
+  float v[3];
+  float offset[3];
+};
+
+inline ShaderYuvMatrix MakeShaderYuvMatrix(const RgbToYuvCoefficients &c) {
+  ShaderYuvMatrix m;
+  m.y[0] = c.yr / 256.0f;
+  m.y[1] = c.yg / 256.0f;
+  m.y[2] = c.yb / 256.0f;
+  m.u[0] = c.ur / 256.0f;
+  m.u[1] = c.ug / 256.0f;
+  m.u[2] = c.ub / 256.0f;
+  m.v[0] = c.vr / 256.0f;
+  m.v[1] = c.vg / 256.0f;
+  m.v[2] = c.vb / 256.0f;
+  const float tie_bias = 1.0f / 1024.0f;
+  m.offset[0] = (c.y_offset + tie_bias) / 255.0f;
+  m.offset[1] = (c.uv_offset + tie_bias) / 255.0f;
+  m.offset[2] = (c.uv_offset + tie_bias) / 255.0f;
+  return m;
+}
+
+// Where a 4:2:0 chroma sample sits relative to its 2x2 luma block.
+enum class ChromaSiting {
+  // Centre of the block, a plain 2x2 box filter. JPEG and libyuv.
+  kCenter,
+  // Co-sited with the left luma column, between the two rows. MPEG-2, H.264.
+  kLeft,
+};
+
+constexpr int kChromaTapCount = 4;
+
+// One bilinear tap of the chroma downsampling filter. |x| and |y| are in luma
+// pixels relative to the centre of the 2x2 block, x to the right and y down
+// in memory order; |weight| sums to 1 over all taps.
+struct ChromaTap {
+  float x;
+  float y;
+  float weight;
+};
+
+// Shaders take the taps as a flat vec3 array.
+static_assert(sizeof(ChromaTap) == 3 * sizeof(float), "ChromaTap must be tightly packed");
+
+// Fills |taps| with the filter for |siting|. kLeft applies [1 2 1] / 4
+// horizontally around the left column; the two taps left of the centre are
+// merged into one bilinear fetch between them.
+inline void ComputeChromaTaps(ChromaSiting siting, ChromaTap taps[kChromaTapCount]) {
+  switch (siting) {
+    case ChromaSiting::kCenter:
+      taps[0] = {-0.5f, -0.5f, 0.25f};
+      taps[1] = {0.5f, -0.5f, 0.25f};
+      taps[2] = {-0.5f, 0.5f, 0.25f};
+      taps[3] = {0.5f, 0.5f, 0.25f};
+      break;
+    case ChromaSiting::kLeft: {
+      // Texels at -1.5 (weight 1/4) and -0.5 (weight 1/2) as one fetch.
+      const float merged_x = (-1.5f * 0.25f + -0.5f * 0.5f) / 0.75f;
+      taps[0] = {merged_x, -0.5f, 0.375f};
+      taps[1] = {0.5f, -0.5f, 0.125f};
+      taps[2] = {merged_x, 0.5f, 0.375f};
+      taps[3] = {0.5f, 0.5f, 0.125f};
+      break;
+    }
+  }
+}
+
+}  // namespace custom
+
+#endif /* YuvConversion_h */
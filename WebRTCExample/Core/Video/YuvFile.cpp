@@ -0,0 +1,441 @@
+//
+//  YuvFile.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/8.
+//
+
+#include "YuvFile.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace custom {
+
+namespace {
+
+const char kY4MMagic[] = "YUV4MPEG2";
+const char kY4MFrame[] = "FRAME";
+// Longest header line accepted, a guard against files that are not Y4M.
+constexpr size_t kMaxY4MLine = 4096;
+// O_DIRECT wants buffers, sizes and file offsets aligned to the logical block
+// size; 4 KiB covers every current device.
+constexpr size_t kDirectAlignment = 4096;
+
+bool IsNV12(uint32_t format) {
+  return format == kFourccNV12FullRange || format == kFourccNV12VideoRange;
+}
+
+void SetError(std::string *error, const std::string &message) {
+  if (error) {
+    *error = message;
+  }
+}
+
+// The line starting at |offset| without its '\n', or false if there is no
+// '\n' within kMaxY4MLine bytes.
+bool LineAt(const uint8_t *data, size_t size, size_t offset, std::string *line, size_t *next) {
+  const size_t end = std::min(size, offset + kMaxY4MLine);
+  const void *newline = memchr(data + offset, '\n', end - offset);
+  if (!newline) {
+    return false;
+  }
+  const size_t length = static_cast<const uint8_t *>(newline) - (data + offset);
+  line->assign(reinterpret_cast<const char *>(data + offset), length);
+  *next = offset + length + 1;
+  return true;
+}
+
+// Parses "YUV4MPEG2 W.. H.. F..:.. C.." into |info|; only 8 bit 4:2:0 is
+// supported, interlacing, aspect and extension tags are ignored.
+bool ParseY4MHeader(const std::string &header, YuvFileInfo *info, std::string *error) {
+  if (header.compare(0, sizeof(kY4MMagic) - 1, kY4MMagic) != 0) {
+    SetError(error, "not a Y4M file");
+    return false;
+  }
+  info->format = kFourccI420;
+  size_t pos = sizeof(kY4MMagic) - 1;
+  while (pos < header.size()) {
+    const size_t end = std::min(header.find(' ', pos + 1), header.size());
+    const std::string tag = header.substr(pos + 1, end - pos - 1);
+    pos = end;
+    if (tag.empty()) {
+      continue;
+    }
+    const char *value = tag.c_str() + 1;
+    switch (tag[0]) {
+      case 'W':
+        info->width = atoi(value);
+        break;
+      case 'H':
+        info->height = atoi(value);
+        break;
+      case 'F':
+        if (sscanf(value, "%d:%d", &info->fps_num, &info->fps_den) != 2 || info->fps_num <= 0 || info->fps_den <= 0) {
+          SetError(error, "bad frame rate " + tag);
+          return false;
+        }
+        break;
+      case 'C':
+        if (strncmp(value, "420", 3) != 0 || strcmp(value, "420p10") == 0 || strcmp(value, "420p12") == 0) {
+          SetError(error, "unsupported colorspace " + tag + ", only 8 bit 4:2:0 is");
+          return false;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  if (info->width <= 0 || info->height <= 0) {
+    SetError(error, "missing frame size");
+    return false;
+  }
+  return true;
+}
+
+// Writes |size| bytes, retrying short writes; |done| counts the bytes written
+// before a failure.
+bool WriteAll(int fd, const uint8_t *data, size_t size, size_t *done) {
+  while (*done < size) {
+    const ssize_t written = write(fd, data + *done, size - *done);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    *done += static_cast<size_t>(written);
+  }
+  return true;
+}
+
+// Turns page cache bypassing off for the rest of the file.
+void DisableDirectIo(int fd) {
+#if defined(__APPLE__)
+  fcntl(fd, F_NOCACHE, 0);
+#elif defined(O_DIRECT)
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+#else
+  (void)fd;
+#endif
+}
+
+}  // namespace
+
+size_t YuvFileFrameSize(const YuvFileInfo &info) {
+  if (info.width <= 0 || info.height <= 0 || (!IsNV12(info.format) && info.format != kFourccI420)) {
+    return 0;
+  }
+  const size_t chroma = static_cast<size_t>(ChromaSize420(info.width)) * ChromaSize420(info.height);
+  return static_cast<size_t>(info.width) * info.height + 2 * chroma;
+}
+
+bool IsY4MPath(const std::string &path) {
+  static const char kSuffix[] = ".y4m";
+  const size_t length = sizeof(kSuffix) - 1;
+  return path.size() >= length && path.compare(path.size() - length, length, kSuffix) == 0;
+}
+
+PlaneSource YuvFrameView::Plane(int index) const {
+  PlaneSource plane;
+  if (index < 0 || index >= plane_count()) {
+    return plane;
+  }
+  plane.data = image.planes[index];
+  plane.width = index == 0 ? image.width : ChromaSize420(image.width);
+  plane.height = index == 0 ? image.height : ChromaSize420(image.height);
+  plane.stride = image.strides[index];
+  plane.bytes_per_sample = (index == 1 && IsNV12(image.format)) ? 2 : 1;
+  return plane;
+}
+
+YuvFileReader::~YuvFileReader() {
+  Close();
+}
+
+bool YuvFileReader::Open(const std::string &path, const YuvFileInfo &raw_info, std::string *error) {
+  Close();
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    SetError(error, "can't open " + path + ": " + strerror(errno));
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    close(fd);
+    SetError(error, path + " is not a regular, non empty file");
+    return false;
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  // Private and writable: frames can be modified in place without touching
+  // the file, pages are only copied once written to.
+  void *data = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    size_ = 0;
+    SetError(error, "can't map " + path + ": " + strerror(errno));
+    return false;
+  }
+  data_ = static_cast<uint8_t *>(data);
+
+  size_t offset = 0;
+  const bool y4m = IsY4MPath(path);
+  if (y4m) {
+    std::string header;
+    if (!LineAt(data_, size_, 0, &header, &offset)) {
+      SetError(error, "truncated Y4M header");
+      Close();
+      return false;
+    }
+    if (!ParseY4MHeader(header, &info_, error)) {
+      Close();
+      return false;
+    }
+  } else {
+    info_ = raw_info;
+  }
+  info_.frame_size = YuvFileFrameSize(info_);
+  if (info_.frame_size == 0) {
+    SetError(error, "raw input needs a frame size and a 4:2:0 format");
+    Close();
+    return false;
+  }
+
+  if (!y4m) {
+    offsets_.resize(size_ / info_.frame_size);
+    for (size_t i = 0; i < offsets_.size(); ++i) {
+      offsets_[i] = i * info_.frame_size;
+    }
+  } else {
+    // Frame headers may carry parameters, so their length is found by walking
+    // them. Only the headers' pages are touched, without read ahead.
+    madvise(data_, size_, MADV_RANDOM);
+    std::string line;
+    size_t payload = 0;
+    while (offset < size_ && LineAt(data_, size_, offset, &line, &payload) &&
+           line.compare(0, sizeof(kY4MFrame) - 1, kY4MFrame) == 0 && size_ - payload >= info_.frame_size) {
+      offsets_.push_back(payload);
+      offset = payload + info_.frame_size;
+    }
+  }
+  madvise(data_, size_, MADV_SEQUENTIAL);
+  return true;
+}
+
+void YuvFileReader::Close() {
+  if (data_) {
+    munmap(data_, size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  info_ = YuvFileInfo();
+  offsets_.clear();
+  next_ = 0;
+}
+
+bool YuvFileReader::Frame(int64_t index, YuvFrameView *view) const {
+  if (index < 0 || index >= frame_count()) {
+    return false;
+  }
+  uint8_t *frame = data_ + offsets_[index];
+  const int chroma_width = ChromaSize420(info_.width);
+  const int chroma_height = ChromaSize420(info_.height);
+  view->index = index;
+  view->image = Yuv420Image();
+  view->image.format = info_.format;
+  view->image.width = info_.width;
+  view->image.height = info_.height;
+  view->image.planes[0] = frame;
+  view->image.strides[0] = info_.width;
+  view->image.planes[1] = frame + static_cast<size_t>(info_.width) * info_.height;
+  if (IsNV12(info_.format)) {
+    view->image.strides[1] = 2 * chroma_width;
+  } else {
+    view->image.strides[1] = chroma_width;
+    view->image.planes[2] = view->image.planes[1] + static_cast<size_t>(chroma_width) * chroma_height;
+    view->image.strides[2] = chroma_width;
+  }
+  return true;
+}
+
+bool YuvFileReader::Next(YuvFrameView *view) {
+  if (!Frame(next_, view)) {
+    return false;
+  }
+  ++next_;
+  if (next_ < frame_count()) {
+    // MADV_SEQUENTIAL only doubles the kernel's read ahead; asking for the
+    // whole next frame keeps the disk busy while this one is processed.
+    static const size_t kPageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t begin = offsets_[next_] / kPageSize * kPageSize;
+    madvise(data_ + begin, offsets_[next_] + info_.frame_size - begin, MADV_WILLNEED);
+  }
+  return true;
+}
+
+YuvFileWriter::~YuvFileWriter() {
+  Close();
+}
+
+bool YuvFileWriter::Open(const std::string &path,
+                         const YuvFileInfo &info,
+                         const YuvFileWriterConfig &config,
+                         std::string *error) {
+  Close();
+  info_ = info;
+  info_.frame_size = YuvFileFrameSize(info_);
+  if (info_.frame_size == 0) {
+    SetError(error, "output needs a frame size and a 4:2:0 format");
+    return false;
+  }
+  failed_ = false;
+  direct_io_ = false;
+  bytes_written_ = 0;
+  if (path == "-") {
+    fd_ = STDOUT_FILENO;
+    owns_fd_ = false;
+  } else {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#if defined(O_DIRECT) && !defined(__APPLE__)
+    if (config.direct_io) {
+      fd_ = open(path.c_str(), flags | O_DIRECT, 0644);
+      direct_io_ = fd_ >= 0;
+    }
+#endif
+    if (fd_ < 0) {
+      fd_ = open(path.c_str(), flags, 0644);
+    }
+    if (fd_ < 0) {
+      SetError(error, "can't create " + path + ": " + strerror(errno));
+      return false;
+    }
+    owns_fd_ = true;
+#if defined(__APPLE__)
+    if (config.direct_io) {
+      direct_io_ = fcntl(fd_, F_NOCACHE, 1) == 0;
+    }
+#endif
+  }
+
+  capacity_ = (std::max<size_t>(config.buffer_bytes, 1) + kDirectAlignment - 1) / kDirectAlignment * kDirectAlignment;
+  buffer_ = static_cast<uint8_t *>(::operator new(capacity_, std::align_val_t(kDirectAlignment)));
+  used_ = 0;
+  y4m_ = IsY4MPath(path);
+  if (y4m_) {
+    char header[256];
+    const int length =
+        snprintf(header, sizeof(header), "%s W%d H%d F%d:%d Ip A1:1 %s\n", kY4MMagic, info_.width, info_.height,
+                 info_.fps_num, info_.fps_den,
+                 info_.format == kFourccNV12FullRange ? "C420jpeg XCOLORRANGE=FULL" : "C420jpeg");
+    Append(reinterpret_cast<const uint8_t *>(header), static_cast<size_t>(length));
+  }
+  return true;
+}
+
+bool YuvFileWriter::WriteFrame(const Yuv420Image &image) {
+  if (fd_ < 0 || failed_ || image.width != info_.width || image.height != info_.height ||
+      !IsValidYuv420Image(image)) {
+    return false;
+  }
+  if (y4m_) {
+    static const char kFrameLine[] = "FRAME\n";
+    Append(reinterpret_cast<const uint8_t *>(kFrameLine), sizeof(kFrameLine) - 1);
+  }
+  const int chroma_width = ChromaSize420(image.width);
+  const int chroma_height = ChromaSize420(image.height);
+  for (int y = 0; y < image.height; ++y) {
+    Append(image.planes[0] + static_cast<size_t>(y) * image.strides[0], image.width);
+  }
+  if (!IsNV12(image.format)) {
+    for (int plane = 1; plane < 3; ++plane) {
+      for (int y = 0; y < chroma_height; ++y) {
+        Append(image.planes[plane] + static_cast<size_t>(y) * image.strides[plane], chroma_width);
+      }
+    }
+  } else if (!y4m_) {
+    for (int y = 0; y < chroma_height; ++y) {
+      Append(image.planes[1] + static_cast<size_t>(y) * image.strides[1], 2 * static_cast<size_t>(chroma_width));
+    }
+  } else {
+    // Y4M is planar: U rows, then V rows.
+    row_.resize(chroma_width);
+    for (int component = 0; component < 2; ++component) {
+      for (int y = 0; y < chroma_height; ++y) {
+        const uint8_t *uv = image.planes[1] + static_cast<size_t>(y) * image.strides[1];
+        for (int x = 0; x < chroma_width; ++x) {
+          row_[x] = uv[2 * x + component];
+        }
+        Append(row_.data(), row_.size());
+      }
+    }
+  }
+  return !failed_;
+}
+
+bool YuvFileWriter::Close() {
+  if (fd_ < 0) {
+    return true;
+  }
+  Flush(true);
+  if (owns_fd_ && close(fd_) != 0) {
+    failed_ = true;
+  }
+  fd_ = -1;
+  ::operator delete(buffer_, std::align_val_t(kDirectAlignment));
+  buffer_ = nullptr;
+  capacity_ = 0;
+  used_ = 0;
+  return !failed_;
+}
+
+bool YuvFileWriter::Append(const uint8_t *data, size_t size) {
+  while (size > 0 && !failed_) {
+    const size_t chunk = std::min(size, capacity_ - used_);
+    memcpy(buffer_ + used_, data, chunk);
+    used_ += chunk;
+    data += chunk;
+    size -= chunk;
+    if (used_ == capacity_) {
+      Flush(false);
+    }
+  }
+  return !failed_;
+}
+
+bool YuvFileWriter::Flush(bool final) {
+  if (used_ == 0 || failed_) {
+    return !failed_;
+  }
+  // Only the final write may end off the block alignment; it goes through the
+  // page cache.
+  if (direct_io_ && final && used_ % kDirectAlignment != 0) {
+    DisableDirectIo(fd_);
+    direct_io_ = false;
+  }
+  size_t done = 0;
+  bool success = WriteAll(fd_, buffer_, used_, &done);
+  if (!success && direct_io_ && errno == EINVAL) {
+    // The file system accepted O_DIRECT at open but not for this write.
+    DisableDirectIo(fd_);
+    direct_io_ = false;
+    success = WriteAll(fd_, buffer_, used_, &done);
+  }
+  if (!success) {
+    failed_ = true;
+    return false;
+  }
+  bytes_written_ += used_;
+  used_ = 0;
+  return true;
+}
+
+}  // namespace custom
@@ -0,0 +1,144 @@
+//
+//  YuvFile.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/8.
+//
+
+#ifndef YuvFile_h
+#define YuvFile_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PlaneGeometry.h"
+#include "YuvFilter.h"
+
+namespace custom {
+
+// A sequence of 4:2:0 frames on disk: Y4M (8 bit, always planar) or headerless
+// I420/NV12 with packed rows.
+struct YuvFileInfo {
+  int width = 0;
+  int height = 0;
+  // kFourccI420 or one of the NV12 fourccs. Y4M is always kFourccI420.
+  uint32_t format = 0;
+  int fps_num = 30;
+  int fps_den = 1;
+  // Payload bytes of one frame, without the Y4M frame header.
+  size_t frame_size = 0;
+};
+
+// Payload bytes of one packed frame of |info|'s size and format, 0 if the
+// format is not 4:2:0.
+size_t YuvFileFrameSize(const YuvFileInfo &info);
+
+// Whether |path| names a Y4M file.
+bool IsY4MPath(const std::string &path);
+
+// One frame of a YuvFileReader, in place in the mapped file.
+struct YuvFrameView {
+  int64_t index = -1;
+  // Planes point into the mapping and stay valid until the reader is closed.
+  // The mapping is private: writing to them, e.g. filtering in place, never
+  // reaches the file.
+  Yuv420Image image;
+
+  int plane_count() const { return image.format == kFourccI420 ? 3 : 2; }
+  // Plane |index| as CustomI420TextureCache and PlanPlaneUpload() take it; the
+  // NV12 chroma plane has two bytes per sample.
+  PlaneSource Plane(int index) const;
+};
+
+// Memory maps a Y4M or raw file and hands out its frames without copying. The
+// frames are indexed when the file is opened, so Frame() seeks in constant
+// time; Next() reads sequentially and asks the kernel to read ahead of it.
+// A truncated last frame is ignored. Not thread safe, but views may be read
+// from any thread while the reader is open.
+class YuvFileReader {
+ public:
+  YuvFileReader() = default;
+  ~YuvFileReader();
+  YuvFileReader(const YuvFileReader &) = delete;
+  YuvFileReader &operator=(const YuvFileReader &) = delete;
+
+  // A path ending in .y4m is parsed for its header; anything else is raw and
+  // described by |raw_info|, whose frame_size is ignored. |path| must be a
+  // regular file, pipes can't be mapped. |error| may be null.
+  bool Open(const std::string &path, const YuvFileInfo &raw_info, std::string *error);
+  void Close();
+
+  const YuvFileInfo &info() const { return info_; }
+  int64_t frame_count() const { return static_cast<int64_t>(offsets_.size()); }
+
+  // Frame |index|; false past the end.
+  bool Frame(int64_t index, YuvFrameView *view) const;
+  // The frame after the one Next() returned last, the first one to begin with.
+  bool Next(YuvFrameView *view);
+  // Makes Next() start over at |index|.
+  void Seek(int64_t index) { next_ = index; }
+
+ private:
+  uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  YuvFileInfo info_;
+  std::vector<size_t> offsets_;
+  int64_t next_ = 0;
+};
+
+struct YuvFileWriterConfig {
+  // Frames are gathered into a buffer of this size, rounded up to 4 KiB, and
+  // written with one write() each time it fills.
+  size_t buffer_bytes = 8 << 20;
+  // Bypasses the page cache: O_DIRECT on Linux, F_NOCACHE on Apple platforms.
+  // Falls back to cached writes where the file system refuses it.
+  bool direct_io = false;
+};
+
+// Writes frames as Y4M, interleaved NV12 chroma split into planes, or raw in
+// the frames' own format. Rows are packed; source strides may be anything.
+class YuvFileWriter {
+ public:
+  YuvFileWriter() = default;
+  ~YuvFileWriter();
+  YuvFileWriter(const YuvFileWriter &) = delete;
+  YuvFileWriter &operator=(const YuvFileWriter &) = delete;
+
+  // A path ending in .y4m gets a Y4M header from |info|, full range NV12 tagged
+  // XCOLORRANGE=FULL. "-" writes to stdout, always cached. |error| may be null.
+  bool Open(const std::string &path,
+            const YuvFileInfo &info,
+            const YuvFileWriterConfig &config,
+            std::string *error);
+  // |image| must have the size of |info|.
+  bool WriteFrame(const Yuv420Image &image);
+  // Writes what is buffered and closes the file. Returns false if any write
+  // failed.
+  bool Close();
+
+  uint64_t bytes_written() const { return bytes_written_; }
+  // Whether the page cache is actually bypassed.
+  bool direct_io() const { return direct_io_; }
+
+ private:
+  bool Append(const uint8_t *data, size_t size);
+  bool Flush(bool final);
+
+  int fd_ = -1;
+  bool owns_fd_ = false;
+  bool y4m_ = false;
+  bool direct_io_ = false;
+  bool failed_ = false;
+  YuvFileInfo info_;
+  uint8_t *buffer_ = nullptr;
+  size_t capacity_ = 0;
+  size_t used_ = 0;
+  uint64_t bytes_written_ = 0;
+  std::vector<uint8_t> row_;
+};
+
+}  // namespace custom
+
+#endif /* YuvFile_h */
@@ -0,0 +1,805 @@
+//
+//  YuvFilter.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/24.
+//
+
+#include "YuvFilter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "YuvConversion.h"
+
+#if defined(CUSTOM_ARCH_X86)
+#include <immintrin.h>
+#elif defined(CUSTOM_ARCH_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace custom {
+
+YuvFilter YuvFilter::Identity() {
+  return YuvFilter();
+}
+
+YuvFilter YuvFilter::Grayscale() {
+  const float third = 1.0f / 3.0f;
+  const float matrix[9] = {third, third, third, third, third, third, third, third, third};
+  const float offset[3] = {0, 0, 0};
+  return ColorMatrix(matrix, offset);
+}
+
+YuvFilter YuvFilter::ColorMatrix(const float matrix[9], const float offset[3]) {
+  YuvFilter filter;
+  memcpy(filter.matrix, matrix, sizeof(filter.matrix));
+  memcpy(filter.offset, offset, sizeof(filter.offset));
+  return filter;
+}
+
+YuvFilter YuvFilter::BrightnessContrast(float brightness, float contrast) {
+  const float matrix[9] = {contrast, 0, 0, 0, contrast, 0, 0, 0, contrast};
+  const float bias = 0.5f - 0.5f * contrast + brightness;
+  const float offset[3] = {bias, bias, bias};
+  return ColorMatrix(matrix, offset);
+}
+
+YuvFilter YuvFilter::Lut(const uint8_t lut[256]) {
+  return Lut(lut, lut, lut);
+}
+
+YuvFilter YuvFilter::Lut(const uint8_t red[256], const uint8_t green[256], const uint8_t blue[256]) {
+  YuvFilter filter;
+  filter.has_lut = true;
+  memcpy(filter.lut[0], red, 256);
+  memcpy(filter.lut[1], green, 256);
+  memcpy(filter.lut[2], blue, 256);
+  return filter;
+}
+
+namespace {
+
+bool IsIdentityAffine(const YuvFilter &filter) {
+  const YuvFilter identity;
+  return memcmp(filter.matrix, identity.matrix, sizeof(filter.matrix)) == 0 &&
+         memcmp(filter.offset, identity.offset, sizeof(filter.offset)) == 0;
+}
+
+}  // namespace
+
+bool ComposeYuvFilters(const YuvFilter &first, const YuvFilter &second, YuvFilter *composed) {
+  if (first.has_lut && !IsIdentityAffine(second)) {
+    return false;
+  }
+  YuvFilter result;
+  // second.matrix * (first.matrix * rgb + first.offset) + second.offset
+  for (int row = 0; row < 3; ++row) {
+    for (int col = 0; col < 3; ++col) {
+      float sum = 0;
+      for (int k = 0; k < 3; ++k) {
+        sum += second.matrix[row * 3 + k] * first.matrix[k * 3 + col];
+      }
+      result.matrix[row * 3 + col] = sum;
+    }
+    float offset = second.offset[row];
+    for (int k = 0; k < 3; ++k) {
+      offset += second.matrix[row * 3 + k] * first.offset[k];
+    }
+    result.offset[row] = offset;
+  }
+  result.has_lut = first.has_lut || second.has_lut;
+  for (int channel = 0; channel < 3; ++channel) {
+    for (int i = 0; i < 256; ++i) {
+      uint8_t value = static_cast<uint8_t>(i);
+      if (first.has_lut) {
+        value = first.lut[channel][value];
+      }
+      if (second.has_lut) {
+        value = second.lut[channel][value];
+      }
+      result.lut[channel][i] = value;
+    }
+  }
+  *composed = result;
+  return true;
+}
+
+namespace {
+
+// The shader's YUV -> RGB matrix, see NV12_SAMPLE_RGB_SOURCE. Chroma is
+// centred on 0.5, i.e. 127.5 in 8 bit units.
+constexpr float kDecodeVR = 1.403f;
+constexpr float kDecodeUG = -0.344f;
+constexpr float kDecodeVG = -0.714f;
+constexpr float kDecodeUB = 1.770f;
+constexpr float kChromaCenter = 127.5f;
+
+// Everything a row kernel needs, in 8 bit units: the decode matrix and the
+// filter folded into one affine map from (y, u, v) to RGB, and the encode
+// coefficients with the rounding of the store added to the offsets.
+struct KernelParams {
+  float matrix[9];
+  float offset[3];
+  float y_coeffs[3];
+  float u_coeffs[3];
+  float v_coeffs[3];
+  float y_offset;
+  float uv_offset;
+  bool has_lut;
+  float lut[3][256];
+};
+
+void MakeKernelParams(const YuvFilter &filter, KernelParams *params) {
+  const float decode[9] = {
+      1.0f, 0.0f, kDecodeVR,
+      1.0f, kDecodeUG, kDecodeVG,
+      1.0f, kDecodeUB, 0.0f,
+  };
+  for (int row = 0; row < 3; ++row) {
+    for (int col = 0; col < 3; ++col) {
+      float sum = 0;
+      for (int k = 0; k < 3; ++k) {
+        sum += filter.matrix[row * 3 + k] * decode[k * 3 + col];
+      }
+      params->matrix[row * 3 + col] = sum;
+    }
+    // Move the chroma centre into the offset so kernels take raw samples.
+    params->offset[row] = filter.offset[row] * 255.0f -
+                          kChromaCenter * (params->matrix[row * 3 + 1] + params->matrix[row * 3 + 2]);
+  }
+  const RgbToYuvCoefficients &c = kBT601VideoRange;
+  const float y_coeffs[3] = {c.yr / 256.0f, c.yg / 256.0f, c.yb / 256.0f};
+  const float u_coeffs[3] = {c.ur / 256.0f, c.ug / 256.0f, c.ub / 256.0f};
+  const float v_coeffs[3] = {c.vr / 256.0f, c.vg / 256.0f, c.vb / 256.0f};
+  memcpy(params->y_coeffs, y_coeffs, sizeof(y_coeffs));
+  memcpy(params->u_coeffs, u_coeffs, sizeof(u_coeffs));
+  memcpy(params->v_coeffs, v_coeffs, sizeof(v_coeffs));
+  params->y_offset = c.y_offset + 0.5f;
+  params->uv_offset = c.uv_offset + 0.5f;
+  params->has_lut = filter.has_lut;
+  for (int channel = 0; channel < 3; ++channel) {
+    for (int i = 0; i < 256; ++i) {
+      params->lut[channel][i] = filter.lut[channel][i];
+    }
+  }
+}
+
+// Filters two luma rows into |dst_y0| and |dst_y1| and one row of chroma into
+// the packed |dst_u| and |dst_v|. |u0|, |v0|, |u1| and |v1| hold the chroma of
+// every luma pixel of the two rows. |y1| equals |y0| for the last row of an odd
+// height frame. Every pixel is read before it is written, so the luma rows may
+// be filtered in place.
+typedef void (*FilterRowPairFunc)(const KernelParams &params,
+                                  const uint8_t *y0,
+                                  const uint8_t *y1,
+                                  const uint8_t *u0,
+                                  const uint8_t *v0,
+                                  const uint8_t *u1,
+                                  const uint8_t *v1,
+                                  uint8_t *dst_y0,
+                                  uint8_t *dst_y1,
+                                  uint8_t *dst_u,
+                                  uint8_t *dst_v,
+                                  int width);
+
+inline void FilterPixel_C(const KernelParams &p, int y, int u, int v, float rgb[3]) {
+  for (int channel = 0; channel < 3; ++channel) {
+    const float *m = p.matrix + channel * 3;
+    float value = m[0] * y + m[1] * u + m[2] * v + p.offset[channel];
+    value = std::min(std::max(value, 0.0f), 255.0f);
+    if (p.has_lut) {
+      value = p.lut[channel][static_cast<int>(value + 0.5f)];
+    }
+    rgb[channel] = value;
+  }
+}
+
+inline uint8_t EncodeY_C(const KernelParams &p, const float rgb[3]) {
+  return static_cast<uint8_t>(p.y_coeffs[0] * rgb[0] + p.y_coeffs[1] * rgb[1] + p.y_coeffs[2] * rgb[2] + p.y_offset);
+}
+
+// |sum| is the sum of the 4 filtered pixels of a chroma block.
+inline void EncodeUV_C(const KernelParams &p, const float sum[3], uint8_t *u, uint8_t *v) {
+  const float r = sum[0] * 0.25f;
+  const float g = sum[1] * 0.25f;
+  const float b = sum[2] * 0.25f;
+  *u = static_cast<uint8_t>(p.u_coeffs[0] * r + p.u_coeffs[1] * g + p.u_coeffs[2] * b + p.uv_offset);
+  *v = static_cast<uint8_t>(p.v_coeffs[0] * r + p.v_coeffs[1] * g + p.v_coeffs[2] * b + p.uv_offset);
+}
+
+void FilterRowPairFrom_C(const KernelParams &p,
+                         const uint8_t *y0,
+                         const uint8_t *y1,
+                         const uint8_t *u0,
+                         const uint8_t *v0,
+                         const uint8_t *u1,
+                         const uint8_t *v1,
+                         uint8_t *dst_y0,
+                         uint8_t *dst_y1,
+                         uint8_t *dst_u,
+                         uint8_t *dst_v,
+                         int x,
+                         int width) {
+  for (; x < width; x += 2) {
+    // The last column of an odd width frame is its own neighbour, as with
+    // GL_CLAMP_TO_EDGE.
+    const int x1 = std::min(x + 1, width - 1);
+    float a0[3], a1[3], b0[3], b1[3];
+    FilterPixel_C(p, y0[x], u0[x], v0[x], a0);
+    FilterPixel_C(p, y0[x1], u0[x1], v0[x1], a1);
+    FilterPixel_C(p, y1[x], u1[x], v1[x], b0);
+    FilterPixel_C(p, y1[x1], u1[x1], v1[x1], b1);
+    dst_y0[x] = EncodeY_C(p, a0);
+    dst_y1[x] = EncodeY_C(p, b0);
+    if (x1 != x) {
+      dst_y0[x1] = EncodeY_C(p, a1);
+      dst_y1[x1] = EncodeY_C(p, b1);
+    }
+    const float sum[3] = {a0[0] + a1[0] + b0[0] + b1[0], a0[1] + a1[1] + b0[1] + b1[1],
+                          a0[2] + a1[2] + b0[2] + b1[2]};
+    EncodeUV_C(p, sum, dst_u + x / 2, dst_v + x / 2);
+  }
+}
+
+void FilterRowPair_C(const KernelParams &p,
+                     const uint8_t *y0,
+                     const uint8_t *y1,
+                     const uint8_t *u0,
+                     const uint8_t *v0,
+                     const uint8_t *u1,
+                     const uint8_t *v1,
+                     uint8_t *dst_y0,
+                     uint8_t *dst_y1,
+                     uint8_t *dst_u,
+                     uint8_t *dst_v,
+                     int width) {
+  FilterRowPairFrom_C(p, y0, y1, u0, v0, u1, v1, dst_y0, dst_y1, dst_u, dst_v, 0, width);
+}
+
+#if defined(CUSTOM_ARCH_X86)
+
+struct Rgb8_AVX2 {
+  __m256 r, g, b;
+};
+
+__attribute__((target("avx2"))) inline __m256 LoadFloat8_AVX2(const uint8_t *src) {
+  __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src));
+  return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+}
+
+__attribute__((target("avx2"))) inline __m256 Dot3_AVX2(const float *c, __m256 a, __m256 b, __m256 d, float offset) {
+  __m256 sum = _mm256_add_ps(_mm256_mul_ps(a, _mm256_set1_ps(c[0])), _mm256_set1_ps(offset));
+  sum = _mm256_add_ps(sum, _mm256_mul_ps(b, _mm256_set1_ps(c[1])));
+  return _mm256_add_ps(sum, _mm256_mul_ps(d, _mm256_set1_ps(c[2])));
+}
+
+__attribute__((target("avx2"))) inline __m256 FilterChannel_AVX2(const KernelParams &p,
+                                                                 int channel,
+                                                                 __m256 y,
+                                                                 __m256 u,
+                                                                 __m256 v) {
+  __m256 value = Dot3_AVX2(p.matrix + channel * 3, y, u, v, p.offset[channel]);
+  value = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+  if (p.has_lut) {
+    __m256i index = _mm256_cvttps_epi32(_mm256_add_ps(value, _mm256_set1_ps(0.5f)));
+    value = _mm256_i32gather_ps(p.lut[channel], index, 4);
+  }
+  return value;
+}
+
+__attribute__((target("avx2"))) inline Rgb8_AVX2 FilterPixels8_AVX2(const KernelParams &p,
+                                                                    const uint8_t *y,
+                                                                    const uint8_t *u,
+                                                                    const uint8_t *v) {
+  __m256 fy = LoadFloat8_AVX2(y);
+  __m256 fu = LoadFloat8_AVX2(u);
+  __m256 fv = LoadFloat8_AVX2(v);
+  return Rgb8_AVX2{FilterChannel_AVX2(p, 0, fy, fu, fv), FilterChannel_AVX2(p, 1, fy, fu, fv),
+                   FilterChannel_AVX2(p, 2, fy, fu, fv)};
+}
+
+// Truncates 8 non negative floats to bytes, saturating.
+__attribute__((target("avx2"))) inline __m128i PackBytes8_AVX2(__m256 value) {
+  __m256i ints = _mm256_cvttps_epi32(value);
+  __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(ints), _mm256_extracti128_si256(ints, 1));
+  return _mm_packus_epi16(words, words);
+}
+
+// Sums of the 2x2 blocks of |row0| and |row1| in the low 4 lanes.
+__attribute__((target("avx2"))) inline __m128 BlockSum4_AVX2(__m256 row0, __m256 row1) {
+  __m256 columns = _mm256_add_ps(row0, row1);
+  __m256 pairs = _mm256_hadd_ps(columns, columns);
+  return _mm256_castps256_ps128(_mm256_permutevar8x32_ps(pairs, _mm256_setr_epi32(0, 1, 4, 5, 0, 1, 4, 5)));
+}
+
+__attribute__((target("avx2"))) inline void StoreChroma4_AVX2(const float *c, float offset, __m128 r, __m128 g, __m128 b,
+                                                              uint8_t *dst) {
+  __m128 value = _mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(c[0] * 0.25f)), _mm_set1_ps(offset));
+  value = _mm_add_ps(value, _mm_mul_ps(g, _mm_set1_ps(c[1] * 0.25f)));
+  value = _mm_add_ps(value, _mm_mul_ps(b, _mm_set1_ps(c[2] * 0.25f)));
+  __m128i words = _mm_packus_epi32(_mm_cvttps_epi32(value), _mm_setzero_si128());
+  const int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+  memcpy(dst, &bytes, 4);
+}
+
+__attribute__((target("avx2"))) void FilterRowPair_AVX2(const KernelParams &p,
+                                                        const uint8_t *y0,
+                                                        const uint8_t *y1,
+                                                        const uint8_t *u0,
+                                                        const uint8_t *v0,
+                                                        const uint8_t *u1,
+                                                        const uint8_t *v1,
+                                                        uint8_t *dst_y0,
+                                                        uint8_t *dst_y1,
+                                                        uint8_t *dst_u,
+                                                        uint8_t *dst_v,
+                                                        int width) {
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    Rgb8_AVX2 a = FilterPixels8_AVX2(p, y0 + x, u0 + x, v0 + x);
+    Rgb8_AVX2 b = FilterPixels8_AVX2(p, y1 + x, u1 + x, v1 + x);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst_y0 + x), PackBytes8_AVX2(Dot3_AVX2(p.y_coeffs, a.r, a.g, a.b, p.y_offset)));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst_y1 + x), PackBytes8_AVX2(Dot3_AVX2(p.y_coeffs, b.r, b.g, b.b, p.y_offset)));
+    __m128 r = BlockSum4_AVX2(a.r, b.r);
+    __m128 g = BlockSum4_AVX2(a.g, b.g);
+    __m128 bl = BlockSum4_AVX2(a.b, b.b);
+    StoreChroma4_AVX2(p.u_coeffs, p.uv_offset, r, g, bl, dst_u + x / 2);
+    StoreChroma4_AVX2(p.v_coeffs, p.uv_offset, r, g, bl, dst_v + x / 2);
+  }
+  FilterRowPairFrom_C(p, y0, y1, u0, v0, u1, v1, dst_y0, dst_y1, dst_u, dst_v, x, width);
+}
+
+#endif  // CUSTOM_ARCH_X86
+
+#if defined(CUSTOM_ARCH_NEON)
+
+// 8 pixels as two quads.
+struct Float8_NEON {
+  float32x4_t lo, hi;
+};
+
+struct Rgb8_NEON {
+  Float8_NEON r, g, b;
+};
+
+inline Float8_NEON LoadFloat8_NEON(const uint8_t *src) {
+  uint16x8_t words = vmovl_u8(vld1_u8(src));
+  return Float8_NEON{vcvtq_f32_u32(vmovl_u16(vget_low_u16(words))), vcvtq_f32_u32(vmovl_u16(vget_high_u16(words)))};
+}
+
+inline float32x4_t Dot3_NEON(const float *c, float32x4_t a, float32x4_t b, float32x4_t d, float offset) {
+  float32x4_t sum = vmlaq_n_f32(vdupq_n_f32(offset), a, c[0]);
+  sum = vmlaq_n_f32(sum, b, c[1]);
+  return vmlaq_n_f32(sum, d, c[2]);
+}
+
+inline float32x4_t FilterChannel_NEON(const KernelParams &p,
+                                      int channel,
+                                      float32x4_t y,
+                                      float32x4_t u,
+                                      float32x4_t v) {
+  float32x4_t value = Dot3_NEON(p.matrix + channel * 3, y, u, v, p.offset[channel]);
+  value = vminq_f32(vmaxq_f32(value, vdupq_n_f32(0.0f)), vdupq_n_f32(255.0f));
+  if (p.has_lut) {
+    // No gather instruction; look the four lanes up one by one.
+    uint32_t index[4];
+    vst1q_u32(index, vcvtq_u32_f32(vaddq_f32(value, vdupq_n_f32(0.5f))));
+    const float *lut = p.lut[channel];
+    const float looked_up[4] = {lut[index[0]], lut[index[1]], lut[index[2]], lut[index[3]]};
+    value = vld1q_f32(looked_up);
+  }
+  return value;
+}
+
+inline Rgb8_NEON FilterPixels8_NEON(const KernelParams &p, const uint8_t *y, const uint8_t *u, const uint8_t *v) {
+  Float8_NEON fy = LoadFloat8_NEON(y);
+  Float8_NEON fu = LoadFloat8_NEON(u);
+  Float8_NEON fv = LoadFloat8_NEON(v);
+  Rgb8_NEON rgb;
+  rgb.r = Float8_NEON{FilterChannel_NEON(p, 0, fy.lo, fu.lo, fv.lo), FilterChannel_NEON(p, 0, fy.hi, fu.hi, fv.hi)};
+  rgb.g = Float8_NEON{FilterChannel_NEON(p, 1, fy.lo, fu.lo, fv.lo), FilterChannel_NEON(p, 1, fy.hi, fu.hi, fv.hi)};
+  rgb.b = Float8_NEON{FilterChannel_NEON(p, 2, fy.lo, fu.lo, fv.lo), FilterChannel_NEON(p, 2, fy.hi, fu.hi, fv.hi)};
+  return rgb;
+}
+
+// Truncates non negative floats to bytes, saturating.
+inline uint8x8_t PackBytes8_NEON(float32x4_t lo, float32x4_t hi) {
+  uint16x8_t words = vcombine_u16(vmovn_u32(vcvtq_u32_f32(lo)), vmovn_u32(vcvtq_u32_f32(hi)));
+  return vqmovn_u16(words);
+}
+
+// Sums of the 2x2 blocks of the 8 pixel wide |row0| and |row1|.
+inline float32x4_t BlockSum4_NEON(const Float8_NEON &row0, const Float8_NEON &row1) {
+  float32x4_t lo = vaddq_f32(row0.lo, row1.lo);
+  float32x4_t hi = vaddq_f32(row0.hi, row1.hi);
+  return vcombine_f32(vpadd_f32(vget_low_f32(lo), vget_high_f32(lo)), vpadd_f32(vget_low_f32(hi), vget_high_f32(hi)));
+}
+
+inline void StoreChroma4_NEON(const float *c, float offset, float32x4_t r, float32x4_t g, float32x4_t b, uint8_t *dst) {
+  const float quarter[3] = {c[0] * 0.25f, c[1] * 0.25f, c[2] * 0.25f};
+  float32x4_t value = Dot3_NEON(quarter, r, g, b, offset);
+  uint8x8_t bytes = PackBytes8_NEON(value, value);
+  const uint32_t packed = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+  memcpy(dst, &packed, 4);
+}
+
+void FilterRowPair_NEON(const KernelParams &p,
+                        const uint8_t *y0,
+                        const uint8_t *y1,
+                        const uint8_t *u0,
+                        const uint8_t *v0,
+                        const uint8_t *u1,
+                        const uint8_t *v1,
+                        uint8_t *dst_y0,
+                        uint8_t *dst_y1,
+                        uint8_t *dst_u,
+                        uint8_t *dst_v,
+                        int width) {
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    Rgb8_NEON a = FilterPixels8_NEON(p, y0 + x, u0 + x, v0 + x);
+    Rgb8_NEON b = FilterPixels8_NEON(p, y1 + x, u1 + x, v1 + x);
+    vst1_u8(dst_y0 + x, PackBytes8_NEON(Dot3_NEON(p.y_coeffs, a.r.lo, a.g.lo, a.b.lo, p.y_offset),
+                                        Dot3_NEON(p.y_coeffs, a.r.hi, a.g.hi, a.b.hi, p.y_offset)));
+    vst1_u8(dst_y1 + x, PackBytes8_NEON(Dot3_NEON(p.y_coeffs, b.r.lo, b.g.lo, b.b.lo, p.y_offset),
+                                        Dot3_NEON(p.y_coeffs, b.r.hi, b.g.hi, b.b.hi, p.y_offset)));
+    float32x4_t r = BlockSum4_NEON(a.r, b.r);
+    float32x4_t g = BlockSum4_NEON(a.g, b.g);
+    float32x4_t bl = BlockSum4_NEON(a.b, b.b);
+    StoreChroma4_NEON(p.u_coeffs, p.uv_offset, r, g, bl, dst_u + x / 2);
+    StoreChroma4_NEON(p.v_coeffs, p.uv_offset, r, g, bl, dst_v + x / 2);
+  }
+  FilterRowPairFrom_C(p, y0, y1, u0, v0, u1, v1, dst_y0, dst_y1, dst_u, dst_v, x, width);
+}
+
+#endif  // CUSTOM_ARCH_NEON
+
+FilterRowPairFunc SelectFilterRowPairFunc(SimdPath path) {
+  if (!IsSimdPathSupported(path)) {
+    return nullptr;
+  }
+  switch (ResolveSimdPath(path)) {
+#if defined(CUSTOM_ARCH_X86)
+    case SimdPath::kAVX2:
+      return FilterRowPair_AVX2;
+#endif
+#if defined(CUSTOM_ARCH_NEON)
+    case SimdPath::kNEON:
+      return FilterRowPair_NEON;
+#endif
+    case SimdPath::kSSE2:
+    case SimdPath::kScalar:
+      return FilterRowPair_C;
+    default:
+      return nullptr;
+  }
+}
+
+bool IsNV12(uint32_t format) {
+  return format == kFourccNV12FullRange || format == kFourccNV12VideoRange;
+}
+
+bool IsValidImage(const Yuv420Image &image) {
+  if (image.width <= 0 || image.height <= 0 || !image.planes[0] || !image.planes[1] ||
+      image.strides[0] < image.width) {
+    return false;
+  }
+  const int chroma_width = (image.width + 1) / 2;
+  if (IsNV12(image.format)) {
+    return image.strides[1] >= chroma_width * 2;
+  }
+  return image.format == kFourccI420 && image.planes[2] && image.strides[1] >= chroma_width &&
+         image.strides[2] >= chroma_width;
+}
+
+// One row of source chroma, deinterleaved.
+struct ChromaRow {
+  uint8_t *u;
+  uint8_t *v;
+};
+
+// Columns [begin, end) of one source chroma row, deinterleaved.
+void ReadChromaRow(const Yuv420Image &image, int row, int begin, int end, ChromaRow dst) {
+  if (IsNV12(image.format)) {
+    const uint8_t *src = image.planes[1] + static_cast<size_t>(row) * image.strides[1];
+    for (int x = begin; x < end; ++x) {
+      dst.u[x] = src[2 * x];
+      dst.v[x] = src[2 * x + 1];
+    }
+  } else {
+    memcpy(dst.u + begin, image.planes[1] + static_cast<size_t>(row) * image.strides[1] + begin, end - begin);
+    memcpy(dst.v + begin, image.planes[2] + static_cast<size_t>(row) * image.strides[2] + begin, end - begin);
+  }
+}
+
+void WriteChromaRow(const Yuv420Image &image, int row, int begin, int end, const uint8_t *u, const uint8_t *v) {
+  if (IsNV12(image.format)) {
+    uint8_t *dst = image.planes[1] + static_cast<size_t>(row) * image.strides[1];
+    for (int x = begin; x < end; ++x) {
+      dst[2 * x] = u[x];
+      dst[2 * x + 1] = v[x];
+    }
+  } else {
+    memcpy(image.planes[1] + static_cast<size_t>(row) * image.strides[1] + begin, u + begin, end - begin);
+    memcpy(image.planes[2] + static_cast<size_t>(row) * image.strides[2] + begin, v + begin, end - begin);
+  }
+}
+
+// Where the GPU samples the half size chroma texture for one luma pixel: the
+// texture coordinate of the pixel centre, (pos + 0.5) / luma_size, lands
+// between chroma samples |i0| and |i1| with |weight| / 256 towards |i1|. For
+// even sizes that is 3/4 of the nearer and 1/4 of the farther sample; odd sizes
+// stretch the chroma over the frame. Edges are clamped like GL_CLAMP_TO_EDGE.
+struct UpsampleTap {
+  int i0;
+  int i1;
+  int weight;
+};
+
+UpsampleTap MakeUpsampleTap(int pos, int luma_size, int chroma_size) {
+  // Chroma position (pos + 0.5) * chroma_size / luma_size - 0.5 as num / den.
+  const int num = (2 * pos + 1) * chroma_size - luma_size;
+  const int den = 2 * luma_size;
+  const int floor = (num >= 0) ? num / den : -((-num + den - 1) / den);
+  const int rem = num - floor * den;
+  UpsampleTap tap;
+  tap.i0 = std::min(std::max(floor, 0), chroma_size - 1);
+  tap.i1 = std::min(std::max(floor + 1, 0), chroma_size - 1);
+  tap.weight = (rem * 256 + den / 2) / den;
+  return tap;
+}
+
+// Bilinear upsampling of one chroma channel for columns [begin, end) of one
+// luma row, blending source rows |row0| and |row1| with |row_weight| / 256
+// towards |row1|.
+void UpsampleChromaRow(const uint8_t *row0,
+                       const uint8_t *row1,
+                       int row_weight,
+                       const UpsampleTap *column_taps,
+                       int begin,
+                       int end,
+                       uint8_t *dst) {
+  for (int x = begin; x < end; ++x) {
+    const UpsampleTap &tap = column_taps[x];
+    const int top = (256 - tap.weight) * row0[tap.i0] + tap.weight * row0[tap.i1];
+    const int bottom = (256 - tap.weight) * row1[tap.i0] + tap.weight * row1[tap.i1];
+    dst[x] = static_cast<uint8_t>(((256 - row_weight) * top + row_weight * bottom + 32768) >> 16);
+  }
+}
+
+// Filters luma columns [x0, x1) of chroma row pairs [k0, k1), x0 even. Taps
+// and scratch rows are laid out for the whole frame, so a region reads its
+// neighbours like the full frame does and produces the same pixels.
+class RegionFilter {
+ public:
+  RegionFilter(const YuvFilter &filter, FilterRowPairFunc row_pair, int width, int height)
+      : row_pair_(row_pair),
+        width_(width),
+        height_(height),
+        chroma_width_((width + 1) / 2),
+        chroma_height_((height + 1) / 2) {
+    MakeKernelParams(filter, &params_);
+    // Three rows of source chroma (previous, current, next), two rows of
+    // upsampled chroma, the filtered chroma row and a spare luma row for odd
+    // heights. Kept per thread so steady state does not allocate.
+    thread_local std::vector<uint8_t> scratch;
+    thread_local std::vector<UpsampleTap> column_taps;
+    const size_t scratch_size = 8 * static_cast<size_t>(chroma_width_) + 5 * static_cast<size_t>(width);
+    if (scratch.size() < scratch_size) {
+      scratch.resize(scratch_size);
+    }
+    column_taps.resize(width);
+    for (int x = 0; x < width; ++x) {
+      column_taps[x] = MakeUpsampleTap(x, width, chroma_width_);
+    }
+    column_taps_ = column_taps.data();
+    uint8_t *next_buffer = scratch.data();
+    for (ChromaRow &row : rows_) {
+      row.u = next_buffer;
+      row.v = next_buffer + chroma_width_;
+      next_buffer += 2 * chroma_width_;
+    }
+    dst_u_ = next_buffer;
+    dst_v_ = dst_u_ + chroma_width_;
+    up_u_[0] = dst_v_ + chroma_width_;
+    up_v_[0] = up_u_[0] + width;
+    up_u_[1] = up_v_[0] + width;
+    up_v_[1] = up_u_[1] + width;
+    spare_y_ = up_v_[1] + width;
+  }
+
+  void Run(const Yuv420Image &src, const Yuv420Image &dst, int x0, int x1, int k0, int k1) {
+    // Source chroma columns the taps of [x0, x1) can reach.
+    const int c0 = std::max(x0 / 2 - 2, 0);
+    const int c1 = std::min(x1 / 2 + 2, chroma_width_);
+    const int width = x1 - x0;
+
+    // Chroma row pair k reads source chroma rows k - 1 to k + 1. They are read
+    // before row k is written, which keeps filtering in place correct.
+    ChromaRow *prev = &rows_[0];
+    ChromaRow *cur = &rows_[1];
+    ChromaRow *next = &rows_[2];
+    ReadChromaRow(src, std::max(k0 - 1, 0), c0, c1, *prev);
+    ReadChromaRow(src, k0, c0, c1, *cur);
+    for (int k = k0; k < k1; ++k) {
+      ReadChromaRow(src, std::min(k + 1, chroma_height_ - 1), c0, c1, *next);
+      const int y = 2 * k;
+      const bool has_pair = (y + 1 < height_);
+      // Without a second row the GPU's vertical taps clamp onto the first one.
+      for (int j = 0; j < (has_pair ? 2 : 1); ++j) {
+        const UpsampleTap tap = MakeUpsampleTap(y + j, height_, chroma_height_);
+        // The taps of rows 2k and 2k + 1 stay within chroma rows k - 1 to k + 1.
+        const ChromaRow *row0 = (tap.i0 < k) ? prev : (tap.i0 > k ? next : cur);
+        const ChromaRow *row1 = (tap.i1 < k) ? prev : (tap.i1 > k ? next : cur);
+        UpsampleChromaRow(row0->u, row1->u, tap.weight, column_taps_, x0, x1, up_u_[j]);
+        UpsampleChromaRow(row0->v, row1->v, tap.weight, column_taps_, x0, x1, up_v_[j]);
+      }
+
+      const uint8_t *src_y0 = src.planes[0] + static_cast<size_t>(y) * src.strides[0];
+      const uint8_t *src_y1 = has_pair ? src_y0 + src.strides[0] : src_y0;
+      uint8_t *dst_y0 = dst.planes[0] + static_cast<size_t>(y) * dst.strides[0];
+      uint8_t *dst_y1 = has_pair ? dst_y0 + dst.strides[0] : spare_y_;
+      const int second = has_pair ? 1 : 0;
+      row_pair_(params_, src_y0 + x0, src_y1 + x0, up_u_[0] + x0, up_v_[0] + x0, up_u_[second] + x0,
+                up_v_[second] + x0, dst_y0 + x0, dst_y1 + (has_pair ? x0 : 0), dst_u_ + x0 / 2, dst_v_ + x0 / 2,
+                width);
+      WriteChromaRow(dst, k, x0 / 2, (x1 + 1) / 2, dst_u_, dst_v_);
+
+      std::swap(prev, cur);
+      std::swap(cur, next);
+    }
+  }
+
+ private:
+  KernelParams params_;
+  FilterRowPairFunc row_pair_;
+  int width_;
+  int height_;
+  int chroma_width_;
+  int chroma_height_;
+  const UpsampleTap *column_taps_;
+  ChromaRow rows_[3];
+  uint8_t *dst_u_;
+  uint8_t *dst_v_;
+  uint8_t *up_u_[2];
+  uint8_t *up_v_[2];
+  uint8_t *spare_y_;
+};
+
+}  // namespace
+
+bool ApplyYuvFilter(const YuvFilter &filter, const Yuv420Image &src, const Yuv420Image &dst, SimdPath path) {
+  if (!IsValidImage(src) || !IsValidImage(dst) || src.width != dst.width || src.height != dst.height) {
+    return false;
+  }
+  FilterRowPairFunc row_pair = SelectFilterRowPairFunc(path);
+  if (!row_pair) {
+    return false;
+  }
+  RegionFilter region(filter, row_pair, src.width, src.height);
+  region.Run(src, dst, 0, src.width, 0, (src.height + 1) / 2);
+  return true;
+}
+
+bool ApplyYuvFilterToRects(const YuvFilter &filter,
+                           const Yuv420Image &src,
+                           const Yuv420Image &dst,
+                           const DirtyRect *rects,
+                           size_t count,
+                           SimdPath path) {
+  if (!IsValidImage(src) || !IsValidImage(dst) || src.width != dst.width || src.height != dst.height ||
+      src.planes[0] == dst.planes[0] || (count > 0 && !rects)) {
+    return false;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    const DirtyRect &rect = rects[i];
+    const int right = rect.x + rect.width;
+    const int bottom = rect.y + rect.height;
+    if (rect.x < 0 || rect.y < 0 || rect.width <= 0 || rect.height <= 0 || (rect.x | rect.y) & 1 ||
+        right > src.width || bottom > src.height || (right & 1 && right != src.width) ||
+        (bottom & 1 && bottom != src.height)) {
+      return false;
+    }
+  }
+  FilterRowPairFunc row_pair = SelectFilterRowPairFunc(path);
+  if (!row_pair) {
+    return false;
+  }
+  RegionFilter region(filter, row_pair, src.width, src.height);
+  for (size_t i = 0; i < count; ++i) {
+    const DirtyRect &rect = rects[i];
+    region.Run(src, dst, rect.x, rect.x + rect.width, rect.y / 2, (rect.y + rect.height + 1) / 2);
+  }
+  return true;
+}
+
+bool ApplyYuvFilterToChangedTiles(const YuvFilter &filter,
+                                  const Yuv420Image &src,
+                                  const Yuv420Image *previous,
+                                  const Yuv420Image &dst,
+                                  DirtyRegionDetector *detector,
+                                  SimdPath path) {
+  if (!detector || !IsValidImage(src)) {
+    return false;
+  }
+  // Kept per thread so steady state does not allocate.
+  thread_local std::vector<DirtyRect> dirty_rects;
+  thread_local std::vector<DirtyRect> clean_rects;
+  const bool nv12 = IsNV12(src.format);
+  if (!detector->Detect(src.planes[0], src.strides[0], src.planes[1], src.strides[1], nv12 ? nullptr : src.planes[2],
+                        nv12 ? 0 : src.strides[2], src.width, src.height, &dirty_rects)) {
+    return false;
+  }
+  if (!previous || !IsValidImage(*previous) || previous->format != dst.format || previous->width != dst.width ||
+      previous->height != dst.height) {
+    return ApplyYuvFilter(filter, src, dst, path);
+  }
+  detector->GrowDirtyBlocks();
+  detector->CollectRects(true, &dirty_rects);
+  detector->CollectRects(false, &clean_rects);
+  for (const DirtyRect &rect : clean_rects) {
+    if (!CopyYuv420Rect(*previous, dst, rect)) {
+      return false;
+    }
+  }
+  return ApplyYuvFilterToRects(filter, src, dst, dirty_rects.data(), dirty_rects.size(), path);
+}
+
+bool IsValidYuv420Image(const Yuv420Image &image) {
+  return IsValidImage(image);
+}
+
+bool CopyYuv420Rect(const Yuv420Image &src, const Yuv420Image &dst, const DirtyRect &rect) {
+  if (!IsValidImage(src) || !IsValidImage(dst) || src.format != dst.format || src.width != dst.width ||
+      src.height != dst.height || rect.x < 0 || rect.y < 0 || (rect.x | rect.y) & 1 ||
+      rect.x + rect.width > src.width || rect.y + rect.height > src.height) {
+    return false;
+  }
+  for (int y = rect.y; y < rect.y + rect.height; ++y) {
+    memcpy(dst.planes[0] + static_cast<size_t>(y) * dst.strides[0] + rect.x,
+           src.planes[0] + static_cast<size_t>(y) * src.strides[0] + rect.x, rect.width);
+  }
+  const int chroma_x = rect.x / 2;
+  const int chroma_width = (rect.x + rect.width + 1) / 2 - chroma_x;
+  const int planes = IsNV12(src.format) ? 1 : 2;
+  const int bytes_per_sample = IsNV12(src.format) ? 2 : 1;
+  for (int k = rect.y / 2; k < (rect.y + rect.height + 1) / 2; ++k) {
+    for (int plane = 1; plane <= planes; ++plane) {
+      memcpy(dst.planes[plane] + static_cast<size_t>(k) * dst.strides[plane] + chroma_x * bytes_per_sample,
+             src.planes[plane] + static_cast<size_t>(k) * src.strides[plane] + chroma_x * bytes_per_sample,
+             static_cast<size_t>(chroma_width) * bytes_per_sample);
+    }
+  }
+  return true;
+}
+
+bool FlipYuv420Vertically(const Yuv420Image &image) {
+  if (!IsValidImage(image)) {
+    return false;
+  }
+  const int chroma_width = (image.width + 1) / 2;
+  const int chroma_height = (image.height + 1) / 2;
+  const int planes = IsNV12(image.format) ? 2 : 3;
+  const int row_bytes[kMaxPlanes] = {image.width, IsNV12(image.format) ? 2 * chroma_width : chroma_width,
+                                     chroma_width};
+  const int rows[kMaxPlanes] = {image.height, chroma_height, chroma_height};
+  // Rows are swapped through a small stack buffer, a chunk at a time.
+  uint8_t chunk[256];
+  for (int plane = 0; plane < planes; ++plane) {
+    for (int top = 0, bottom = rows[plane] - 1; top < bottom; ++top, --bottom) {
+      uint8_t *top_row = image.planes[plane] + static_cast<size_t>(top) * image.strides[plane];
+      uint8_t *bottom_row = image.planes[plane] + static_cast<size_t>(bottom) * image.strides[plane];
+      for (int x = 0; x < row_bytes[plane]; x += static_cast<int>(sizeof(chunk))) {
+        const size_t bytes = std::min<size_t>(sizeof(chunk), static_cast<size_t>(row_bytes[plane] - x));
+        memcpy(chunk, top_row + x, bytes);
+        memcpy(top_row + x, bottom_row + x, bytes);
+        memcpy(bottom_row + x, chunk, bytes);
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace custom
@@ -0,0 +1,113 @@
+//
+//  YuvFilter.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/2/24.
+//
+
+#ifndef YuvFilter_h
+#define YuvFilter_h
+
+#include <cstddef>
+#include <cstdint>
+
+#include "CpuFeatures.h"
+#include "DirtyRegion.h"
+#include "FrameFormat.h"
+
+namespace custom {
+
+// Per pixel RGB operation with the semantics of the applyFilter() functions in
+// CustomTargetShader: rgb' = lut(clamp(matrix * rgb + offset, 0, 1)). Colors
+// are normalized to [0, 1] as in the shaders. The matrix is row major.
+struct YuvFilter {
+  float matrix[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+  float offset[3] = {0, 0, 0};
+  // Applied per channel after clamping, indexed by the 8 bit value.
+  bool has_lut = false;
+  uint8_t lut[3][256] = {};
+
+  static YuvFilter Identity();
+  // Average of the three channels, the same as GRAYSCALE_FILTER_SOURCE.
+  static YuvFilter Grayscale();
+  static YuvFilter ColorMatrix(const float matrix[9], const float offset[3]);
+  // rgb' = (rgb - 0.5) * contrast + 0.5 + brightness.
+  static YuvFilter BrightnessContrast(float brightness, float contrast);
+  // The same curve for all three channels.
+  static YuvFilter Lut(const uint8_t lut[256]);
+  static YuvFilter Lut(const uint8_t red[256], const uint8_t green[256], const uint8_t blue[256]);
+};
+
+// |first| followed by |second| as one filter. The shader clamps once, after the
+// whole filter, and so does the composition. Fails if |first| has a LUT and
+// |second| is not a pure LUT, which can't be expressed as a single filter.
+bool ComposeYuvFilters(const YuvFilter &first, const YuvFilter &second, YuvFilter *composed);
+
+// A 4:2:0 frame. NV12 formats use planes[0] and the interleaved planes[1];
+// I420 uses all three.
+struct Yuv420Image {
+  uint32_t format = 0;
+  int width = 0;
+  int height = 0;
+  uint8_t *planes[kMaxPlanes] = {};
+  int strides[kMaxPlanes] = {};
+};
+
+// Whether |image| is NV12 or I420 with a positive size, its planes set and
+// strides covering a row.
+bool IsValidYuv420Image(const Yuv420Image &image);
+
+// Filters |src| into |dst| on the CPU, producing what CustomTargetShader's NV12
+// output does for the same filter: YUV is decoded with the shader's matrix,
+// chroma is upsampled bilinearly as the GPU samples it, and the result is
+// encoded with kBT601VideoRange and a 2x2 chroma box filter. Agrees with the
+// GPU within the rounding of its arithmetic, about 1 code value; a steep LUT
+// magnifies that by its slope.
+//
+// |src| and |dst| must have the same size but may differ in layout, e.g. I420
+// in and NV12 out, and may be the same image to filter in place. Returns false
+// on invalid arguments or if |path| is not supported. There is no SSE2 kernel,
+// SimdPath::kSSE2 runs the scalar code.
+bool ApplyYuvFilter(const YuvFilter &filter,
+                    const Yuv420Image &src,
+                    const Yuv420Image &dst,
+                    SimdPath path = SimdPath::kAuto);
+
+// ApplyYuvFilter() restricted to |rects|: every pixel inside them gets the
+// value the whole frame filter would give it, as chroma upsampling still reads
+// the neighbours outside, and pixels outside are not touched. Rectangles must
+// cover whole 2x2 chroma blocks: even origin, and an even end unless it is the
+// frame edge, as DirtyRegionDetector's are. |src| and |dst| must not
+// share memory, one rectangle's output would feed another's upsampling.
+bool ApplyYuvFilterToRects(const YuvFilter &filter,
+                           const Yuv420Image &src,
+                           const Yuv420Image &dst,
+                           const DirtyRect *rects,
+                           size_t count,
+                           SimdPath path = SimdPath::kAuto);
+
+// ApplyYuvFilter() for mostly static input: |detector| compares |src| with the
+// previous frame, luma and chroma, and only the changed blocks and those next
+// to them, whose edges the changed chroma reaches through upsampling, are
+// filtered; the others are copied from |previous|, the output for the
+// previous frame. With a zero SAD threshold |dst| is what ApplyYuvFilter()
+// gives. Filters the whole frame, still updating |detector|, if |previous| is
+// null or differs from |dst| in format or size. |src| and |dst| must not share
+// memory.
+bool ApplyYuvFilterToChangedTiles(const YuvFilter &filter,
+                                  const Yuv420Image &src,
+                                  const Yuv420Image *previous,
+                                  const Yuv420Image &dst,
+                                  DirtyRegionDetector *detector,
+                                  SimdPath path = SimdPath::kAuto);
+
+// Copies |rect| (even origin) of |src| to |dst|, which have the same format and
+// size.
+bool CopyYuv420Rect(const Yuv420Image &src, const Yuv420Image &dst, const DirtyRect &rect);
+
+// Turns |image| upside down in place, every plane by its own rows.
+bool FlipYuv420Vertically(const Yuv420Image &image);
+
+}  // namespace custom
+
+#endif /* YuvFilter_h */
@@ -17,6 +17,28 @@ class CustomVideoSource: NSObject, RTCVideoCapturerDelegate {
     
     var pixelBufferProcesser: ProcessPixelBufferProtocol?
     
+    /// Overlap the GPU work of a frame with the CPU work of the previous one, if the processer supports it.
+    /// Adds up to one frame of latency. Turning it off sends the frames still in flight on with the next captured frame.
+    var usesPipelinedProcessing = false {
+        didSet {
+            if oldValue && !usesPipelinedProcessing {
+                pipelineFlushLock.lock()
+                needsPipelineFlush = true
+                pipelineFlushLock.unlock()
+            }
+        }
+    }
+    
+    private let pipelineFlushLock = NSLock()
+    private var needsPipelineFlush = false
+    
+    /// When set, frames are processed on `processingQueue` instead of the capture queue, and frames that can't be
+    /// processed within the scheduler's latency budget are dropped. Off by default; e.g.
+    /// `CustomFrameScheduler(latencyBudgetMs: 66)` allows two frames at 30 fps.
+    var frameScheduler: CustomFrameScheduler?
+    
+    private let processingQueue = DispatchQueue(label: "CustomVideoSource.processing")
+    
     private var keyWindow: UIWindow? {
         // Get connected scenes
         return UIApplication.shared.connectedScenes
@@ -52,6 +74,64 @@ class CustomVideoSource: NSObject, RTCVideoCapturerDelegate {
         // Fix frame ortation for RTCVideoRotation_270
         let isFrontCamera = isUsingFrontCamera(capturer: capturer)
         let fixedFrame = RTCVideoFrame(buffer: frame.buffer, rotation: fixFrameRotation(statusBarOrientation: orientation, isUsingFrontCamera: isFrontCamera), timeStampNs: frame.timeStampNs)
+        
+        // The processer isn't thread safe: flush on the thread frames are processed on.
+        pipelineFlushLock.lock()
+        let flushesPipeline = needsPipelineFlush
+        needsPipelineFlush = false
+        pipelineFlushLock.unlock()
+        if flushesPipeline {
+            if frameScheduler != nil {
+                processingQueue.async { [weak self] in
+                    self?.pixelBufferProcesser?.flushPendingFrames?()
+                }
+            } else {
+                pixelBufferProcesser?.flushPendingFrames?()
+            }
+        }
+        
+        if let frameScheduler = frameScheduler, pixelBufferProcesser?.shouldProcessFrameBuffer() == true {
+            let scheduledFrame = ScheduledFrame(capturer: capturer, frame: frame, fixedFrame: fixedFrame, orientation: orientation, arrivalNs: CustomStageTrace.shared.nowNs)
+            // A replaced frame means a worker is already on its way to pick up this one.
+            if frameScheduler.offerFrame(scheduledFrame) == .queued {
+                processingQueue.async { [weak self] in
+                    self?.processScheduledFrame()
+                }
+            }
+            return
+        }
+        
+        if let videoFrame = process(frame: frame, fixedFrame: fixedFrame, orientation: orientation, capturer: capturer) {
+            deliver(videoFrame, capturer: capturer)
+        }
+    }
+    
+    /// Sends on the frames still in the processer's pipeline. Call it once the capturer has stopped, when nothing is
+    /// processed on the capture queue any more; `completion` runs after the last one was sent.
+    func capturerDidStop(completion: (() -> Void)? = nil) {
+        processingQueue.async { [weak self] in
+            self?.pixelBufferProcesser?.flushPendingFrames?()
+            completion?()
+        }
+    }
+    
+    private func processScheduledFrame() {
+        guard let frameScheduler = frameScheduler, let scheduledFrame = frameScheduler.takeFrame() as? ScheduledFrame else {
+            return
+        }
+        let trace = CustomStageTrace.shared
+        if trace.isEnabled {
+            trace.record(.queue, timeStampNs: scheduledFrame.fixedFrame.timeStampNs, beginNs: scheduledFrame.arrivalNs, endNs: trace.nowNs)
+        }
+        let videoFrame = process(frame: scheduledFrame.frame, fixedFrame: scheduledFrame.fixedFrame, orientation: scheduledFrame.orientation, capturer: scheduledFrame.capturer)
+        frameScheduler.didFinishFrame()
+        if let videoFrame = videoFrame {
+            deliver(videoFrame, capturer: scheduledFrame.capturer)
+        }
+    }
+    
+    /// Returns the frame to send on, or nil if it will be sent from a pipelined completion.
+    private func process(frame: RTCVideoFrame, fixedFrame: RTCVideoFrame, orientation: UIInterfaceOrientation, capturer: RTCVideoCapturer) -> RTCVideoFrame? {
         var videoFrame: RTCVideoFrame = frame
         
         if pixelBufferProcesser?.shouldProcessFrameBuffer() == true {
@@ -62,6 +142,16 @@ class CustomVideoSource: NSObject, RTCVideoCapturerDelegate {
                 pixelBuffer = rtcCVPixelBuffer.pixelBuffer
             }
             
+            // Pipelined processing: the frame is sent on from the completion, once its GPU work is done.
+            if usesPipelinedProcessing, let originalRTCPixelBuffer = pixelBuffer,
+               pixelBufferProcesser?.processBuffer?(originalRTCPixelBuffer, orientation: orientation, timeStampNs: fixedFrame.timeStampNs, completion: { [weak self] resultPixelBuffer, timeStampNs in
+                   guard let self = self else { return }
+                   let videoFrame = self.makeVideoFrame(pixelBuffer: resultPixelBuffer ?? originalRTCPixelBuffer, rotation: fixedFrame.rotation, timeStampNs: timeStampNs)
+                   self.deliver(videoFrame, capturer: capturer)
+               }) != nil {
+                return nil
+            }
+            
             // Process pixelBuffer. e.g. Add filter, effects
             if let originalRTCPixelBuffer = pixelBuffer, let reusltPixelBuffer = pixelBufferProcesser?.processBuffer(originalRTCPixelBuffer, orientation: orientation, timeStampNs: fixedFrame.timeStampNs) {
                 pixelBuffer = reusltPixelBuffer
@@ -69,16 +159,32 @@ class CustomVideoSource: NSObject, RTCVideoCapturerDelegate {
             
             // Recreate videoFrame
             if let pixelBuffer = pixelBuffer {
-                var rotation: RTCVideoRotation = fixedFrame.rotation;
-                if rotation == RTCVideoRotation._270 {
-                    rotation = RTCVideoRotation._0
-                }
-                let rtcCVPixelBuffer = RTCCVPixelBuffer(pixelBuffer: pixelBuffer)
-                videoFrame = RTCVideoFrame(buffer: rtcCVPixelBuffer, rotation: rotation, timeStampNs: fixedFrame.timeStampNs)
+                videoFrame = makeVideoFrame(pixelBuffer: pixelBuffer, rotation: fixedFrame.rotation, timeStampNs: fixedFrame.timeStampNs)
             }
         }
         
+        return videoFrame
+    }
+    
+    /// Hands a frame to the video source, timing it as the trace's handoff stage.
+    private func deliver(_ videoFrame: RTCVideoFrame, capturer: RTCVideoCapturer) {
+        let trace = CustomStageTrace.shared
+        guard trace.isEnabled else {
+            rtcVideoSource.capturer(capturer, didCapture: videoFrame)
+            return
+        }
+        let beginNs = trace.nowNs
         rtcVideoSource.capturer(capturer, didCapture: videoFrame)
+        trace.record(.handoff, timeStampNs: videoFrame.timeStampNs, beginNs: beginNs, endNs: trace.nowNs)
+    }
+    
+    private func makeVideoFrame(pixelBuffer: CVPixelBuffer, rotation: RTCVideoRotation, timeStampNs: Int64) -> RTCVideoFrame {
+        var rotation: RTCVideoRotation = rotation
+        if rotation == RTCVideoRotation._270 {
+            rotation = RTCVideoRotation._0
+        }
+        let rtcCVPixelBuffer = RTCCVPixelBuffer(pixelBuffer: pixelBuffer)
+        return RTCVideoFrame(buffer: rtcCVPixelBuffer, rotation: rotation, timeStampNs: timeStampNs)
     }
     
     private func isUsingFrontCamera(capturer: RTCVideoCapturer) -> Bool {
@@ -126,3 +232,21 @@ class CustomVideoSource: NSObject, RTCVideoCapturerDelegate {
         }
     }
 }
+
+/// A captured frame waiting in CustomFrameScheduler's mailbox.
+private final class ScheduledFrame: NSObject {
+    let capturer: RTCVideoCapturer
+    let frame: RTCVideoFrame
+    let fixedFrame: RTCVideoFrame
+    let orientation: UIInterfaceOrientation
+    /// When the capturer delivered the frame, on the CustomStageTrace clock.
+    let arrivalNs: Int64
+    
+    init(capturer: RTCVideoCapturer, frame: RTCVideoFrame, fixedFrame: RTCVideoFrame, orientation: UIInterfaceOrientation, arrivalNs: Int64) {
+        self.capturer = capturer
+        self.frame = frame
+        self.fixedFrame = fixedFrame
+        self.orientation = orientation
+        self.arrivalNs = arrivalNs
+    }
+}
@@ -12,12 +12,19 @@ enum SignalingMessageType: String, Codable {
     case answer = "answer"
     case unKnown = "unKnown"
     case candidate = "candidate"
+    case candidates = "candidates"
 }
 
 struct SignalingMessage: Codable {
     let type: SignalingMessageType
     let sessionDescription: SDP?
     let candidate: Candidate?
+    /// Several trickled candidates, sent in place of candidate messages to peers that set candidateBatches.
+    let candidates: [Candidate]?
+    /// Set in an offer or answer by a peer that accepts candidates messages.
+    let candidateBatches: Bool?
+    /// Set in an offer or answer by a peer that takes its data channel messages framed, see WebRTCService.peerTakesDataFrames.
+    let dataFrames: Bool?
 }
 
 struct SDP: Codable {
@@ -29,3 +36,50 @@ struct Candidate: Codable {
     let sdpMLineIndex: Int32
     let sdpMid: String?
 }
+
+extension SignalingMessageType {
+    init(_ type: CustomSignalingMessageType) {
+        switch type {
+        case .offer:
+            self = .offer
+        case .answer:
+            self = .answer
+        case .candidate:
+            self = .candidate
+        case .candidates:
+            self = .candidates
+        default:
+            self = .unKnown
+        }
+    }
+    
+    var customType: CustomSignalingMessageType {
+        switch self {
+        case .offer:
+            return .offer
+        case .answer:
+            return .answer
+        case .candidate:
+            return .candidate
+        case .candidates:
+            return .candidates
+        case .unKnown:
+            return .unknown
+        }
+    }
+}
+
+extension SignalingMessage {
+    init(message: CustomSignalingMessage) {
+        type = SignalingMessageType(message.type)
+        sessionDescription = message.sdp.map { SDP(sdp: $0) }
+        if message.hasCandidate, let sdp = message.candidateSdp {
+            candidate = Candidate(sdp: sdp, sdpMLineIndex: message.candidateSdpMLineIndex, sdpMid: message.candidateSdpMid)
+        } else {
+            candidate = nil
+        }
+        candidates = message.candidates?.map { Candidate(sdp: $0.sdp, sdpMLineIndex: $0.sdpMLineIndex, sdpMid: $0.sdpMid) }
+        candidateBatches = message.supportsCandidateBatches ? true : nil
+        dataFrames = message.supportsDataFrames ? true : nil
+    }
+}
@@ -15,9 +15,19 @@ NS_ASSUME_NONNULL_BEGIN
 @property(nonatomic, readonly) GLuint uTexture;
 @property(nonatomic, readonly) GLuint vTexture;
 
+/// Upload counters since creation. |uploadedBytes| counts plane payload, not padding; |uploadTimeNs| is CPU time spent
+/// issuing uploads, including repacking padded planes.
+@property(nonatomic, readonly) uint64_t uploadedFrames;
+@property(nonatomic, readonly) uint64_t uploadedBytes;
+@property(nonatomic, readonly) uint64_t uploadTimeNs;
+/// Times texture storage was (re)allocated; stays put while the frame size does not change.
+@property(nonatomic, readonly) uint64_t textureAllocations;
+
 - (instancetype)initWithContext:(EAGLContext *)context;
 
-- (void)uploadFrameToTextures:(CVPixelBufferRef)buffer;
+/// Uploads a planar (y420) or bi-planar 4:2:0 buffer, honoring each plane's stride. Returns NO if |buffer| has another
+/// layout.
+- (BOOL)uploadFrameToTextures:(CVPixelBufferRef)buffer;
 
 @end
 
@@ -14,12 +14,15 @@
 #import <OpenGL/gl3.h>
 #endif
 
+#include <chrono>
 #include <vector>
 
-// Two sets of 3 textures are used here, one for each of the Y, U and V planes. Having two sets
-// alleviates CPU blockage in the event that the GPU is asked to render to a texture that is already
-// in use.
-static const GLsizei kNumTextureSets = 2;
+#include "PlaneGeometry.h"
+
+// Three sets of 3 textures are used here, one for each of the Y, U and V planes. Textures are updated in place with
+// glTexSubImage2D, so a set must not be written while a frame still in flight samples it; three sets cover the
+// processor's deepest pipeline.
+static const GLsizei kNumTextureSets = 3;
 static const GLsizei kNumTexturesPerSet = 3;
 static const GLsizei kNumTextures = kNumTexturesPerSet * kNumTextureSets;
 
@@ -27,13 +30,21 @@ static const GLsizei kNumTextures = kNumTexturesPerSet * kNumTextureSets;
 
 @property(nonatomic, assign) BOOL hasUnpackRowLength;
 @property(nonatomic, assign) GLint currentTextureSet;
+@property(nonatomic, readwrite) uint64_t uploadedFrames;
+@property(nonatomic, readwrite) uint64_t uploadedBytes;
+@property(nonatomic, readwrite) uint64_t uploadTimeNs;
+@property(nonatomic, readwrite) uint64_t textureAllocations;
 
 @end
 
 @implementation CustomI420TextureCache {
   // Handles for OpenGL constructs.
   GLuint _textures[kNumTextures];
-  // Used to create a non-padded plane for GPU upload when we receive padded frames.
+  // Storage size of each texture, so storage is only reallocated when the frame size changes.
+  GLsizei _textureWidths[kNumTextures];
+  GLsizei _textureHeights[kNumTextures];
+  // Used to create a non-padded plane for GPU upload when we receive padded frames, and to split the chroma of
+  // bi-planar frames into U and V.
   std::vector<uint8_t> _planeBuffer;
 }
 
@@ -76,110 +87,113 @@ static const GLsizei kNumTextures = kNumTexturesPerSet * kNumTextureSets;
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    _textureWidths[i] = 0;
+    _textureHeights[i] = 0;
   }
 }
 
-- (void)uploadPlane:(const uint8_t *)plane
-            texture:(GLuint)texture
-              width:(size_t)width
-             height:(size_t)height
-             stride:(int32_t)stride {
-  glBindTexture(GL_TEXTURE_2D, texture);
+- (void)uploadPackedPlane:(const uint8_t *)plane
+                textureIndex:(GLsizei)index
+                       width:(GLsizei)width
+                      height:(GLsizei)height {
+  glBindTexture(GL_TEXTURE_2D, _textures[index]);
+  if (_textureWidths[index] != width || _textureHeights[index] != height) {
+    // Size changed: allocate new storage with the data, later frames update it in place.
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, width, height, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, plane);
+    _textureWidths[index] = width;
+    _textureHeights[index] = height;
+    _textureAllocations++;
+  } else {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_LUMINANCE, GL_UNSIGNED_BYTE, plane);
+  }
+}
 
-  const uint8_t *uploadPlane = plane;
-  if ((size_t)stride != width) {
-   if (_hasUnpackRowLength) {
+- (BOOL)uploadPlane:(const custom::PlaneSource &)plane textureIndex:(GLsizei)index {
+  custom::PlaneUpload upload;
+  if (!custom::PlanPlaneUpload(plane, _hasUnpackRowLength, &upload)) {
+    return NO;
+  }
+  switch (upload.mode) {
+    case custom::PlaneUploadMode::kPacked:
+      [self uploadPackedPlane:plane.data textureIndex:index width:plane.width height:plane.height];
+      break;
+    case custom::PlaneUploadMode::kRowLength:
       // GLES3 allows us to specify stride.
-      glPixelStorei(GL_UNPACK_ROW_LENGTH, stride);
-      glTexImage2D(GL_TEXTURE_2D,
-                   0,
-                   GL_LUMINANCE,
-                   static_cast<GLsizei>(width),
-                   static_cast<GLsizei>(height),
-                   0,
-                   GL_LUMINANCE,
-                   GL_UNSIGNED_BYTE,
-                   uploadPlane);
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, upload.row_length);
+      [self uploadPackedPlane:plane.data textureIndex:index width:plane.width height:plane.height];
       glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-      return;
-    } else {
+      break;
+    case custom::PlaneUploadMode::kRepack:
       // Make an unpadded copy and upload that instead. Quick profiling showed
       // that this is faster than uploading row by row using glTexSubImage2D.
-      uint8_t *unpaddedPlane = _planeBuffer.data();
-      for (size_t y = 0; y < height; ++y) {
-        memcpy(unpaddedPlane + y * width, plane + y * stride, width);
+      if (_planeBuffer.size() < plane.packed_size()) {
+        _planeBuffer.resize(plane.packed_size());
       }
-      uploadPlane = unpaddedPlane;
-    }
+      custom::CopyPlanePacked(plane, _planeBuffer.data());
+      [self uploadPackedPlane:_planeBuffer.data() textureIndex:index width:plane.width height:plane.height];
+      break;
+  }
+  _uploadedBytes += plane.packed_size();
+  return YES;
+}
+
+- (BOOL)uploadBiPlanarChroma:(const custom::PlaneSource &)uv textureIndex:(GLsizei)index {
+  if (!custom::IsValidPlane(uv)) {
+    return NO;
+  }
+  const size_t planeSize = (size_t)uv.width * uv.height;
+  if (_planeBuffer.size() < 2 * planeSize) {
+    _planeBuffer.resize(2 * planeSize);
   }
-  glTexImage2D(GL_TEXTURE_2D,
-               0,
-               GL_LUMINANCE,
-               static_cast<GLsizei>(width),
-               static_cast<GLsizei>(height),
-               0,
-               GL_LUMINANCE,
-               GL_UNSIGNED_BYTE,
-               uploadPlane);
+  uint8_t *dataU = _planeBuffer.data();
+  uint8_t *dataV = dataU + planeSize;
+  custom::SplitUVPlanePacked(uv, dataU, dataV);
+  [self uploadPackedPlane:dataU textureIndex:index width:uv.width height:uv.height];
+  [self uploadPackedPlane:dataV textureIndex:index + 1 width:uv.width height:uv.height];
+  _uploadedBytes += 2 * planeSize;
+  return YES;
 }
 
-- (void)uploadFrameToTextures:(CVPixelBufferRef)buffer {
+static custom::PlaneSource PlaneOfPixelBuffer(CVPixelBufferRef buffer, size_t planeIndex, int bytesPerSample) {
+  custom::PlaneSource plane;
+  plane.data = static_cast<const uint8_t *>(CVPixelBufferGetBaseAddressOfPlane(buffer, planeIndex));
+  plane.width = (int)CVPixelBufferGetWidthOfPlane(buffer, planeIndex);
+  plane.height = (int)CVPixelBufferGetHeightOfPlane(buffer, planeIndex);
+  plane.stride = (int)CVPixelBufferGetBytesPerRowOfPlane(buffer, planeIndex);
+  plane.bytes_per_sample = bytesPerSample;
+  return plane;
+}
+
+- (BOOL)uploadFrameToTextures:(CVPixelBufferRef)buffer {
+  const size_t planeCount = CVPixelBufferGetPlaneCount(buffer);
+  if (planeCount != 2 && planeCount != 3) {
+    DLog(@"CustomI420TextureCache: unsupported pixel format %u with %zu planes",
+         (unsigned)CVPixelBufferGetPixelFormatType(buffer), planeCount);
+    return NO;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
   _currentTextureSet = (_currentTextureSet + 1) % kNumTextureSets;
-    size_t width  = CVPixelBufferGetWidth(buffer);
-    size_t height = CVPixelBufferGetHeight(buffer);
-    
-//    int chromaWidth = (width + 1) / 2;
-//    int chromaHeight = (height + 1) / 2;
-    
-//    RTC_DCHECK_GE(stride_y, width);
-//      RTC_DCHECK_GE(stride_u, (width + 1) / 2);
-//      RTC_DCHECK_GE(stride_v, (width + 1) / 2);
-//    data_(static_cast<uint8_t*>
-    
-//    const uint8_t* I420Buffer::DataY() const {
-//      return data_.get();
-//    }
-//    const uint8_t* I420Buffer::DataU() const {
-//      return data_.get() + stride_y_ * height_;
-//    }
-//    const uint8_t* I420Buffer::DataV() const {
-//      return data_.get() + stride_y_ * height_ + stride_u_ * ((height_ + 1) / 2);
-//    }
-    
-    const int chromaWidth = (int)((width + 1) / 2);
-    const int chromaHeight = (int)((height + 1) / 2);
-    const int strideY = (int)width;
-    const int strideU = (int)((width + 1) / 2);
-    const int strideV = (int)((width + 1) / 2);
-  
-//    if (strideY != width || strideU != chromaWidth ||
-//      strideV != chromaWidth) {
-//        _planeBuffer.resize(width * height);
-//    }
-
-    CVPixelBufferLockBaseAddress(buffer, kCVPixelBufferLock_ReadOnly);
-    uint8_t *dataY = (uint8_t*)CVPixelBufferGetBaseAddressOfPlane(buffer,0);
-    uint8_t *dataU = dataY + strideY * height;
-    uint8_t *dataV = dataY + strideY * height + strideU * ((height + 1) / 2);
-    CVPixelBufferUnlockBaseAddress(buffer, kCVPixelBufferLock_ReadOnly);
-    
-    [self uploadPlane:dataY
-            texture:self.yTexture
-              width:width
-             height:height
-             stride:strideY];
-
-    [self uploadPlane:dataU
-            texture:self.uTexture
-              width:chromaWidth
-             height:chromaHeight
-             stride:strideU];
-
-    [self uploadPlane:dataV
-            texture:self.vTexture
-              width:chromaWidth
-             height:chromaHeight
-             stride:strideV];
+  const GLsizei firstTexture = _currentTextureSet * kNumTexturesPerSet;
+
+  // The planes are only valid while the base address is locked, which must last until the upload has copied them.
+  CVPixelBufferLockBaseAddress(buffer, kCVPixelBufferLock_ReadOnly);
+  BOOL uploaded = [self uploadPlane:PlaneOfPixelBuffer(buffer, 0, 1) textureIndex:firstTexture];
+  if (uploaded && planeCount == 3) {
+    uploaded = [self uploadPlane:PlaneOfPixelBuffer(buffer, 1, 1) textureIndex:firstTexture + 1] &&
+               [self uploadPlane:PlaneOfPixelBuffer(buffer, 2, 1) textureIndex:firstTexture + 2];
+  } else if (uploaded) {
+    // Bi-planar video range frames end up here too; the U and V textures get the split chroma plane.
+    uploaded = [self uploadBiPlanarChroma:PlaneOfPixelBuffer(buffer, 1, 2) textureIndex:firstTexture + 1];
+  }
+  CVPixelBufferUnlockBaseAddress(buffer, kCVPixelBufferLock_ReadOnly);
+
+  if (uploaded) {
+    _uploadedFrames++;
+  }
+  _uploadTimeNs +=
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  return uploaded;
 }
 
 @end
@@ -7,16 +7,47 @@
 
 #import <Foundation/Foundation.h>
 #import "ProcessPixelBufferProtocol.h"
+#import "CustomTypes.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
 @protocol ShaderProtocol;
+@class CustomFrameHistory;
+@class CustomPathCostModel;
+@class CustomQualitySampler;
 
 NS_EXTENSION_UNAVAILABLE_IOS("Rendering not available in app extensions.")
 @interface CustomPixelBufferProcesser : NSObject<ProcessPixelBufferProtocol>
 
 @property(nonatomic, readonly) EAGLContext *glContext;
 
+/// Frames -processBuffer:orientation:timeStampNs:completion: keeps in flight on the GPU. 1 means every frame is finished
+/// before the next one is drawn. Clamped to [1, 3], defaults to 2.
+@property(nonatomic, assign) NSUInteger maxFramesInFlight;
+
+/// Processed frames kept in frameHistory for temporal filters, 0 to keep none. Every kept frame holds on to a pooled
+/// buffer. Clamped to [0, 8], defaults to 0.
+@property(nonatomic, assign) NSUInteger frameHistoryDepth;
+
+/// The latest processed frames with their timestamps, newest first; nil while frameHistoryDepth is 0.
+@property(nonatomic, readonly, nullable) CustomFrameHistory *frameHistory;
+
+/// Where frames are processed. Frames the shader has a CPU equivalent for (see -[ShaderProtocol
+/// cpuFilterForPixelFormat:orientation:]) may skip GL upload, draw and readback for a SIMD pass over their planes;
+/// CustomProcessingPathAutomatic, the default, takes whichever path pathCostModel measured cheaper.
+@property(nonatomic, assign) CustomProcessingPath processingPath;
+
+/// Measured costs and decisions per effect and frame size.
+@property(nonatomic, readonly) CustomPathCostModel *pathCostModel;
+
+/// Samples the quality of drawn frames that have a CPU equivalent, comparing the GPU output with the CPU filter's in
+/// the background; see CustomQualitySampler. Frames taking the CPU path aren't sampled. Defaults to nil.
+@property(nonatomic, strong, nullable) CustomQualitySampler *qualitySampler;
+
+/// Builds the default shader's programs in the background so the first processed frame doesn't wait for shader
+/// compilation. Call at app start.
++ (void)warmUpShaders;
+
 /// Will use default shader
 - (instancetype)init;
 
@@ -26,6 +57,15 @@ NS_EXTENSION_UNAVAILABLE_IOS("Rendering not available in app extensions.")
 /// Note: This function pass ownership of return value(CVPixelBufferRef) to the caller.
 - (CVPixelBufferRef _Nullable)processBuffer:(CVPixelBufferRef _Nullable)pixelBuffer orientation:(UIInterfaceOrientation)orientation timeStampNs:(int64_t)timeStampNs CF_RETURNS_RETAINED;
 
+/// Pipelined processing. Issues the draw for |pixelBuffer| and returns without waiting for the GPU; the frame is
+/// finished with a GL fence sync once its commands have completed, so its readback and conversion overlap the draw of
+/// the next frame. |completion| is called on the calling thread, in submission order, with the original |timeStampNs|;
+/// usually from the next call, or from -flushPendingFrames. Skipped frames are completed with a nil buffer.
+- (void)processBuffer:(CVPixelBufferRef _Nullable)pixelBuffer orientation:(UIInterfaceOrientation)orientation timeStampNs:(int64_t)timeStampNs completion:(CustomProcessCompletionHandler)completion;
+
+/// Waits for and completes every frame still in flight.
+- (void)flushPendingFrames;
+
 - (BOOL)shouldProcessFrameBuffer;
 
 @end
@@ -0,0 +1,498 @@
+//
+//  CustomPixelBufferProcesser.mm
+//  WebRTCExample
+//
+//  Created by rcadmin on 2021/12/23.
+//
+
+#import "CustomPixelBufferProcesser.h"
+#import "CustomNV12TextureCache.h"
+#import "CustomI420TextureCache.h"
+#import "CustomTargetShader.h"
+#import "CustomFrameHistory.h"
+#import "CustomCPUFilter.h"
+#import "CustomPathCostModel.h"
+#import "CustomQualitySampler.h"
+#import <GLKit/GLKit.h>
+#import "ShaderProtocol.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "FramePipeline.h"
+#include "PathCostModel.h"
+#include "StageTrace.h"
+
+namespace {
+
+// How long a forced wait blocks on a fence before giving up on it.
+const GLuint64 kFenceWaitTimeoutNs = 1000000000;
+
+// Every frame in flight holds one of CustomTargetShader's render targets, it keeps three.
+const size_t kMaxFramesInFlight = 3;
+
+struct FenceDeleter {
+    void operator()(GLsync fence) const {
+        glDeleteSync(fence);
+    }
+};
+
+// A frame whose GL commands have been issued but which hasn't been delivered yet.
+struct PendingFrame {
+    int64_t timeStampNs = 0;
+    // Signalled once the GPU has finished the frame. Null if the frame needs no waiting.
+    std::unique_ptr<__GLsync, FenceDeleter> fence;
+    // Null if the frame was skipped or failed; it is then delivered as nil.
+    CustomShadingFinisher finisher;
+    CustomProcessCompletionHandler completion;
+    // Time spent issuing the GL commands of a frame that could have taken the CPU path, -1 if it couldn't; the
+    // finisher's time is added once it has run.
+    int64_t encodeNs = -1;
+    custom::PathCostKey costKey;
+    // Set for frames the quality sampler picked: the drawn frame's input and its CPU equivalent.
+    id qualitySource;
+    CustomCPUFilter *qualityFilter = nil;
+};
+
+// custom::FramePipeline stage backed by GL fence syncs.
+struct GLFenceStage {
+    // Receives every delivered frame, may be nil.
+    CustomFrameHistory *history = nil;
+    CustomPathCostModel *pathCostModel = nil;
+    CustomQualitySampler *qualitySampler = nil;
+
+    bool IsDone(PendingFrame &frame, bool wait) {
+        if (!frame.fence) {
+            return true;
+        }
+        // Only blocking waits are traced, they are the GPU time the pipeline could not hide.
+        custom::StageTrace &trace = custom::StageTrace::Shared();
+        const int64_t waitBeginNs = (wait && trace.enabled()) ? custom::TraceNowNs() : -1;
+        GLenum status = glClientWaitSync(frame.fence.get(), wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? kFenceWaitTimeoutNs : 0);
+        if (waitBeginNs >= 0) {
+            trace.Record(custom::TraceStage::kReadback, frame.timeStampNs, waitBeginNs, custom::TraceNowNs());
+        }
+        if (status == GL_TIMEOUT_EXPIRED) {
+            if (!wait) {
+                return false;
+            }
+            DLog(@"Timed out waiting for the GPU, finishing the frame anyway");
+        }
+        return true;
+    }
+
+    void Complete(PendingFrame frame, int64_t timeStampNs) {
+        frame.fence.reset();
+        CVPixelBufferRef pixelBuffer = NULL;
+        if (frame.finisher) {
+            const int64_t finishBeginNs = custom::TraceNowNs();
+            {
+                custom::ScopedStage conversion(custom::StageTrace::Shared(), custom::TraceStage::kConversion, timeStampNs);
+                pixelBuffer = frame.finisher();
+            }
+            if (pixelBuffer && frame.encodeNs >= 0) {
+                const custom::PathCostKey &key = frame.costKey;
+                [pathCostModel recordCostNs:frame.encodeNs + custom::TraceNowNs() - finishBeginNs
+                                    forPath:CustomProcessingPathGPU
+                                  effectKey:key.effect
+                                pixelFormat:key.format
+                                      width:key.width
+                                     height:key.height];
+            }
+        }
+        if (pixelBuffer && history) {
+            [history pushPixelBuffer:pixelBuffer timeStampNs:timeStampNs];
+        }
+        if (pixelBuffer && frame.qualitySource) {
+            [qualitySampler sampleProcessedPixelBuffer:pixelBuffer
+                                                source:(__bridge CVPixelBufferRef)frame.qualitySource
+                                             cpuFilter:frame.qualityFilter
+                                           timeStampNs:timeStampNs];
+        }
+        if (frame.completion) {
+            frame.completion(pixelBuffer, timeStampNs);
+        }
+        if (pixelBuffer) {
+            CVPixelBufferRelease(pixelBuffer);
+        }
+    }
+};
+
+}  // namespace
+
+@interface CustomPixelBufferProcesser()
+
+@property(nonatomic, strong) EAGLContext *glContext;
+@property(nonatomic, strong) CustomNV12TextureCache *nv12TextureCache;
+@property(nonatomic, strong) CustomI420TextureCache *i420TextureCache;
+@property(nonatomic, assign) int64_t lastDrawnFrameTimeStampNs;
+@property(nonatomic) id<ShaderProtocol> shader;
+
+@end
+
+@implementation CustomPixelBufferProcesser {
+    custom::FramePipeline<PendingFrame> _pipeline;
+}
+
++ (void)warmUpShaders {
+    [CustomTargetShader warmUpProgramCache];
+}
+
+/// Will use default shader
+- (instancetype)init {
+    if (self = [super init]) {
+        if (![self configure]) {
+            return nil;
+        }
+        _shader = [[CustomTargetShader alloc] init];
+        [_shader setGLContext:_glContext];
+    }
+    return self;
+}
+
+/// Use custom shader.
+- (instancetype)initWithShader:(id<ShaderProtocol>)shader {
+    if (self = [super init]) {
+        if (![self configure]) {
+            return nil;
+        }
+        _shader = shader;
+        [_shader setGLContext:_glContext];
+    }
+    return self;
+}
+
+/// Used for init.
+- (BOOL)configure {
+    EAGLContext *glContext = [[EAGLContext alloc] initWithAPI:kEAGLRenderingAPIOpenGLES3];
+    if (!glContext) {
+        glContext = [[EAGLContext alloc] initWithAPI:kEAGLRenderingAPIOpenGLES2];
+    }
+  
+    if (!glContext) {
+        DLog(@"Failed to create EAGLContext");
+        return NO;
+    }
+    _glContext = glContext;
+    _pathCostModel = [[CustomPathCostModel alloc] init];
+
+    // Listen to application state in order to clean up OpenGL before app goes away.
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                         selector:@selector(willResignActive)
+                             name:UIApplicationWillResignActiveNotification
+                           object:nil];
+  
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                         selector:@selector(didBecomeActive)
+                             name:UIApplicationDidBecomeActiveNotification
+                           object:nil];
+    
+    __weak typeof(self)weakSelf = self;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        __strong typeof(weakSelf)strongSelf = weakSelf;
+        if ([[UIApplication sharedApplication] applicationState] == UIApplicationStateActive) {
+          [strongSelf setUpGL];
+        }
+    });
+    return YES;
+}
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    __weak typeof(self)weakSelf = self;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        __strong typeof(weakSelf)strongSelf = weakSelf;
+        UIApplicationState appState =
+            [UIApplication sharedApplication].applicationState;
+        if (appState == UIApplicationStateActive) {
+          [strongSelf tearDownGL];
+        }
+    });
+  
+    [self ensureGLContext];
+    // Pending frames are dropped, their fences are deleted with them.
+    _pipeline.Clear();
+    _shader = nil;
+    if (_glContext && [EAGLContext currentContext] == _glContext) {
+        [EAGLContext setCurrentContext:nil];
+    }
+}
+
+/// Note: This function pass ownership of return value(CVPixelBufferRef) to the caller.
+- (CVPixelBufferRef _Nullable)processBuffer:(CVPixelBufferRef _Nullable)pixelBuffer orientation:(UIInterfaceOrientation)orientation timeStampNs:(int64_t)timeStampNs CF_RETURNS_RETAINED {
+    // Deliver pipelined frames first so results stay in order.
+    if (_pipeline.in_flight() > 0) {
+        [self flushPendingFrames];
+    }
+    CustomCPUFilter *cpuFilter = [self cpuFilterForPixelBuffer:pixelBuffer orientation:orientation];
+    CustomProcessingPath path = [self pathForPixelBuffer:pixelBuffer cpuFilter:cpuFilter];
+    const int64_t beginNs = custom::TraceNowNs();
+    CVPixelBufferRef processedPixelBuffer = NULL;
+    if (path == CustomProcessingPathCPU) {
+        processedPixelBuffer = [self filterPixelBuffer:pixelBuffer withCPUFilter:cpuFilter timeStampNs:timeStampNs];
+    }
+    if (!processedPixelBuffer) {
+        path = CustomProcessingPathGPU;
+        processedPixelBuffer = [self drawPixelBuffer:pixelBuffer orientation:orientation timeStampNs:timeStampNs];
+    }
+    if (processedPixelBuffer && cpuFilter) {
+        [self recordCostNs:custom::TraceNowNs() - beginNs forPath:path pixelBuffer:pixelBuffer cpuFilter:cpuFilter];
+        if (path == CustomProcessingPathGPU && [_qualitySampler shouldSampleFrame]) {
+            [_qualitySampler sampleProcessedPixelBuffer:processedPixelBuffer
+                                                 source:pixelBuffer
+                                              cpuFilter:cpuFilter
+                                            timeStampNs:timeStampNs];
+        }
+    }
+    if (processedPixelBuffer && _frameHistory) {
+        [_frameHistory pushPixelBuffer:processedPixelBuffer timeStampNs:timeStampNs];
+    }
+    return processedPixelBuffer;
+}
+
+- (void)processBuffer:(CVPixelBufferRef _Nullable)pixelBuffer orientation:(UIInterfaceOrientation)orientation timeStampNs:(int64_t)timeStampNs completion:(CustomProcessCompletionHandler)completion {
+    [self ensureGLContext];
+    GLFenceStage stage;
+    stage.history = _frameHistory;
+    stage.pathCostModel = _pathCostModel;
+    stage.qualitySampler = _qualitySampler;
+    // Finish the oldest frames if needed so the render target this draw uses is free.
+    _pipeline.WaitForCapacity(stage);
+
+    PendingFrame frame;
+    frame.timeStampNs = timeStampNs;
+    frame.completion = completion;
+    CustomCPUFilter *cpuFilter = [self cpuFilterForPixelBuffer:pixelBuffer orientation:orientation];
+    const int64_t beginNs = custom::TraceNowNs();
+    if ([self pathForPixelBuffer:pixelBuffer cpuFilter:cpuFilter] == CustomProcessingPathCPU) {
+        // Filtered right away; the frame still goes through the pipeline so completions stay in order.
+        CVPixelBufferRef filteredPixelBuffer = [self filterPixelBuffer:pixelBuffer withCPUFilter:cpuFilter timeStampNs:timeStampNs];
+        if (filteredPixelBuffer) {
+            [self recordCostNs:custom::TraceNowNs() - beginNs forPath:CustomProcessingPathCPU pixelBuffer:pixelBuffer cpuFilter:cpuFilter];
+            id result = CFBridgingRelease(filteredPixelBuffer);
+            frame.finisher = ^CVPixelBufferRef {
+                return CVPixelBufferRetain((__bridge CVPixelBufferRef)result);
+            };
+        }
+    } else {
+        frame.finisher = [self encodeBuffer:pixelBuffer orientation:orientation timeStampNs:timeStampNs];
+        if (frame.finisher && cpuFilter) {
+            frame.encodeNs = custom::TraceNowNs() - beginNs;
+            frame.costKey = [self costKeyForPixelBuffer:pixelBuffer cpuFilter:cpuFilter];
+            if ([_qualitySampler shouldSampleFrame]) {
+                frame.qualitySource = (__bridge id)pixelBuffer;
+                frame.qualityFilter = cpuFilter;
+            }
+        }
+        if (frame.finisher && _glContext.API == kEAGLRenderingAPIOpenGLES3) {
+            frame.fence.reset(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+            glFlush();
+        }
+    }
+    _pipeline.Submit(timeStampNs, std::move(frame));
+
+    // Usually completes the previous frame, whose conversion then overlaps this frame's draw on the GPU.
+    _pipeline.Poll(stage);
+}
+
+- (void)flushPendingFrames {
+    [self ensureGLContext];
+    GLFenceStage stage;
+    stage.history = _frameHistory;
+    stage.pathCostModel = _pathCostModel;
+    stage.qualitySampler = _qualitySampler;
+    _pipeline.Flush(stage);
+}
+
+- (NSUInteger)maxFramesInFlight {
+    return _pipeline.max_in_flight();
+}
+
+- (void)setMaxFramesInFlight:(NSUInteger)maxFramesInFlight {
+    _pipeline.set_max_in_flight(std::min<size_t>(maxFramesInFlight, kMaxFramesInFlight));
+}
+
+- (NSUInteger)frameHistoryDepth {
+    return _frameHistory.capacity;
+}
+
+- (void)setFrameHistoryDepth:(NSUInteger)frameHistoryDepth {
+    if (frameHistoryDepth == 0) {
+        _frameHistory = nil;
+    } else if (frameHistoryDepth != _frameHistory.capacity) {
+        _frameHistory = [[CustomFrameHistory alloc] initWithCapacity:frameHistoryDepth];
+    }
+}
+
+- (BOOL)shouldProcessFrameBuffer {
+    return YES;
+}
+
+#pragma mark - Private
+
+/// Draws |pixelBuffer| and waits for the result.
+- (nullable CVPixelBufferRef)drawPixelBuffer:(CVPixelBufferRef _Nullable)pixelBuffer orientation:(UIInterfaceOrientation)orientation timeStampNs:(int64_t)timeStampNs CF_RETURNS_RETAINED {
+    CustomShadingFinisher finisher = [self encodeBuffer:pixelBuffer orientation:orientation timeStampNs:timeStampNs];
+    if (!finisher) {
+        return nil;
+    }
+    custom::StageTrace &trace = custom::StageTrace::Shared();
+    if (trace.enabled()) {
+        // Wait explicitly so the GPU's share is not counted as conversion, which would otherwise wait implicitly.
+        custom::ScopedStage readback(trace, custom::TraceStage::kReadback, timeStampNs);
+        glFinish();
+    }
+    custom::ScopedStage conversion(trace, custom::TraceStage::kConversion, timeStampNs);
+    return finisher();
+}
+
+/// The shader's CPU equivalent for |pixelBuffer|, nil if the frame has to be drawn.
+- (nullable CustomCPUFilter *)cpuFilterForPixelBuffer:(CVPixelBufferRef _Nullable)pixelBuffer orientation:(UIInterfaceOrientation)orientation {
+    if (!pixelBuffer || _processingPath == CustomProcessingPathGPU ||
+        ![_shader respondsToSelector:@selector(cpuFilterForPixelFormat:orientation:)]) {
+        return nil;
+    }
+    return [_shader cpuFilterForPixelFormat:CVPixelBufferGetPixelFormatType(pixelBuffer) orientation:orientation];
+}
+
+- (CustomProcessingPath)pathForPixelBuffer:(CVPixelBufferRef _Nullable)pixelBuffer cpuFilter:(nullable CustomCPUFilter *)cpuFilter {
+    if (!cpuFilter) {
+        return CustomProcessingPathGPU;
+    }
+    if (_processingPath == CustomProcessingPathCPU) {
+        return CustomProcessingPathCPU;
+    }
+    const custom::PathCostKey key = [self costKeyForPixelBuffer:pixelBuffer cpuFilter:cpuFilter];
+    return [_pathCostModel choosePathForEffectKey:key.effect pixelFormat:key.format width:key.width height:key.height];
+}
+
+- (custom::PathCostKey)costKeyForPixelBuffer:(CVPixelBufferRef)pixelBuffer cpuFilter:(CustomCPUFilter *)cpuFilter {
+    custom::PathCostKey key;
+    key.effect = cpuFilter.effectKey;
+    key.format = CVPixelBufferGetPixelFormatType(pixelBuffer);
+    key.width = (int)CVPixelBufferGetWidth(pixelBuffer);
+    key.height = (int)CVPixelBufferGetHeight(pixelBuffer);
+    return key;
+}
+
+- (void)recordCostNs:(int64_t)costNs forPath:(CustomProcessingPath)path pixelBuffer:(CVPixelBufferRef)pixelBuffer cpuFilter:(CustomCPUFilter *)cpuFilter {
+    const custom::PathCostKey key = [self costKeyForPixelBuffer:pixelBuffer cpuFilter:cpuFilter];
+    [_pathCostModel recordCostNs:costNs forPath:path effectKey:key.effect pixelFormat:key.format width:key.width height:key.height];
+}
+
+/// The CPU path: filters |pixelBuffer| into a pooled buffer without touching GL.
+- (nullable CVPixelBufferRef)filterPixelBuffer:(CVPixelBufferRef)pixelBuffer withCPUFilter:(CustomCPUFilter *)cpuFilter timeStampNs:(int64_t)timeStampNs CF_RETURNS_RETAINED {
+    if (timeStampNs == _lastDrawnFrameTimeStampNs) {
+        return nil;
+    }
+    custom::ScopedStage conversion(custom::StageTrace::Shared(), custom::TraceStage::kConversion, timeStampNs);
+    CVPixelBufferRef filteredPixelBuffer = [cpuFilter filteredPixelBuffer:pixelBuffer];
+    if (filteredPixelBuffer) {
+        _lastDrawnFrameTimeStampNs = timeStampNs;
+    }
+    return filteredPixelBuffer;
+}
+
+/// Uploads |pixelBuffer| and issues the shader's draw. Returns the block finishing the frame, or nil if there is
+/// nothing to deliver. Shaders without deferred methods are run synchronously and their result wrapped.
+- (nullable CustomShadingFinisher)encodeBuffer:(CVPixelBufferRef _Nullable)pixelBuffer orientation:(UIInterfaceOrientation)orientation timeStampNs:(int64_t)timeStampNs {
+    // The renderer will draw the frame to the framebuffer corresponding to the
+    // one used by |view|.
+    if (!pixelBuffer || timeStampNs == _lastDrawnFrameTimeStampNs) {
+        return nil;
+    }
+  
+    [self ensureGLContext];
+    glClear(GL_COLOR_BUFFER_BIT);
+    
+    CustomShadingFinisher finisher = nil;
+    CVPixelBufferRef resPixelBuffer = NULL;
+    size_t width = CVPixelBufferGetWidth(pixelBuffer);
+    size_t height = CVPixelBufferGetHeight(pixelBuffer);
+    
+    custom::StageTrace &trace = custom::StageTrace::Shared();
+    OSType pixelFormatType = CVPixelBufferGetPixelFormatType(pixelBuffer);
+    if (pixelFormatType == kCVPixelFormatType_420YpCbCr8BiPlanarFullRange) {
+        // 上传pixel buffer到OpenGL ES
+        {
+            custom::ScopedStage upload(trace, custom::TraceStage::kUpload, timeStampNs);
+            [self.nv12TextureCache uploadFrameToTextures:pixelBuffer];
+        }
+        // 应用着色器(包含绘制)
+        custom::ScopedStage draw(trace, custom::TraceStage::kDraw, timeStampNs);
+        if ([_shader respondsToSelector:@selector(encodeShadingForTextureWithWidth:height:orientation:yPlane:uvPlane:)]) {
+            finisher = [_shader encodeShadingForTextureWithWidth:(int)width height:(int)height orientation:orientation yPlane:self.nv12TextureCache.yTexture uvPlane:self.nv12TextureCache.uvTexture];
+        } else {
+            resPixelBuffer = [_shader applyShadingForTextureWithWidth:(int)width height:(int)height orientation:orientation yPlane:self.nv12TextureCache.yTexture uvPlane:self.nv12TextureCache.uvTexture];
+        }
+      
+        [self.nv12TextureCache releaseTextures];
+    } else {
+        BOOL uploaded = NO;
+        {
+            custom::ScopedStage upload(trace, custom::TraceStage::kUpload, timeStampNs);
+            uploaded = [self.i420TextureCache uploadFrameToTextures:pixelBuffer];
+        }
+        if (!uploaded) {
+            return nil;
+        }
+        custom::ScopedStage draw(trace, custom::TraceStage::kDraw, timeStampNs);
+        if ([_shader respondsToSelector:@selector(encodeShadingForTextureWithWidth:height:orientation:yPlane:uPlane:vPlane:)]) {
+            finisher = [_shader encodeShadingForTextureWithWidth:(int)width height:(int)height orientation:orientation yPlane:self.i420TextureCache.yTexture uPlane:self.i420TextureCache.uTexture vPlane:self.i420TextureCache.vTexture];
+        } else {
+            resPixelBuffer = [_shader applyShadingForTextureWithWidth:(int)width height:(int)height orientation:orientation yPlane:self.i420TextureCache.yTexture uPlane:self.i420TextureCache.uTexture vPlane:self.i420TextureCache.vTexture];
+        }
+    }
+    
+    _lastDrawnFrameTimeStampNs = timeStampNs;
+
+    if (resPixelBuffer) {
+        id result = CFBridgingRelease(resPixelBuffer);
+        finisher = ^CVPixelBufferRef {
+            return CVPixelBufferRetain((__bridge CVPixelBufferRef)result);
+        };
+    }
+    return finisher;
+}
+
+- (void)setUpGL {
+    [self ensureGLContext];
+    glDisable(GL_DITHER);
+}
+
+- (void)tearDownGL {
+    [self ensureGLContext];
+    _nv12TextureCache = nil;
+    _i420TextureCache = nil;
+}
+
+- (void)didBecomeActive {
+    [self setUpGL];
+}
+
+- (void)willResignActive {
+    [self tearDownGL];
+}
+
+- (void)ensureGLContext {
+    NSAssert(_glContext, @"context shouldn't be nil");
+    if ([EAGLContext currentContext] != _glContext) {
+        [EAGLContext setCurrentContext:_glContext];
+    }
+}
+
+- (CustomNV12TextureCache *)nv12TextureCache {
+    if (!_nv12TextureCache) {
+      _nv12TextureCache = [[CustomNV12TextureCache alloc] initWithContext:_glContext];
+    }
+    return _nv12TextureCache;
+}
+
+- (CustomI420TextureCache *)i420TextureCache {
+    if (!_i420TextureCache) {
+      _i420TextureCache = [[CustomI420TextureCache alloc] initWithContext:_glContext];
+    }
+    return _i420TextureCache;
+}
+
+@end
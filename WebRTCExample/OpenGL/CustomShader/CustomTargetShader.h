@@ -20,6 +20,20 @@ NS_ASSUME_NONNULL_BEGIN
 
 @property(nonatomic, readonly) EAGLContext *glContext;
 
+/// GL and CoreVideo objects created so far: the texture cache, render target pixel buffers, textures and framebuffers.
+/// Every creation is also logged with its frame number, except the two plane textures the direct NV12 path creates
+/// around each output buffer.
+@property(nonatomic, readonly) uint64_t allocationCount;
+
+/// Frames processed in a row without creating any of the objects above. On the BGRA readback path it keeps growing once
+/// the render targets for the current resolution exist. The direct NV12 path, the default on ES3, is not allocation
+/// free: it creates two plane textures every frame, so this stays 0 there.
+@property(nonatomic, readonly) uint64_t framesSinceLastAllocation;
+
+/// Builds every program of this shader once on a background context, so CustomProgramCache holds their binaries before
+/// the first frame needs them. Call at app start; returns immediately.
++ (void)warmUpProgramCache;
+
 /// glContext used for creating texture cache and should the same as the one which used for process pixel buffer. And the glContext will set value by CustomPixelBufferProcesser.
 - (void)setGLContext:(EAGLContext *)glContext;
 
@@ -31,6 +45,15 @@ NS_ASSUME_NONNULL_BEGIN
                                yPlane:(GLuint)yPlane
                               uvPlane:(GLuint)uvPlane CF_RETURNS_RETAINED;
 
+/// Deferred variant of the I420 callback. Only issues the GL commands; the returned block produces the output buffer
+/// once the GPU has finished them.
+- (nullable CustomShadingFinisher)encodeShadingForTextureWithWidth:(int)width height:(int)height orientation:(UIInterfaceOrientation)orientation yPlane:(GLuint)yPlane uPlane:(GLuint)uPlane vPlane:(GLuint)vPlane;
+
+/// Deferred variant of the NV12 callback.
+- (nullable CustomShadingFinisher)encodeShadingForTextureWithWidth:(int)width height:(int)height orientation:(UIInterfaceOrientation)orientation
+                                                            yPlane:(GLuint)yPlane
+                                                           uvPlane:(GLuint)uvPlane;
+
 @end
 
 NS_ASSUME_NONNULL_END
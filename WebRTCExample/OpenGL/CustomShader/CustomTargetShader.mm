@@ -9,6 +9,16 @@
 #import "CustomOpenGLDefines.h"
 #import "CustomShaderUtil.h"
 #import "CustomPixelBufferUtils.h"
+#import "CustomPixelBufferPool.h"
+#import "CustomProgramCache.h"
+#import "CustomGLResources.h"
+#import "CustomCPUFilter.h"
+
+#include <memory>
+
+#include "AllocationTrace.h"
+#include "RenderTargetRing.h"
+#include "YuvConversion.h"
 
 static const int kYTextureUnit = 0;
 static const int kUTextureUnit = 1;
@@ -28,51 +38,136 @@ const char kVertexShaderSource[] =
 
 // Fragment shader converts YUV values from input textures into a final RGB
 // pixel. The conversion formula is from http://www.fourcc.org/fccyvrgb.php.
+#define I420_SAMPLE_RGB_SOURCE \
+  "uniform lowp sampler2D s_textureY;\n" \
+  "uniform lowp sampler2D s_textureU;\n" \
+  "uniform lowp sampler2D s_textureV;\n" \
+  "vec3 sampleRGB(highp vec2 texcoord) {\n" \
+  "    float y, u, v;\n" \
+  "    y = " FRAGMENT_SHADER_TEXTURE "(s_textureY, texcoord).r;\n" \
+  "    u = " FRAGMENT_SHADER_TEXTURE "(s_textureU, texcoord).r - 0.5;\n" \
+  "    v = " FRAGMENT_SHADER_TEXTURE "(s_textureV, texcoord).r - 0.5;\n" \
+  "    return vec3(y + 1.403 * v, y - 0.344 * u - 0.714 * v, y + 1.770 * u);\n" \
+  "}\n"
+
+#define NV12_SAMPLE_RGB_SOURCE \
+  "uniform lowp sampler2D s_textureY;\n" \
+  "uniform lowp sampler2D s_textureUV;\n" \
+  "vec3 sampleRGB(highp vec2 texcoord) {\n" \
+  "    float y = " FRAGMENT_SHADER_TEXTURE "(s_textureY, texcoord).r;\n" \
+  "    vec2 uv = " FRAGMENT_SHADER_TEXTURE "(s_textureUV, texcoord).ra - vec2(0.5, 0.5);\n" \
+  "    return vec3(y + 1.403 * uv.y, y - 0.344 * uv.x - 0.714 * uv.y, y + 1.770 * uv.x);\n" \
+  "}\n"
+
+#define PASSTHROUGH_FILTER_SOURCE \
+  "vec3 applyFilter(vec3 rgb) {\n" \
+  "    return rgb;\n" \
+  "}\n"
+
+// 简单的灰度滤镜: 原理 -> float color = (r + g + b) / 3.0 -> gl_FragColor = vec4(color,color,color,1.0)
+#define GRAYSCALE_FILTER_SOURCE \
+  "vec3 applyFilter(vec3 rgb) {\n" \
+  "    float color = (rgb.r + rgb.g + rgb.b) / 3.0;\n" \
+  "    return vec3(color, color, color);\n" \
+  "}\n"
+
+// Writes the filtered RGB pixel.
+#define RGB_OUTPUT_SOURCE \
+  FRAGMENT_SHADER_OUT \
+  "void main() {\n" \
+  "    " FRAGMENT_SHADER_COLOR " = vec4(applyFilter(sampleRGB(v_texcoord)), 1.0);\n" \
+  "  }\n"
+
+// Writes the luma of the filtered pixel into the R8 view of an NV12 plane 0.
+// The coefficients come from custom::kBT601VideoRange, see YuvConversion.h.
+#define Y_OUTPUT_SOURCE \
+  "uniform highp vec3 u_yCoefficients;\n" \
+  "uniform highp vec3 u_yuvOffset;\n" \
+  FRAGMENT_SHADER_OUT \
+  "void main() {\n" \
+  "    highp vec3 rgb = clamp(applyFilter(sampleRGB(v_texcoord)), 0.0, 1.0);\n" \
+  "    " FRAGMENT_SHADER_COLOR " = vec4(dot(rgb, u_yCoefficients) + u_yuvOffset.x, 0.0, 0.0, 1.0);\n" \
+  "  }\n"
+
+// Writes interleaved chroma into the RG8 view of an NV12 plane 1. The target
+// is half size, so every fragment covers a 2x2 luma block; the taps from
+// custom::ComputeChromaTaps are given in luma pixels of the output and mapped
+// back to texture space with the screen space derivatives, which also takes
+// care of the rotation baked into the vertex data.
+#define UV_OUTPUT_SOURCE \
+  "uniform highp vec3 u_uCoefficients;\n" \
+  "uniform highp vec3 u_vCoefficients;\n" \
+  "uniform highp vec3 u_yuvOffset;\n" \
+  "uniform highp vec3 u_chromaTaps[4];\n" \
+  FRAGMENT_SHADER_OUT \
+  "void main() {\n" \
+  "    highp vec2 dx = dFdx(v_texcoord) * 0.5;\n" \
+  "    highp vec2 dy = dFdy(v_texcoord) * 0.5;\n" \
+  "    highp vec3 rgb = vec3(0.0);\n" \
+  "    for (int i = 0; i < 4; i++) {\n" \
+  "        highp vec2 texcoord = v_texcoord + u_chromaTaps[i].x * dx + u_chromaTaps[i].y * dy;\n" \
+  "        rgb += u_chromaTaps[i].z * clamp(applyFilter(sampleRGB(texcoord)), 0.0, 1.0);\n" \
+  "    }\n" \
+  "    " FRAGMENT_SHADER_COLOR " = vec4(dot(rgb, u_uCoefficients) + u_yuvOffset.y,\n" \
+  "                                     dot(rgb, u_vCoefficients) + u_yuvOffset.z,\n" \
+  "                                     0.0, 1.0);\n" \
+  "  }\n"
+
+#if TARGET_OS_IPHONE
+#define DERIVATIVES_EXTENSION "#extension GL_OES_standard_derivatives : enable\n"
+#else
+#define DERIVATIVES_EXTENSION
+#endif
+
 static const char kI420FragmentShaderSource[] =
   SHADER_VERSION
   "precision highp float;"
   FRAGMENT_SHADER_IN " vec2 v_texcoord;\n"
-  "uniform lowp sampler2D s_textureY;\n"
-  "uniform lowp sampler2D s_textureU;\n"
-  "uniform lowp sampler2D s_textureV;\n"
-  FRAGMENT_SHADER_OUT
-  "void main() {\n"
-  "    float y, u, v, r, g, b;\n"
-  "    y = " FRAGMENT_SHADER_TEXTURE "(s_textureY, v_texcoord).r;\n"
-  "    u = " FRAGMENT_SHADER_TEXTURE "(s_textureU, v_texcoord).r;\n"
-  "    v = " FRAGMENT_SHADER_TEXTURE "(s_textureV, v_texcoord).r;\n"
-  "    u = u - 0.5;\n"
-  "    v = v - 0.5;\n"
-  "    r = y + 1.403 * v;\n"
-  "    g = y - 0.344 * u - 0.714 * v;\n"
-  "    b = y + 1.770 * u;\n"
-  "    " FRAGMENT_SHADER_COLOR " = vec4(r, g, b, 1.0);\n"
-  "  }\n";
-
-// 简单的灰度滤镜片段着色器: 原理 -> float color = (r + g + b) / 3.0 -> gl_FragColor = vec4(color,color,color,1.0)
+  I420_SAMPLE_RGB_SOURCE
+  PASSTHROUGH_FILTER_SOURCE
+  RGB_OUTPUT_SOURCE;
+
 static const char kNV12FragmentShaderSource[] =
   SHADER_VERSION
   "precision mediump float;"
   FRAGMENT_SHADER_IN " vec2 v_texcoord;\n"
-  "uniform lowp sampler2D s_textureY;\n"
-  "uniform lowp sampler2D s_textureUV;\n"
-  FRAGMENT_SHADER_OUT
-  "void main() {\n"
-  "    mediump float y;\n"
-  "    mediump vec2 uv;\n"
-  "    y = " FRAGMENT_SHADER_TEXTURE "(s_textureY, v_texcoord).r;\n"
-  "    uv = " FRAGMENT_SHADER_TEXTURE "(s_textureUV, v_texcoord).ra -\n"
-  "        vec2(0.5, 0.5);\n"
-  "    mediump float r,g,b,color;\n"
-  "    r = y + 1.403 * uv.y;\n"
-  "    g = y - 0.344 * uv.x - 0.714 * uv.y;\n"
-  "    b = y + 1.770 * uv.x;\n"
-  "    color = (r + g + b) / 3.0;\n"
-  "    " FRAGMENT_SHADER_COLOR " = vec4(color,\n"
-  "                                     color,\n"
-  "                                     color,\n"
-  "                                     1.0);\n"
-  "  }\n";
+  NV12_SAMPLE_RGB_SOURCE
+  GRAYSCALE_FILTER_SOURCE
+  RGB_OUTPUT_SOURCE;
+
+static const char kI420ToYFragmentShaderSource[] =
+  SHADER_VERSION
+  "precision highp float;"
+  FRAGMENT_SHADER_IN " vec2 v_texcoord;\n"
+  I420_SAMPLE_RGB_SOURCE
+  PASSTHROUGH_FILTER_SOURCE
+  Y_OUTPUT_SOURCE;
+
+static const char kI420ToUVFragmentShaderSource[] =
+  SHADER_VERSION
+  DERIVATIVES_EXTENSION
+  "precision highp float;"
+  FRAGMENT_SHADER_IN " vec2 v_texcoord;\n"
+  I420_SAMPLE_RGB_SOURCE
+  PASSTHROUGH_FILTER_SOURCE
+  UV_OUTPUT_SOURCE;
+
+static const char kNV12ToYFragmentShaderSource[] =
+  SHADER_VERSION
+  "precision mediump float;"
+  FRAGMENT_SHADER_IN " vec2 v_texcoord;\n"
+  NV12_SAMPLE_RGB_SOURCE
+  GRAYSCALE_FILTER_SOURCE
+  Y_OUTPUT_SOURCE;
+
+static const char kNV12ToUVFragmentShaderSource[] =
+  SHADER_VERSION
+  DERIVATIVES_EXTENSION
+  "precision mediump float;"
+  FRAGMENT_SHADER_IN " vec2 v_texcoord;\n"
+  NV12_SAMPLE_RGB_SOURCE
+  GRAYSCALE_FILTER_SOURCE
+  UV_OUTPUT_SOURCE;
 
 // 原始片段着色器
 //static const char kNV12FragmentShaderSource[] =
@@ -94,110 +189,282 @@ static const char kNV12FragmentShaderSource[] =
 //  "                                     1.0);\n"
 //  "  }\n";
 
+namespace {
+
+// A BGRA pixel buffer mapped as a texture and attached to its own framebuffer, kept across frames.
+struct BGRARenderTarget {
+    CVPixelBufferRef pixelBuffer = NULL;
+    CVOpenGLESTextureRef texture = NULL;
+    GLuint frameBuffer = 0;
+
+    ~BGRARenderTarget() {
+        if (frameBuffer) {
+            glDeleteFramebuffers(1, &frameBuffer);
+        }
+        if (texture) {
+            CFRelease(texture);
+        }
+        if (pixelBuffer) {
+            CVPixelBufferRelease(pixelBuffer);
+        }
+    }
+};
+
+}  // namespace
+
 @interface CustomTargetShader()
 
+/*Programs, vertex buffer and sampler are shared with other shaders of the glContext's sharegroup.*/
+@property(nonatomic, strong) CustomGLResources *resources;
 @property(nonatomic, assign) GLuint VBO;
-@property(nonatomic, assign) GLuint VAO;
+@property(nonatomic, assign) GLuint sampler;
 @property(nonatomic, assign) GLuint nv12Program;
 @property(nonatomic, assign) GLuint i420Program;
+/*Programs writing the Y and UV planes of an NV12 output buffer.*/
+@property(nonatomic, assign) GLuint nv12ToYProgram;
+@property(nonatomic, assign) GLuint nv12ToUVProgram;
+@property(nonatomic, assign) GLuint i420ToYProgram;
+@property(nonatomic, assign) GLuint i420ToUVProgram;
+/*Maps the BGRA render targets and the planes of NV12 output buffers as textures.*/
+@property(nonatomic, assign) CVOpenGLESTextureCacheRef textureCache;
+/*R8 and RG8 render targets need OpenGL ES 3, otherwise fall back to rendering BGRA and converting on the CPU.*/
+@property(nonatomic, assign) BOOL rendersYUVDirectly;
 @property(nonatomic, strong) EAGLContext *glContext;
-/*Store current rotation and only upload new vertex data when rotation changes.*/
-@property(nonatomic, assign) CustomVideoRotation currentRotation;
+/*First vertex of the quad for the current rotation in the shared vertex buffer.*/
+@property(nonatomic, assign) GLint firstVertex;
 @property(nonatomic) GLuint frameBuffer;
 
 @end
 
-@implementation CustomTargetShader
+@implementation CustomTargetShader {
+    custom::RenderTargetRing<BGRARenderTarget> _bgraRenderTargets;
+    custom::AllocationTrace _allocationTrace;
+    // CPU equivalents of the NV12 and I420 programs, created on first use.
+    CustomCPUFilter *_nv12CPUFilter;
+    CustomCPUFilter *_i420CPUFilter;
+}
+
++ (void)warmUpProgramCache {
+    [[CustomProgramCache sharedCache] warmUpWithBlock:^{
+        const char *fragmentShaderSources[] = {
+            kI420FragmentShaderSource,
+            kNV12FragmentShaderSource,
+            kI420ToYFragmentShaderSource,
+            kI420ToUVFragmentShaderSource,
+            kNV12ToYFragmentShaderSource,
+            kNV12ToUVFragmentShaderSource,
+        };
+        for (const char *fragmentShaderSource : fragmentShaderSources) {
+            glDeleteProgram([[CustomProgramCache sharedCache] createProgramWithVertexShaderSource:kVertexShaderSource fragmentShaderSource:fragmentShaderSource]);
+        }
+    }];
+}
 
 /// glContext used for creating texture cache and should the same as the one which used for process pixel buffer. And the glContext will set value by CustomPixelBufferProcesser.
 - (void)setGLContext:(EAGLContext *)glContext {
     _glContext = glContext;
+    _resources = [CustomGLResources resourcesForContext:glContext];
     _frameBuffer = -1;
+    _rendersYUVDirectly = glContext.API == kEAGLRenderingAPIOpenGLES3;
 }
 
 - (void)dealloc {
-    glDeleteProgram(_nv12Program);
-    glDeleteProgram(_i420Program);
-    glDeleteBuffers(1, &_VBO);
-    glDeleteVertexArrays(1, &_VAO);
+    [_resources releaseProgram:_nv12Program];
+    [_resources releaseProgram:_i420Program];
+    [_resources releaseProgram:_nv12ToYProgram];
+    [_resources releaseProgram:_nv12ToUVProgram];
+    [_resources releaseProgram:_i420ToYProgram];
+    [_resources releaseProgram:_i420ToUVProgram];
+    [_resources releaseVertexBuffer:_VBO];
+    [_resources releaseSampler:_sampler];
+    _bgraRenderTargets.Clear();
+    if (_textureCache) {
+        CFRelease(_textureCache);
+    }
     glDeleteFramebuffers(1, &_frameBuffer);
 }
 
+- (uint64_t)allocationCount {
+    return _allocationTrace.stats().allocations;
+}
+
+- (uint64_t)framesSinceLastAllocation {
+    return _allocationTrace.stats().steady_frames;
+}
+
 - (BOOL)createAndSetupI420Program {
   NSAssert(!_i420Program, @"I420 program already created");
-    _i420Program = [CustomShaderUtil createProgramWithVertexShaderSource:kVertexShaderSource fragmentShaderSource:kI420FragmentShaderSource];
-  if (!_i420Program) {
-    return NO;
-  }
-  GLint ySampler = glGetUniformLocation(_i420Program, "s_textureY");
-  GLint uSampler = glGetUniformLocation(_i420Program, "s_textureU");
-  GLint vSampler = glGetUniformLocation(_i420Program, "s_textureV");
-
-  if (ySampler < 0 || uSampler < 0 || vSampler < 0) {
-    DLog(@"Failed to get uniform variable locations in I420 shader");
-    glDeleteProgram(_i420Program);
-    _i420Program = 0;
-    return NO;
-  }
-
-  glUseProgram(_i420Program);
-  glUniform1i(ySampler, kYTextureUnit);
-  glUniform1i(uSampler, kUTextureUnit);
-  glUniform1i(vSampler, kVTextureUnit);
-
-  return YES;
+    _i420Program = [_resources acquireProgramWithVertexShaderSource:kVertexShaderSource fragmentShaderSource:kI420FragmentShaderSource setup:^BOOL(GLuint program) {
+        GLint ySampler = glGetUniformLocation(program, "s_textureY");
+        GLint uSampler = glGetUniformLocation(program, "s_textureU");
+        GLint vSampler = glGetUniformLocation(program, "s_textureV");
+
+        if (ySampler < 0 || uSampler < 0 || vSampler < 0) {
+            DLog(@"Failed to get uniform variable locations in I420 shader");
+            return NO;
+        }
+
+        glUniform1i(ySampler, kYTextureUnit);
+        glUniform1i(uSampler, kUTextureUnit);
+        glUniform1i(vSampler, kVTextureUnit);
+        return YES;
+    }];
+  return _i420Program != 0;
 }
 
 /// 创建着色器程序，顶点着色器, 片段着色器，并且编译链接着色器.
 - (BOOL)createAndSetupNV12Program {
     NSAssert(!_nv12Program, @"NV12 program already created");
-    _nv12Program = [CustomShaderUtil createProgramWithVertexShaderSource:kVertexShaderSource fragmentShaderSource:kNV12FragmentShaderSource];
-  
-    if (!_nv12Program) {
+    _nv12Program = [_resources acquireProgramWithVertexShaderSource:kVertexShaderSource fragmentShaderSource:kNV12FragmentShaderSource setup:^BOOL(GLuint program) {
+        GLint ySampler = glGetUniformLocation(program, "s_textureY");
+        GLint uvSampler = glGetUniformLocation(program, "s_textureUV");
+
+        if (ySampler < 0 || uvSampler < 0) {
+            DLog(@"Failed to get uniform variable locations in NV12 shader");
+            return NO;
+        }
+
+        glUniform1i(ySampler, kYTextureUnit);
+        glUniform1i(uvSampler, kUvTextureUnit);
+        return YES;
+    }];
+    return _nv12Program != 0;
+}
+
+/// Creates a program writing one plane of an NV12 output buffer. |samplers| are the input sampler names, each one is
+/// bound to the texture unit of its index. The RGB->YUV coefficients and chroma taps come from YuvConversion.h so the
+/// output matches the libyuv conversion of the BGRA path.
+- (GLuint)createYUVOutputProgramWithFragmentShaderSource:(const char [_Nonnull])fragmentShaderSource samplers:(NSArray<NSString *> *)samplers {
+    return [_resources acquireProgramWithVertexShaderSource:kVertexShaderSource fragmentShaderSource:fragmentShaderSource setup:^BOOL(GLuint program) {
+        for (NSUInteger i = 0; i < samplers.count; i++) {
+            GLint sampler = glGetUniformLocation(program, samplers[i].UTF8String);
+            if (sampler < 0) {
+                DLog(@"Failed to get uniform variable locations in YUV output shader");
+                return NO;
+            }
+            glUniform1i(sampler, static_cast<GLint>(i));
+        }
+
+        // Uniforms a program doesn't use have location -1 and are ignored.
+        const custom::ShaderYuvMatrix matrix = custom::MakeShaderYuvMatrix(custom::kBT601VideoRange);
+        glUniform3fv(glGetUniformLocation(program, "u_yCoefficients"), 1, matrix.y);
+        glUniform3fv(glGetUniformLocation(program, "u_uCoefficients"), 1, matrix.u);
+        glUniform3fv(glGetUniformLocation(program, "u_vCoefficients"), 1, matrix.v);
+        glUniform3fv(glGetUniformLocation(program, "u_yuvOffset"), 1, matrix.offset);
+
+        custom::ChromaTap taps[custom::kChromaTapCount];
+        custom::ComputeChromaTaps(custom::ChromaSiting::kCenter, taps);
+        glUniform3fv(glGetUniformLocation(program, "u_chromaTaps"), custom::kChromaTapCount, &taps[0].x);
+        return YES;
+    }];
+}
+
+- (BOOL)createAndSetupNV12OutputPrograms {
+    NSArray<NSString *> *samplers = @[@"s_textureY", @"s_textureUV"];
+    _nv12ToYProgram = [self createYUVOutputProgramWithFragmentShaderSource:kNV12ToYFragmentShaderSource samplers:samplers];
+    _nv12ToUVProgram = [self createYUVOutputProgramWithFragmentShaderSource:kNV12ToUVFragmentShaderSource samplers:samplers];
+    if (!_nv12ToYProgram || !_nv12ToUVProgram) {
+        [_resources releaseProgram:_nv12ToYProgram];
+        [_resources releaseProgram:_nv12ToUVProgram];
+        _nv12ToYProgram = 0;
+        _nv12ToUVProgram = 0;
         return NO;
     }
-    
-    GLint ySampler = glGetUniformLocation(_nv12Program, "s_textureY");
-    GLint uvSampler = glGetUniformLocation(_nv12Program, "s_textureUV");
+    return YES;
+}
 
-    if (ySampler < 0 || uvSampler < 0) {
-        DLog(@"Failed to get uniform variable locations in NV12 shader");
-        glDeleteProgram(_nv12Program);
-        _nv12Program = 0;
+- (BOOL)createAndSetupI420OutputPrograms {
+    NSArray<NSString *> *samplers = @[@"s_textureY", @"s_textureU", @"s_textureV"];
+    _i420ToYProgram = [self createYUVOutputProgramWithFragmentShaderSource:kI420ToYFragmentShaderSource samplers:samplers];
+    _i420ToUVProgram = [self createYUVOutputProgramWithFragmentShaderSource:kI420ToUVFragmentShaderSource samplers:samplers];
+    if (!_i420ToYProgram || !_i420ToUVProgram) {
+        [_resources releaseProgram:_i420ToYProgram];
+        [_resources releaseProgram:_i420ToUVProgram];
+        _i420ToYProgram = 0;
+        _i420ToUVProgram = 0;
         return NO;
     }
+    return YES;
+}
 
-    glUseProgram(_nv12Program);
-    glUniform1i(ySampler, kYTextureUnit);
-    glUniform1i(uvSampler, kUvTextureUnit);
+/// Returns the next render target of the ring, creating all of them when the size changes. In steady state this
+/// creates no GL or CoreVideo objects; the targets keep their texture and framebuffer attachment across frames.
+- (nullable BGRARenderTarget *)nextBGRARenderTargetWithWidth:(int)width height:(int)height {
+    if (![self prepareTextureCache]) {
+        return nil;
+    }
 
-    return YES;
+    custom::FrameBufferKey key;
+    key.width = width;
+    key.height = height;
+    key.format = kCVPixelFormatType_32BGRA;
+    return _bgraRenderTargets.Next(key, [self](const custom::FrameBufferKey &targetKey) -> std::unique_ptr<BGRARenderTarget> {
+        auto target = std::make_unique<BGRARenderTarget>();
+        target->pixelBuffer = [CustomPixelBufferUtils createEmptyPixelBuffer:kCVPixelFormatType_32BGRA targetSize:CGSizeMake(targetKey.width, targetKey.height)];
+        if (!target->pixelBuffer) {
+            return nullptr;
+        }
+        [self traceAllocation:"BGRA pixel buffer"];
+
+        CVReturn ret = CVOpenGLESTextureCacheCreateTextureFromImage(kCFAllocatorDefault, self.textureCache, target->pixelBuffer, NULL, GL_TEXTURE_2D, GL_RGBA, static_cast<GLsizei>(targetKey.width), static_cast<GLsizei>(targetKey.height), GL_BGRA, GL_UNSIGNED_BYTE, 0, &target->texture);
+        if (ret != kCVReturnSuccess) {
+            DLog(@"CVOpenGLESTextureCacheCreateTextureFromImage faild");
+            return nullptr;
+        }
+        [self traceAllocation:"BGRA texture"];
+
+        // The storage belongs to the IOSurface, only the sampling state is set here.
+        glBindTexture(CVOpenGLESTextureGetTarget(target->texture), CVOpenGLESTextureGetName(target->texture));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenFramebuffers(1, &target->frameBuffer);
+        [self traceAllocation:"framebuffer"];
+        glBindFramebuffer(GL_FRAMEBUFFER, target->frameBuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, CVOpenGLESTextureGetName(target->texture), 0);
+        GLenum fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
+            DLog(@"ERROR::FRAMEBUFFER:: Framebuffer is not complete!");
+            return nullptr;
+        }
+        return target;
+    });
 }
 
-- (CVReturn)createBGRATextureCacheWithWidth:(int)width height:(int)height pixelBuffer:(CVPixelBufferRef *)pixelBuffer outTexture:(CVOpenGLESTextureRef *)outTexture textureCache:(CVOpenGLESTextureCacheRef *)textureCache {
+/// Creates the texture cache shared by all render targets on first use.
+- (BOOL)prepareTextureCache {
+    if (_textureCache) {
+        return YES;
+    }
     CVReturn ret = CVOpenGLESTextureCacheCreate(
         kCFAllocatorDefault, NULL,
         #if COREVIDEO_USE_EAGLCONTEXT_CLASS_IN_API
          _glContext,
         #else
-        (__bridge void *)glContext,
+        (__bridge void *)_glContext,
         #endif
-        NULL, textureCache);
-    
+        NULL, &_textureCache);
     if (ret != kCVReturnSuccess) {
-        return ret;
+        DLog(@"CVOpenGLESTextureCacheCreate faild");
+        return NO;
     }
-    
-    *pixelBuffer = [CustomPixelBufferUtils createEmptyPixelBuffer:kCVPixelFormatType_32BGRA targetSize:CGSizeMake(width, height)];
-    
-    ret = CVOpenGLESTextureCacheCreateTextureFromImage(kCFAllocatorDefault, *textureCache, *pixelBuffer, NULL, GL_TEXTURE_2D, GL_RGBA, static_cast<GLsizei>(width), static_cast<GLsizei>(height), GL_BGRA, GL_UNSIGNED_BYTE, 0, outTexture);
+    [self traceAllocation:"texture cache"];
+    return YES;
+}
 
-    return ret;
+- (void)traceAllocation:(const char *)what {
+    uint64_t frame = _allocationTrace.Record(what);
+    DLog(@"frame %llu: created %s", frame, what);
 }
 
 - (BOOL)bindFrameBufferWithTexture: (GLuint)textureID width:(int)width height:(int)height {
     if (_frameBuffer == -1) {
         glGenFramebuffers(1, &_frameBuffer);
+        [self traceAllocation:"framebuffer"];
     }
     
     glBindFramebuffer(GL_FRAMEBUFFER, _frameBuffer);
@@ -215,53 +482,120 @@ static const char kNV12FragmentShaderSource[] =
     return YES;
 }
 
-- (void)bindTexture:(GLuint)textureID width:(int)width height:(int)height {
-    glActiveTexture(GL_TEXTURE0);
-    
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+/// Renders straight into a pooled NV12 pixel buffer: plane 0 is bound as an R8 render target for the Y pass and
+/// plane 1 as a half size RG8 render target for the UV pass, so the filter output never goes through the CPU.
+/// |bindInputTextures| binds the input planes to their texture units before each pass. The programs encode with
+/// kBT601VideoRange, so the buffer is video range '420v' whatever the range of the input.
+- (nullable CustomShadingFinisher)encodeNV12WithWidth:(int)width height:(int)height
+                                          orientation:(UIInterfaceOrientation)orientation
+                                             yProgram:(GLuint)yProgram
+                                            uvProgram:(GLuint)uvProgram
+                                    bindInputTextures:(void (^)(void))bindInputTextures {
+    if (![self prepareTextureCache]) {
+        return nil;
+    }
+
+    CVPixelBufferRef pixelBuffer = [[CustomPixelBufferPool sharedPool] createPixelBuffer:kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange targetSize:CGSizeMake(width, height)];
+    if (!pixelBuffer) {
+        return nil;
+    }
+
+    const int uvWidth = static_cast<int>(CVPixelBufferGetWidthOfPlane(pixelBuffer, 1));
+    const int uvHeight = static_cast<int>(CVPixelBufferGetHeightOfPlane(pixelBuffer, 1));
+    CVOpenGLESTextureRef yTexture = NULL;
+    CVOpenGLESTextureRef uvTexture = NULL;
+    // The plane textures belong to this frame's output buffer, so they are created every frame. They are counted but
+    // not logged, which would be two lines per frame.
+    CVReturn ret = CVOpenGLESTextureCacheCreateTextureFromImage(kCFAllocatorDefault, _textureCache, pixelBuffer, NULL, GL_TEXTURE_2D, GL_R8, static_cast<GLsizei>(width), static_cast<GLsizei>(height), GL_RED, GL_UNSIGNED_BYTE, 0, &yTexture);
+    if (ret == kCVReturnSuccess) {
+        _allocationTrace.Record("NV12 Y texture");
+        ret = CVOpenGLESTextureCacheCreateTextureFromImage(kCFAllocatorDefault, _textureCache, pixelBuffer, NULL, GL_TEXTURE_2D, GL_RG8, static_cast<GLsizei>(uvWidth), static_cast<GLsizei>(uvHeight), GL_RG, GL_UNSIGNED_BYTE, 1, &uvTexture);
+    }
+    if (ret == kCVReturnSuccess) {
+        _allocationTrace.Record("NV12 UV texture");
+    }
+
+    BOOL rendered = NO;
+    if (ret != kCVReturnSuccess) {
+        DLog(@"CVOpenGLESTextureCacheCreateTextureFromImage faild");
+    } else {
+        rendered = [self drawWithProgram:yProgram toTexture:CVOpenGLESTextureGetName(yTexture) width:width height:height bindInputTextures:bindInputTextures] &&
+                   [self drawWithProgram:uvProgram toTexture:CVOpenGLESTextureGetName(uvTexture) width:uvWidth height:uvHeight bindInputTextures:bindInputTextures];
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glFlush();
+
+    if (yTexture) {
+        CFRelease(yTexture);
+    }
+    if (uvTexture) {
+        CFRelease(uvTexture);
+    }
+    CVOpenGLESTextureCacheFlush(_textureCache, 0);
+
+    if (!rendered) {
+        CVPixelBufferRelease(pixelBuffer);
+        return nil;
+    }
+    // Nothing left to do on the CPU, the buffer is complete once the GPU is.
+    id outputBuffer = CFBridgingRelease(pixelBuffer);
+    return ^CVPixelBufferRef {
+        return CVPixelBufferRetain((__bridge CVPixelBufferRef)outputBuffer);
+    };
+}
+
+- (BOOL)drawWithProgram:(GLuint)program toTexture:(GLuint)textureID width:(int)width height:(int)height bindInputTextures:(void (^)(void))bindInputTextures {
+    if (![self bindFrameBufferWithTexture:textureID width:width height:height]) {
+        return NO;
+    }
+    glUseProgram(program);
+    bindInputTextures();
+    glDrawArrays(GL_TRIANGLE_FAN, _firstVertex, 4);
+    return YES;
 }
 
 /// Callback for I420 frames. Each plane is given as a texture.
 - (nullable CVPixelBufferRef)applyShadingForTextureWithWidth:(int)width height:(int)height orientation:(UIInterfaceOrientation)orientation yPlane:(GLuint)yPlane uPlane:(GLuint)uPlane vPlane:(GLuint)vPlane CF_RETURNS_RETAINED {
-    
-    CVPixelBufferRef pixelBuffer = NULL;
-    CVOpenGLESTextureRef outTexture = NULL;
-    CVOpenGLESTextureCacheRef textureCache = NULL;
-    GLuint textureID = -1;
-    
-    // Create BGRA pixel buffer for FBO
-    CVReturn ret = [self createBGRATextureCacheWithWidth:width height:height pixelBuffer:&pixelBuffer outTexture:&outTexture textureCache:&textureCache];
-    
-    if (ret != kCVReturnSuccess) {
-        if (outTexture) {
-            CFRelease(outTexture);
-        }
-        
-        if (textureCache) {
-            CFRelease(textureCache);
-        }
-        
-        if (pixelBuffer) {
-            CVPixelBufferRelease(pixelBuffer);
-        }
-        DLog(@"CVOpenGLESTextureCacheCreateTextureFromImage faild");
+    CustomShadingFinisher finisher = [self encodeShadingForTextureWithWidth:width height:height orientation:orientation yPlane:yPlane uPlane:uPlane vPlane:vPlane];
+    return finisher ? finisher() : nil;
+}
+
+/// Issues the draw for an I420 frame. The finisher converts the BGRA render target on the CPU, or hands out the NV12
+/// buffer rendered directly.
+- (nullable CustomShadingFinisher)encodeShadingForTextureWithWidth:(int)width height:(int)height orientation:(UIInterfaceOrientation)orientation yPlane:(GLuint)yPlane uPlane:(GLuint)uPlane vPlane:(GLuint)vPlane {
+    _allocationTrace.BeginFrame();
+    // Bound before any program is created, their attribute setup reads from it.
+    if (![self prepareVertexBufferWithRotation:[self convertOrientationFrom:orientation]]) {
         return nil;
-    } else {
-        textureID = CVOpenGLESTextureGetName(outTexture);
-        [self bindTexture:textureID width:width height:height];
-        if (![self bindFrameBufferWithTexture:textureID width:width height:height]) {
-            return nil;
+    }
+
+    if (_rendersYUVDirectly) {
+        if (_i420ToYProgram || [self createAndSetupI420OutputPrograms]) {
+            return [self encodeNV12WithWidth:width height:height orientation:orientation
+                                    yProgram:_i420ToYProgram
+                                   uvProgram:_i420ToUVProgram
+                           bindInputTextures:^{
+                glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + kYTextureUnit));
+                glBindTexture(GL_TEXTURE_2D, yPlane);
+                glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + kUTextureUnit));
+                glBindTexture(GL_TEXTURE_2D, uPlane);
+                glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + kVTextureUnit));
+                glBindTexture(GL_TEXTURE_2D, vPlane);
+            }];
         }
+        DLog(@"Failed to setup I420 output programs, falling back to BGRA readback");
+        _rendersYUVDirectly = NO;
     }
-    
-    if (![self prepareVertexBufferWithRotation:[self convertOrientationFrom:orientation]]) {
+
+    // Render into the next BGRA target of the ring, then convert it on the CPU.
+    BGRARenderTarget *target = [self nextBGRARenderTargetWithWidth:width height:height];
+    if (!target) {
         return nil;
     }
+    glBindFramebuffer(GL_FRAMEBUFFER, target->frameBuffer);
+    glViewport(0, 0, width, height);
       
     if (!_i420Program && ![self createAndSetupI420Program]) {
         DLog(@"Failed to setup I420 program");
@@ -279,70 +613,61 @@ static const char kNV12FragmentShaderSource[] =
     glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + kVTextureUnit));
     glBindTexture(GL_TEXTURE_2D, vPlane);
 
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    glDrawArrays(GL_TRIANGLE_FAN, _firstVertex, 4);
     
-    if (textureID != -1) {
-        glDeleteTextures(1, &textureID);
-    }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glFlush();
-    
-    if (outTexture) {
-        CFRelease(outTexture);
-    }
 
-    if (textureCache) {
-        CFRelease(textureCache);
-    }
-    
-    CVPixelBufferRef targetPixelBuffer = [CustomPixelBufferUtils convertBGRAToI420:pixelBuffer];
-    
-    if (pixelBuffer) {
-        CVPixelBufferRelease(pixelBuffer);
-    }
-    
-    return targetPixelBuffer;
+    // The ring won't draw into this target again before the frame is finished.
+    id bgraBuffer = (__bridge id)target->pixelBuffer;
+    return ^CVPixelBufferRef {
+        return [CustomPixelBufferUtils convertBGRAToI420:(__bridge CVPixelBufferRef)bgraBuffer];
+    };
 }
 
 /// 应用着色器. Each plane is given as a texture.
 - (nullable CVPixelBufferRef)applyShadingForTextureWithWidth:(int)width height:(int)height orientation:(UIInterfaceOrientation)orientation
                                yPlane:(GLuint)yPlane
                               uvPlane:(GLuint)uvPlane CF_RETURNS_RETAINED {
-    CVPixelBufferRef pixelBuffer = NULL;
-    CVOpenGLESTextureRef outTexture = NULL;
-    CVOpenGLESTextureCacheRef textureCache = NULL;
-    GLuint textureID = -1;
-    
-    // Create BGRA pixel buffer for FBO
-    CVReturn ret = [self createBGRATextureCacheWithWidth:width height:height pixelBuffer:&pixelBuffer outTexture:&outTexture textureCache:&textureCache];
-    
-    if (ret != kCVReturnSuccess) {
-        if (outTexture) {
-            CFRelease(outTexture);
-        }
-        
-        if (textureCache) {
-            CFRelease(textureCache);
-        }
-        
-        if (pixelBuffer) {
-            CVPixelBufferRelease(pixelBuffer);
-        }
-        DLog(@"CVOpenGLESTextureCacheCreateTextureFromImage faild");
+    CustomShadingFinisher finisher = [self encodeShadingForTextureWithWidth:width height:height orientation:orientation yPlane:yPlane uvPlane:uvPlane];
+    return finisher ? finisher() : nil;
+}
+
+/// Issues the draw for an NV12 frame, see the I420 variant.
+- (nullable CustomShadingFinisher)encodeShadingForTextureWithWidth:(int)width height:(int)height orientation:(UIInterfaceOrientation)orientation
+                                                            yPlane:(GLuint)yPlane
+                                                           uvPlane:(GLuint)uvPlane {
+    _allocationTrace.BeginFrame();
+    // 设置VBO并选择顶点数据, FBO中的buffer方向不对, 通过纹理坐标来修正. Bound before any program is created, their
+    // attribute setup reads from it.
+    if (![self prepareVertexBufferWithRotation:[self convertOrientationFrom:orientation]]) {
         return nil;
-    } else {
-        textureID = CVOpenGLESTextureGetName(outTexture);
-        [self bindTexture:textureID width:width height:height];
-        if (![self bindFrameBufferWithTexture:textureID width:width height:height]) {
-            return nil;
+    }
+
+    if (_rendersYUVDirectly) {
+        if (_nv12ToYProgram || [self createAndSetupNV12OutputPrograms]) {
+            return [self encodeNV12WithWidth:width height:height orientation:orientation
+                                    yProgram:_nv12ToYProgram
+                                   uvProgram:_nv12ToUVProgram
+                           bindInputTextures:^{
+                glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + kYTextureUnit));
+                glBindTexture(GL_TEXTURE_2D, yPlane);
+                glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + kUvTextureUnit));
+                glBindTexture(GL_TEXTURE_2D, uvPlane);
+            }];
         }
+        DLog(@"Failed to setup NV12 output programs, falling back to BGRA readback");
+        _rendersYUVDirectly = NO;
     }
-  
-    // 设置VAO,VBO并且上传顶点数据, FBO中的buffer方向不对, 通过纹理坐标来修正.
-    if (![self prepareVertexBufferWithRotation:[self convertOrientationFrom:orientation]]) {
+
+    // Render into the next BGRA target of the ring, then convert it on the CPU.
+    BGRARenderTarget *target = [self nextBGRARenderTargetWithWidth:width height:height];
+    if (!target) {
         return nil;
     }
+    glBindFramebuffer(GL_FRAMEBUFFER, target->frameBuffer);
+    glViewport(0, 0, width, height);
 
     // 创建着色器程序，顶点着色器, 片段着色器，并且编译链接着色器.
     if (!_nv12Program && ![self createAndSetupNV12Program]) {
@@ -356,50 +681,63 @@ static const char kNV12FragmentShaderSource[] =
     glBindTexture(GL_TEXTURE_2D, yPlane);
     glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + kUvTextureUnit));
     glBindTexture(GL_TEXTURE_2D, uvPlane);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    glDrawArrays(GL_TRIANGLE_FAN, _firstVertex, 4);
     
-    if (textureID != -1) {
-        glDeleteTextures(1, &textureID);
-    }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glFlush();
-    
-    if (outTexture) {
-        CFRelease(outTexture);
-    }
 
-    if (textureCache) {
-        CFRelease(textureCache);
+    // The ring won't draw into this target again before the frame is finished.
+    id bgraBuffer = (__bridge id)target->pixelBuffer;
+    return ^CVPixelBufferRef {
+        return [CustomPixelBufferUtils convertBGRAToNV12:(__bridge CVPixelBufferRef)bgraBuffer];
+    };
+}
+
+/// Only the direct YUV output is matched, and only for the orientation drawn with the unrotated quad, which turns the
+/// frame upside down in the render target.
+- (nullable CustomCPUFilter *)cpuFilterForPixelFormat:(OSType)pixelFormat orientation:(UIInterfaceOrientation)orientation {
+    if (!_rendersYUVDirectly || [self convertOrientationFrom:orientation] != CustomVideoRotation_90) {
+        return nil;
     }
-    
-    CVPixelBufferRef targetPixelBuffer = [CustomPixelBufferUtils convertBGRAToNV12:pixelBuffer];
-    
-    if (pixelBuffer) {
-        CVPixelBufferRelease(pixelBuffer);
+    // The processer draws '420f' with the NV12 programs and everything else with the I420 ones.
+    if (pixelFormat == kCVPixelFormatType_420YpCbCr8BiPlanarFullRange) {
+        if (!_nv12CPUFilter) {
+            _nv12CPUFilter = [CustomCPUFilter grayscaleFilter];
+            _nv12CPUFilter.flipsVertically = YES;
+        }
+        return _nv12CPUFilter;
     }
-    
-    return targetPixelBuffer;
+    if (pixelFormat == kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange || pixelFormat == kCVPixelFormatType_420YpCbCr8Planar) {
+        if (!_i420CPUFilter) {
+            _i420CPUFilter = [CustomCPUFilter identityFilter];
+            _i420CPUFilter.flipsVertically = YES;
+        }
+        return _i420CPUFilter;
+    }
+    return nil;
 }
 
-/// 设置VAO,VBO并且上传顶点数据
+/// 设置VBO并且选择顶点数据. The shared vertex buffer holds every rotation, nothing is uploaded when it changes.
 - (BOOL)prepareVertexBufferWithRotation:(CustomVideoRotation)rotation {
-    if (!_VBO && ![CustomShaderUtil createVertexBuffer:&_VBO VAO:&_VAO]) {
-        DLog(@"Failed to setup vertex buffer");
-        return NO;
+    if (!_VBO) {
+        _VBO = [_resources acquireQuadVertexBuffer];
+        if (!_VBO) {
+            DLog(@"Failed to setup vertex buffer");
+            return NO;
+        }
+        // Sampler bindings are context state, binding once serves every later draw. 0 without OpenGL ES 3, where the
+        // textures' own parameters apply.
+        _sampler = [_resources acquireLinearSampler];
+        if (_sampler) {
+            for (int unit : {kYTextureUnit, kUTextureUnit, kVTextureUnit}) {
+                glBindSampler(static_cast<GLuint>(unit), _sampler);
+            }
+        }
     }
-    
-    #if !TARGET_OS_IPHONE
-    glBindVertexArray(_VAO);
-    #endif
-  
+
     glBindBuffer(GL_ARRAY_BUFFER, _VBO);
-  
-    if (!_currentRotation || rotation != _currentRotation) {
-        _currentRotation = rotation;
-        // 上传顶点数据,包括顶点坐标和纹理坐标数据
-        [CustomShaderUtil setVertexDataWithRotation:_currentRotation];
-    }
+    _firstVertex = [CustomShaderUtil firstQuadVertexWithRotation:rotation];
     return YES;
 }
 
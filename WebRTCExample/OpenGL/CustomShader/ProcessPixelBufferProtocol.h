@@ -13,6 +13,10 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/// Receives a processed frame. |pixelBuffer| is only valid during the call, retain it to keep it; it is nil if the
+/// frame could not be processed.
+typedef void (^CustomProcessCompletionHandler)(CVPixelBufferRef _Nullable pixelBuffer, int64_t timeStampNs);
+
 @protocol ProcessPixelBufferProtocol <NSObject>
 
 /// Note: This function pass ownership of return value(CVPixelBufferRef) to the caller.
@@ -20,6 +24,15 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (BOOL)shouldProcessFrameBuffer;
 
+@optional
+
+/// Pipelined variant of -processBuffer:orientation:timeStampNs:. |completion| is called exactly once per call, in call
+/// order, possibly after this method has returned.
+- (void)processBuffer:(CVPixelBufferRef _Nullable)pixelBuffer orientation:(UIInterfaceOrientation)orientation timeStampNs:(int64_t)timeStampNs completion:(CustomProcessCompletionHandler)completion;
+
+/// Completes every frame still pending in pipelined mode.
+- (void)flushPendingFrames;
+
 @end
 
 NS_ASSUME_NONNULL_END
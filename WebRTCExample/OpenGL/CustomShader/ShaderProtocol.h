@@ -14,6 +14,12 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+@class CustomCPUFilter;
+
+/// Produces the output of a frame whose GL commands have been issued. Only call it once the GPU has finished them.
+/// Returns a +1 reference the caller has to release.
+typedef CVPixelBufferRef _Nullable (^CustomShadingFinisher)(void);
+
 @protocol ShaderProtocol <NSObject>
 
 @property(nonatomic, readonly) EAGLContext *glContext;
@@ -29,6 +35,22 @@ NS_ASSUME_NONNULL_BEGIN
                                yPlane:(GLuint)yPlane
                               uvPlane:(GLuint)uvPlane CF_RETURNS_RETAINED;
 
+@optional
+
+/// Deferred variant of the I420 callback for pipelined processing. Only issues the GL commands and returns the block
+/// producing the output buffer, so the caller can fence the commands and finish the frame later.
+- (nullable CustomShadingFinisher)encodeShadingForTextureWithWidth:(int)width height:(int)height orientation:(UIInterfaceOrientation)orientation yPlane:(GLuint)yPlane uPlane:(GLuint)uPlane vPlane:(GLuint)vPlane;
+
+/// Deferred variant of the NV12 callback for pipelined processing.
+- (nullable CustomShadingFinisher)encodeShadingForTextureWithWidth:(int)width height:(int)height orientation:(UIInterfaceOrientation)orientation
+                                                            yPlane:(GLuint)yPlane
+                                                           uvPlane:(GLuint)uvPlane;
+
+/// A CustomCPUFilter whose -filteredPixelBuffer: gives the same output as the shader for frames of |pixelFormat|
+/// drawn with |orientation|, within the rounding of either side; nil if there is none. Lets CustomPixelBufferProcesser
+/// take the CPU path where that is cheaper. Called from the processing thread.
+- (nullable CustomCPUFilter *)cpuFilterForPixelFormat:(OSType)pixelFormat orientation:(UIInterfaceOrientation)orientation;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -15,10 +15,9 @@
 
 #import "CustomOpenGLDefines.h"
 #import "CustomRTCShader.h"
+#import "CustomGLResources.h"
 #import <WebRTC/RTCLogging.h>
 
-#include "absl/types/optional.h"
-
 static const int kYTextureUnit = 0;
 static const int kUTextureUnit = 1;
 static const int kVTextureUnit = 2;
@@ -94,86 +93,82 @@ static const char kNV12FragmentShaderSource[] =
 
 
 @implementation CustomRTCDefaultShader {
+  // Shared with other shaders of the view's sharegroup, taken on the first draw.
+  CustomGLResources *_resources;
   GLuint _VBO;
-  GLuint _VAO;
-  // Store current rotation and only upload new vertex data when rotation changes.
-  absl::optional<RTCVideoRotation> _currentRotation;
+  GLuint _sampler;
+  // First vertex of the quad for the current rotation in the shared vertex buffer.
+  GLint _firstVertex;
 
   GLuint _i420Program;
   GLuint _nv12Program;
 }
 
 - (void)dealloc {
-  glDeleteProgram(_i420Program);
-  glDeleteProgram(_nv12Program);
-  glDeleteBuffers(1, &_VBO);
-  glDeleteVertexArrays(1, &_VAO);
+  [_resources releaseProgram:_i420Program];
+  [_resources releaseProgram:_nv12Program];
+  [_resources releaseVertexBuffer:_VBO];
+  [_resources releaseSampler:_sampler];
 }
 
 - (BOOL)createAndSetupI420Program {
   NSAssert(!_i420Program, @"I420 program already created");
-  _i420Program = RTCCreateProgramFromFragmentSource(kI420FragmentShaderSource);
-  if (!_i420Program) {
-    return NO;
-  }
-  GLint ySampler = glGetUniformLocation(_i420Program, "s_textureY");
-  GLint uSampler = glGetUniformLocation(_i420Program, "s_textureU");
-  GLint vSampler = glGetUniformLocation(_i420Program, "s_textureV");
-
-  if (ySampler < 0 || uSampler < 0 || vSampler < 0) {
-    RTCLog(@"Failed to get uniform variable locations in I420 shader");
-    glDeleteProgram(_i420Program);
-    _i420Program = 0;
-    return NO;
-  }
-
-  glUseProgram(_i420Program);
-  glUniform1i(ySampler, kYTextureUnit);
-  glUniform1i(uSampler, kUTextureUnit);
-  glUniform1i(vSampler, kVTextureUnit);
-
-  return YES;
+  _i420Program = RTCAcquireProgramFromFragmentSource(_resources, kI420FragmentShaderSource, ^BOOL(GLuint program) {
+    GLint ySampler = glGetUniformLocation(program, "s_textureY");
+    GLint uSampler = glGetUniformLocation(program, "s_textureU");
+    GLint vSampler = glGetUniformLocation(program, "s_textureV");
+
+    if (ySampler < 0 || uSampler < 0 || vSampler < 0) {
+      RTCLog(@"Failed to get uniform variable locations in I420 shader");
+      return NO;
+    }
+
+    glUniform1i(ySampler, kYTextureUnit);
+    glUniform1i(uSampler, kUTextureUnit);
+    glUniform1i(vSampler, kVTextureUnit);
+    return YES;
+  });
+  return _i420Program != 0;
 }
 
 // 创建着色器程序，顶点着色器, 片段着色器，并且编译链接着色器.
 - (BOOL)createAndSetupNV12Program {
   NSAssert(!_nv12Program, @"NV12 program already created");
-  _nv12Program = RTCCreateProgramFromFragmentSource(kNV12FragmentShaderSource);
-  if (!_nv12Program) {
-    return NO;
-  }
-  GLint ySampler = glGetUniformLocation(_nv12Program, "s_textureY");
-  GLint uvSampler = glGetUniformLocation(_nv12Program, "s_textureUV");
-
-  if (ySampler < 0 || uvSampler < 0) {
-    RTCLog(@"Failed to get uniform variable locations in NV12 shader");
-    glDeleteProgram(_nv12Program);
-    _nv12Program = 0;
-    return NO;
-  }
-
-  glUseProgram(_nv12Program);
-  glUniform1i(ySampler, kYTextureUnit);
-  glUniform1i(uvSampler, kUvTextureUnit);
-
-  return YES;
+  _nv12Program = RTCAcquireProgramFromFragmentSource(_resources, kNV12FragmentShaderSource, ^BOOL(GLuint program) {
+    GLint ySampler = glGetUniformLocation(program, "s_textureY");
+    GLint uvSampler = glGetUniformLocation(program, "s_textureUV");
+
+    if (ySampler < 0 || uvSampler < 0) {
+      RTCLog(@"Failed to get uniform variable locations in NV12 shader");
+      return NO;
+    }
+
+    glUniform1i(ySampler, kYTextureUnit);
+    glUniform1i(uvSampler, kUvTextureUnit);
+    return YES;
+  });
+  return _nv12Program != 0;
 }
 
-// 设置VAO,VBO并且上传顶点数据
+// 设置VBO并且选择顶点数据. The shared vertex buffer holds every rotation, nothing is uploaded when it changes.
 - (BOOL)prepareVertexBufferWithRotation:(RTCVideoRotation)rotation {
-  if (!_VBO && !RTCCreateVertexBuffer(&_VBO, &_VAO)) {
-    RTCLog(@"Failed to setup vertex buffer");
-    return NO;
+  if (!_VBO) {
+    _resources = [CustomGLResources resourcesForContext:[EAGLContext currentContext]];
+    _VBO = [_resources acquireQuadVertexBuffer];
+    if (!_VBO) {
+      RTCLog(@"Failed to setup vertex buffer");
+      return NO;
+    }
+    // Sampler bindings are context state and the view's context only draws with this shader.
+    _sampler = [_resources acquireLinearSampler];
+    if (_sampler) {
+      for (int unit : {kYTextureUnit, kUTextureUnit, kVTextureUnit}) {
+        glBindSampler(static_cast<GLuint>(unit), _sampler);
+      }
+    }
   }
-#if !TARGET_OS_IPHONE
-  glBindVertexArray(_VAO);
-#endif
   glBindBuffer(GL_ARRAY_BUFFER, _VBO);
-  if (!_currentRotation || rotation != *_currentRotation) {
-    _currentRotation = absl::optional<RTCVideoRotation>(rotation);
-    // 上传顶点数据,包括顶点坐标和纹理坐标数据
-    RTCSetVertexData(*_currentRotation);
-  }
+  _firstVertex = RTCQuadFirstVertex(rotation);
   return YES;
 }
 
@@ -203,7 +198,7 @@ static const char kNV12FragmentShaderSource[] =
   glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + kVTextureUnit));
   glBindTexture(GL_TEXTURE_2D, vPlane);
 
-  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+  glDrawArrays(GL_TRIANGLE_FAN, _firstVertex, 4);
 }
 
 // 应用着色器
@@ -212,7 +207,7 @@ static const char kNV12FragmentShaderSource[] =
                              rotation:(RTCVideoRotation)rotation
                                yPlane:(GLuint)yPlane
                               uvPlane:(GLuint)uvPlane {
-  // 设置VAO,VBO并且上传顶点数据
+  // 设置VBO并且选择顶点数据
   if (![self prepareVertexBufferWithRotation:rotation]) {
     return;
   }
@@ -232,7 +227,7 @@ static const char kNV12FragmentShaderSource[] =
   glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + kUvTextureUnit));
   glBindTexture(GL_TEXTURE_2D, uvPlane);
 
-  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+  glDrawArrays(GL_TRIANGLE_FAN, _firstVertex, 4);
 }
 
 @end
@@ -7,6 +7,8 @@
 
 #import <WebRTC/RTCVideoFrame.h>
 
+#import "CustomGLResources.h"
+
 NS_ASSUME_NONNULL_BEGIN
 
 RTC_EXTERN const char kRTCVertexShaderSource[];
@@ -15,8 +17,14 @@ RTC_EXTERN GLuint RTCCreateShader(GLenum type, const GLchar* source);
 RTC_EXTERN GLuint RTCCreateProgram(GLuint vertexShader, GLuint fragmentShader);
 RTC_EXTERN GLuint
 RTCCreateProgramFromFragmentSource(const char fragmentShaderSource[_Nonnull]);
-RTC_EXTERN BOOL RTCCreateVertexBuffer(GLuint* vertexBuffer,
-                                      GLuint* vertexArray);
-RTC_EXTERN void RTCSetVertexData(RTCVideoRotation rotation);
+// The program of |fragmentShaderSource| and the plain vertex shader, shared
+// through |resources|. |setup| runs once, when the program is created.
+RTC_EXTERN GLuint RTCAcquireProgramFromFragmentSource(
+    CustomGLResources* resources,
+    const char fragmentShaderSource[_Nonnull],
+    CustomProgramSetup _Nullable setup);
+// First vertex of the quad for |rotation| in CustomGLResources' quad vertex
+// buffer.
+RTC_EXTERN GLint RTCQuadFirstVertex(RTCVideoRotation rotation);
 
 NS_ASSUME_NONNULL_END
@@ -13,13 +13,14 @@
 #import <OpenGL/gl3.h>
 #endif
 
-#include <algorithm>
-#include <array>
 #include <memory>
 
 #import "CustomOpenGLDefines.h"
+#import "CustomProgramCache.h"
 #import <WebRTC/RTCLogging.h>
 
+#include "GLResourceRegistry.h"
+
 // Vertex shader doesn't do anything except pass coordinates through.
 const char kRTCVertexShaderSource[] =
   SHADER_VERSION
@@ -96,18 +97,12 @@ GLuint RTCCreateProgram(GLuint vertexShader, GLuint fragmentShader) {
 // Creates and links a shader program with the given fragment shader source and
 // a plain vertex shader. Returns the program handle or 0 on error.
 GLuint RTCCreateProgramFromFragmentSource(const char fragmentShaderSource[]) {
-  GLuint vertexShader = RTCCreateShader(GL_VERTEX_SHADER, kRTCVertexShaderSource);
-    RTCLogInfo(@"failed to create vertex shader: %u", vertexShader);
-  GLuint fragmentShader =
-      RTCCreateShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
-    RTCLogInfo(@"failed to create fragment shader %u", fragmentShader);
-  GLuint program = RTCCreateProgram(vertexShader, fragmentShader);
-  // Shaders are created only to generate program.
-  if (vertexShader) {
-    glDeleteShader(vertexShader);
-  }
-  if (fragmentShader) {
-    glDeleteShader(fragmentShader);
+  // Compiled only the first time, later runs load the linked binary.
+  GLuint program = [[CustomProgramCache sharedCache] createProgramWithVertexShaderSource:kRTCVertexShaderSource
+                                                                    fragmentShaderSource:fragmentShaderSource];
+  if (!program) {
+    RTCLogError(@"Failed to create program");
+    return 0;
   }
 
   // Set vertex shader variables 'position' and 'texcoord' in program.
@@ -132,44 +127,20 @@ GLuint RTCCreateProgramFromFragmentSource(const char fragmentShaderSource[]) {
   return program;
 }
 
-BOOL RTCCreateVertexBuffer(GLuint *VBO, GLuint *VAO) {
-#if !TARGET_OS_IPHONE
-  glGenVertexArrays(1, VAO);
-  if (*VAO == 0) {
-    return NO;
-  }
-  glBindVertexArray(*VAO);
-#endif
-  // VBO
-  glGenBuffers(1, VBO);
-  if (*VBO == 0) {
-    glDeleteVertexArrays(1, VAO);
-    return NO;
-  }
-  glBindBuffer(GL_ARRAY_BUFFER, *VBO);
-  glBufferData(GL_ARRAY_BUFFER, 4 * 4 * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
-  return YES;
+GLuint RTCAcquireProgramFromFragmentSource(CustomGLResources *resources,
+                                           const char fragmentShaderSource[],
+                                           CustomProgramSetup setup) {
+  return [resources acquireProgramWithVertexShaderSource:kRTCVertexShaderSource
+                                    fragmentShaderSource:fragmentShaderSource
+                                                   setup:setup];
 }
 
-// 上传顶点数据,包括顶点坐标和纹理坐标数据
-// Set vertex data to the currently bound vertex buffer.
-void RTCSetVertexData(RTCVideoRotation rotation) {
-  // When modelview and projection matrices are identity (default) the world is
-  // contained in the square around origin with unit size 2. Drawing to these
-  // coordinates is equivalent to drawing to the entire screen. The texture is
-  // stretched over that square using texture coordinates (u, v) that range
-  // from (0, 0) to (1, 1) inclusive. Texture coordinates are flipped vertically
-  // here because the incoming frame has origin in upper left hand corner but
-  // OpenGL expects origin in bottom left corner.
-  std::array<std::array<GLfloat, 2>, 4> UVCoords = {{
-      {{0, 1}},  // Lower left.
-      {{1, 1}},  // Lower right.
-      {{1, 0}},  // Upper right.
-      {{0, 0}},  // Upper left.
-  }};
-
+// 顶点数据(包括顶点坐标和纹理坐标)四个方向都预先上传到同一个VBO, 旋转时只选择起始顶点.
+// The quads of all four rotations live in one static vertex buffer, see
+// custom::FillRotatedQuadVertices.
+GLint RTCQuadFirstVertex(RTCVideoRotation rotation) {
   // Rotate the UV coordinates.
-  int rotation_offset;
+  int rotation_offset = 0;
   switch (rotation) {
     case RTCVideoRotation_0:
       rotation_offset = 0;
@@ -184,28 +155,5 @@ void RTCSetVertexData(RTCVideoRotation rotation) {
       rotation_offset = 3;
       break;
   }
-  std::rotate(UVCoords.begin(), UVCoords.begin() + rotation_offset,
-              UVCoords.end());
-
-  const GLfloat gVertices[] = {
-      // X, Y, U, V.
-      -1, -1, UVCoords[0][0], UVCoords[0][1],
-       1, -1, UVCoords[1][0], UVCoords[1][1],
-       1,  1, UVCoords[2][0], UVCoords[2][1],
-      -1,  1, UVCoords[3][0], UVCoords[3][1],
-  };
-
-    /*
-     e.g: 手机竖屏时
-     const GLfloat gVertices[] = {
-         // X, Y, U, V.
-           -1, -1, 1, 1,
-            1, -1, 1, 0,
-            1,  1, 0, 0,
-           -1,  1, 0, 1,
-     };
-     */
-
-  glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(gVertices), gVertices);
+  return custom::RotatedQuadFirstVertex(rotation_offset);
 }
-
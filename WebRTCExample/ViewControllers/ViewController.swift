@@ -88,6 +88,12 @@ class ViewController: UIViewController {
         return webRTCService.isConnected && signalingService.isConnected
     }
     
+    deinit {
+        #if !targetEnvironment(simulator)
+        videoCapturerService.stopCaptureLocalVideo(completeHandler: nil)
+        #endif
+    }
+    
     override func viewDidLoad() {
         super.viewDidLoad()
         // Do any additional setup after loading the view.
@@ -211,6 +217,10 @@ extension ViewController: WebRTCServiceDelegate {
         signalingService.sendCandidate(iceCandidate: iceCandidate)
     }
     
+    func didCompleteGathering(service: WebRTCService) {
+        signalingService.flushCandidates()
+    }
+    
     func didIceConnectionStateChanged(service: WebRTCService, iceConnectionState: RTCIceConnectionState) {
         
     }
@@ -271,6 +281,7 @@ extension ViewController: SignalingServiceDelegate {
         switch signalingMessage.type {
         case .offer:
             if let sdp = signalingMessage.sessionDescription?.sdp {
+                webRTCService.peerTakesDataFrames = signalingService.advertisesDataFrames && signalingMessage.dataFrames == true
                 webRTCService.receiveOffer(offerSDP: RTCSessionDescription(type: .offer, sdp: sdp)) { [weak self] result in
                     if case let .success(answerSDP) = result {
                         self?.signalingService.sendSDP(sessionDescription: answerSDP)
@@ -279,12 +290,17 @@ extension ViewController: SignalingServiceDelegate {
             }
         case .answer:
             if let sdp = signalingMessage.sessionDescription?.sdp {
+                webRTCService.peerTakesDataFrames = signalingService.advertisesDataFrames && signalingMessage.dataFrames == true
                 webRTCService.receiveAnswer(answerSDP: RTCSessionDescription(type: .answer, sdp: sdp))
             }
         case .candidate:
             if let candidate = signalingMessage.candidate {
                 webRTCService.receiveCandidate(candidate: RTCIceCandidate(sdp: candidate.sdp, sdpMLineIndex: candidate.sdpMLineIndex, sdpMid: candidate.sdpMid))
             }
+        case .candidates:
+            for candidate in signalingMessage.candidates ?? [] {
+                webRTCService.receiveCandidate(candidate: RTCIceCandidate(sdp: candidate.sdp, sdpMLineIndex: candidate.sdpMLineIndex, sdpMid: candidate.sdpMid))
+            }
         case .unKnown:
             print("Web socket did receive message: unKnown")
         }
@@ -38,6 +38,18 @@ class CustomVideoCapturerService {
         }
     }
     
+    /// Stops the camera, then sends on the frames still being processed.
+    func stopCaptureLocalVideo(completeHandler: (() -> Void)?) {
+        let localVideoSource = webRTCService?.localVideoSource
+        cameraVideoCapturer.stopCapture {
+            guard let localVideoSource = localVideoSource else {
+                completeHandler?()
+                return
+            }
+            localVideoSource.capturerDidStop(completion: completeHandler)
+        }
+    }
+    
     private func findDeviceForPosition(_ position: AVCaptureDevice.Position) -> AVCaptureDevice? {
         let captureDevices = RTCCameraVideoCapturer.captureDevices()
         
@@ -22,6 +22,27 @@ protocol SignalingServiceDelegate: NSObjectProtocol {
 class SignalingService {
     private var socket: WebSocket?
     private var signalingAddress: String?
+    /// Replaces JSONEncoder/JSONDecoder, the wire format is the same.
+    private let codec = CustomSignalingCodec()
+    /// Coalesces trickled candidates, see CustomCandidateBatcher. Batches go out as one candidates message to peers that
+    /// advertised candidateBatches, as candidate messages to the others.
+    private lazy var candidateBatcher: CustomCandidateBatcher = {
+        let candidateBatcher = CustomCandidateBatcher()
+        candidateBatcher.handler = { [weak self] candidates in
+            DispatchQueue.main.async {
+                self?.sendCandidates(candidates)
+            }
+        }
+        return candidateBatcher
+    }()
+    /// Whether the peer's latest offer or answer accepted candidates messages.
+    private var peerSupportsCandidateBatches = false
+    
+    /// Send candidates through candidateBatcher, and tell the peer candidates messages are accepted.
+    var batchesCandidates = true
+    
+    /// Tell the peer this end takes framed data channel messages, see WebRTCService.peerTakesDataFrames.
+    var advertisesDataFrames = true
     
     var isConnected: Bool {
         return socket?.isConnected == true
@@ -61,32 +82,37 @@ class SignalingService {
             type = .answer
         }
         
-        let sdp = SDP(sdp: sessionDescription.sdp)
-        let signalingMessage = SignalingMessage(type: type, sessionDescription: sdp, candidate: nil)
-        
-        do {
-            try sendMessage(signalingMessage)
-        } catch {
-            print("sendSDP faild: \(error)")
-        }
+        // A new description may come with an ICE restart, whose candidates repeat the old addresses.
+        candidateBatcher.reset()
+        sendMessage(codec.encodeSessionDescription(sessionDescription.sdp, type: type.customType, advertisesCandidateBatches: batchesCandidates, advertisesDataFrames: advertisesDataFrames))
     }
     
     func sendCandidate(iceCandidate: RTCIceCandidate) {
-        let candidate = Candidate(sdp: iceCandidate.sdp, sdpMLineIndex: iceCandidate.sdpMLineIndex, sdpMid: iceCandidate.sdpMid)
-        let signalingMessage = SignalingMessage(type: .candidate, sessionDescription: nil, candidate: candidate)
-        do {
-            try sendMessage(signalingMessage)
-        } catch {
-            print("sendCandidate faild: \(error)")
+        guard batchesCandidates else {
+            sendMessage(codec.encodeCandidate(iceCandidate.sdp, sdpMLineIndex: iceCandidate.sdpMLineIndex, sdpMid: iceCandidate.sdpMid))
+            return
         }
+        candidateBatcher.add(CustomSignalingCandidate(sdp: iceCandidate.sdp, sdpMLineIndex: iceCandidate.sdpMLineIndex, sdpMid: iceCandidate.sdpMid))
     }
     
-    private func sendMessage(_ signalingMessage: SignalingMessage) throws {
-        let data = try JSONEncoder().encode(signalingMessage)
-        if let message = String(data: data, encoding: .utf8) {
-            if self.socket?.isConnected == true {
-                self.socket?.write(string: message)
-            }
+    /// Sends the candidates still being batched, e.g. once gathering completes.
+    func flushCandidates() {
+        candidateBatcher.flush()
+    }
+    
+    private func sendCandidates(_ candidates: [CustomSignalingCandidate]) {
+        if peerSupportsCandidateBatches && candidates.count > 1 {
+            sendMessage(codec.encodeCandidates(candidates))
+            return
+        }
+        for candidate in candidates {
+            sendMessage(codec.encodeCandidate(candidate.sdp, sdpMLineIndex: candidate.sdpMLineIndex, sdpMid: candidate.sdpMid))
+        }
+    }
+    
+    private func sendMessage(_ message: String) {
+        if self.socket?.isConnected == true {
+            self.socket?.write(string: message)
         }
     }
 }
@@ -101,17 +127,22 @@ extension SignalingService: WebSocketDelegate {
     }
     
     func websocketDidReceiveMessage(socket: WebSocketClient, text: String) {
-        do {
-            guard let data = text.data(using: .utf8) else {
-                delegate?.websocketDidReceiveMessage(service: self, signalingMessage: nil)
-                return
+        // Native strings are parsed in place, bridged ones through their NSString.
+        let decoded = text.utf8.withContiguousStorageIfAvailable { utf8 -> CustomSignalingMessage? in
+            guard let baseAddress = utf8.baseAddress else {
+                return nil
             }
-            let signalingMessage = try JSONDecoder().decode(SignalingMessage.self, from: data)
-            delegate?.websocketDidReceiveMessage(service: self, signalingMessage: signalingMessage)
-        } catch {
+            return codec.decodeMessage(utf8: baseAddress, length: UInt(utf8.count))
+        } ?? codec.decodeMessage(text)
+        guard let message = decoded else {
             delegate?.websocketDidReceiveMessage(service: self, signalingMessage: nil)
-            print("Decode SignalingMessage faild: \(error)")
+            print("Decode SignalingMessage faild: \(text.prefix(64))")
+            return
+        }
+        if message.type == .offer || message.type == .answer {
+            peerSupportsCandidateBatches = message.supportsCandidateBatches
         }
+        delegate?.websocketDidReceiveMessage(service: self, signalingMessage: SignalingMessage(message: message))
     }
     
     func websocketDidReceiveData(socket: WebSocketClient, data: Data) {
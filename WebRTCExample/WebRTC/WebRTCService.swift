@@ -29,6 +29,7 @@ enum WebRTCServiceResult<T> {
 
 protocol WebRTCServiceDelegate: NSObjectProtocol {
     func didGenerateCandidate(service: WebRTCService, iceCandidate: RTCIceCandidate)
+    func didCompleteGathering(service: WebRTCService)
     func didIceConnectionStateChanged(service: WebRTCService, iceConnectionState: RTCIceConnectionState)
     func didOpenDataChannel(service: WebRTCService)
     func didReceiveData(service: WebRTCService, data: Data?)
@@ -48,6 +49,41 @@ class WebRTCService: NSObject {
     
     private lazy var mediaConstraints: RTCMediaConstraints = RTCMediaConstraints(mandatoryConstraints: nil, optionalConstraints: nil)
     
+    /// Codec order and bitrates of local descriptions, e.g. `sdpMunger.preferredVideoCodec = "H264"`.
+    let sdpMunger = CustomSdpMunger()
+    
+    /// Streams multiplexed over the remote data channel.
+    private enum DataStream: UInt16 {
+        /// `sendData`, and binary messages from peers that don't frame them.
+        case bulk = 0
+        /// `sendMessge`, ahead of bulk chunks; plain text messages to peers that don't take frames.
+        case control = 1
+    }
+    
+    /// Messages of any size, sent in chunks paced by the data channel's bufferedAmount.
+    private lazy var dataTransfer: CustomDataTransfer = {
+        let dataTransfer = CustomDataTransfer()
+        dataTransfer.setPriority(0, weight: 1, forStream: DataStream.control.rawValue)
+        dataTransfer.setSendsText(true, forStream: DataStream.control.rawValue)
+        dataTransfer.handler = { [weak self] data, stream in
+            guard let self = self else { return }
+            if stream == DataStream.control.rawValue {
+                self.delegate?.didReceiveMessage(service: self, message: String(data: data, encoding: .utf8))
+            } else {
+                self.delegate?.didReceiveData(service: self, data: data)
+            }
+        }
+        return dataTransfer
+    }()
+    
+    /// Whether the peer's offer or answer advertised dataFrames and this end did too: both then send data channel
+    /// messages framed. Until it is set, messages go out whole as plain data channel messages. Set it before applying
+    /// the remote description.
+    var peerTakesDataFrames: Bool {
+        get { return dataTransfer.framed }
+        set { dataTransfer.framed = newValue }
+    }
+    
     lazy var localVideoSource: CustomVideoSource = {
         let localVideoSource = self.peerConnectionFactory.videoSource()
         let forwardVideoSource = CustomVideoSource(rtcVideoSource: localVideoSource)
@@ -196,8 +232,9 @@ extension WebRTCService {
                 return
             }
             
-            if let offerSDP = sdp {
+            if let sdp = sdp {
                 print("Get sdp and create local sdp")
+                let offerSDP = RTCSessionDescription(type: .offer, sdp: self.sdpMunger.mungeOffer(sdp.sdp))
                 self.peerConnection?.setLocalDescription(offerSDP, completionHandler: { (err) in
                     if let error = err {
                         print("Set local offer sdp faild: \(error)")
@@ -215,20 +252,21 @@ extension WebRTCService {
     }
     
     func makeAnswer(_ completionHandler: WebRTCServiceResultHandler?) {
-        peerConnection?.answer(for: self.mediaConstraints) { [weak self] answerSDP, error in
+        peerConnection?.answer(for: self.mediaConstraints) { [weak self] sdp, error in
             if let error = error {
                 print("Make answer faild: \(error)")
                 completionHandler?(WebRTCServiceResult<RTCSessionDescription>.failure(error))
                 return
             }
             
-            guard let answerSDP = answerSDP else {
+            guard let `self` = self, let sdp = sdp else {
                 print("Create local answerSDP faild")
                 completionHandler?(WebRTCServiceResult<RTCSessionDescription>.failure(WebRTCServiceError(code: 0, domain: "Create local answerSDP faild", userInfo: nil)))
                 return
             }
+            let answerSDP = RTCSessionDescription(type: .answer, sdp: self.sdpMunger.mungeAnswer(sdp.sdp))
             
-            self?.peerConnection?.setLocalDescription(answerSDP) { error in
+            self.peerConnection?.setLocalDescription(answerSDP) { error in
                 if let error = error {
                     print("Set local answer faild: \(error)")
                     completionHandler?(WebRTCServiceResult<RTCSessionDescription>.failure(error))
@@ -245,23 +283,18 @@ extension WebRTCService {
         peerConnection?.add(candidate)
     }
     
+    /// Sent ahead of the chunks of `sendData` transfers, as a plain text message to peers that don't take frames; queued
+    /// until the remote data channel opens.
     func sendMessge(message: String) {
-        if self.remoteDataChannel?.readyState == .open {
-            if let message = message.data(using: .utf8) {
-                let buffer = RTCDataBuffer(data: message, isBinary: false)
-                self.remoteDataChannel?.sendData(buffer)
-            }
-        } else {
-            print("Remote data channel is not ready")
+        if let message = message.data(using: .utf8), !dataTransfer.send(message, onStream: DataStream.control.rawValue) {
+            print("Data channel send queue is full")
         }
     }
     
+    /// Queued until the remote data channel opens.
     func sendData(data: Data) {
-        if remoteDataChannel?.readyState == .open {
-            let buffer = RTCDataBuffer(data: data, isBinary: true)
-            remoteDataChannel?.sendData(buffer)
-        } else {
-            print("Remote data channel is not ready")
+        if !dataTransfer.send(data, onStream: DataStream.bulk.rawValue) {
+            print("Data channel send queue is full")
         }
     }
 }
@@ -332,7 +365,9 @@ extension WebRTCService: RTCPeerConnectionDelegate {
     }
     
     func peerConnection(_ peerConnection: RTCPeerConnection, didChange newState: RTCIceGatheringState) {
-        
+        if newState == .complete {
+            self.delegate?.didCompleteGathering(service: self)
+        }
     }
     
     func peerConnection(_ peerConnection: RTCPeerConnection, didGenerate candidate: RTCIceCandidate) {
@@ -346,6 +381,8 @@ extension WebRTCService: RTCPeerConnectionDelegate {
     func peerConnection(_ peerConnection: RTCPeerConnection, didOpen dataChannel: RTCDataChannel) {
         remoteDataChannel = dataChannel
         remoteDataChannel?.delegate = self
+        dataTransfer.dataChannel = dataChannel
+        dataTransfer.bufferedAmountDidChange()
         delegate?.didOpenDataChannel(service: self)
     }
 }
@@ -354,7 +391,7 @@ extension WebRTCService: RTCPeerConnectionDelegate {
 extension WebRTCService: RTCDataChannelDelegate {
     func dataChannel(_ dataChannel: RTCDataChannel, didReceiveMessageWith buffer: RTCDataBuffer) {
         if buffer.isBinary {
-            self.delegate?.didReceiveData(service: self, data: buffer.data)
+            dataTransfer.receive(buffer)
         } else {
             self.delegate?.didReceiveMessage(service: self, message: String(data: buffer.data, encoding: .utf8))
         }
@@ -371,6 +408,8 @@ extension WebRTCService: RTCDataChannelDelegate {
             } else if dataChannel.channelId == remoteDataChannel?.channelId ?? -1 {
                 remoteDataChannel?.close()
                 remoteDataChannel = nil
+                dataTransfer.dataChannel = nil
+                dataTransfer.reset()
             }
         case .closing:
             state = "closing"
@@ -378,6 +417,9 @@ extension WebRTCService: RTCDataChannelDelegate {
             state = "connecting"
         case .open:
             state = "open"
+            if dataChannel.channelId == remoteDataChannel?.channelId ?? -1 {
+                dataTransfer.bufferedAmountDidChange()
+            }
         @unknown default:
             state = "@unknown"
         }
@@ -386,6 +428,8 @@ extension WebRTCService: RTCDataChannelDelegate {
     }
     
     func dataChannel(_ dataChannel: RTCDataChannel, didChangeBufferedAmount amount: UInt64) {
-        
+        if dataChannel.channelId == remoteDataChannel?.channelId ?? -1 {
+            dataTransfer.bufferedAmountDidChange()
+        }
     }
 }
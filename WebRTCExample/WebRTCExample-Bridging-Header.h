@@ -9,5 +9,15 @@
 #import "CustomRTCDefaultShader.h"
 #import "ProcessPixelBufferProtocol.h"
 #import "CustomTypes.h"
+#import "CustomFrameScheduler.h"
+#import "CustomStageTrace.h"
+#import "CustomColorConverter.h"
+#import "CustomFrameHistory.h"
+#import "CustomPathCostModel.h"
+#import "CustomQualitySampler.h"
+#import "CustomSignalingCodec.h"
+#import "CustomCandidateBatcher.h"
+#import "CustomSdpMunger.h"
+#import "CustomDataTransfer.h"
 
 #endif /* WebRTCExample_Brigding_Header_h */
@@ -0,0 +1,529 @@
+//
+//  BulkTransferTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/13.
+//
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BulkTransfer.h"
+#include "TestCheck.h"
+
+namespace {
+
+// What the sender handed to the channel; refuses everything while |open| is
+// false.
+struct Channel {
+  bool open = true;
+  std::vector<std::vector<uint8_t>> sent;
+  std::vector<bool> text;
+
+  custom::BulkSender::SendFunc Func() {
+    return [this](const uint8_t *data, size_t size, bool is_text) {
+      if (!open) {
+        return false;
+      }
+      sent.emplace_back(data, data + size);
+      text.push_back(is_text);
+      return true;
+    };
+  }
+
+  // Stream of every frame sent, from its header.
+  std::vector<uint16_t> Streams() const {
+    std::vector<uint16_t> streams;
+    for (const std::vector<uint8_t> &frame : sent) {
+      streams.push_back(static_cast<uint16_t>(frame[2] | frame[3] << 8));
+    }
+    return streams;
+  }
+};
+
+custom::StreamConfig Config(uint8_t priority, uint32_t weight, bool text = false) {
+  custom::StreamConfig config;
+  config.priority = priority;
+  config.weight = weight;
+  config.text = text;
+  return config;
+}
+
+// A message with recognizable bytes, kept alive by the returned owner.
+std::shared_ptr<const void> Message(size_t size, uint8_t seed, const uint8_t **data) {
+  auto bytes = std::make_shared<std::vector<uint8_t>>(size);
+  for (size_t i = 0; i < size; ++i) {
+    (*bytes)[i] = static_cast<uint8_t>(seed + i * 7);
+  }
+  *data = bytes->data();
+  return bytes;
+}
+
+bool Enqueue(custom::BulkSender *sender, uint16_t stream, size_t size, uint8_t seed, int64_t now_ns = 0) {
+  const uint8_t *data = nullptr;
+  std::shared_ptr<const void> owner = Message(size, seed, &data);
+  return sender->Enqueue(stream, data, size, std::move(owner), now_ns);
+}
+
+std::vector<uint8_t> Expected(size_t size, uint8_t seed) {
+  const uint8_t *data = nullptr;
+  std::shared_ptr<const void> owner = Message(size, seed, &data);
+  return std::vector<uint8_t>(data, data + size);
+}
+
+struct Delivered {
+  uint16_t stream = 0;
+  std::vector<uint8_t> data;
+  bool pooled = false;
+};
+
+custom::BulkReceiver::DeliverFunc Collect(std::vector<Delivered> *out) {
+  return [out](const custom::ReceivedMessage &message) {
+    Delivered delivered;
+    delivered.stream = message.stream;
+    delivered.data.assign(message.data, message.data + message.size);
+    delivered.pooled = message.buffer != nullptr;
+    out->push_back(delivered);
+  };
+}
+
+std::vector<uint8_t> Frame(const custom::DataFrameHeader &header, size_t payload) {
+  std::vector<uint8_t> frame(custom::kDataFrameHeaderSize + payload);
+  custom::WriteDataFrameHeader(header, frame.data());
+  return frame;
+}
+
+// Messages of sizes around the chunk size go through whole, on any stream,
+// and chunks of messages on different streams interleave.
+void TestRoundTrip() {
+  custom::BulkSenderConfig config;
+  config.chunk_size = 7;
+  Channel channel;
+  custom::BulkSender sender(config, channel.Func());
+  const size_t kSizes[] = {0, 1, 6, 7, 8, 14, 38, 100};
+  for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i) {
+    CHECK(Enqueue(&sender, static_cast<uint16_t>(i % 3), kSizes[i], static_cast<uint8_t>(i)));
+  }
+  CHECK_EQ(sender.queued_messages(), 8u);
+  CHECK_EQ(sender.queued_bytes(), 174u);
+  // 1 + 1 + 1 + 1 + 2 + 2 + 6 + 15 frames.
+  CHECK_EQ(sender.Pump(0, 10), 29u);
+  CHECK_EQ(sender.queued_messages(), 0u);
+  CHECK_EQ(sender.queued_bytes(), 0u);
+  CHECK_EQ(sender.stats().messages, 8u);
+  CHECK_EQ(sender.stats().frames, 29u);
+  CHECK_EQ(sender.stats().bytes, 174u);
+  CHECK_EQ(sender.stats().latency_sum_ns, 80);
+  // Nothing is sent twice.
+  CHECK_EQ(sender.Pump(0, 20), 0u);
+
+  std::vector<Delivered> delivered;
+  custom::BulkReceiver receiver(custom::BulkReceiverConfig(), Collect(&delivered));
+  for (const std::vector<uint8_t> &frame : channel.sent) {
+    CHECK(frame.size() <= custom::kDataFrameHeaderSize + 7);
+    CHECK(receiver.OnFrame(frame.data(), frame.size(), 0));
+  }
+  CHECK_EQ(delivered.size(), 8u);
+  CHECK_EQ(receiver.pending_messages(), 0u);
+  CHECK_EQ(receiver.stats().sequence_gaps, 0u);
+  CHECK_EQ(receiver.stats().bytes, 174u);
+  for (size_t i = 0; i < delivered.size(); ++i) {
+    bool found = false;
+    for (size_t j = 0; j < sizeof(kSizes) / sizeof(kSizes[0]); ++j) {
+      if (delivered[i].data == Expected(kSizes[j], static_cast<uint8_t>(j)) && delivered[i].stream == j % 3) {
+        found = true;
+        // A single frame message is a view of its frame.
+        CHECK_EQ(delivered[i].pooled, kSizes[j] > 7);
+      }
+    }
+    CHECK(found);
+  }
+  // Messages of one stream arrive in order.
+  std::vector<size_t> stream0;
+  for (const Delivered &message : delivered) {
+    if (message.stream == 0) {
+      stream0.push_back(message.data.size());
+    }
+  }
+  CHECK(stream0 == std::vector<size_t>({0, 7, 38}));
+}
+
+// Frames go out while bufferedAmount is under high water, and after a stall
+// only once it drained to low water.
+void TestWindow() {
+  custom::BulkSenderConfig config;
+  config.chunk_size = 10;
+  config.high_water = 100;
+  config.low_water = 25;
+  Channel channel;
+  custom::BulkSender sender(config, channel.Func());
+  CHECK(Enqueue(&sender, 0, 100, 1));
+  // 30 byte frames: at 0, 30, 60 and 90.
+  CHECK_EQ(sender.Pump(0, 0), 4u);
+  CHECK_EQ(sender.stats().stalls, 1u);
+  CHECK_EQ(sender.Pump(99, 0), 0u);
+  CHECK_EQ(sender.Pump(26, 0), 0u);
+  CHECK_EQ(sender.Pump(25, 0), 3u);
+  CHECK_EQ(sender.stats().stalls, 2u);
+  CHECK_EQ(sender.Pump(0, 0), 3u);
+  CHECK_EQ(sender.stats().stalls, 2u);
+  CHECK_EQ(sender.stats().messages, 1u);
+  CHECK_EQ(channel.sent.size(), 10u);
+
+  // A window too small for one frame still sends one at a time.
+  config.high_water = 1;
+  config.low_water = 0;
+  sender.set_config(config);
+  CHECK(Enqueue(&sender, 0, 20, 2));
+  CHECK_EQ(sender.Pump(0, 0), 1u);
+  CHECK_EQ(sender.Pump(0, 0), 1u);
+}
+
+// A frame the channel refuses is offered again; a message sent before the
+// channel opens waits for it.
+void TestSendFailures() {
+  custom::BulkSenderConfig config;
+  config.chunk_size = 4;
+  Channel channel;
+  channel.open = false;
+  custom::BulkSender sender(config, channel.Func());
+  CHECK(Enqueue(&sender, 5, 10, 3, 100));
+  CHECK_EQ(sender.Pump(0, 110), 0u);
+  CHECK_EQ(sender.Pump(0, 120), 0u);
+  CHECK_EQ(sender.stats().send_failures, 2u);
+  CHECK_EQ(sender.queued_bytes(), 10u);
+  channel.open = true;
+  CHECK_EQ(sender.Pump(0, 130), 3u);
+  CHECK_EQ(sender.stats().latency_max_ns, 30);
+
+  std::vector<Delivered> delivered;
+  custom::BulkReceiver receiver(custom::BulkReceiverConfig(), Collect(&delivered));
+  for (const std::vector<uint8_t> &frame : channel.sent) {
+    CHECK(receiver.OnFrame(frame.data(), frame.size(), 0));
+  }
+  CHECK_EQ(delivered.size(), 1u);
+  CHECK(delivered[0].data == Expected(10, 3));
+  CHECK_EQ(delivered[0].stream, 5);
+}
+
+void TestSenderLimits() {
+  custom::BulkSenderConfig config;
+  config.max_queued_bytes = 100;
+  Channel channel;
+  custom::BulkSender sender(config, channel.Func());
+  CHECK(Enqueue(&sender, 0, 60, 1));
+  CHECK(!Enqueue(&sender, 0, 41, 1));
+  CHECK(Enqueue(&sender, 1, 40, 1));
+  CHECK_EQ(sender.stats().rejected, 1u);
+  sender.Clear();
+  CHECK_EQ(sender.queued_messages(), 0u);
+  CHECK_EQ(sender.queued_bytes(), 0u);
+  CHECK_EQ(sender.Pump(0, 0), 0u);
+  CHECK(Enqueue(&sender, 0, 100, 1));
+  CHECK_EQ(sender.Pump(0, 0), 1u);
+  CHECK_EQ(channel.sent.size(), 1u);
+}
+
+// Without framing every message goes whole, as it was given, in the order
+// streams are scheduled, and still within the window.
+void TestUnframed() {
+  custom::BulkSenderConfig config;
+  config.chunk_size = 4;
+  config.high_water = 50;
+  config.low_water = 10;
+  config.framed = false;
+  Channel channel;
+  custom::BulkSender sender(config, channel.Func());
+  CHECK(Enqueue(&sender, 0, 30, 1));
+  CHECK(Enqueue(&sender, 0, 0, 2));
+  CHECK(Enqueue(&sender, 0, 100, 3));
+  CHECK(Enqueue(&sender, 0, 5, 4));
+  // 30, then 0, then the 100 byte message takes the window past high water.
+  CHECK_EQ(sender.Pump(0, 0), 3u);
+  CHECK_EQ(sender.stats().stalls, 1u);
+  CHECK_EQ(sender.Pump(11, 0), 0u);
+  CHECK_EQ(sender.Pump(10, 0), 1u);
+  CHECK_EQ(channel.sent.size(), 4u);
+  CHECK(channel.sent[0] == Expected(30, 1));
+  CHECK(channel.sent[1].empty());
+  CHECK(channel.sent[2] == Expected(100, 3));
+  CHECK(channel.sent[3] == Expected(5, 4));
+  CHECK_EQ(sender.stats().messages, 4u);
+  CHECK_EQ(sender.stats().frames, 4u);
+  CHECK_EQ(sender.stats().bytes, 135u);
+
+  // A refused message is offered again whole.
+  channel.open = false;
+  CHECK(Enqueue(&sender, 0, 9, 5));
+  CHECK_EQ(sender.Pump(0, 0), 0u);
+  channel.open = true;
+  CHECK_EQ(sender.Pump(0, 0), 1u);
+  CHECK(channel.sent.back() == Expected(9, 5));
+
+  // Switching back frames the next message.
+  config.framed = true;
+  sender.set_config(config);
+  CHECK(Enqueue(&sender, 0, 9, 6));
+  CHECK_EQ(sender.Pump(0, 0), 3u);
+  CHECK_EQ(channel.sent.back().size(), custom::kDataFrameHeaderSize + 1);
+  CHECK_EQ(channel.sent.back()[0], custom::kDataFrameMagic);
+}
+
+// Text streams go out as text only while unframed.
+void TestTextStreams() {
+  custom::BulkSenderConfig config;
+  config.framed = false;
+  Channel channel;
+  custom::BulkSender sender(config, channel.Func());
+  sender.SetStreamConfig(1, Config(0, 1, true));
+  CHECK(sender.stream_config(1).text);
+  CHECK(!sender.stream_config(2).text);
+  CHECK_EQ(sender.stream_config(2).priority, 1);
+  CHECK(Enqueue(&sender, 2, 10, 1));
+  CHECK(Enqueue(&sender, 1, 5, 2));
+  CHECK_EQ(sender.Pump(0, 0), 2u);
+  // The urgent text message first.
+  CHECK(channel.sent[0] == Expected(5, 2));
+  CHECK(channel.text == std::vector<bool>({true, false}));
+
+  config.framed = true;
+  sender.set_config(config);
+  CHECK(Enqueue(&sender, 1, 5, 3));
+  CHECK_EQ(sender.Pump(0, 0), 1u);
+  CHECK(!channel.text.back());
+}
+
+// A stream only sends while no more urgent one has a frame ready, so a
+// control message goes out between two chunks of a bulk message.
+void TestStrictPriority() {
+  custom::BulkSenderConfig config;
+  config.chunk_size = 10;
+  config.high_water = 60;
+  config.low_water = 0;
+  config.urgent_headroom = 0;
+  Channel channel;
+  custom::BulkSender sender(config, channel.Func());
+  sender.SetStreamConfig(1, Config(0, 1));
+  CHECK(Enqueue(&sender, 2, 50, 1));
+  CHECK(Enqueue(&sender, 3, 50, 2));
+  CHECK_EQ(sender.Pump(0, 0), 2u);
+  CHECK(Enqueue(&sender, 1, 5, 3));
+  CHECK(Enqueue(&sender, 1, 15, 4));
+  // All three control chunks: the window is checked before each frame.
+  CHECK_EQ(sender.Pump(0, 0), 3u);
+  CHECK_EQ(sender.Pump(0, 0), 2u);
+  CHECK(channel.Streams() == std::vector<uint16_t>({2, 3, 1, 1, 1, 2, 3}));
+
+  // Moving a queued stream to another priority takes it along.
+  sender.SetStreamConfig(3, Config(0, 1));
+  CHECK_EQ(sender.Pump(0, 0), 2u);
+  CHECK_EQ(sender.Pump(0, 0), 2u);
+  const std::vector<uint16_t> after = channel.Streams();
+  CHECK(std::vector<uint16_t>(after.begin() + 7, after.end()) == std::vector<uint16_t>({3, 3, 3, 2}));
+
+  std::vector<Delivered> delivered;
+  custom::BulkReceiver receiver(custom::BulkReceiverConfig(), Collect(&delivered));
+  while (sender.queued_messages() > 0) {
+    sender.Pump(0, 0);
+  }
+  for (const std::vector<uint8_t> &frame : channel.sent) {
+    CHECK(receiver.OnFrame(frame.data(), frame.size(), 0));
+  }
+  CHECK_EQ(delivered.size(), 4u);
+  CHECK_EQ(delivered[0].stream, 1);
+  CHECK(delivered[0].data == Expected(5, 3));
+  CHECK(delivered[1].data == Expected(15, 4));
+  CHECK_EQ(receiver.stats().sequence_gaps, 0u);
+}
+
+// Streams of one priority share the channel in proportion to their weights,
+// frame by frame.
+void TestWeightedShares() {
+  custom::BulkSenderConfig config;
+  config.chunk_size = 10;
+  Channel channel;
+  custom::BulkSender sender(config, channel.Func());
+  sender.SetStreamConfig(2, Config(1, 1));
+  sender.SetStreamConfig(3, Config(1, 3));
+  CHECK(Enqueue(&sender, 2, 1000, 1));
+  CHECK(Enqueue(&sender, 3, 1000, 2));
+  sender.Pump(0, 0);
+  const std::vector<uint16_t> streams = channel.Streams();
+  CHECK_EQ(streams.size(), 200u);
+  CHECK(std::vector<uint16_t>(streams.begin(), streams.begin() + 8) ==
+        std::vector<uint16_t>({2, 3, 3, 3, 2, 3, 3, 3}));
+  // Exactly 1:3 while both have data queued.
+  size_t counts[2] = {0, 0};
+  for (size_t i = 0; i < 120; ++i) {
+    counts[streams[i] - 2]++;
+  }
+  CHECK_EQ(counts[0], 30u);
+  CHECK_EQ(counts[1], 90u);
+
+  // Shares count bytes: 21 byte frames against 30 byte ones of the same
+  // weight get more turns, but not more of the channel.
+  Channel bytes_channel;
+  custom::BulkSender bytes_sender(config, bytes_channel.Func());
+  for (int i = 0; i < 40; ++i) {
+    CHECK(Enqueue(&bytes_sender, 2, 10, 1));
+    CHECK(Enqueue(&bytes_sender, 3, 1, 2));
+  }
+  bytes_sender.Pump(0, 0);
+  const std::vector<uint16_t> mixed = bytes_channel.Streams();
+  CHECK(std::vector<uint16_t>(mixed.begin(), mixed.begin() + 12) ==
+        std::vector<uint16_t>({2, 3, 2, 3, 2, 3, 3, 2, 3, 2, 3, 3}));
+  size_t small = 0;
+  for (size_t i = 0; i < 50; ++i) {
+    small += mixed[i] == 3;
+  }
+  CHECK_EQ(small, 29u);
+}
+
+// Priority 0 streams may go urgent_headroom past the window; the others wait
+// for it to drain.
+void TestUrgentHeadroom() {
+  custom::BulkSenderConfig config;
+  config.chunk_size = 10;
+  config.high_water = 100;
+  config.low_water = 25;
+  config.urgent_headroom = 50;
+  Channel channel;
+  custom::BulkSender sender(config, channel.Func());
+  sender.SetStreamConfig(1, Config(0, 1));
+  CHECK(Enqueue(&sender, 2, 200, 1));
+  CHECK_EQ(sender.Pump(0, 0), 4u);
+  CHECK(Enqueue(&sender, 1, 40, 2));
+  // 120 + 30 reaches high water + headroom.
+  CHECK_EQ(sender.Pump(120, 0), 1u);
+  CHECK_EQ(sender.Pump(149, 0), 1u);
+  CHECK_EQ(sender.Pump(150, 0), 0u);
+  // The bulk stream waits for low water even once the urgent one is done.
+  CHECK_EQ(sender.Pump(60, 0), 2u);
+  CHECK_EQ(sender.queued_messages(), 1u);
+  CHECK_EQ(sender.Pump(60, 0), 0u);
+  CHECK_EQ(sender.Pump(25, 0), 3u);
+  const std::vector<uint16_t> streams = channel.Streams();
+  CHECK(streams == std::vector<uint16_t>({2, 2, 2, 2, 1, 1, 1, 1, 2, 2, 2}));
+}
+
+void TestReceiverErrors() {
+  custom::BulkReceiverConfig config;
+  config.max_message_size = 50;
+  config.max_pending_messages = 1;
+  std::vector<Delivered> delivered;
+  custom::BulkReceiver receiver(config, Collect(&delivered));
+
+  const uint8_t kText[] = "hello";
+  CHECK(!receiver.OnFrame(kText, sizeof(kText), 0));
+  CHECK_EQ(std::string(receiver.error()), "not a data frame");
+  CHECK_EQ(receiver.stats().malformed, 1u);
+
+  custom::DataFrameHeader header;
+  header.flags = custom::kDataFrameFirst;
+  header.message_size = 51;
+  std::vector<uint8_t> frame = Frame(header, 10);
+  CHECK(!receiver.OnFrame(frame.data(), frame.size(), 0));
+  CHECK_EQ(std::string(receiver.error()), "message too large");
+
+  // One message at a time is reassembled.
+  header.sequence = 1;
+  header.message_size = 20;
+  frame = Frame(header, 10);
+  CHECK(receiver.OnFrame(frame.data(), frame.size(), 0));
+  header.sequence = 2;
+  header.message_id = 1;
+  frame = Frame(header, 10);
+  CHECK(!receiver.OnFrame(frame.data(), frame.size(), 0));
+  CHECK_EQ(std::string(receiver.error()), "too many messages being reassembled");
+  CHECK_EQ(receiver.pending_messages(), 1u);
+
+  // A chunk has to continue its message where it stopped.
+  header.sequence = 3;
+  header.flags = custom::kDataFrameLast;
+  header.message_id = 0;
+  header.offset = 11;
+  header.message_size = 21;
+  frame = Frame(header, 10);
+  CHECK(!receiver.OnFrame(frame.data(), frame.size(), 0));
+  CHECK_EQ(std::string(receiver.error()), "chunk of a message not being reassembled");
+  header.sequence = 4;
+  header.offset = 10;
+  header.message_size = 20;
+  frame = Frame(header, 10);
+  CHECK(receiver.OnFrame(frame.data(), frame.size(), 7));
+  CHECK_EQ(delivered.size(), 1u);
+  CHECK_EQ(delivered[0].data.size(), 20u);
+  CHECK_EQ(receiver.stats().latency_max_ns, 7);
+  CHECK_EQ(receiver.stats().dropped, 3u);
+  CHECK_EQ(receiver.stats().sequence_gaps, 0u);
+
+  // Gaps in the frame sequence are counted.
+  header.sequence = 9;
+  header.flags = custom::kDataFrameFirst | custom::kDataFrameLast;
+  header.offset = 0;
+  header.message_size = 1;
+  frame = Frame(header, 1);
+  CHECK(receiver.OnFrame(frame.data(), frame.size(), 0));
+  CHECK_EQ(receiver.stats().sequence_gaps, 1u);
+
+  // Reset drops what is being reassembled.
+  header.sequence = 10;
+  header.flags = custom::kDataFrameFirst;
+  header.message_size = 2;
+  frame = Frame(header, 1);
+  CHECK(receiver.OnFrame(frame.data(), frame.size(), 0));
+  receiver.Reset();
+  CHECK_EQ(receiver.pending_messages(), 0u);
+  header.sequence = 0;
+  header.flags = custom::kDataFrameLast;
+  header.offset = 1;
+  frame = Frame(header, 1);
+  CHECK(!receiver.OnFrame(frame.data(), frame.size(), 0));
+  CHECK_EQ(receiver.stats().sequence_gaps, 1u);
+}
+
+// Reassembly buffers come back to the pool once the message is let go.
+void TestReceiverPool() {
+  custom::BulkSenderConfig config;
+  config.chunk_size = 1000;
+  Channel channel;
+  custom::BulkSender sender(config, channel.Func());
+  std::vector<std::shared_ptr<custom::MessageBuffer>> kept;
+  custom::BulkReceiver receiver(custom::BulkReceiverConfig(), [&kept](const custom::ReceivedMessage &message) {
+    kept.push_back(message.buffer);
+  });
+  for (int i = 0; i < 3; ++i) {
+    CHECK(Enqueue(&sender, 0, 5000, static_cast<uint8_t>(i)));
+    sender.Pump(0, 0);
+    for (const std::vector<uint8_t> &frame : channel.sent) {
+      CHECK(receiver.OnFrame(frame.data(), frame.size(), 0));
+    }
+    channel.sent.clear();
+    if (i == 0) {
+      kept.clear();
+    }
+  }
+  CHECK_EQ(kept.size(), 2u);
+  CHECK_EQ(receiver.pool().stats().hits, 1u);
+  CHECK_EQ(receiver.pool().stats().misses, 2u);
+  CHECK_EQ(receiver.pool().stats().in_use, 2u);
+}
+
+}  // namespace
+
+int main() {
+  TestRoundTrip();
+  TestWindow();
+  TestSendFailures();
+  TestSenderLimits();
+  TestUnframed();
+  TestTextStreams();
+  TestStrictPriority();
+  TestWeightedShares();
+  TestUrgentHeadroom();
+  TestReceiverErrors();
+  TestReceiverPool();
+  return TestExitCode();
+}
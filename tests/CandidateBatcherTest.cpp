@@ -0,0 +1,217 @@
+//
+//  CandidateBatcherTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/11.
+//
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "CandidateBatcher.h"
+#include "TestCheck.h"
+
+namespace {
+
+custom::SignalingCandidate Candidate(std::string_view sdp, int32_t index = 0, const char *mid = "0") {
+  custom::SignalingCandidate candidate;
+  candidate.sdp = sdp;
+  candidate.sdp_mline_index = index;
+  candidate.has_sdp_mid = mid != nullptr;
+  if (mid) {
+    candidate.sdp_mid = mid;
+  }
+  return candidate;
+}
+
+std::string Key(const custom::SignalingCandidate &candidate) {
+  std::string key;
+  custom::CandidateAddressKey(candidate, &key);
+  return key;
+}
+
+bool SameAddress(std::string_view a, std::string_view b) {
+  return Key(Candidate(a)) == Key(Candidate(b));
+}
+
+// A sent batch, copied out of the batcher.
+struct Batch {
+  int64_t sent_ns = 0;
+  std::vector<std::string> sdps;
+  std::vector<std::string> mids;
+  std::vector<int32_t> indexes;
+};
+
+const char kHost[] = "candidate:1467250027 1 udp 2122260223 192.168.1.20 54321 typ host generation 0 ufrag abcd";
+
+void TestAddressKey() {
+  // Only the transport address counts.
+  CHECK(SameAddress(kHost, "candidate:99 1 udp 1686052607 192.168.1.20 54321 typ srflx raddr 192.168.1.20 rport "
+                           "54321 generation 1 ufrag wxyz"));
+  CHECK(SameAddress(kHost, std::string("a=") + kHost));
+  CHECK(SameAddress(kHost, "candidate:1467250027  1 UDP 2122260223 192.168.1.20 54321 typ host"));
+  CHECK(SameAddress("candidate:1 1 udp 1 2001:DB8::1 9 typ host", "candidate:1 1 udp 1 2001:db8::1 9 typ host"));
+  CHECK(SameAddress("candidate:1 1 tcp 1 10.0.0.1 9 typ host tcptype passive",
+                    "candidate:2 1 TCP 5 10.0.0.1 9 typ host tcptype PASSIVE"));
+
+  CHECK(!SameAddress(kHost, "candidate:1467250027 2 udp 2122260223 192.168.1.20 54321 typ host"));
+  CHECK(!SameAddress(kHost, "candidate:1467250027 1 tcp 2122260223 192.168.1.20 54321 typ host"));
+  CHECK(!SameAddress(kHost, "candidate:1467250027 1 udp 2122260223 192.168.1.21 54321 typ host"));
+  CHECK(!SameAddress(kHost, "candidate:1467250027 1 udp 2122260223 192.168.1.20 54322 typ host"));
+  CHECK(!SameAddress("candidate:1 1 tcp 1 10.0.0.1 9 typ host tcptype passive",
+                     "candidate:1 1 tcp 1 10.0.0.1 9 typ host tcptype active"));
+  CHECK(!SameAddress("candidate:1 1 tcp 1 10.0.0.1 9 typ host tcptype passive",
+                     "candidate:1 1 tcp 1 10.0.0.1 9 typ host"));
+  // Fields can't run into each other.
+  CHECK(!SameAddress("candidate:1 1 udp 1 10.0.0.1 19 typ host", "candidate:1 1 udp 1 10.0.0.11 9 typ host"));
+
+  CHECK(Key(Candidate(kHost, 0, "0")) != Key(Candidate(kHost, 1, "0")));
+  CHECK(Key(Candidate(kHost, 0, "0")) != Key(Candidate(kHost, 0, "1")));
+  CHECK(Key(Candidate(kHost, 0, "")) != Key(Candidate(kHost, 0, nullptr)));
+
+  // Lines that don't parse are keyed whole.
+  CHECK(!SameAddress("garbage", "garbage "));
+  CHECK(SameAddress("garbage", "garbage"));
+  CHECK(!SameAddress("candidate:1 1 udp 1 10.0.0.1 9 host", "candidate:2 1 udp 1 10.0.0.1 9 host"));
+  CHECK(!SameAddress("candidate:1 1 udp 1 10.0.0.1 9 typ", "candidate:1 1 udp 1 10.0.0.1 9 typ host"));
+}
+
+// Every distinct address is kept: the batcher compares whole keys, so two
+// addresses never collide however many there are.
+void TestDistinctAddressesAreKept() {
+  custom::CandidateBatcherConfig config;
+  config.window_ns = 0;
+  size_t sent = 0;
+  custom::CandidateBatcher batcher(config, [&](const custom::SignalingCandidate *, size_t count) { sent += count; });
+  std::unordered_set<std::string> keys;
+  for (int i = 0; i < 200000; ++i) {
+    char line[128];
+    snprintf(line, sizeof(line), "candidate:1 %d udp 1 10.%d.%d.%d %d typ host", 1 + i % 2, i >> 16 & 0xFF,
+             i >> 8 & 0xFF, i & 0xFF, 1024 + i % 7);
+    const custom::SignalingCandidate candidate = Candidate(line, i % 3, "0");
+    keys.insert(Key(candidate));
+    CHECK(batcher.Add(candidate, i));
+    CHECK(!batcher.Add(candidate, i));
+  }
+  CHECK_EQ(keys.size(), 200000u);
+  CHECK_EQ(sent, 200000u);
+  CHECK_EQ(batcher.stats().duplicates, 200000u);
+}
+
+void TestBatches() {
+  custom::CandidateBatcherConfig config;
+  config.window_ns = 20;
+  config.max_candidates = 3;
+  config.max_bytes = 1000;
+  std::vector<Batch> batches;
+  int64_t now = 0;
+  custom::CandidateBatcher batcher(config, [&](const custom::SignalingCandidate *candidates, size_t count) {
+    Batch batch;
+    batch.sent_ns = now;
+    for (size_t i = 0; i < count; ++i) {
+      batch.sdps.emplace_back(candidates[i].sdp);
+      batch.mids.emplace_back(candidates[i].has_sdp_mid ? candidates[i].sdp_mid : "<none>");
+      batch.indexes.push_back(candidates[i].sdp_mline_index);
+    }
+    batches.push_back(batch);
+  });
+
+  CHECK_EQ(batcher.deadline_ns(), -1);
+  now = 100;
+  CHECK(batcher.Add(Candidate("candidate:1 1 udp 1 10.0.0.1 1 typ host", 0, "audio"), now));
+  CHECK_EQ(batcher.deadline_ns(), 120);
+  now = 110;
+  CHECK(batcher.Add(Candidate("candidate:1 1 udp 1 10.0.0.1 2 typ host", 1, nullptr), now));
+  // A redundant candidate is dropped and doesn't move the deadline.
+  CHECK(!batcher.Add(Candidate("candidate:7 1 udp 9 10.0.0.1 1 typ srflx", 0, "audio"), now));
+  CHECK_EQ(batcher.pending(), 2u);
+  batcher.Poll(119);
+  CHECK(batches.empty());
+  now = 120;
+  batcher.Poll(now);
+  CHECK_EQ(batches.size(), 1u);
+  CHECK_EQ(batches[0].sdps.size(), 2u);
+  CHECK_EQ(batches[0].sdps[1], "candidate:1 1 udp 1 10.0.0.1 2 typ host");
+  CHECK_EQ(batches[0].mids[0], "audio");
+  CHECK_EQ(batches[0].mids[1], "<none>");
+  CHECK_EQ(batches[0].indexes[1], 1);
+  CHECK_EQ(batcher.pending(), 0u);
+  CHECK_EQ(batcher.deadline_ns(), -1);
+
+  // Full at max_candidates.
+  now = 200;
+  for (int port = 10; port < 13; ++port) {
+    CHECK(batcher.Add(Candidate("candidate:1 1 udp 1 10.0.0.1 " + std::to_string(port) + " typ host"), now));
+  }
+  CHECK_EQ(batches.size(), 2u);
+  CHECK_EQ(batches[1].sdps.size(), 3u);
+  CHECK_EQ(batches[1].sent_ns, 200);
+
+  // A candidate that would overflow max_bytes sends what there is first.
+  config.max_bytes = 60;
+  config.max_candidates = 16;
+  batcher.set_config(config);
+  const std::string line_a = "candidate:1 1 udp 1 10.0.0.2 1 typ host" + std::string(10, ' ');
+  const std::string line_b = "candidate:1 1 udp 1 10.0.0.2 2 typ host" + std::string(10, ' ');
+  CHECK(batcher.Add(Candidate(line_a), now));
+  CHECK_EQ(batches.size(), 2u);
+  CHECK(batcher.Add(Candidate(line_b), now));
+  CHECK_EQ(batches.size(), 3u);
+  CHECK_EQ(batches[2].sdps.size(), 1u);
+  CHECK_EQ(batches[2].sdps[0], line_a);
+  CHECK_EQ(batcher.pending(), 1u);
+  now = 205;
+  batcher.Flush(now);
+  CHECK_EQ(batches.size(), 4u);
+  CHECK_EQ(batches[3].sdps[0], line_b);
+  batcher.Flush(now);
+  CHECK_EQ(batches.size(), 4u);
+
+  // No window sends every candidate on its own.
+  config.window_ns = 0;
+  batcher.set_config(config);
+  CHECK(batcher.Add(Candidate("candidate:1 1 udp 1 10.0.0.3 1 typ host"), now));
+  CHECK_EQ(batches.size(), 5u);
+
+  const custom::CandidateBatchStats &stats = batcher.stats();
+  CHECK_EQ(stats.candidates, 9u);
+  CHECK_EQ(stats.duplicates, 1u);
+  CHECK_EQ(stats.batches, 5u);
+  CHECK_EQ(stats.sent, 8u);
+  CHECK_EQ(stats.max_batch, 3u);
+  // 20 and 10 in the first batch, 5 for line_b.
+  CHECK_EQ(stats.latency_sum_ns, 35);
+  CHECK_EQ(stats.latency_max_ns, 20);
+  CHECK_EQ(stats.mean_batch(), 8.0 / 5);
+}
+
+// Reset() forgets the addresses seen, for an ICE restart, but keeps what is
+// queued.
+void TestReset() {
+  custom::CandidateBatcherConfig config;
+  std::vector<size_t> batches;
+  custom::CandidateBatcher batcher(config, [&](const custom::SignalingCandidate *, size_t count) {
+    batches.push_back(count);
+  });
+  CHECK(batcher.Add(Candidate(kHost), 0));
+  CHECK(!batcher.Add(Candidate(kHost), 1));
+  batcher.Reset();
+  CHECK_EQ(batcher.pending(), 1u);
+  CHECK(batcher.Add(Candidate(kHost), 2));
+  batcher.Flush(3);
+  CHECK_EQ(batches.size(), 1u);
+  CHECK_EQ(batches[0], 2u);
+}
+
+}  // namespace
+
+int main() {
+  TestAddressKey();
+  TestDistinctAddressesAreKept();
+  TestBatches();
+  TestReset();
+  return TestExitCode();
+}
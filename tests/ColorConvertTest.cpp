@@ -0,0 +1,275 @@
+//
+//  ColorConvertTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ColorConvert.h"
+#include "RotateConvert.h"
+#include "TestCheck.h"
+#include "TestFrame.h"
+
+namespace {
+
+const custom::SimdPath kPaths[] = {custom::SimdPath::kSSE2, custom::SimdPath::kAVX2, custom::SimdPath::kNEON};
+const custom::YuvMatrix kMatrices[] = {custom::YuvMatrix::kBT601, custom::YuvMatrix::kBT709,
+                                       custom::YuvMatrix::kBT2020};
+const custom::YuvRange kRanges[] = {custom::YuvRange::kVideo, custom::YuvRange::kFull};
+const custom::PixelLayout kYuvLayouts[] = {custom::PixelLayout::kNV12, custom::PixelLayout::kNV21,
+                                           custom::PixelLayout::kI420};
+const int kSizes[][2] = {{64, 48}, {37, 21}, {1, 1}, {130, 3}};
+
+// The fourcc of the custom_test::TestFrame holding |layout|; NV21 has the
+// planes of NV12.
+uint32_t FourccOf(custom::PixelLayout layout) {
+  switch (layout) {
+    case custom::PixelLayout::kBGRA:
+      return custom::kFourccBGRA;
+    case custom::PixelLayout::kI420:
+      return custom::kFourccI420;
+    default:
+      return custom::kFourccNV12VideoRange;
+  }
+}
+
+// A frame with its own storage; rows are padded by 8 bytes, filled with a
+// marker that must survive a conversion.
+struct Frame {
+  custom_test::TestFrame buffer;
+  custom::ColorImage image;
+
+  Frame(custom::PixelLayout layout, int width, int height)
+      : buffer(FourccOf(layout), width, height, 8, 0xEE), image(buffer.Color(layout)) {}
+
+  Frame(const Frame &) = delete;
+  Frame &operator=(const Frame &) = delete;
+
+  // Y, U, V of a 4:2:0 frame, in that order, without padding.
+  std::vector<uint8_t> Samples() const {
+    std::vector<uint8_t> samples;
+    const int chroma_width = (image.width + 1) / 2;
+    const int chroma_height = (image.height + 1) / 2;
+    if (image.layout == custom::PixelLayout::kBGRA) {
+      for (int y = 0; y < image.height; ++y) {
+        const uint8_t *row = image.planes[0] + y * image.strides[0];
+        samples.insert(samples.end(), row, row + image.width * 4);
+      }
+      return samples;
+    }
+    for (int y = 0; y < image.height; ++y) {
+      const uint8_t *row = image.planes[0] + y * image.strides[0];
+      samples.insert(samples.end(), row, row + image.width);
+    }
+    for (int c = 0; c < 2; ++c) {
+      for (int y = 0; y < chroma_height; ++y) {
+        for (int x = 0; x < chroma_width; ++x) {
+          switch (image.layout) {
+            case custom::PixelLayout::kNV12:
+              samples.push_back(image.planes[1][y * image.strides[1] + 2 * x + c]);
+              break;
+            case custom::PixelLayout::kNV21:
+              samples.push_back(image.planes[1][y * image.strides[1] + 2 * x + 1 - c]);
+              break;
+            default:
+              samples.push_back(image.planes[1 + c][y * image.strides[1 + c] + x]);
+              break;
+          }
+        }
+      }
+    }
+    return samples;
+  }
+
+  // Whether the row padding still holds the marker.
+  bool PaddingIntact() const { return buffer.PaddingIntact(); }
+};
+
+// Every SIMD path matches the scalar one bit for bit, in every combination and
+// direction, and leaves the row padding alone.
+void TestSimdMatchesScalar() {
+  for (custom::YuvMatrix matrix : kMatrices) {
+    for (custom::YuvRange range : kRanges) {
+      for (custom::PixelLayout layout : kYuvLayouts) {
+        for (const auto &size : kSizes) {
+          Frame bgra(custom::PixelLayout::kBGRA, size[0], size[1]);
+          Frame yuv(layout, size[0], size[1]);
+          bgra.buffer.FillRandom(size[0] + size[1]);
+          yuv.buffer.FillRandom(size[0] * size[1]);
+
+          Frame expected_yuv(layout, size[0], size[1]);
+          Frame expected_bgra(custom::PixelLayout::kBGRA, size[0], size[1]);
+          const custom::ColorConversion to_yuv =
+              custom::ColorConversion::Select(matrix, range, custom::PixelLayout::kBGRA, layout,
+                                              custom::SimdPath::kScalar);
+          const custom::ColorConversion to_bgra =
+              custom::ColorConversion::Select(matrix, range, layout, custom::PixelLayout::kBGRA,
+                                              custom::SimdPath::kScalar);
+          CHECK(to_yuv.Convert(bgra.image, expected_yuv.image));
+          CHECK(to_bgra.Convert(yuv.image, expected_bgra.image));
+          CHECK(expected_yuv.PaddingIntact());
+          CHECK(expected_bgra.PaddingIntact());
+
+          for (custom::SimdPath path : kPaths) {
+            if (!custom::IsSimdPathSupported(path)) {
+              continue;
+            }
+            Frame actual_yuv(layout, size[0], size[1]);
+            Frame actual_bgra(custom::PixelLayout::kBGRA, size[0], size[1]);
+            CHECK(custom::ColorConversion::Select(matrix, range, custom::PixelLayout::kBGRA, layout, path)
+                      .Convert(bgra.image, actual_yuv.image));
+            CHECK(custom::ColorConversion::Select(matrix, range, layout, custom::PixelLayout::kBGRA, path)
+                      .Convert(yuv.image, actual_bgra.image));
+            if (actual_yuv.Samples() != expected_yuv.Samples() || actual_bgra.Samples() != expected_bgra.Samples() ||
+                !actual_yuv.PaddingIntact() || !actual_bgra.PaddingIntact()) {
+              fprintf(stderr, "%s %dx%d differs from scalar on %s\n", custom::PixelLayoutName(layout), size[0],
+                      size[1], custom::SimdPathName(path));
+              CHECK(false);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// NV12, NV21 and I420 hold the same samples.
+void TestLayoutsAgree() {
+  Frame bgra(custom::PixelLayout::kBGRA, 37, 21);
+  bgra.buffer.FillRandom(3);
+  std::vector<uint8_t> reference;
+  for (custom::PixelLayout layout : kYuvLayouts) {
+    Frame yuv(layout, 37, 21);
+    CHECK(custom::ColorConversion::Select(custom::YuvMatrix::kBT709, custom::YuvRange::kFull,
+                                          custom::PixelLayout::kBGRA, layout)
+              .Convert(bgra.image, yuv.image));
+    if (reference.empty()) {
+      reference = yuv.Samples();
+    }
+    CHECK(yuv.Samples() == reference);
+  }
+}
+
+// BT.601 video range NV12 is the conversion BGRAToNV12Rotated does.
+void TestBT601MatchesRotateConvert() {
+  for (const auto &size : kSizes) {
+    Frame bgra(custom::PixelLayout::kBGRA, size[0], size[1]);
+    bgra.buffer.FillRandom(11);
+    Frame expected(custom::PixelLayout::kNV12, size[0], size[1]);
+    CHECK(custom::BGRAToNV12Rotated(bgra.image.planes[0], bgra.image.strides[0], size[0], size[1],
+                                    expected.image.planes[0], expected.image.strides[0], expected.image.planes[1],
+                                    expected.image.strides[1], custom::Rotation::k0));
+    Frame actual(custom::PixelLayout::kNV12, size[0], size[1]);
+    CHECK(custom::ColorConversion::Select(custom::YuvMatrix::kBT601, custom::YuvRange::kVideo,
+                                          custom::PixelLayout::kBGRA, custom::PixelLayout::kNV12)
+              .Convert(bgra.image, actual.image));
+    CHECK(actual.Samples() == expected.Samples());
+  }
+}
+
+// Converting bands of rows that start on even rows, as CustomPixelBufferUtils
+// does on its thread pool, gives the whole frame's output.
+void TestBandsMatchWholeFrame() {
+  const custom::ColorConversion conversion = custom::ColorConversion::Select(
+      custom::YuvMatrix::kBT601, custom::YuvRange::kVideo, custom::PixelLayout::kBGRA, custom::PixelLayout::kNV12);
+  for (const auto &size : kSizes) {
+    Frame bgra(custom::PixelLayout::kBGRA, size[0], size[1]);
+    bgra.buffer.FillRandom(13);
+    Frame expected(custom::PixelLayout::kNV12, size[0], size[1]);
+    CHECK(conversion.Convert(bgra.image, expected.image));
+    Frame banded(custom::PixelLayout::kNV12, size[0], size[1]);
+    for (int first_row = 0; first_row < size[1]; first_row += 6) {
+      custom::ColorImage src = bgra.image;
+      custom::ColorImage dst = banded.image;
+      src.height = dst.height = std::min(6, size[1] - first_row);
+      src.planes[0] += first_row * src.strides[0];
+      dst.planes[0] += first_row * dst.strides[0];
+      dst.planes[1] += first_row / 2 * dst.strides[1];
+      CHECK(conversion.Convert(src, dst));
+    }
+    CHECK(banded.Samples() == expected.Samples());
+    CHECK(banded.PaddingIntact());
+  }
+}
+
+// Colors that are flat over each 2x2 block survive BGRA -> YUV -> BGRA within
+// 2 code values per channel; subsampling loses nothing there.
+void TestRoundTrip() {
+  const int kWidth = 64;
+  const int kHeight = 64;
+  for (custom::YuvMatrix matrix : kMatrices) {
+    for (custom::YuvRange range : kRanges) {
+      Frame bgra(custom::PixelLayout::kBGRA, kWidth, kHeight);
+      uint32_t state = 5;
+      for (int y = 0; y < kHeight; y += 2) {
+        for (int x = 0; x < kWidth; x += 2) {
+          uint8_t color[4] = {0, 0, 0, 255};
+          for (int c = 0; c < 3; ++c) {
+            state = state * 1664525u + 1013904223u;
+            color[c] = static_cast<uint8_t>(state >> 24);
+          }
+          for (int dy = 0; dy < 2; ++dy) {
+            for (int dx = 0; dx < 2; ++dx) {
+              std::copy(color, color + 4, bgra.image.planes[0] + (y + dy) * bgra.image.strides[0] + (x + dx) * 4);
+            }
+          }
+        }
+      }
+      Frame yuv(custom::PixelLayout::kNV12, kWidth, kHeight);
+      Frame back(custom::PixelLayout::kBGRA, kWidth, kHeight);
+      CHECK(custom::ColorConversion::Select(matrix, range, custom::PixelLayout::kBGRA, custom::PixelLayout::kNV12)
+                .Convert(bgra.image, yuv.image));
+      CHECK(custom::ColorConversion::Select(matrix, range, custom::PixelLayout::kNV12, custom::PixelLayout::kBGRA)
+                .Convert(yuv.image, back.image));
+      const std::vector<uint8_t> before = bgra.Samples();
+      const std::vector<uint8_t> after = back.Samples();
+      int error = 0;
+      for (size_t i = 0; i < before.size(); ++i) {
+        error = std::max(error, std::abs(before[i] - after[i]));
+      }
+      if (error > 2) {
+        fprintf(stderr, "round trip matrix %d range %d: max error %d\n", static_cast<int>(matrix),
+                static_cast<int>(range), error);
+        CHECK(false);
+      }
+    }
+  }
+}
+
+void TestRejectsInvalid() {
+  CHECK(!custom::ColorConversion().valid());
+  CHECK(!custom::ColorConversion::Select(custom::YuvMatrix::kBT601, custom::YuvRange::kVideo,
+                                         custom::PixelLayout::kBGRA, custom::PixelLayout::kBGRA)
+             .valid());
+  CHECK(!custom::ColorConversion::Select(custom::YuvMatrix::kBT601, custom::YuvRange::kVideo,
+                                         custom::PixelLayout::kNV12, custom::PixelLayout::kI420)
+             .valid());
+
+  const custom::ColorConversion conversion = custom::ColorConversion::Select(
+      custom::YuvMatrix::kBT601, custom::YuvRange::kVideo, custom::PixelLayout::kBGRA, custom::PixelLayout::kNV12);
+  CHECK(conversion.valid());
+  CHECK(conversion.path() != custom::SimdPath::kAuto);
+  Frame bgra(custom::PixelLayout::kBGRA, 16, 16);
+  Frame smaller(custom::PixelLayout::kNV12, 16, 14);
+  Frame i420(custom::PixelLayout::kI420, 16, 16);
+  CHECK(!conversion.Convert(bgra.image, smaller.image));
+  CHECK(!conversion.Convert(bgra.image, i420.image));
+}
+
+}  // namespace
+
+int main() {
+  TestSimdMatchesScalar();
+  TestLayoutsAgree();
+  TestBT601MatchesRotateConvert();
+  TestBandsMatchWholeFrame();
+  TestRoundTrip();
+  TestRejectsInvalid();
+  return TestExitCode();
+}
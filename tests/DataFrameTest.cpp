@@ -0,0 +1,123 @@
+//
+//  DataFrameTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/13.
+//
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "DataFrame.h"
+#include "TestCheck.h"
+
+namespace {
+
+// A frame of |header| with a |payload| byte chunk of zeros.
+std::vector<uint8_t> Frame(const custom::DataFrameHeader &header, size_t payload) {
+  std::vector<uint8_t> frame(custom::kDataFrameHeaderSize + payload);
+  custom::WriteDataFrameHeader(header, frame.data());
+  return frame;
+}
+
+std::string ReadError(const std::vector<uint8_t> &frame) {
+  custom::DataFrameHeader header;
+  const char *error = "";
+  if (custom::ReadDataFrameHeader(frame.data(), frame.size(), &header, &error)) {
+    return "";
+  }
+  return error;
+}
+
+void TestLayout() {
+  custom::DataFrameHeader header;
+  header.flags = custom::kDataFrameFirst;
+  header.stream = 0x0102;
+  header.sequence = 0x03040506;
+  header.message_id = 0x0708090A;
+  header.offset = 0;
+  header.message_size = 0x0B0C0D0E;
+  const std::vector<uint8_t> frame = Frame(header, 3);
+  const uint8_t kExpected[custom::kDataFrameHeaderSize] = {
+      0xCB, 0x11, 0x02, 0x01, 0x06, 0x05, 0x04, 0x03, 0x0A, 0x09,
+      0x08, 0x07, 0x00, 0x00, 0x00, 0x00, 0x0E, 0x0D, 0x0C, 0x0B,
+  };
+  CHECK(std::vector<uint8_t>(frame.begin(), frame.begin() + custom::kDataFrameHeaderSize) ==
+        std::vector<uint8_t>(kExpected, kExpected + custom::kDataFrameHeaderSize));
+
+  custom::DataFrameHeader read;
+  const char *error = "";
+  CHECK(custom::ReadDataFrameHeader(frame.data(), frame.size(), &read, &error));
+  CHECK_EQ(read.flags, custom::kDataFrameFirst);
+  CHECK_EQ(read.stream, 0x0102);
+  CHECK_EQ(read.sequence, 0x03040506u);
+  CHECK_EQ(read.message_id, 0x0708090Au);
+  CHECK_EQ(read.offset, 0u);
+  CHECK_EQ(read.message_size, 0x0B0C0D0Eu);
+
+  // Flags past the low four bits aren't written.
+  header.flags = 0xF0 | custom::kDataFrameFirst;
+  CHECK_EQ(Frame(header, 3)[1], 0x11);
+}
+
+void TestChunkBounds() {
+  custom::DataFrameHeader header;
+  header.message_size = 10;
+
+  // First, middle and last chunks of a 10 byte message.
+  header.flags = custom::kDataFrameFirst;
+  CHECK_EQ(ReadError(Frame(header, 4)), "");
+  header.flags = 0;
+  header.offset = 4;
+  CHECK_EQ(ReadError(Frame(header, 3)), "");
+  header.flags = custom::kDataFrameLast;
+  header.offset = 7;
+  CHECK_EQ(ReadError(Frame(header, 3)), "");
+  CHECK_EQ(ReadError(Frame(header, 4)), "chunk past the end of its message");
+  // A single frame message, and an empty one.
+  header.flags = custom::kDataFrameFirst | custom::kDataFrameLast;
+  header.offset = 0;
+  CHECK_EQ(ReadError(Frame(header, 10)), "");
+  header.message_size = 0;
+  CHECK_EQ(ReadError(Frame(header, 0)), "");
+
+  // Flags have to match where the chunk is.
+  header.message_size = 10;
+  header.flags = custom::kDataFrameFirst;
+  CHECK_EQ(ReadError(Frame(header, 10)), "chunk flags don't match its offset");
+  header.flags = custom::kDataFrameLast;
+  header.offset = 4;
+  CHECK_EQ(ReadError(Frame(header, 3)), "chunk flags don't match its offset");
+  header.flags = 0;
+  header.offset = 0;
+  CHECK_EQ(ReadError(Frame(header, 3)), "chunk flags don't match its offset");
+  // The offset and the chunk size don't wrap around.
+  header.flags = custom::kDataFrameLast;
+  header.offset = 0xFFFFFFFF;
+  header.message_size = 0xFFFFFFFF;
+  CHECK_EQ(ReadError(Frame(header, 2)), "chunk past the end of its message");
+}
+
+void TestNotAFrame() {
+  custom::DataFrameHeader header;
+  header.flags = custom::kDataFrameFirst | custom::kDataFrameLast;
+  std::vector<uint8_t> frame = Frame(header, 0);
+  frame.pop_back();
+  CHECK_EQ(ReadError(frame), "not a data frame");
+  frame = Frame(header, 0);
+  frame[0] = 'h';
+  CHECK_EQ(ReadError(frame), "not a data frame");
+  frame = Frame(header, 0);
+  frame[1] = 0x23;
+  CHECK_EQ(ReadError(frame), "unsupported data frame version");
+}
+
+}  // namespace
+
+int main() {
+  TestLayout();
+  TestChunkBounds();
+  TestNotAFrame();
+  return TestExitCode();
+}
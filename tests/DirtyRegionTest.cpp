@@ -0,0 +1,208 @@
+//
+//  DirtyRegionTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "DirtyRegion.h"
+#include "TestCheck.h"
+#include "TestFrame.h"
+#include "YuvFilter.h"
+
+namespace {
+
+const custom::SimdPath kPaths[] = {custom::SimdPath::kScalar, custom::SimdPath::kSSE2, custom::SimdPath::kAVX2,
+                                   custom::SimdPath::kNEON};
+
+using custom_test::TestFrame;
+
+// Sets the chroma sample (x, y) of plane U (0) or V (1).
+void SetChroma(TestFrame *frame, int c, int x, int y, uint8_t value) {
+  if (frame->image.format == custom::kFourccI420) {
+    frame->At(1 + c, x, y) = value;
+  } else {
+    frame->At(1, 2 * x + c, y) = value;
+  }
+}
+
+// A screen like frame: flat areas, a few edges and colored panels.
+void DrawScene(TestFrame *frame) {
+  const custom::Yuv420Image &image = frame->image;
+  for (int y = 0; y < image.height; ++y) {
+    for (int x = 0; x < image.width; ++x) {
+      image.planes[0][y * image.strides[0] + x] = static_cast<uint8_t>((x / 24 + y / 20) % 2 ? 200 : 60);
+    }
+  }
+  for (int y = 0; y < (image.height + 1) / 2; ++y) {
+    for (int x = 0; x < (image.width + 1) / 2; ++x) {
+      SetChroma(frame, 0, x, y, static_cast<uint8_t>(x < image.width / 4 ? 90 : 150));
+      SetChroma(frame, 1, x, y, static_cast<uint8_t>(y < image.height / 4 ? 170 : 110));
+    }
+  }
+}
+
+// Moves a |size| x |size| window with a pattern of its own to (x, y).
+void DrawWindow(TestFrame *frame, int x0, int y0, int size, uint8_t shade) {
+  for (int y = y0; y < y0 + size && y < frame->image.height; ++y) {
+    for (int x = x0; x < x0 + size && x < frame->image.width; ++x) {
+      frame->image.planes[0][y * frame->image.strides[0] + x] = static_cast<uint8_t>(shade + (x ^ y) % 16);
+    }
+  }
+  for (int y = y0 / 2; y < (y0 + size) / 2 && y < (frame->image.height + 1) / 2; ++y) {
+    for (int x = x0 / 2; x < (x0 + size) / 2 && x < (frame->image.width + 1) / 2; ++x) {
+      SetChroma(frame, 0, x, y, 200);
+      SetChroma(frame, 1, x, y, 60);
+    }
+  }
+}
+
+// Filters |frames| in tile mode, each output becoming the next previous one,
+// and checks every output against a full frame ApplyYuvFilter().
+void CheckMatchesFullFrame(const custom::YuvFilter &filter, const std::vector<TestFrame> &frames, const char *name) {
+  custom::DirtyRegionDetector detector;
+  std::vector<TestFrame> outputs;
+  for (size_t i = 0; i < frames.size(); ++i) {
+    const custom::Yuv420Image &src = frames[i].image;
+    TestFrame tiled(custom::kFourccNV12VideoRange, src.width, src.height);
+    TestFrame full(custom::kFourccNV12VideoRange, src.width, src.height);
+    CHECK(custom::ApplyYuvFilterToChangedTiles(filter, src, outputs.empty() ? nullptr : &outputs.back().image,
+                                               tiled.image, &detector));
+    CHECK(custom::ApplyYuvFilter(filter, src, full.image));
+    if (!(tiled == full)) {
+      fprintf(stderr, "%s: frame %zu differs from full frame filtering\n", name, i);
+      CHECK(false);
+    }
+    outputs.push_back(tiled);
+  }
+}
+
+// The reviewer's cases: one changed tile, whose upsampled chroma reaches into
+// its neighbours, and a change of color only.
+void TestTilesMatchFullFrame() {
+  const custom::YuvFilter filter = custom::YuvFilter::BrightnessContrast(0.05f, 1.4f);
+  for (uint32_t format : {custom::kFourccNV12VideoRange, custom::kFourccI420}) {
+    TestFrame scene(format, 64, 64);
+    DrawScene(&scene);
+
+    TestFrame one_tile = scene;
+    DrawWindow(&one_tile, 16, 16, 16, 30);
+    CheckMatchesFullFrame(filter, {scene, one_tile}, "one tile");
+
+    TestFrame chroma_only = scene;
+    for (int y = 8; y < 16; ++y) {
+      for (int x = 8; x < 16; ++x) {
+        SetChroma(&chroma_only, 0, x, y, 40);
+        SetChroma(&chroma_only, 1, x, y, 220);
+      }
+    }
+    CheckMatchesFullFrame(filter, {scene, chroma_only}, "chroma only");
+  }
+
+  // A window moving over a static screen, odd size so the edge blocks are
+  // partial.
+  std::vector<TestFrame> frames;
+  TestFrame frame(custom::kFourccNV12VideoRange, 150, 94);
+  DrawScene(&frame);
+  frames.push_back(frame);
+  for (int i = 0; i < 12; ++i) {
+    TestFrame next = frames.front();
+    DrawWindow(&next, 6 + i * 9, 4 + i * 5, 40, static_cast<uint8_t>(40 + i * 10));
+    frames.push_back(next);
+  }
+  CheckMatchesFullFrame(custom::YuvFilter::Grayscale(), frames, "moving window");
+}
+
+void TestDetectsChroma() {
+  TestFrame scene(custom::kFourccNV12VideoRange, 64, 48);
+  DrawScene(&scene);
+  custom::DirtyRegionDetector detector;
+  std::vector<custom::DirtyRect> rects;
+  const custom::Yuv420Image &image = scene.image;
+  CHECK(detector.Detect(image.planes[0], image.strides[0], image.planes[1], image.strides[1], nullptr, 0, 64, 48,
+                        &rects));
+  CHECK_EQ(rects.size(), 1u);
+
+  SetChroma(&scene, 1, 20, 10, 0);
+  CHECK(detector.Detect(image.planes[0], image.strides[0], 64, 48, &rects));
+  // Comparing luma only is a change of layout, everything is dirty again.
+  CHECK_EQ(rects.size(), 1u);
+  CHECK_EQ(rects[0].width, 64);
+  CHECK(detector.Detect(image.planes[0], image.strides[0], 64, 48, &rects));
+  CHECK(rects.empty());
+
+  CHECK(detector.Detect(image.planes[0], image.strides[0], image.planes[1], image.strides[1], nullptr, 0, 64, 48,
+                        &rects));
+  CHECK(detector.Detect(image.planes[0], image.strides[0], image.planes[1], image.strides[1], nullptr, 0, 64, 48,
+                        &rects));
+  CHECK(rects.empty());
+  // Chroma sample (20, 10) is in block (2, 1).
+  SetChroma(&scene, 0, 20, 10, 255);
+  CHECK(detector.Detect(image.planes[0], image.strides[0], image.planes[1], image.strides[1], nullptr, 0, 64, 48,
+                        &rects));
+  CHECK_EQ(rects.size(), 1u);
+  CHECK_EQ(rects[0].x, 32);
+  CHECK_EQ(rects[0].y, 16);
+  CHECK_EQ(rects[0].width, 16);
+  CHECK_EQ(rects[0].height, 16);
+}
+
+void TestGrowDirtyBlocks() {
+  TestFrame scene(custom::kFourccNV12VideoRange, 80, 64);
+  DrawScene(&scene);
+  custom::DirtyRegionDetector detector;
+  std::vector<custom::DirtyRect> rects;
+  const custom::Yuv420Image &image = scene.image;
+  CHECK(detector.Detect(image.planes[0], image.strides[0], 80, 64, &rects));
+  image.planes[0][0] ^= 0xFF;
+  image.planes[0][40 * image.strides[0] + 70] ^= 0xFF;
+  CHECK(detector.Detect(image.planes[0], image.strides[0], 80, 64, &rects));
+  CHECK_EQ(detector.stats().dirty_blocks, 20u + 2u);
+  detector.GrowDirtyBlocks();
+  // Block (0, 0) grows to 2x2 blocks, block (4, 2) to 2x3 at the right edge.
+  const std::vector<uint8_t> &map = detector.block_map();
+  int dirty = 0;
+  for (uint8_t block : map) {
+    dirty += block;
+  }
+  CHECK_EQ(dirty, 4 + 6);
+  CHECK(map[0] && map[1] && map[5] && map[6] && !map[2]);
+  CHECK(map[1 * 5 + 3] && map[3 * 5 + 4] && !map[3 * 5 + 2]);
+  CHECK_EQ(detector.stats().dirty_blocks, 20u + 10u);
+  detector.CollectRects(true, &rects);
+  CHECK_EQ(rects.size(), 2u);
+}
+
+void TestBlockSadPaths() {
+  std::vector<uint8_t> a(32 * 16);
+  std::vector<uint8_t> b(32 * 16);
+  uint32_t state = 3;
+  for (size_t i = 0; i < a.size(); ++i) {
+    state = state * 1664525u + 1013904223u;
+    a[i] = static_cast<uint8_t>(state >> 24);
+    b[i] = static_cast<uint8_t>(state >> 16);
+  }
+  for (int height : {1, 7, 16}) {
+    const uint32_t expected = custom::BlockSad(a.data(), 32, b.data(), 32, 16, height, custom::SimdPath::kScalar);
+    for (custom::SimdPath path : kPaths) {
+      if (custom::IsSimdPathSupported(path)) {
+        CHECK_EQ(custom::BlockSad(a.data(), 32, b.data(), 32, 16, height, path), expected);
+      }
+    }
+  }
+  CHECK_EQ(custom::BlockSad(a.data(), 32, a.data(), 32, 16, 16), 0u);
+}
+
+}  // namespace
+
+int main() {
+  TestTilesMatchFullFrame();
+  TestDetectsChroma();
+  TestGrowDirtyBlocks();
+  TestBlockSadPaths();
+  return TestExitCode();
+}
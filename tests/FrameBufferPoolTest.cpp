@@ -0,0 +1,157 @@
+//
+//  FrameBufferPoolTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "FrameBufferPool.h"
+#include "TestCheck.h"
+
+namespace {
+
+custom::FrameBufferKey Key(int width, int height, uint32_t format = custom::kFourccNV12VideoRange) {
+  custom::FrameBufferKey key;
+  key.width = width;
+  key.height = height;
+  key.format = format;
+  return key;
+}
+
+void TestRecycles() {
+  custom::FrameBufferPool pool;
+  std::shared_ptr<custom::FrameBuffer> first = pool.Acquire(Key(64, 48));
+  CHECK(first != nullptr);
+  CHECK_EQ(first->layout.plane_count, 2);
+  CHECK_EQ(reinterpret_cast<uintptr_t>(first->data) % 64, 0u);
+  uint8_t *data = first->data;
+  first.reset();
+  std::shared_ptr<custom::FrameBuffer> second = pool.Acquire(Key(64, 48));
+  CHECK_EQ(second->data, data);
+  CHECK_EQ(pool.stats().hits, 1u);
+  CHECK_EQ(pool.stats().misses, 1u);
+  CHECK(pool.Acquire(Key(64, 48, 0)) == nullptr);
+}
+
+// high_water is the most buffers in use at once, not the number allocated.
+void TestHighWaterIsMaxInUse() {
+  custom::FrameBufferPool pool;
+  for (int i = 0; i < 10; ++i) {
+    std::shared_ptr<custom::FrameBuffer> a = pool.Acquire(Key(64, 48));
+    std::shared_ptr<custom::FrameBuffer> b = pool.Acquire(Key(64, 48));
+    CHECK_EQ(pool.stats().in_use, 2u);
+  }
+  CHECK_EQ(pool.stats().in_use, 0u);
+  CHECK_EQ(pool.stats().high_water, 2u);
+  CHECK_EQ(pool.stats().misses, 2u);
+  CHECK_EQ(pool.stats().hits, 18u);
+
+  std::shared_ptr<custom::FrameBuffer> held = pool.Acquire(Key(64, 48));
+  pool.ResetStats();
+  CHECK_EQ(pool.stats().high_water, 1u);
+  CHECK_EQ(pool.stats().hits, 0u);
+}
+
+void TestIdleLimitAndFlush() {
+  custom::FrameBufferPool pool(2, 4);
+  std::vector<std::shared_ptr<custom::FrameBuffer>> buffers;
+  for (int i = 0; i < 4; ++i) {
+    buffers.push_back(pool.Acquire(Key(64, 48)));
+  }
+  const size_t size = buffers[0]->layout.total_size;
+  CHECK_EQ(pool.stats().allocated_bytes, 4 * size);
+  buffers.clear();
+  // Only two are kept idle.
+  CHECK_EQ(pool.stats().allocated_bytes, 2 * size);
+  pool.Flush();
+  CHECK_EQ(pool.stats().allocated_bytes, 0u);
+}
+
+void TestEvictsLeastRecentlyUsedKey() {
+  custom::FrameBufferPool pool(4, 2);
+  pool.Acquire(Key(64, 48));
+  pool.Acquire(Key(32, 24));
+  pool.Acquire(Key(64, 48));
+  pool.Acquire(Key(16, 12));
+  // 32x24 was evicted, 64x48 is still pooled.
+  pool.ResetStats();
+  pool.Acquire(Key(64, 48));
+  pool.Acquire(Key(32, 24));
+  CHECK_EQ(pool.stats().hits, 1u);
+  CHECK_EQ(pool.stats().misses, 1u);
+}
+
+void TestBufferOutlivesPool() {
+  std::shared_ptr<custom::FrameBuffer> buffer;
+  {
+    custom::FrameBufferPool pool;
+    buffer = pool.Acquire(Key(64, 48));
+  }
+  buffer->Plane(1)[0] = 1;
+  buffer.reset();
+}
+
+struct AllocatorCounts {
+  int allocated = 0;
+  int freed = 0;
+};
+
+custom::FrameBufferAllocator CountingAllocator(std::shared_ptr<AllocatorCounts> counts) {
+  custom::FrameBufferAllocator allocator;
+  allocator.allocate = [counts](custom::FrameBuffer *buffer) -> size_t {
+    if (buffer->key.format != custom::kFourccBGRA) {
+      return 0;
+    }
+    counts->allocated++;
+    buffer->layout = custom::ComputeFrameLayout(buffer->key, 1);
+    buffer->handle = new int(counts->allocated);
+    return buffer->layout.total_size;
+  };
+  allocator.free = [counts](custom::FrameBuffer *buffer) {
+    counts->freed++;
+    delete static_cast<int *>(buffer->handle);
+  };
+  return allocator;
+}
+
+void TestCustomAllocator() {
+  auto counts = std::make_shared<AllocatorCounts>();
+  std::shared_ptr<custom::FrameBuffer> kept;
+  {
+    custom::FrameBufferPool pool(1, 4, CountingAllocator(counts));
+    CHECK(pool.Acquire(Key(8, 8)) == nullptr);
+    std::shared_ptr<custom::FrameBuffer> a = pool.Acquire(Key(8, 8, custom::kFourccBGRA));
+    std::shared_ptr<custom::FrameBuffer> b = pool.Acquire(Key(8, 8, custom::kFourccBGRA));
+    CHECK(a->data == nullptr);
+    CHECK_EQ(*static_cast<int *>(a->handle), 1);
+    CHECK_EQ(*static_cast<int *>(b->handle), 2);
+    CHECK_EQ(pool.stats().allocated_bytes, 2 * 8 * 8 * 4u);
+    void *handle = a->handle;
+    a.reset();
+    b.reset();
+    // One is kept idle, the other freed.
+    CHECK_EQ(counts->freed, 1);
+    kept = pool.Acquire(Key(8, 8, custom::kFourccBGRA));
+    CHECK_EQ(kept->handle, handle);
+    CHECK_EQ(counts->allocated, 2);
+  }
+  // Freed by the allocator after the pool is gone too.
+  kept.reset();
+  CHECK_EQ(counts->freed, 2);
+}
+
+}  // namespace
+
+int main() {
+  TestRecycles();
+  TestHighWaterIsMaxInUse();
+  TestIdleLimitAndFlush();
+  TestEvictsLeastRecentlyUsedKey();
+  TestBufferOutlivesPool();
+  TestCustomAllocator();
+  return TestExitCode();
+}
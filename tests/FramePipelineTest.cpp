@@ -0,0 +1,121 @@
+//
+//  FramePipelineTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+#include <cstdint>
+#include <vector>
+
+#include "FramePipeline.h"
+#include "TestCheck.h"
+
+namespace {
+
+// Stands in for the GPU: a frame's work is done once the fake clock reaches
+// its ready time, and a blocking wait advances the clock to it.
+struct FakeGpuStage {
+  struct Frame {
+    int id = 0;
+    int64_t ready_at = 0;
+  };
+
+  int64_t now = 0;
+  int blocking_waits = 0;
+  std::vector<int> completed;
+  std::vector<int64_t> timestamps;
+
+  bool IsDone(Frame &frame, bool wait) {
+    if (wait && frame.ready_at > now) {
+      now = frame.ready_at;
+      blocking_waits++;
+    }
+    return frame.ready_at <= now;
+  }
+
+  void Complete(Frame frame, int64_t timestamp_ns) {
+    completed.push_back(frame.id);
+    timestamps.push_back(timestamp_ns);
+  }
+};
+
+void TestCompletesInOrder() {
+  custom::FramePipeline<FakeGpuStage::Frame> pipeline(3);
+  FakeGpuStage gpu;
+  pipeline.Submit(100, {0, 30});
+  pipeline.Submit(200, {1, 10});
+  pipeline.Submit(300, {2, 20});
+  // Frame 1 and 2 are done, but frame 0 isn't: nothing completes out of order.
+  gpu.now = 25;
+  CHECK_EQ(pipeline.Poll(gpu), 0u);
+  gpu.now = 30;
+  CHECK_EQ(pipeline.Poll(gpu), 3u);
+  CHECK(gpu.completed == std::vector<int>({0, 1, 2}));
+  CHECK(gpu.timestamps == std::vector<int64_t>({100, 200, 300}));
+  CHECK_EQ(gpu.blocking_waits, 0);
+}
+
+// A full pipeline blocks on its oldest frame before the next draw.
+void TestBoundsFramesInFlight() {
+  custom::FramePipeline<FakeGpuStage::Frame> pipeline(2);
+  FakeGpuStage gpu;
+  for (int i = 0; i < 10; ++i) {
+    pipeline.WaitForCapacity(gpu);
+    CHECK(pipeline.in_flight() < 2);
+    pipeline.Submit(i, {i, gpu.now + 50});
+    gpu.now += 10;
+  }
+  CHECK_EQ(pipeline.stats().max_in_flight_seen, 2u);
+  CHECK_EQ(pipeline.stats().completed, 8u);
+  CHECK(gpu.blocking_waits > 0);
+  CHECK_EQ(pipeline.stats().forced_waits, static_cast<uint64_t>(gpu.blocking_waits));
+  CHECK_EQ(pipeline.Flush(gpu), 2u);
+  CHECK_EQ(pipeline.in_flight(), 0u);
+  for (int i = 0; i < 10; ++i) {
+    CHECK_EQ(gpu.completed[i], i);
+  }
+}
+
+// With the GPU faster than the frame interval, the previous frame is always
+// done by the next call and nothing blocks: the overlap the pipeline is for.
+void TestOverlapsWhenGpuKeepsUp() {
+  custom::FramePipeline<FakeGpuStage::Frame> pipeline;
+  FakeGpuStage gpu;
+  for (int i = 0; i < 30; ++i) {
+    pipeline.Poll(gpu);
+    pipeline.WaitForCapacity(gpu);
+    pipeline.Submit(i, {i, gpu.now + 20});
+    gpu.now += 33;
+  }
+  CHECK_EQ(gpu.blocking_waits, 0);
+  CHECK_EQ(pipeline.in_flight(), 1u);
+  pipeline.Flush(gpu);
+  CHECK_EQ(gpu.completed.size(), 30u);
+}
+
+void TestShrinkingDepthAndClear() {
+  custom::FramePipeline<FakeGpuStage::Frame> pipeline(3);
+  FakeGpuStage gpu;
+  for (int i = 0; i < 3; ++i) {
+    pipeline.Submit(i, {i, 100});
+  }
+  pipeline.set_max_in_flight(1);
+  CHECK_EQ(pipeline.WaitForCapacity(gpu), 3u);
+  pipeline.set_max_in_flight(0);
+  CHECK_EQ(pipeline.max_in_flight(), 1u);
+  pipeline.Submit(3, {3, 1000});
+  pipeline.Clear();
+  CHECK_EQ(pipeline.Flush(gpu), 0u);
+  CHECK_EQ(gpu.completed.size(), 3u);
+}
+
+}  // namespace
+
+int main() {
+  TestCompletesInOrder();
+  TestBoundsFramesInFlight();
+  TestOverlapsWhenGpuKeepsUp();
+  TestShrinkingDepthAndClear();
+  return TestExitCode();
+}
@@ -0,0 +1,146 @@
+//
+//  FramePyramidTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "FramePyramid.h"
+#include "TestCheck.h"
+
+namespace {
+
+const custom::SimdPath kPaths[] = {custom::SimdPath::kScalar, custom::SimdPath::kSSE2, custom::SimdPath::kAVX2,
+                                   custom::SimdPath::kNEON};
+
+struct Plane {
+  int width = 0;
+  int height = 0;
+  int channels = 1;
+  int stride = 0;
+  std::vector<uint8_t> data;
+
+  uint8_t At(int x, int y, int c) const {
+    return data[static_cast<size_t>(std::min(y, height - 1)) * stride + std::min(x, width - 1) * channels + c];
+  }
+};
+
+Plane MakePlane(int width, int height, int channels, int padding, uint32_t seed) {
+  Plane plane;
+  plane.width = width;
+  plane.height = height;
+  plane.channels = channels;
+  plane.stride = width * channels + padding;
+  plane.data.resize(static_cast<size_t>(plane.stride) * height);
+  uint32_t state = seed;
+  for (uint8_t &value : plane.data) {
+    state = state * 1664525u + 1013904223u;
+    value = static_cast<uint8_t>(state >> 24);
+  }
+  return plane;
+}
+
+// A |factor| x |factor| box of |plane| at layer sample (x, y), edges clamped.
+uint8_t Box(const Plane &plane, int x, int y, int c, int factor) {
+  int sum = factor * factor / 2;
+  for (int dy = 0; dy < factor; ++dy) {
+    for (int dx = 0; dx < factor; ++dx) {
+      sum += plane.At(x * factor + dx, y * factor + dy, c);
+    }
+  }
+  return static_cast<uint8_t>(sum / (factor * factor));
+}
+
+// Whether |layer|'s |width| x |height| samples are the boxes of |plane|.
+bool MatchesBoxes(const Plane &plane, const uint8_t *layer, int stride, int width, int height, int factor) {
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      for (int c = 0; c < plane.channels; ++c) {
+        if (layer[static_cast<size_t>(y) * stride + x * plane.channels + c] != Box(plane, x, y, c, factor)) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// Every path produces exact 2x2 and 4x4 boxes of the source, odd sizes
+// included.
+void TestMatchesBoxReference() {
+  const int kSizes[][2] = {{4, 4}, {5, 7}, {37, 21}, {64, 48}, {130, 66}, {642, 362}, {1280, 720}};
+  for (const auto &size : kSizes) {
+    const int width = size[0];
+    const int height = size[1];
+    const Plane y = MakePlane(width, height, 1, 16, width);
+    const Plane uv = MakePlane((width + 1) / 2, (height + 1) / 2, 2, 16, height);
+    for (custom::SimdPath path : kPaths) {
+      if (!custom::IsSimdPathSupported(path)) {
+        continue;
+      }
+      custom::FrameBufferPool pool;
+      custom::NV12Pyramid pyramid;
+      CHECK(custom::BuildNV12Pyramid(y.data.data(), y.stride, uv.data.data(), uv.stride, width, height,
+                                     custom::kFourccNV12VideoRange, &pool, &pyramid, path));
+      bool ok = true;
+      for (int level = 1; level <= custom::kPyramidLayerCount; ++level) {
+        const custom::PyramidLayer &layer = pyramid.layers[level - 1];
+        const int factor = 1 << level;
+        ok = ok && layer.width == width / factor && layer.height == height / factor;
+        ok = ok && MatchesBoxes(y, layer.y, layer.stride_y, layer.width, layer.height, factor);
+        ok = ok && MatchesBoxes(uv, layer.uv, layer.stride_uv, (layer.width + 1) / 2, (layer.height + 1) / 2, factor);
+      }
+      if (!ok) {
+        fprintf(stderr, "%dx%d on %s differs from the box reference\n", width, height, custom::SimdPathName(path));
+        CHECK(false);
+      }
+    }
+  }
+}
+
+// Both layers share one pooled buffer, which is recycled once released.
+void TestSharesOnePooledBuffer() {
+  const Plane y = MakePlane(64, 48, 1, 0, 1);
+  const Plane uv = MakePlane(32, 24, 2, 0, 2);
+  custom::FrameBufferPool pool;
+  for (int i = 0; i < 3; ++i) {
+    custom::NV12Pyramid pyramid;
+    CHECK(custom::BuildNV12Pyramid(y.data.data(), y.stride, uv.data.data(), uv.stride, 64, 48,
+                                   custom::kFourccNV12FullRange, &pool, &pyramid));
+    CHECK_EQ(pool.stats().in_use, 1u);
+    CHECK(pyramid.layers[1].y >= pyramid.layers[0].y + pyramid.layers[0].height * pyramid.layers[0].stride_y);
+    CHECK(pyramid.layers[1].uv >=
+          pyramid.layers[0].uv + (pyramid.layers[0].height + 1) / 2 * pyramid.layers[0].stride_uv);
+  }
+  CHECK_EQ(pool.stats().misses, 1u);
+  CHECK_EQ(pool.stats().hits, 2u);
+}
+
+void TestRejectsInvalid() {
+  const Plane y = MakePlane(8, 8, 1, 0, 1);
+  const Plane uv = MakePlane(4, 4, 2, 0, 2);
+  custom::FrameBufferPool pool;
+  custom::NV12Pyramid pyramid;
+  CHECK(!custom::BuildNV12Pyramid(y.data.data(), y.stride, uv.data.data(), uv.stride, 3, 8,
+                                  custom::kFourccNV12VideoRange, &pool, &pyramid));
+  CHECK(!custom::BuildNV12Pyramid(y.data.data(), y.stride, uv.data.data(), uv.stride, 8, 8,
+                                  custom::kFourccI420, &pool, &pyramid));
+  CHECK(!custom::BuildNV12Pyramid(y.data.data(), 4, uv.data.data(), uv.stride, 8, 8,
+                                  custom::kFourccNV12VideoRange, &pool, &pyramid));
+  CHECK(!custom::BuildNV12Pyramid(y.data.data(), y.stride, uv.data.data(), uv.stride, 8, 8,
+                                  custom::kFourccNV12VideoRange, nullptr, &pyramid));
+}
+
+}  // namespace
+
+int main() {
+  TestMatchesBoxReference();
+  TestSharesOnePooledBuffer();
+  TestRejectsInvalid();
+  return TestExitCode();
+}
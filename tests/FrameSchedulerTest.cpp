@@ -0,0 +1,115 @@
+//
+//  FrameSchedulerTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+#include <cstdint>
+#include <string>
+
+#include "FrameScheduler.h"
+#include "LatestFrameMailbox.h"
+#include "TestCheck.h"
+
+namespace {
+
+constexpr int64_t kMs = 1000000;
+
+custom::FrameScheduler MakeScheduler(int64_t budget_ms) {
+  custom::FrameSchedulerConfig config;
+  config.latency_budget_ns = budget_ms * kMs;
+  config.smoothing = 0.5;
+  return custom::FrameScheduler(config);
+}
+
+void TestAdmitsWhileIdleOrUnmeasured() {
+  custom::FrameScheduler scheduler = MakeScheduler(66);
+  CHECK(scheduler.Admit(0));
+  scheduler.OnProcessingStarted(0);
+  // No processing time is known yet.
+  CHECK(scheduler.Admit(33 * kMs));
+  scheduler.OnProcessingFinished(0, 50 * kMs);
+  CHECK_EQ(scheduler.average_processing_ns(), 50 * kMs);
+  CHECK(scheduler.Admit(66 * kMs));
+}
+
+// A frame arriving while the worker is busy is skipped if waiting for the
+// current frame plus its own average processing would go over the budget.
+void TestSkipsFramesThatWouldBeLate() {
+  custom::FrameScheduler scheduler = MakeScheduler(66);
+  scheduler.OnProcessingStarted(0);
+  scheduler.OnProcessingFinished(0, 40 * kMs);
+  scheduler.OnProcessingStarted(100 * kMs);
+  // 40 ms left of the current frame + 40 ms > 66 ms.
+  CHECK(!scheduler.Admit(100 * kMs));
+  // 20 ms left + 40 ms fits.
+  CHECK(scheduler.Admit(120 * kMs));
+  const custom::FrameSchedulerCounters totals = scheduler.Totals();
+  CHECK_EQ(totals.admitted, 1u);
+  CHECK_EQ(totals.dropped, 1u);
+}
+
+// A replaced frame was admitted once and isn't also counted as dropped.
+void TestReplacedFramesAreCountedOnce() {
+  custom::FrameScheduler scheduler = MakeScheduler(1000);
+  custom::LatestFrameMailbox<int> mailbox;
+  int arrived = 0;
+  for (int i = 0; i < 3; ++i) {
+    arrived++;
+    if (scheduler.Admit(i * kMs) && mailbox.Put(i, i * kMs)) {
+      scheduler.OnReplaced(i * kMs);
+    }
+  }
+  int frame = -1;
+  int64_t arrival = 0;
+  CHECK(mailbox.Take(&frame, &arrival));
+  CHECK_EQ(frame, 2);
+  CHECK_EQ(arrival, 2 * kMs);
+  CHECK(!mailbox.Take(&frame, &arrival));
+  scheduler.OnProcessingStarted(3 * kMs);
+  scheduler.OnProcessingFinished(arrival, 4 * kMs);
+
+  const custom::FrameSchedulerCounters totals = scheduler.Totals();
+  CHECK_EQ(totals.admitted, 3u);
+  CHECK_EQ(totals.dropped, 0u);
+  CHECK_EQ(totals.replaced, 2u);
+  CHECK_EQ(totals.processed, 1u);
+  CHECK_EQ(totals.admitted + totals.dropped, static_cast<uint64_t>(arrived));
+  CHECK_EQ(totals.processed + totals.replaced, totals.admitted);
+}
+
+void TestCountsLateFrames() {
+  custom::FrameScheduler scheduler = MakeScheduler(66);
+  scheduler.OnProcessingStarted(10 * kMs);
+  scheduler.OnProcessingFinished(0, 70 * kMs);
+  scheduler.OnProcessingStarted(70 * kMs);
+  scheduler.OnProcessingFinished(40 * kMs, 100 * kMs);
+  CHECK_EQ(scheduler.Totals().late, 1u);
+  CHECK_EQ(scheduler.Totals().processed, 2u);
+}
+
+void TestPerSecondWindows() {
+  custom::FrameScheduler scheduler = MakeScheduler(66);
+  for (int i = 0; i < 30; ++i) {
+    scheduler.Admit(i * 33 * kMs);
+  }
+  CHECK_EQ(scheduler.LastSecond().admitted, 0u);
+  scheduler.Admit(1000 * kMs);
+  CHECK_EQ(scheduler.LastSecond().admitted, 30u);
+  // Nothing happened during the second before 3.5 s.
+  scheduler.Admit(3500 * kMs);
+  CHECK_EQ(scheduler.LastSecond().admitted, 0u);
+  CHECK_EQ(scheduler.Totals().admitted, 32u);
+}
+
+}  // namespace
+
+int main() {
+  TestAdmitsWhileIdleOrUnmeasured();
+  TestSkipsFramesThatWouldBeLate();
+  TestReplacedFramesAreCountedOnce();
+  TestCountsLateFrames();
+  TestPerSecondWindows();
+  return TestExitCode();
+}
@@ -0,0 +1,242 @@
+//
+//  GLResourceRegistryTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/14.
+//
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "GLResourceRegistry.h"
+#include "TestCheck.h"
+
+namespace {
+
+typedef std::array<float, custom::kQuadVertexCount * custom::kQuadFloatsPerVertex> Quad;
+
+// The texture coordinates before rotation, flipped vertically.
+const float kUVCoords[custom::kQuadVertexCount][2] = {{0, 1}, {1, 1}, {1, 0}, {0, 0}};
+
+// What RTCSetVertexData() uploaded for an RTCVideoRotation in degrees, before
+// the quads were baked.
+Quad OldRTCVertices(int rotation) {
+  std::array<std::array<float, 2>, 4> uv_coords = {{
+      {{kUVCoords[0][0], kUVCoords[0][1]}},
+      {{kUVCoords[1][0], kUVCoords[1][1]}},
+      {{kUVCoords[2][0], kUVCoords[2][1]}},
+      {{kUVCoords[3][0], kUVCoords[3][1]}},
+  }};
+  int rotation_offset = 0;
+  switch (rotation) {
+    case 0:
+      rotation_offset = 0;
+      break;
+    case 90:
+      rotation_offset = 1;
+      break;
+    case 180:
+      rotation_offset = 2;
+      break;
+    case 270:
+      rotation_offset = 3;
+      break;
+  }
+  std::rotate(uv_coords.begin(), uv_coords.begin() + rotation_offset, uv_coords.end());
+  return {{
+      -1, -1, uv_coords[0][0], uv_coords[0][1],
+       1, -1, uv_coords[1][0], uv_coords[1][1],
+       1,  1, uv_coords[2][0], uv_coords[2][1],
+      -1,  1, uv_coords[3][0], uv_coords[3][1],
+  }};
+}
+
+// What +[CustomShaderUtil setVertexDataWithRotation:] uploaded for a
+// CustomVideoRotation in degrees.
+Quad OldTargetVertices(int rotation) {
+  int rotation_offset = 0;
+  switch (rotation) {
+    case 0:
+      rotation_offset = 2;
+      break;
+    case 90:
+      rotation_offset = 0;
+      break;
+    case 180:
+      rotation_offset = 2;
+      break;
+    case 270:
+      rotation_offset = 1;
+      break;
+  }
+  const float *temp_uv_coords[4] = {};
+  for (int i = 0; i < 4; i++) {
+    int temp_index = i - rotation_offset % 4;
+    if (temp_index < 0) {
+      temp_index = temp_index + 4;
+    }
+    temp_uv_coords[temp_index] = kUVCoords[i];
+  }
+  return {{
+      -1, -1, temp_uv_coords[0][0], temp_uv_coords[0][1],
+       1, -1, temp_uv_coords[1][0], temp_uv_coords[1][1],
+       1,  1, temp_uv_coords[2][0], temp_uv_coords[2][1],
+      -1,  1, temp_uv_coords[3][0], temp_uv_coords[3][1],
+  }};
+}
+
+// The first vertices RTCQuadFirstVertex() and
+// +[CustomShaderUtil firstQuadVertexWithRotation:] draw from.
+int RTCFirstVertex(int rotation) {
+  return custom::RotatedQuadFirstVertex(rotation / 90);
+}
+
+int TargetFirstVertex(int rotation) {
+  const int offsets[] = {2, 0, 2, 1};
+  return custom::RotatedQuadFirstVertex(offsets[rotation / 90]);
+}
+
+// The quad drawn from |first_vertex| of the baked buffer.
+Quad BakedQuad(const float vertices[custom::kRotatedQuadFloatCount], int first_vertex) {
+  Quad quad;
+  std::copy(vertices + first_vertex * custom::kQuadFloatsPerVertex,
+            vertices + first_vertex * custom::kQuadFloatsPerVertex + quad.size(), quad.begin());
+  return quad;
+}
+
+void TestBakedQuads() {
+  float vertices[custom::kRotatedQuadFloatCount];
+  std::fill(vertices, vertices + custom::kRotatedQuadFloatCount, -2.0f);
+  custom::FillRotatedQuadVertices(vertices);
+  const float kExpected[custom::kRotatedQuadFloatCount] = {
+      // X, Y, U, V; rotated by 0 to 3 corners.
+      -1, -1, 0, 1,   1, -1, 1, 1,   1, 1, 1, 0,   -1, 1, 0, 0,
+      -1, -1, 1, 1,   1, -1, 1, 0,   1, 1, 0, 0,   -1, 1, 0, 1,
+      -1, -1, 1, 0,   1, -1, 0, 0,   1, 1, 0, 1,   -1, 1, 1, 1,
+      -1, -1, 0, 0,   1, -1, 0, 1,   1, 1, 1, 1,   -1, 1, 1, 0,
+  };
+  CHECK(std::equal(vertices, vertices + custom::kRotatedQuadFloatCount, kExpected));
+
+  CHECK_EQ(custom::RotatedQuadFirstVertex(0), 0);
+  CHECK_EQ(custom::RotatedQuadFirstVertex(1), 4);
+  CHECK_EQ(custom::RotatedQuadFirstVertex(3), 12);
+  CHECK_EQ(custom::RotatedQuadFirstVertex(4), 0);
+
+  // Every rotation draws what the old upload routines did.
+  for (int rotation : {0, 90, 180, 270}) {
+    CHECK(BakedQuad(vertices, RTCFirstVertex(rotation)) == OldRTCVertices(rotation));
+    CHECK(BakedQuad(vertices, TargetFirstVertex(rotation)) == OldTargetVertices(rotation));
+  }
+  // The portrait example of the old RTCSetVertexData() comment.
+  const Quad kPortrait = {{-1, -1, 1, 1, 1, -1, 1, 0, 1, 1, 0, 0, -1, 1, 0, 1}};
+  CHECK(BakedQuad(vertices, RTCFirstVertex(90)) == kPortrait);
+}
+
+// A factory returning |name| and |bytes| that counts its calls.
+custom::GLResourceRegistry::Factory Factory(uint32_t name, size_t bytes, int *calls) {
+  return [name, bytes, calls](size_t *size) {
+    ++*calls;
+    *size = bytes;
+    return name;
+  };
+}
+
+void TestAcquireShares() {
+  custom::GLResourceRegistry registry;
+  int calls = 0;
+  CHECK_EQ(registry.Acquire(custom::GLResourceKind::kProgram, 1, Factory(10, 1000, &calls)), 10u);
+  // The same key shares the object without running the factory.
+  CHECK_EQ(registry.Acquire(custom::GLResourceKind::kProgram, 1, Factory(11, 1000, &calls)), 10u);
+  CHECK_EQ(calls, 1);
+  // Another key or kind is another object.
+  CHECK_EQ(registry.Acquire(custom::GLResourceKind::kProgram, 2, Factory(12, 500, &calls)), 12u);
+  CHECK_EQ(registry.Acquire(custom::GLResourceKind::kVertexBuffer, 1, Factory(10, 256, &calls)), 10u);
+  CHECK_EQ(calls, 3);
+
+  const custom::GLResourceReport report = registry.Report();
+  CHECK_EQ(report[custom::GLResourceKind::kProgram].objects, 2u);
+  CHECK_EQ(report[custom::GLResourceKind::kProgram].references, 3u);
+  CHECK_EQ(report[custom::GLResourceKind::kProgram].bytes, 1500u);
+  CHECK_EQ(report[custom::GLResourceKind::kVertexBuffer].objects, 1u);
+  CHECK_EQ(report[custom::GLResourceKind::kVertexBuffer].bytes, 256u);
+  CHECK_EQ(report[custom::GLResourceKind::kSampler].objects, 0u);
+  CHECK_EQ(report.created, 3u);
+  CHECK_EQ(report.shared, 1u);
+  CHECK_EQ(report.ToString(),
+           "program: 2 objects, 3 refs, 1500 bytes\n"
+           "vertex buffer: 1 objects, 1 refs, 256 bytes\n"
+           "sampler: 0 objects, 0 refs, 0 bytes\n"
+           "created 3, shared 1\n");
+}
+
+// A failed factory stores nothing, so the next Acquire() tries again.
+void TestFactoryFailure() {
+  custom::GLResourceRegistry registry;
+  int calls = 0;
+  CHECK_EQ(registry.Acquire(custom::GLResourceKind::kSampler, 1, Factory(0, 64, &calls)), 0u);
+  CHECK_EQ(registry.Acquire(custom::GLResourceKind::kSampler, 1, custom::GLResourceRegistry::Factory()), 0u);
+  CHECK_EQ(registry.Report()[custom::GLResourceKind::kSampler].objects, 0u);
+  CHECK_EQ(registry.Report().created, 0u);
+  CHECK_EQ(registry.Acquire(custom::GLResourceKind::kSampler, 1, Factory(7, 64, &calls)), 7u);
+  CHECK_EQ(calls, 2);
+  CHECK_EQ(registry.Report().created, 1u);
+  CHECK_EQ(registry.Report().shared, 0u);
+}
+
+void TestRelease() {
+  custom::GLResourceRegistry registry;
+  int calls = 0;
+  registry.Acquire(custom::GLResourceKind::kProgram, 1, Factory(10, 1000, &calls));
+  registry.Acquire(custom::GLResourceKind::kProgram, 1, Factory(10, 1000, &calls));
+  registry.Acquire(custom::GLResourceKind::kVertexBuffer, 1, Factory(10, 256, &calls));
+  // Names are per kind; unknown names and 0 are ignored.
+  CHECK(!registry.Release(custom::GLResourceKind::kSampler, 10));
+  CHECK(!registry.Release(custom::GLResourceKind::kProgram, 11));
+  CHECK(!registry.Release(custom::GLResourceKind::kProgram, 0));
+  CHECK(!registry.Release(custom::GLResourceKind::kProgram, 10));
+  CHECK_EQ(registry.Report()[custom::GLResourceKind::kProgram].references, 1u);
+  CHECK(registry.Release(custom::GLResourceKind::kProgram, 10));
+  CHECK_EQ(registry.Report()[custom::GLResourceKind::kProgram].objects, 0u);
+  CHECK(!registry.Release(custom::GLResourceKind::kProgram, 10));
+  CHECK_EQ(registry.Report()[custom::GLResourceKind::kVertexBuffer].objects, 1u);
+  // A released key is created again.
+  CHECK_EQ(registry.Acquire(custom::GLResourceKind::kProgram, 1, Factory(20, 1000, &calls)), 20u);
+  CHECK_EQ(calls, 3);
+}
+
+void TestTakeAll() {
+  custom::GLResourceRegistry registry;
+  int calls = 0;
+  registry.Acquire(custom::GLResourceKind::kProgram, 1, Factory(10, 1000, &calls));
+  registry.Acquire(custom::GLResourceKind::kProgram, 1, Factory(10, 1000, &calls));
+  registry.Acquire(custom::GLResourceKind::kSampler, 1, Factory(3, 64, &calls));
+  const std::vector<std::pair<custom::GLResourceKind, uint32_t>> objects = registry.TakeAll();
+  CHECK(objects == (std::vector<std::pair<custom::GLResourceKind, uint32_t>>{
+                       {custom::GLResourceKind::kProgram, 10}, {custom::GLResourceKind::kSampler, 3}}));
+  const custom::GLResourceReport report = registry.Report();
+  for (const custom::GLResourceCounts &counts : report.kinds) {
+    CHECK_EQ(counts.objects, 0u);
+    CHECK_EQ(counts.references, 0u);
+    CHECK_EQ(counts.bytes, 0u);
+  }
+  CHECK_EQ(report.created, 2u);
+  CHECK_EQ(report.shared, 1u);
+  // Taken objects are no longer released by the registry.
+  CHECK(!registry.Release(custom::GLResourceKind::kProgram, 10));
+  CHECK(registry.TakeAll().empty());
+}
+
+}  // namespace
+
+int main() {
+  TestBakedQuads();
+  TestAcquireShares();
+  TestFactoryFailure();
+  TestRelease();
+  TestTakeAll();
+  return TestExitCode();
+}
@@ -0,0 +1,117 @@
+//
+//  MessageBufferPoolTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/13.
+//
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "MessageBufferPool.h"
+#include "TestCheck.h"
+
+namespace {
+
+void TestSizeClasses() {
+  custom::MessageBufferPool pool;
+  CHECK_EQ(pool.Acquire(0)->capacity, 4096u);
+  CHECK_EQ(pool.Acquire(1)->capacity, 4096u);
+  CHECK_EQ(pool.Acquire(4096)->capacity, 4096u);
+  CHECK_EQ(pool.Acquire(4097)->capacity, 8192u);
+  CHECK_EQ(pool.Acquire(1 << 20)->capacity, 1u << 20);
+  std::shared_ptr<custom::MessageBuffer> buffer = pool.Acquire(100000);
+  CHECK_EQ(buffer->size, 100000u);
+  CHECK_EQ(buffer->capacity, 131072u);
+  buffer->data[buffer->capacity - 1] = 1;
+}
+
+void TestRecycles() {
+  custom::MessageBufferPool pool;
+  std::shared_ptr<custom::MessageBuffer> first = pool.Acquire(5000);
+  uint8_t *data = first->data;
+  first.reset();
+  // Any size of the class takes the idle buffer.
+  std::shared_ptr<custom::MessageBuffer> second = pool.Acquire(8000);
+  CHECK_EQ(second->data, data);
+  CHECK_EQ(second->size, 8000u);
+  CHECK_EQ(pool.stats().hits, 1u);
+  CHECK_EQ(pool.stats().misses, 1u);
+  // Another class doesn't.
+  CHECK(pool.Acquire(9000)->data != data);
+  CHECK_EQ(pool.stats().misses, 2u);
+  CHECK_EQ(pool.stats().in_use, 1u);
+  CHECK_EQ(pool.stats().high_water, 2u);
+
+  pool.ResetStats();
+  CHECK_EQ(pool.stats().hits, 0u);
+  CHECK_EQ(pool.stats().misses, 0u);
+  CHECK_EQ(pool.stats().high_water, 1u);
+}
+
+void TestIdleLimitAndFlush() {
+  custom::MessageBufferPool pool(2);
+  std::vector<std::shared_ptr<custom::MessageBuffer>> buffers;
+  for (int i = 0; i < 4; ++i) {
+    buffers.push_back(pool.Acquire(4096));
+  }
+  CHECK_EQ(pool.stats().allocated_bytes, 4u * 4096);
+  buffers.clear();
+  // Only two are kept idle.
+  CHECK_EQ(pool.stats().allocated_bytes, 2u * 4096);
+  std::shared_ptr<custom::MessageBuffer> held = pool.Acquire(4096);
+  pool.Flush();
+  CHECK_EQ(pool.stats().allocated_bytes, 4096u);
+  held.reset();
+  CHECK_EQ(pool.stats().allocated_bytes, 4096u);
+  CHECK_EQ(pool.stats().in_use, 0u);
+}
+
+// Messages past max_pooled_size get a buffer of their own size, freed on
+// release.
+void TestLargeMessagesArentPooled() {
+  custom::MessageBufferPool pool(4, 64 << 10);
+  std::shared_ptr<custom::MessageBuffer> large = pool.Acquire((64 << 10) + 1);
+  CHECK_EQ(large->capacity, (64u << 10) + 1);
+  CHECK_EQ(pool.stats().allocated_bytes, (64u << 10) + 1);
+  large.reset();
+  CHECK_EQ(pool.stats().allocated_bytes, 0u);
+  pool.Acquire((64 << 10) + 1);
+  CHECK_EQ(pool.stats().hits, 0u);
+  CHECK_EQ(pool.stats().misses, 2u);
+  // At the limit it still is.
+  pool.Acquire(64 << 10);
+  pool.Acquire(64 << 10);
+  CHECK_EQ(pool.stats().hits, 1u);
+}
+
+// Buffers may be released on another thread and after the pool is gone.
+void TestReleaseAnywhere() {
+  std::shared_ptr<custom::MessageBuffer> survivor;
+  {
+    custom::MessageBufferPool pool;
+    std::vector<std::shared_ptr<custom::MessageBuffer>> buffers;
+    for (int i = 0; i < 8; ++i) {
+      buffers.push_back(pool.Acquire(4096));
+    }
+    survivor = buffers.back();
+    std::thread releaser([&buffers] { buffers.clear(); });
+    releaser.join();
+    CHECK_EQ(pool.stats().in_use, 1u);
+    CHECK_EQ(pool.stats().allocated_bytes, 5u * 4096);
+  }
+  survivor->data[0] = 1;
+  survivor.reset();
+}
+
+}  // namespace
+
+int main() {
+  TestSizeClasses();
+  TestRecycles();
+  TestIdleLimitAndFlush();
+  TestLargeMessagesArentPooled();
+  TestReleaseAnywhere();
+  return TestExitCode();
+}
@@ -0,0 +1,160 @@
+//
+//  OfferTemplateCacheTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/12.
+//
+
+#include <string>
+
+#include "OfferTemplateCache.h"
+#include "SessionDescription.h"
+#include "TestCheck.h"
+
+namespace {
+
+// An offer whose per peer connection values come from |seed|, with
+// |codecs| as the video m= line's formats.
+std::string MakeOffer(int seed, const std::string &codecs = "96 102") {
+  const std::string s = std::to_string(seed);
+  return "v=0\r\n"
+         "o=- 10" + s + " 2 IN IP4 127.0.0.1\r\n"
+         "s=-\r\n"
+         "t=0 0\r\n"
+         "a=msid-semantic: WMS stream" + s + "\r\n"
+         "m=video 9 UDP/TLS/RTP/SAVPF " + codecs + "\r\n"
+         "c=IN IP4 0.0.0.0\r\n"
+         "a=ice-ufrag:uf" + s + "\r\n"
+         "a=ice-pwd:pwd" + s + "\r\n"
+         "a=fingerprint:sha-256 AB:" + s + "\r\n"
+         "a=mid:0\r\n"
+         "a=msid:stream" + s + " track" + s + "\r\n"
+         "a=rtpmap:96 VP8/90000\r\n"
+         "a=rtpmap:102 H264/90000\r\n"
+         "a=ssrc-group:FID 1" + s + " 2" + s + "\r\n"
+         "a=ssrc:1" + s + " cname:c" + s + "\r\n"
+         "a=ssrc:2" + s + " cname:c" + s + "\r\n";
+}
+
+// The munge the cache stands in for: H264 first and a bandwidth cap.
+std::string Munge(const std::string &offer) {
+  custom::SessionDescription description;
+  CHECK(description.Parse(offer));
+  CHECK(description.PreferCodec(0, "H264"));
+  description.SetBandwidth(0, 1500);
+  return description.ToString();
+}
+
+void TestApplyMatchesMunge() {
+  custom::OfferTemplateCache cache;
+  std::string munged;
+  const std::string first = MakeOffer(1);
+  CHECK(!cache.Apply(first, &munged));
+  CHECK_EQ(cache.misses(), 1u);
+  CHECK(cache.Store(first, Munge(first)));
+  CHECK_EQ(cache.size(), 1u);
+
+  // Offers of the same shape are filled in, with values of any length.
+  for (int seed : {2, 37, 123456789}) {
+    const std::string offer = MakeOffer(seed);
+    munged = "stale";
+    CHECK(cache.Apply(offer, &munged));
+    CHECK_EQ(munged, Munge(offer));
+  }
+  CHECK_EQ(cache.hits(), 3u);
+
+  // A different shape isn't.
+  CHECK(!cache.Apply(MakeOffer(2, "96"), &munged));
+  std::string extra_line = MakeOffer(2);
+  extra_line += "a=rtcp-mux\r\n";
+  CHECK(!cache.Apply(extra_line, &munged));
+  // One more volatile line is a different shape too.
+  std::string extra_value = MakeOffer(2);
+  extra_value += "a=candidate:1 1 udp 1 10.0.0.1 9 typ host\r\n";
+  CHECK(!cache.Apply(extra_value, &munged));
+  CHECK_EQ(cache.misses(), 4u);
+  CHECK_EQ(cache.hits(), 3u);
+}
+
+void TestLineBreaks() {
+  custom::OfferTemplateCache cache;
+  std::string lf;
+  for (char c : MakeOffer(1)) {
+    if (c != '\r') {
+      lf.push_back(c);
+    }
+  }
+  // Stored as is: a template keeps the line breaks of the munged text.
+  CHECK(cache.Store(lf, lf));
+  std::string munged;
+  CHECK(!cache.Apply(MakeOffer(1), &munged));
+  CHECK(cache.Apply(lf, &munged));
+  CHECK_EQ(munged, lf);
+  // A volatile value on the last line, without a line break.
+  CHECK(cache.Store("v=0\na=ice-ufrag:ab", "v=0\nb=AS:1\na=ice-ufrag:ab"));
+  CHECK(cache.Apply("v=0\na=ice-ufrag:xyz", &munged));
+  CHECK_EQ(munged, "v=0\nb=AS:1\na=ice-ufrag:xyz");
+}
+
+void TestStoreRefusesChangedValues() {
+  custom::OfferTemplateCache cache;
+  const std::string offer = MakeOffer(1);
+  std::string munged = Munge(offer);
+  // A munge that edits, drops or reorders a volatile value can't be
+  // templated.
+  std::string edited = munged;
+  edited.replace(edited.find("uf1"), 3, "uf9");
+  CHECK(!cache.Store(offer, edited));
+  std::string dropped = munged;
+  dropped.erase(dropped.find("a=ice-pwd:"), std::string("a=ice-pwd:pwd1\r\n").size());
+  CHECK(!cache.Store(offer, dropped));
+  CHECK_EQ(cache.size(), 0u);
+
+  // Storing a shape again replaces its template.
+  CHECK(cache.Store(offer, offer));
+  CHECK(cache.Store(offer, munged));
+  CHECK_EQ(cache.size(), 1u);
+  std::string applied;
+  CHECK(cache.Apply(MakeOffer(5), &applied));
+  CHECK_EQ(applied, Munge(MakeOffer(5)));
+
+  cache.Clear();
+  CHECK_EQ(cache.size(), 0u);
+  CHECK(!cache.Apply(offer, &applied));
+}
+
+void TestEviction() {
+  custom::OfferTemplateCache cache(2);
+  const std::string a = MakeOffer(1, "96");
+  const std::string b = MakeOffer(1, "102");
+  const std::string c = MakeOffer(1, "96 102");
+  CHECK(cache.Store(a, a));
+  CHECK(cache.Store(b, b));
+  // Storing a shape again doesn't count as new.
+  CHECK(cache.Store(a, a));
+  CHECK_EQ(cache.size(), 2u);
+  // The oldest goes first.
+  CHECK(cache.Store(c, c));
+  CHECK_EQ(cache.size(), 2u);
+  std::string munged;
+  CHECK(!cache.Apply(a, &munged));
+  CHECK(cache.Apply(b, &munged));
+  CHECK(cache.Apply(c, &munged));
+
+  // At least one template is kept.
+  custom::OfferTemplateCache tiny(0);
+  CHECK(tiny.Store(a, a));
+  CHECK(tiny.Store(b, b));
+  CHECK_EQ(tiny.size(), 1u);
+  CHECK(tiny.Apply(b, &munged));
+}
+
+}  // namespace
+
+int main() {
+  TestApplyMatchesMunge();
+  TestLineBreaks();
+  TestStoreRefusesChangedValues();
+  TestEviction();
+  return TestExitCode();
+}
@@ -0,0 +1,198 @@
+//
+//  PathCostModelTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/14.
+//
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PathCostModel.h"
+#include "TestCheck.h"
+
+namespace {
+
+const custom::ProcessingPath kGpu = custom::ProcessingPath::kGpu;
+const custom::ProcessingPath kCpu = custom::ProcessingPath::kCpu;
+
+custom::PathCostKey Key(uint64_t effect, int width = 1280, int height = 720) {
+  custom::PathCostKey key;
+  key.effect = effect;
+  key.format = 1;
+  key.width = width;
+  key.height = height;
+  return key;
+}
+
+custom::PathCostEntry Entry(const custom::PathCostModel &model, const custom::PathCostKey &key) {
+  for (const custom::PathCostEntry &entry : model.Entries()) {
+    if (entry.key == key) {
+      return entry;
+    }
+  }
+  return custom::PathCostEntry();
+}
+
+// Runs one frame of |key| on the path the model picks, at the cost of that
+// path; returns the path.
+custom::ProcessingPath RunFrame(custom::PathCostModel *model, const custom::PathCostKey &key, int64_t gpu_ns,
+                                int64_t cpu_ns) {
+  const custom::ProcessingPath path = model->Choose(key);
+  model->Record(key, path, path == kGpu ? gpu_ns : cpu_ns);
+  return path;
+}
+
+// Each path runs one untimed warm-up frame and probe_frames timed ones, the
+// GPU first, before the model decides.
+void TestProbesBeforeDeciding() {
+  custom::PathCostConfig config;
+  config.probe_frames = 4;
+  custom::PathCostModel model(config);
+  const custom::PathCostKey key = Key(1);
+  std::vector<custom::ProcessingPath> paths;
+  for (int i = 0; i < 10; ++i) {
+    CHECK(!Entry(model, key).decided);
+    // The warm-up frames pay for compilation and allocations.
+    const bool warm_up = i == 0 || i == 5;
+    paths.push_back(RunFrame(&model, key, warm_up ? 1000000 : 3000, warm_up ? 1000000 : 1000));
+  }
+  CHECK(paths == std::vector<custom::ProcessingPath>({kGpu, kGpu, kGpu, kGpu, kGpu, kCpu, kCpu, kCpu, kCpu, kCpu}));
+  const custom::PathCostEntry entry = Entry(model, key);
+  CHECK(entry.decided);
+  CHECK(entry.chosen == kCpu);
+  CHECK_EQ(entry.gpu_frames, 5u);
+  CHECK_EQ(entry.cpu_frames, 5u);
+  CHECK_EQ(entry.gpu_samples, 4u);
+  CHECK_EQ(entry.cpu_samples, 4u);
+  CHECK_EQ(entry.gpu_ns, 3000);
+  CHECK_EQ(entry.cpu_ns, 1000);
+  CHECK_EQ(entry.switches, 0u);
+  CHECK_EQ(std::string(custom::ProcessingPathName(entry.chosen)), "cpu");
+}
+
+void TestChoosesTheCheaperPath() {
+  custom::PathCostConfig config;
+  config.probe_frames = 2;
+  config.reprobe_interval = 0;
+  custom::PathCostModel model(config);
+  const custom::PathCostKey gpu_key = Key(1);
+  const custom::PathCostKey cpu_key = Key(2);
+  for (int i = 0; i < 6; ++i) {
+    RunFrame(&model, gpu_key, 1000, 1200);
+    RunFrame(&model, cpu_key, 1200, 1000);
+  }
+  CHECK(Entry(model, gpu_key).chosen == kGpu);
+  CHECK(Entry(model, cpu_key).chosen == kCpu);
+  // Without reprobing, every frame takes the chosen path.
+  for (int i = 0; i < 1000; ++i) {
+    CHECK(RunFrame(&model, gpu_key, 1000, 1200) == kGpu);
+  }
+  CHECK_EQ(Entry(model, gpu_key).cpu_frames, 3u);
+}
+
+// Once decided, one frame in reprobe_interval runs the other path.
+void TestReprobes() {
+  custom::PathCostConfig config;
+  config.probe_frames = 1;
+  config.reprobe_interval = 5;
+  custom::PathCostModel model(config);
+  const custom::PathCostKey key = Key(1);
+  for (int i = 0; i < 4; ++i) {
+    RunFrame(&model, key, 2000, 1000);
+  }
+  CHECK(Entry(model, key).chosen == kCpu);
+  std::vector<custom::ProcessingPath> paths;
+  for (int i = 0; i < 10; ++i) {
+    paths.push_back(RunFrame(&model, key, 2000, 1000));
+  }
+  CHECK(paths == std::vector<custom::ProcessingPath>({kCpu, kCpu, kCpu, kCpu, kGpu, kCpu, kCpu, kCpu, kCpu, kGpu}));
+  CHECK_EQ(Entry(model, key).gpu_frames, 4u);
+  CHECK(Entry(model, key).chosen == kCpu);
+}
+
+// The other path only takes over once it is switch_margin cheaper.
+void TestSwitchMargin() {
+  custom::PathCostConfig config;
+  config.probe_frames = 1;
+  config.reprobe_interval = 0;
+  config.switch_margin = 0.1;
+  // Every sample replaces the average.
+  config.smoothing = 1.0;
+  custom::PathCostModel model(config);
+  const custom::PathCostKey key = Key(1);
+  for (int i = 0; i < 4; ++i) {
+    RunFrame(&model, key, 2000, 1000);
+  }
+  CHECK(Entry(model, key).chosen == kCpu);
+
+  // 950 isn't 10% under 1000.
+  model.Record(key, kGpu, 950);
+  CHECK(Entry(model, key).chosen == kCpu);
+  model.Record(key, kGpu, 899);
+  CHECK(Entry(model, key).chosen == kGpu);
+  CHECK_EQ(Entry(model, key).switches, 1u);
+  // The chosen path getting slower switches back as well.
+  model.Record(key, kGpu, 1100);
+  CHECK(Entry(model, key).chosen == kGpu);
+  model.Record(key, kGpu, 1200);
+  CHECK(Entry(model, key).chosen == kCpu);
+  CHECK_EQ(Entry(model, key).switches, 2u);
+  CHECK(model.Choose(key) == kCpu);
+}
+
+// The least recently used key is forgotten and starts over.
+void TestEviction() {
+  custom::PathCostConfig config;
+  config.probe_frames = 1;
+  config.max_entries = 2;
+  custom::PathCostModel model(config);
+  for (int i = 0; i < 4; ++i) {
+    RunFrame(&model, Key(1), 2000, 1000);
+    RunFrame(&model, Key(2), 2000, 1000);
+  }
+  CHECK(Entry(model, Key(1)).decided);
+  // Using a key makes it the most recent one.
+  model.Choose(Key(1));
+  model.Choose(Key(3));
+  std::vector<custom::PathCostEntry> entries = model.Entries();
+  CHECK_EQ(entries.size(), 2u);
+  CHECK(entries[0].key == Key(3));
+  CHECK(entries[1].key == Key(1));
+  // Another frame size is another key.
+  model.Choose(Key(1, 1920, 1080));
+  entries = model.Entries();
+  CHECK(entries[0].key == Key(1, 1920, 1080));
+  CHECK(entries[1].key == Key(3));
+
+  CHECK(model.Choose(Key(2)) == kGpu);
+  CHECK(!Entry(model, Key(2)).decided);
+  CHECK_EQ(Entry(model, Key(2)).cpu_frames, 0u);
+}
+
+void TestReset() {
+  custom::PathCostConfig config;
+  config.probe_frames = 1;
+  custom::PathCostModel model(config);
+  for (int i = 0; i < 4; ++i) {
+    RunFrame(&model, Key(1), 2000, 1000);
+  }
+  CHECK(model.Choose(Key(1)) == kCpu);
+  model.Reset();
+  CHECK(model.Entries().empty());
+  CHECK(model.Choose(Key(1)) == kGpu);
+  CHECK(!Entry(model, Key(1)).decided);
+}
+
+}  // namespace
+
+int main() {
+  TestProbesBeforeDeciding();
+  TestChoosesTheCheaperPath();
+  TestReprobes();
+  TestSwitchMargin();
+  TestEviction();
+  TestReset();
+  return TestExitCode();
+}
@@ -0,0 +1,136 @@
+//
+//  PlaneGeometryTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+#include <cstdint>
+#include <vector>
+
+#include "PlaneGeometry.h"
+#include "TestCheck.h"
+
+namespace {
+
+// A plane whose sample at (x, y), byte b, is x * 7 + y * 13 + b; padding is 0xEE.
+std::vector<uint8_t> MakePlane(int width, int height, int stride, int bytes_per_sample) {
+  std::vector<uint8_t> data(static_cast<size_t>(stride) * height, 0xEE);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      for (int b = 0; b < bytes_per_sample; ++b) {
+        data[y * stride + x * bytes_per_sample + b] = static_cast<uint8_t>(x * 7 + y * 13 + b);
+      }
+    }
+  }
+  return data;
+}
+
+custom::PlaneSource Source(const std::vector<uint8_t> &data, int width, int height, int stride,
+                           int bytes_per_sample) {
+  custom::PlaneSource plane;
+  plane.data = data.data();
+  plane.width = width;
+  plane.height = height;
+  plane.stride = stride;
+  plane.bytes_per_sample = bytes_per_sample;
+  return plane;
+}
+
+void TestChromaSize() {
+  CHECK_EQ(custom::ChromaSize420(1), 1);
+  CHECK_EQ(custom::ChromaSize420(640), 320);
+  CHECK_EQ(custom::ChromaSize420(641), 321);
+}
+
+void TestValidity() {
+  std::vector<uint8_t> data(64);
+  CHECK(custom::IsValidPlane(Source(data, 8, 4, 8, 1)));
+  CHECK(!custom::IsValidPlane(Source(data, 8, 4, 7, 1)));
+  CHECK(!custom::IsValidPlane(Source(data, 4, 4, 7, 2)));
+  CHECK(!custom::IsValidPlane(Source(data, 0, 4, 8, 1)));
+  custom::PlaneSource empty = Source(data, 8, 4, 8, 1);
+  empty.data = nullptr;
+  CHECK(!custom::IsValidPlane(empty));
+  custom::PlaneUpload upload;
+  CHECK(!custom::PlanPlaneUpload(Source(data, 8, 4, 7, 1), true, &upload));
+}
+
+void TestUploadModes() {
+  std::vector<uint8_t> data(4096);
+  custom::PlaneUpload upload;
+
+  // Packed rows, odd width included.
+  CHECK(custom::PlanPlaneUpload(Source(data, 641, 3, 641, 1), false, &upload));
+  CHECK(upload.mode == custom::PlaneUploadMode::kPacked);
+  CHECK_EQ(upload.row_length, 0);
+
+  // Padded luma: a row length on ES3, a repack on ES2.
+  CHECK(custom::PlanPlaneUpload(Source(data, 641, 3, 704, 1), true, &upload));
+  CHECK(upload.mode == custom::PlaneUploadMode::kRowLength);
+  CHECK_EQ(upload.row_length, 704);
+  CHECK(custom::PlanPlaneUpload(Source(data, 641, 3, 704, 1), false, &upload));
+  CHECK(upload.mode == custom::PlaneUploadMode::kRepack);
+
+  // Interleaved chroma: the row length is in samples.
+  CHECK(custom::PlanPlaneUpload(Source(data, 321, 2, 704, 2), true, &upload));
+  CHECK(upload.mode == custom::PlaneUploadMode::kRowLength);
+  CHECK_EQ(upload.row_length, 352);
+  // A stride that isn't a whole number of samples can't be a row length.
+  CHECK(custom::PlanPlaneUpload(Source(data, 321, 2, 643, 2), true, &upload));
+  CHECK(upload.mode == custom::PlaneUploadMode::kRepack);
+
+  // A single row never reads past its end.
+  CHECK(custom::PlanPlaneUpload(Source(data, 5, 1, 64, 1), false, &upload));
+  CHECK(upload.mode == custom::PlaneUploadMode::kPacked);
+}
+
+void TestCopyPacked() {
+  const int kSizes[][3] = {{1, 1, 1}, {7, 3, 16}, {641, 5, 704}, {33, 9, 33}};
+  for (const auto &size : kSizes) {
+    const int width = size[0];
+    const int height = size[1];
+    const int stride = size[2];
+    const std::vector<uint8_t> data = MakePlane(width, height, stride, 1);
+    std::vector<uint8_t> packed(static_cast<size_t>(width) * height + 1, 0x55);
+    custom::CopyPlanePacked(Source(data, width, height, stride, 1), packed.data());
+    bool equal = true;
+    for (int y = 0; y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        equal = equal && packed[y * width + x] == static_cast<uint8_t>(x * 7 + y * 13);
+      }
+    }
+    CHECK(equal);
+    // Writes exactly packed_size() bytes.
+    CHECK_EQ(packed.back(), 0x55);
+  }
+}
+
+void TestSplitUV() {
+  // 321 x 3 chroma samples of a 641 x 5 frame, padded to 704 bytes.
+  const int width = custom::ChromaSize420(641);
+  const int height = custom::ChromaSize420(5);
+  const std::vector<uint8_t> data = MakePlane(width, height, 704, 2);
+  std::vector<uint8_t> u(static_cast<size_t>(width) * height);
+  std::vector<uint8_t> v(u.size());
+  custom::SplitUVPlanePacked(Source(data, width, height, 704, 2), u.data(), v.data());
+  bool equal = true;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      equal = equal && u[y * width + x] == static_cast<uint8_t>(x * 7 + y * 13) &&
+              v[y * width + x] == static_cast<uint8_t>(x * 7 + y * 13 + 1);
+    }
+  }
+  CHECK(equal);
+}
+
+}  // namespace
+
+int main() {
+  TestChromaSize();
+  TestValidity();
+  TestUploadModes();
+  TestCopyPacked();
+  TestSplitUV();
+  return TestExitCode();
+}
@@ -0,0 +1,142 @@
+//
+//  ProgramBinaryCacheTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ProgramBinaryCache.h"
+#include "TestCheck.h"
+
+namespace {
+
+custom::ProgramBinary MakeBinary(uint32_t format, size_t size, uint8_t seed) {
+  custom::ProgramBinary binary;
+  binary.format = format;
+  for (size_t i = 0; i < size; ++i) {
+    binary.data.push_back(static_cast<uint8_t>(seed + i * 7));
+  }
+  return binary;
+}
+
+bool Holds(custom::ProgramBinaryCache &cache, uint64_t key, const custom::ProgramBinary &expected) {
+  custom::ProgramBinary binary;
+  return cache.Find(key, &binary) && binary.format == expected.format && binary.data == expected.data;
+}
+
+void TestKeys() {
+  const uint64_t key = custom::ProgramCacheKey("vs", "fs", "Apple|A15|OpenGL ES 3.0");
+  CHECK_EQ(custom::ProgramCacheKey("vs", "fs", "Apple|A15|OpenGL ES 3.0"), key);
+  CHECK(custom::ProgramCacheKey("vs", "fs", "Apple|A16|OpenGL ES 3.0") != key);
+  CHECK(custom::ProgramCacheKey("vs", "fs2", "Apple|A15|OpenGL ES 3.0") != key);
+  // The sources are delimited, moving text from one to the other is another program.
+  CHECK(custom::ProgramCacheKey("vsf", "s", "Apple|A15|OpenGL ES 3.0") != key);
+  // Test vectors of 64 bit FNV-1a.
+  CHECK_EQ(custom::Fnv1a64("", 0), 0xcbf29ce484222325ull);
+  CHECK_EQ(custom::Fnv1a64("a", 1), 0xaf63dc4c8601ec8cull);
+}
+
+void TestLruEviction() {
+  custom::ProgramBinaryCache cache(3);
+  for (uint64_t key = 1; key <= 3; ++key) {
+    cache.Insert(key, MakeBinary(1, 16, static_cast<uint8_t>(key)));
+  }
+  custom::ProgramBinary binary;
+  // Using key 1 makes key 2 the least recently used.
+  CHECK(cache.Find(1, &binary));
+  cache.Insert(4, MakeBinary(1, 16, 4));
+  CHECK_EQ(cache.size(), 3u);
+  CHECK(!cache.Find(2, &binary));
+  CHECK(cache.Find(1, &binary) && cache.Find(3, &binary) && cache.Find(4, &binary));
+
+  cache.Insert(5, custom::ProgramBinary());
+  CHECK(!cache.Find(5, &binary));
+  cache.Erase(3);
+  CHECK(!cache.Find(3, &binary));
+  CHECK_EQ(cache.size(), 2u);
+}
+
+void TestRoundTrip() {
+  custom::ProgramBinaryCache cache;
+  CHECK(!cache.dirty());
+  const custom::ProgramBinary a = MakeBinary(0x8E0C, 1000, 1);
+  const custom::ProgramBinary b = MakeBinary(0x93B0, 3, 2);
+  cache.Insert(10, a);
+  cache.Insert(20, b);
+  CHECK(cache.dirty());
+  const std::vector<uint8_t> data = cache.Serialize();
+  CHECK(!cache.dirty());
+
+  custom::ProgramBinaryCache loaded;
+  CHECK(loaded.Deserialize(data.data(), data.size()));
+  CHECK_EQ(loaded.size(), 2u);
+  CHECK(Holds(loaded, 10, a));
+  CHECK(Holds(loaded, 20, b));
+
+  const std::string path = "ProgramBinaryCacheTest.bin";
+  CHECK(cache.SaveToFile(path));
+  custom::ProgramBinaryCache from_file;
+  CHECK(from_file.LoadFromFile(path));
+  CHECK(Holds(from_file, 10, a));
+  remove(path.c_str());
+  CHECK(!from_file.LoadFromFile(path));
+  CHECK(!cache.SaveToFile("no-such-directory/cache.bin"));
+  CHECK(cache.dirty());
+}
+
+// Any single bit flip and every truncation is detected, and the entries in
+// memory are kept.
+void TestRejectsDamage() {
+  custom::ProgramBinaryCache cache;
+  cache.Insert(1, MakeBinary(7, 40, 1));
+  cache.Insert(2, MakeBinary(8, 9, 2));
+  const std::vector<uint8_t> data = cache.Serialize();
+
+  custom::ProgramBinaryCache target;
+  const custom::ProgramBinary kept = MakeBinary(9, 5, 3);
+  target.Insert(99, kept);
+  size_t accepted = 0;
+  for (size_t bit = 0; bit < data.size() * 8; ++bit) {
+    std::vector<uint8_t> damaged = data;
+    damaged[bit / 8] ^= static_cast<uint8_t>(1 << (bit % 8));
+    accepted += target.Deserialize(damaged.data(), damaged.size());
+  }
+  for (size_t size = 0; size < data.size(); ++size) {
+    accepted += target.Deserialize(data.data(), size);
+  }
+  CHECK_EQ(accepted, 0u);
+  CHECK_EQ(target.size(), 1u);
+  CHECK(Holds(target, 99, kept));
+}
+
+void TestStats() {
+  custom::ProgramBinaryCache cache;
+  cache.RecordMiss(30000000);
+  cache.RecordMiss(10000000);
+  cache.RecordHit(1000000);
+  cache.RecordRejected();
+  const custom::ProgramCacheStats stats = cache.stats();
+  CHECK_EQ(stats.misses, 2u);
+  CHECK_EQ(stats.hits, 1u);
+  CHECK_EQ(stats.rejected, 1u);
+  CHECK(stats.average_compile_ms() == 20.0);
+  CHECK(stats.average_load_ms() == 1.0);
+  cache.ResetStats();
+  CHECK_EQ(cache.stats().misses, 0u);
+}
+
+}  // namespace
+
+int main() {
+  TestKeys();
+  TestLruEviction();
+  TestRoundTrip();
+  TestRejectsDamage();
+  TestStats();
+  return TestExitCode();
+}
@@ -0,0 +1,319 @@
+//
+//  QualityMetricsTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/9.
+//
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "QualityMetrics.h"
+#include "TestCheck.h"
+#include "TestFrame.h"
+
+namespace {
+
+const custom::SimdPath kPaths[] = {custom::SimdPath::kScalar, custom::SimdPath::kSSE2, custom::SimdPath::kAVX2,
+                                   custom::SimdPath::kNEON};
+
+// An I420 frame and the same samples as NV12, both with padded rows.
+struct Frame {
+  static constexpr int kPadding = 9;
+
+  int width;
+  int height;
+  custom_test::TestFrame i420;
+  custom_test::TestFrame nv12;
+
+  Frame(int width, int height)
+      : width(width),
+        height(height),
+        i420(custom::kFourccI420, width, height, kPadding),
+        nv12(custom::kFourccNV12VideoRange, width, height, kPadding) {}
+
+  int chroma_width() const { return (width + 1) / 2; }
+  int chroma_height() const { return (height + 1) / 2; }
+
+  uint8_t &Y(int x, int row) { return i420.At(0, x, row); }
+  uint8_t &U(int x, int row) { return i420.At(1, x, row); }
+  uint8_t &V(int x, int row) { return i420.At(2, x, row); }
+
+  // Copies the I420 samples into the NV12 frame.
+  void Interleave() {
+    for (int row = 0; row < height; ++row) {
+      for (int x = 0; x < width; ++x) {
+        nv12.At(0, x, row) = Y(x, row);
+      }
+    }
+    for (int row = 0; row < chroma_height(); ++row) {
+      for (int x = 0; x < chroma_width(); ++x) {
+        nv12.At(1, 2 * x, row) = U(x, row);
+        nv12.At(1, 2 * x + 1, row) = V(x, row);
+      }
+    }
+  }
+
+  custom::Yuv420Image I420() const { return i420.image; }
+  custom::Yuv420Image NV12() const { return nv12.image; }
+};
+
+uint32_t Next(uint32_t *state) {
+  *state = *state * 1664525u + 1013904223u;
+  return *state >> 24;
+}
+
+// A smooth gradient with noise, so SSIM is neither 0 nor 1.
+Frame MakeReference(int width, int height, uint32_t seed) {
+  Frame frame(width, height);
+  uint32_t state = seed;
+  for (int row = 0; row < height; ++row) {
+    for (int x = 0; x < width; ++x) {
+      frame.Y(x, row) = static_cast<uint8_t>((x * 3 + row * 2 + Next(&state) % 16) & 0xFF);
+    }
+  }
+  for (int row = 0; row < frame.chroma_height(); ++row) {
+    for (int x = 0; x < frame.chroma_width(); ++x) {
+      frame.U(x, row) = static_cast<uint8_t>(96 + x + Next(&state) % 8);
+      frame.V(x, row) = static_cast<uint8_t>(160 - row + Next(&state) % 8);
+    }
+  }
+  frame.Interleave();
+  return frame;
+}
+
+// |reference| with noise of up to +-|amount| on every sample, clamped.
+Frame Distort(Frame reference, int amount, uint32_t seed) {
+  uint32_t state = seed;
+  auto distort = [&](uint8_t &sample) {
+    const int value = sample + static_cast<int>(Next(&state) % (2 * amount + 1)) - amount;
+    sample = static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+  };
+  for (int row = 0; row < reference.height; ++row) {
+    for (int x = 0; x < reference.width; ++x) {
+      distort(reference.Y(x, row));
+    }
+  }
+  for (int row = 0; row < reference.chroma_height(); ++row) {
+    for (int x = 0; x < reference.chroma_width(); ++x) {
+      distort(reference.U(x, row));
+      distort(reference.V(x, row));
+    }
+  }
+  reference.Interleave();
+  return reference;
+}
+
+custom::PlaneSource PlaneOf(const std::vector<uint8_t> &data, int width, int height, int stride) {
+  custom::PlaneSource plane;
+  plane.data = data.data();
+  plane.width = width;
+  plane.height = height;
+  plane.stride = stride;
+  return plane;
+}
+
+// SSE, and SSIM as x264 computes it, summing each 8x8 window's samples
+// directly rather than from 4x4 blocks.
+void ReferenceQuality(const custom::PlaneSource &a, const custom::PlaneSource &b, uint64_t *sse, double *ssim) {
+  *sse = 0;
+  for (int row = 0; row < a.height; ++row) {
+    for (int x = 0; x < a.width; ++x) {
+      const int difference = a.data[static_cast<size_t>(row) * a.stride + x] -
+                             b.data[static_cast<size_t>(row) * b.stride + x];
+      *sse += static_cast<uint64_t>(difference * difference);
+    }
+  }
+  // x264's constants, scaled for sums of 64 samples.
+  const double c1 = .01 * .01 * 255 * 255 * 64;
+  const double c2 = .03 * .03 * 255 * 255 * 64 * 63;
+  double total = 0;
+  int windows = 0;
+  for (int top = 0; top + 8 <= a.height / 4 * 4; top += 4) {
+    for (int left = 0; left + 8 <= a.width / 4 * 4; left += 4) {
+      double sum_a = 0;
+      double sum_b = 0;
+      double sum_squares = 0;
+      double sum_ab = 0;
+      for (int row = top; row < top + 8; ++row) {
+        for (int x = left; x < left + 8; ++x) {
+          const double sa = a.data[static_cast<size_t>(row) * a.stride + x];
+          const double sb = b.data[static_cast<size_t>(row) * b.stride + x];
+          sum_a += sa;
+          sum_b += sb;
+          sum_squares += sa * sa + sb * sb;
+          sum_ab += sa * sb;
+        }
+      }
+      const double variances = sum_squares * 64 - sum_a * sum_a - sum_b * sum_b;
+      const double covariance = sum_ab * 64 - sum_a * sum_b;
+      total += (2 * sum_a * sum_b + c1) * (2 * covariance + c2) /
+               ((sum_a * sum_a + sum_b * sum_b + c1) * (variances + c2));
+      windows++;
+    }
+  }
+  *ssim = total / windows;
+}
+
+// MeasurePlane() on every path matches the reference, odd sizes and strides
+// included, and every path gives the same bits.
+void TestMatchesReference() {
+  const int kSizes[][2] = {{8, 8}, {16, 16}, {33, 17}, {67, 45}, {130, 66}};
+  for (const auto &size : kSizes) {
+    const int width = size[0];
+    const int height = size[1];
+    const int stride = width + 13;
+    std::vector<uint8_t> a(static_cast<size_t>(stride) * height);
+    std::vector<uint8_t> b(a.size());
+    uint32_t state = width;
+    for (size_t i = 0; i < a.size(); ++i) {
+      a[i] = static_cast<uint8_t>(i % 251 / 2 + Next(&state) % 32);
+      b[i] = static_cast<uint8_t>(a[i] + Next(&state) % 24);
+    }
+    const custom::PlaneSource plane_a = PlaneOf(a, width, height, stride);
+    const custom::PlaneSource plane_b = PlaneOf(b, width, height, stride);
+    uint64_t expected_sse = 0;
+    double expected_ssim = 0;
+    ReferenceQuality(plane_a, plane_b, &expected_sse, &expected_ssim);
+
+    custom::PlaneQuality scalar;
+    custom::QualityMeter scalar_meter(custom::SimdPath::kScalar);
+    CHECK(scalar_meter.MeasurePlane(plane_a, plane_b, true, &scalar));
+    CHECK_EQ(scalar.sse, expected_sse);
+    CHECK_EQ(scalar.samples, static_cast<uint64_t>(width) * height);
+    CHECK(std::fabs(scalar.ssim - expected_ssim) < 1e-9);
+    CHECK(std::fabs(scalar.psnr - 10 * std::log10(255.0 * 255 * width * height / expected_sse)) < 1e-9);
+    for (custom::SimdPath path : kPaths) {
+      if (!custom::IsSimdPathSupported(path)) {
+        continue;
+      }
+      custom::QualityMeter meter(path);
+      custom::PlaneQuality quality;
+      CHECK(meter.MeasurePlane(plane_a, plane_b, true, &quality));
+      if (quality.sse != scalar.sse || quality.psnr != scalar.psnr || quality.ssim != scalar.ssim) {
+        printf("  %s differs from scalar at %dx%d\n", custom::SimdPathName(path), width, height);
+        CHECK(false);
+      }
+    }
+  }
+}
+
+// NV12 and I420 layouts of the same frames give the same scores, on every
+// path, with and without SSIM, and the frame scores combine the planes'.
+void TestLayoutsAgree() {
+  const int kSizes[][2] = {{16, 16}, {35, 19}, {128, 72}};
+  for (const auto &size : kSizes) {
+    Frame reference = MakeReference(size[0], size[1], 7);
+    Frame distorted = Distort(reference, 6, 8);
+    for (custom::SimdPath path : kPaths) {
+      if (!custom::IsSimdPathSupported(path)) {
+        continue;
+      }
+      custom::QualityMeter meter(path);
+      for (bool with_ssim : {false, true}) {
+        custom::FrameQuality i420;
+        CHECK(meter.Measure(reference.I420(), distorted.I420(), with_ssim, &i420));
+        const custom::Yuv420Image layouts[][2] = {{reference.NV12(), distorted.NV12()},
+                                                  {reference.I420(), distorted.NV12()},
+                                                  {reference.NV12(), distorted.I420()}};
+        for (const auto &pair : layouts) {
+          custom::FrameQuality quality;
+          CHECK(meter.Measure(pair[0], pair[1], with_ssim, &quality));
+          for (int plane = 0; plane < 3; ++plane) {
+            CHECK_EQ(quality.planes[plane].sse, i420.planes[plane].sse);
+            CHECK_EQ(quality.planes[plane].ssim, i420.planes[plane].ssim);
+          }
+          CHECK_EQ(quality.psnr, i420.psnr);
+          CHECK_EQ(quality.ssim, i420.ssim);
+        }
+
+        uint64_t sse = 0;
+        uint64_t samples = 0;
+        double ssim = 0;
+        for (const custom::PlaneQuality &plane : i420.planes) {
+          sse += plane.sse;
+          samples += plane.samples;
+          ssim += plane.ssim * plane.samples;
+          CHECK_EQ(plane.ssim == 0, !with_ssim);
+        }
+        CHECK_EQ(samples, static_cast<uint64_t>(size[0]) * size[1] +
+                              2 * static_cast<uint64_t>((size[0] + 1) / 2) * ((size[1] + 1) / 2));
+        CHECK(std::fabs(i420.psnr - 10 * std::log10(255.0 * 255 * samples / sse)) < 1e-9);
+        CHECK(std::fabs(i420.ssim - ssim / samples) < 1e-12);
+      }
+    }
+  }
+}
+
+void TestKnownScores() {
+  Frame reference = MakeReference(64, 48, 3);
+  custom::QualityMeter meter;
+  custom::FrameQuality quality;
+  CHECK(meter.Measure(reference.NV12(), reference.I420(), true, &quality));
+  CHECK_EQ(quality.psnr, custom::kMaxPsnr);
+  CHECK_EQ(quality.ssim, 1.0);
+  for (const custom::PlaneQuality &plane : quality.planes) {
+    CHECK_EQ(plane.sse, 0u);
+    CHECK_EQ(plane.psnr, custom::kMaxPsnr);
+    CHECK(std::fabs(plane.ssim - 1) < 1e-12);
+  }
+
+  // Every luma sample off by one: 10 * log10(255^2).
+  Frame brighter = reference;
+  for (int row = 0; row < 48; ++row) {
+    for (int x = 0; x < 64; ++x) {
+      brighter.Y(x, row) = static_cast<uint8_t>(reference.Y(x, row) ^ 1);
+    }
+  }
+  CHECK(meter.Measure(reference.I420(), brighter.I420(), true, &quality));
+  CHECK_EQ(quality.planes[0].sse, 64u * 48);
+  CHECK(std::fabs(quality.planes[0].psnr - 48.130803608679) < 1e-9);
+  CHECK(quality.planes[0].ssim > 0.99 && quality.planes[0].ssim < 1);
+  CHECK_EQ(quality.planes[1].psnr, custom::kMaxPsnr);
+
+  // More noise scores lower.
+  custom::FrameQuality light;
+  custom::FrameQuality heavy;
+  CHECK(meter.Measure(reference.I420(), Distort(reference, 2, 5).I420(), true, &light));
+  CHECK(meter.Measure(reference.I420(), Distort(reference, 20, 5).I420(), true, &heavy));
+  CHECK(heavy.psnr < light.psnr);
+  CHECK(heavy.ssim < light.ssim);
+}
+
+void TestRejectsInvalidArguments() {
+  custom::QualityMeter meter;
+  custom::FrameQuality quality;
+  Frame small = MakeReference(custom::kMinQualityFrameSize - 1, 32, 1);
+  CHECK(!meter.Measure(small.I420(), small.I420(), false, &quality));
+  Frame a = MakeReference(32, 32, 1);
+  Frame b = MakeReference(32, 34, 1);
+  CHECK(!meter.Measure(a.I420(), b.I420(), false, &quality));
+  custom::Yuv420Image missing = a.NV12();
+  missing.planes[1] = nullptr;
+  CHECK(!meter.Measure(a.I420(), missing, false, &quality));
+
+  custom::PlaneQuality plane_quality;
+  const std::vector<uint8_t> data(64 * 8);
+  CHECK(meter.MeasurePlane(PlaneOf(data, 7, 7, 8), PlaneOf(data, 7, 7, 8), false, &plane_quality));
+  CHECK(!meter.MeasurePlane(PlaneOf(data, 7, 7, 8), PlaneOf(data, 7, 7, 8), true, &plane_quality));
+  CHECK(!meter.MeasurePlane(PlaneOf(data, 8, 8, 8), PlaneOf(data, 8, 7, 8), false, &plane_quality));
+  custom::PlaneSource interleaved = PlaneOf(data, 8, 8, 16);
+  interleaved.bytes_per_sample = 2;
+  CHECK(!meter.MeasurePlane(interleaved, interleaved, false, &plane_quality));
+  for (custom::SimdPath path : kPaths) {
+    custom::QualityMeter path_meter(path);
+    CHECK_EQ(path_meter.Measure(a.I420(), a.NV12(), true, &quality), custom::IsSimdPathSupported(path));
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestMatchesReference();
+  TestLayoutsAgree();
+  TestKnownScores();
+  TestRejectsInvalidArguments();
+  return TestExitCode();
+}
@@ -0,0 +1,200 @@
+//
+//  RotateConvertTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+#include <cstdint>
+#include <vector>
+
+#include "RotateConvert.h"
+#include "TestCheck.h"
+
+namespace {
+
+const custom::Rotation kRotations[] = {custom::Rotation::k0, custom::Rotation::k90, custom::Rotation::k180,
+                                       custom::Rotation::k270};
+const custom::SimdPath kPaths[] = {custom::SimdPath::kScalar, custom::SimdPath::kSSE2, custom::SimdPath::kAVX2,
+                                   custom::SimdPath::kNEON};
+
+struct Nv12 {
+  int width = 0;
+  int height = 0;
+  int stride_y = 0;
+  int stride_uv = 0;
+  std::vector<uint8_t> y;
+  std::vector<uint8_t> uv;
+
+  Nv12(int w, int h, int padding) : width(w), height(h) {
+    stride_y = w + padding;
+    stride_uv = (w + 1) / 2 * 2 + padding;
+    y.assign(static_cast<size_t>(stride_y) * h, 0xEE);
+    uv.assign(static_cast<size_t>(stride_uv) * ((h + 1) / 2), 0xEE);
+  }
+};
+
+// libyuv::ARGBRotate followed by the C path of libyuv::ARGBToNV12, written out
+// pixel by pixel with libyuv's BT.601 constants.
+Nv12 Reference(const std::vector<uint8_t> &bgra, int width, int height, custom::Rotation rotation) {
+  const bool swap = rotation == custom::Rotation::k90 || rotation == custom::Rotation::k270;
+  const int dst_width = swap ? height : width;
+  const int dst_height = swap ? width : height;
+  std::vector<uint8_t> rotated(static_cast<size_t>(dst_width) * dst_height * 4);
+  for (int y = 0; y < dst_height; ++y) {
+    for (int x = 0; x < dst_width; ++x) {
+      int sx = x;
+      int sy = y;
+      switch (rotation) {
+        case custom::Rotation::k0:
+          break;
+        case custom::Rotation::k90:
+          sx = y;
+          sy = height - 1 - x;
+          break;
+        case custom::Rotation::k180:
+          sx = width - 1 - x;
+          sy = height - 1 - y;
+          break;
+        case custom::Rotation::k270:
+          sx = width - 1 - y;
+          sy = x;
+          break;
+      }
+      for (int c = 0; c < 4; ++c) {
+        rotated[(static_cast<size_t>(y) * dst_width + x) * 4 + c] = bgra[(static_cast<size_t>(sy) * width + sx) * 4 + c];
+      }
+    }
+  }
+
+  Nv12 out(dst_width, dst_height, 0);
+  auto pixel = [&](int x, int y) { return &rotated[(static_cast<size_t>(y) * dst_width + x) * 4]; };
+  for (int y = 0; y < dst_height; ++y) {
+    for (int x = 0; x < dst_width; ++x) {
+      const uint8_t *p = pixel(x, y);
+      out.y[y * out.stride_y + x] = static_cast<uint8_t>((66 * p[2] + 129 * p[1] + 25 * p[0] + 0x1080) >> 8);
+    }
+  }
+  for (int y = 0; y < dst_height; y += 2) {
+    const int y1 = y + 1 < dst_height ? y + 1 : y;
+    for (int x = 0; x < dst_width; x += 2) {
+      int sum[3] = {};
+      const int columns = x + 1 < dst_width ? 2 : 1;
+      for (int c = 0; c < 3; ++c) {
+        for (int dx = 0; dx < columns; ++dx) {
+          sum[c] += pixel(x + dx, y)[c] + pixel(x + dx, y1)[c];
+        }
+        sum[c] >>= columns;
+      }
+      const int b = sum[0], g = sum[1], r = sum[2];
+      out.uv[(y / 2) * out.stride_uv + x] = static_cast<uint8_t>((112 * b - 74 * g - 38 * r + 0x8080) >> 8);
+      out.uv[(y / 2) * out.stride_uv + x + 1] = static_cast<uint8_t>((112 * r - 94 * g - 18 * b + 0x8080) >> 8);
+    }
+  }
+  return out;
+}
+
+std::vector<uint8_t> Pattern(int width, int height, int stride, uint32_t seed) {
+  std::vector<uint8_t> bgra(static_cast<size_t>(stride) * height, 0);
+  uint32_t state = seed;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width * 4; ++x) {
+      state = state * 1664525u + 1013904223u;
+      bgra[y * stride + x] = static_cast<uint8_t>(state >> 24);
+    }
+  }
+  return bgra;
+}
+
+// Compares the visible part of |actual| and checks its padding was left alone.
+bool Matches(const Nv12 &actual, const Nv12 &expected) {
+  for (int y = 0; y < expected.height; ++y) {
+    for (int x = 0; x < actual.stride_y; ++x) {
+      const uint8_t value = actual.y[y * actual.stride_y + x];
+      if (x < expected.width ? value != expected.y[y * expected.stride_y + x] : value != 0xEE) {
+        return false;
+      }
+    }
+  }
+  const int uv_width = (expected.width + 1) / 2 * 2;
+  for (int y = 0; y < (expected.height + 1) / 2; ++y) {
+    for (int x = 0; x < actual.stride_uv; ++x) {
+      const uint8_t value = actual.uv[y * actual.stride_uv + x];
+      if (x < uv_width ? value != expected.uv[y * expected.stride_uv + x] : value != 0xEE) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void TestMatchesLibyuv() {
+  const int kSizes[][2] = {{2, 2}, {1, 1}, {7, 5}, {33, 17}, {64, 48}, {65, 37}, {130, 3}};
+  for (const auto &size : kSizes) {
+    const int width = size[0];
+    const int height = size[1];
+    const int src_stride = width * 4 + 12;
+    std::vector<uint8_t> bgra = Pattern(width, height, src_stride, width * 31 + height);
+    std::vector<uint8_t> packed(static_cast<size_t>(width) * height * 4);
+    for (int y = 0; y < height; ++y) {
+      std::copy(&bgra[y * src_stride], &bgra[y * src_stride + width * 4], &packed[y * width * 4]);
+    }
+    for (custom::Rotation rotation : kRotations) {
+      const Nv12 expected = Reference(packed, width, height, rotation);
+      for (custom::SimdPath path : kPaths) {
+        if (!custom::IsSimdPathSupported(path)) {
+          continue;
+        }
+        Nv12 actual(expected.width, expected.height, 24);
+        CHECK(custom::BGRAToNV12Rotated(bgra.data(), src_stride, width, height, actual.y.data(), actual.stride_y,
+                                        actual.uv.data(), actual.stride_uv, rotation, path));
+        if (!Matches(actual, expected)) {
+          fprintf(stderr, "%dx%d rotated %d on %s\n", width, height, static_cast<int>(rotation),
+                  custom::SimdPathName(path));
+          CHECK(false);
+        }
+      }
+    }
+  }
+}
+
+// Pure colors land on libyuv's values.
+void TestGolden() {
+  const struct {
+    uint8_t b, g, r;
+    uint8_t y, u, v;
+  } kColors[] = {
+      {0, 0, 0, 16, 128, 128},     {255, 255, 255, 235, 128, 128}, {0, 0, 255, 82, 90, 240},
+      {0, 255, 0, 144, 54, 34},    {255, 0, 0, 41, 240, 110},
+  };
+  for (const auto &color : kColors) {
+    std::vector<uint8_t> bgra;
+    for (int i = 0; i < 16 * 8; ++i) {
+      bgra.insert(bgra.end(), {color.b, color.g, color.r, 255});
+    }
+    Nv12 out(8, 16, 0);
+    CHECK(custom::BGRAToNV12Rotated(bgra.data(), 16 * 4, 16, 8, out.y.data(), out.stride_y, out.uv.data(),
+                                    out.stride_uv, custom::Rotation::k90));
+    CHECK_EQ(out.y[0], color.y);
+    CHECK_EQ(out.y[out.y.size() - 1], color.y);
+    CHECK_EQ(out.uv[0], color.u);
+    CHECK_EQ(out.uv[1], color.v);
+  }
+}
+
+void TestRejectsBadArguments() {
+  std::vector<uint8_t> bgra(16 * 4);
+  Nv12 out(4, 4, 0);
+  CHECK(!custom::BGRAToNV12Rotated(nullptr, 16, 4, 4, out.y.data(), 4, out.uv.data(), 4, custom::Rotation::k0));
+  CHECK(!custom::BGRAToNV12Rotated(bgra.data(), 16, 0, 4, out.y.data(), 4, out.uv.data(), 4, custom::Rotation::k0));
+  CHECK(!custom::BGRAToNV12Rotated(bgra.data(), 8, 4, 4, out.y.data(), 4, out.uv.data(), 4, custom::Rotation::k0));
+}
+
+}  // namespace
+
+int main() {
+  TestMatchesLibyuv();
+  TestGolden();
+  TestRejectsBadArguments();
+  return TestExitCode();
+}
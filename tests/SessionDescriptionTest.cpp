@@ -0,0 +1,283 @@
+//
+//  SessionDescriptionTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/12.
+//
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "SessionDescription.h"
+#include "TestCheck.h"
+
+namespace {
+
+// Audio, video with H264 and its rtx after VP8, and a data channel.
+const char kOffer[] =
+    "v=0\r\n"
+    "o=- 4611731400430051336 2 IN IP4 127.0.0.1\r\n"
+    "s=-\r\n"
+    "t=0 0\r\n"
+    "a=group:BUNDLE 0 1 2\r\n"
+    "m=audio 9 UDP/TLS/RTP/SAVPF 111 0\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "a=mid:0\r\n"
+    "a=sendrecv\r\n"
+    "a=rtpmap:111 opus/48000/2\r\n"
+    "a=fmtp:111 minptime=10;useinbandfec=1\r\n"
+    "a=rtpmap:0 PCMU/8000\r\n"
+    "m=video 9 UDP/TLS/RTP/SAVPF 96 97 102 103 35\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "a=mid:1\r\n"
+    "a=rtpmap:96 VP8/90000\r\n"
+    "a=rtpmap:97 rtx/90000\r\n"
+    "a=fmtp:97 apt=96\r\n"
+    "a=rtpmap:102 H264/90000\r\n"
+    "a=fmtp:102 level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42001f\r\n"
+    "a=rtpmap:103 rtx/90000\r\n"
+    "a=fmtp:103 apt=102\r\n"
+    "m=application 9 UDP/DTLS/SCTP webrtc-datachannel\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "a=mid:2\r\n"
+    "a=recvonly\r\n";
+
+std::string WithoutCarriageReturns(std::string_view text) {
+  std::string out;
+  for (char c : text) {
+    if (c != '\r') {
+      out.push_back(c);
+    }
+  }
+  return out;
+}
+
+// Lines of |description|'s output, without their line breaks.
+std::vector<std::string> Lines(const custom::SessionDescription &description) {
+  std::vector<std::string> lines;
+  const std::string text = description.ToString();
+  size_t begin = 0;
+  while (begin < text.size()) {
+    const size_t end = text.find("\r\n", begin);
+    lines.push_back(text.substr(begin, end - begin));
+    begin = end + 2;
+  }
+  return lines;
+}
+
+void TestParse() {
+  custom::SessionDescription description;
+  CHECK(description.Parse(kOffer));
+  CHECK_EQ(std::string(description.error()), "");
+  CHECK_EQ(description.line_count(), 26u);
+  CHECK_EQ(description.session_end_line(), 5u);
+  CHECK_EQ(description.media_count(), 3u);
+  CHECK_EQ(description.line(1).type, 'o');
+  CHECK_EQ(description.line(1).value, "- 4611731400430051336 2 IN IP4 127.0.0.1");
+  // Unedited, the output is the input.
+  CHECK_EQ(description.ToString(), kOffer);
+
+  // LF only, with blank lines and no final line break.
+  std::string lf = WithoutCarriageReturns(kOffer);
+  lf.insert(lf.find("s=-"), "\n");
+  lf.pop_back();
+  CHECK(description.Parse(lf));
+  CHECK_EQ(description.line_count(), 26u);
+  CHECK_EQ(description.ToString(), kOffer);
+
+  const custom::SdpAttribute attribute = custom::SplitSdpAttribute("rtpmap:111 opus/48000/2");
+  CHECK_EQ(attribute.name, "rtpmap");
+  CHECK_EQ(attribute.value, "111 opus/48000/2");
+  CHECK_EQ(custom::SplitSdpAttribute("rtcp-mux").name, "rtcp-mux");
+  CHECK(custom::SplitSdpAttribute("rtcp-mux").value.empty());
+
+  std::string_view value;
+  CHECK(description.FindAttribute(0, description.line_count(), "mid", &value));
+  CHECK_EQ(value, "0");
+  CHECK(description.FindAttribute(description.media(1).first_line, description.media(1).end_line, "mid", &value));
+  CHECK_EQ(value, "1");
+  CHECK(!description.FindAttribute(0, description.session_end_line(), "mid", &value));
+  CHECK(!description.FindAttribute(0, 1000, "ice-ufrag", &value));
+}
+
+void TestParseErrors() {
+  custom::SessionDescription description;
+  CHECK(!description.Parse(""));
+  CHECK_EQ(std::string(description.error()), "doesn't start with v=");
+  CHECK(!description.Parse("s=-\r\nv=0\r\n"));
+  CHECK_EQ(description.error_line(), 0u);
+  CHECK(!description.Parse("v=0\r\no=- 1 2 IN IP4 127.0.0.1\r\nbogus\r\n"));
+  CHECK_EQ(std::string(description.error()), "line isn't <type>=<value>");
+  CHECK_EQ(description.error_line(), 2u);
+  CHECK(!description.Parse("v=0\nX=upper\n"));
+  CHECK_EQ(description.error_line(), 1u);
+  CHECK(!description.Parse("v=0\nm\n"));
+  // A failed parse leaves nothing behind, and the next one succeeds.
+  CHECK_EQ(description.line_count(), 0u);
+  CHECK_EQ(description.media_count(), 0u);
+  CHECK(description.Parse("v=0\r\n"));
+  CHECK_EQ(std::string(description.error()), "");
+  CHECK_EQ(description.line_count(), 1u);
+  CHECK_EQ(description.session_end_line(), 1u);
+}
+
+void TestMediaSections() {
+  custom::SessionDescription description;
+  CHECK(description.Parse(kOffer));
+
+  const custom::SdpMediaSection &audio = description.media(0);
+  CHECK_EQ(audio.first_line, 5u);
+  CHECK_EQ(audio.end_line, 12u);
+  CHECK_EQ(audio.media, "audio");
+  CHECK_EQ(audio.port, "9");
+  CHECK_EQ(audio.protocol, "UDP/TLS/RTP/SAVPF");
+  CHECK_EQ(audio.formats.size(), 2u);
+  CHECK_EQ(audio.mid, "0");
+  CHECK_EQ(audio.direction, "sendrecv");
+  CHECK_EQ(audio.codecs.size(), 2u);
+  CHECK_EQ(audio.codecs[0].payload_type, 111);
+  CHECK_EQ(audio.codecs[0].name, "opus");
+  CHECK_EQ(audio.codecs[0].clock_rate, 48000);
+  CHECK_EQ(audio.codecs[0].fmtp, "minptime=10;useinbandfec=1");
+  CHECK_EQ(audio.codecs[0].associated_payload_type, -1);
+  CHECK_EQ(audio.codecs[1].name, "PCMU");
+  CHECK_EQ(audio.codecs[1].clock_rate, 8000);
+
+  // 35 has no a=rtpmap, so it isn't a codec.
+  const custom::SdpMediaSection &video = description.media(1);
+  CHECK_EQ(video.formats.size(), 5u);
+  CHECK_EQ(video.formats[4], "35");
+  CHECK_EQ(video.codecs.size(), 4u);
+  CHECK_EQ(video.codecs[1].name, "rtx");
+  CHECK_EQ(video.codecs[1].associated_payload_type, 96);
+  CHECK_EQ(video.codecs[3].associated_payload_type, 102);
+  // Absent direction is sendrecv.
+  CHECK_EQ(video.direction, "sendrecv");
+
+  const custom::SdpMediaSection &data = description.media(2);
+  CHECK_EQ(data.end_line, description.line_count());
+  CHECK_EQ(data.media, "application");
+  CHECK_EQ(data.formats.size(), 1u);
+  CHECK_EQ(data.formats[0], "webrtc-datachannel");
+  CHECK(data.codecs.empty());
+  CHECK_EQ(data.direction, "recvonly");
+}
+
+void TestPreferCodec() {
+  custom::SessionDescription description;
+  CHECK(description.Parse(kOffer));
+  // Compared case insensitively; the rtx follows its codec.
+  CHECK(description.PreferCodec(1, "h264"));
+  const custom::SdpMediaSection &video = description.media(1);
+  CHECK_EQ(description.line(video.first_line).value, "video 9 UDP/TLS/RTP/SAVPF 102 103 96 97 35");
+  CHECK_EQ(video.formats.size(), 5u);
+  CHECK_EQ(video.formats[0], "102");
+  CHECK_EQ(video.codecs[0].payload_type, 102);
+  CHECK_EQ(video.codecs[1].payload_type, 103);
+  CHECK_EQ(video.codecs[2].payload_type, 96);
+  CHECK_EQ(video.codecs[3].payload_type, 97);
+  // Preferring it again changes nothing.
+  CHECK(description.PreferCodec(1, "H264"));
+  CHECK_EQ(description.line(video.first_line).value, "video 9 UDP/TLS/RTP/SAVPF 102 103 96 97 35");
+
+  CHECK(!description.PreferCodec(1, "AV1"));
+  CHECK(!description.PreferCodec(2, "H264"));
+  CHECK(description.PreferCodec(0, "PCMU"));
+  CHECK_EQ(description.line(description.media(0).first_line).value, "audio 9 UDP/TLS/RTP/SAVPF 0 111");
+
+  std::string expected = kOffer;
+  expected.replace(expected.find("111 0\r\n"), 5, "0 111");
+  expected.replace(expected.find("96 97 102 103 35"), 16, "102 103 96 97 35");
+  CHECK_EQ(description.ToString(), expected);
+}
+
+void TestBandwidth() {
+  custom::SessionDescription description;
+  CHECK(description.Parse(kOffer));
+  const size_t lines = description.line_count();
+  // Inserted after c=, and the sections after it move down.
+  description.SetBandwidth(1, 2000);
+  CHECK_EQ(description.line_count(), lines + 1);
+  const custom::SdpMediaSection &video = description.media(1);
+  CHECK_EQ(description.line(video.first_line + 2).type, 'b');
+  CHECK_EQ(description.line(video.first_line + 2).value, "AS:2000");
+  CHECK_EQ(video.end_line, 23u);
+  CHECK_EQ(description.media(2).first_line, 23u);
+  CHECK_EQ(description.media(0).end_line, 12u);
+
+  description.SetBandwidth(1, 500);
+  CHECK_EQ(description.line_count(), lines + 1);
+  CHECK_EQ(description.line(video.first_line + 2).value, "AS:500");
+
+  description.SetBandwidth(1, 0);
+  CHECK_EQ(description.line_count(), lines);
+  CHECK_EQ(description.media(2).first_line, 22u);
+  CHECK_EQ(description.ToString(), kOffer);
+  // Removing what isn't there does nothing.
+  description.SetBandwidth(1, 0);
+  CHECK_EQ(description.ToString(), kOffer);
+
+  // Without c=, right after the m= line; the last section ends with the SDP.
+  CHECK(description.Parse("v=0\r\nm=video 9 RTP/AVP 96\r\na=mid:0\r\n"));
+  description.SetBandwidth(0, 300);
+  CHECK_EQ(description.ToString(), "v=0\r\nm=video 9 RTP/AVP 96\r\nb=AS:300\r\na=mid:0\r\n");
+  CHECK_EQ(description.media(0).end_line, description.line_count());
+}
+
+void TestSimulcast() {
+  custom::SessionDescription description;
+  CHECK(description.Parse(kOffer));
+  const std::vector<std::string> rids = {"h", "m", "l"};
+  CHECK(!description.AddSimulcast(0, rids));
+  CHECK(!description.AddSimulcast(2, rids));
+  CHECK(!description.AddSimulcast(1, {}));
+  CHECK(description.AddSimulcast(1, rids));
+  // Only once.
+  CHECK(!description.AddSimulcast(1, rids));
+
+  const std::vector<std::string> lines = Lines(description);
+  const custom::SdpMediaSection &video = description.media(1);
+  CHECK_EQ(video.end_line, 26u);
+  CHECK_EQ(lines[22], "a=rid:h send");
+  CHECK_EQ(lines[23], "a=rid:m send");
+  CHECK_EQ(lines[24], "a=rid:l send");
+  CHECK_EQ(lines[25], "a=simulcast:send h;m;l");
+  CHECK_EQ(lines[26], "m=application 9 UDP/DTLS/SCTP webrtc-datachannel");
+  CHECK_EQ(description.media(2).first_line, 26u);
+
+  // Not for a section that doesn't send.
+  std::string recvonly = kOffer;
+  recvonly.insert(recvonly.find("a=mid:1\r\n") + 9, "a=recvonly\r\n");
+  CHECK(description.Parse(recvonly));
+  CHECK(!description.AddSimulcast(1, rids));
+
+  // Edits combine: each keeps the others' line ranges right.
+  CHECK(description.Parse(kOffer));
+  CHECK(description.AddSimulcast(1, {"f"}));
+  description.SetBandwidth(1, 1000);
+  CHECK(description.PreferCodec(1, "H264"));
+  description.SetBandwidth(2, 64);
+  std::string expected = kOffer;
+  expected.replace(expected.find("96 97 102 103 35"), 16, "102 103 96 97 35");
+  expected.insert(expected.find("a=mid:1\r\n"), "b=AS:1000\r\n");
+  expected.insert(expected.find("m=application"), "a=rid:f send\r\na=simulcast:send f\r\n");
+  expected.insert(expected.find("a=mid:2\r\n"), "b=AS:64\r\n");
+  CHECK_EQ(description.ToString(), expected);
+
+  std::string appended = "x";
+  description.AppendTo(&appended);
+  CHECK_EQ(appended, "x" + expected);
+}
+
+}  // namespace
+
+int main() {
+  TestParse();
+  TestParseErrors();
+  TestMediaSections();
+  TestPreferCodec();
+  TestBandwidth();
+  TestSimulcast();
+  return TestExitCode();
+}
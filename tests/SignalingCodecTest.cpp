@@ -0,0 +1,359 @@
+//
+//  SignalingCodecTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/10.
+//
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "SignalingCodec.h"
+#include "TestCheck.h"
+
+// Counts heap allocations, to check that steady state parsing makes none.
+namespace {
+size_t allocations = 0;
+}  // namespace
+
+void *operator new(size_t size) {
+  allocations++;
+  if (void *p = malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  free(p);
+}
+
+namespace {
+
+using custom::SignalingMessageType;
+
+const char kOffer[] =
+    "{\"type\":\"offer\",\"sessionDescription\":{\"sdp\":\"v=0\\r\\no=- 4611731400430051336 2 IN IP4 127.0.0.1\\r\\n"
+    "s=-\\r\\nt=0 0\\r\\na=group:BUNDLE 0\\r\\nm=audio 9 UDP/TLS/RTP/SAVPF 111\\r\\n\"},\"candidateBatches\":true}";
+
+const char kCandidate[] =
+    "{\"type\":\"candidate\",\"candidate\":{\"sdp\":\"candidate:842163049 1 udp 1677729535 203.0.113.7 51000 typ "
+    "srflx raddr 10.0.0.2 rport 51000 generation 0\",\"sdpMLineIndex\":0,\"sdpMid\":\"0\"}}";
+
+bool SameCandidate(const custom::SignalingCandidate &x, const custom::SignalingCandidate &y) {
+  return x.sdp == y.sdp && x.sdp_mline_index == y.sdp_mline_index && x.has_sdp_mid == y.has_sdp_mid &&
+         (!x.has_sdp_mid || x.sdp_mid == y.sdp_mid);
+}
+
+bool SameMessage(const custom::SignalingMessage &a, const custom::SignalingMessage &b) {
+  if (a.type != b.type || a.has_session_description != b.has_session_description ||
+      a.supports_candidate_batches != b.supports_candidate_batches ||
+      a.supports_data_frames != b.supports_data_frames || a.has_candidate != b.has_candidate ||
+      a.candidate_count != b.candidate_count) {
+    return false;
+  }
+  if ((a.has_session_description && a.sdp != b.sdp) || (a.has_candidate && !SameCandidate(a.candidate, b.candidate))) {
+    return false;
+  }
+  for (size_t i = 0; i < a.candidate_count; ++i) {
+    if (!SameCandidate(a.candidates[i], b.candidates[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Parses(std::string_view json) {
+  custom::SignalingParser parser;
+  custom::SignalingMessage message;
+  return parser.Parse(json, &message);
+}
+
+void TestParsesMessages() {
+  custom::SignalingParser parser;
+  custom::SignalingMessage message;
+  CHECK(parser.Parse(kOffer, &message));
+  CHECK(message.type == SignalingMessageType::kOffer);
+  CHECK(message.has_session_description);
+  CHECK_EQ(message.sdp, std::string_view("v=0\r\no=- 4611731400430051336 2 IN IP4 127.0.0.1\r\ns=-\r\nt=0 0\r\n"
+                                         "a=group:BUNDLE 0\r\nm=audio 9 UDP/TLS/RTP/SAVPF 111\r\n"));
+  CHECK(message.supports_candidate_batches);
+  CHECK(!message.has_candidate);
+  CHECK_EQ(message.candidate_count, 0u);
+  CHECK_EQ(std::string(parser.error()), "");
+
+  // A string without escapes is a view of the frame.
+  const std::string frame = kCandidate;
+  CHECK(parser.Parse(frame, &message));
+  CHECK(message.type == SignalingMessageType::kCandidate);
+  CHECK(message.has_candidate);
+  CHECK(message.candidate.sdp.data() > frame.data() && message.candidate.sdp.data() < frame.data() + frame.size());
+  CHECK_EQ(message.candidate.sdp_mline_index, 0);
+  CHECK(message.candidate.has_sdp_mid);
+  CHECK_EQ(message.candidate.sdp_mid, "0");
+  CHECK(!message.supports_candidate_batches);
+
+  // Any key order, whitespace, nulls for optionals and unknown keys of any
+  // shape.
+  CHECK(parser.Parse(" {\n\"extra\" : {\"a\":[1, -2.5e3, true, null, \"x\\\"\", {}]},\t\"candidate\" : {"
+                     "\"sdpMid\":null, \"sdpMLineIndex\": -7, \"ignored\": [], \"sdp\": \"c\"},"
+                     "\"sessionDescription\":null, \"type\" : \"candidate\"} ",
+                     &message));
+  CHECK(message.has_candidate);
+  CHECK(!message.has_session_description);
+  CHECK(!message.candidate.has_sdp_mid);
+  CHECK_EQ(message.candidate.sdp_mline_index, -7);
+
+  CHECK(parser.Parse("{\"type\":\"candidates\",\"candidates\":[{\"sdp\":\"a\",\"sdpMLineIndex\":0},"
+                     "{\"sdp\":\"b\",\"sdpMLineIndex\":1,\"sdpMid\":\"1\"}]}",
+                     &message));
+  CHECK(message.type == SignalingMessageType::kCandidates);
+  CHECK_EQ(message.candidate_count, 2u);
+  CHECK_EQ(message.candidates[1].sdp, "b");
+  CHECK_EQ(message.candidates[1].sdp_mid, "1");
+  CHECK(parser.Parse("{\"type\":\"candidates\",\"candidates\":[]}", &message));
+  CHECK_EQ(message.candidate_count, 0u);
+
+  for (const char *type : {"offer", "answer", "unKnown", "candidate", "candidates"}) {
+    CHECK(Parses("{\"type\":\"" + std::string(type) + "\"}"));
+  }
+  CHECK(parser.Parse("{\"type\":\"answer\",\"candidateBatches\":null}", &message));
+  CHECK(!message.supports_candidate_batches);
+  CHECK(parser.Parse("{\"type\":\"answer\",\"candidateBatches\":false}", &message));
+  CHECK(!message.supports_candidate_batches);
+  CHECK(!message.supports_data_frames);
+  CHECK(parser.Parse("{\"dataFrames\":true,\"type\":\"offer\"}", &message));
+  CHECK(message.supports_data_frames);
+  CHECK(!message.supports_candidate_batches);
+  CHECK(parser.Parse("{\"type\":\"offer\",\"dataFrames\":null}", &message));
+  CHECK(!message.supports_data_frames);
+  CHECK(parser.Parse("{\"type\":\"answer\",\"c\":2147483647,\"candidate\":{\"sdp\":\"\",\"sdpMLineIndex\":"
+                     "-2147483648}}",
+                     &message));
+  CHECK_EQ(message.candidate.sdp_mline_index, INT32_MIN);
+}
+
+void TestUnescapes() {
+  custom::SignalingParser parser;
+  custom::SignalingMessage message;
+  CHECK(parser.Parse("{\"type\":\"offer\",\"sessionDescription\":{\"sdp\":"
+                     "\"\\\"\\\\\\/\\b\\f\\n\\r\\t\\u0041\\u00e9\\u20AC\\ud83d\\ude00.\"}}",
+                     &message));
+  CHECK_EQ(message.sdp, std::string_view("\"\\/\b\f\n\r\t"
+                                         "A\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80."));
+  // UTF-8 passes through as it is.
+  CHECK(parser.Parse("{\"type\":\"offer\",\"sessionDescription\":{\"sdp\":\"\xC3\xA9\\n\"}}", &message));
+  CHECK_EQ(message.sdp, std::string_view("\xC3\xA9\n"));
+}
+
+void TestRejects() {
+  const char *kInvalid[] = {
+      "",
+      "[]",
+      "{}",
+      "{\"type\":\"Offer\"}",
+      "{\"type\":1}",
+      "{\"type\":\"offer\"",
+      "{\"type\":\"offer\",}",
+      "{\"type\":\"offer\"} x",
+      "{\"type\":\"offer\"}{}",
+      "{\"type\":\"offer\" \"a\":1}",
+      "{\"type\":\"offer\",\"sessionDescription\":{}}",
+      "{\"type\":\"offer\",\"sessionDescription\":{\"sdp\":1}}",
+      "{\"type\":\"offer\",\"sessionDescription\":{\"sdp\":\"\\x\"}}",
+      "{\"type\":\"offer\",\"sessionDescription\":{\"sdp\":\"\\u12\"}}",
+      "{\"type\":\"offer\",\"sessionDescription\":{\"sdp\":\"\\ud83d\"}}",
+      "{\"type\":\"offer\",\"sessionDescription\":{\"sdp\":\"\\ud83d\\u0041\"}}",
+      "{\"type\":\"offer\",\"sessionDescription\":{\"sdp\":\"\\ude00\"}}",
+      "{\"type\":\"offer\",\"sessionDescription\":{\"sdp\":\"a\nb\"}}",
+      "{\"type\":\"offer\",\"sessionDescription\":{\"sdp\":\"abc",
+      "{\"type\":\"candidate\",\"candidate\":{\"sdp\":\"a\"}}",
+      "{\"type\":\"candidate\",\"candidate\":{\"sdpMLineIndex\":0}}",
+      "{\"type\":\"candidate\",\"candidate\":{\"sdp\":\"a\",\"sdpMLineIndex\":1.0}}",
+      "{\"type\":\"candidate\",\"candidate\":{\"sdp\":\"a\",\"sdpMLineIndex\":1e2}}",
+      "{\"type\":\"candidate\",\"candidate\":{\"sdp\":\"a\",\"sdpMLineIndex\":01}}",
+      "{\"type\":\"candidate\",\"candidate\":{\"sdp\":\"a\",\"sdpMLineIndex\":2147483648}}",
+      "{\"type\":\"candidate\",\"candidate\":{\"sdp\":\"a\",\"sdpMLineIndex\":-2147483649}}",
+      "{\"type\":\"candidate\",\"candidate\":{\"sdp\":\"a\",\"sdpMLineIndex\":\"0\"}}",
+      "{\"type\":\"candidate\",\"candidate\":{\"sdp\":\"a\",\"sdpMLineIndex\":0,\"sdpMid\":0}}",
+      "{\"type\":\"candidates\",\"candidates\":{}}",
+      "{\"type\":\"candidates\",\"candidates\":[{\"sdp\":\"a\",\"sdpMLineIndex\":0},]}",
+      "{\"type\":\"answer\",\"candidateBatches\":1}",
+      "{\"type\":\"answer\",\"dataFrames\":\"true\"}",
+      "{\"type\":\"answer\",\"x\":tru}",
+      "{\"type\":\"answer\",\"x\":-}",
+      "{\"type\":\"answer\",\"x\":1.}",
+      "{\"type\":\"answer\",\"x\":01}",
+      "{\"type\":\"answer\",\"x\":[1 2]}",
+  };
+  custom::SignalingParser parser;
+  custom::SignalingMessage message;
+  for (const char *json : kInvalid) {
+    if (parser.Parse(json, &message)) {
+      printf("  accepted %s\n", json);
+      CHECK(false);
+      continue;
+    }
+    CHECK(parser.error()[0] != '\0');
+    CHECK(parser.error_offset() <= strlen(json));
+  }
+
+  CHECK(!parser.Parse("{\"type\":\"offer\",\"sessionDescription\":{\"sdp\":\"\\q\"}}", &message));
+  CHECK_EQ(std::string(parser.error()), "bad escape");
+  CHECK_EQ(parser.error_offset(), 45u);
+
+  // Unknown values nest kMaxSignalingDepth deep inside the message.
+  auto nested = [](int depth) {
+    return "{\"type\":\"offer\",\"x\":" + std::string(depth, '[') + std::string(depth, ']') + "}";
+  };
+  CHECK(Parses(nested(custom::kMaxSignalingDepth)));
+  CHECK(!Parses(nested(custom::kMaxSignalingDepth + 1)));
+
+  auto candidates = [](size_t count) {
+    std::string json = "{\"type\":\"candidates\",\"candidates\":[";
+    for (size_t i = 0; i < count; ++i) {
+      json += (i ? "," : "") + std::string("{\"sdp\":\"a\",\"sdpMLineIndex\":0}");
+    }
+    return json + "]}";
+  };
+  CHECK(Parses(candidates(custom::kMaxSignalingCandidates)));
+  CHECK(!Parses(candidates(custom::kMaxSignalingCandidates + 1)));
+}
+
+void TestWrites() {
+  custom::SignalingWriter writer;
+  custom::SignalingMessage message;
+  message.type = SignalingMessageType::kCandidate;
+  message.has_candidate = true;
+  message.candidate.sdp = "candidate:1 1 udp 1 192.0.2.1 9 typ host";
+  message.candidate.sdp_mline_index = -3;
+  message.candidate.has_sdp_mid = true;
+  message.candidate.sdp_mid = "a/b";
+  CHECK_EQ(writer.Write(message), "{\"type\":\"candidate\",\"candidate\":{\"sdp\":\"candidate:1 1 udp 1 192.0.2.1 9 "
+                                  "typ host\",\"sdpMLineIndex\":-3,\"sdpMid\":\"a/b\"}}");
+
+  message = custom::SignalingMessage();
+  message.type = SignalingMessageType::kAnswer;
+  message.has_session_description = true;
+  const std::string sdp = "v=0\r\n\"q\"\\\b\f\t\x01\x1f\xC3\xA9";
+  message.sdp = sdp;
+  message.supports_candidate_batches = true;
+  CHECK_EQ(writer.Write(message), "{\"type\":\"answer\",\"sessionDescription\":{\"sdp\":\"v=0\\r\\n\\\"q\\\"\\\\\\b\\f"
+                                  "\\t\\u0001\\u001f\xC3\xA9\"},\"candidateBatches\":true}");
+  CHECK_EQ(writer.buffer(), writer.Write(message));
+  message.supports_candidate_batches = false;
+  message.supports_data_frames = true;
+  message.sdp = "v=0\r\n";
+  CHECK_EQ(writer.Write(message),
+           "{\"type\":\"answer\",\"sessionDescription\":{\"sdp\":\"v=0\\r\\n\"},\"dataFrames\":true}");
+
+  // A candidates message always has the array.
+  message = custom::SignalingMessage();
+  message.type = SignalingMessageType::kCandidates;
+  CHECK_EQ(writer.Write(message), "{\"type\":\"candidates\",\"candidates\":[]}");
+}
+
+uint32_t Next(uint32_t *state) {
+  *state = *state * 1664525u + 1013904223u;
+  return *state >> 8;
+}
+
+// What signaling_fuzz checks, on mutations of valid messages: every input
+// the parser accepts is written back, parsed to the same message and written
+// to the same bytes again.
+void TestRoundTripsMutations() {
+  const std::string seeds[] = {
+      kOffer,
+      kCandidate,
+      "{\"type\":\"candidates\",\"candidates\":[{\"sdp\":\"a\\u00e9\",\"sdpMLineIndex\":0},"
+      "{\"sdp\":\"b\",\"sdpMLineIndex\":12,\"sdpMid\":\"\\ud83d\\ude00\"}]}",
+      "{\"type\":\"unKnown\",\"x\":[{\"y\":null},-0.5e+2,\"\\t\"],\"candidateBatches\":false,\"dataFrames\":true}",
+  };
+  const char kBytes[] = "{}[]:,\"\\ -019.eE+tfnu\x01\x7f\xC3";
+  custom::SignalingParser parser;
+  custom::SignalingParser reparser;
+  custom::SignalingWriter writer;
+  custom::SignalingWriter rewriter;
+  uint32_t state = 1;
+  int accepted = 0;
+  for (int i = 0; i < 40000; ++i) {
+    std::string json = seeds[i % 4];
+    const int edits = 1 + Next(&state) % 3;
+    for (int e = 0; e < edits && !json.empty(); ++e) {
+      const size_t at = Next(&state) % json.size();
+      const char byte = kBytes[Next(&state) % (sizeof(kBytes) - 1)];
+      switch (Next(&state) % 3) {
+        case 0:
+          json[at] = byte;
+          break;
+        case 1:
+          json.insert(json.begin() + at, byte);
+          break;
+        default:
+          json.erase(at, 1);
+          break;
+      }
+    }
+    custom::SignalingMessage message;
+    if (!parser.Parse(json, &message)) {
+      CHECK(parser.error()[0] != '\0' && parser.error_offset() <= json.size());
+      continue;
+    }
+    accepted++;
+    const std::string written(writer.Write(message));
+    custom::SignalingMessage reparsed;
+    CHECK(reparser.Parse(written, &reparsed));
+    CHECK(SameMessage(message, reparsed));
+    CHECK_EQ(rewriter.Write(reparsed), written);
+  }
+  // Enough of them are still messages for the check to mean something.
+  CHECK(accepted > 4000);
+}
+
+// Once its scratch has grown to the largest frame, the parser doesn't
+// allocate, nor does the writer once its buffer has.
+void TestSteadyStateDoesNotAllocate() {
+  const std::string frames[] = {
+      kOffer,
+      kCandidate,
+      "{\"type\":\"candidates\",\"candidates\":[{\"sdp\":\"a\",\"sdpMLineIndex\":0},{\"sdp\":\"b\","
+      "\"sdpMLineIndex\":1}]}",
+  };
+  custom::SignalingParser parser;
+  custom::SignalingWriter writer;
+  custom::SignalingMessage message;
+  for (const std::string &frame : frames) {
+    CHECK(parser.Parse(frame, &message));
+    writer.Write(message);
+  }
+  const size_t before = allocations;
+  for (int i = 0; i < 100; ++i) {
+    for (const std::string &frame : frames) {
+      CHECK(parser.Parse(frame, &message));
+      writer.Write(message);
+    }
+  }
+  CHECK_EQ(allocations, before);
+}
+
+}  // namespace
+
+int main() {
+  TestParsesMessages();
+  TestUnescapes();
+  TestRejects();
+  TestWrites();
+  TestRoundTripsMutations();
+  TestSteadyStateDoesNotAllocate();
+  return TestExitCode();
+}
@@ -0,0 +1,128 @@
+//
+//  StageTraceTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "StageTrace.h"
+#include "TestCheck.h"
+
+namespace {
+
+void TestDisabledRecordsNothing() {
+  custom::StageTrace trace;
+  CHECK(!trace.enabled());
+  trace.Record(custom::TraceStage::kDraw, 1, 10, 20);
+  { custom::ScopedStage stage(trace, custom::TraceStage::kUpload, 1); }
+  CHECK(trace.Snapshot().empty());
+}
+
+void TestRecordsAndSortsByBegin() {
+  custom::StageTrace trace;
+  trace.set_enabled(true);
+  trace.Record(custom::TraceStage::kDraw, 7, 300, 400);
+  trace.Record(custom::TraceStage::kUpload, 7, 100, 250);
+  {
+    custom::ScopedStage stage(trace, custom::TraceStage::kConversion, 9);
+  }
+  const std::vector<custom::TraceEvent> events = trace.Snapshot();
+  CHECK_EQ(events.size(), 3u);
+  CHECK(events[0].stage == custom::TraceStage::kUpload);
+  CHECK_EQ(events[0].frame_ns, 7);
+  CHECK_EQ(events[0].end_ns, 250);
+  CHECK(events[1].stage == custom::TraceStage::kDraw);
+  CHECK(events[2].stage == custom::TraceStage::kConversion);
+  CHECK_EQ(events[2].frame_ns, 9);
+  CHECK(events[2].end_ns >= events[2].begin_ns);
+}
+
+// The ring keeps the newest events; 5 per thread rounds up to 8.
+void TestRingKeepsNewest() {
+  custom::StageTrace trace(5);
+  trace.set_enabled(true);
+  for (int i = 0; i < 20; ++i) {
+    trace.Record(custom::TraceStage::kQueue, i, i * 10, i * 10 + 5);
+  }
+  const std::vector<custom::TraceEvent> events = trace.Snapshot();
+  CHECK_EQ(events.size(), 8u);
+  CHECK_EQ(events.front().frame_ns, 12);
+  CHECK_EQ(events.back().frame_ns, 19);
+}
+
+// Every thread gets its own ring, up to kMaxThreads; the rest are counted.
+void TestThreadRings() {
+  custom::StageTrace trace(64);
+  trace.set_enabled(true);
+  const int kThreads = custom::StageTrace::kMaxThreads + 3;
+  for (int t = 0; t < kThreads; ++t) {
+    std::thread([&trace, t] {
+      for (int i = 0; i < 4; ++i) {
+        trace.Record(custom::TraceStage::kHandoff, t, t * 100 + i, t * 100 + i + 1);
+      }
+    }).join();
+  }
+  const std::vector<custom::TraceEvent> events = trace.Snapshot();
+  CHECK_EQ(events.size(), static_cast<size_t>(custom::StageTrace::kMaxThreads) * 4);
+  CHECK_EQ(trace.dropped_events(), 12u);
+  for (const custom::TraceEvent &event : events) {
+    CHECK_EQ(static_cast<int64_t>(event.thread), event.frame_ns);
+  }
+}
+
+// Snapshots taken while two threads record only ever see whole events.
+void TestConcurrentSnapshot() {
+  custom::StageTrace trace(16);
+  trace.set_enabled(true);
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 2; ++t) {
+    writers.emplace_back([&trace, &stop] {
+      for (int64_t i = 0; !stop.load(); ++i) {
+        trace.Record(custom::TraceStage::kReadback, i, i * 3, i * 3 + 1);
+      }
+    });
+  }
+  bool consistent = true;
+  for (int i = 0; i < 2000; ++i) {
+    for (const custom::TraceEvent &event : trace.Snapshot()) {
+      if (event.begin_ns != event.frame_ns * 3 || event.end_ns != event.begin_ns + 1 ||
+          event.stage != custom::TraceStage::kReadback) {
+        consistent = false;
+      }
+    }
+  }
+  stop = true;
+  for (std::thread &writer : writers) {
+    writer.join();
+  }
+  CHECK(consistent);
+}
+
+void TestChromeTrace() {
+  custom::StageTrace trace;
+  CHECK_EQ(trace.ExportChromeTrace(), std::string("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[]}"));
+  trace.set_enabled(true);
+  trace.Record(custom::TraceStage::kDraw, 42, 1500, 4000);
+  CHECK_EQ(trace.ExportChromeTrace(),
+           std::string("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[{\"name\":\"draw\",\"cat\":\"video\",\"ph\":\"X\","
+                       "\"pid\":1,\"tid\":1,\"ts\":1.500,\"dur\":2.500,\"args\":{\"frame_ns\":42}}]}"));
+}
+
+}  // namespace
+
+int main() {
+  TestDisabledRecordsNothing();
+  TestRecordsAndSortsByBegin();
+  TestRingKeepsNewest();
+  TestThreadRings();
+  TestConcurrentSnapshot();
+  TestChromeTrace();
+  return TestExitCode();
+}
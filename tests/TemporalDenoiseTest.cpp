@@ -0,0 +1,268 @@
+//
+//  TemporalDenoiseTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "FrameHistory.h"
+#include "TemporalDenoise.h"
+#include "TestCheck.h"
+#include "TestFrame.h"
+
+namespace {
+
+const custom::SimdPath kPaths[] = {custom::SimdPath::kScalar, custom::SimdPath::kSSE2, custom::SimdPath::kAVX2,
+                                   custom::SimdPath::kNEON};
+
+using custom_test::TestFrame;
+
+// Row padding of the frames, and what it holds; it must be left alone.
+const int kPadding = 7;
+const uint8_t kFill = 0xA5;
+
+// |base| plus noise of +-|noise| on every sample, clamped.
+void FillAround(TestFrame *frame, uint32_t seed, const TestFrame &base, int noise) {
+  uint32_t state = seed;
+  for (int plane = 0; plane < frame->plane_count(); ++plane) {
+    for (int y = 0; y < frame->rows(plane); ++y) {
+      for (int x = 0; x < frame->row_bytes(plane); ++x) {
+        state = state * 1664525u + 1013904223u;
+        const int value = base.At(plane, x, y) + static_cast<int>(state >> 24) % (2 * noise + 1) - noise;
+        frame->At(plane, x, y) = static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+      }
+    }
+  }
+}
+
+// The header's definition, one sample at a time.
+uint8_t Reference(int current, const int *history, int count, int threshold) {
+  int sum = current;
+  for (int i = 0; i < count; ++i) {
+    const int difference = history[i] > current ? history[i] - current : current - history[i];
+    sum += difference <= threshold ? history[i] : current;
+  }
+  // Rounded to nearest, halves up.
+  return static_cast<uint8_t>((2 * sum + count + 1) / (2 * (count + 1)));
+}
+
+bool MatchesReference(TestFrame &src, std::vector<TestFrame> &history, int count, int threshold, TestFrame &dst) {
+  for (int plane = 0; plane < src.plane_count(); ++plane) {
+    for (int y = 0; y < src.rows(plane); ++y) {
+      for (int x = 0; x < src.row_bytes(plane); ++x) {
+        int samples[custom::kMaxTemporalDenoiseFrames];
+        for (int i = 0; i < count; ++i) {
+          samples[i] = history[i].At(plane, x, y);
+        }
+        if (dst.At(plane, x, y) != Reference(src.At(plane, x, y), samples, count, threshold)) {
+          printf("  plane %d (%d, %d): %d, expected %d\n", plane, x, y, dst.At(plane, x, y),
+                 Reference(src.At(plane, x, y), samples, count, threshold));
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+std::vector<custom::Yuv420Image> Images(const std::vector<TestFrame> &frames) {
+  std::vector<custom::Yuv420Image> images;
+  for (const TestFrame &frame : frames) {
+    images.push_back(frame.image);
+  }
+  return images;
+}
+
+// Every path matches the reference for every history length, odd sizes and
+// both layouts included, and leaves the padding alone.
+void TestMatchesReference() {
+  const int kSizes[][2] = {{2, 2}, {1, 1}, {33, 17}, {64, 48}, {130, 7}};
+  const uint8_t kThresholds[] = {0, 10, 255};
+  for (uint32_t format : {custom::kFourccNV12VideoRange, custom::kFourccI420}) {
+    for (const auto &size : kSizes) {
+      TestFrame src(format, size[0], size[1], kPadding, kFill);
+      src.FillRandom(size[0]);
+      std::vector<TestFrame> history;
+      for (int i = 0; i < custom::kMaxTemporalDenoiseFrames; ++i) {
+        history.emplace_back(format, size[0], size[1], kPadding, kFill);
+        // Mostly within the middle threshold of |src|, with some motion.
+        FillAround(&history.back(), 100 + i, src, 14);
+      }
+      const std::vector<custom::Yuv420Image> images = Images(history);
+      for (int count = 0; count <= custom::kMaxTemporalDenoiseFrames; ++count) {
+        for (uint8_t threshold : kThresholds) {
+          TestFrame scalar(format, size[0], size[1], kPadding, kFill);
+          CHECK(custom::ApplyTemporalDenoise(src.image, images.data(), count, threshold, scalar.image,
+                                             custom::SimdPath::kScalar));
+          CHECK(MatchesReference(src, history, count, threshold, scalar));
+          for (custom::SimdPath path : kPaths) {
+            if (!custom::IsSimdPathSupported(path)) {
+              continue;
+            }
+            TestFrame out(format, size[0], size[1], kPadding, kFill);
+            CHECK(custom::ApplyTemporalDenoise(src.image, images.data(), count, threshold, out.image, path));
+            if (!(out == scalar)) {
+              printf("  %s differs from scalar, %dx%d K=%d threshold %d\n", custom::SimdPathName(path), size[0],
+                     size[1], count, threshold);
+              CHECK(false);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// Denoising in place gives what denoising into another image does.
+void TestInPlace() {
+  for (uint32_t format : {custom::kFourccNV12VideoRange, custom::kFourccI420}) {
+    TestFrame src(format, 67, 35, kPadding, kFill);
+    src.FillRandom(3);
+    std::vector<TestFrame> history;
+    for (int i = 0; i < 4; ++i) {
+      history.emplace_back(format, 67, 35, kPadding, kFill);
+      FillAround(&history.back(), 20 + i, src, 8);
+    }
+    const std::vector<custom::Yuv420Image> images = Images(history);
+    for (custom::SimdPath path : kPaths) {
+      if (!custom::IsSimdPathSupported(path)) {
+        continue;
+      }
+      TestFrame expected(format, 67, 35, kPadding, kFill);
+      CHECK(custom::ApplyTemporalDenoise(src.image, images.data(), 4, 6, expected.image, path));
+      TestFrame in_place = src;
+      CHECK(custom::ApplyTemporalDenoise(in_place.image, images.data(), 4, 6, in_place.image, path));
+      CHECK(in_place == expected);
+    }
+  }
+}
+
+// Averaging frames of static content with independent noise reduces it.
+void TestReducesNoise() {
+  TestFrame clean(custom::kFourccNV12VideoRange, 64, 48, kPadding, kFill);
+  clean.FillRandom(1);
+  std::vector<TestFrame> noisy;
+  for (int i = 0; i < 5; ++i) {
+    noisy.emplace_back(custom::kFourccNV12VideoRange, 64, 48, kPadding, kFill);
+    FillAround(&noisy.back(), 50 + i, clean, 6);
+  }
+  const std::vector<custom::Yuv420Image> images = Images(noisy);
+  TestFrame out(custom::kFourccNV12VideoRange, 64, 48, kPadding, kFill);
+  CHECK(custom::ApplyTemporalDenoise(noisy[4].image, images.data(), 4, 12, out.image));
+  int64_t before = 0;
+  int64_t after = 0;
+  for (int y = 0; y < 48; ++y) {
+    for (int x = 0; x < 64; ++x) {
+      const int clean_sample = clean.At(0, x, y);
+      before += (noisy[4].At(0, x, y) - clean_sample) * (noisy[4].At(0, x, y) - clean_sample);
+      after += (out.At(0, x, y) - clean_sample) * (out.At(0, x, y) - clean_sample);
+    }
+  }
+  CHECK(after * 2 < before);
+}
+
+void TestRejectsInvalidArguments() {
+  TestFrame src(custom::kFourccNV12VideoRange, 16, 16, kPadding, kFill);
+  TestFrame dst(custom::kFourccNV12VideoRange, 16, 16, kPadding, kFill);
+  TestFrame other_size(custom::kFourccNV12VideoRange, 16, 18, kPadding, kFill);
+  TestFrame other_format(custom::kFourccI420, 16, 16, kPadding, kFill);
+  std::vector<custom::Yuv420Image> history(custom::kMaxTemporalDenoiseFrames + 1, src.image);
+  CHECK(!custom::ApplyTemporalDenoise(src.image, history.data(), -1, 4, dst.image));
+  CHECK(!custom::ApplyTemporalDenoise(src.image, history.data(), custom::kMaxTemporalDenoiseFrames + 1, 4, dst.image));
+  CHECK(!custom::ApplyTemporalDenoise(src.image, nullptr, 1, 4, dst.image));
+  CHECK(custom::ApplyTemporalDenoise(src.image, nullptr, 0, 4, dst.image));
+  CHECK(!custom::ApplyTemporalDenoise(src.image, history.data(), 1, 4, other_size.image));
+  CHECK(!custom::ApplyTemporalDenoise(src.image, history.data(), 1, 4, other_format.image));
+  history[1] = other_size.image;
+  CHECK(!custom::ApplyTemporalDenoise(src.image, history.data(), 2, 4, dst.image));
+  CHECK(custom::ApplyTemporalDenoise(src.image, history.data(), 1, 4, dst.image));
+  custom::Yuv420Image missing_plane = src.image;
+  missing_plane.planes[1] = nullptr;
+  CHECK(!custom::ApplyTemporalDenoise(missing_plane, history.data(), 1, 4, dst.image));
+  for (custom::SimdPath path : kPaths) {
+    CHECK_EQ(custom::ApplyTemporalDenoise(src.image, history.data(), 1, 4, dst.image, path),
+             custom::IsSimdPathSupported(path));
+  }
+}
+
+struct Counted {
+  explicit Counted(int *alive) : alive(alive) { ++*alive; }
+  ~Counted() { --*alive; }
+  int *alive;
+};
+
+void TestFrameHistory() {
+  CHECK_EQ(custom::FrameHistory<int>(0).capacity(), 1u);
+  CHECK_EQ(custom::FrameHistory<int>(20).capacity(), custom::FrameHistory<int>::kMaxCapacity);
+
+  custom::FrameHistory<int> history(3);
+  CHECK(!history.At(0));
+  CHECK(!history.Nearest(0, 1000));
+  history.Push(10, nullptr);
+  CHECK_EQ(history.size(), 0u);
+  for (int i = 1; i <= 5; ++i) {
+    history.Push(i * 100, std::make_shared<int>(i));
+  }
+  // 3, 4 and 5 are left.
+  CHECK_EQ(history.size(), 3u);
+  int64_t timestamp = 0;
+  CHECK_EQ(*history.At(0, &timestamp), 5);
+  CHECK_EQ(timestamp, 500);
+  CHECK_EQ(*history.At(2, &timestamp), 3);
+  CHECK_EQ(timestamp, 300);
+  CHECK(!history.At(3));
+
+  int64_t found = 0;
+  CHECK_EQ(*history.Nearest(420, 50, &found), 4);
+  CHECK_EQ(found, 400);
+  CHECK(!history.Nearest(200, 50));
+  CHECK_EQ(*history.Nearest(250, 50), 3);
+  // Equally close to 400 and 500: the newer one.
+  CHECK_EQ(*history.Nearest(450, 50), 5);
+
+  history.Clear();
+  CHECK_EQ(history.size(), 0u);
+  CHECK(!history.At(0));
+  history.Push(600, std::make_shared<int>(6));
+  CHECK_EQ(*history.At(0), 6);
+  CHECK(!history.At(1));
+}
+
+// The history holds one reference; a borrowed frame outlives its slot, and
+// an evicted frame that isn't borrowed is released.
+void TestFrameHistoryReleasesFrames() {
+  int alive = 0;
+  {
+    custom::FrameHistory<Counted> history(2);
+    history.Push(0, std::make_shared<Counted>(&alive));
+    std::shared_ptr<Counted> borrowed = history.At(0);
+    history.Push(1, std::make_shared<Counted>(&alive));
+    history.Push(2, std::make_shared<Counted>(&alive));
+    CHECK_EQ(alive, 3);
+    CHECK_EQ(borrowed.use_count(), 1);
+    borrowed.reset();
+    CHECK_EQ(alive, 2);
+    history.Push(3, std::make_shared<Counted>(&alive));
+    CHECK_EQ(alive, 2);
+    history.Clear();
+    CHECK_EQ(alive, 0);
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestMatchesReference();
+  TestInPlace();
+  TestReducesNoise();
+  TestRejectsInvalidArguments();
+  TestFrameHistory();
+  TestFrameHistoryReleasesFrames();
+  return TestExitCode();
+}
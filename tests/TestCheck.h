@@ -0,0 +1,49 @@
+//
+//  TestCheck.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+#ifndef TestCheck_h
+#define TestCheck_h
+
+// Checks for the host tests under ctest. A failed check prints where it failed
+// and the test goes on; TestExitCode() fails the process at the end.
+//
+//   int main() {
+//     TestSomething();
+//     return TestExitCode();
+//   }
+
+#include <cstdio>
+
+namespace custom_test {
+
+inline int failures = 0;
+
+inline void Fail(const char *file, int line, const char *what) {
+  fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+  failures++;
+}
+
+}  // namespace custom_test
+
+#define CHECK(condition)                               \
+  do {                                                 \
+    if (!(condition)) {                                \
+      custom_test::Fail(__FILE__, __LINE__, #condition); \
+    }                                                  \
+  } while (0)
+
+#define CHECK_EQ(a, b) CHECK((a) == (b))
+
+inline int TestExitCode() {
+  if (custom_test::failures > 0) {
+    fprintf(stderr, "%d checks failed\n", custom_test::failures);
+    return 1;
+  }
+  return 0;
+}
+
+#endif /* TestCheck_h */
@@ -0,0 +1,153 @@
+//
+//  TestFrame.h
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/14.
+//
+
+#ifndef TestFrame_h
+#define TestFrame_h
+
+// A frame with its own storage for the host tests, NV12 (either range), I420
+// or BGRA. Every row is followed by |padding| bytes. The padding starts out as
+// |fill|, like the samples, and the code under test must leave it alone.
+//
+//   custom_test::TestFrame frame(custom::kFourccI420, 33, 17);
+//   frame.FillRandom(1);
+//   Filter(frame.image);
+//   CHECK(frame.PaddingIntact());
+
+#include <cstdint>
+#include <vector>
+
+#include "ColorConvert.h"
+#include "FrameFormat.h"
+#include "YuvFilter.h"
+
+namespace custom_test {
+
+struct TestFrame {
+  std::vector<uint8_t> storage[custom::kMaxPlanes];
+  // Points into |storage|.
+  custom::Yuv420Image image;
+  int padding = 0;
+  uint8_t fill = 0;
+
+  TestFrame(uint32_t format, int width, int height, int padding = 8, uint8_t fill = 0)
+      : padding(padding), fill(fill) {
+    image.format = format;
+    image.width = width;
+    image.height = height;
+    for (int plane = 0; plane < plane_count(); ++plane) {
+      image.strides[plane] = row_bytes(plane) + padding;
+      storage[plane].assign(static_cast<size_t>(image.strides[plane]) * rows(plane), fill);
+    }
+    PointAtStorage();
+  }
+
+  TestFrame(const TestFrame &other)
+      : image(other.image), padding(other.padding), fill(other.fill) {
+    for (int plane = 0; plane < custom::kMaxPlanes; ++plane) {
+      storage[plane] = other.storage[plane];
+    }
+    PointAtStorage();
+  }
+
+  TestFrame &operator=(const TestFrame &other) {
+    for (int plane = 0; plane < custom::kMaxPlanes; ++plane) {
+      storage[plane] = other.storage[plane];
+    }
+    image = other.image;
+    padding = other.padding;
+    fill = other.fill;
+    PointAtStorage();
+    return *this;
+  }
+
+  int plane_count() const {
+    switch (image.format) {
+      case custom::kFourccI420:
+        return 3;
+      case custom::kFourccBGRA:
+        return 1;
+      default:
+        return 2;
+    }
+  }
+  // Bytes of samples in a row of |plane|, without the padding.
+  int row_bytes(int plane) const {
+    const int chroma_width = (image.width + 1) / 2;
+    if (image.format == custom::kFourccBGRA) {
+      return image.width * 4;
+    }
+    return plane == 0 ? image.width : (plane_count() == 2 ? 2 * chroma_width : chroma_width);
+  }
+  int rows(int plane) const { return plane == 0 ? image.height : (image.height + 1) / 2; }
+
+  uint8_t &At(int plane, int x, int y) { return storage[plane][static_cast<size_t>(y) * image.strides[plane] + x]; }
+  uint8_t At(int plane, int x, int y) const {
+    return storage[plane][static_cast<size_t>(y) * image.strides[plane] + x];
+  }
+
+  // Random samples; the padding keeps |fill|.
+  void FillRandom(uint32_t seed) {
+    uint32_t state = seed;
+    for (int plane = 0; plane < plane_count(); ++plane) {
+      for (int y = 0; y < rows(plane); ++y) {
+        for (int x = 0; x < row_bytes(plane); ++x) {
+          state = state * 1664525u + 1013904223u;
+          At(plane, x, y) = static_cast<uint8_t>(state >> 24);
+        }
+      }
+    }
+  }
+
+  // Whether every padding byte still holds |fill|.
+  bool PaddingIntact() const {
+    for (int plane = 0; plane < plane_count(); ++plane) {
+      for (int y = 0; y < rows(plane); ++y) {
+        for (int x = row_bytes(plane); x < image.strides[plane]; ++x) {
+          if (At(plane, x, y) != fill) {
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  // The same planes as a custom::ColorImage of |layout|, e.g. NV21 for an NV12
+  // frame.
+  custom::ColorImage Color(custom::PixelLayout layout) const {
+    custom::ColorImage color;
+    color.layout = layout;
+    color.width = image.width;
+    color.height = image.height;
+    for (int plane = 0; plane < custom::kMaxPlanes; ++plane) {
+      color.planes[plane] = image.planes[plane];
+      color.strides[plane] = image.strides[plane];
+    }
+    return color;
+  }
+
+  // Same bytes, padding included.
+  bool operator==(const TestFrame &other) const {
+    for (int plane = 0; plane < custom::kMaxPlanes; ++plane) {
+      if (storage[plane] != other.storage[plane]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  void PointAtStorage() {
+    for (int plane = 0; plane < custom::kMaxPlanes; ++plane) {
+      image.planes[plane] = storage[plane].empty() ? nullptr : storage[plane].data();
+    }
+  }
+};
+
+}  // namespace custom_test
+
+#endif /* TestFrame_h */
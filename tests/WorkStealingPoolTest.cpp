@@ -0,0 +1,143 @@
+//
+//  WorkStealingPoolTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "RotateConvert.h"
+#include "TestCheck.h"
+#include "WorkStealingPool.h"
+
+namespace {
+
+void TestRunsEveryTaskOnce() {
+  for (int threads : {1, 2, 4}) {
+    custom::WorkStealingPool pool(threads);
+    CHECK_EQ(pool.thread_count(), threads);
+    for (int count : {0, 1, 7, 500}) {
+      std::vector<std::atomic<int>> runs(count);
+      for (auto &run : runs) {
+        run = 0;
+      }
+      pool.ParallelFor(count, [&](int i) { runs[i]++; });
+      for (int i = 0; i < count; ++i) {
+        CHECK_EQ(runs[i].load(), 1);
+      }
+    }
+    CHECK_EQ(pool.stats().tasks, 508u);
+  }
+}
+
+// Tasks dealt to a thread that is busy get stolen by the others.
+void TestStealsFromASlowThread() {
+  custom::WorkStealingPool pool(4);
+  std::atomic<int> done{0};
+  for (int job = 0; job < 20; ++job) {
+    pool.ParallelFor(64, [&](int i) {
+      if (i == 0) {
+        volatile uint64_t spin = 0;
+        for (int k = 0; k < 2000000; ++k) {
+          spin = spin + k;
+        }
+      }
+      done++;
+    });
+  }
+  CHECK_EQ(done.load(), 20 * 64);
+  CHECK_EQ(pool.stats().jobs, 20u);
+  CHECK(pool.stats().steals > 0);
+}
+
+// Bands cover every row once, in whole row pairs and at least the minimum
+// height, except for the last one.
+void TestRowBands() {
+  custom::WorkStealingPool pool(3);
+  for (int height : {1, 2, 31, 64, 720, 1081}) {
+    std::vector<std::atomic<int>> rows(height);
+    for (auto &row : rows) {
+      row = 0;
+    }
+    std::atomic<int> bands{0};
+    std::atomic<bool> aligned{true};
+    custom::ForEachRowBand(&pool, height, 2, 32, [&](int first_row, int end_row) {
+      bands++;
+      if (first_row % 2 != 0 || (end_row != height && end_row - first_row < 32)) {
+        aligned = false;
+      }
+      for (int y = first_row; y < end_row; ++y) {
+        rows[y]++;
+      }
+    });
+    CHECK(aligned.load());
+    CHECK(bands.load() >= 1);
+    CHECK(height > 64 || bands.load() <= 2);
+    for (int y = 0; y < height; ++y) {
+      CHECK_EQ(rows[y].load(), 1);
+    }
+  }
+
+  int calls = 0;
+  custom::ForEachRowBand(nullptr, 1080, 2, 32, [&](int first_row, int end_row) {
+    calls++;
+    CHECK_EQ(first_row, 0);
+    CHECK_EQ(end_row, 1080);
+  });
+  CHECK_EQ(calls, 1);
+}
+
+// CustomPixelBufferUtils converts each band with its own call, the planes
+// offset to the band's first row; the result must match one call over the frame.
+void TestBandedConversionMatchesWholeFrame() {
+  const int kSizes[][2] = {{1280, 720}, {642, 363}, {64, 33}};
+  for (const auto &size : kSizes) {
+    const int width = size[0];
+    const int height = size[1];
+    const int src_stride = width * 4 + 32;
+    const int stride_y = width + 64;
+    const int stride_uv = (width + 1) / 2 * 2 + 64;
+    const int chroma_height = (height + 1) / 2;
+    std::vector<uint8_t> bgra(static_cast<size_t>(src_stride) * height);
+    uint32_t state = 7;
+    for (uint8_t &value : bgra) {
+      state = state * 1664525u + 1013904223u;
+      value = static_cast<uint8_t>(state >> 24);
+    }
+    std::vector<uint8_t> whole_y(static_cast<size_t>(stride_y) * height);
+    std::vector<uint8_t> whole_uv(static_cast<size_t>(stride_uv) * chroma_height);
+    CHECK(custom::BGRAToNV12Rotated(bgra.data(), src_stride, width, height, whole_y.data(), stride_y,
+                                    whole_uv.data(), stride_uv, custom::Rotation::k0));
+
+    for (int threads : {1, 2, 4}) {
+      custom::WorkStealingPool pool(threads);
+      std::vector<uint8_t> banded_y(whole_y.size());
+      std::vector<uint8_t> banded_uv(whole_uv.size());
+      std::atomic<bool> ok{true};
+      custom::ForEachRowBand(&pool, height, 2, 32, [&](int first_row, int end_row) {
+        ok = custom::BGRAToNV12Rotated(bgra.data() + static_cast<size_t>(first_row) * src_stride, src_stride, width,
+                                       end_row - first_row,
+                                       banded_y.data() + static_cast<size_t>(first_row) * stride_y, stride_y,
+                                       banded_uv.data() + static_cast<size_t>(first_row / 2) * stride_uv, stride_uv,
+                                       custom::Rotation::k0) &&
+             ok;
+      });
+      CHECK(ok.load());
+      CHECK(banded_y == whole_y);
+      CHECK(banded_uv == whole_uv);
+    }
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestRunsEveryTaskOnce();
+  TestStealsFromASlowThread();
+  TestRowBands();
+  TestBandedConversionMatchesWholeFrame();
+  return TestExitCode();
+}
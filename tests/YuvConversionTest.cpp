@@ -0,0 +1,121 @@
+//
+//  YuvConversionTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+#include <cmath>
+#include <initializer_list>
+
+#include "TestCheck.h"
+#include "YuvConversion.h"
+
+namespace {
+
+bool Equal(const custom::RgbToYuvCoefficients &c, const int expected[11]) {
+  const int actual[11] = {c.yr, c.yg, c.yb, c.ur, c.ug, c.ub, c.vr, c.vg, c.vb, c.y_offset, c.uv_offset};
+  for (int i = 0; i < 11; ++i) {
+    if (actual[i] != expected[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Equal(const custom::YuvToRgbCoefficients &c, const int expected[6]) {
+  const int actual[6] = {c.y_scale, c.vr, c.ug, c.vg, c.ub, c.y_offset};
+  for (int i = 0; i < 6; ++i) {
+    if (actual[i] != expected[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The tables every kernel and shader derives from.
+void TestCoefficientsArePinned() {
+  using custom::YuvMatrix;
+  using custom::YuvRange;
+  const struct {
+    YuvMatrix matrix;
+    YuvRange range;
+    int to_yuv[11];
+    int to_rgb[6];
+  } kTables[] = {
+      {YuvMatrix::kBT601, YuvRange::kVideo, {66, 129, 25, -38, -74, 112, 112, -94, -18, 16, 128},
+       {4769, 6537, 1605, 3330, 8263, 16}},
+      {YuvMatrix::kBT601, YuvRange::kFull, {77, 150, 29, -43, -85, 128, 128, -107, -21, 0, 128},
+       {4096, 5743, 1410, 2925, 7258, 0}},
+      {YuvMatrix::kBT709, YuvRange::kVideo, {47, 157, 16, -26, -86, 112, 112, -102, -10, 16, 128},
+       {4769, 7343, 873, 2183, 8652, 16}},
+      {YuvMatrix::kBT709, YuvRange::kFull, {54, 184, 18, -29, -99, 128, 128, -116, -12, 0, 128},
+       {4096, 6450, 767, 1917, 7601, 0}},
+      {YuvMatrix::kBT2020, YuvRange::kVideo, {58, 149, 13, -31, -81, 112, 112, -103, -9, 16, 128},
+       {4769, 6876, 767, 2664, 8773, 16}},
+      {YuvMatrix::kBT2020, YuvRange::kFull, {67, 174, 15, -36, -92, 128, 128, -118, -10, 0, 128},
+       {4096, 6040, 674, 2340, 7706, 0}},
+  };
+  for (const auto &table : kTables) {
+    CHECK(Equal(custom::RgbToYuvCoefficientsFor(table.matrix, table.range), table.to_yuv));
+    CHECK(Equal(custom::YuvToRgbCoefficientsFor(table.matrix, table.range), table.to_rgb));
+  }
+}
+
+// What a shader stores: the float dot product plus offset, rounded to 8 bits.
+int ShaderStore(const float coefficients[3], float offset, int r, int g, int b) {
+  const float value = coefficients[0] * (r / 255.0f) + coefficients[1] * (g / 255.0f) +
+                      coefficients[2] * (b / 255.0f) + offset;
+  return static_cast<int>(std::floor(value * 255.0f + 0.5f));
+}
+
+// Every 8 bit RGB value gives the CPU kernels' result through the shader form.
+void TestShaderMatrixMatchesFixedPoint() {
+  const custom::RgbToYuvCoefficients &c = custom::kBT601VideoRange;
+  const custom::ShaderYuvMatrix m = custom::MakeShaderYuvMatrix(c);
+  long mismatches = 0;
+  for (int r = 0; r < 256; ++r) {
+    for (int g = 0; g < 256; ++g) {
+      for (int b = 0; b < 256; ++b) {
+        mismatches += ShaderStore(m.y, m.offset[0], r, g, b) != custom::RgbToY(c, r, g, b);
+        mismatches += ShaderStore(m.u, m.offset[1], r, g, b) != custom::RgbToU(c, r, g, b);
+        mismatches += ShaderStore(m.v, m.offset[2], r, g, b) != custom::RgbToV(c, r, g, b);
+      }
+    }
+  }
+  CHECK_EQ(mismatches, 0);
+}
+
+void TestChromaTaps() {
+  for (custom::ChromaSiting siting : {custom::ChromaSiting::kCenter, custom::ChromaSiting::kLeft}) {
+    custom::ChromaTap taps[custom::kChromaTapCount];
+    custom::ComputeChromaTaps(siting, taps);
+    float weight = 0;
+    float x = 0;
+    float y = 0;
+    for (const custom::ChromaTap &tap : taps) {
+      weight += tap.weight;
+      x += tap.x * tap.weight;
+      y += tap.y * tap.weight;
+    }
+    CHECK(std::fabs(weight - 1) < 1e-6f);
+    // Vertically centred between the two rows; horizontally on the centre or
+    // the left column.
+    CHECK(std::fabs(y) < 1e-6f);
+    CHECK(std::fabs(x - (siting == custom::ChromaSiting::kCenter ? 0.0f : -0.5f)) < 1e-6f);
+  }
+  custom::ChromaTap taps[custom::kChromaTapCount];
+  custom::ComputeChromaTaps(custom::ChromaSiting::kCenter, taps);
+  for (const custom::ChromaTap &tap : taps) {
+    CHECK(tap.weight == 0.25f && std::fabs(tap.x) == 0.5f && std::fabs(tap.y) == 0.5f);
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestCoefficientsArePinned();
+  TestShaderMatrixMatchesFixedPoint();
+  TestChromaTaps();
+  return TestExitCode();
+}
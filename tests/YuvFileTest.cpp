@@ -0,0 +1,295 @@
+//
+//  YuvFileTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/8.
+//
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "TestCheck.h"
+#include "TestFrame.h"
+#include "YuvFile.h"
+
+namespace {
+
+// A 4:2:0 frame of random samples. The writer must not write the padding.
+custom_test::TestFrame RandomFrame(uint32_t format, int width, int height, uint32_t seed) {
+  custom_test::TestFrame frame(format, width, height, 5);
+  frame.FillRandom(seed);
+  return frame;
+}
+
+// |plane| of |image| with packed rows; for NV12, plane 1 is U and plane 2 V.
+std::vector<uint8_t> PackedPlane(const custom::Yuv420Image &image, int plane) {
+  const bool nv12 = image.format != custom::kFourccI420;
+  const int width = plane == 0 ? image.width : (image.width + 1) / 2;
+  const int height = plane == 0 ? image.height : (image.height + 1) / 2;
+  std::vector<uint8_t> packed;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      if (plane > 0 && nv12) {
+        packed.push_back(image.planes[1][static_cast<size_t>(y) * image.strides[1] + 2 * x + plane - 1]);
+      } else {
+        packed.push_back(image.planes[plane][static_cast<size_t>(y) * image.strides[plane] + x]);
+      }
+    }
+  }
+  return packed;
+}
+
+// Whether |a| and |b| hold the same samples, whatever their layouts.
+bool SameSamples(const custom::Yuv420Image &a, const custom::Yuv420Image &b) {
+  if (a.width != b.width || a.height != b.height) {
+    return false;
+  }
+  for (int plane = 0; plane < 3; ++plane) {
+    if (PackedPlane(a, plane) != PackedPlane(b, plane)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string ReadFile(const std::string &path) {
+  std::string contents;
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return contents;
+  }
+  char buffer[4096];
+  size_t read = 0;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    contents.append(buffer, read);
+  }
+  fclose(file);
+  return contents;
+}
+
+void WriteFile(const std::string &path, const std::string &contents) {
+  FILE *file = fopen(path.c_str(), "wb");
+  fwrite(contents.data(), 1, contents.size(), file);
+  fclose(file);
+}
+
+custom::YuvFileInfo Info(uint32_t format, int width, int height) {
+  custom::YuvFileInfo info;
+  info.format = format;
+  info.width = width;
+  info.height = height;
+  return info;
+}
+
+void TestFrameSize() {
+  CHECK_EQ(custom::YuvFileFrameSize(Info(custom::kFourccI420, 64, 48)), 64u * 48 * 3 / 2);
+  CHECK_EQ(custom::YuvFileFrameSize(Info(custom::kFourccNV12VideoRange, 33, 17)), 33u * 17 + 2 * 17 * 9);
+  CHECK_EQ(custom::YuvFileFrameSize(Info(custom::kFourccNV12FullRange, 1, 1)), 3u);
+  CHECK_EQ(custom::YuvFileFrameSize(Info(custom::kFourccBGRA, 64, 48)), 0u);
+  CHECK_EQ(custom::YuvFileFrameSize(Info(custom::kFourccI420, 0, 48)), 0u);
+
+  CHECK(custom::IsY4MPath("clip.y4m"));
+  CHECK(custom::IsY4MPath(".y4m"));
+  CHECK(!custom::IsY4MPath("clip.yuv"));
+  CHECK(!custom::IsY4MPath("y4m"));
+  CHECK(!custom::IsY4MPath("clip.y4m.yuv"));
+}
+
+// Frames written and read back have the same samples, for every combination
+// of source layout and file type, odd sizes included, and through buffers
+// small enough to flush mid frame.
+void TestRoundTrip() {
+  const std::string kPaths[] = {"YuvFileTest.y4m", "YuvFileTest.yuv"};
+  const uint32_t kFormats[] = {custom::kFourccI420, custom::kFourccNV12VideoRange};
+  const int kSizes[][2] = {{64, 48}, {33, 17}, {1, 1}};
+  const size_t kBufferBytes[] = {1, 8 << 20};
+  for (const std::string &path : kPaths) {
+    for (uint32_t format : kFormats) {
+      for (const auto &size : kSizes) {
+        for (size_t buffer_bytes : kBufferBytes) {
+          for (bool direct_io : {false, true}) {
+            std::vector<custom_test::TestFrame> frames;
+            for (int i = 0; i < 3; ++i) {
+              frames.push_back(RandomFrame(format, size[0], size[1], i + 1));
+            }
+            custom::YuvFileInfo info = Info(format, size[0], size[1]);
+            info.fps_num = 25;
+            custom::YuvFileWriterConfig config;
+            config.buffer_bytes = buffer_bytes;
+            config.direct_io = direct_io;
+            custom::YuvFileWriter writer;
+            std::string error;
+            CHECK(writer.Open(path, info, config, &error));
+            for (const custom_test::TestFrame &frame : frames) {
+              CHECK(writer.WriteFrame(frame.image));
+            }
+            CHECK(writer.Close());
+
+            const bool y4m = custom::IsY4MPath(path);
+            const size_t frame_size = custom::YuvFileFrameSize(info);
+            const std::string contents = ReadFile(path);
+            CHECK_EQ(writer.bytes_written(), contents.size());
+            if (!y4m) {
+              CHECK_EQ(contents.size(), 3 * frame_size);
+            }
+
+            custom::YuvFileReader reader;
+            CHECK(reader.Open(path, info, &error));
+            CHECK_EQ(reader.frame_count(), 3);
+            CHECK_EQ(reader.info().width, size[0]);
+            CHECK_EQ(reader.info().height, size[1]);
+            CHECK_EQ(reader.info().format, y4m ? custom::kFourccI420 : format);
+            CHECK_EQ(reader.info().frame_size, frame_size);
+            if (y4m) {
+              CHECK_EQ(reader.info().fps_num, 25);
+              CHECK_EQ(reader.info().fps_den, 1);
+            }
+            custom::YuvFrameView view;
+            for (int i = 0; i < 3; ++i) {
+              CHECK(reader.Next(&view));
+              CHECK_EQ(view.index, i);
+              CHECK(SameSamples(view.image, frames[i].image));
+            }
+            CHECK(!reader.Next(&view));
+          }
+        }
+      }
+    }
+  }
+  remove("YuvFileTest.y4m");
+  remove("YuvFileTest.yuv");
+}
+
+void TestY4MHeader() {
+  const std::string path = "YuvFileTest.y4m";
+  custom::YuvFileWriter writer;
+  custom::YuvFileInfo info = Info(custom::kFourccNV12FullRange, 4, 2);
+  info.fps_num = 30000;
+  info.fps_den = 1001;
+  CHECK(writer.Open(path, info, custom::YuvFileWriterConfig(), nullptr));
+  CHECK(writer.Close());
+  CHECK_EQ(ReadFile(path), std::string("YUV4MPEG2 W4 H2 F30000:1001 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n"));
+
+  // Frame headers with parameters, and a truncated last frame, which is
+  // ignored.
+  const std::string frame(custom::YuvFileFrameSize(Info(custom::kFourccI420, 4, 2)), 'x');
+  WriteFile(path, "YUV4MPEG2 H2 W4 C420mpeg2 F24:1\nFRAME\n" + frame + "FRAME Ixyz\n" + frame + "FRAME\n" +
+                      frame.substr(1));
+  custom::YuvFileReader reader;
+  std::string error;
+  CHECK(reader.Open(path, custom::YuvFileInfo(), &error));
+  CHECK_EQ(reader.frame_count(), 2);
+  CHECK_EQ(reader.info().fps_num, 24);
+  custom::YuvFrameView view;
+  CHECK(reader.Frame(1, &view));
+  CHECK_EQ(std::string(reinterpret_cast<const char *>(view.image.planes[0]), frame.size()), frame);
+
+  const char *kInvalid[] = {
+      "YUV4MPEG2 W4 H2 C420p10\nFRAME\n",
+      "YUV4MPEG2 W4 H2 C444\nFRAME\n",
+      "YUV4MPEG2 W4 H2 F0:1\nFRAME\n",
+      "YUV4MPEG2 W4\nFRAME\n",
+      "YUV4MPEG W4 H2\nFRAME\n",
+  };
+  for (const char *contents : kInvalid) {
+    WriteFile(path, contents);
+    error.clear();
+    CHECK(!reader.Open(path, custom::YuvFileInfo(), &error));
+    CHECK(!error.empty());
+    CHECK_EQ(reader.frame_count(), 0);
+  }
+  // No newline within the line limit.
+  WriteFile(path, "YUV4MPEG2 W4 H2" + std::string(5000, ' '));
+  CHECK(!reader.Open(path, custom::YuvFileInfo(), nullptr));
+  remove(path.c_str());
+}
+
+// Frames are views of a private mapping: seeking works in any order, and
+// writing to a frame never reaches the file.
+void TestViews() {
+  const std::string path = "YuvFileTest.yuv";
+  const custom::YuvFileInfo info = Info(custom::kFourccNV12VideoRange, 6, 4);
+  std::string contents;
+  for (int i = 0; i < 4; ++i) {
+    contents += std::string(custom::YuvFileFrameSize(info), static_cast<char>('a' + i));
+  }
+  // A truncated fifth frame.
+  WriteFile(path, contents + "zz");
+
+  custom::YuvFileReader reader;
+  CHECK(reader.Open(path, info, nullptr));
+  CHECK_EQ(reader.frame_count(), 4);
+  custom::YuvFrameView view;
+  CHECK(reader.Frame(2, &view));
+  CHECK_EQ(view.image.planes[0][0], 'c');
+  CHECK_EQ(view.image.planes[1], view.image.planes[0] + 6 * 4);
+  CHECK(!view.image.planes[2]);
+  CHECK(!reader.Frame(4, &view));
+  CHECK(!reader.Frame(-1, &view));
+  reader.Seek(3);
+  CHECK(reader.Next(&view));
+  CHECK_EQ(view.index, 3);
+  CHECK(!reader.Next(&view));
+  reader.Seek(0);
+  CHECK(reader.Next(&view));
+  CHECK_EQ(view.image.planes[0][0], 'a');
+
+  const custom::PlaneSource luma = view.Plane(0);
+  CHECK_EQ(luma.width, 6);
+  CHECK_EQ(luma.stride, 6);
+  CHECK_EQ(luma.bytes_per_sample, 1);
+  const custom::PlaneSource chroma = view.Plane(1);
+  CHECK_EQ(chroma.width, 3);
+  CHECK_EQ(chroma.height, 2);
+  CHECK_EQ(chroma.stride, 6);
+  CHECK_EQ(chroma.bytes_per_sample, 2);
+  CHECK(!view.Plane(2).data);
+
+  memset(view.image.planes[0], 'q', custom::YuvFileFrameSize(info));
+  CHECK(reader.Frame(0, &view));
+  CHECK_EQ(view.image.planes[0][0], 'q');
+  reader.Close();
+  CHECK_EQ(reader.frame_count(), 0);
+  CHECK_EQ(ReadFile(path), contents + "zz");
+  remove(path.c_str());
+}
+
+void TestRejectsInvalidFiles() {
+  custom::YuvFileReader reader;
+  std::string error;
+  CHECK(!reader.Open("YuvFileTest.missing", Info(custom::kFourccI420, 4, 2), &error));
+  CHECK(!error.empty());
+  WriteFile("YuvFileTest.yuv", "");
+  CHECK(!reader.Open("YuvFileTest.yuv", Info(custom::kFourccI420, 4, 2), nullptr));
+  WriteFile("YuvFileTest.yuv", "abcdefghijkl");
+  CHECK(!reader.Open("YuvFileTest.yuv", custom::YuvFileInfo(), nullptr));
+  CHECK(reader.Open("YuvFileTest.yuv", Info(custom::kFourccI420, 4, 2), nullptr));
+  CHECK_EQ(reader.frame_count(), 1);
+  remove("YuvFileTest.yuv");
+
+  custom::YuvFileWriter writer;
+  CHECK(!writer.Open("YuvFileTest.yuv", Info(custom::kFourccBGRA, 4, 2), custom::YuvFileWriterConfig(), nullptr));
+  CHECK(!writer.Open("YuvFileTest.missing/out.yuv", Info(custom::kFourccI420, 4, 2), custom::YuvFileWriterConfig(),
+                     &error));
+  CHECK(writer.Open("YuvFileTest.yuv", Info(custom::kFourccI420, 4, 2), custom::YuvFileWriterConfig(), nullptr));
+  const custom_test::TestFrame other_size = RandomFrame(custom::kFourccI420, 4, 4, 1);
+  CHECK(!writer.WriteFrame(other_size.image));
+  CHECK(writer.Close());
+  CHECK_EQ(writer.bytes_written(), 0u);
+  CHECK(!writer.WriteFrame(RandomFrame(custom::kFourccI420, 4, 2, 1).image));
+  remove("YuvFileTest.yuv");
+}
+
+}  // namespace
+
+int main() {
+  TestFrameSize();
+  TestRoundTrip();
+  TestY4MHeader();
+  TestViews();
+  TestRejectsInvalidFiles();
+  return TestExitCode();
+}
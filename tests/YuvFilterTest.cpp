@@ -0,0 +1,320 @@
+//
+//  YuvFilterTest.cpp
+//  WebRTCExample
+//
+//  Created by rcadmin on 2022/3/7.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "TestCheck.h"
+#include "YuvFilter.h"
+
+namespace {
+
+const custom::SimdPath kPaths[] = {custom::SimdPath::kScalar, custom::SimdPath::kSSE2, custom::SimdPath::kAVX2,
+                                   custom::SimdPath::kNEON};
+
+// A 4:2:0 frame with its own storage; strides are padded by |padding| bytes.
+struct Frame {
+  std::vector<uint8_t> storage[custom::kMaxPlanes];
+  custom::Yuv420Image image;
+
+  Frame(uint32_t format, int width, int height, int padding = 0) {
+    image.format = format;
+    image.width = width;
+    image.height = height;
+    const int chroma_width = (width + 1) / 2;
+    const int chroma_height = (height + 1) / 2;
+    const bool nv12 = format != custom::kFourccI420;
+    const int planes = nv12 ? 2 : 3;
+    for (int i = 0; i < planes; ++i) {
+      const int row = i == 0 ? width : (nv12 ? chroma_width * 2 : chroma_width);
+      const int rows = i == 0 ? height : chroma_height;
+      image.strides[i] = row + padding;
+      storage[i].assign(static_cast<size_t>(image.strides[i]) * rows, 0xEE);
+      image.planes[i] = storage[i].data();
+    }
+  }
+
+  uint8_t Y(int x, int y) const { return image.planes[0][y * image.strides[0] + x]; }
+  uint8_t U(int x, int y) const {
+    return image.format == custom::kFourccI420 ? image.planes[1][y * image.strides[1] + x]
+                                               : image.planes[1][y * image.strides[1] + 2 * x];
+  }
+  uint8_t V(int x, int y) const {
+    return image.format == custom::kFourccI420 ? image.planes[2][y * image.strides[2] + x]
+                                               : image.planes[1][y * image.strides[1] + 2 * x + 1];
+  }
+  void Set(int plane, int x, int y, uint8_t value) { image.planes[plane][y * image.strides[plane] + x] = value; }
+};
+
+// Smooth content with some noise, the kind of frame a camera delivers.
+void Fill(Frame *frame, uint32_t seed) {
+  uint32_t state = seed;
+  auto noise = [&state]() {
+    state = state * 1664525u + 1013904223u;
+    return static_cast<int>(state >> 28) - 8;
+  };
+  const custom::Yuv420Image &image = frame->image;
+  for (int y = 0; y < image.height; ++y) {
+    for (int x = 0; x < image.width; ++x) {
+      frame->Set(0, x, y, static_cast<uint8_t>(std::clamp(40 + x * 3 + y * 2 + noise(), 0, 255)));
+    }
+  }
+  for (int y = 0; y < (image.height + 1) / 2; ++y) {
+    for (int x = 0; x < (image.width + 1) / 2; ++x) {
+      const uint8_t u = static_cast<uint8_t>(std::clamp(90 + x * 4 + noise(), 0, 255));
+      const uint8_t v = static_cast<uint8_t>(std::clamp(170 - y * 5 + noise(), 0, 255));
+      if (image.format == custom::kFourccI420) {
+        frame->Set(1, x, y, u);
+        frame->Set(2, x, y, v);
+      } else {
+        frame->Set(1, 2 * x, y, u);
+        frame->Set(1, 2 * x + 1, y, v);
+      }
+    }
+  }
+}
+
+// Chroma of |frame| sampled bilinearly at luma pixel (x, y), as a GPU samples
+// a half size texture with GL_LINEAR and GL_CLAMP_TO_EDGE, in [0, 1].
+void SampleChroma(const Frame &frame, int x, int y, float *u, float *v) {
+  const int cw = (frame.image.width + 1) / 2;
+  const int ch = (frame.image.height + 1) / 2;
+  const float cx = std::clamp((x + 0.5f) * cw / frame.image.width - 0.5f, 0.0f, cw - 1.0f);
+  const float cy = std::clamp((y + 0.5f) * ch / frame.image.height - 0.5f, 0.0f, ch - 1.0f);
+  const int x0 = static_cast<int>(cx);
+  const int y0 = static_cast<int>(cy);
+  const int x1 = std::min(x0 + 1, cw - 1);
+  const int y1 = std::min(y0 + 1, ch - 1);
+  const float fx = cx - x0;
+  const float fy = cy - y0;
+  auto lerp = [&](uint8_t (Frame::*get)(int, int) const) {
+    const float top = (frame.*get)(x0, y0) * (1 - fx) + (frame.*get)(x1, y0) * fx;
+    const float bottom = (frame.*get)(x0, y1) * (1 - fx) + (frame.*get)(x1, y1) * fx;
+    return (top * (1 - fy) + bottom * fy) / 255.0f;
+  };
+  *u = lerp(&Frame::U);
+  *v = lerp(&Frame::V);
+}
+
+// Float model of CustomTargetShader's NV12 output for |filter|: decode with the
+// shader's matrix, filter, clamp, look up, then encode with BT.601 video range and a
+// 2x2 chroma box.
+void ShaderModel(const custom::YuvFilter &filter, const Frame &src, std::vector<float> *y_out,
+                 std::vector<float> *u_out, std::vector<float> *v_out) {
+  const int width = src.image.width;
+  const int height = src.image.height;
+  std::vector<float> rgb(static_cast<size_t>(width) * height * 3);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      float u, v;
+      SampleChroma(src, x, y, &u, &v);
+      const float luma = src.Y(x, y) / 255.0f;
+      const float in[3] = {luma + 1.403f * (v - 0.5f), luma - 0.344f * (u - 0.5f) - 0.714f * (v - 0.5f),
+                           luma + 1.770f * (u - 0.5f)};
+      for (int c = 0; c < 3; ++c) {
+        float value = filter.offset[c];
+        for (int k = 0; k < 3; ++k) {
+          value += filter.matrix[c * 3 + k] * in[k];
+        }
+        value = std::clamp(value, 0.0f, 1.0f) * 255.0f;
+        if (filter.has_lut) {
+          value = filter.lut[c][static_cast<int>(value + 0.5f)];
+        }
+        rgb[(static_cast<size_t>(y) * width + x) * 3 + c] = value;
+      }
+    }
+  }
+  auto at = [&](int x, int y, int c) { return rgb[(static_cast<size_t>(y) * width + x) * 3 + c]; };
+  y_out->resize(static_cast<size_t>(width) * height);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      (*y_out)[y * width + x] = (66 * at(x, y, 0) + 129 * at(x, y, 1) + 25 * at(x, y, 2)) / 256.0f + 16;
+    }
+  }
+  const int cw = (width + 1) / 2;
+  const int ch = (height + 1) / 2;
+  u_out->resize(static_cast<size_t>(cw) * ch);
+  v_out->resize(u_out->size());
+  for (int y = 0; y < ch; ++y) {
+    for (int x = 0; x < cw; ++x) {
+      float sum[3] = {};
+      for (int c = 0; c < 3; ++c) {
+        for (int dy = 0; dy < 2; ++dy) {
+          for (int dx = 0; dx < 2; ++dx) {
+            sum[c] += at(std::min(2 * x + dx, width - 1), std::min(2 * y + dy, height - 1), c) / 4;
+          }
+        }
+      }
+      (*u_out)[y * cw + x] = (-38 * sum[0] - 74 * sum[1] + 112 * sum[2]) / 256.0f + 128;
+      (*v_out)[y * cw + x] = (112 * sum[0] - 94 * sum[1] - 18 * sum[2]) / 256.0f + 128;
+    }
+  }
+}
+
+// Largest difference between |frame| and the rounded model.
+float MaxError(const Frame &frame, const std::vector<float> &y, const std::vector<float> &u,
+               const std::vector<float> &v) {
+  const int width = frame.image.width;
+  const int cw = (width + 1) / 2;
+  float error = 0;
+  for (int row = 0; row < frame.image.height; ++row) {
+    for (int x = 0; x < width; ++x) {
+      const float expected = std::clamp(std::floor(y[row * width + x] + 0.5f), 0.0f, 255.0f);
+      error = std::max(error, std::fabs(frame.Y(x, row) - expected));
+    }
+  }
+  for (int row = 0; row < (frame.image.height + 1) / 2; ++row) {
+    for (int x = 0; x < cw; ++x) {
+      const float expected_u = std::clamp(std::floor(u[row * cw + x] + 0.5f), 0.0f, 255.0f);
+      const float expected_v = std::clamp(std::floor(v[row * cw + x] + 0.5f), 0.0f, 255.0f);
+      error = std::max(error, std::fabs(frame.U(x, row) - expected_u));
+      error = std::max(error, std::fabs(frame.V(x, row) - expected_v));
+    }
+  }
+  return error;
+}
+
+std::vector<custom::YuvFilter> Filters() {
+  const float sepia[9] = {0.393f, 0.769f, 0.189f, 0.349f, 0.686f, 0.168f, 0.272f, 0.534f, 0.131f};
+  const float offset[3] = {0.02f, 0, -0.02f};
+  uint8_t invert[256];
+  for (int i = 0; i < 256; ++i) {
+    invert[i] = static_cast<uint8_t>(255 - i);
+  }
+  custom::YuvFilter graded;
+  custom::ComposeYuvFilters(custom::YuvFilter::BrightnessContrast(0.05f, 1.1f), custom::YuvFilter::Lut(invert),
+                            &graded);
+  return {custom::YuvFilter::Identity(),
+          custom::YuvFilter::Grayscale(),
+          custom::YuvFilter::BrightnessContrast(0.1f, 1.3f),
+          custom::YuvFilter::ColorMatrix(sepia, offset),
+          custom::YuvFilter::Lut(invert),
+          graded};
+}
+
+// Within 1 code value of the shader model, for every layout and SIMD path.
+void TestMatchesShaderModel() {
+  const int kSizes[][2] = {{64, 48}, {33, 17}, {2, 2}, {130, 7}};
+  const uint32_t kFormats[] = {custom::kFourccNV12VideoRange, custom::kFourccI420};
+  for (const auto &size : kSizes) {
+    for (uint32_t format : kFormats) {
+      Frame src(format, size[0], size[1], 8);
+      Fill(&src, size[0] * 7 + format);
+      for (const custom::YuvFilter &filter : Filters()) {
+        std::vector<float> y, u, v;
+        ShaderModel(filter, src, &y, &u, &v);
+        for (custom::SimdPath path : kPaths) {
+          if (!custom::IsSimdPathSupported(path)) {
+            continue;
+          }
+          Frame dst(custom::kFourccNV12VideoRange, size[0], size[1], 16);
+          CHECK(custom::ApplyYuvFilter(filter, src.image, dst.image, path));
+          const float error = MaxError(dst, y, u, v);
+          if (error > 1) {
+            fprintf(stderr, "%dx%d %s on %s: max error %.0f\n", size[0], size[1],
+                    format == custom::kFourccI420 ? "i420" : "nv12", custom::SimdPathName(path), error);
+            CHECK(false);
+          }
+        }
+      }
+    }
+  }
+}
+
+bool SamePixels(const Frame &a, const Frame &b) {
+  for (int y = 0; y < a.image.height; ++y) {
+    for (int x = 0; x < a.image.width; ++x) {
+      if (a.Y(x, y) != b.Y(x, y)) {
+        return false;
+      }
+    }
+  }
+  for (int y = 0; y < (a.image.height + 1) / 2; ++y) {
+    for (int x = 0; x < (a.image.width + 1) / 2; ++x) {
+      if (a.U(x, y) != b.U(x, y) || a.V(x, y) != b.V(x, y)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// In place filtering and I420 output give the same pixels as NV12 output.
+void TestLayoutsAndInPlace() {
+  const custom::YuvFilter filter = custom::YuvFilter::BrightnessContrast(-0.05f, 1.2f);
+  Frame src(custom::kFourccNV12VideoRange, 37, 21, 4);
+  Fill(&src, 5);
+  Frame nv12(custom::kFourccNV12VideoRange, 37, 21);
+  Frame i420(custom::kFourccI420, 37, 21, 12);
+  CHECK(custom::ApplyYuvFilter(filter, src.image, nv12.image));
+  CHECK(custom::ApplyYuvFilter(filter, src.image, i420.image));
+  CHECK(SamePixels(nv12, i420));
+  CHECK(custom::ApplyYuvFilter(filter, src.image, src.image));
+  CHECK(SamePixels(nv12, src));
+}
+
+void TestCompose() {
+  uint8_t invert[256];
+  for (int i = 0; i < 256; ++i) {
+    invert[i] = static_cast<uint8_t>(255 - i);
+  }
+  custom::YuvFilter composed;
+  CHECK(custom::ComposeYuvFilters(custom::YuvFilter::Grayscale(), custom::YuvFilter::Lut(invert), &composed));
+  CHECK(composed.has_lut);
+  // A matrix after a lookup table can't be folded into one filter.
+  CHECK(!custom::ComposeYuvFilters(custom::YuvFilter::Lut(invert), custom::YuvFilter::Grayscale(), &composed));
+}
+
+void TestFlipAndCopy() {
+  Frame frame(custom::kFourccI420, 9, 5, 3);
+  Fill(&frame, 9);
+  Frame original = frame;
+  original.image.planes[0] = original.storage[0].data();
+  original.image.planes[1] = original.storage[1].data();
+  original.image.planes[2] = original.storage[2].data();
+  CHECK(custom::FlipYuv420Vertically(frame.image));
+  CHECK_EQ(frame.Y(4, 0), original.Y(4, 4));
+  CHECK_EQ(frame.U(1, 0), original.U(1, 2));
+  CHECK_EQ(frame.V(4, 2), original.V(4, 0));
+
+  Frame copy(custom::kFourccI420, 9, 5);
+  custom::DirtyRect rect;
+  rect.x = 2;
+  rect.y = 2;
+  rect.width = 7;
+  rect.height = 3;
+  CHECK(custom::CopyYuv420Rect(original.image, copy.image, rect));
+  CHECK_EQ(copy.Y(8, 4), original.Y(8, 4));
+  CHECK_EQ(copy.U(4, 2), original.U(4, 2));
+  CHECK_EQ(copy.Y(1, 1), 0xEE);
+}
+
+void TestRejectsInvalidImages() {
+  Frame src(custom::kFourccNV12VideoRange, 16, 8);
+  Frame smaller(custom::kFourccNV12VideoRange, 16, 6);
+  CHECK(!custom::ApplyYuvFilter(custom::YuvFilter::Identity(), src.image, smaller.image));
+  custom::Yuv420Image bad = src.image;
+  bad.strides[0] = 8;
+  CHECK(!custom::IsValidYuv420Image(bad));
+  bad = src.image;
+  bad.format = custom::kFourccBGRA;
+  CHECK(!custom::IsValidYuv420Image(bad));
+}
+
+}  // namespace
+
+int main() {
+  TestMatchesShaderModel();
+  TestLayoutsAndInPlace();
+  TestCompose();
+  TestFlipAndCopy();
+  TestRejectsInvalidImages();
+  return TestExitCode();
+}